@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+#include <cfloat>
 #include <DirectXMath.h>
 
 using namespace DirectX;
@@ -10,14 +12,14 @@ struct AABB
 
     void expand(const AABB& b)
     {
-        minv.x = min(minv.x, b.minv.x); minv.y = min(minv.y, b.minv.y); minv.z = min(minv.z, b.minv.z);
-        maxv.x = max(maxv.x, b.maxv.x); maxv.y = max(maxv.y, b.maxv.y); maxv.z = max(maxv.z, b.maxv.z);
+        minv.x = (std::min)(minv.x, b.minv.x); minv.y = (std::min)(minv.y, b.minv.y); minv.z = (std::min)(minv.z, b.minv.z);
+        maxv.x = (std::max)(maxv.x, b.maxv.x); maxv.y = (std::max)(maxv.y, b.maxv.y); maxv.z = (std::max)(maxv.z, b.maxv.z);
     }
 
     void expand(const XMFLOAT3& p)
     {
-        minv.x = min(minv.x, p.x); minv.y = min(minv.y, p.y); minv.z = min(minv.z, p.z);
-        maxv.x = max(maxv.x, p.x); maxv.y = max(maxv.y, p.y); maxv.z = max(maxv.z, p.z);
+        minv.x = (std::min)(minv.x, p.x); minv.y = (std::min)(minv.y, p.y); minv.z = (std::min)(minv.z, p.z);
+        maxv.x = (std::max)(maxv.x, p.x); maxv.y = (std::max)(maxv.y, p.y); maxv.z = (std::max)(maxv.z, p.z);
     }
 
     XMFLOAT3 center() const
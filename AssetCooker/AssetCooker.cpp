@@ -0,0 +1,419 @@
+// Офлайн-кукер: заранее делает всё, что AssetLoader делает при старте (разбор OBJ, сварка вершин,
+// касательные, оптимизация порядка, LOD-цепочки, мешлеты), и пишет MeshCache в том виде, в каком его откроет рантайм.
+// Текстуры сцены конвертируются в DDS с полной цепочкой мипов (на Windows, через DirectXTex/WIC).
+//
+// AssetCooker [-o MeshCache] [-j потоки] [-d 0,500,1000] [-f] lod0.obj[,lod1.obj...] ...
+//
+// Пересобирается только то, у чего поменялся хэш содержимого: для сцен хэш OBJ+MTL лежит
+// в заголовке кэша, для текстур - в Textures/manifest.txt. Независимые ассеты готовятся параллельно.
+#include "ObjImport.h"
+#include "MeshCacheFormat.h"
+#include "ShaderCache.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <DirectXTex.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // меняется вместе с параметрами конвертации текстур
+    const uint64_t kTextureCookVersion = 1;
+
+    struct CookOptions
+    {
+        fs::path outDir = "MeshCache";
+        unsigned threads = 0;
+        std::vector<float> distances = { 0.0f, 500.0f, 1000.0f, 1500.0f };
+        LodChainSettings lods;
+        bool force = false;
+        std::vector<std::vector<std::string>> scenes;
+    };
+
+    enum class CookStatus { UpToDate, Cooked, Failed };
+
+    struct SceneJob
+    {
+        std::vector<std::string> objPaths;
+        CookStatus status = CookStatus::UpToDate;
+        std::string error;
+        std::vector<fs::path> textures;
+        MeshOptimizeStats meshStats;  // сумма по всем мешам и LOD, только для пересобранных
+        std::vector<size_t> lodTriangles;  // по LOD: сумма по мешам
+        std::vector<float> lodErrors;      // по LOD: наибольшая по мешам
+    };
+
+    struct TextureJob
+    {
+        fs::path source;
+        fs::path output;
+        uint64_t hash = 0;
+        CookStatus status = CookStatus::UpToDate;
+        std::string error;
+    };
+
+    void PrintUsage()
+    {
+        std::printf(
+            "usage: AssetCooker [-o dir] [-j threads] [-d d0,d1,...] [-r r1,r2,...] [-f] lod0.obj[,lod1.obj...] ...\n"
+            "  -o  output directory (MeshCache)\n"
+            "  -j  worker threads (all cores)\n"
+            "  -d  LOD switch distances (0,500,1000,1500), must match the runtime\n"
+            "  -r  generated LOD triangle ratios for single-file scenes (0.5,0.25,0.125), must match the runtime\n"
+            "  -f  cook everything, ignoring hashes\n");
+    }
+
+    std::vector<std::string> Split(const std::string& s, char sep)
+    {
+        std::vector<std::string> out;
+        size_t pos = 0;
+        while (pos <= s.size())
+        {
+            size_t end = s.find(sep, pos);
+            if (end == std::string::npos)
+                end = s.size();
+            if (end > pos)
+                out.push_back(s.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        return out;
+    }
+
+    bool ParseArgs(int argc, char** argv, CookOptions& opt)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string a = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (a == "-o" && hasValue)
+                opt.outDir = argv[++i];
+            else if (a == "-j" && hasValue)
+                opt.threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+            else if (a == "-d" && hasValue)
+            {
+                opt.distances.clear();
+                for (const std::string& d : Split(argv[++i], ','))
+                    opt.distances.push_back(std::strtof(d.c_str(), nullptr));
+            }
+            else if (a == "-r" && hasValue)
+            {
+                opt.lods.triangleRatios.clear();
+                for (const std::string& r : Split(argv[++i], ','))
+                    opt.lods.triangleRatios.push_back(std::strtof(r.c_str(), nullptr));
+            }
+            else if (a == "-f")
+                opt.force = true;
+            else if (!a.empty() && a[0] != '-')
+                opt.scenes.push_back(Split(a, ','));
+            else
+                return false;
+        }
+        return !opt.scenes.empty();
+    }
+
+    bool HashFile(const fs::path& path, uint64_t& outHash)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        std::vector<char> buf(1 << 20);
+        uint64_t h = ShaderCache::HashBytes(&kTextureCookVersion, sizeof(kTextureCookVersion));
+        while (in)
+        {
+            in.read(buf.data(), (std::streamsize)buf.size());
+            h = ShaderCache::HashBytes(buf.data(), (size_t)in.gcount(), h);
+        }
+        outHash = h;
+        return true;
+    }
+
+    // так же, как RenderingSystem::LoadTextures: путь из MTL относительно каталога OBJ, затем только имя файла
+    bool ResolveTexture(const fs::path& objDir, const std::string& rel, fs::path& out)
+    {
+        if (rel.empty())
+            return false;
+        std::error_code ec;
+        fs::path p1 = objDir / rel;
+        if (fs::exists(p1, ec)) { out = p1; return true; }
+        fs::path p2 = objDir / fs::path(rel).filename();
+        if (fs::exists(p2, ec)) { out = p2; return true; }
+        return false;
+    }
+
+    std::map<std::string, uint64_t> LoadManifest(const fs::path& path)
+    {
+        std::map<std::string, uint64_t> m;
+        std::ifstream in(path);
+        std::string name;
+        unsigned long long hash;
+        while (in >> name >> std::hex >> hash)
+            m[name] = hash;
+        return m;
+    }
+
+    void SaveManifest(const fs::path& path, const std::map<std::string, uint64_t>& m)
+    {
+        std::error_code ec;
+        fs::path tmp = path;
+        tmp += ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            for (const auto& e : m)
+                out << e.first << ' ' << std::hex << e.second << '\n';
+            if (!out)
+                return;
+        }
+        fs::rename(tmp, path, ec);
+    }
+
+    // parsePool - для разбора OBJ; внутри ParallelFor по сценам должен быть nullptr
+    void CookScene(const CookOptions& opt, SceneJob& job, TaskPool* parsePool)
+    {
+        const uint64_t hash = HashMeshSources(job.objPaths, opt.distances, opt.lods);
+        const std::wstring path = MeshCachePathForSources(opt.outDir.wstring(), job.objPaths);
+        const fs::path objDir = fs::path(job.objPaths[0]).parent_path();
+
+        std::vector<std::string> texturePaths;
+        MeshCacheInfo info;
+        if (!opt.force && ReadMeshCacheInfo(path, info) && info.sourceHash == hash)
+        {
+            texturePaths = std::move(info.texturePaths);
+        }
+        else
+        {
+            const std::vector<ImportedObject> objects = ImportScene(job.objPaths, opt.lods, parsePool);
+            if (!WriteMeshCache(path, hash, objects, opt.distances))
+                throw std::runtime_error("cannot write " + fs::path(path).string());
+            job.status = CookStatus::Cooked;
+
+            for (const ImportedObject& o : objects)
+            {
+                for (const MeshOptimizeStats& s : o.lodOptimizeStats)
+                {
+                    job.meshStats.before += s.before;
+                    job.meshStats.after += s.after;
+                }
+                if (job.lodTriangles.size() < o.lodMeshes.size())
+                {
+                    job.lodTriangles.resize(o.lodMeshes.size(), 0);
+                    job.lodErrors.resize(o.lodMeshes.size(), 0.0f);
+                }
+                for (size_t k = 0; k < o.lodMeshes.size(); ++k)
+                {
+                    job.lodTriangles[k] += o.lodMeshes[k].indices.size() / 3;
+                    if (k < o.lodErrors.size())
+                        job.lodErrors[k] = (std::max)(job.lodErrors[k], o.lodErrors[k]);
+                }
+                for (const std::string* t : { &o.material.diffuseTexPath, &o.material.normalTexPath,
+                    &o.material.displacementTexPath, &o.material.roughnessTexPath,
+                    &o.material.metallicTexPath, &o.material.aoTexPath })
+                    texturePaths.push_back(*t);
+            }
+        }
+
+        for (const std::string& rel : texturePaths)
+        {
+            fs::path full;
+            if (ResolveTexture(objDir, rel, full))
+                job.textures.push_back(full);
+        }
+    }
+
+#ifdef _WIN32
+    void CookTexture(const TextureJob& job)
+    {
+        // WIC работает через COM, потоки TaskPool его не инициализируют
+        const HRESULT coHr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+        DirectX::ScratchImage image;
+        DirectX::TexMetadata meta{};
+        const std::wstring src = job.source.wstring();
+        const std::wstring ext = job.source.extension().wstring();
+
+        HRESULT hr;
+        if (_wcsicmp(ext.c_str(), L".tga") == 0)
+            hr = DirectX::LoadFromTGAFile(src.c_str(), &meta, image);
+        else if (_wcsicmp(ext.c_str(), L".dds") == 0)
+            hr = DirectX::LoadFromDDSFile(src.c_str(), DirectX::DDS_FLAGS_NONE, &meta, image);
+        else if (_wcsicmp(ext.c_str(), L".hdr") == 0)
+            hr = DirectX::LoadFromHDRFile(src.c_str(), &meta, image);
+        else
+            hr = DirectX::LoadFromWICFile(src.c_str(), DirectX::WIC_FLAGS_NONE, &meta, image);
+
+        DirectX::ScratchImage mips;
+        const DirectX::ScratchImage* result = &image;
+        if (SUCCEEDED(hr) && meta.mipLevels == 1 && !DirectX::IsCompressed(meta.format))
+        {
+            hr = DirectX::GenerateMipMaps(*image.GetImage(0, 0, 0), DirectX::TEX_FILTER_DEFAULT, 0, mips);
+            result = &mips;
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            hr = DirectX::SaveToDDSFile(result->GetImages(), result->GetImageCount(), result->GetMetadata(),
+                DirectX::DDS_FLAGS_NONE, job.output.wstring().c_str());
+        }
+
+        if (SUCCEEDED(coHr))
+            CoUninitialize();
+        if (FAILED(hr))
+            throw std::runtime_error("texture conversion failed");
+    }
+    const bool kCanCookTextures = true;
+#else
+    // без WIC PNG/JPG не прочитать; рантайм тогда грузит исходники как раньше
+    void CookTexture(const TextureJob&) {}
+    const bool kCanCookTextures = false;
+#endif
+
+    const char* StatusName(CookStatus s)
+    {
+        return s == CookStatus::Cooked ? "cooked" : s == CookStatus::Failed ? "FAILED" : "up to date";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    CookOptions opt;
+    if (!ParseArgs(argc, argv, opt))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    TaskPool pool(opt.threads);
+
+    std::vector<SceneJob> scenes(opt.scenes.size());
+    for (size_t i = 0; i < scenes.size(); ++i)
+        scenes[i].objPaths = opt.scenes[i];
+
+    auto cookScene = [&](size_t i, TaskPool* parsePool)
+    {
+        try { CookScene(opt, scenes[i], parsePool); }
+        catch (const std::exception& ex)
+        {
+            scenes[i].status = CookStatus::Failed;
+            scenes[i].error = ex.what();
+        }
+    };
+
+    // ParallelFor не вкладывается: одна сцена разбирается всеми потоками, несколько - по сцене на поток
+    if (scenes.size() == 1)
+    {
+        cookScene(0, &pool);
+    }
+    else
+    {
+        pool.ParallelFor(scenes.size(), 1, [&](size_t b, size_t e)
+        {
+            for (size_t i = b; i < e; ++i)
+                cookScene(i, nullptr);
+        });
+    }
+
+    // одна текстура может быть у нескольких сцен
+    const fs::path textureDir = opt.outDir / "Textures";
+    const fs::path manifestPath = textureDir / "manifest.txt";
+    std::map<std::string, uint64_t> manifest = LoadManifest(manifestPath);
+
+    std::set<fs::path> uniqueTextures;
+    if (kCanCookTextures)
+    {
+        for (const SceneJob& s : scenes)
+            uniqueTextures.insert(s.textures.begin(), s.textures.end());
+    }
+    else
+    {
+        std::printf("textures skipped: conversion needs the Windows build (DirectXTex/WIC)\n");
+    }
+
+    std::vector<TextureJob> textures;
+    for (const fs::path& src : uniqueTextures)
+    {
+        TextureJob t;
+        t.source = src;
+        t.output = CookedTexturePath(opt.outDir.wstring(), src.wstring());
+        textures.push_back(t);
+    }
+
+    std::error_code ec;
+    if (!textures.empty())
+        fs::create_directories(textureDir, ec);
+
+    pool.ParallelFor(textures.size(), 1, [&](size_t b, size_t e)
+    {
+        for (size_t i = b; i < e; ++i)
+        {
+            TextureJob& t = textures[i];
+            try
+            {
+                if (!HashFile(t.source, t.hash))
+                    throw std::runtime_error("cannot read source");
+
+                const auto it = manifest.find(t.output.filename().string());
+                std::error_code existsEc;
+                if (!opt.force && it != manifest.end() && it->second == t.hash && fs::exists(t.output, existsEc))
+                    continue;
+
+                CookTexture(t);
+                t.status = CookStatus::Cooked;
+            }
+            catch (const std::exception& ex)
+            {
+                t.status = CookStatus::Failed;
+                t.error = ex.what();
+            }
+        }
+    });
+
+    int failed = 0;
+    for (const SceneJob& s : scenes)
+    {
+        std::printf("[%s] %s%s%s\n", StatusName(s.status), s.objPaths[0].c_str(),
+            s.error.empty() ? "" : ": ", s.error.c_str());
+        if (s.status == CookStatus::Cooked)
+        {
+            const VertexCacheStats& b = s.meshStats.before;
+            const VertexCacheStats& a = s.meshStats.after;
+            // кэш вершин - по всем LOD вместе, треугольники - по каждому LOD отдельно
+            std::printf("    all LODs: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overfetch %.2f -> %.2f\n",
+                b.Acmr(), a.Acmr(), b.Atvr(), a.Atvr(),
+                b.Overfetch(sizeof(Vertex)), a.Overfetch(sizeof(Vertex)));
+            if (!s.lodTriangles.empty())
+                std::printf("    LOD 0: %zu tris\n", s.lodTriangles[0]);
+            for (size_t k = 1; k < s.lodTriangles.size(); ++k)
+                std::printf("    LOD %zu: %zu tris, error %g\n", k, s.lodTriangles[k], s.lodErrors[k]);
+        }
+        failed += s.status == CookStatus::Failed;
+    }
+    for (const TextureJob& t : textures)
+    {
+        if (t.status == CookStatus::Cooked)
+            manifest[t.output.filename().string()] = t.hash;
+        if (t.status != CookStatus::UpToDate)
+            std::printf("[%s] %s%s%s\n", StatusName(t.status), t.source.string().c_str(),
+                t.error.empty() ? "" : ": ", t.error.c_str());
+    }
+    if (!textures.empty())
+        SaveManifest(manifestPath, manifest);
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu scenes, %zu textures, %u threads, %.2f s\n",
+        scenes.size(), textures.size(), pool.GetThreadCount(), seconds);
+    return failed ? 1 : 0;
+}
@@ -1,8 +1,8 @@
 ﻿#include "AssetLoader.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-#include <unordered_map>
+#include "ObjParser.h"
+#include "VertexWeld.h"
+#include "MeshOptimizer.h"
 #include <WICTextureLoader.h>
 #include "DX12Framework.h"
 #include <d3d12.h>
@@ -10,6 +10,7 @@
 #include <DirectXTex.h>
 #include <filesystem>
 #include "SceneObject.h"
+#include "ObjImport.h"
 #include <vector>
 #include <algorithm>
 
@@ -40,23 +41,24 @@ Mesh AssetLoader::LoadGeometry(const std::string& objPath)
     std::vector<tinyobj::shape_t> shapes;
     std::string warn, err;
 
-    bool ok = tinyobj::LoadObj(&attrib, &shapes, nullptr, &warn, &err, objPath.c_str(), nullptr);
+    bool ok = ParallelLoadObj(&attrib, &shapes, nullptr, &warn, &err, objPath.c_str(), nullptr, m_taskPool);
     if (!ok) {
         throw std::runtime_error("TinyObjLoader error: " + warn + err);
     }
 
     Mesh mesh;
-    std::unordered_map<uint64_t, UINT32> uniqueVerts;
-    uniqueVerts.reserve(shapes.size() * 3);
+    size_t corners = 0;
+    for (const auto& shape : shapes)
+        corners += shape.mesh.indices.size();
+    VertexWeldTable weld(attrib.vertices.size() / 3, (std::min)(corners, attrib.vertices.size() / 3));
+    mesh.indices.reserve(corners);
 
     for (const auto& shape : shapes) {
         for (const auto& idx : shape.mesh.indices) {
-            uint64_t key = (uint64_t(idx.vertex_index + 1) << 42)
-                | (uint64_t(idx.texcoord_index + 1) << 21)
-                | uint64_t(idx.normal_index + 1);
-
-            auto it = uniqueVerts.find(key);
-            if (it == uniqueVerts.end()) {
+            bool isNew;
+            const UINT32 newIndex = weld.FindOrAdd(idx.vertex_index, idx.texcoord_index, idx.normal_index, 0,
+                static_cast<UINT32>(mesh.vertices.size()), isNew);
+            if (isNew) {
                 Vertex v{};
                 v.Pos = {
                     attrib.vertices[3 * idx.vertex_index + 0],
@@ -85,14 +87,9 @@ Mesh AssetLoader::LoadGeometry(const std::string& objPath)
                 v.tangent = { 0.0f, 0.0f, 0.0f };
                 v.handedness = 0.0f;
 
-                UINT32 newIndex = static_cast<UINT32>(mesh.vertices.size());
                 mesh.vertices.push_back(v);
-                mesh.indices.push_back(newIndex);
-                uniqueVerts[key] = newIndex;
-            }
-            else {
-                mesh.indices.push_back(it->second);
             }
+            mesh.indices.push_back(newIndex);
         }
     }
 
@@ -137,6 +134,7 @@ Mesh AssetLoader::LoadGeometry(const std::string& objPath)
         }
     }
 
+    OptimizeMesh(mesh);
     return mesh;
 }
 
@@ -312,248 +310,75 @@ UINT AssetLoader::LoadTexture(ID3D12Device* device, ResourceUploadBatch& uploadB
 
     device->CreateShaderResourceView(texture.Get(), &srvDesc, cpuHandle);
 
-    textures.push_back(texture);
+    textures[srvIndex] = texture;
     return srvIndex;
 }
 
-std::vector<SceneObject> AssetLoader::LoadSceneObjects(const std::string& objPath)
+std::vector<SceneObject> AssetLoader::MakeSceneObjects(std::vector<ImportedObject>&& imported, const std::vector<float>& distances)
 {
-    tinyobj::attrib_t                attrib;
-    std::vector<tinyobj::shape_t>    shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string                      warn, err;
-    std::string baseDir = std::filesystem::path(objPath)
-        .parent_path()
-        .string();
-
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, objPath.c_str(), baseDir.c_str())) 
-    {
-        throw std::runtime_error("TinyObjLoader error: " + warn + err);
-    }
-
-    size_t M = materials.size();
-    size_t N = M + 1;
-    std::vector<Mesh> meshPerMat(N);
-    std::vector<std::unordered_map<uint64_t, uint32_t>> uniqueVertMaps(N);
+    std::vector<SceneObject> sceneObjects;
+    sceneObjects.reserve(imported.size());
 
-    for (auto& shape : shapes) 
+    for (auto& src : imported)
     {
-        auto& fvCounts = shape.mesh.num_face_vertices;
-        auto& matIds = shape.mesh.material_ids;
-        auto& idxs = shape.mesh.indices;
+        SceneObject obj(
+            src.lodMeshes[0],
+            { 0.0f,0.0f,0.0f },
+            { 0.0f,0.0f,0.0f },
+            { 1.0f,1.0f,1.0f }
+        );
+        obj.material = std::move(src.material);
+        obj.lodMeshes = std::move(src.lodMeshes);
+        obj.EnsureDefaultLOD();
+        if (!src.lodDistances.empty()) obj.lodDistances = std::move(src.lodDistances);
+        else if (!distances.empty()) obj.lodDistances = distances;
 
-        size_t indexOffset = 0;
-        for (size_t f = 0; f < fvCounts.size(); ++f) 
-        {
-            int rawMatId = (f < matIds.size() ? matIds[f] : -1);
-            int mid = (rawMatId >= 0 && rawMatId < (int)M) ? rawMatId : (int)M;
-
-            Mesh& mesh = meshPerMat[mid];
-            auto& umap = uniqueVertMaps[mid];
-
-            for (size_t v = 0; v < fvCounts[f]; ++v) 
-            {
-                const auto& idx = idxs[indexOffset + v];
-                uint64_t key = (uint64_t(idx.vertex_index + 1) << 42)
-                    | (uint64_t(idx.texcoord_index + 1) << 21)
-                    | uint64_t(idx.normal_index + 1);
-
-                uint32_t newIndex;
-                auto it = umap.find(key);
-                if (it == umap.end()) 
-                {
-                    Vertex vert{};
-                    vert.Pos = 
-                    {
-                        attrib.vertices[3 * idx.vertex_index + 0],
-                        attrib.vertices[3 * idx.vertex_index + 1],
-                        attrib.vertices[3 * idx.vertex_index + 2]
-                    };
-                    if (idx.normal_index >= 0) 
-                    {
-                        vert.Normal = 
-                        {
-                            attrib.normals[3 * idx.normal_index + 0],
-                            attrib.normals[3 * idx.normal_index + 1],
-                            attrib.normals[3 * idx.normal_index + 2]
-                        };
-                    }
-                    if (idx.texcoord_index >= 0) 
-                    {
-                        vert.uv = 
-                        {
-                            attrib.texcoords[2 * idx.texcoord_index + 0],
-                            1.0f - attrib.texcoords[2 * idx.texcoord_index + 1]
-                        };
-                    }
-                    newIndex = static_cast<uint32_t>(mesh.vertices.size());
-                    mesh.vertices.push_back(vert);
-                    umap[key] = newIndex;
-                }
-                else 
-                {
-                    newIndex = it->second;
-                }
-                mesh.indices.push_back(newIndex);
-            }
-            indexOffset += fvCounts[f];
-        }
+        sceneObjects.push_back(std::move(obj));
     }
 
-    for (auto& mesh : meshPerMat) 
-    {
-        for (auto& v : mesh.vertices) 
-        {
-            v.tangent = { 0,0,0 };
-            v.handedness = 0;
-        }
-
-        for (size_t f = 0; f + 2 < mesh.indices.size(); f += 3) 
-        {
-            uint32_t i0 = mesh.indices[f], i1 = mesh.indices[f + 1], i2 = mesh.indices[f + 2];
-            auto& v0 = mesh.vertices[i0];
-            auto& v1 = mesh.vertices[i1];
-            auto& v2 = mesh.vertices[i2];
-
-            float duv1x = v1.uv.x - v0.uv.x;
-            float duv1y = v1.uv.y - v0.uv.y;
-            float duv2x = v2.uv.x - v0.uv.x;
-            float duv2y = v2.uv.y - v0.uv.y;
-
-            float det = duv1x * duv2y - duv2x * duv1y;
-            XMVECTOR T, B;
-            float H;
-
-            if (fabs(det) < 1e-6f)
-            {
-                T = XMVectorSet(1, 0, 0, 0);
-                B = XMVectorSet(0, 1, 0, 0);
-                H = 1.0f;
-            }
-            else
-            {
-                float invDet = 1.0f / det;
-                XMVECTOR p0 = XMLoadFloat3(&v0.Pos);
-                XMVECTOR p1 = XMLoadFloat3(&v1.Pos);
-                XMVECTOR p2 = XMLoadFloat3(&v2.Pos);
-                XMVECTOR edge1 = p1 - p0;
-                XMVECTOR edge2 = p2 - p0;
-
-                T = (edge1 * duv2y - edge2 * duv1y) * invDet;
-                B = (edge2 * duv1x - edge1 * duv2x) * invDet;
-                H = XMVectorGetX(XMVector3Dot(XMVector3Cross(edge1, edge2), B)) < 0 ? -1.0f : 1.0f;
-            }
-
-            XMVECTOR t0 = XMVector3Normalize(XMLoadFloat3(&v0.tangent) + T);
-            XMVECTOR t1 = XMVector3Normalize(XMLoadFloat3(&v1.tangent) + T);
-            XMVECTOR t2 = XMVector3Normalize(XMLoadFloat3(&v2.tangent) + T);
-
-            XMStoreFloat3(&v0.tangent, t0);
-            XMStoreFloat3(&v1.tangent, t1);
-            XMStoreFloat3(&v2.tangent, t2);
-
-            v0.handedness = v1.handedness = v2.handedness = H;
-        }
-
-        for (auto& v : mesh.vertices) 
-        {
-            XMVECTOR t = XMLoadFloat3(&v.tangent);
-            t = XMVector3Normalize(t);
-            XMStoreFloat3(&v.tangent, t);
-        }
-    }
+    return sceneObjects;
+}
 
+std::vector<SceneObject> AssetLoader::LoadSceneObjects(const std::string& objPath)
+{
     std::vector<SceneObject> sceneObjects;
-    sceneObjects.reserve(N);
-
-    for (size_t i = 0; i < N; ++i) 
+    for (auto& src : ImportObj(objPath, m_taskPool))
     {
-        if (meshPerMat[i].indices.empty()) continue;
-
         SceneObject obj(
-            meshPerMat[i],
+            src.lodMeshes[0],
             { 0.0f,0.0f,0.0f },
             { 0.0f,0.0f,0.0f },
             { 1.0f,1.0f,1.0f }
         );
-
-        if (i < M) 
-        {
-            const auto& m = materials[i];
-
-            obj.material.ambient = { m.ambient[0],  m.ambient[1],  m.ambient[2] };
-            obj.material.diffuse = { m.diffuse[0],  m.diffuse[1],  m.diffuse[2] };
-            obj.material.specular = { m.specular[0], m.specular[1], m.specular[2] };
-            obj.material.roughness = m.roughness;
-            obj.material.metallic = m.metallic;
-            obj.material.ao = 1.0f;
-            obj.material.shininess = m.shininess;
-            obj.material.diffuseTexPath = m.diffuse_texname;
-            obj.material.normalTexPath = !m.bump_texname.empty() ? m.bump_texname
-                : !m.normal_texname.empty() ? m.normal_texname : "";
-            obj.material.displacementTexPath = m.displacement_texname;
-            obj.material.roughnessTexPath = m.roughness_texname;
-            obj.material.metallicTexPath = m.metallic_texname;
-            obj.material.aoTexPath = m.ambient_texname;
-
-            const bool hasMetalMap = !m.metallic_texname.empty();
-            const bool hasRoughMap = !m.roughness_texname.empty();
-
-            const bool hasAnyPBR = hasMetalMap || hasRoughMap || (m.metallic > 0.0f) || (m.roughness > 0.0f);
-
-            if (!hasAnyPBR)
-            {
-                obj.material.metallic = 0.0f;
-                float Ns = max(0.0f, m.shininess);
-                obj.material.roughness = 1.0f;
-            }
-        }
-        else 
-        {
-            obj.material.ambient = { 0.0f, 0.0f, 0.0f };
-            obj.material.diffuse = { 1.0f, 1.0f, 1.0f };
-            obj.material.specular = { 0.0f, 0.0f, 0.0f };
-            obj.material.shininess = 1.0f;
-            obj.material.diffuseTexPath.clear();
-            obj.material.normalTexPath.clear();
-            obj.material.displacementTexPath.clear();
-            obj.material.roughnessTexPath.clear();
-            obj.material.metallicTexPath.clear();
-            obj.material.aoTexPath.clear();
-        }
-
+        obj.material = std::move(src.material);
         sceneObjects.push_back(std::move(obj));
     }
-
     return sceneObjects;
 }
 
 std::vector<SceneObject> AssetLoader::LoadSceneObjectsLODs(const std::vector<std::string>& objPaths, const std::vector<float>& distances)
 {
-    if (objPaths.empty()) throw std::runtime_error("no LOD paths");
-
-    auto base = LoadSceneObjects(objPaths[0]);
-    for (auto& obj : base) {
-        obj.EnsureDefaultLOD();
-    }
+    return MakeSceneObjects(ImportScene(objPaths, m_lodSettings, m_taskPool), distances);
+}
 
-    for (size_t k = 1; k < objPaths.size(); ++k) {
-        auto lodK = LoadSceneObjects(objPaths[k]);
-        for (size_t i = 0; i < base.size(); ++i) {
-            if (i < lodK.size() && !lodK[i].mesh.indices.empty()) {
-                if (base[i].lodMeshes.size() <= k) base[i].lodMeshes.resize(k + 1);
-                base[i].lodMeshes[k] = std::move(lodK[i].mesh);
-            }
-        }
-    }
+std::vector<SceneObject> AssetLoader::LoadSceneObjectsCached(MeshCache& cache, const std::vector<std::string>& objPaths, const std::vector<float>& distances)
+{
+    const uint64_t hash = HashMeshSources(objPaths, distances, m_lodSettings);
+    const std::wstring path = cache.PathForSources(objPaths);
 
-    if (!objPaths.empty()) {
-        for (auto& obj : base) {
-            if (!distances.empty()) obj.lodDistances = distances;
-        }
+    std::vector<SceneObject> objects;
+    if (cache.Open(path, hash))
+    {
+        cache.CountHit();
+        cache.FillSceneObjects(objects, m_lodSettings);
+        return objects;
     }
 
-    return base;
+    cache.CountMiss();
+    std::vector<ImportedObject> imported = ImportScene(objPaths, m_lodSettings, m_taskPool);
+    if (WriteMeshCache(path, hash, imported, distances))
+        cache.Open(path, hash);
+    return MakeSceneObjects(std::move(imported), distances);
 }
 
 UINT AssetLoader::LoadDDSTextureCube(ID3D12Device* device, ResourceUploadBatch& uploadBatch, DX12Framework* framework, const wchar_t* filename)
@@ -597,6 +422,17 @@ UINT AssetLoader::LoadDDSTextureCube(ID3D12Device* device, ResourceUploadBatch&
         srvIndex, framework->GetSrvDescriptorSize());
     device->CreateShaderResourceView(texture.Get(), &srv, cpu);
 
-    textures.push_back(texture);
+    textures[srvIndex] = texture;
     return srvIndex;
-}
\ No newline at end of file
+}
+
+// GPU должен закончить работу с текстурой до вызова
+void AssetLoader::ReleaseTexture(DX12Framework* framework, UINT srvIndex)
+{
+    auto it = textures.find(srvIndex);
+    if (it == textures.end())
+        return;
+
+    textures.erase(it);
+    framework->FreeSrvDescriptor(srvIndex);
+}
@@ -5,7 +5,10 @@
 #include <ResourceUploadBatch.h>
 #include <wrl.h>
 #include "SceneObject.h"
+#include "MeshCache.h"
+#include "ObjImport.h"
 #include <vector>
+#include <unordered_map>
 
 using Microsoft::WRL::ComPtr;
 
@@ -16,13 +19,23 @@ public:
 	Material LoadMaterial(const std::string& mtlFile, const std::string& materialName);
 	UINT LoadTexture(ID3D12Device* device, ResourceUploadBatch& uploadBatch, DX12Framework* framework, const wchar_t* filename);
 	std::vector<SceneObject> LoadSceneObjects(const std::string& objPath);
+	// один путь - LOD генерируются упрощением (SetLodChainSettings) со своими дистанциями, иначе LOD k из objPaths[k]
 	std::vector<SceneObject> LoadSceneObjectsLODs(const std::vector<std::string>& objPaths, const std::vector<float>& distances = {});
+	// LoadSceneObjectsLODs через бинарный кэш; после вызова cache открыт, из него берутся мешлеты
+	std::vector<SceneObject> LoadSceneObjectsCached(MeshCache& cache, const std::vector<std::string>& objPaths, const std::vector<float>& distances = {});
 	UINT LoadDDSTextureCube(ID3D12Device* device, ResourceUploadBatch& uploadBatch, DX12Framework* framework, const wchar_t* filename);
+	void ReleaseTexture(DX12Framework* framework, UINT srvIndex);
+	// OBJ разбираются на этом пуле; nullptr - в вызывающем потоке
+	void SetTaskPool(TaskPool* pool) { m_taskPool = pool; }
+	void SetLodChainSettings(const LodChainSettings& settings) { m_lodSettings = settings; }
 
 private:
-	std::vector <ComPtr<ID3D12Resource>> textures;
+	std::unordered_map<UINT, ComPtr<ID3D12Resource>> textures;
+	TaskPool* m_taskPool = nullptr;
+	LodChainSettings m_lodSettings;
 
 private:
+	static std::vector<SceneObject> MakeSceneObjects(std::vector<ImportedObject>&& imported, const std::vector<float>& distances);
 	static inline void ThrowIfFailed(HRESULT hr) { if (FAILED(hr)) throw std::runtime_error("HRESULT failed"); }
 };
 
@@ -0,0 +1,331 @@
+#include "CpuParticleSim.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// AVX-путь только на x86; GCC и Clang собирают его без -mavx через target("avx"),
+// а включается он всё равно лишь после проверки CPUID
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_PARTICLE_AVX 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CPU_PARTICLE_TARGET_AVX
+#else
+#include <cpuid.h>
+#define CPU_PARTICLE_TARGET_AVX __attribute__((target("avx")))
+#endif
+#else
+#define CPU_PARTICLE_AVX 0
+#endif
+
+namespace
+{
+    // те же хэш и rand01, что в ParticlesCS.hlsl
+    uint32_t WangHash(uint32_t s)
+    {
+        s = (s ^ 61u) ^ (s >> 16);
+        s *= 9u;
+        s ^= s >> 4;
+        s *= 0x27d4eb2du;
+        s ^= s >> 15;
+        return s;
+    }
+
+    float Rand01(uint32_t s)
+    {
+        return (float)(WangHash(s) & 0x00FFFFFFu) / 16777216.0f;
+    }
+
+    const float EmitSize = 1.0f;
+    const float BenchmarkLifetime = 50.0f;
+}
+
+bool CpuParticleSim::IsAvxSupported()
+{
+#if CPU_PARTICLE_AVX
+    static const bool supported = []()
+    {
+#if defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 1);
+        const unsigned ecx = (unsigned)info[2];
+#else
+        unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return false;
+#endif
+        const bool osxsave = (ecx & (1u << 27)) != 0;
+        const bool avx = (ecx & (1u << 28)) != 0;
+        if (!osxsave || !avx)
+            return false;
+        // ОС сохраняет XMM и YMM при переключении потоков
+#if defined(_MSC_VER)
+        const unsigned long long xcr0 = _xgetbv(0);
+#else
+        unsigned lo = 0, hi = 0;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        const unsigned long long xcr0 = ((unsigned long long)hi << 32) | lo;
+#endif
+        return (xcr0 & 6) == 6;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void CpuParticleSim::Streams::Resize(size_t n)
+{
+    for (auto* v : { &px, &py, &pz, &vx, &vy, &vz, &age, &lifetime, &size })
+        v->resize(n);
+}
+
+void CpuParticleSim::Reset(uint32_t capacity)
+{
+    m_capacity = capacity;
+    m_alive = 0;
+    m_current = 0;
+    m_streams[0].Resize(capacity);
+    m_streams[1].Resize(capacity);
+}
+
+void CpuParticleSim::ForChunks(size_t count, const std::function<void(size_t, size_t)>& fn)
+{
+    if (m_pool)
+    {
+        m_pool->ParallelFor(count, ChunkSize, fn);
+        return;
+    }
+    for (size_t b = 0; b < count; b += ChunkSize)
+        fn(b, (std::min)(count, b + ChunkSize));
+}
+
+uint32_t CpuParticleSim::Emit(const ParticleUpdateCB& cb)
+{
+    const uint32_t n = (std::min)(cb.spawnCount, m_capacity - m_alive);
+    Streams& s = m_streams[m_current];
+    const uint32_t base = m_alive;
+
+    ForChunks(n, [&](size_t b, size_t e)
+    {
+        for (size_t i = b; i < e; ++i)
+        {
+            const uint32_t seed = 1337u + (uint32_t)i * 747796405u + cb.emitSeed;
+            float x = Rand01(seed) * 2.0f - 1.0f;
+            float y = Rand01(seed + 1) * 2.0f - 1.0f;
+            float z = Rand01(seed + 2) * 2.0f - 1.0f;
+            const float inv = 1.0f / std::sqrt(x * x + y * y + z * z);
+
+            const size_t j = base + i;
+            s.px[j] = cb.emitterPos[0];
+            s.py[j] = cb.emitterPos[1];
+            s.pz[j] = cb.emitterPos[2];
+            s.vx[j] = x * inv * cb.initialSpeed;
+            s.vy[j] = y * inv * cb.initialSpeed;
+            s.vz[j] = z * inv * cb.initialSpeed;
+            s.age[j] = 0.0f;
+            s.lifetime[j] = cb.lifetime;
+            s.size[j] = EmitSize;
+        }
+    });
+
+    m_alive += n;
+    return n;
+}
+
+uint32_t CpuParticleSim::UpdateChunkScalar(Streams& s, size_t begin, size_t end, const ParticleUpdateCB& cb) const
+{
+    const float dt = cb.dt;
+    const float dvx = cb.accel[0] * dt, dvy = cb.accel[1] * dt, dvz = cb.accel[2] * dt;
+
+    size_t w = begin;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const float vx = s.vx[i] + dvx, vy = s.vy[i] + dvy, vz = s.vz[i] + dvz;
+        const float age = s.age[i] + dt;
+        if (!(age < s.lifetime[i]))
+            continue;
+
+        s.px[w] = s.px[i] + vx * dt;
+        s.py[w] = s.py[i] + vy * dt;
+        s.pz[w] = s.pz[i] + vz * dt;
+        s.vx[w] = vx; s.vy[w] = vy; s.vz[w] = vz;
+        s.age[w] = age;
+        s.lifetime[w] = s.lifetime[i];
+        s.size[w] = s.size[i];
+        ++w;
+    }
+    return (uint32_t)(w - begin);
+}
+
+#if CPU_PARTICLE_AVX
+CPU_PARTICLE_TARGET_AVX
+uint32_t CpuParticleSim::UpdateChunkAvx(Streams& s, size_t begin, size_t end, const ParticleUpdateCB& cb) const
+{
+    const float dt = cb.dt;
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 dvx = _mm256_set1_ps(cb.accel[0] * dt);
+    const __m256 dvy = _mm256_set1_ps(cb.accel[1] * dt);
+    const __m256 dvz = _mm256_set1_ps(cb.accel[2] * dt);
+
+    float* const streams[9] = { s.px.data(), s.py.data(), s.pz.data(), s.vx.data(), s.vy.data(), s.vz.data(),
+        s.age.data(), s.lifetime.data(), s.size.data() };
+
+    size_t w = begin;
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 v[9];
+        v[3] = _mm256_add_ps(_mm256_loadu_ps(streams[3] + i), dvx);
+        v[4] = _mm256_add_ps(_mm256_loadu_ps(streams[4] + i), dvy);
+        v[5] = _mm256_add_ps(_mm256_loadu_ps(streams[5] + i), dvz);
+        v[0] = _mm256_add_ps(_mm256_loadu_ps(streams[0] + i), _mm256_mul_ps(v[3], vdt));
+        v[1] = _mm256_add_ps(_mm256_loadu_ps(streams[1] + i), _mm256_mul_ps(v[4], vdt));
+        v[2] = _mm256_add_ps(_mm256_loadu_ps(streams[2] + i), _mm256_mul_ps(v[5], vdt));
+        v[6] = _mm256_add_ps(_mm256_loadu_ps(streams[6] + i), vdt);
+        v[7] = _mm256_loadu_ps(streams[7] + i);
+        v[8] = _mm256_loadu_ps(streams[8] + i);
+
+        const int alive = _mm256_movemask_ps(_mm256_cmp_ps(v[6], v[7], _CMP_LT_OQ));
+
+        // блок уже в регистрах, так что запись в [w, w + 8) ничего непрочитанного не затрёт
+        if (alive == 0xFF)
+        {
+            for (int k = 0; k < 9; ++k)
+                _mm256_storeu_ps(streams[k] + w, v[k]);
+            w += 8;
+            continue;
+        }
+        if (alive == 0)
+            continue;
+
+        alignas(32) float tmp[9][8];
+        for (int k = 0; k < 9; ++k)
+            _mm256_store_ps(tmp[k], v[k]);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            if (!(alive & (1 << lane)))
+                continue;
+            for (int k = 0; k < 9; ++k)
+                streams[k][w] = tmp[k][lane];
+            ++w;
+        }
+    }
+
+    // хвост короче 8 - скалярно, сдвигая к w
+    if (i < end)
+    {
+        const uint32_t tail = UpdateChunkScalar(s, i, end, cb);
+        if (w != i)
+            for (int k = 0; k < 9; ++k)
+                memmove(streams[k] + w, streams[k] + i, tail * sizeof(float));
+        w += tail;
+    }
+    return (uint32_t)(w - begin);
+}
+#else
+uint32_t CpuParticleSim::UpdateChunkAvx(Streams& s, size_t begin, size_t end, const ParticleUpdateCB& cb) const
+{
+    return UpdateChunkScalar(s, begin, end, cb);
+}
+#endif
+
+void CpuParticleSim::Update(const ParticleUpdateCB& cb)
+{
+    if (m_alive == 0)
+        return;
+
+    Streams& src = m_streams[m_current];
+    const bool simd = IsSimdActive();
+    const size_t chunks = (m_alive + ChunkSize - 1) / ChunkSize;
+    m_chunkAlive.assign(chunks, 0);
+
+    ForChunks(m_alive, [&](size_t b, size_t e)
+    {
+        m_chunkAlive[b / ChunkSize] = simd ? UpdateChunkAvx(src, b, e, cb) : UpdateChunkScalar(src, b, e, cb);
+    });
+
+    std::vector<uint32_t> offsets(chunks);
+    uint32_t total = 0;
+    for (size_t k = 0; k < chunks; ++k)
+    {
+        offsets[k] = total;
+        total += m_chunkAlive[k];
+    }
+
+    // никто не умер - выжившие уже на месте
+    if (total == m_alive)
+        return;
+
+    // куски сжаты каждый у своего начала; собираем их подряд во второй набор массивов
+    Streams& dst = m_streams[m_current ^ 1];
+    ForChunks(m_alive, [&](size_t b, size_t)
+    {
+        const size_t k = b / ChunkSize;
+        const size_t n = m_chunkAlive[k];
+        if (n == 0)
+            return;
+        const size_t to = offsets[k];
+        std::vector<float>* from[9] = { &src.px, &src.py, &src.pz, &src.vx, &src.vy, &src.vz, &src.age, &src.lifetime, &src.size };
+        std::vector<float>* into[9] = { &dst.px, &dst.py, &dst.pz, &dst.vx, &dst.vy, &dst.vz, &dst.age, &dst.lifetime, &dst.size };
+        for (int a = 0; a < 9; ++a)
+            memcpy(into[a]->data() + to, from[a]->data() + b, n * sizeof(float));
+    });
+
+    m_current ^= 1;
+    m_alive = total;
+}
+
+ParticleCPU CpuParticleSim::GetParticle(uint32_t i) const
+{
+    const Streams& s = m_streams[m_current];
+    ParticleCPU p;
+    p.pos[0] = s.px[i]; p.pos[1] = s.py[i]; p.pos[2] = s.pz[i];
+    p.vel[0] = s.vx[i]; p.vel[1] = s.vy[i]; p.vel[2] = s.vz[i];
+    p.age = s.age[i];
+    p.lifetime = s.lifetime[i];
+    p.size = s.size[i];
+    return p;
+}
+
+void CpuParticleSim::ExportAoS(std::vector<ParticleCPU>& out) const
+{
+    out.resize(m_alive);
+    for (uint32_t i = 0; i < m_alive; ++i)
+        out[i] = GetParticle(i);
+}
+
+CpuParticleBenchmarkResult RunCpuParticleBenchmark(uint32_t particles, uint32_t frames, TaskPool* pool, bool simd)
+{
+    CpuParticleSim sim(pool);
+    sim.SetSimdEnabled(simd);
+    sim.Reset(particles);
+
+    ParticleUpdateCB cb{};
+    cb.spawnCount = particles;
+    cb.emitterPos[1] = 100.0f;
+    cb.initialSpeed = 8.0f;
+    cb.lifetime = BenchmarkLifetime;
+    sim.Emit(cb);
+
+    // dt такой, чтобы за все кадры никто не успел умереть
+    cb.spawnCount = 0;
+    cb.accel[1] = -10.0f;
+    cb.dt = (std::min)(1.0f / 60.0f, 0.5f * BenchmarkLifetime / (float)(std::max)(frames, 1u));
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < frames; ++f)
+        sim.Update(cb);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    CpuParticleBenchmarkResult r;
+    r.particles = particles;
+    r.frames = frames;
+    r.threads = pool ? pool->GetThreadCount() : 1;
+    r.simd = sim.IsSimdActive();
+    r.msPerFrame = frames ? seconds * 1000.0 / frames : 0.0;
+    r.particlesPerSecond = seconds > 0.0 ? (double)particles * frames / seconds : 0.0;
+    return r;
+}
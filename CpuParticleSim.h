@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ParticleTypes.h"
+#include "TaskPool.h"
+
+// CPU-вариант CS_Update/CS_Emit: SoA-хранилище, интегрирование по 8 частиц AVX
+// (скалярный путь, если AVX нет) и обновление кусками на TaskPool.
+// Мёртвые частицы выкидываются сразу, порядок живых сохраняется, так что результат
+// не зависит от числа потоков. Столкновений с глубиной нет - буфера глубины на CPU нет.
+class CpuParticleSim
+{
+public:
+    static const size_t ChunkSize = 16 * 1024;
+
+    // pool == nullptr - всё в вызывающем потоке
+    explicit CpuParticleSim(TaskPool* pool = nullptr) : m_pool(pool) {}
+
+    void Reset(uint32_t capacity);
+
+    // cb.spawnCount новых частиц в cb.emitterPos, как CS_Emit; возвращает сколько влезло
+    uint32_t Emit(const ParticleUpdateCB& cb);
+    // шаг CS_Update на cb.dt и cb.accel
+    void Update(const ParticleUpdateCB& cb);
+
+    uint32_t GetAliveCount() const { return m_alive; }
+    uint32_t GetCapacity() const { return m_capacity; }
+    ParticleCPU GetParticle(uint32_t i) const;
+    void ExportAoS(std::vector<ParticleCPU>& out) const;
+
+    void SetSimdEnabled(bool enabled) { m_simd = enabled; }
+    bool IsSimdActive() const { return m_simd && IsAvxSupported(); }
+    static bool IsAvxSupported();
+
+private:
+    struct Streams
+    {
+        std::vector<float> px, py, pz;
+        std::vector<float> vx, vy, vz;
+        std::vector<float> age, lifetime, size;
+
+        void Resize(size_t n);
+    };
+
+    // обновляет [begin, end) и сдвигает выживших к begin; возвращает их число
+    uint32_t UpdateChunkScalar(Streams& s, size_t begin, size_t end, const ParticleUpdateCB& cb) const;
+    uint32_t UpdateChunkAvx(Streams& s, size_t begin, size_t end, const ParticleUpdateCB& cb) const;
+    void ForChunks(size_t count, const std::function<void(size_t, size_t)>& fn);
+
+    TaskPool* m_pool = nullptr;
+    bool m_simd = true;
+
+    Streams m_streams[2];
+    int m_current = 0;
+    uint32_t m_alive = 0;
+    uint32_t m_capacity = 0;
+    std::vector<uint32_t> m_chunkAlive;
+};
+
+struct CpuParticleBenchmarkResult
+{
+    uint32_t particles = 0;
+    uint32_t frames = 0;
+    unsigned threads = 0;
+    bool simd = false;
+    double msPerFrame = 0.0;
+    double particlesPerSecond = 0.0;
+};
+
+// particles живых частиц (lifetime с запасом на все кадры), frames шагов Update
+CpuParticleBenchmarkResult RunCpuParticleBenchmark(uint32_t particles, uint32_t frames, TaskPool* pool, bool simd);
@@ -123,6 +123,12 @@ void DX12Framework::CreateDevice()
         D3D_FEATURE_LEVEL_11_0,
         IID_PPV_ARGS(&m_device)));
 
+    bestAdapter.As(&m_adapter);
+    m_heapAllocator.Init(m_device.Get(), m_adapter.Get());
+    m_stagingPool.Init(&m_heapAllocator);
+    m_uploadRing.Init(&m_heapAllocator, UploadRingSize);
+    m_readback.Init(m_device.Get(), &m_heapAllocator);
+
     ComPtr<ID3D12InfoQueue> infoQueue;
     if (SUCCEEDED(m_device.As(&infoQueue))) 
     {
@@ -236,6 +242,7 @@ void DX12Framework::CreateDescriptorHeaps()
     srvDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     srvDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     ThrowIfFailed(m_device->CreateDescriptorHeap(&srvDesc, IID_PPV_ARGS(&m_srvHeap)));
+    m_srvAllocator.Init(srvDesc.NumDescriptors, TransientSrvPerFrame, FrameCount);
     m_srvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
     D3D12_DESCRIPTOR_HEAP_DESC samplerDesc = {};
@@ -295,7 +302,7 @@ void DX12Framework::CreateDepthResources()
 
     CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_DEFAULT);
 
-    ThrowIfFailed(m_device->CreateCommittedResource(
+    ThrowIfFailed(CreateResource(
         &heap, D3D12_HEAP_FLAG_NONE,
         &depthDesc,
         D3D12_RESOURCE_STATE_DEPTH_WRITE,
@@ -324,6 +331,9 @@ void DX12Framework::WaitForGpu()
             fence, m_fenceEvent));
         WaitForSingleObject(m_fenceEvent, INFINITE);
     }
+    m_stagingPool.OnFenceSignaled(fence, m_fence->GetCompletedValue());
+    m_uploadRing.OnFenceSignaled(fence, m_fence->GetCompletedValue());
+    m_readback.OnFenceSignaled(fence, m_fence->GetCompletedValue());
 }
 
 void DX12Framework::ClearColorAndDepthBuffer(float clear[4])
@@ -378,6 +388,8 @@ void DX12Framework::Clear(const FLOAT clearColor[4])
 
 void DX12Framework::BeginFrame()
 {
+    m_srvAllocator.BeginFrame(m_backBufferIndex);
+
     auto backBuffer = GetCurrentBackBufferResource();
     CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
         backBuffer,
@@ -412,32 +424,41 @@ void DX12Framework::EndFrame()
         ThrowIfFailed(m_fence->SetEventOnCompletion(fenceToWaitFor, m_fenceEvent));
         WaitForSingleObject(m_fenceEvent, INFINITE);
     }
+    m_stagingPool.OnFenceSignaled(fenceToWaitFor, m_fence->GetCompletedValue());
+    m_uploadRing.OnFenceSignaled(fenceToWaitFor, m_fence->GetCompletedValue());
+    m_readback.OnFenceSignaled(fenceToWaitFor, m_fence->GetCompletedValue());
 }
 
 UINT DX12Framework::AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count) {
     if (type != D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
          throw std::runtime_error("AllocateDescriptors: unsupported heap type");
-    UINT heapSize = m_srvHeap->GetDesc().NumDescriptors;
-    if (m_nextSrvDescriptor + count > heapSize)
-         throw std::runtime_error("AllocateDescriptors: not enough descriptors");
-    UINT start = m_nextSrvDescriptor;
-    m_nextSrvDescriptor += count;
-    return start; 
+    return m_srvAllocator.Allocate(count);
+}
+
+void DX12Framework::FreeDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT index, UINT count) {
+    if (type != D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+         throw std::runtime_error("FreeDescriptors: unsupported heap type");
+    m_srvAllocator.Free(index, count);
+}
+
+StagingBuffer DX12Framework::AllocateUpload(UINT64 size, UINT64 alignment)
+{
+    StagingBuffer buffer = m_uploadRing.Allocate(size, alignment);
+    if (!buffer.resource)
+        buffer = m_stagingPool.Acquire(size);
+    return buffer;
 }
 
 void DX12Framework::CreateDefaultBuffer(
     ID3D12GraphicsCommandList* cmdList,
-    void* initData,
+    const void* initData,
     UINT64 byteSize,
-    ComPtr<ID3D12Resource>& defaultBuffer,
-    ComPtr<ID3D12Resource>& uploadBuffer)
+    ComPtr<ID3D12Resource>& defaultBuffer)
 {
-    auto device = GetDevice();
-
     CD3DX12_HEAP_PROPERTIES defaultHeapProps(D3D12_HEAP_TYPE_DEFAULT);
     CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 
-    ThrowIfFailed(device->CreateCommittedResource(
+    ThrowIfFailed(CreateResource(
         &defaultHeapProps,
         D3D12_HEAP_FLAG_NONE,
         &bufferDesc,
@@ -445,26 +466,9 @@ void DX12Framework::CreateDefaultBuffer(
         nullptr,
         IID_PPV_ARGS(&defaultBuffer)));
 
-    CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
-    ThrowIfFailed(device->CreateCommittedResource(
-        &uploadHeapProps,
-        D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&uploadBuffer)));
-
-    D3D12_SUBRESOURCE_DATA subResourceData = {};
-    subResourceData.pData = initData;
-    subResourceData.RowPitch = byteSize;
-    subResourceData.SlicePitch = subResourceData.RowPitch;
-
-    UpdateSubresources<1>(
-        cmdList,
-        defaultBuffer.Get(),
-        uploadBuffer.Get(),
-        0, 0, 1,
-        &subResourceData);
+    StagingBuffer staging = AcquireStaging(byteSize);
+    memcpy(staging.cpu, initData, (size_t)byteSize);
+    cmdList->CopyBufferRegion(defaultBuffer.Get(), 0, staging.resource, 0, byteSize);
 
     CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
         defaultBuffer.Get(),
@@ -4,6 +4,11 @@
 #include "d3dx12.h"
 #include <dxgi1_4.h>
 #include <stdexcept>
+#include "DescriptorAllocator.h"
+#include "GpuHeapAllocator.h"
+#include "StagingPool.h"
+#include "UploadRing.h"
+#include "ReadbackManager.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -15,7 +20,22 @@ public:
     void Init();
     void Clear(const FLOAT clearColor[4]);
     void Present();
-    void CreateDefaultBuffer(ID3D12GraphicsCommandList* cmdList, void* initData, UINT64 byteSize, ComPtr<ID3D12Resource>& defaultBuffer, ComPtr<ID3D12Resource>& uploadBuffer);
+    // то же, что CreateCommittedResource, но ресурс размещается в общей куче
+    HRESULT CreateResource(const D3D12_HEAP_PROPERTIES* heapProps, D3D12_HEAP_FLAGS heapFlags,
+        const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES initialState,
+        const D3D12_CLEAR_VALUE* clearValue, REFIID riid, void** resource)
+    {
+        return m_heapAllocator.CreateResource(heapProps, heapFlags, desc, initialState, clearValue, riid, resource);
+    }
+    GpuHeapAllocator& GetHeapAllocator() { return m_heapAllocator; }
+    // upload-буфер занят до выполнения команд, записанных до следующего Signal
+    StagingBuffer AcquireStaging(UINT64 size) { return m_stagingPool.Acquire(size); }
+    StagingPool& GetStagingPool() { return m_stagingPool; }
+    // мелкие покадровые загрузки: из кольца, а если оно заполнено - из пула
+    StagingBuffer AllocateUpload(UINT64 size, UINT64 alignment);
+    UploadRing& GetUploadRing() { return m_uploadRing; }
+    ReadbackManager& GetReadback() { return m_readback; }
+    void CreateDefaultBuffer(ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, ComPtr<ID3D12Resource>& defaultBuffer);
     D3D12_CPU_DESCRIPTOR_HANDLE GetDSVHandle() const { return m_dsvHandle; }
     ID3D12Device* GetDevice() const { return m_device.Get(); }
     ID3D12CommandQueue* GetCommandQueue() const { return m_commandQueue.Get(); }
@@ -47,13 +67,13 @@ public:
     void ClearColorAndDepthBuffer(float clear[4]);
     void SetViewportAndScissors();
     void SetRootSignatureAndPSO(ID3D12RootSignature* root, ID3D12PipelineState* state);
-    UINT AllocateSrvDescriptor() 
-    {
-        if (m_nextSrvDescriptor >= m_srvHeap->GetDesc().NumDescriptors)
-            throw std::runtime_error("SRV heap is full");
-        return m_nextSrvDescriptor++;
-    }
+    UINT AllocateSrvDescriptor() { return m_srvAllocator.Allocate(1); }
+    void FreeSrvDescriptor(UINT index) { m_srvAllocator.Free(index, 1); }
     UINT AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT count);
+    void FreeDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE type, UINT index, UINT count);
+    // живут до следующего BeginFrame с тем же back buffer
+    UINT AllocateTransientDescriptors(UINT count) { return m_srvAllocator.AllocateTransient(count); }
+    const DescriptorAllocator& GetSrvAllocator() const { return m_srvAllocator; }
     UINT GetWhiteTextureSrvIndex() const { return m_whiteSrvIndex; }
     UINT GetFrameCount() { return FrameCount; }
     UINT& GetBackBufferIndex() { return m_backBufferIndex; }
@@ -73,9 +93,16 @@ private:
     float m_height;
 
     static const UINT FrameCount = 2;
-    UINT m_nextSrvDescriptor = 0;
+    static const UINT TransientSrvPerFrame = 256;
+    DescriptorAllocator m_srvAllocator;
     ComPtr<IDXGISwapChain3> m_swapChain;
+    ComPtr<IDXGIAdapter3> m_adapter;
     ComPtr<ID3D12Device> m_device;
+    GpuHeapAllocator m_heapAllocator;
+    StagingPool m_stagingPool;
+    UploadRing m_uploadRing;
+    ReadbackManager m_readback;
+    static const UINT64 UploadRingSize = 8ull * 1024 * 1024;
     ComPtr<ID3D12CommandQueue> m_commandQueue;
     ComPtr<ID3D12CommandAllocator> m_commandAllocator;
     ComPtr<ID3D12GraphicsCommandList> m_commandList;
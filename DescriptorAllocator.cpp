@@ -0,0 +1,176 @@
+#include "DescriptorAllocator.h"
+#include <stdexcept>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    uint32_t LowestBit(uint64_t mask)
+    {
+#ifdef _MSC_VER
+        unsigned long i;
+        _BitScanForward64(&i, mask);
+        return (uint32_t)i;
+#else
+        return (uint32_t)__builtin_ctzll(mask);
+#endif
+    }
+
+    uint32_t HighestBit(uint64_t mask)
+    {
+#ifdef _MSC_VER
+        unsigned long i;
+        _BitScanReverse64(&i, mask);
+        return (uint32_t)i;
+#else
+        return 63u - (uint32_t)__builtin_clzll(mask);
+#endif
+    }
+}
+
+DescriptorAllocator::DescriptorAllocator(uint32_t totalCount, uint32_t transientPerFrame, uint32_t frameCount)
+{
+    Init(totalCount, transientPerFrame, frameCount);
+}
+
+void DescriptorAllocator::Init(uint32_t totalCount, uint32_t transientPerFrame, uint32_t frameCount)
+{
+    if (frameCount == 0 || (uint64_t)transientPerFrame * frameCount >= totalCount)
+        throw std::runtime_error("DescriptorAllocator: transient ring does not fit into heap");
+
+    m_persistentCount = totalCount - transientPerFrame * frameCount;
+    m_persistentUsed = 0;
+    m_highWater = 0;
+    m_freeHeads.assign(SizeClass(m_persistentCount) + 1, (uint32_t)Invalid);
+    m_freeMask = 0;
+    m_next.assign(m_persistentCount, (uint32_t)Invalid);
+    m_prev.assign(m_persistentCount, (uint32_t)Invalid);
+    m_state.assign(m_persistentCount, StateNone);
+
+    // Область - хвост блока степени двойки: адрес в блоке = индекс + m_base. Нарезка на выровненные блоки
+    // растёт снизу вверх, самые мелкие - у нуля, туда же первыми попадают новые выделения
+    const uint32_t top = (uint32_t)m_freeHeads.size() - 1;
+    m_base = (1u << top) - m_persistentCount;
+    for (uint32_t a = m_base; a - m_base < m_persistentCount;)
+    {
+        const uint32_t cls = a ? LowestBit(a) : top;
+        PushFree(a - m_base, cls);
+        a += 1u << cls;
+    }
+
+    m_transientPerFrame = transientPerFrame;
+    m_frameCount = frameCount;
+    m_frameIndex = 0;
+    m_transientOffset = 0;
+}
+
+// ceil(log2(count)), блок класса c занимает 1 << c дескрипторов
+uint32_t DescriptorAllocator::SizeClass(uint32_t count)
+{
+    uint32_t c = 0;
+    while ((1u << c) < count) ++c;
+    return c;
+}
+
+void DescriptorAllocator::PushFree(uint32_t index, uint32_t cls)
+{
+    m_state[index] = (uint8_t)cls;
+    const uint32_t head = m_freeHeads[cls];
+    m_next[index] = head;
+    m_prev[index] = Invalid;
+    if (head != Invalid)
+        m_prev[head] = index;
+    m_freeHeads[cls] = index;
+    m_freeMask |= 1ull << cls;
+}
+
+void DescriptorAllocator::RemoveFree(uint32_t index, uint32_t cls)
+{
+    const uint32_t next = m_next[index];
+    const uint32_t prev = m_prev[index];
+    if (prev != Invalid)
+        m_next[prev] = next;
+    else
+        m_freeHeads[cls] = next;
+    if (next != Invalid)
+        m_prev[next] = prev;
+    if (m_freeHeads[cls] == Invalid)
+        m_freeMask &= ~(1ull << cls);
+    m_state[index] = StateNone;
+}
+
+uint32_t DescriptorAllocator::Allocate(uint32_t count)
+{
+    if (count == 0)
+        throw std::runtime_error("DescriptorAllocator: zero-sized allocation");
+
+    const uint32_t cls = SizeClass(count);
+    const uint64_t fits = cls < 64 ? m_freeMask & (~0ull << cls) : 0;
+    if (!fits)
+        throw std::runtime_error("SRV heap is full");
+
+    uint32_t from = LowestBit(fits);
+    const uint32_t index = m_freeHeads[from];
+    RemoveFree(index, from);
+
+    // верхние половины уходят в списки меньших классов
+    while (from > cls)
+    {
+        --from;
+        PushFree(index + (1u << from), from);
+    }
+
+    m_state[index] = (uint8_t)(StateAllocated | cls);
+    m_persistentUsed += 1u << cls;
+    if (index + (1u << cls) > m_highWater)
+        m_highWater = index + (1u << cls);
+    return index;
+}
+
+void DescriptorAllocator::Free(uint32_t index, uint32_t count)
+{
+    if (index == Invalid || count == 0)
+        return;
+
+    uint32_t cls = SizeClass(count);
+    if (index >= m_persistentCount || m_state[index] != (uint8_t)(StateAllocated | cls))
+        throw std::runtime_error("DescriptorAllocator: freeing descriptors that are not allocated (double free?)");
+
+    m_state[index] = StateNone;
+    m_persistentUsed -= 1u << cls;
+
+    // сливаемся с соседом, пока он свободен целиком того же класса
+    while (cls + 1 < m_freeHeads.size())
+    {
+        const uint32_t a = (index + m_base) ^ (1u << cls);
+        if (a < m_base || m_state[a - m_base] != (uint8_t)cls)
+            break;
+        const uint32_t buddy = a - m_base;
+        RemoveFree(buddy, cls);
+        index = index < buddy ? index : buddy;
+        ++cls;
+    }
+    PushFree(index, cls);
+}
+
+uint32_t DescriptorAllocator::GetLargestFreeBlock() const
+{
+    return m_freeMask ? 1u << HighestBit(m_freeMask) : 0;
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frameIndex)
+{
+    m_frameIndex = frameIndex % m_frameCount;
+    m_transientOffset = 0;
+}
+
+uint32_t DescriptorAllocator::AllocateTransient(uint32_t count)
+{
+    if (m_transientOffset + count > m_transientPerFrame)
+        throw std::runtime_error("DescriptorAllocator: transient ring is full");
+
+    uint32_t index = m_persistentCount + m_frameIndex * m_transientPerFrame + m_transientOffset;
+    m_transientOffset += count;
+    return index;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Распределитель индексов в shader-visible куче дескрипторов.
+// [0, persistentCount) - постоянная область, buddy-блоки степеней двойки: большой свободный блок
+// делится пополам до нужного класса, при освобождении блок сливается со свободным соседом.
+// Свободные блоки - интрузивные списки по классам и маска непустых классов, Allocate/Free - O(1).
+// Берётся блок наименьшего подходящего класса, от него отрезается нижняя часть. Начальные блоки
+// растут от нуля вверх, так что занятое держится внизу кучи - шейдеры индексируют текстуры
+// массивом ограниченного размера (MAX_SRV).
+// [persistentCount, total) - кольцо временных дескрипторов, по сегменту на кадр.
+// Сам с устройством не работает, только считает индексы.
+class DescriptorAllocator
+{
+public:
+    static const uint32_t Invalid = UINT32_MAX;
+
+    DescriptorAllocator() = default;
+    DescriptorAllocator(uint32_t totalCount, uint32_t transientPerFrame, uint32_t frameCount);
+
+    void Init(uint32_t totalCount, uint32_t transientPerFrame, uint32_t frameCount);
+
+    uint32_t Allocate(uint32_t count = 1);
+    // count - тот же, что при Allocate. Повторное или чужое освобождение - исключение
+    void Free(uint32_t index, uint32_t count = 1);
+
+    void BeginFrame(uint32_t frameIndex);
+    uint32_t AllocateTransient(uint32_t count = 1);
+
+    uint32_t GetPersistentCapacity() const { return m_persistentCount; }
+    uint32_t GetPersistentUsed() const { return m_persistentUsed; }
+    uint32_t GetHighWaterMark() const { return m_highWater; }
+    uint32_t GetLargestFreeBlock() const;
+    uint32_t GetTransientUsed() const { return m_transientOffset; }
+    uint32_t GetTransientCapacity() const { return m_transientPerFrame; }
+
+private:
+    static uint32_t SizeClass(uint32_t count);
+
+    void PushFree(uint32_t index, uint32_t cls);
+    void RemoveFree(uint32_t index, uint32_t cls);
+
+    // состояние блока по индексу его начала
+    static constexpr uint8_t StateNone = 0xFF;
+    static constexpr uint8_t StateAllocated = 0x80;   // | класс; иначе класс свободного блока
+
+    uint32_t m_persistentCount = 0;
+    uint32_t m_base = 0;                 // смещение области в объемлющем блоке степени двойки
+    uint32_t m_persistentUsed = 0;
+    uint32_t m_highWater = 0;
+    std::vector<uint32_t> m_freeHeads;   // по классам, Invalid - пусто
+    uint64_t m_freeMask = 0;             // бит c - список класса c не пуст
+    std::vector<uint32_t> m_next;        // связи свободных блоков по индексу начала
+    std::vector<uint32_t> m_prev;
+    std::vector<uint8_t> m_state;
+
+    uint32_t m_transientPerFrame = 0;
+    uint32_t m_frameCount = 0;
+    uint32_t m_frameIndex = 0;
+    uint32_t m_transientOffset = 0;
+};
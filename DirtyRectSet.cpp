@@ -0,0 +1,98 @@
+#include "DirtyRectSet.h"
+#include <algorithm>
+
+DirtyRect DirtyRectSet::Union(const DirtyRect& a, const DirtyRect& b)
+{
+    return { std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1) };
+}
+
+bool DirtyRectSet::Touches(const DirtyRect& a, const DirtyRect& b)
+{
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+
+bool DirtyRectSet::ShouldMerge(const DirtyRect& a, const DirtyRect& b) const
+{
+    // вложенные сливаются всегда; остальные - если лишняя площадь невелика
+    const int64_t u = Union(a, b).Area();
+    if (u == a.Area() || u == b.Area())
+        return true;
+    return Touches(a, b) && (double)u <= (double)(a.Area() + b.Area()) * m_mergeSlack;
+}
+
+void DirtyRectSet::Add(const DirtyRect& rect)
+{
+    if (rect.Empty())
+        return;
+
+    // новый прямоугольник может поглотить несколько старых, а результат - ещё
+    DirtyRect r = rect;
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        for (size_t i = 0; i < m_rects.size(); ++i)
+        {
+            if (ShouldMerge(r, m_rects[i]))
+            {
+                r = Union(r, m_rects[i]);
+                m_rects[i] = m_rects.back();
+                m_rects.pop_back();
+                merged = true;
+                break;
+            }
+        }
+    }
+    m_rects.push_back(r);
+
+    while (m_rects.size() > m_maxRects)
+        MergeCheapestPair();
+}
+
+void DirtyRectSet::MergeCheapestPair()
+{
+    size_t bestI = 0, bestJ = 1;
+    int64_t bestWaste = INT64_MAX;
+    for (size_t i = 0; i < m_rects.size(); ++i)
+    {
+        for (size_t j = i + 1; j < m_rects.size(); ++j)
+        {
+            const int64_t waste = Union(m_rects[i], m_rects[j]).Area() - m_rects[i].Area() - m_rects[j].Area();
+            if (waste < bestWaste)
+            {
+                bestWaste = waste;
+                bestI = i;
+                bestJ = j;
+            }
+        }
+    }
+
+    const DirtyRect u = Union(m_rects[bestI], m_rects[bestJ]);
+    m_rects[bestJ] = m_rects.back();
+    m_rects.pop_back();
+    m_rects[bestI] = u;
+
+    // объединение могло накрыть другие прямоугольники
+    for (size_t k = 0; k < m_rects.size();)
+    {
+        if (k != bestI && Union(u, m_rects[k]).Area() == u.Area())
+        {
+            m_rects[k] = m_rects.back();
+            m_rects.pop_back();
+            if (bestI == m_rects.size())
+                bestI = k;
+        }
+        else
+        {
+            ++k;
+        }
+    }
+}
+
+int64_t DirtyRectSet::GetArea() const
+{
+    int64_t area = 0;
+    for (const DirtyRect& r : m_rects)
+        area += r.Area();
+    return area;
+}
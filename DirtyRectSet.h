@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Полуоткрытый прямоугольник текселей [x0, x1) x [y0, y1)
+struct DirtyRect
+{
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    int Width() const { return x1 - x0; }
+    int Height() const { return y1 - y0; }
+    int64_t Area() const { return (int64_t)Width() * Height(); }
+    bool Empty() const { return x1 <= x0 || y1 <= y0; }
+};
+
+// Набор изменённых за кадр областей текстуры.
+// Пересекающиеся и соседние прямоугольники сливаются, если общий bounding box
+// почти не больше их суммы; число прямоугольников ограничено maxRects.
+class DirtyRectSet
+{
+public:
+    explicit DirtyRectSet(size_t maxRects = 8, float mergeSlack = 1.25f)
+        : m_maxRects(maxRects), m_mergeSlack(mergeSlack) {}
+
+    void Add(const DirtyRect& rect);
+    void Clear() { m_rects.clear(); }
+
+    const std::vector<DirtyRect>& GetRects() const { return m_rects; }
+    bool Empty() const { return m_rects.empty(); }
+    int64_t GetArea() const;
+
+    static DirtyRect Union(const DirtyRect& a, const DirtyRect& b);
+    static bool Touches(const DirtyRect& a, const DirtyRect& b);
+
+private:
+    bool ShouldMerge(const DirtyRect& a, const DirtyRect& b) const;
+    void MergeCheapestPair();
+
+    size_t m_maxRects;
+    float m_mergeSlack;
+    std::vector<DirtyRect> m_rects;
+};
@@ -5,7 +5,7 @@ struct FrustumPlane {
     DirectX::XMVECTOR normal;
 };
 
-void ExtractFrustumPlanes(DirectX::XMFLOAT4 planes[6], const DirectX::XMMATRIX& viewProj)
+inline void ExtractFrustumPlanes(DirectX::XMFLOAT4 planes[6], const DirectX::XMMATRIX& viewProj)
 {
     using namespace DirectX;
 
@@ -48,21 +48,21 @@ void GBuffer::CreateResources()
     clearRT.Color[0] = 0.2f; clearRT.Color[1] = 0.2f;
     clearRT.Color[2] = 1.0f; clearRT.Color[3] = 1.0f;
 
-    ThrowIfFailed(m_framework->GetDevice()->CreateCommittedResource(
+    ThrowIfFailed(m_framework->CreateResource(
         &heapDefault, D3D12_HEAP_FLAG_NONE, &texDesc,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
         &clearRT, IID_PPV_ARGS(&m_rtAlbedo)));
 
     texDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
     clearRT.Format = texDesc.Format;
-    ThrowIfFailed(m_framework->GetDevice()->CreateCommittedResource(
+    ThrowIfFailed(m_framework->CreateResource(
         &heapDefault, D3D12_HEAP_FLAG_NONE, &texDesc,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
         &clearRT, IID_PPV_ARGS(&m_rtNormal)));
 
     texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
     clearRT.Format = texDesc.Format;
-    ThrowIfFailed(m_framework->GetDevice()->CreateCommittedResource(
+    ThrowIfFailed(m_framework->CreateResource(
         &heapDefault, D3D12_HEAP_FLAG_NONE, &texDesc,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
         &clearRT, IID_PPV_ARGS(&m_rtMaterial)));
@@ -76,7 +76,7 @@ void GBuffer::CreateResources()
     D3D12_CLEAR_VALUE clearDS = {};
     clearDS.Format = DXGI_FORMAT_D32_FLOAT;
     clearDS.DepthStencil.Depth = 1.0f;
-    ThrowIfFailed(m_framework->GetDevice()->CreateCommittedResource(
+    ThrowIfFailed(m_framework->CreateResource(
         &heapDefault, D3D12_HEAP_FLAG_NONE, &depthDesc,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
         &clearDS, IID_PPV_ARGS(&m_depth)));
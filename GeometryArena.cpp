@@ -0,0 +1,321 @@
+#include "GeometryArena.h"
+#include "VertexStreams.h"
+#include "d3dx12.h"
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+static inline void ThrowIfFailed(HRESULT hr)
+{
+    if (FAILED(hr))
+        throw std::runtime_error("HRESULT failed");
+}
+
+void GeometryArena::Init(ID3D12Device* device, StagingPool* stagingPool, UINT vertexCapacity, UINT indexCapacity, UINT dataCapacity,
+    bool packedVertices, UINT index16Capacity)
+{
+    m_device = device;
+    m_stagingPool = stagingPool;
+    m_packed = packedVertices;
+    if (!m_packed)
+        index16Capacity = 0;
+
+    m_streams[Vertices] = { nullptr, m_packed ? (UINT)sizeof(PackedVertex) : (UINT)sizeof(Vertex), vertexCapacity };
+    m_streams[Positions] = { nullptr, PositionStreamStride, vertexCapacity };
+    m_streams[Indices] = { nullptr, sizeof(UINT32), indexCapacity };
+    // размер буфера кратен 4 байтам
+    m_streams[Indices16] = { nullptr, sizeof(uint16_t), (index16Capacity + 1) & ~1u };
+    m_streams[Data] = { nullptr, sizeof(uint32_t), dataCapacity };
+
+    for (Stream& s : m_streams)
+        s.buffer = CreateStreamBuffer(s);
+
+    m_vertexAlloc.Init(vertexCapacity);
+    m_indexAlloc.Init(indexCapacity);
+    m_index16Alloc.Init(index16Capacity);
+    m_dataAlloc.Init(dataCapacity);
+
+    m_ranges.clear();
+    m_isMesh.clear();
+    m_live.clear();
+    m_freeHandles.clear();
+    m_staging.clear();
+    m_pending.clear();
+    m_readable = false;
+}
+
+ComPtr<ID3D12Resource> GeometryArena::CreateStreamBuffer(const Stream& s) const
+{
+    ComPtr<ID3D12Resource> buffer;
+    if (s.capacity == 0)
+        return buffer;
+
+    CD3DX12_HEAP_PROPERTIES heapDefault(D3D12_HEAP_TYPE_DEFAULT);
+    auto desc = CD3DX12_RESOURCE_DESC::Buffer((UINT64)s.capacity * s.stride);
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &heapDefault, D3D12_HEAP_FLAG_NONE, &desc,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr, IID_PPV_ARGS(&buffer)));
+    return buffer;
+}
+
+UINT GeometryArena::NewHandle(const GeometryRange& range, bool isMesh)
+{
+    UINT handle;
+    if (!m_freeHandles.empty())
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        handle = (UINT)m_ranges.size();
+        m_ranges.emplace_back();
+        m_isMesh.push_back(0);
+        m_live.push_back(0);
+    }
+    m_ranges[handle] = range;
+    m_isMesh[handle] = isMesh ? 1 : 0;
+    m_live[handle] = 1;
+    return handle;
+}
+
+void GeometryArena::Stage(StreamId stream, UINT element, const void* data, UINT64 size)
+{
+    if (size == 0)
+        return;
+    const UINT64 src = m_staging.size();
+    m_staging.resize(src + size);
+    memcpy(m_staging.data() + src, data, size);
+    m_pending.push_back({ stream, (UINT64)element * m_streams[stream].stride, src, size });
+}
+
+UINT GeometryArena::AddMesh(const Mesh& mesh, const VertexQuantization* quant)
+{
+    return AddMesh(mesh.vertices.data(), nullptr, (UINT)mesh.vertices.size(), mesh.indices.data(), (UINT)mesh.indices.size(), quant);
+}
+
+UINT GeometryArena::AddMesh(const Vertex* vertices, const XMFLOAT3* positions, UINT vertexCount, const UINT32* indices, UINT indexCount,
+    const VertexQuantization* quant)
+{
+    GeometryRange r;
+    r.vertexCount = vertexCount;
+    r.indexCount = indexCount;
+
+    r.baseVertex = m_vertexAlloc.Allocate(r.vertexCount);
+    if (r.baseVertex == OffsetAllocator::Invalid)
+        throw std::runtime_error("GeometryArena: vertex buffer is full");
+
+    // короткие индексы, пока для них есть место; иначе меш уходит в общий поток uint32
+    if (m_packed && FitsIndex16(vertexCount))
+    {
+        r.firstIndex = m_index16Alloc.Allocate(r.indexCount);
+        r.index16 = r.firstIndex != OffsetAllocator::Invalid;
+    }
+    if (!r.index16)
+        r.firstIndex = m_indexAlloc.Allocate(r.indexCount);
+    if (r.firstIndex == OffsetAllocator::Invalid)
+    {
+        m_vertexAlloc.Free(r.baseVertex);
+        throw std::runtime_error("GeometryArena: index buffer is full");
+    }
+
+    std::vector<XMFLOAT3> split;
+    if (!positions)
+    {
+        split.resize(vertexCount);
+        SplitPositionStream(vertices, vertexCount, split.data());
+        positions = split.data();
+    }
+    if (m_packed)
+    {
+        const VertexQuantization q = quant ? *quant : ComputeVertexQuantization(vertices, vertexCount);
+        std::vector<PackedVertex> packed(vertexCount);
+        PackVertices(vertices, vertexCount, q, packed.data());
+        Stage(Vertices, r.baseVertex, packed.data(), (UINT64)r.vertexCount * sizeof(PackedVertex));
+    }
+    else
+    {
+        Stage(Vertices, r.baseVertex, vertices, (UINT64)r.vertexCount * sizeof(Vertex));
+    }
+    Stage(Positions, r.baseVertex, positions, (UINT64)r.vertexCount * PositionStreamStride);
+
+    if (r.index16)
+    {
+        std::vector<uint16_t> narrow(indexCount);
+        PackIndices16(indices, indexCount, narrow.data());
+        Stage(Indices16, r.firstIndex, narrow.data(), (UINT64)r.indexCount * sizeof(uint16_t));
+    }
+    else
+    {
+        Stage(Indices, r.firstIndex, indices, (UINT64)r.indexCount * sizeof(UINT32));
+    }
+
+    return NewHandle(r, true);
+}
+
+UINT GeometryArena::AddData(const void* data, UINT count, UINT alignment)
+{
+    GeometryRange r;
+    r.dataCount = count;
+    r.dataOffset = m_dataAlloc.Allocate(count, alignment);
+    if (r.dataOffset == OffsetAllocator::Invalid)
+        throw std::runtime_error("GeometryArena: data buffer is full");
+
+    Stage(Data, r.dataOffset, data, (UINT64)count * sizeof(uint32_t));
+    return NewHandle(r, false);
+}
+
+void GeometryArena::Free(UINT handle)
+{
+    if (handle >= m_ranges.size() || !m_live[handle])
+        return;
+
+    const GeometryRange& r = m_ranges[handle];
+    if (m_isMesh[handle])
+    {
+        m_vertexAlloc.Free(r.baseVertex);
+        (r.index16 ? m_index16Alloc : m_indexAlloc).Free(r.firstIndex);
+    }
+    else
+    {
+        m_dataAlloc.Free(r.dataOffset);
+    }
+
+    m_live[handle] = 0;
+    m_freeHandles.push_back(handle);
+}
+
+void GeometryArena::FlushUploads(ID3D12GraphicsCommandList* cmd)
+{
+    if (m_pending.empty())
+        return;
+
+    StagingBuffer upload = m_stagingPool->Acquire(m_staging.size());
+    memcpy(upload.cpu, m_staging.data(), m_staging.size());
+
+    // буферы арены живут в GENERIC_READ, на время копирования переводим в COPY_DEST.
+    // Новые буферы создаются сразу в COPY_DEST, поэтому перед первым Flush переход не нужен.
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    for (Stream& s : m_streams)
+        if (s.buffer)
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+                s.buffer.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST));
+    if (m_readable)
+        cmd->ResourceBarrier((UINT)barriers.size(), barriers.data());
+
+    for (const PendingCopy& c : m_pending)
+        cmd->CopyBufferRegion(m_streams[c.stream].buffer.Get(), c.dstOffset, upload.resource, c.srcOffset, c.size);
+
+    for (auto& b : barriers)
+        std::swap(b.Transition.StateBefore, b.Transition.StateAfter);
+    cmd->ResourceBarrier((UINT)barriers.size(), barriers.data());
+    m_readable = true;
+
+    m_staging.clear();
+    m_pending.clear();
+}
+
+bool GeometryArena::Defragment(ID3D12GraphicsCommandList* cmd)
+{
+    // ожидающие копии посчитаны по старым смещениям
+    FlushUploads(cmd);
+
+    // старые смещения нужны, чтобы скопировать данные в новые буферы
+    const std::vector<GeometryRange> oldRanges = m_ranges;
+
+    auto remap = [](const std::vector<OffsetAllocator::Move>& moves) {
+        std::unordered_map<UINT, UINT> m;
+        for (const auto& mv : moves) m[mv.from] = mv.to;
+        return m;
+    };
+    const auto vertexMoves = remap(m_vertexAlloc.Compact());
+    const auto indexMoves = remap(m_indexAlloc.Compact());
+    const auto index16Moves = remap(m_index16Alloc.Compact());
+    const auto dataMoves = remap(m_dataAlloc.Compact());
+
+    if (vertexMoves.empty() && indexMoves.empty() && index16Moves.empty() && dataMoves.empty())
+        return false;
+
+    auto moved = [](const std::unordered_map<UINT, UINT>& m, UINT offset) {
+        auto it = m.find(offset);
+        return it == m.end() ? offset : it->second;
+    };
+
+    for (size_t h = 0; h < m_ranges.size(); ++h)
+    {
+        if (!m_live[h]) continue;
+        GeometryRange& r = m_ranges[h];
+        if (m_isMesh[h])
+        {
+            r.baseVertex = moved(vertexMoves, r.baseVertex);
+            r.firstIndex = moved(r.index16 ? index16Moves : indexMoves, r.firstIndex);
+        }
+        else
+        {
+            r.dataOffset = moved(dataMoves, r.dataOffset);
+        }
+    }
+
+    // новые буферы создаются в COPY_DEST, старые остаются в GENERIC_READ и читаются как источник
+    ComPtr<ID3D12Resource> fresh[StreamCount];
+    for (int s = 0; s < StreamCount; ++s)
+        fresh[s] = CreateStreamBuffer(m_streams[s]);
+
+    auto copy = [&](StreamId s, UINT from, UINT to, UINT count) {
+        const UINT64 stride = m_streams[s].stride;
+        if (count != 0)
+            cmd->CopyBufferRegion(fresh[s].Get(), to * stride, m_streams[s].buffer.Get(), from * stride, count * stride);
+    };
+
+    for (size_t h = 0; h < m_ranges.size(); ++h)
+    {
+        if (!m_live[h]) continue;
+        const GeometryRange& o = oldRanges[h];
+        const GeometryRange& n = m_ranges[h];
+        if (m_isMesh[h])
+        {
+            copy(Vertices, o.baseVertex, n.baseVertex, n.vertexCount);
+            copy(Positions, o.baseVertex, n.baseVertex, n.vertexCount);
+            copy(n.index16 ? Indices16 : Indices, o.firstIndex, n.firstIndex, n.indexCount);
+        }
+        else
+        {
+            copy(Data, o.dataOffset, n.dataOffset, n.dataCount);
+        }
+    }
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    for (int s = 0; s < StreamCount; ++s)
+    {
+        if (!fresh[s]) continue;
+        barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(
+            fresh[s].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+        // GPU ещё читает старый буфер
+        m_stagingPool->DeferRelease(m_streams[s].buffer);
+        m_streams[s].buffer = fresh[s];
+    }
+    cmd->ResourceBarrier((UINT)barriers.size(), barriers.data());
+    return true;
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryArena::GetVertexBufferView() const
+{
+    const Stream& s = m_streams[Vertices];
+    if (!s.buffer) return {};
+    return { s.buffer->GetGPUVirtualAddress(), s.capacity * s.stride, s.stride };
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryArena::GetPositionBufferView() const
+{
+    const Stream& s = m_streams[Positions];
+    if (!s.buffer) return {};
+    return { s.buffer->GetGPUVirtualAddress(), s.capacity * s.stride, s.stride };
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryArena::GetIndexBufferView(bool index16) const
+{
+    const Stream& s = m_streams[index16 ? Indices16 : Indices];
+    if (!s.buffer) return {};
+    return { s.buffer->GetGPUVirtualAddress(), s.capacity * s.stride, index16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT };
+}
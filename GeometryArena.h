@@ -0,0 +1,116 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <climits>
+#include <vector>
+#include "Meshes.h"
+#include "OffsetAllocator.h"
+#include "StagingPool.h"
+#include "VertexPacking.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Диапазоны одного меша внутри общих буферов арены.
+// Индексы меша локальные, рисовать через DrawIndexedInstanced(indexCount, 1, firstIndex, baseVertex, 0).
+struct GeometryRange
+{
+    UINT baseVertex = 0;
+    UINT vertexCount = 0;
+    UINT firstIndex = 0;    // в элементах своего потока индексов
+    UINT indexCount = 0;
+    bool index16 = false;   // индексы в потоке uint16
+
+    // сырые uint32 (данные мешлетов)
+    UINT dataOffset = 0;
+    UINT dataCount = 0;
+};
+
+// Вся статическая геометрия в нескольких больших буферах:
+// вершины (Vertex), позиции (XMFLOAT3, те же индексы что у вершин), индексы (uint32) и сырые uint32.
+// В упакованном режиме вершины лежат как PackedVertex, а меши до 65536 вершин берут индексы
+// из отдельного потока uint16. Позиции остаются float: их читают тени и BLAS.
+// Объекты держат хэндл, диапазон по нему может поменяться после Defragment.
+class GeometryArena
+{
+public:
+    static const UINT Invalid = UINT_MAX;
+
+    // index16Capacity используется только с packedVertices
+    void Init(ID3D12Device* device, StagingPool* stagingPool, UINT vertexCapacity, UINT indexCapacity, UINT dataCapacity,
+        bool packedVertices = false, UINT index16Capacity = 0);
+
+    // данные копируются в staging, на GPU уходят в FlushUploads.
+    // quant - квантизация упакованных позиций, nullptr - по AABB самого меша
+    UINT AddMesh(const Mesh& mesh, const VertexQuantization* quant = nullptr);
+    // из готовых массивов (например, прямо из отображённого MeshCache); positions == nullptr - выделить из вершин
+    UINT AddMesh(const Vertex* vertices, const XMFLOAT3* positions, UINT vertexCount, const UINT32* indices, UINT indexCount,
+        const VertexQuantization* quant = nullptr);
+    UINT AddData(const void* data, UINT count, UINT alignment = 1);
+    void Free(UINT handle);
+
+    // upload-буфер берётся из StagingPool и возвращается туда после выполнения копий
+    void FlushUploads(ID3D12GraphicsCommandList* cmd);
+
+    // сжимает все потоки в новые буферы; true - буферы заменены, view и SRV надо пересоздать
+    bool Defragment(ID3D12GraphicsCommandList* cmd);
+
+    const GeometryRange& GetRange(UINT handle) const { return m_ranges[handle]; }
+
+    D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const;
+    D3D12_VERTEX_BUFFER_VIEW GetPositionBufferView() const;
+    D3D12_INDEX_BUFFER_VIEW GetIndexBufferView(bool index16 = false) const;
+
+    bool IsPacked() const { return m_packed; }
+    UINT GetVertexStride() const { return m_streams[Vertices].stride; }
+
+    ID3D12Resource* GetVertexBuffer() const { return m_streams[Vertices].buffer.Get(); }
+    ID3D12Resource* GetPositionBuffer() const { return m_streams[Positions].buffer.Get(); }
+    ID3D12Resource* GetIndexBuffer(bool index16 = false) const { return m_streams[index16 ? Indices16 : Indices].buffer.Get(); }
+    ID3D12Resource* GetDataBuffer() const { return m_streams[Data].buffer.Get(); }
+
+    const OffsetAllocator& GetVertexAllocator() const { return m_vertexAlloc; }
+    const OffsetAllocator& GetIndexAllocator() const { return m_indexAlloc; }
+    const OffsetAllocator& GetIndex16Allocator() const { return m_index16Alloc; }
+    const OffsetAllocator& GetDataAllocator() const { return m_dataAlloc; }
+
+private:
+    enum StreamId { Vertices, Positions, Indices, Indices16, Data, StreamCount };
+
+    struct Stream
+    {
+        ComPtr<ID3D12Resource> buffer;
+        UINT stride = 0;
+        UINT capacity = 0;
+    };
+
+    struct PendingCopy
+    {
+        StreamId stream;
+        UINT64 dstOffset;
+        UINT64 srcOffset;
+        UINT64 size;
+    };
+
+    ComPtr<ID3D12Resource> CreateStreamBuffer(const Stream& s) const;
+    void Stage(StreamId stream, UINT element, const void* data, UINT64 size);
+    UINT NewHandle(const GeometryRange& range, bool isMesh);
+
+    ID3D12Device* m_device = nullptr;
+    StagingPool* m_stagingPool = nullptr;
+    Stream m_streams[StreamCount];
+
+    OffsetAllocator m_vertexAlloc;
+    OffsetAllocator m_indexAlloc;
+    OffsetAllocator m_index16Alloc;
+    OffsetAllocator m_dataAlloc;
+    bool m_packed = false;
+
+    std::vector<GeometryRange> m_ranges;
+    std::vector<uint8_t> m_isMesh;
+    std::vector<uint8_t> m_live;
+    std::vector<UINT> m_freeHandles;
+
+    std::vector<uint8_t> m_staging;
+    std::vector<PendingCopy> m_pending;
+    bool m_readable = false;
+};
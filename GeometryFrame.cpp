@@ -0,0 +1,217 @@
+#include "GeometryFrame.h"
+#include "MeshCacheFormat.h"
+#include "RecordingCommandList.h"
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    // поля SceneObject, которые читает кадр геометрии
+    struct BenchObject
+    {
+        XMFLOAT4 Color{ 1.0f, 1.0f, 1.0f, 1.0f };
+        UINT materialIndex = 0;
+        XMFLOAT3 position{ 0.0f, 0.0f, 0.0f };
+        XMFLOAT3 rotation{ 0.0f, 0.0f, 0.0f };
+        XMFLOAT3 scale{ 1.0f, 1.0f, 1.0f };
+        std::vector<float> lodDistances;
+        bool meshlets = false;
+
+        XMMATRIX GetWorldMatrix() const
+        {
+            return
+                XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z) *
+                XMMatrixTranslation(position.x, position.y, position.z) *
+                XMMatrixScaling(scale.x, scale.y, scale.z);
+        }
+    };
+
+    struct BenchLod
+    {
+        UINT indexCount = 0;
+        std::vector<MeshletBounds> bounds;
+    };
+
+    UINT Align256(UINT size) { return (size + 255) & ~255u; }
+
+    // RecordingCommandList указатели не разыменовывает, нужны только разные значения
+    template<typename T>
+    T* FakeHandle(uintptr_t id) { return reinterpret_cast<T*>(id * 256); }
+
+    double Ms(std::chrono::steady_clock::time_point begin)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+}
+
+GeometryFrameBenchmarkResult RunGeometryFrameBenchmark(uint32_t objects, uint32_t frames, MeshletCullPath cullPath)
+{
+    GeometryFrameBenchmarkResult r;
+    r.objects = objects;
+    r.frames = frames;
+    r.cullPath = cullPath;
+
+    // LOD как у загруженных моделей: сфера от подробной к грубой
+    const uint32_t segments[] = { 48, 24, 12, 6 };
+    std::vector<BenchLod> lods;
+    uint32_t maxMeshlets = 0;
+    for (uint32_t s : segments)
+    {
+        const Mesh mesh = CreateSphere(s, s, 1.0f);
+        BenchLod lod;
+        lod.indexCount = (UINT)mesh.indices.size();
+
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> vertices, prims;
+        const XMFLOAT3* positions = &mesh.vertices[0].Pos;
+        BuildMeshlets_Clustered(mesh.indices, positions, sizeof(Vertex), mesh.vertices.size(),
+            MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims, MeshletConeWeight, meshlets, vertices, prims);
+        for (const Meshlet& m : meshlets)
+            lod.bounds.push_back(ComputeMeshletBounds(m, vertices, prims, positions, sizeof(Vertex)));
+        maxMeshlets = (std::max)(maxMeshlets, (uint32_t)lod.bounds.size());
+        lods.push_back(std::move(lod));
+    }
+
+    // сетка side x side x side с шагом 4, масштаб 1..2
+    const uint32_t side = (uint32_t)std::ceil(std::cbrt((double)objects));
+    const float spacing = 4.0f;
+    const float half = side * spacing * 0.5f;
+    std::vector<BenchObject> scene(objects);
+    std::vector<OctItem> items;
+    AABB bounds;
+    for (uint32_t i = 0; i < objects; ++i)
+    {
+        BenchObject& obj = scene[i];
+        const uint32_t x = i % side, y = (i / side) % side, z = i / (side * side);
+        const float s = 1.0f + (i % 5) * 0.25f;
+        obj.scale = { s, s, s };
+        // GetWorldMatrix масштабирует после переноса
+        obj.position = { (x * spacing - half) / s, (y * spacing - half) / s, (z * spacing - half) / s };
+        obj.rotation = { 0.0f, i * 0.1f, 0.0f };
+        obj.materialIndex = i % 32;
+        obj.lodDistances = { 0.0f, 8.0f, 24.0f, 64.0f };
+        obj.meshlets = (i & 1) != 0;
+
+        const XMFLOAT3 c = { obj.position.x * s, obj.position.y * s, obj.position.z * s };
+        OctItem item;
+        item.box.minv = { c.x - s, c.y - s, c.z - s };
+        item.box.maxv = { c.x + s, c.y + s, c.z + s };
+        item.ptr = &obj;
+        bounds.expand(item.box);
+        items.push_back(item);
+    }
+    Octree octree;
+    if (objects)
+        octree.Build(bounds, items);
+
+    const UINT cbStride = Align256(sizeof(ObjectCB));
+    const UINT cullStride = Align256(sizeof(MeshletCullConstants));
+    std::vector<uint8_t> cbData((size_t)objects * cbStride), passData(Align256(sizeof(PassCB)));
+    std::vector<uint8_t> cullData((size_t)objects * cullStride);
+    std::vector<uint32_t> listData((size_t)objects * maxMeshlets);
+    const std::vector<VertexQuantization> quant;
+    std::vector<XMFLOAT4X4> worlds;
+
+    GeometryPassBindings b;
+    b.rootSignature = FakeHandle<ID3D12RootSignature>(1);
+    b.meshletRootSignature = FakeHandle<ID3D12RootSignature>(2);
+    b.gbufferPSO = FakeHandle<ID3D12PipelineState>(3);
+    b.tessellationPSO = FakeHandle<ID3D12PipelineState>(4);
+    b.transparentPSO = FakeHandle<ID3D12PipelineState>(5);
+    b.meshletPSO = FakeHandle<ID3D12PipelineState>(6);
+    b.meshletCullPSO = FakeHandle<ID3D12PipelineState>(7);
+    b.meshletListPSO = FakeHandle<ID3D12PipelineState>(8);
+    b.lightCB = 0x1000;
+    b.tessCB = 0x2000;
+    b.animCB = 0x3000;
+    b.passCB = 0x4000;
+    b.srvTable = { 0x100 };
+    b.samplerTable = { 0x200 };
+
+    // общая арена, как у GeometryArena: LOD подряд
+    const D3D12_VERTEX_BUFFER_VIEW vbv{ 0x1000000, 1 << 24, 20 };
+    const D3D12_INDEX_BUFFER_VIEW ibv{ 0x2000000, 1 << 22, DXGI_FORMAT_R16_UINT };
+    auto source = [&](size_t objIndex, int lod)
+    {
+        GeometryObjectSource src;
+        const BenchLod& l = lods[(size_t)lod];
+        if (scene[objIndex].meshlets)
+        {
+            src.meshletCount = (UINT)l.bounds.size();
+            src.meshletBounds = l.bounds.data();
+            src.meshletTable = { 0x10000 + (UINT64)lod * 0x100 };
+        }
+        else
+        {
+            src.vbv = vbv;
+            src.ibv = ibv;
+            src.indexCount = l.indexCount;
+            src.firstIndex = (UINT)lod * 0x10000;
+        }
+        return src;
+    };
+
+    GeometryFrameParams params;
+    params.objectCBs = 0x100000;
+    params.objectCBStride = cbStride;
+    params.materialCBs = 0x200000;
+    params.materialCBStride = 256;
+    params.cullPath = cullPath;
+    params.cullData = cullData.data();
+    params.cullCBs = 0x300000;
+    params.cullStride = cullStride;
+    params.listData = listData.data();
+    params.listAddress = 0x400000;
+
+    const XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f);
+    std::vector<BenchObject*> visible;
+    GeometryFrame frame;
+    RecordingCommandList rec;
+
+    for (uint32_t f = 0; f < frames; ++f)
+    {
+        // облёт по кругу чуть выше сетки, камера смотрит мимо центра
+        const float angle = f * 0.05f;
+        const float radius = half * 1.5f + 8.0f;
+        const XMFLOAT3 eye = { std::cos(angle) * radius, half * 0.3f, std::sin(angle) * radius };
+        const XMMATRIX viewProj = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorSet(half * 0.2f, 0.0f, 0.0f, 1.0f),
+            XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * proj;
+
+        for (uint32_t i = 0; i < objects; i += 8)
+            scene[i].rotation.y += 0.01f;
+
+        auto begin = std::chrono::steady_clock::now();
+        QueryVisibleObjects(objects ? &octree : nullptr, viewProj, visible);
+        r.extractMs += Ms(begin);
+
+        begin = std::chrono::steady_clock::now();
+        r.cbUploads += PackObjectCBs(scene, quant, worlds, cbData.data(), cbStride);
+        PackPassCB(viewProj, passData.data());
+        r.packMs += Ms(begin);
+
+        begin = std::chrono::steady_clock::now();
+        params.lodOrigin = eye;
+        XMStoreFloat4x4(&params.cullView.viewProj, viewProj);
+        params.cullView.occluderViewProj = params.cullView.viewProj;
+        params.cullView.cameraPos = eye;
+        params.cullView.flags = MeshletCullFrustum | MeshletCullCone;
+        params.worlds = worlds.data();
+        BuildGeometryDrawItems(visible, scene.data(), params, source, frame);
+        r.buildMs += Ms(begin);
+
+        begin = std::chrono::steady_clock::now();
+        rec.Reset();
+        StateFilteredCommandList<RecordingCommandList> sc(&rec);
+        const GeometryPassStats stats = RecordGeometryDraws(sc, b, frame.items);
+        r.recordMs += Ms(begin);
+
+        r.visible += visible.size();
+        r.drawIndexed += stats.drawIndexed;
+        r.meshDispatches += stats.meshDispatches;
+        r.stateCallsIssued += stats.stateCallsIssued;
+        r.stateCallsElided += stats.stateCallsElided;
+        r.cullStats += frame.cullStats;
+        r.streamBytes = rec.GetStreamSize();
+    }
+    return r;
+}
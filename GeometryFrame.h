@@ -0,0 +1,261 @@
+#pragma once
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "FrustumPlane.h"
+#include "GeometryRecorder.h"
+#include "MeshletCulling.h"
+#include "Octree.h"
+#include "VertexPacking.h"
+
+using namespace DirectX;
+
+// CPU-часть кадра геометрии без устройства: видимые объекты, LOD, объектные CB, отсечение мешлетов
+// и GeometryDrawItem. RenderingSystem пишет в upload-буферы, бенчмарк и тесты - в обычную память.
+// TObject - SceneObject или структура с теми же полями: position, scale, lodDistances, Color,
+// materialIndex и GetWorldMatrix()
+
+// = cbuffer ObjectCB в Shaders.hlsl
+struct ObjectCB
+{
+    XMFLOAT4X4 World;
+    UINT MaterialIndex;
+    XMFLOAT3 QuantOffset;  // упакованные вершины: AABB объекта, см. VertexPacking.h
+    XMFLOAT3 QuantScale;
+    float _padCB;
+};
+
+// = cbuffer PassCB
+struct PassCB
+{
+    XMFLOAT4X4 ViewProj;
+};
+
+// дистанции LOD в единицах меша, масштаб объекта можно менять на лету
+inline int SelectLod(const std::vector<float>& lodDistances, const XMFLOAT3& scale, float dist)
+{
+    const float lodScale = (std::max)({ scale.x, scale.y, scale.z });
+    for (int j = 0; j + 1 < static_cast<int>(lodDistances.size()); ++j)
+    {
+        if (dist < lodDistances[j + 1] * lodScale)
+            return j;
+    }
+    return static_cast<int>(lodDistances.size()) - 1;
+}
+
+template<typename TObject>
+void QueryVisibleObjects(const Octree* octree, const XMMATRIX& viewProj, std::vector<TObject*>& out)
+{
+    XMFLOAT4 planes[6];
+    ExtractFrustumPlanes(planes, viewProj);
+
+    out.clear();
+    if (!octree) return;
+
+    std::vector<void*> hits;
+    octree->QueryFrustum(planes, hits);
+
+    for (void* p : hits)
+        out.push_back(reinterpret_cast<TObject*>(p));
+}
+
+// объектный CB пишем только если поменялась матрица; worlds - что уже лежит в буфере.
+// Возвращает число записанных CB
+template<typename TObject>
+UINT PackObjectCBs(const std::vector<TObject>& objects, const std::vector<VertexQuantization>& quant,
+    std::vector<XMFLOAT4X4>& worlds, uint8_t* mapped, UINT stride)
+{
+    const bool firstUpload = worlds.size() != objects.size();
+    if (firstUpload)
+        worlds.resize(objects.size());
+
+    UINT uploads = 0;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        const TObject& obj = objects[i];
+
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, obj.GetWorldMatrix());
+        if (!firstUpload && memcmp(&world, &worlds[i], sizeof(world)) == 0)
+            continue;
+
+        worlds[i] = world;
+
+        ObjectCB cb{};
+        cb.World = world;
+        cb.MaterialIndex = obj.materialIndex;
+        if (i < quant.size())
+        {
+            cb.QuantOffset = quant[i].offset;
+            cb.QuantScale = quant[i].scale;
+        }
+        memcpy(mapped + i * stride, &cb, sizeof(cb));
+        ++uploads;
+    }
+    return uploads;
+}
+
+inline void PackPassCB(const XMMATRIX& viewProj, uint8_t* mapped)
+{
+    PassCB pass{};
+    XMStoreFloat4x4(&pass.ViewProj, viewProj);
+    memcpy(mapped, &pass, sizeof(pass));
+}
+
+// геометрия объекта на выбранном LOD: мешлеты (meshletCount != 0) или диапазон арены
+struct GeometryObjectSource
+{
+    bool tessellated = false;
+
+    UINT meshletCount = 0;
+    const MeshletBounds* meshletBounds = nullptr;
+    D3D12_GPU_DESCRIPTOR_HANDLE meshletTable{};
+
+    D3D12_VERTEX_BUFFER_VIEW vbv{};
+    D3D12_INDEX_BUFFER_VIEW ibv{};
+    UINT indexCount = 0;
+    UINT firstIndex = 0;
+    UINT baseVertex = 0;
+};
+
+// объект, для которого AS пишет флаги видимости
+struct MeshletCullCheck
+{
+    size_t objIndex = 0;
+    size_t lod = 0;
+    MeshletCullConstants constants{};
+};
+
+struct GeometryFrameParams
+{
+    XMFLOAT3 lodOrigin = { 0.0f, 0.0f, 0.0f };
+
+    D3D12_GPU_VIRTUAL_ADDRESS objectCBs = 0;
+    UINT objectCBStride = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS materialCBs = 0;
+    UINT materialCBStride = 0;
+
+    MeshletCullPath cullPath = MeshletCullPath::Off;
+    MeshletCullView cullView;
+    const XMFLOAT4X4* worlds = nullptr;         // по объектам, из PackObjectCBs
+
+    uint8_t* cullData = nullptr;                // Amplification: MeshletCullConstants на объект
+    D3D12_GPU_VIRTUAL_ADDRESS cullCBs = 0;
+    UINT cullStride = 0;
+    std::vector<MeshletCullCheck>* checks = nullptr;   // не null - AS пишет флаги для сверки
+
+    uint32_t* listData = nullptr;               // CpuList: видимые мешлеты подряд
+    D3D12_GPU_VIRTUAL_ADDRESS listAddress = 0;
+};
+
+struct GeometryFrame
+{
+    std::vector<GeometryDrawItem> items;
+    MeshletCullStats cullStats;      // только CpuList
+    uint32_t visibilityCount = 0;    // флагов видимости, записанных AS
+    uint32_t listCount = 0;          // элементов listData
+
+    void Clear()
+    {
+        items.clear();
+        cullStats = {};
+        visibilityCount = 0;
+        listCount = 0;
+    }
+};
+
+// source(objIndex, lod) -> GeometryObjectSource; objIndex считается от firstObject
+template<typename TObject, typename TSource>
+void BuildGeometryDrawItems(const std::vector<TObject*>& visible, const TObject* firstObject,
+    const GeometryFrameParams& p, TSource&& source, GeometryFrame& frame)
+{
+    frame.Clear();
+    const XMVECTOR origin = XMLoadFloat3(&p.lodOrigin);
+
+    for (const TObject* obj : visible)
+    {
+        const float dist = XMVectorGetX(XMVector3Length(origin - XMLoadFloat3(&obj->position)));
+        const int lod = SelectLod(obj->lodDistances, obj->scale, dist);
+        const size_t objIndex = (size_t)(obj - firstObject);
+        const GeometryObjectSource src = source(objIndex, lod);
+
+        GeometryDrawItem item;
+        item.objectCB = p.objectCBs + (UINT)objIndex * p.objectCBStride;
+        item.materialCB = p.materialCBs + obj->materialIndex * p.materialCBStride;
+        item.transparent = (obj->Color.w != 1.0f);
+        item.tessellated = src.tessellated;
+        item.meshlet = src.meshletCount != 0;
+
+        if (item.meshlet)
+        {
+            item.meshletTable = src.meshletTable;
+            item.meshletCount = src.meshletCount;
+            item.meshletCull = p.cullPath;
+
+            if (p.cullPath != MeshletCullPath::Off)
+            {
+                MeshletCullConstants c = MakeMeshletCullConstants(p.worlds[objIndex], p.cullView, src.meshletCount);
+
+                if (p.cullPath == MeshletCullPath::Amplification)
+                {
+                    if (p.checks)
+                    {
+                        c.flags |= MeshletCullWriteVisibility;
+                        c.visibilityOffset = frame.visibilityCount;
+                        frame.visibilityCount += src.meshletCount;
+                        p.checks->push_back({ objIndex, (size_t)lod, c });
+                    }
+                    memcpy(p.cullData + objIndex * p.cullStride, &c, sizeof(c));
+                    item.meshletCullCB = p.cullCBs + objIndex * p.cullStride;
+                }
+                else
+                {
+                    // список видимых - в общий upload-буфер подряд, AS не нужен
+                    uint32_t* list = p.listData + frame.listCount;
+                    item.meshletCount = CullMeshlets(src.meshletBounds, src.meshletCount, c, nullptr, list, &frame.cullStats);
+                    item.meshletList = p.listAddress + frame.listCount * sizeof(uint32_t);
+                    frame.listCount += item.meshletCount;
+                }
+            }
+        }
+        else
+        {
+            item.vbv = src.vbv;
+            item.ibv = src.ibv;
+            item.indexCount = src.indexCount;
+            item.firstIndex = src.firstIndex;
+            item.baseVertex = src.baseVertex;
+        }
+
+        frame.items.push_back(item);
+    }
+}
+
+struct GeometryFrameBenchmarkResult
+{
+    uint32_t objects = 0;
+    uint32_t frames = 0;
+    MeshletCullPath cullPath = MeshletCullPath::Off;
+    uint64_t visible = 0;        // суммы по кадрам
+    uint64_t cbUploads = 0;
+    uint64_t drawIndexed = 0;
+    uint64_t meshDispatches = 0;
+    uint64_t stateCallsIssued = 0;
+    uint64_t stateCallsElided = 0;
+    MeshletCullStats cullStats;
+    size_t streamBytes = 0;      // RecordingCommandList последнего кадра
+
+    double extractMs = 0.0;      // октодерево
+    double packMs = 0.0;         // объектные CB и PassCB
+    double buildMs = 0.0;        // LOD, отсечение мешлетов, GeometryDrawItem
+    double recordMs = 0.0;       // RecordGeometryDraws в RecordingCommandList
+
+    double MsPerFrame(double ms) const { return frames ? ms / frames : 0.0; }
+    double TotalMs() const { return extractMs + packMs + buildMs + recordMs; }
+};
+
+// Синтетическая сцена: сетка объектов, у половины мешлеты; камера облетает её, восьмая часть объектов
+// вращается и каждый кадр переписывает CB. Весь кадр GeometryPass, кроме GPU
+GeometryFrameBenchmarkResult RunGeometryFrameBenchmark(uint32_t objects, uint32_t frames,
+    MeshletCullPath cullPath = MeshletCullPath::CpuList);
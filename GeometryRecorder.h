@@ -0,0 +1,167 @@
+#pragma once
+#include <d3d12.h>
+#include <vector>
+#include "StateFilteredCommandList.h"
+
+// Как отсекаются мешлеты объекта: никак, в AS_MeshletCull или заранее на CPU (CullMeshlets)
+enum class MeshletCullPath : uint8_t { Off, Amplification, CpuList };
+
+// Всё, что нужно GeometryPass для записи одного объекта, без обращения к устройству и SceneObject
+struct GeometryDrawItem
+{
+    D3D12_GPU_VIRTUAL_ADDRESS objectCB = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS materialCB = 0;
+    bool meshlet = false;
+    bool tessellated = false;
+    bool transparent = false;
+
+    D3D12_VERTEX_BUFFER_VIEW vbv{};
+    D3D12_INDEX_BUFFER_VIEW ibv{};
+    UINT indexCount = 0;
+    UINT firstIndex = 0;
+    UINT baseVertex = 0;
+
+    D3D12_GPU_DESCRIPTOR_HANDLE meshletTable{};
+    UINT meshletCount = 0;   // CpuList - уже только видимые
+
+    MeshletCullPath meshletCull = MeshletCullPath::Off;
+    D3D12_GPU_VIRTUAL_ADDRESS meshletCullCB = 0;   // Amplification
+    D3D12_GPU_VIRTUAL_ADDRESS meshletList = 0;     // CpuList
+};
+
+struct GeometryPassBindings
+{
+    ID3D12RootSignature* rootSignature = nullptr;
+    ID3D12RootSignature* meshletRootSignature = nullptr;
+    ID3D12PipelineState* gbufferPSO = nullptr;
+    ID3D12PipelineState* tessellationPSO = nullptr;
+    ID3D12PipelineState* transparentPSO = nullptr;
+    ID3D12PipelineState* meshletPSO = nullptr;
+    ID3D12PipelineState* meshletCullPSO = nullptr;
+    ID3D12PipelineState* meshletListPSO = nullptr;
+
+    D3D12_GPU_VIRTUAL_ADDRESS lightCB = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS tessCB = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS animCB = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS passCB = 0;
+    D3D12_GPU_DESCRIPTOR_HANDLE srvTable{};
+    D3D12_GPU_DESCRIPTOR_HANDLE samplerTable{};
+    D3D12_GPU_VIRTUAL_ADDRESS meshletVisibility = 0;
+    D3D12_GPU_DESCRIPTOR_HANDLE hizTable{};
+};
+
+struct GeometryPassStats
+{
+    UINT drawIndexed = 0;
+    UINT meshDispatches = 0;
+    UINT stateCallsIssued = 0;   // счётчики sc после записи
+    UINT stateCallsElided = 0;
+};
+
+// мешлетный объект; только для списков с DispatchMesh
+template<typename TCmdList>
+void RecordMeshletDraw(StateFilteredCommandList<TCmdList>& sc,
+    const GeometryPassBindings& b, const GeometryDrawItem& item, GeometryPassStats& stats)
+{
+    sc.SetGraphicsRootSignature(b.meshletRootSignature);
+    if (item.meshletCull == MeshletCullPath::Amplification)
+        sc.SetPipelineState(b.meshletCullPSO);
+    else if (item.meshletCull == MeshletCullPath::CpuList)
+        sc.SetPipelineState(b.meshletListPSO);
+    else
+        sc.SetPipelineState(b.meshletPSO);
+
+    sc.SetGraphicsRootConstantBufferView(0, item.objectCB);
+    sc.SetGraphicsRootConstantBufferView(1, b.lightCB);
+    sc.SetGraphicsRootConstantBufferView(2, b.tessCB);
+    sc.SetGraphicsRootDescriptorTable(3, b.srvTable);
+    sc.SetGraphicsRootDescriptorTable(4, b.samplerTable);
+    sc.SetGraphicsRootConstantBufferView(5, item.materialCB);
+    sc.SetGraphicsRootConstantBufferView(6, b.animCB);
+    sc.SetGraphicsRootDescriptorTable(7, item.meshletTable);
+    sc.SetGraphicsRootConstantBufferView(9, b.passCB);
+
+    if (item.meshletCull == MeshletCullPath::Amplification)
+    {
+        // группа AS_MeshletCull - 32 мешлета
+        sc.SetGraphicsRootConstantBufferView(10, item.meshletCullCB);
+        sc.SetGraphicsRootUnorderedAccessView(12, b.meshletVisibility);
+        sc.SetGraphicsRootDescriptorTable(13, b.hizTable);
+        sc.DispatchMesh((item.meshletCount + 31) / 32, 1, 1);
+        stats.meshDispatches++;
+    }
+    else if (item.meshletCull == MeshletCullPath::CpuList)
+    {
+        if (item.meshletCount == 0)
+            return;
+        sc.SetGraphicsRootShaderResourceView(11, item.meshletList);
+        sc.DispatchMesh(item.meshletCount, 1, 1);
+        stats.meshDispatches++;
+    }
+    else
+    {
+        sc.DispatchMesh(item.meshletCount, 1, 1);
+        stats.meshDispatches++;
+    }
+}
+
+// TCmdList - ID3D12GraphicsCommandList6 (или базовый список без mesh shaders) на GPU, RecordingCommandList без него
+template<typename TCmdList>
+GeometryPassStats RecordGeometryDraws(StateFilteredCommandList<TCmdList>& sc,
+    const GeometryPassBindings& b, const std::vector<GeometryDrawItem>& items)
+{
+    GeometryPassStats stats;
+    bool switchedToTransparent = false;
+
+    sc.SetGraphicsRootSignature(b.rootSignature);
+
+    for (const GeometryDrawItem& item : items)
+    {
+        if (!switchedToTransparent && item.transparent)
+        {
+            sc.SetPipelineState(b.transparentPSO);
+            switchedToTransparent = true;
+        }
+
+        if (item.meshlet)
+        {
+            // без ID3D12GraphicsCommandList6 мешлетных элементов нет: их строят только при поддержке mesh shaders
+            if constexpr (HasDispatchMesh<TCmdList>::value)
+                RecordMeshletDraw(sc, b, item, stats);
+        }
+        else
+        {
+            sc.SetGraphicsRootSignature(b.rootSignature);
+
+            if (item.tessellated)
+            {
+                sc.SetPipelineState(b.tessellationPSO);
+                sc.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
+            }
+            else
+            {
+                sc.SetPipelineState(b.gbufferPSO);
+                sc.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            }
+
+            sc.SetGraphicsRootConstantBufferView(0, item.objectCB);
+            sc.SetGraphicsRootConstantBufferView(1, b.lightCB);
+            sc.SetGraphicsRootConstantBufferView(2, b.tessCB);
+            sc.SetGraphicsRootDescriptorTable(3, b.srvTable);
+            sc.SetGraphicsRootDescriptorTable(4, b.samplerTable);
+            sc.SetGraphicsRootConstantBufferView(5, item.materialCB);
+            sc.SetGraphicsRootConstantBufferView(6, b.animCB);
+            sc.SetGraphicsRootConstantBufferView(7, b.passCB);
+
+            sc.IASetVertexBuffers(0, 1, &item.vbv);
+            sc.IASetIndexBuffer(&item.ibv);
+
+            sc.DrawIndexedInstanced(item.indexCount, 1, item.firstIndex, (INT)item.baseVertex, 0);
+            stats.drawIndexed++;
+        }
+    }
+
+    stats.stateCallsIssued = sc.GetIssuedCount();
+    stats.stateCallsElided = sc.GetElidedCount();
+    return stats;
+}
@@ -0,0 +1,255 @@
+#include "GpuHeapAllocator.h"
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+static inline void ThrowIfFailed(HRESULT hr)
+{
+    if (FAILED(hr))
+        throw std::runtime_error("HRESULT failed");
+}
+
+namespace
+{
+    // DEFAULT, UPLOAD, READBACK
+    const uint32_t kHeapTypeCount = 3;
+    const uint32_t kPoolCount = kHeapTypeCount * (uint32_t)HeapResourceClass::Count;
+
+    // {5B0E6C2A-8F41-4D7E-9C3B-2A61D0F47E18}
+    const GUID kPlacementGuid = { 0x5b0e6c2a, 0x8f41, 0x4d7e, { 0x9c, 0x3b, 0x2a, 0x61, 0xd0, 0xf4, 0x7e, 0x18 } };
+
+    uint32_t PoolIndex(D3D12_HEAP_TYPE type, HeapResourceClass cls)
+    {
+        return ((uint32_t)type - 1) * (uint32_t)HeapResourceClass::Count + (uint32_t)cls;
+    }
+
+    D3D12_HEAP_FLAGS HeapFlagsFor(HeapResourceClass cls)
+    {
+        return cls == HeapResourceClass::Buffer
+            ? D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS
+            : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    }
+}
+
+struct GpuHeapState
+{
+    std::mutex mutex;
+    HeapBlockPool pools[kPoolCount];
+    std::vector<ComPtr<ID3D12Heap>> heaps[kPoolCount];
+    uint32_t placedResources = 0;
+    uint32_t committedFallbacks = 0;
+
+    void Free(uint32_t pool, const HeapBlockPool::Allocation& a)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pools[pool].Free(a);
+        --placedResources;
+    }
+
+    void TrimLocked()
+    {
+        for (uint32_t p = 0; p < kPoolCount; ++p)
+            for (uint32_t b : pools[p].ReleaseEmptyBlocks())
+                heaps[p][b].Reset();
+    }
+};
+
+namespace
+{
+    // Вешается на ресурс через SetPrivateDataInterface; ресурс отпускает его при уничтожении
+    class PlacementToken final : public IUnknown
+    {
+    public:
+        PlacementToken(std::shared_ptr<GpuHeapState> state, uint32_t pool, const HeapBlockPool::Allocation& a)
+            : m_state(std::move(state)), m_pool(pool), m_allocation(a)
+        {
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if (riid == __uuidof(IUnknown))
+            {
+                *object = static_cast<IUnknown*>(this);
+                AddRef();
+                return S_OK;
+            }
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override { return ++m_refs; }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const ULONG refs = --m_refs;
+            if (refs == 0)
+            {
+                m_state->Free(m_pool, m_allocation);
+                delete this;
+            }
+            return refs;
+        }
+
+    private:
+        std::atomic<ULONG> m_refs{ 1 };
+        std::shared_ptr<GpuHeapState> m_state;
+        uint32_t m_pool;
+        HeapBlockPool::Allocation m_allocation;
+    };
+}
+
+void GpuHeapAllocator::Init(ID3D12Device* device, IDXGIAdapter3* adapter, uint64_t blockSize)
+{
+    m_device = device;
+    m_adapter = adapter;
+    m_state = std::make_shared<GpuHeapState>();
+    for (HeapBlockPool& pool : m_state->pools)
+        pool.Init(blockSize);
+}
+
+HeapResourceClass GpuHeapAllocator::Classify(const D3D12_RESOURCE_DESC& desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return HeapResourceClass::Buffer;
+    if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        return HeapResourceClass::RenderTarget;
+    return HeapResourceClass::Texture;
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO GpuHeapAllocator::QueryAllocationInfo(D3D12_RESOURCE_DESC& desc, HeapResourceClass cls) const
+{
+    // маленьким текстурам без MSAA можно 4 КБ вместо 64 КБ, если драйвер согласен
+    if (cls == HeapResourceClass::Texture && desc.SampleDesc.Count <= 1)
+    {
+        desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+        D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+        if (info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+            return info;
+    }
+    desc.Alignment = 0;
+    return m_device->GetResourceAllocationInfo(0, 1, &desc);
+}
+
+HRESULT GpuHeapAllocator::CreateResource(const D3D12_HEAP_PROPERTIES* heapProps, D3D12_HEAP_FLAGS heapFlags,
+    const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES initialState,
+    const D3D12_CLEAR_VALUE* clearValue, REFIID riid, void** resource)
+{
+    if (!m_state)
+        throw std::runtime_error("GpuHeapAllocator: Init was not called");
+
+    const HeapResourceClass cls = Classify(*desc);
+    const D3D12_HEAP_TYPE type = heapProps->Type;
+
+    // текстуры бывают только в DEFAULT; CUSTOM и особые флаги кучи оставляем драйверу.
+    // Placed RT/DS до первого использования обязаны пройти Clear/Discard/Copy, а у нас
+    // не все цели это гарантируют (история TAA, копии глубины) - их тоже оставляем committed
+    const bool placeable = heapFlags == D3D12_HEAP_FLAG_NONE &&
+        cls != HeapResourceClass::RenderTarget &&
+        (type == D3D12_HEAP_TYPE_DEFAULT ||
+         ((type == D3D12_HEAP_TYPE_UPLOAD || type == D3D12_HEAP_TYPE_READBACK) && cls == HeapResourceClass::Buffer));
+
+    if (placeable)
+    {
+        D3D12_RESOURCE_DESC placedDesc = *desc;
+        const D3D12_RESOURCE_ALLOCATION_INFO info = QueryAllocationInfo(placedDesc, cls);
+        if (info.SizeInBytes != UINT64_MAX &&
+            SUCCEEDED(CreatePlaced(type, cls, placedDesc, info, initialState, clearValue, riid, resource)))
+            return S_OK;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        ++m_state->committedFallbacks;
+    }
+    return m_device->CreateCommittedResource(heapProps, heapFlags, desc, initialState, clearValue, riid, resource);
+}
+
+HRESULT GpuHeapAllocator::CreatePlaced(D3D12_HEAP_TYPE heapType, HeapResourceClass cls, const D3D12_RESOURCE_DESC& desc,
+    const D3D12_RESOURCE_ALLOCATION_INFO& info, D3D12_RESOURCE_STATES initialState,
+    const D3D12_CLEAR_VALUE* clearValue, REFIID riid, void** resource)
+{
+    const uint32_t pool = PoolIndex(heapType, cls);
+    HeapBlockPool::Allocation a;
+    ID3D12Heap* heap = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+
+        bool newBlock = false;
+        a = m_state->pools[pool].Allocate(info.SizeInBytes, info.Alignment, newBlock);
+        if (a.block == HeapBlockPool::Invalid)
+            return E_OUTOFMEMORY;
+
+        auto& heaps = m_state->heaps[pool];
+        if (heaps.size() <= a.block)
+            heaps.resize(a.block + 1);
+
+        if (newBlock)
+        {
+            D3D12_HEAP_DESC heapDesc{};
+            heapDesc.SizeInBytes = m_state->pools[pool].GetBlockSize();
+            heapDesc.Properties.Type = heapType;
+            heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+            heapDesc.Flags = HeapFlagsFor(cls);
+
+            HRESULT hr = m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heaps[a.block]));
+            if (FAILED(hr))
+            {
+                m_state->pools[pool].Free(a);
+                m_state->TrimLocked();
+                return hr;
+            }
+        }
+        heap = heaps[a.block].Get();
+        ++m_state->placedResources;
+    }
+
+    ComPtr<ID3D12Resource> placed;
+    HRESULT hr = m_device->CreatePlacedResource(heap, a.offset, &desc, initialState, clearValue, IID_PPV_ARGS(&placed));
+    if (FAILED(hr))
+    {
+        m_state->Free(pool, a);
+        return hr;
+    }
+
+    // после этого диапазон освобождает сам ресурс
+    PlacementToken* token = new PlacementToken(m_state, pool, a);
+    hr = placed->SetPrivateDataInterface(kPlacementGuid, token);
+    token->Release();
+    ThrowIfFailed(hr);
+
+    return placed->QueryInterface(riid, resource);
+}
+
+void GpuHeapAllocator::Trim()
+{
+    if (!m_state)
+        return;
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->TrimLocked();
+}
+
+GpuMemoryBudget GpuHeapAllocator::GetBudget() const
+{
+    GpuMemoryBudget b;
+    if (m_state)
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        for (const HeapBlockPool& pool : m_state->pools)
+        {
+            b.reservedBytes += pool.GetReservedBytes();
+            b.usedBytes += pool.GetUsedBytes();
+            b.heapBlocks += (uint32_t)pool.GetLiveBlockCount();
+        }
+        b.placedResources = m_state->placedResources;
+        b.committedFallbacks = m_state->committedFallbacks;
+    }
+
+    DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+    if (m_adapter && SUCCEEDED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+    {
+        b.budget = info.Budget;
+        b.currentUsage = info.CurrentUsage;
+    }
+    return b;
+}
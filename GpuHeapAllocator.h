@@ -0,0 +1,65 @@
+#pragma once
+#include <wrl.h>
+#include <d3d12.h>
+#include <dxgi1_4.h>
+#include <cstdint>
+#include <memory>
+#include "HeapBlockPool.h"
+
+using Microsoft::WRL::ComPtr;
+
+enum class HeapResourceClass : uint8_t
+{
+    Buffer,
+    Texture,        // без RT/DS флагов
+    RenderTarget,   // RT или DS, всегда committed
+    Count
+};
+
+struct GpuMemoryBudget
+{
+    uint64_t reservedBytes = 0;     // сумма всех блоков-куч
+    uint64_t usedBytes = 0;         // занято placed-ресурсами
+    uint32_t heapBlocks = 0;
+    uint32_t placedResources = 0;
+    uint32_t committedFallbacks = 0;
+    uint64_t budget = 0;            // DXGI_QUERY_VIDEO_MEMORY_INFO для локального сегмента, 0 без адаптера
+    uint64_t currentUsage = 0;
+};
+
+struct GpuHeapState;
+
+// Размещает ресурсы в больших ID3D12Heap (блоки на тип кучи и класс ресурса)
+// вместо неявной кучи на каждый CreateCommittedResource.
+// Диапазон возвращается в пул сам, когда удалён последний ComPtr на ресурс.
+class GpuHeapAllocator
+{
+public:
+    static const uint64_t DefaultBlockSize = 64ull * 1024 * 1024;
+
+    void Init(ID3D12Device* device, IDXGIAdapter3* adapter, uint64_t blockSize = DefaultBlockSize);
+
+    // аргументы как у ID3D12Device::CreateCommittedResource; что не влезает в блок
+    // или требует особых флагов кучи, создаётся committed
+    HRESULT CreateResource(const D3D12_HEAP_PROPERTIES* heapProps, D3D12_HEAP_FLAGS heapFlags,
+        const D3D12_RESOURCE_DESC* desc, D3D12_RESOURCE_STATES initialState,
+        const D3D12_CLEAR_VALUE* clearValue, REFIID riid, void** resource);
+
+    // освобождает пустые блоки
+    void Trim();
+
+    GpuMemoryBudget GetBudget() const;
+
+    static HeapResourceClass Classify(const D3D12_RESOURCE_DESC& desc);
+
+private:
+    D3D12_RESOURCE_ALLOCATION_INFO QueryAllocationInfo(D3D12_RESOURCE_DESC& desc, HeapResourceClass cls) const;
+    HRESULT CreatePlaced(D3D12_HEAP_TYPE heapType, HeapResourceClass cls, const D3D12_RESOURCE_DESC& desc,
+        const D3D12_RESOURCE_ALLOCATION_INFO& info, D3D12_RESOURCE_STATES initialState,
+        const D3D12_CLEAR_VALUE* clearValue, REFIID riid, void** resource);
+
+    ComPtr<ID3D12Device> m_device;
+    ComPtr<IDXGIAdapter3> m_adapter;
+    // общее с ресурсами: живёт, пока жив хоть один placed-ресурс
+    std::shared_ptr<GpuHeapState> m_state;
+};
@@ -0,0 +1,91 @@
+#include "HeapBlockPool.h"
+#include <stdexcept>
+
+HeapBlockPool::HeapBlockPool(uint64_t blockSize)
+{
+    Init(blockSize);
+}
+
+void HeapBlockPool::Init(uint64_t blockSize)
+{
+    if (blockSize == 0 || blockSize % PageSize != 0 || blockSize / PageSize >= UINT32_MAX)
+        throw std::runtime_error("HeapBlockPool: block size must be a multiple of 4 KB");
+
+    m_blockSize = blockSize;
+    m_usedBytes = 0;
+    m_blocks.clear();
+}
+
+HeapBlockPool::Allocation HeapBlockPool::Allocate(uint64_t size, uint64_t alignment, bool& newBlock)
+{
+    newBlock = false;
+    Allocation a;
+
+    if (alignment < PageSize) alignment = PageSize;
+    if (size == 0 || size > m_blockSize || alignment > m_blockSize || alignment % PageSize != 0)
+        return a;
+
+    const uint32_t pages = (uint32_t)((size + PageSize - 1) / PageSize);
+    const uint32_t alignPages = (uint32_t)(alignment / PageSize);
+
+    auto tryBlock = [&](uint32_t b) {
+        const uint32_t page = m_blocks[b].pages.Allocate(pages, alignPages);
+        if (page == OffsetAllocator::Invalid)
+            return false;
+        a.block = b;
+        a.offset = (uint64_t)page * PageSize;
+        a.size = (uint64_t)pages * PageSize;
+        return true;
+    };
+
+    for (uint32_t b = 0; b < (uint32_t)m_blocks.size(); ++b)
+        if (m_blocks[b].live && tryBlock(b))
+        {
+            m_usedBytes += a.size;
+            return a;
+        }
+
+    // новый блок: сначала занимаем освобождённый слот, чтобы индексы не росли
+    uint32_t b = 0;
+    while (b < m_blocks.size() && m_blocks[b].live) ++b;
+    if (b == m_blocks.size())
+        m_blocks.emplace_back();
+
+    m_blocks[b].pages.Init((uint32_t)(m_blockSize / PageSize));
+    m_blocks[b].live = true;
+    newBlock = true;
+
+    tryBlock(b);
+    m_usedBytes += a.size;
+    return a;
+}
+
+void HeapBlockPool::Free(const Allocation& allocation)
+{
+    if (allocation.block == Invalid)
+        return;
+    m_blocks[allocation.block].pages.Free((uint32_t)(allocation.offset / PageSize));
+    m_usedBytes -= allocation.size;
+}
+
+std::vector<uint32_t> HeapBlockPool::ReleaseEmptyBlocks()
+{
+    std::vector<uint32_t> released;
+    for (uint32_t b = 0; b < (uint32_t)m_blocks.size(); ++b)
+    {
+        if (m_blocks[b].live && m_blocks[b].pages.GetAllocationCount() == 0)
+        {
+            m_blocks[b].live = false;
+            released.push_back(b);
+        }
+    }
+    return released;
+}
+
+size_t HeapBlockPool::GetLiveBlockCount() const
+{
+    size_t n = 0;
+    for (const Block& b : m_blocks)
+        if (b.live) ++n;
+    return n;
+}
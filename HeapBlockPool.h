@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "OffsetAllocator.h"
+
+// Раскладка ресурсов по большим блокам-кучам одного вида (тип кучи + класс ресурса).
+// Считает в страницах по 4 КБ (минимальное выравнивание placed-ресурса), с устройством не работает:
+// GpuHeapAllocator создаёт ID3D12Heap, когда Allocate сообщает о новом блоке.
+class HeapBlockPool
+{
+public:
+    static const uint32_t Invalid = UINT32_MAX;
+    static const uint64_t PageSize = 4096;
+
+    struct Allocation
+    {
+        uint32_t block = Invalid;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    HeapBlockPool() = default;
+    explicit HeapBlockPool(uint64_t blockSize);
+
+    void Init(uint64_t blockSize);
+
+    // block == Invalid - ресурс больше блока, его надо создавать отдельно
+    Allocation Allocate(uint64_t size, uint64_t alignment, bool& newBlock);
+    void Free(const Allocation& allocation);
+
+    // пустые блоки помечаются свободными для повторного использования, возвращаются их индексы
+    std::vector<uint32_t> ReleaseEmptyBlocks();
+
+    uint64_t GetBlockSize() const { return m_blockSize; }
+    size_t GetLiveBlockCount() const;
+    uint64_t GetReservedBytes() const { return GetLiveBlockCount() * m_blockSize; }
+    uint64_t GetUsedBytes() const { return m_usedBytes; }
+
+private:
+    struct Block
+    {
+        OffsetAllocator pages;
+        bool live = false;
+    };
+
+    uint64_t m_blockSize = 0;
+    uint64_t m_usedBytes = 0;
+    std::vector<Block> m_blocks;
+};
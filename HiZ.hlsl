@@ -0,0 +1,30 @@
+// Пирамида максимумов глубины для отсечения мешлетов, один уровень за проход.
+// Размеры и покрытие как у BuildHiZPyramid (MeshletCulling.cpp): тексель x уровня берёт исходные
+// 2x и 2x + 1, последний в ряду - до конца нечётного источника.
+
+cbuffer HiZCB : register(b0)
+{
+    uint2 SrcSize;
+    uint2 DstSize;
+};
+
+Texture2D<float> gHiZSrc : register(t0);
+RWTexture2D<float> gHiZDst : register(u0);
+
+[numthreads(8, 8, 1)]
+void CS_BuildHiZ(uint3 id : SV_DispatchThreadID)
+{
+    if (id.x >= DstSize.x || id.y >= DstSize.y)
+        return;
+
+    uint2 first = id.xy * 2;
+    uint2 last = min(first + 1, SrcSize - 1);
+    if (id.x == DstSize.x - 1) last.x = SrcSize.x - 1;
+    if (id.y == DstSize.y - 1) last.y = SrcSize.y - 1;
+
+    float d = 0.0;
+    for (uint y = first.y; y <= last.y; ++y)
+        for (uint x = first.x; x <= last.x; ++x)
+            d = max(d, gHiZSrc.Load(int3(x, y, 0)));
+    gHiZDst[id.xy] = d;
+}
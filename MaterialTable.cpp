@@ -0,0 +1,55 @@
+#include "MaterialTable.h"
+#include <cstring>
+
+UINT MaterialTable::Add(const MaterialCB& material)
+{
+    for (size_t i = 0; i < m_materials.size(); ++i)
+    {
+        if (std::memcmp(&m_materials[i], &material, sizeof(MaterialCB)) == 0)
+            return static_cast<UINT>(i);
+    }
+
+    const UINT index = static_cast<UINT>(m_materials.size());
+    m_materials.push_back(material);
+    m_dirty.push_back(0);
+    MarkDirty(index);
+    return index;
+}
+
+MaterialCB& MaterialTable::Edit(UINT index)
+{
+    MarkDirty(index);
+    return m_materials[index];
+}
+
+void MaterialTable::MarkAllDirty()
+{
+    for (UINT i = 0; i < static_cast<UINT>(m_materials.size()); ++i)
+        MarkDirty(i);
+}
+
+void MaterialTable::MarkDirty(UINT index)
+{
+    if (m_dirty[index]) return;
+    m_dirty[index] = 1;
+    m_dirtyList.push_back(index);
+}
+
+size_t MaterialTable::Flush(uint8_t* mapped, UINT stride)
+{
+    const size_t count = m_dirtyList.size();
+    for (UINT index : m_dirtyList)
+    {
+        std::memcpy(mapped + static_cast<size_t>(index) * stride, &m_materials[index], sizeof(MaterialCB));
+        m_dirty[index] = 0;
+    }
+    m_dirtyList.clear();
+    return count;
+}
+
+void MaterialTable::Clear()
+{
+    m_materials.clear();
+    m_dirty.clear();
+    m_dirtyList.clear();
+}
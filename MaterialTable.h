@@ -0,0 +1,59 @@
+#pragma once
+#include <d3d12.h>
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MaterialCB
+{
+    float      useNormalMap;
+    UINT       diffuseIdx;
+    UINT       normalIdx;
+    UINT       dispIdx;
+
+    UINT       roughIdx;
+    UINT       metalIdx;
+    UINT       aoIdx;
+    UINT       hasDiffuseMap;
+
+    DirectX::XMFLOAT4 baseColor;
+
+    UINT       useRoughMap;
+    UINT       useMetalMap;
+    UINT       useAOMap;
+    UINT       hasRoughMap;
+
+    UINT       hasMetalMap;
+    UINT       hasAOMap;
+    UINT       _padM0;
+    UINT       _padM1;
+};
+
+// Постоянная таблица материалов: по одной записи на уникальный материал, а не на объект.
+// В upload-буфер уходят только изменённые записи (Flush), объект хранит лишь индекс.
+class MaterialTable
+{
+public:
+    // одинаковые по байтам материалы получают один индекс
+    UINT Add(const MaterialCB& material);
+
+    const MaterialCB& Get(UINT index) const { return m_materials[index]; }
+    MaterialCB& Edit(UINT index);
+    void MarkAllDirty();
+
+    // копирует грязные записи в mapped + index * stride, возвращает их число
+    size_t Flush(uint8_t* mapped, UINT stride);
+
+    void Clear();
+
+    size_t Size() const { return m_materials.size(); }
+    size_t DirtyCount() const { return m_dirtyList.size(); }
+
+private:
+    void MarkDirty(UINT index);
+
+    std::vector<MaterialCB> m_materials;
+    std::vector<uint8_t> m_dirty;
+    std::vector<UINT> m_dirtyList;
+};
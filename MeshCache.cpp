@@ -0,0 +1,266 @@
+#include "MeshCache.h"
+#include "SceneObject.h"
+#include "ObjImport.h"
+#include "MeshletBuilder.h"
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    bool IsAligned(uint64_t offset) { return offset % MeshCacheAlignment == 0; }
+}
+
+MeshCache::MeshCache(const std::wstring& directory)
+    : m_directory(directory)
+{
+}
+
+MeshCache::~MeshCache()
+{
+    Close();
+}
+
+bool MeshCache::Open(const std::wstring& path, uint64_t sourceHash)
+{
+    Close();
+
+    m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart < (LONGLONG)sizeof(MeshCacheHeader))
+    {
+        Close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping)
+        m_base = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = (uint64_t)size.QuadPart;
+
+    if (!m_base || Header().sourceHash != sourceHash || !Validate())
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MeshCache::Close()
+{
+    if (m_base)
+        UnmapViewOfFile(m_base);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+
+    m_base = nullptr;
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+    m_size = 0;
+}
+
+bool MeshCache::Validate() const
+{
+    const MeshCacheHeader& h = Header();
+    if (h.magic != MeshCacheMagic || h.version != MeshCacheVersion || h.fileSize != m_size ||
+        h.meshletMaxVerts != MeshCacheMeshletMaxVerts || h.meshletMaxPrims != MeshCacheMeshletMaxPrims)
+        return false;
+
+    auto InRange = [&](uint64_t offset, uint64_t count, uint64_t stride)
+    {
+        if (!IsAligned(offset) || offset > m_size)
+            return false;
+        return count <= (m_size - offset) / stride;
+    };
+
+    if (!InRange(h.objectsOffset, h.objectCount, sizeof(MeshCacheObject)) ||
+        !InRange(h.lodsOffset, h.lodCount, sizeof(MeshCacheLod)) ||
+        !InRange(h.distancesOffset, h.distanceCount, sizeof(float)) ||
+        !InRange(h.stringsOffset, h.stringsSize, 1) ||
+        h.stringsSize == 0 || m_base[h.stringsOffset + h.stringsSize - 1] != 0)
+        return false;
+
+    for (uint32_t i = 0; i < h.objectCount; ++i)
+    {
+        const MeshCacheObject& o = Objects()[i];
+        if (o.firstLod > h.lodCount || o.lodCount > h.lodCount - o.firstLod)
+            return false;
+        for (uint32_t t : o.texPaths)
+            if (t >= h.stringsSize)
+                return false;
+    }
+
+    for (uint32_t i = 0; i < h.lodCount; ++i)
+    {
+        const MeshCacheLod& l = Lods()[i];
+        const uint64_t meshletWords = (uint64_t)l.meshletCount * (MeshletBoundsWords + MeshletWords) +
+            l.meshletVertexCount + l.meshletPrimCount;
+        if (!InRange(l.verticesOffset, l.vertexCount, sizeof(Vertex)) ||
+            !InRange(l.positionsOffset, l.vertexCount, sizeof(XMFLOAT3)) ||
+            !InRange(l.indicesOffset, l.indexCount, sizeof(uint32_t)) ||
+            !InRange(l.meshletsOffset, meshletWords, sizeof(uint32_t)))
+            return false;
+    }
+    return true;
+}
+
+uint32_t MeshCache::GetObjectCount() const
+{
+    return IsOpen() ? Header().objectCount : 0;
+}
+
+uint32_t MeshCache::GetLodCount(uint32_t object) const
+{
+    return Objects()[object].lodCount;
+}
+
+MeshCacheLodView MeshCache::GetLod(uint32_t object, uint32_t lod) const
+{
+    const MeshCacheLod& l = Lods()[Objects()[object].firstLod + lod];
+
+    MeshCacheLodView v;
+    v.vertices = reinterpret_cast<const Vertex*>(m_base + l.verticesOffset);
+    v.positions = reinterpret_cast<const XMFLOAT3*>(m_base + l.positionsOffset);
+    v.indices = reinterpret_cast<const uint32_t*>(m_base + l.indicesOffset);
+    v.meshletBlob = reinterpret_cast<const uint32_t*>(m_base + l.meshletsOffset);
+    v.vertexCount = l.vertexCount;
+    v.indexCount = l.indexCount;
+    v.meshletCount = l.meshletCount;
+    v.meshletVertexCount = l.meshletVertexCount;
+    v.meshletPrimCount = l.meshletPrimCount;
+    v.meshletBlobWords = MeshletBlobInfo{ l.meshletCount, l.meshletVertexCount, l.meshletPrimCount }.Words();
+    return v;
+}
+
+const char* MeshCache::String(uint32_t offset) const
+{
+    return reinterpret_cast<const char*>(m_base + Header().stringsOffset + offset);
+}
+
+void MeshCache::FillSceneObjects(std::vector<SceneObject>& out, const LodChainSettings& lods) const
+{
+    out.clear();
+    if (!IsOpen())
+        return;
+
+    const MeshCacheHeader& h = Header();
+    const float* distances = reinterpret_cast<const float*>(m_base + h.distancesOffset);
+    out.reserve(h.objectCount);
+
+    for (uint32_t i = 0; i < h.objectCount; ++i)
+    {
+        const MeshCacheObject& o = Objects()[i];
+
+        SceneObject obj(
+            Mesh(),
+            { 0.0f,0.0f,0.0f },
+            { 0.0f,0.0f,0.0f },
+            { 1.0f,1.0f,1.0f }
+        );
+
+        obj.lodMeshes.resize(o.lodCount);
+        std::vector<float> lodErrors;
+        for (uint32_t k = 0; k < o.lodCount; ++k)
+        {
+            const MeshCacheLodView v = GetLod(i, k);
+            obj.lodMeshes[k].vertices.assign(v.vertices, v.vertices + v.vertexCount);
+            obj.lodMeshes[k].indices.assign(v.indices, v.indices + v.indexCount);
+            if (Lods()[o.firstLod + k].distance >= 0.0f)
+                lodErrors.push_back(Lods()[o.firstLod + k].error);
+        }
+        if (!obj.lodMeshes.empty())
+            obj.mesh = obj.lodMeshes[0];
+        // сгенерированная цепочка несёт свои дистанции, как в AssetLoader::MakeSceneObjects;
+        // пересчёт из ошибок, чтобы кэш кукера подходил к любому экрану
+        if (lodErrors.size() == o.lodCount && o.lodCount > 1)
+            obj.lodDistances = LodDistancesFromErrors(lodErrors, lods);
+        else if (h.distanceCount)
+            obj.lodDistances.assign(distances, distances + h.distanceCount);
+
+        Material& m = obj.material;
+        m.ambient = { o.ambient[0], o.ambient[1], o.ambient[2] };
+        m.diffuse = { o.diffuse[0], o.diffuse[1], o.diffuse[2] };
+        m.specular = { o.specular[0], o.specular[1], o.specular[2] };
+        m.roughness = o.roughness;
+        m.metallic = o.metallic;
+        m.ao = o.ao;
+        m.shininess = o.shininess;
+        m.diffuseTexPath = String(o.texPaths[0]);
+        m.normalTexPath = String(o.texPaths[1]);
+        m.displacementTexPath = String(o.texPaths[2]);
+        m.roughnessTexPath = String(o.texPaths[3]);
+        m.metallicTexPath = String(o.texPaths[4]);
+        m.aoTexPath = String(o.texPaths[5]);
+
+        obj.bsCenter = { o.sphereCenter[0], o.sphereCenter[1], o.sphereCenter[2] };
+        obj.bsRadius = o.sphereRadius;
+
+        out.push_back(std::move(obj));
+    }
+}
+
+MeshCacheBenchmarkResult RunMeshCacheBenchmark(const std::vector<std::string>& objPaths,
+    const std::vector<float>& distances, const LodChainSettings& lods, const std::wstring& directory)
+{
+    MeshCacheBenchmarkResult r;
+
+    // холодная загрузка - то, что делал старт без кэша: разбор OBJ, генерация LOD и мешлеты для каждого LOD
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ImportedObject> cold = ImportScene(objPaths, lods);
+    std::vector<std::vector<uint32_t>> blobs;
+    for (const ImportedObject& obj : cold)
+    {
+        for (const Mesh& mesh : obj.lodMeshes)
+        {
+            blobs.emplace_back();
+            if (!mesh.indices.empty())
+                BuildMeshletBlob(mesh, MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims, blobs.back());
+        }
+    }
+    r.coldMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    MeshCache cache(directory);
+    const std::wstring path = cache.PathForSources(objPaths);
+    if (!WriteMeshCache(path, HashMeshSources(objPaths, distances, lods), cold, distances))
+        return r;
+
+    // хэш исходников входит в замер: без него нельзя доверять кэшу
+    start = std::chrono::steady_clock::now();
+    std::vector<SceneObject> cached;
+    if (cache.Open(path, HashMeshSources(objPaths, distances, lods)))
+        cache.FillSceneObjects(cached, lods);
+    r.cachedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    r.objects = (uint32_t)cached.size();
+    r.fileBytes = cache.GetFileSize();
+
+    r.matches = cache.IsOpen() && cached.size() == cold.size();
+    size_t blobIndex = 0;
+    for (uint32_t i = 0; r.matches && i < (uint32_t)cold.size(); ++i)
+    {
+        const ImportedObject& a = cold[i];
+        const SceneObject& b = cached[i];
+        if (a.lodMeshes.size() != b.lodMeshes.size())
+        {
+            r.matches = false;
+            break;
+        }
+        for (uint32_t k = 0; r.matches && k < (uint32_t)a.lodMeshes.size(); ++k)
+        {
+            const Mesh& ma = a.lodMeshes[k];
+            const Mesh& mb = b.lodMeshes[k];
+            const MeshCacheLodView v = cache.GetLod(i, k);
+            const std::vector<uint32_t>& blob = blobs[blobIndex++];
+
+            r.matches = ma.vertices.size() == mb.vertices.size() && ma.indices == mb.indices &&
+                memcmp(ma.vertices.data(), mb.vertices.data(), ma.vertices.size() * sizeof(Vertex)) == 0 &&
+                blob.size() == v.meshletBlobWords &&
+                memcmp(blob.data(), v.meshletBlob, blob.size() * sizeof(uint32_t)) == 0;
+        }
+    }
+    return r;
+}
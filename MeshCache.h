@@ -0,0 +1,88 @@
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Vertexes.h"
+#include "MeshCacheFormat.h"
+
+struct SceneObject;
+
+struct MeshCacheLodView
+{
+    const Vertex* vertices = nullptr;
+    const XMFLOAT3* positions = nullptr;
+    const uint32_t* indices = nullptr;
+    const uint32_t* meshletBlob = nullptr;
+
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t meshletCount = 0;
+    uint32_t meshletVertexCount = 0;
+    uint32_t meshletPrimCount = 0;
+    uint32_t meshletBlobWords = 0;
+};
+
+// Кэш сцены, отображённый в память целиком (формат в MeshCacheFormat.h).
+// Массивы читаются прямо из файла, без разбора и промежуточных копий.
+class MeshCache
+{
+public:
+    explicit MeshCache(const std::wstring& directory = L"MeshCache");
+    ~MeshCache();
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    std::wstring PathForSources(const std::vector<std::string>& objPaths) const { return MeshCachePathForSources(m_directory, objPaths); }
+    const std::wstring& GetDirectory() const { return m_directory; }
+
+    // false - файла нет, он битый, другой версии или собран из других исходников
+    bool Open(const std::wstring& path, uint64_t sourceHash);
+    void Close();
+    bool IsOpen() const { return m_base != nullptr; }
+
+    uint32_t GetObjectCount() const;
+    uint32_t GetLodCount(uint32_t object) const;
+    MeshCacheLodView GetLod(uint32_t object, uint32_t lod) const;
+    uint64_t GetFileSize() const { return m_size; }
+
+    // те же SceneObject, что вернул бы AssetLoader::LoadSceneObjectsLODs; дистанции сгенерированных
+    // цепочек - из ошибок LOD по экрану из lods
+    void FillSceneObjects(std::vector<SceneObject>& out, const LodChainSettings& lods) const;
+
+    size_t GetHits() const { return m_hits; }
+    size_t GetMisses() const { return m_misses; }
+    void CountHit() { ++m_hits; }
+    void CountMiss() { ++m_misses; }
+
+private:
+    bool Validate() const;
+    const MeshCacheHeader& Header() const { return *reinterpret_cast<const MeshCacheHeader*>(m_base); }
+    const MeshCacheObject* Objects() const { return reinterpret_cast<const MeshCacheObject*>(m_base + Header().objectsOffset); }
+    const MeshCacheLod* Lods() const { return reinterpret_cast<const MeshCacheLod*>(m_base + Header().lodsOffset); }
+    const char* String(uint32_t offset) const;
+
+    std::wstring m_directory;
+
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+    const uint8_t* m_base = nullptr;
+    uint64_t m_size = 0;
+
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+};
+
+struct MeshCacheBenchmarkResult
+{
+    uint32_t objects = 0;
+    uint64_t fileBytes = 0;
+    double coldMs = 0.0;    // импорт OBJ (tinyobj, сварка, касательные) и мешлеты
+    double cachedMs = 0.0;  // отображение файла и SceneObject из него
+    bool matches = false;   // вершины, индексы и мешлеты совпали
+};
+
+// перезаписывает кэш для objPaths в directory
+MeshCacheBenchmarkResult RunMeshCacheBenchmark(const std::vector<std::string>& objPaths,
+    const std::vector<float>& distances, const LodChainSettings& lods, const std::wstring& directory = L"MeshCache");
@@ -0,0 +1,311 @@
+#include "MeshCacheFormat.h"
+#include "ObjImport.h"
+#include "MeshletBuilder.h"
+#include "ShaderCache.h"
+#include "VertexStreams.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <cwchar>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    uint64_t AlignUp(uint64_t v) { return (v + MeshCacheAlignment - 1) & ~(MeshCacheAlignment - 1); }
+
+    bool ReadWholeFile(const fs::path& path, std::string& out)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    uint64_t HashFileContents(const fs::path& path, const std::string& text, bool found, uint64_t h)
+    {
+        const std::string name = path.generic_string();
+        h = ShaderCache::HashBytes(name.data(), name.size() + 1, h);
+        if (!found)
+            return ShaderCache::HashBytes("<missing>", 9, h);
+        return ShaderCache::HashBytes(text.data(), text.size(), h);
+    }
+
+    // OBJ и все MTL из его строк mtllib (имена через пробел, относительно каталога OBJ)
+    uint64_t HashObjWithMaterials(const fs::path& objPath, uint64_t h)
+    {
+        std::string text;
+        const bool found = ReadWholeFile(objPath, text);
+        h = HashFileContents(objPath, text, found, h);
+
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            size_t end = text.find('\n', pos);
+            if (end == std::string::npos)
+                end = text.size();
+
+            size_t p = text.find_first_not_of(" \t", pos);
+            if (p != std::string::npos && p < end && text.compare(p, 6, "mtllib") == 0 &&
+                p + 6 < end && (text[p + 6] == ' ' || text[p + 6] == '\t'))
+            {
+                p += 6;
+                while (p < end)
+                {
+                    p = text.find_first_not_of(" \t\r", p);
+                    if (p == std::string::npos || p >= end)
+                        break;
+                    size_t q = text.find_first_of(" \t\r\n", p);
+                    if (q == std::string::npos || q > end)
+                        q = end;
+
+                    const fs::path mtlPath = objPath.parent_path() / text.substr(p, q - p);
+                    std::string mtl;
+                    const bool mtlFound = ReadWholeFile(mtlPath, mtl);
+                    h = HashFileContents(mtlPath, mtl, mtlFound, h);
+                    p = q;
+                }
+            }
+            pos = end + 1;
+        }
+        return h;
+    }
+
+    uint64_t Append(std::vector<uint8_t>& file, const void* data, uint64_t size)
+    {
+        const uint64_t offset = AlignUp(file.size());
+        file.resize((size_t)(offset + size));
+        if (size)
+            memcpy(file.data() + offset, data, (size_t)size);
+        return offset;
+    }
+
+    void ComputeBounds(const std::vector<Vertex>& vertices, MeshCacheObject& o)
+    {
+        XMFLOAT3 mn = { FLT_MAX, FLT_MAX, FLT_MAX };
+        XMFLOAT3 mx = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (const Vertex& v : vertices)
+        {
+            mn.x = (std::min)(mn.x, v.Pos.x); mx.x = (std::max)(mx.x, v.Pos.x);
+            mn.y = (std::min)(mn.y, v.Pos.y); mx.y = (std::max)(mx.y, v.Pos.y);
+            mn.z = (std::min)(mn.z, v.Pos.z); mx.z = (std::max)(mx.z, v.Pos.z);
+        }
+        if (vertices.empty())
+            mn = mx = { 0.0f, 0.0f, 0.0f };
+
+        o.boundsMin[0] = mn.x; o.boundsMin[1] = mn.y; o.boundsMin[2] = mn.z;
+        o.boundsMax[0] = mx.x; o.boundsMax[1] = mx.y; o.boundsMax[2] = mx.z;
+
+        // как в SceneObject::CreateBuffers: центр AABB и половина диагонали
+        const float hx = 0.5f * (mx.x - mn.x), hy = 0.5f * (mx.y - mn.y), hz = 0.5f * (mx.z - mn.z);
+        o.sphereCenter[0] = 0.5f * (mn.x + mx.x);
+        o.sphereCenter[1] = 0.5f * (mn.y + mx.y);
+        o.sphereCenter[2] = 0.5f * (mn.z + mx.z);
+        o.sphereRadius = std::sqrt(hx * hx + hy * hy + hz * hz);
+    }
+}
+
+uint64_t HashMeshSources(const std::vector<std::string>& objPaths, const std::vector<float>& distances,
+    const LodChainSettings& lods)
+{
+    const uint32_t format[3] = { MeshCacheVersion, MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims };
+    uint64_t h = ShaderCache::HashBytes(format, sizeof(format));
+
+    const uint32_t distanceCount = (uint32_t)distances.size();
+    h = ShaderCache::HashBytes(&distanceCount, sizeof(distanceCount), h);
+    h = ShaderCache::HashBytes(distances.data(), distances.size() * sizeof(float), h);
+
+    // LOD генерируются только для сцены из одного файла. pixelError, screenHeight и fovY влияют лишь
+    // на дистанции включения, а их FillSceneObjects считает из ошибок LOD при загрузке
+    if (objPaths.size() == 1)
+    {
+        const uint32_t ratioCount = (uint32_t)lods.triangleRatios.size();
+        const float params[4] =
+        {
+            lods.simplify.maxError, lods.simplify.normalWeight, lods.simplify.uvWeight,
+            lods.simplify.lockBorders ? 1.0f : 0.0f,
+        };
+        h = ShaderCache::HashBytes(&ratioCount, sizeof(ratioCount), h);
+        h = ShaderCache::HashBytes(lods.triangleRatios.data(), lods.triangleRatios.size() * sizeof(float), h);
+        h = ShaderCache::HashBytes(params, sizeof(params), h);
+    }
+
+    for (const std::string& p : objPaths)
+        h = HashObjWithMaterials(fs::path(p), h);
+    return h;
+}
+
+std::wstring MeshCachePathForSources(const std::wstring& directory, const std::vector<std::string>& objPaths)
+{
+    uint64_t h = ShaderCache::HashBytes("", 0);
+    for (const std::string& p : objPaths)
+        h = ShaderCache::HashBytes(p.c_str(), p.size() + 1, h);
+
+    wchar_t name[32];
+    swprintf(name, 32, L"%016llx.mesh", (unsigned long long)h);
+    return (fs::path(directory) / name).wstring();
+}
+
+bool WriteMeshCache(const std::wstring& path, uint64_t sourceHash,
+    const std::vector<ImportedObject>& objects, const std::vector<float>& distances)
+{
+    std::vector<uint8_t> strings(1, 0);
+    auto AddString = [&](const std::string& s) -> uint32_t
+    {
+        if (s.empty())
+            return 0;
+        const uint32_t offset = (uint32_t)strings.size();
+        strings.insert(strings.end(), s.begin(), s.end());
+        strings.push_back(0);
+        return offset;
+    };
+
+    std::vector<MeshCacheObject> records(objects.size());
+    uint32_t lodCount = 0;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        const ImportedObject& obj = objects[i];
+        const Material& m = obj.material;
+        MeshCacheObject& o = records[i];
+        memset(&o, 0, sizeof(o));
+
+        memcpy(o.ambient, &m.ambient, sizeof(o.ambient));
+        memcpy(o.diffuse, &m.diffuse, sizeof(o.diffuse));
+        memcpy(o.specular, &m.specular, sizeof(o.specular));
+        o.roughness = m.roughness;
+        o.metallic = m.metallic;
+        o.ao = m.ao;
+        o.shininess = m.shininess;
+
+        o.texPaths[0] = AddString(m.diffuseTexPath);
+        o.texPaths[1] = AddString(m.normalTexPath);
+        o.texPaths[2] = AddString(m.displacementTexPath);
+        o.texPaths[3] = AddString(m.roughnessTexPath);
+        o.texPaths[4] = AddString(m.metallicTexPath);
+        o.texPaths[5] = AddString(m.aoTexPath);
+
+        o.firstLod = lodCount;
+        o.lodCount = (uint32_t)obj.lodMeshes.size();
+        lodCount += o.lodCount;
+
+        ComputeBounds(obj.lodMeshes[0].vertices, o);
+    }
+
+    MeshCacheHeader header{};
+    header.magic = MeshCacheMagic;
+    header.version = MeshCacheVersion;
+    header.sourceHash = sourceHash;
+    header.objectCount = (uint32_t)objects.size();
+    header.lodCount = lodCount;
+    header.distanceCount = (uint32_t)distances.size();
+    header.meshletMaxVerts = MeshCacheMeshletMaxVerts;
+    header.meshletMaxPrims = MeshCacheMeshletMaxPrims;
+    header.stringsSize = (uint32_t)strings.size();
+
+    // таблицы в начале файла, массивы за ними
+    header.objectsOffset = AlignUp(sizeof(MeshCacheHeader));
+    header.lodsOffset = AlignUp(header.objectsOffset + records.size() * sizeof(MeshCacheObject));
+    header.distancesOffset = AlignUp(header.lodsOffset + (uint64_t)lodCount * sizeof(MeshCacheLod));
+    header.stringsOffset = AlignUp(header.distancesOffset + distances.size() * sizeof(float));
+
+    std::vector<uint8_t> file((size_t)(header.stringsOffset + strings.size()));
+    memcpy(file.data() + header.stringsOffset, strings.data(), strings.size());
+
+    std::vector<MeshCacheLod> lods;
+    lods.reserve(lodCount);
+    std::vector<uint32_t> blob;
+    for (const ImportedObject& obj : objects)
+    {
+        for (size_t k = 0; k < obj.lodMeshes.size(); ++k)
+        {
+            const Mesh& mesh = obj.lodMeshes[k];
+            MeshCacheLod l{};
+            l.error = k < obj.lodErrors.size() ? obj.lodErrors[k] : 0.0f;
+            l.distance = k < obj.lodDistances.size() ? obj.lodDistances[k] : -1.0f;
+            l.vertexCount = (uint32_t)mesh.vertices.size();
+            l.indexCount = (uint32_t)mesh.indices.size();
+
+            const std::vector<XMFLOAT3> positions = ExtractPositionStream(mesh.vertices);
+            l.verticesOffset = Append(file, mesh.vertices.data(), (uint64_t)l.vertexCount * sizeof(Vertex));
+            l.positionsOffset = Append(file, positions.data(), (uint64_t)l.vertexCount * sizeof(XMFLOAT3));
+            l.indicesOffset = Append(file, mesh.indices.data(), (uint64_t)l.indexCount * sizeof(uint32_t));
+
+            blob.clear();
+            if (!mesh.indices.empty())
+            {
+                const MeshletBlobInfo info = BuildMeshletBlob(mesh, MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims, blob);
+                l.meshletCount = info.meshletCount;
+                l.meshletVertexCount = info.vertexCount;
+                l.meshletPrimCount = info.primCount;
+            }
+            l.meshletsOffset = Append(file, blob.data(), (uint64_t)blob.size() * sizeof(uint32_t));
+
+            lods.push_back(l);
+        }
+    }
+
+    header.fileSize = file.size();
+    memcpy(file.data(), &header, sizeof(header));
+    if (!records.empty())
+        memcpy(file.data() + header.objectsOffset, records.data(), records.size() * sizeof(MeshCacheObject));
+    if (!lods.empty())
+        memcpy(file.data() + header.lodsOffset, lods.data(), lods.size() * sizeof(MeshCacheLod));
+    if (!distances.empty())
+        memcpy(file.data() + header.distancesOffset, distances.data(), distances.size() * sizeof(float));
+
+    // пишем во временный файл и переименовываем, чтобы не оставить обрезанный кэш
+    std::error_code ec;
+    fs::path finalPath(path);
+    fs::create_directories(finalPath.parent_path(), ec);
+    fs::path tmpPath = finalPath;
+    tmpPath += L".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(reinterpret_cast<const char*>(file.data()), (std::streamsize)file.size());
+        if (!out)
+            return false;
+    }
+    fs::rename(tmpPath, finalPath, ec);
+    if (ec)
+    {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool ReadMeshCacheInfo(const std::wstring& path, MeshCacheInfo& out)
+{
+    std::ifstream in(fs::path(path), std::ios::binary);
+    MeshCacheHeader header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (header.magic != MeshCacheMagic || header.version != MeshCacheVersion || header.stringsSize == 0)
+        return false;
+
+    std::string strings(header.stringsSize, '\0');
+    if (!in.seekg((std::streamoff)header.stringsOffset) || !in.read(&strings[0], strings.size()) || strings.back() != 0)
+        return false;
+
+    out.sourceHash = header.sourceHash;
+    out.texturePaths.clear();
+    for (size_t pos = 1; pos < strings.size(); pos = strings.find('\0', pos) + 1)
+        out.texturePaths.push_back(strings.c_str() + pos);
+    return true;
+}
+
+std::wstring CookedTexturePath(const std::wstring& directory, const std::wstring& source)
+{
+    const std::string key = fs::path(source).lexically_normal().generic_string();
+    const uint64_t h = ShaderCache::HashBytes(key.data(), key.size());
+
+    wchar_t name[32];
+    swprintf(name, 32, L"%016llx.dds", (unsigned long long)h);
+    return (fs::path(directory) / L"Textures" / name).wstring();
+}
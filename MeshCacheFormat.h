@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ImportedObject;
+struct LodChainSettings;
+
+// Формат бинарного кэша сцены, собранной из OBJ/MTL: готовые вершины и индексы по материалам, LOD-цепочки,
+// bounds и мешлеты в раскладке GeometryArena. Все массивы выровнены на 16 байт, чтобы читать их
+// прямо из отображённого в память файла. Пишут его рантайм (MeshCache) и офлайн-кукер (AssetCooker).
+//
+// [MeshCacheHeader][MeshCacheObject x objectCount][MeshCacheLod x lodCount][float x distanceCount][строки][массивы]
+struct MeshCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t fileSize;
+
+    uint32_t objectCount;
+    uint32_t lodCount;
+    uint32_t distanceCount;
+    uint32_t meshletMaxVerts;
+    uint32_t meshletMaxPrims;
+    uint32_t stringsSize;
+
+    uint64_t objectsOffset;
+    uint64_t lodsOffset;
+    uint64_t distancesOffset;
+    uint64_t stringsOffset;
+};
+
+// один сабмеш (материал) сцены
+struct MeshCacheObject
+{
+    float ambient[3];
+    float diffuse[3];
+    float specular[3];
+    float roughness;
+    float metallic;
+    float ao;
+    float shininess;
+
+    // смещения в таблице строк, 0 - пустая строка; порядок как у SceneObject::texIdx
+    uint32_t texPaths[6];
+
+    uint32_t firstLod;
+    uint32_t lodCount;
+
+    // по LOD 0
+    float boundsMin[3];
+    float boundsMax[3];
+    float sphereCenter[3];
+    float sphereRadius;
+};
+
+struct MeshCacheLod
+{
+    uint64_t verticesOffset;    // Vertex
+    uint64_t positionsOffset;   // XMFLOAT3, поток позиций для арены
+    uint64_t indicesOffset;     // uint32
+    uint64_t meshletsOffset;    // [MeshletBounds x N][Meshlet x N][meshletVertices][meshletPrims]
+
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t meshletCount;
+    uint32_t meshletVertexCount;
+    uint32_t meshletPrimCount;
+    float error;                // относительно LOD 0, в единицах меша; 0 - LOD из файла
+    float distance;             // < 0 - дистанции из заголовка, иначе цепочка сгенерирована и дистанции
+                                // считаются при загрузке из error под текущий экран
+};
+
+static const uint32_t MeshCacheMagic = 0x4843534D; // "MSCH"
+static const uint32_t MeshCacheVersion = 4;
+static const uint32_t MeshCacheMeshletMaxVerts = 64;
+static const uint32_t MeshCacheMeshletMaxPrims = 126;
+static const uint64_t MeshCacheAlignment = 16;
+
+// содержимое всех OBJ и подключённых через mtllib MTL, дистанции LOD, параметры упрощения и формата.
+// От экрана (LodChainSettings::pixelError, screenHeight, fovY) ключ не зависит
+uint64_t HashMeshSources(const std::vector<std::string>& objPaths, const std::vector<float>& distances,
+    const LodChainSettings& lods);
+// имя файла зависит только от списка путей: при смене исходников файл перезаписывается
+std::wstring MeshCachePathForSources(const std::wstring& directory, const std::vector<std::string>& objPaths);
+
+// мешлеты строятся здесь же; пишет во временный файл и переименовывает
+bool WriteMeshCache(const std::wstring& path, uint64_t sourceHash,
+    const std::vector<ImportedObject>& objects, const std::vector<float>& distances);
+struct MeshCacheInfo
+{
+    uint64_t sourceHash = 0;
+    std::vector<std::string> texturePaths;
+};
+
+// только заголовок и таблица строк; false - файла нет или это не кэш текущей версии
+bool ReadMeshCacheInfo(const std::wstring& path, MeshCacheInfo& out);
+
+// готовая DDS с мипами для текстуры source (кукер пишет, LoadTextures берёт, если она не старше исходника)
+std::wstring CookedTexturePath(const std::wstring& directory, const std::wstring& source);
@@ -0,0 +1,352 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    const uint32_t kNoVertex = UINT32_MAX;
+    const size_t kFetchLineBytes = 64;
+    const size_t kFetchLines = 256;
+
+    // треугольники каждой вершины подряд: triangles[offsets[v]..offsets[v + 1])
+    struct TriangleAdjacency
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        TriangleAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount)
+            : offsets(vertexCount + 1, 0), triangles(indices.size())
+        {
+            for (uint32_t i : indices)
+                ++offsets[i + 1];
+            for (size_t v = 0; v < vertexCount; ++v)
+                offsets[v + 1] += offsets[v];
+
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+                triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+    };
+
+    // FIFO на метках времени: вершина в кэше, пока после неё было не больше size промахов
+    struct FifoCache
+    {
+        std::vector<uint32_t> stamps;
+        uint32_t time;
+        uint32_t size;
+
+        FifoCache(size_t vertexCount, uint32_t cacheSize)
+            : stamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize)
+        {
+        }
+
+        bool InCache(uint32_t v) const { return time - stamps[v] <= size; }
+
+        // true - промах
+        bool Touch(uint32_t v)
+        {
+            if (InCache(v))
+                return false;
+            stamps[v] = time++;
+            return true;
+        }
+
+        void Flush() { time += size + 1; }
+    };
+
+    XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+    size_t vertexStride, uint32_t cacheSize)
+{
+    VertexCacheStats s;
+    s.triangles = indices.size() / 3;
+    s.vertices = vertexCount;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<uint64_t> lines(kFetchLines, UINT64_MAX);
+
+    for (uint32_t i : indices)
+    {
+        if (!cache.Touch(i))
+            continue;
+        ++s.transformed;
+
+        // вершина может лежать на двух строках
+        const uint64_t first = (uint64_t)i * vertexStride / kFetchLineBytes;
+        const uint64_t last = ((uint64_t)i * vertexStride + vertexStride - 1) / kFetchLineBytes;
+        for (uint64_t line = first; line <= last; ++line)
+        {
+            uint64_t& tag = lines[line % kFetchLines];
+            if (tag != line)
+            {
+                tag = line;
+                s.fetchedBytes += kFetchLineBytes;
+            }
+        }
+    }
+    return s;
+}
+
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+    uint32_t cacheSize, std::vector<uint32_t>* outClusters)
+{
+    if (indices.size() % 3 != 0) throw std::runtime_error("indices must be triangle list");
+
+    const size_t triCount = indices.size() / 3;
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    if (outClusters)
+        outClusters->clear();
+    if (triCount == 0)
+        return out;
+
+    const TriangleAdjacency adj(indices, vertexCount);
+
+    // live - сколько треугольников вершины ещё не выведено
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        live[v] = adj.offsets[v + 1] - adj.offsets[v];
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<uint8_t> emitted(triCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    deadEnd.reserve(indices.size());
+    uint32_t cursor = 0;
+
+    // тупик: сначала недавно выведенные вершины, потом первая по номеру с живыми треугольниками
+    auto SkipDeadEnd = [&]()
+    {
+        while (!deadEnd.empty())
+        {
+            const uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0)
+                return v;
+        }
+        for (; cursor < vertexCount; ++cursor)
+        {
+            if (live[cursor] > 0)
+                return cursor;
+        }
+        return kNoVertex;
+    };
+
+    uint32_t fanning = SkipDeadEnd();
+    bool jumped = true;
+    while (fanning != kNoVertex)
+    {
+        if (jumped && outClusters)
+            outClusters->push_back((uint32_t)(out.size() / 3));
+
+        // веер вокруг fanning целиком
+        candidates.clear();
+        for (uint32_t k = adj.offsets[fanning]; k < adj.offsets[fanning + 1]; ++k)
+        {
+            const uint32_t t = adj.triangles[k];
+            if (emitted[t])
+                continue;
+            emitted[t] = 1;
+
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const uint32_t v = indices[t * 3 + c];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                cache.Touch(v);
+            }
+        }
+
+        // следующей берётся вершина, которая ещё будет в кэше после своего веера, и самая старая из таких
+        uint32_t best = kNoVertex;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (live[v] == 0)
+                continue;
+            int64_t priority = 0;
+            const uint32_t age = cache.time - cache.stamps[v];
+            if (age + 2 * live[v] <= cacheSize)
+                priority = age;
+            if (priority > bestPriority)
+            {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+
+        jumped = best == kNoVertex;
+        fanning = jumped ? SkipDeadEnd() : best;
+    }
+    return out;
+}
+
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+    const XMFLOAT3* positions, size_t positionStride, size_t vertexCount, float threshold, uint32_t cacheSize)
+{
+    if (indices.size() % 3 != 0) throw std::runtime_error("indices must be triangle list");
+
+    const uint32_t triCount = (uint32_t)(indices.size() / 3);
+    if (triCount == 0 || clusters.empty())
+        return indices;
+
+    auto Position = [&](uint32_t v) -> const XMFLOAT3&
+    {
+        return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+    };
+
+    // мягкие границы: кусок кластера закрывается, как только его ACMR дошёл до threshold * ACMR кластера
+    FifoCache cache(vertexCount, cacheSize);
+    auto Misses = [&](uint32_t t)
+    {
+        uint32_t m = 0;
+        for (uint32_t c = 0; c < 3; ++c)
+            m += cache.Touch(indices[t * 3 + c]);
+        return m;
+    };
+
+    std::vector<uint32_t> starts;
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        const uint32_t begin = clusters[c];
+        const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triCount;
+
+        cache.Flush();
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; ++t)
+            clusterMisses += Misses(t);
+        const float limit = threshold * clusterMisses / (end - begin);
+
+        cache.Flush();
+        starts.push_back(begin);
+        uint32_t misses = 0;
+        for (uint32_t t = begin; t + 1 < end; ++t)
+        {
+            misses += Misses(t);
+            if (misses <= limit * (t + 1 - starts.back()))
+            {
+                starts.push_back(t + 1);
+                misses = 0;
+                cache.Flush();
+            }
+        }
+    }
+
+    struct Piece
+    {
+        uint32_t begin, end;
+        XMFLOAT3 centroid;  // взвешен площадью
+        XMFLOAT3 normal;    // сумма нормалей с весом площади
+        float area;
+        float key;
+    };
+    std::vector<Piece> pieces(starts.size());
+
+    XMFLOAT3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    XMFLOAT3 meshNormal = { 0.0f, 0.0f, 0.0f };
+    float outward = 0.0f;  // сумма dot(центр треугольника, нормаль)
+
+    for (size_t p = 0; p < pieces.size(); ++p)
+    {
+        Piece& piece = pieces[p];
+        piece.begin = starts[p];
+        piece.end = p + 1 < starts.size() ? starts[p + 1] : triCount;
+        piece.centroid = { 0.0f, 0.0f, 0.0f };
+        piece.normal = { 0.0f, 0.0f, 0.0f };
+        piece.area = 0.0f;
+
+        for (uint32_t t = piece.begin; t < piece.end; ++t)
+        {
+            const XMFLOAT3& p0 = Position(indices[t * 3 + 0]);
+            const XMFLOAT3& p1 = Position(indices[t * 3 + 1]);
+            const XMFLOAT3& p2 = Position(indices[t * 3 + 2]);
+
+            const XMFLOAT3 n = Cross(Sub(p1, p0), Sub(p2, p0));
+            const float area = std::sqrt(Dot(n, n));
+            const XMFLOAT3 c = { (p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f };
+
+            piece.centroid = { piece.centroid.x + c.x * area, piece.centroid.y + c.y * area, piece.centroid.z + c.z * area };
+            piece.normal = { piece.normal.x + n.x, piece.normal.y + n.y, piece.normal.z + n.z };
+            piece.area += area;
+            outward += Dot(c, n);
+        }
+
+        meshCentroid = { meshCentroid.x + piece.centroid.x, meshCentroid.y + piece.centroid.y, meshCentroid.z + piece.centroid.z };
+        meshNormal = { meshNormal.x + piece.normal.x, meshNormal.y + piece.normal.y, meshNormal.z + piece.normal.z };
+        meshArea += piece.area;
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid = { meshCentroid.x / meshArea, meshCentroid.y / meshArea, meshCentroid.z / meshArea };
+
+    // обход треугольников бывает любым: наружу смотрит та сторона, куда в сумме смотрят нормали от центра
+    const float sign = outward - Dot(meshCentroid, meshNormal) < 0.0f ? -1.0f : 1.0f;
+
+    for (Piece& piece : pieces)
+    {
+        piece.key = 0.0f;
+        const float len = std::sqrt(Dot(piece.normal, piece.normal));
+        if (piece.area > 0.0f && len > 0.0f)
+        {
+            const XMFLOAT3 c = { piece.centroid.x / piece.area, piece.centroid.y / piece.area, piece.centroid.z / piece.area };
+            piece.key = sign * Dot(Sub(c, meshCentroid), piece.normal) / len;
+        }
+    }
+
+    std::stable_sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) { return a.key > b.key; });
+
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    for (const Piece& piece : pieces)
+        out.insert(out.end(), indices.begin() + piece.begin * 3, indices.begin() + piece.end * 3);
+    return out;
+}
+
+size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), kNoVertex);
+    std::vector<Vertex> out;
+    out.reserve(vertices.size());
+
+    for (uint32_t& i : indices)
+    {
+        if (remap[i] == kNoVertex)
+        {
+            remap[i] = (uint32_t)out.size();
+            out.push_back(vertices[i]);
+        }
+        i = remap[i];
+    }
+
+    vertices.swap(out);
+    return vertices.size();
+}
+
+void OptimizeMesh(Mesh& mesh, MeshOptimizeStats* stats)
+{
+    if (stats)
+        stats->before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), sizeof(Vertex));
+
+    if (!mesh.indices.empty() && mesh.indices.size() % 3 == 0)
+    {
+        std::vector<uint32_t> clusters;
+        const std::vector<uint32_t> cacheOrder = OptimizeVertexCache(mesh.indices, mesh.vertices.size(),
+            MeshOptimizerCacheSize, &clusters);
+        mesh.indices = OptimizeOverdraw(cacheOrder, clusters, &mesh.vertices[0].Pos, sizeof(Vertex), mesh.vertices.size());
+        OptimizeVertexFetch(mesh.vertices, mesh.indices);
+    }
+
+    if (stats)
+        stats->after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), sizeof(Vertex));
+}
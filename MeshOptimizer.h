@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Meshes.h"
+
+// Оптимизация меша после импорта, без D3D (используется и офлайн-кукером):
+// порядок треугольников под кэш вершин (Tipsify), порядок кластеров против перерисовки,
+// порядок вершин под выборку из буфера. Набор треугольников и их обход не меняются.
+
+static const uint32_t MeshOptimizerCacheSize = 16;
+
+// модель FIFO-кэша пост-трансформа и прямого кэша выборки вершин (256 строк по 64 байта)
+struct VertexCacheStats
+{
+    size_t triangles = 0;
+    size_t vertices = 0;       // вершин в буфере
+    size_t transformed = 0;    // промахи кэша пост-трансформа
+    size_t fetchedBytes = 0;   // промахи кэша выборки, в байтах
+
+    // вершинных шейдеров на треугольник: 0.5 - идеал для сетки, 3 - без повторного использования
+    double Acmr() const { return triangles ? (double)transformed / triangles : 0.0; }
+    // на вершину буфера: 1 - каждая считается один раз
+    double Atvr() const { return vertices ? (double)transformed / vertices : 0.0; }
+    // прочитано байт на байт буфера вершин: 1 - каждая строка читается один раз
+    double Overfetch(size_t vertexStride) const { return vertices ? (double)fetchedBytes / (vertices * vertexStride) : 0.0; }
+
+    VertexCacheStats& operator+=(const VertexCacheStats& o)
+    {
+        triangles += o.triangles;
+        vertices += o.vertices;
+        transformed += o.transformed;
+        fetchedBytes += o.fetchedBytes;
+        return *this;
+    }
+};
+
+struct MeshOptimizeStats
+{
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+    size_t vertexStride, uint32_t cacheSize = MeshOptimizerCacheSize);
+
+// Tipsify (Sander, Nehab, Barczak 2007). outClusters - начала кластеров (в треугольниках),
+// граница там, где обход упёрся в тупик и прыгнул в другое место меша
+std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+    uint32_t cacheSize = MeshOptimizerCacheSize, std::vector<uint32_t>* outClusters = nullptr);
+
+// кластеры дробятся там, где их ACMR не хуже исходного больше чем в threshold раз, и рисуются
+// от смотрящих наружу к смотрящим внутрь: дальние грани чаще отбрасываются тестом глубины
+std::vector<uint32_t> OptimizeOverdraw(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+    const XMFLOAT3* positions, size_t positionStride, size_t vertexCount,
+    float threshold = 1.05f, uint32_t cacheSize = MeshOptimizerCacheSize);
+
+// вершины в порядке первого использования, неиспользуемые выбрасываются; возвращает новое число вершин
+size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// всё вместе; stats - ACMR/ATVR до и после
+void OptimizeMesh(Mesh& mesh, MeshOptimizeStats* stats = nullptr);
@@ -0,0 +1,824 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "ObjImport.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+
+namespace
+{
+    const uint32_t kNone = UINT32_MAX;
+    // вес плоскости вдоль открытого края и шва против плоскостей треугольников
+    const double kBoundaryWeight = 10.0;
+
+    struct Vec3
+    {
+        double x, y, z;
+    };
+
+    Vec3 Sub(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    double Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Vec3 Cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    Vec3 Scale(const Vec3& a, double s) { return { a.x * s, a.y * s, a.z * s }; }
+
+    // p^T A p + 2 b^T p + c: сумма квадратов расстояний до плоскостей с весами, w - сумма весов
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0;
+        double c = 0;
+        double w = 0;
+
+        // n - единичная нормаль, плоскость n.p + d = 0
+        void AddPlane(const Vec3& n, double d, double w)
+        {
+            a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+            a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+            b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+            c += w * d * d;
+            this->w += w;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            w += q.w;
+        }
+
+        // сумма, не среднее: делится на w вместе с ценой атрибутов
+        double Eval(const Vec3& p) const
+        {
+            const double e =
+                a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+                2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+            return e > 0.0 ? e : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t stamp;
+
+        bool operator>(const Collapse& o) const { return cost > o.cost; }
+    };
+
+    class Simplifier
+    {
+    public:
+        Simplifier(const Mesh& mesh, const SimplifySettings& settings)
+            : m_mesh(mesh), m_settings(settings)
+        {
+            Normalize();
+            WeldPositions();
+            BuildTriangles();
+            BuildQuadrics();
+        }
+
+        Mesh Run(size_t targetTriangles, float* outError)
+        {
+            // бесконечные координаты: квадрики не посчитать
+            if (!std::isfinite(m_radius))
+                return m_mesh;
+
+            for (uint32_t p = 0; p < (uint32_t)m_positions.size(); ++p)
+            {
+                Neighbours(p, m_ring);
+                for (uint32_t q : m_ring)
+                    Push(p, q);
+            }
+
+            const double maxCost = (double)m_settings.maxError * m_settings.maxError;
+            double worst = 0.0;
+
+            std::vector<std::pair<uint32_t, uint32_t>> map;
+            while (m_aliveTriangles > targetTriangles && !m_heap.empty())
+            {
+                const Collapse c = m_heap.top();
+                m_heap.pop();
+                if (c.cost > maxCost)
+                    break;
+                if (m_dead[c.from] || m_dead[c.to] || m_stamps[c.from] != c.stamp)
+                    continue;
+
+                // цена в куче могла устареть, пока менялись соседи: тогда обратно в кучу
+                double cost;
+                if (!Evaluate(c.from, c.to, map, cost))
+                    continue;
+                if (cost > c.cost * (1.0 + 1e-9))
+                {
+                    m_heap.push({ cost, c.from, c.to, c.stamp });
+                    continue;
+                }
+                if (!Valid(c.from, c.to, map))
+                    continue;
+
+                Apply(c.from, c.to, map);
+                worst = (std::max)(worst, cost);
+            }
+
+            if (outError)
+                *outError = (float)(std::sqrt(worst) * m_radius);
+            return Extract();
+        }
+
+    private:
+        void Normalize()
+        {
+            const std::vector<Vertex>& v = m_mesh.vertices;
+            Vec3 mn = { 0, 0, 0 }, mx = { 0, 0, 0 };
+            if (!v.empty())
+            {
+                mn = mx = { v[0].Pos.x, v[0].Pos.y, v[0].Pos.z };
+                for (const Vertex& x : v)
+                {
+                    mn = { (std::min)(mn.x, (double)x.Pos.x), (std::min)(mn.y, (double)x.Pos.y), (std::min)(mn.z, (double)x.Pos.z) };
+                    mx = { (std::max)(mx.x, (double)x.Pos.x), (std::max)(mx.y, (double)x.Pos.y), (std::max)(mx.z, (double)x.Pos.z) };
+                }
+            }
+            m_center = Scale({ mn.x + mx.x, mn.y + mx.y, mn.z + mx.z }, 0.5);
+            const Vec3 half = Scale(Sub(mx, mn), 0.5);
+            m_radius = std::sqrt(Dot(half, half));
+            if (m_radius <= 0.0)
+                m_radius = 1.0;
+        }
+
+        // вершины с одинаковой позицией (швы) - одна позиция
+        void WeldPositions()
+        {
+            const std::vector<Vertex>& v = m_mesh.vertices;
+            std::vector<uint32_t> order(v.size());
+            for (uint32_t i = 0; i < (uint32_t)v.size(); ++i)
+                order[i] = i;
+
+            auto Less = [&](uint32_t a, uint32_t b)
+            {
+                return std::memcmp(&v[a].Pos, &v[b].Pos, sizeof(XMFLOAT3)) < 0;
+            };
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return Less(a, b) || (!Less(b, a) && a < b); });
+
+            m_positionOf.assign(v.size(), kNone);
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                if (i == 0 || std::memcmp(&v[order[i]].Pos, &v[order[i - 1]].Pos, sizeof(XMFLOAT3)) != 0)
+                {
+                    const XMFLOAT3& p = v[order[i]].Pos;
+                    m_positions.push_back(Scale(Sub({ p.x, p.y, p.z }, m_center), 1.0 / m_radius));
+                }
+                m_positionOf[order[i]] = (uint32_t)m_positions.size() - 1;
+            }
+
+            m_dead.assign(m_positions.size(), 0);
+            m_locked.assign(m_positions.size(), 0);
+            m_border.assign(m_positions.size(), 0);
+            m_stamps.assign(m_positions.size(), 0);
+            m_marks.assign(m_positions.size(), 0);
+            m_quadrics.assign(m_positions.size(), Quadric());
+            m_triangles.assign(m_positions.size(), {});
+            m_mass.assign(v.size(), 0.0);
+        }
+
+        void BuildTriangles()
+        {
+            const std::vector<UINT32>& idx = m_mesh.indices;
+            const size_t triCount = idx.size() / 3;
+            m_corners.assign(idx.begin(), idx.begin() + triCount * 3);
+            m_cornerPositions.resize(m_corners.size());
+            for (size_t c = 0; c < m_corners.size(); ++c)
+                m_cornerPositions[c] = m_positionOf[m_corners[c]];
+            m_alive.assign(triCount, 0);
+
+            for (uint32_t t = 0; t < (uint32_t)triCount; ++t)
+            {
+                const uint32_t p0 = m_positionOf[m_corners[t * 3 + 0]];
+                const uint32_t p1 = m_positionOf[m_corners[t * 3 + 1]];
+                const uint32_t p2 = m_positionOf[m_corners[t * 3 + 2]];
+                // вырожденные по позициям треугольники выбрасываются сразу
+                if (p0 == p1 || p1 == p2 || p0 == p2)
+                    continue;
+
+                m_alive[t] = 1;
+                ++m_aliveTriangles;
+                m_triangles[p0].push_back(t);
+                m_triangles[p1].push_back(t);
+                m_triangles[p2].push_back(t);
+            }
+        }
+
+        void BuildQuadrics()
+        {
+            // рёбра: (меньшая позиция, большая позиция, вершина, вершина, треугольник)
+            struct Edge
+            {
+                uint32_t pa, pb, wa, wb, t;
+            };
+            std::vector<Edge> edges;
+            edges.reserve(m_aliveTriangles * 3);
+
+            for (uint32_t t = 0; t < (uint32_t)m_alive.size(); ++t)
+            {
+                if (!m_alive[t])
+                    continue;
+
+                const Vec3& p0 = Pos(t, 0);
+                const Vec3& p1 = Pos(t, 1);
+                const Vec3& p2 = Pos(t, 2);
+                Vec3 n = Cross(Sub(p1, p0), Sub(p2, p0));
+                const double len = std::sqrt(Dot(n, n));
+                const double area = 0.5 * len;
+                if (len > 0.0)
+                    n = Scale(n, 1.0 / len);
+
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    m_quadrics[PosId(t, k)].AddPlane(n, -Dot(n, p0), area);
+                    m_mass[m_corners[t * 3 + k]] += area / 3.0;
+
+                    uint32_t wa = m_corners[t * 3 + k], wb = m_corners[t * 3 + (k + 1) % 3];
+                    uint32_t pa = m_positionOf[wa], pb = m_positionOf[wb];
+                    if (pa > pb)
+                    {
+                        std::swap(pa, pb);
+                        std::swap(wa, wb);
+                    }
+                    edges.push_back({ pa, pb, wa, wb, t });
+                }
+            }
+
+            std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b)
+            {
+                if (a.pa != b.pa) return a.pa < b.pa;
+                if (a.pb != b.pb) return a.pb < b.pb;
+                if (a.wa != b.wa) return a.wa < b.wa;
+                return a.wb < b.wb;
+            });
+
+            for (size_t i = 0; i < edges.size();)
+            {
+                size_t j = i;
+                while (j < edges.size() && edges[j].pa == edges[i].pa && edges[j].pb == edges[i].pb)
+                    ++j;
+
+                const size_t sharing = j - i;
+                if (sharing > 2)
+                {
+                    // неманифолдное ребро
+                    m_locked[edges[i].pa] = m_locked[edges[i].pb] = 1;
+                }
+                else
+                {
+                    for (size_t k = i; k < j; ++k)
+                    {
+                        // край: ребро у одного треугольника; шов: у соседа по позициям другие вершины
+                        const bool border = sharing == 1;
+                        const bool seam = sharing == 2 &&
+                            (edges[i].wa != edges[i + 1].wa || edges[i].wb != edges[i + 1].wb);
+                        if (border)
+                            m_border[edges[k].pa] = m_border[edges[k].pb] = 1;
+                        if (border || seam)
+                            AddEdgePlane(edges[k].pa, edges[k].pb, edges[k].t);
+                    }
+                }
+                i = j;
+            }
+
+            if (m_settings.lockBorders)
+            {
+                for (size_t p = 0; p < m_positions.size(); ++p)
+                    m_locked[p] |= m_border[p];
+            }
+        }
+
+        // плоскость через ребро перпендикулярно треугольнику: вершины края не уходят с края
+        void AddEdgePlane(uint32_t pa, uint32_t pb, uint32_t t)
+        {
+            const Vec3 e = Sub(m_positions[pb], m_positions[pa]);
+            Vec3 tn = Cross(Sub(Pos(t, 1), Pos(t, 0)), Sub(Pos(t, 2), Pos(t, 0)));
+            Vec3 n = Cross(e, tn);
+            const double len = std::sqrt(Dot(n, n));
+            if (len <= 0.0)
+                return;
+            n = Scale(n, 1.0 / len);
+
+            const double w = kBoundaryWeight * Dot(e, e);
+            const double d = -Dot(n, m_positions[pa]);
+            m_quadrics[pa].AddPlane(n, d, w);
+            m_quadrics[pb].AddPlane(n, d, w);
+        }
+
+        uint32_t PosId(uint32_t t, uint32_t k) const { return m_cornerPositions[t * 3 + k]; }
+        const Vec3& Pos(uint32_t t, uint32_t k) const { return m_positions[PosId(t, k)]; }
+
+        void Neighbours(uint32_t p, std::vector<uint32_t>& out) const
+        {
+            out.clear();
+            for (uint32_t t : m_triangles[p])
+            {
+                if (!m_alive[t])
+                    continue;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t q = PosId(t, k);
+                    if (q != p)
+                        out.push_back(q);
+                }
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        }
+
+        static const std::pair<uint32_t, uint32_t>* Find(const std::vector<std::pair<uint32_t, uint32_t>>& map, uint32_t w)
+        {
+            for (const auto& m : map)
+            {
+                if (m.first == w)
+                    return &m;
+            }
+            return nullptr;
+        }
+
+        // цена переноса позиции p в q; map - куда уходит каждая вершина p в общих треугольниках
+        bool Evaluate(uint32_t p, uint32_t q, std::vector<std::pair<uint32_t, uint32_t>>& map, double& cost) const
+        {
+            if (m_locked[p])
+                return false;
+
+            map.clear();
+            uint32_t shared = 0;
+            for (uint32_t t : m_triangles[p])
+            {
+                if (!m_alive[t])
+                    continue;
+
+                uint32_t wp = kNone, wq = kNone;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    if (PosId(t, k) == p) wp = m_corners[t * 3 + k];
+                    if (PosId(t, k) == q) wq = m_corners[t * 3 + k];
+                }
+                if (wq == kNone)
+                    continue;
+
+                ++shared;
+                const auto* m = Find(map, wp);
+                if (!m)
+                    map.push_back({ wp, wq });
+                else if (m->second != wq)
+                    return false;  // вершина p по разные стороны ребра уходит в разные вершины q
+            }
+
+            if (shared == 0 || shared > 2)
+                return false;
+            // с края - только вдоль края
+            if (m_border[p] && shared != 1)
+                return false;
+
+            cost = m_quadrics[p].Eval(m_positions[q]);
+            const double nw = (double)m_settings.normalWeight * m_settings.normalWeight;
+            const double uw = (double)m_settings.uvWeight * m_settings.uvWeight;
+            for (const auto& m : map)
+            {
+                const Vertex& a = m_mesh.vertices[m.first];
+                const Vertex& b = m_mesh.vertices[m.second];
+                const double dn =
+                    (a.Normal.x - b.Normal.x) * (a.Normal.x - b.Normal.x) +
+                    (a.Normal.y - b.Normal.y) * (a.Normal.y - b.Normal.y) +
+                    (a.Normal.z - b.Normal.z) * (a.Normal.z - b.Normal.z);
+                const double du =
+                    (a.uv.x - b.uv.x) * (a.uv.x - b.uv.x) +
+                    (a.uv.y - b.uv.y) * (a.uv.y - b.uv.y);
+                cost += m_mass[m.first] * (nw * dn + uw * du);
+            }
+            // средний квадрат расстояния по площади, иначе мелкие треугольники схлопывались бы даром
+            if (m_quadrics[p].w > 0.0)
+                cost /= m_quadrics[p].w;
+            return true;
+        }
+
+        // проверки топологии перед самим схлопыванием, после Evaluate
+        bool Valid(uint32_t p, uint32_t q, const std::vector<std::pair<uint32_t, uint32_t>>& map)
+        {
+            const Vec3& target = m_positions[q];
+            uint32_t shared = 0;
+            ++m_markToken;
+            for (uint32_t t : m_triangles[p])
+            {
+                if (!m_alive[t])
+                    continue;
+
+                uint32_t kp = 0;
+                bool hasQ = false;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t x = PosId(t, k);
+                    if (x == p) kp = k;
+                    if (x == q) hasQ = true;
+                    m_marks[x] = m_markToken;
+                }
+                if (hasQ)
+                {
+                    ++shared;
+                    continue;
+                }
+
+                // вершине p без пары в q некуда уйти: шов порвался бы
+                if (!Find(map, m_corners[t * 3 + kp]))
+                    return false;
+
+                // треугольник не должен перевернуться
+                const Vec3& a = Pos(t, (kp + 1) % 3);
+                const Vec3& b = Pos(t, (kp + 2) % 3);
+                const Vec3 before = Cross(Sub(a, m_positions[p]), Sub(b, m_positions[p]));
+                const Vec3 after = Cross(Sub(a, target), Sub(b, target));
+                if (Dot(before, after) <= 0.0)
+                    return false;
+            }
+
+            // условие связности: общие соседи p и q - только вершины общих треугольников
+            Neighbours(q, m_ring);
+            uint32_t common = 0;
+            for (uint32_t x : m_ring)
+                common += x != p && m_marks[x] == m_markToken;
+            return common == shared;
+        }
+
+        void Push(uint32_t p, uint32_t q)
+        {
+            double cost;
+            if (!m_dead[p] && !m_dead[q] && Evaluate(p, q, m_pushMap, cost))
+                m_heap.push({ cost, p, q, m_stamps[p] });
+        }
+
+        void Apply(uint32_t p, uint32_t q, const std::vector<std::pair<uint32_t, uint32_t>>& map)
+        {
+            for (uint32_t t : m_triangles[p])
+            {
+                if (!m_alive[t])
+                    continue;
+
+                bool hasQ = false;
+                for (uint32_t k = 0; k < 3; ++k)
+                    hasQ |= PosId(t, k) == q;
+                if (hasQ)
+                {
+                    m_alive[t] = 0;
+                    --m_aliveTriangles;
+                    continue;
+                }
+
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    if (m_cornerPositions[t * 3 + k] != p)
+                        continue;
+                    m_corners[t * 3 + k] = Find(map, m_corners[t * 3 + k])->second;
+                    m_cornerPositions[t * 3 + k] = q;
+                }
+                m_triangles[q].push_back(t);
+            }
+
+            m_quadrics[q].Add(m_quadrics[p]);
+            for (const auto& m : map)
+                m_mass[m.second] += m_mass[m.first];
+
+            m_dead[p] = 1;
+            m_triangles[p].clear();
+            m_triangles[p].shrink_to_fit();
+            ++m_stamps[q];
+
+            std::vector<uint32_t>& tq = m_triangles[q];
+            tq.erase(std::remove_if(tq.begin(), tq.end(), [&](uint32_t t) { return !m_alive[t]; }), tq.end());
+
+            Neighbours(q, m_around);
+            for (uint32_t x : m_around)
+            {
+                Push(q, x);
+                Push(x, q);
+            }
+        }
+
+        Mesh Extract() const
+        {
+            Mesh out;
+            std::vector<uint32_t> remap(m_mesh.vertices.size(), kNone);
+            for (uint32_t t = 0; t < (uint32_t)m_alive.size(); ++t)
+            {
+                if (!m_alive[t])
+                    continue;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    const uint32_t w = m_corners[t * 3 + k];
+                    if (remap[w] == kNone)
+                    {
+                        remap[w] = (uint32_t)out.vertices.size();
+                        out.vertices.push_back(m_mesh.vertices[w]);
+                    }
+                    out.indices.push_back(remap[w]);
+                }
+            }
+            return out;
+        }
+
+        const Mesh& m_mesh;
+        SimplifySettings m_settings;
+        Vec3 m_center = { 0, 0, 0 };
+        double m_radius = 1.0;
+
+        // по позициям
+        std::vector<Vec3> m_positions;
+        std::vector<uint8_t> m_dead;
+        std::vector<uint8_t> m_locked;
+        std::vector<uint8_t> m_border;
+        std::vector<uint32_t> m_stamps;
+        std::vector<Quadric> m_quadrics;
+        std::vector<std::vector<uint32_t>> m_triangles;
+
+        // по вершинам
+        std::vector<uint32_t> m_positionOf;
+        std::vector<double> m_mass;
+
+        // по треугольникам
+        std::vector<uint32_t> m_corners;
+        std::vector<uint32_t> m_cornerPositions;
+        std::vector<uint8_t> m_alive;
+        size_t m_aliveTriangles = 0;
+
+        // временные, чтобы не выделять память на каждую проверку
+        std::vector<uint32_t> m_marks;
+        uint32_t m_markToken = 0;
+        std::vector<uint32_t> m_ring;
+        std::vector<uint32_t> m_around;
+        std::vector<std::pair<uint32_t, uint32_t>> m_pushMap;
+
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_heap;
+    };
+
+    // Эриксон, "Real-Time Collision Detection", 5.1.5
+    Vec3 ClosestPointOnTriangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c)
+    {
+        const Vec3 ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+        const double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+        if (d1 <= 0.0 && d2 <= 0.0) return a;
+
+        const Vec3 bp = Sub(p, b);
+        const double d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+        if (d3 >= 0.0 && d4 <= d3) return b;
+
+        const double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+            return { a.x + ab.x * d1 / (d1 - d3), a.y + ab.y * d1 / (d1 - d3), a.z + ab.z * d1 / (d1 - d3) };
+
+        const Vec3 cp = Sub(p, c);
+        const double d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+        if (d6 >= 0.0 && d5 <= d6) return c;
+
+        const double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+            return { a.x + ac.x * d2 / (d2 - d6), a.y + ac.y * d2 / (d2 - d6), a.z + ac.z * d2 / (d2 - d6) };
+
+        const double va = d3 * d6 - d5 * d4;
+        if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+        {
+            const double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            return { b.x + (c.x - b.x) * w, b.y + (c.y - b.y) * w, b.z + (c.z - b.z) * w };
+        }
+
+        const double denom = 1.0 / (va + vb + vc);
+        const double v = vb * denom, w = vc * denom;
+        return { a.x + ab.x * v + ac.x * w, a.y + ab.y * v + ac.y * w, a.z + ab.z * v + ac.z * w };
+    }
+
+    Vec3 ToVec3(const XMFLOAT3& p) { return { p.x, p.y, p.z }; }
+}
+
+Mesh SimplifyMesh(const Mesh& mesh, size_t targetTriangles, const SimplifySettings& settings, float* outError)
+{
+    if (outError)
+        *outError = 0.0f;
+    if (mesh.indices.size() < 3 || mesh.indices.size() / 3 <= targetTriangles)
+        return mesh;
+
+    Simplifier s(mesh, settings);
+    return s.Run(targetTriangles, outError);
+}
+
+float MeasureSimplifyError(const Mesh& original, const Mesh& simplified)
+{
+    if (original.vertices.empty())
+        return 0.0f;
+    const size_t triCount = simplified.indices.size() / 3;
+    if (triCount == 0)
+        return std::numeric_limits<float>::infinity();
+
+    // равномерная сетка по треугольникам simplified, примерно треугольник на ячейку
+    Vec3 mn = ToVec3(original.vertices[0].Pos), mx = mn;
+    auto Grow = [&](const XMFLOAT3& p)
+    {
+        mn = { (std::min)(mn.x, (double)p.x), (std::min)(mn.y, (double)p.y), (std::min)(mn.z, (double)p.z) };
+        mx = { (std::max)(mx.x, (double)p.x), (std::max)(mx.y, (double)p.y), (std::max)(mx.z, (double)p.z) };
+    };
+    for (const Vertex& v : original.vertices) Grow(v.Pos);
+    for (const Vertex& v : simplified.vertices) Grow(v.Pos);
+
+    const Vec3 extent = Sub(mx, mn);
+    const double longest = (std::max)({ extent.x, extent.y, extent.z, 1e-12 });
+    if (!std::isfinite(longest))
+        return std::numeric_limits<float>::infinity();
+    // ячейка порядка среднего треугольника: поверхность, а не объём, должна дать ~1 треугольник на ячейку
+    double area = 0.0;
+    for (size_t t = 0; t < triCount; ++t)
+    {
+        const Vec3 a = ToVec3(simplified.vertices[simplified.indices[t * 3 + 0]].Pos);
+        const Vec3 n = Cross(Sub(ToVec3(simplified.vertices[simplified.indices[t * 3 + 1]].Pos), a),
+            Sub(ToVec3(simplified.vertices[simplified.indices[t * 3 + 2]].Pos), a));
+        area += 0.5 * std::sqrt(Dot(n, n));
+    }
+    double cell = (std::max)(std::sqrt(2.0 * area / triCount), longest * 1e-6);
+    while ((extent.x / cell + 1) * (extent.y / cell + 1) * (extent.z / cell + 1) > 4.0 * triCount + 64.0)
+        cell *= 1.25;
+    const int dim[3] =
+    {
+        (std::max)(1, (int)std::ceil(extent.x / cell)),
+        (std::max)(1, (int)std::ceil(extent.y / cell)),
+        (std::max)(1, (int)std::ceil(extent.z / cell)),
+    };
+    auto CellOf = [&](double v, double lo, int n)
+    {
+        return (std::min)(n - 1, (std::max)(0, (int)((v - lo) / cell)));
+    };
+
+    std::vector<uint32_t> cellStart((size_t)dim[0] * dim[1] * dim[2] + 1, 0);
+    std::vector<uint32_t> cellTriangles;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        std::vector<uint32_t> fill;
+        if (pass == 1)
+        {
+            for (size_t i = 1; i < cellStart.size(); ++i)
+                cellStart[i] += cellStart[i - 1];
+            cellTriangles.resize(cellStart.back());
+            fill.assign(cellStart.begin(), cellStart.end() - 1);
+        }
+
+        for (uint32_t t = 0; t < (uint32_t)triCount; ++t)
+        {
+            const XMFLOAT3& a = simplified.vertices[simplified.indices[t * 3 + 0]].Pos;
+            const XMFLOAT3& b = simplified.vertices[simplified.indices[t * 3 + 1]].Pos;
+            const XMFLOAT3& c = simplified.vertices[simplified.indices[t * 3 + 2]].Pos;
+            const int x0 = CellOf((std::min)({ a.x, b.x, c.x }), mn.x, dim[0]), x1 = CellOf((std::max)({ a.x, b.x, c.x }), mn.x, dim[0]);
+            const int y0 = CellOf((std::min)({ a.y, b.y, c.y }), mn.y, dim[1]), y1 = CellOf((std::max)({ a.y, b.y, c.y }), mn.y, dim[1]);
+            const int z0 = CellOf((std::min)({ a.z, b.z, c.z }), mn.z, dim[2]), z1 = CellOf((std::max)({ a.z, b.z, c.z }), mn.z, dim[2]);
+            for (int z = z0; z <= z1; ++z)
+                for (int y = y0; y <= y1; ++y)
+                    for (int x = x0; x <= x1; ++x)
+                    {
+                        const size_t id = ((size_t)z * dim[1] + y) * dim[0] + x;
+                        if (pass == 0)
+                            ++cellStart[id + 1];
+                        else
+                            cellTriangles[fill[id]++] = t;
+                    }
+        }
+    }
+
+    // кольца ячеек вокруг точки, пока ближайший найденный треугольник ближе следующего кольца
+    std::vector<uint32_t> visited(triCount, kNone);
+    double worst = 0.0;
+    for (uint32_t i = 0; i < (uint32_t)original.vertices.size(); ++i)
+    {
+        const Vec3 p = ToVec3(original.vertices[i].Pos);
+        const int cx = CellOf(p.x, mn.x, dim[0]), cy = CellOf(p.y, mn.y, dim[1]), cz = CellOf(p.z, mn.z, dim[2]);
+        // за этим кольцом ячеек уже нет
+        const int maxRing = (std::max)({ cx, dim[0] - 1 - cx, cy, dim[1] - 1 - cy, cz, dim[2] - 1 - cz });
+
+        double best = std::numeric_limits<double>::infinity();
+        for (int r = 0; r <= maxRing; ++r)
+        {
+            const int z0 = (std::max)(cz - r, 0), z1 = (std::min)(cz + r, dim[2] - 1);
+            const int y0 = (std::max)(cy - r, 0), y1 = (std::min)(cy + r, dim[1] - 1);
+            const int x0 = (std::max)(cx - r, 0), x1 = (std::min)(cx + r, dim[0] - 1);
+            for (int z = z0; z <= z1; ++z)
+                for (int y = y0; y <= y1; ++y)
+                {
+                    // внутри кольца по y и z - только крайние x
+                    const bool shell = std::abs(z - cz) == r || std::abs(y - cy) == r;
+                    const int step = shell ? 1 : (std::max)(2 * r, 1);
+                    for (int x = shell ? x0 : cx - r; x <= x1; x += step)
+                    {
+                        if (x < x0)
+                            continue;
+
+                        const size_t id = ((size_t)z * dim[1] + y) * dim[0] + x;
+                        for (uint32_t k = cellStart[id]; k < cellStart[id + 1]; ++k)
+                        {
+                            const uint32_t t = cellTriangles[k];
+                            if (visited[t] == i)
+                                continue;
+                            visited[t] = i;
+
+                            const Vec3 c = ClosestPointOnTriangle(p,
+                                ToVec3(simplified.vertices[simplified.indices[t * 3 + 0]].Pos),
+                                ToVec3(simplified.vertices[simplified.indices[t * 3 + 1]].Pos),
+                                ToVec3(simplified.vertices[simplified.indices[t * 3 + 2]].Pos));
+                            const Vec3 d = Sub(p, c);
+                            best = (std::min)(best, Dot(d, d));
+                        }
+                    }
+                }
+
+            // всё, что дальше кольца r, не ближе r ячеек
+            if (best <= (r * cell) * (r * cell))
+                break;
+        }
+        worst = (std::max)(worst, best);
+    }
+    return (float)std::sqrt(worst);
+}
+
+std::vector<float> LodDistancesFromErrors(const std::vector<float>& errors, const LodChainSettings& settings)
+{
+    // ошибка e на дистанции d занимает e * H / (2 d tan(fov / 2)) пикселей
+    const float k = settings.screenHeight / (2.0f * std::tan(settings.fovY * 0.5f) * (std::max)(settings.pixelError, 1e-3f));
+
+    std::vector<float> distances(errors.size(), 0.0f);
+    for (size_t i = 1; i < errors.size(); ++i)
+        distances[i] = (std::max)(distances[i - 1], errors[i] * k);
+    return distances;
+}
+
+void GenerateLodChain(std::vector<ImportedObject>& objects, const LodChainSettings& settings, TaskPool* pool)
+{
+    struct Job
+    {
+        size_t object = 0;
+        size_t lod = 0;  // номер в triangleRatios
+        Mesh mesh;
+        float error = 0.0f;
+        MeshOptimizeStats stats;
+    };
+
+    std::vector<Job> jobs;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        if (objects[i].lodMeshes.size() != 1 || objects[i].lodMeshes[0].indices.empty())
+            continue;
+        for (size_t k = 0; k < settings.triangleRatios.size(); ++k)
+        {
+            Job job;
+            job.object = i;
+            job.lod = k;
+            jobs.push_back(std::move(job));
+        }
+    }
+
+    // каждый LOD упрощается из LOD 0 и меряется относительно него
+    auto Run = [&](size_t b, size_t e)
+    {
+        for (size_t j = b; j < e; ++j)
+        {
+            Job& job = jobs[j];
+            const Mesh& base = objects[job.object].lodMeshes[0];
+            const size_t target = (size_t)((base.indices.size() / 3) * settings.triangleRatios[job.lod]);
+
+            job.mesh = SimplifyMesh(base, (std::max)(target, (size_t)1), settings.simplify);
+            OptimizeMesh(job.mesh, &job.stats);
+            job.error = MeasureSimplifyError(base, job.mesh);
+        }
+    };
+    if (pool)
+        pool->ParallelFor(jobs.size(), 1, Run);
+    else
+        Run(0, jobs.size());
+
+    for (size_t j = 0; j < jobs.size();)
+    {
+        ImportedObject& obj = objects[jobs[j].object];
+        obj.lodErrors = { 0.0f };
+        obj.lodOptimizeStats.resize(1);
+
+        for (; j < jobs.size() && &objects[jobs[j].object] == &obj; ++j)
+        {
+            Job& job = jobs[j];
+            const size_t prevTriangles = obj.lodMeshes.back().indices.size() / 3;
+            // упёрся в maxError: дальше LOD будут такими же
+            if (job.mesh.indices.empty() || job.mesh.indices.size() / 3 > prevTriangles * 9 / 10)
+            {
+                while (j + 1 < jobs.size() && jobs[j + 1].object == job.object)
+                    ++j;
+                continue;
+            }
+            obj.lodMeshes.push_back(std::move(job.mesh));
+            obj.lodErrors.push_back(job.error);
+            obj.lodOptimizeStats.push_back(job.stats);
+        }
+
+        obj.lodDistances = LodDistancesFromErrors(obj.lodErrors, settings);
+    }
+}
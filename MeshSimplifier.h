@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Meshes.h"
+
+class TaskPool;
+struct ImportedObject;
+
+struct SimplifySettings
+{
+    // доля радиуса меша (половины диагонали AABB) по метрике квадрик, дальше упрощение не идёт;
+    // настоящее отклонение поверхности меряет MeasureSimplifyError, обычно оно в 1-2 раза больше
+    float maxError = 0.02f;
+    float normalWeight = 0.1f;    // цена разницы атрибутов против расстояния в радиусах меша
+    float uvWeight = 1.0f;
+    bool lockBorders = true;      // открытые края (и стыки сабмешей разных материалов) не двигаются
+};
+
+// Упрощение схлопыванием ребра в вершину (half-edge collapse) по квадрикам Гарланда-Хекберта.
+// Вершины не двигаются и не интерполируются, атрибуты остаются как были. Шов UV/нормалей
+// (несколько вершин в одной позиции) схлопывается только вдоль шва, всеми вершинами сразу.
+// outError - корень наибольшей ошибки квадрики среди принятых схлопываний, в единицах меша
+Mesh SimplifyMesh(const Mesh& mesh, size_t targetTriangles, const SimplifySettings& settings, float* outError = nullptr);
+
+// наибольшее расстояние от вершин original до поверхности simplified, в единицах меша
+float MeasureSimplifyError(const Mesh& original, const Mesh& simplified);
+
+struct LodChainSettings
+{
+    std::vector<float> triangleRatios = { 0.5f, 0.25f, 0.125f };  // LOD 1..N от числа треугольников LOD 0
+    SimplifySettings simplify;
+
+    // LOD включается там, где его ошибка видна не больше чем на pixelError пикселей
+    float pixelError = 1.0f;
+    float screenHeight = 1080.0f;
+    float fovY = XM_PIDIV4;
+};
+
+// Объектам с одним LOD достраивает цепочку упрощением LOD 0 и заполняет lodErrors и lodDistances.
+// LOD, который упёрся в maxError и почти не уменьшился, отбрасывается вместе с остальными.
+// Меши упрощаются параллельно на pool, nullptr - в вызывающем потоке
+void GenerateLodChain(std::vector<ImportedObject>& objects, const LodChainSettings& settings, TaskPool* pool);
+
+// errors[0] = 0 для LOD 0; дистанции в единицах меша, не убывают
+std::vector<float> LodDistancesFromErrors(const std::vector<float>& errors, const LodChainSettings& settings);
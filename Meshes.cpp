@@ -1,4 +1,5 @@
 #include "Meshes.h"
+#include "MeshOptimizer.h"
 #include <string>
 #include <stdexcept>
 using namespace DirectX;
@@ -122,6 +123,7 @@ Mesh CreateSphere(int slices, int stacks, float radius)
         }
     }
 
+    OptimizeMesh(m);
     return m;
 }
 
@@ -0,0 +1,691 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <cstring>
+#include <unordered_map>
+
+static inline uint32_t PackTriU8(uint32_t a, uint32_t b, uint32_t c)
+{
+    return (a & 0xFFu) | ((b & 0xFFu) << 8) | ((c & 0xFFu) << 16);
+}
+
+void BuildMeshlets_Greedy(
+    const std::vector<uint32_t>& indices,
+    uint32_t maxVerts, uint32_t maxPrims,
+    std::vector<Meshlet>& outMeshlets,
+    std::vector<uint32_t>& outMeshletVertices,
+    std::vector<uint32_t>& outMeshletPrimsPacked)
+{
+    if (indices.size() % 3 != 0) throw std::runtime_error("indices must be triangle list");
+    if (maxVerts == 0 || maxVerts > 64) throw std::runtime_error("maxVerts must be 1-64");
+    if (maxPrims == 0 || maxPrims > 126) throw std::runtime_error("maxPrims must be 1-126");
+
+    outMeshlets.clear();
+    outMeshletVertices.clear();
+    outMeshletPrimsPacked.clear();
+
+    std::vector<uint32_t> curVerts; curVerts.reserve(maxVerts);
+    std::vector<uint32_t> curPrims; curPrims.reserve(maxPrims);
+    std::unordered_map<uint32_t, uint32_t> remap; remap.reserve(maxVerts * 2);
+
+    auto Flush = [&]()
+    {
+        if (curPrims.empty()) return;
+
+        Meshlet m{};
+        m.vertexOffset = (uint32_t)outMeshletVertices.size();
+        m.vertexCount  = (uint32_t)curVerts.size();
+        m.primOffset   = (uint32_t)outMeshletPrimsPacked.size();
+        m.primCount    = (uint32_t)curPrims.size();
+
+        outMeshlets.push_back(m);
+
+        outMeshletVertices.insert(outMeshletVertices.end(), curVerts.begin(), curVerts.end());
+        outMeshletPrimsPacked.insert(outMeshletPrimsPacked.end(), curPrims.begin(), curPrims.end());
+
+        curVerts.clear();
+        curPrims.clear();
+        remap.clear();
+    };
+
+    const size_t triCount = indices.size() / 3;
+    for (size_t t = 0; t < triCount; ++t)
+    {
+        uint32_t i0 = indices[t * 3 + 0];
+        uint32_t i1 = indices[t * 3 + 1];
+        uint32_t i2 = indices[t * 3 + 2];
+
+        uint32_t add = 0;
+        add += (remap.find(i0) == remap.end()) ? 1u : 0u;
+        add += (remap.find(i1) == remap.end()) ? 1u : 0u;
+        add += (remap.find(i2) == remap.end()) ? 1u : 0u;
+
+        if ((curPrims.size() + 1) > maxPrims || (curVerts.size() + add) > maxVerts)
+        {
+            Flush();
+        }
+
+        auto GetLocal = [&](uint32_t gi) -> uint32_t
+        {
+            auto it = remap.find(gi);
+            if (it != remap.end()) return it->second;
+            uint32_t li = (uint32_t)curVerts.size();
+            curVerts.push_back(gi);
+            remap.emplace(gi, li);
+            return li;
+        };
+
+        uint32_t l0 = GetLocal(i0);
+        uint32_t l1 = GetLocal(i1);
+        uint32_t l2 = GetLocal(i2);
+
+        curPrims.push_back(PackTriU8(l0, l1, l2));
+    }
+
+    Flush();
+}
+
+namespace
+{
+    const uint32_t kNone = UINT32_MAX;
+
+    XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    XMFLOAT3 Add(const XMFLOAT3& a, const XMFLOAT3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    XMFLOAT3 Scale(const XMFLOAT3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+    float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    float Length(const XMFLOAT3& a) { return std::sqrt(Dot(a, a)); }
+    XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    XMFLOAT3 Normalize(const XMFLOAT3& a)
+    {
+        const float len = Length(a);
+        return len > 0.0f && std::isfinite(len) ? Scale(a, 1.0f / len) : XMFLOAT3{ 0.0f, 0.0f, 0.0f };
+    }
+
+    struct PositionReader
+    {
+        const uint8_t* base;
+        size_t stride;
+
+        const XMFLOAT3& operator()(uint32_t v) const
+        {
+            return *reinterpret_cast<const XMFLOAT3*>(base + v * stride);
+        }
+    };
+
+    void CheckLimits(const std::vector<uint32_t>& indices, uint32_t maxVerts, uint32_t maxPrims)
+    {
+        if (indices.size() % 3 != 0) throw std::runtime_error("indices must be triangle list");
+        if (maxVerts == 0 || maxVerts > 64) throw std::runtime_error("maxVerts must be 1-64");
+        if (maxPrims == 0 || maxPrims > 126) throw std::runtime_error("maxPrims must be 1-126");
+    }
+
+    // Свободные треугольники по ячейкам сетки центроидов: у ячейки живые записи лежат
+    // в начале её диапазона, занятые выкидываются перестановкой при обходе
+    class TriangleGrid
+    {
+    public:
+        TriangleGrid(const std::vector<XMFLOAT3>& centroids, double area)
+        {
+            XMFLOAT3 mn = { INFINITY, INFINITY, INFINITY };
+            XMFLOAT3 mx = { -INFINITY, -INFINITY, -INFINITY };
+            for (const XMFLOAT3& c : centroids)
+            {
+                if (!std::isfinite(c.x) || !std::isfinite(c.y) || !std::isfinite(c.z))
+                    continue;
+                mn = { (std::min)(mn.x, c.x), (std::min)(mn.y, c.y), (std::min)(mn.z, c.z) };
+                mx = { (std::max)(mx.x, c.x), (std::max)(mx.y, c.y), (std::max)(mx.z, c.z) };
+            }
+
+            m_origin = mn.x <= mx.x ? mn : XMFLOAT3{ 0.0f, 0.0f, 0.0f };
+            const double extent[3] = {
+                mn.x <= mx.x ? (double)mx.x - mn.x : 0.0,
+                mn.y <= mx.y ? (double)mx.y - mn.y : 0.0,
+                mn.z <= mx.z ? (double)mx.z - mn.z : 0.0 };
+
+            // ячейка - пара треугольников по стороне; ячеек не больше чем вдвое против треугольников
+            const size_t triCount = centroids.size();
+            double cell = 2.0 * std::sqrt(area / (std::max)(triCount, (size_t)1));
+            if (!(cell > 0.0) || !std::isfinite(cell))
+                cell = (std::max)({ extent[0], extent[1], extent[2], 1e-30 });
+            for (;;)
+            {
+                double cells = 1.0;
+                for (int a = 0; a < 3; ++a)
+                {
+                    const double d = std::ceil(extent[a] / cell);
+                    m_dims[a] = std::isfinite(d) ? (int)(std::min)((std::max)(d, 1.0), 1024.0) : 1;
+                    cells *= m_dims[a];
+                }
+                if (cells <= 2.0 * triCount + 8.0)
+                    break;
+                cell *= 1.5;
+            }
+            m_cell = (float)cell;
+
+            const size_t cellCount = (size_t)m_dims[0] * m_dims[1] * m_dims[2];
+            m_start.assign(cellCount + 1, 0);
+            m_live.assign(cellCount, 0);
+            std::vector<uint32_t> cellOf(triCount);
+            for (size_t t = 0; t < triCount; ++t)
+            {
+                cellOf[t] = CellIndex(centroids[t]);
+                ++m_start[cellOf[t] + 1];
+            }
+            for (size_t c = 0; c < cellCount; ++c)
+            {
+                m_live[c] = m_start[c + 1];
+                m_start[c + 1] += m_start[c];
+            }
+            m_items.resize(triCount);
+            std::vector<uint32_t> fill(m_start.begin(), m_start.end() - 1);
+            for (size_t t = 0; t < triCount; ++t)
+                m_items[fill[cellOf[t]]++] = (uint32_t)t;
+        }
+
+        // ближайший по центроиду свободный треугольник в пределах maxRing ячеек, иначе kNone
+        uint32_t FindNearest(const XMFLOAT3& p, const std::vector<XMFLOAT3>& centroids,
+            const std::vector<uint8_t>& used, int maxRing)
+        {
+            int c[3];
+            CellCoords(p, c);
+
+            uint32_t best = kNone;
+            float bestD2 = INFINITY;
+            for (int r = 0; r <= maxRing; ++r)
+            {
+                for (int dz = -r; dz <= r; ++dz)
+                for (int dy = -r; dy <= r; ++dy)
+                for (int dx = -r; dx <= r; ++dx)
+                {
+                    if ((std::max)({ std::abs(dx), std::abs(dy), std::abs(dz) }) != r)
+                        continue;
+                    const int x = c[0] + dx, y = c[1] + dy, z = c[2] + dz;
+                    if (x < 0 || y < 0 || z < 0 || x >= m_dims[0] || y >= m_dims[1] || z >= m_dims[2])
+                        continue;
+
+                    const size_t cell = ((size_t)z * m_dims[1] + y) * m_dims[0] + x;
+                    uint32_t* items = m_items.data() + m_start[cell];
+                    uint32_t& live = m_live[cell];
+                    for (uint32_t i = 0; i < live;)
+                    {
+                        const uint32_t t = items[i];
+                        if (used[t])
+                        {
+                            items[i] = items[--live];
+                            items[live] = t;
+                            continue;
+                        }
+                        const XMFLOAT3 d = Sub(centroids[t], p);
+                        const float d2 = Dot(d, d);
+                        if (d2 < bestD2 || best == kNone)
+                        {
+                            bestD2 = d2;
+                            best = t;
+                        }
+                        ++i;
+                    }
+                }
+                // всё, что дальше кольца r, не ближе r ячеек
+                if (best != kNone && bestD2 <= (r * m_cell) * (r * m_cell))
+                    break;
+            }
+            return best;
+        }
+
+    private:
+        void CellCoords(const XMFLOAT3& p, int out[3]) const
+        {
+            const float v[3] = { p.x - m_origin.x, p.y - m_origin.y, p.z - m_origin.z };
+            for (int a = 0; a < 3; ++a)
+            {
+                const float f = v[a] / m_cell;
+                out[a] = f > 0.0f ? (int)(std::min)(f, (float)(m_dims[a] - 1)) : 0;
+            }
+        }
+
+        uint32_t CellIndex(const XMFLOAT3& p) const
+        {
+            int c[3];
+            CellCoords(p, c);
+            return (uint32_t)(((size_t)c[2] * m_dims[1] + c[1]) * m_dims[0] + c[0]);
+        }
+
+        XMFLOAT3 m_origin = { 0.0f, 0.0f, 0.0f };
+        float m_cell = 1.0f;
+        int m_dims[3] = { 1, 1, 1 };
+        std::vector<uint32_t> m_start;
+        std::vector<uint32_t> m_live;
+        std::vector<uint32_t> m_items;
+    };
+}
+
+void BuildMeshlets_Clustered(
+    const std::vector<uint32_t>& indices,
+    const XMFLOAT3* positions, size_t positionStride, size_t vertexCount,
+    uint32_t maxVerts, uint32_t maxPrims, float coneWeight,
+    std::vector<Meshlet>& outMeshlets,
+    std::vector<uint32_t>& outMeshletVertices,
+    std::vector<uint32_t>& outMeshletPrimsPacked)
+{
+    CheckLimits(indices, maxVerts, maxPrims);
+    for (uint32_t i : indices)
+        if (i >= vertexCount) throw std::runtime_error("index out of range");
+
+    outMeshlets.clear();
+    outMeshletVertices.clear();
+    outMeshletPrimsPacked.clear();
+
+    const size_t triCount = indices.size() / 3;
+    if (triCount == 0)
+        return;
+
+    const PositionReader P{ reinterpret_cast<const uint8_t*>(positions), positionStride };
+
+    std::vector<XMFLOAT3> centroids(triCount);
+    std::vector<XMFLOAT3> normals(triCount);
+    double area = 0.0;
+    for (size_t t = 0; t < triCount; ++t)
+    {
+        const XMFLOAT3& a = P(indices[t * 3 + 0]);
+        const XMFLOAT3& b = P(indices[t * 3 + 1]);
+        const XMFLOAT3& c = P(indices[t * 3 + 2]);
+        centroids[t] = Scale(Add(Add(a, b), c), 1.0f / 3.0f);
+        const XMFLOAT3 n = Cross(Sub(b, a), Sub(c, a));
+        const float len = Length(n);
+        if (std::isfinite(len))
+            area += 0.5 * len;
+        normals[t] = Normalize(n);
+    }
+
+    // треугольники каждой вершины: свободные лежат в начале, live[v] штук
+    std::vector<uint32_t> adjOffsets(vertexCount + 1, 0);
+    std::vector<uint32_t> adjTris(indices.size());
+    for (uint32_t i : indices)
+        ++adjOffsets[i + 1];
+    for (size_t v = 0; v < vertexCount; ++v)
+        adjOffsets[v + 1] += adjOffsets[v];
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        live[v] = adjOffsets[v + 1] - adjOffsets[v];
+    {
+        std::vector<uint32_t> fill(adjOffsets.begin(), adjOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i)
+            adjTris[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    TriangleGrid grid(centroids, area);
+    std::vector<uint8_t> used(triCount, 0);
+    std::vector<uint32_t> localIndex(vertexCount, kNone);
+
+    std::vector<uint32_t> curVerts; curVerts.reserve(maxVerts);
+    std::vector<uint32_t> curPrims; curPrims.reserve(maxPrims);
+    XMFLOAT3 centroidSum = { 0.0f, 0.0f, 0.0f };
+    XMFLOAT3 normalSum = { 0.0f, 0.0f, 0.0f };
+    XMFLOAT3 lastCenter = centroids[0];
+    size_t remaining = triCount;
+    size_t cursor = 0;
+
+    auto AddTriangle = [&](uint32_t t)
+    {
+        used[t] = 1;
+        --remaining;
+
+        uint32_t local[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            if (localIndex[v] == kNone)
+            {
+                localIndex[v] = (uint32_t)curVerts.size();
+                curVerts.push_back(v);
+            }
+            local[k] = localIndex[v];
+
+            // одна запись на каждое вхождение вершины
+            uint32_t* list = adjTris.data() + adjOffsets[v];
+            for (uint32_t j = 0; j < live[v]; ++j)
+            {
+                if (list[j] == t)
+                {
+                    std::swap(list[j], list[--live[v]]);
+                    break;
+                }
+            }
+        }
+        curPrims.push_back(PackTriU8(local[0], local[1], local[2]));
+        centroidSum = Add(centroidSum, centroids[t]);
+        normalSum = Add(normalSum, normals[t]);
+    };
+
+    auto Flush = [&]()
+    {
+        if (curPrims.empty()) return;
+
+        Meshlet m{};
+        m.vertexOffset = (uint32_t)outMeshletVertices.size();
+        m.vertexCount = (uint32_t)curVerts.size();
+        m.primOffset = (uint32_t)outMeshletPrimsPacked.size();
+        m.primCount = (uint32_t)curPrims.size();
+        outMeshlets.push_back(m);
+
+        outMeshletVertices.insert(outMeshletVertices.end(), curVerts.begin(), curVerts.end());
+        outMeshletPrimsPacked.insert(outMeshletPrimsPacked.end(), curPrims.begin(), curPrims.end());
+
+        for (uint32_t v : curVerts)
+            localIndex[v] = kNone;
+        lastCenter = Scale(centroidSum, 1.0f / curPrims.size());
+        curVerts.clear();
+        curPrims.clear();
+        centroidSum = { 0.0f, 0.0f, 0.0f };
+        normalSum = { 0.0f, 0.0f, 0.0f };
+    };
+
+    while (remaining > 0)
+    {
+        if (curPrims.empty())
+        {
+            // следующий мешлет начинается рядом с предыдущим, иначе с первого свободного по порядку
+            uint32_t seed = grid.FindNearest(lastCenter, centroids, used, 2);
+            if (seed == kNone)
+            {
+                while (used[cursor]) ++cursor;
+                seed = (uint32_t)cursor;
+            }
+            AddTriangle(seed);
+            continue;
+        }
+
+        const XMFLOAT3 center = Scale(centroidSum, 1.0f / curPrims.size());
+        const XMFLOAT3 axis = Normalize(normalSum);
+
+        uint32_t best = kNone;
+        uint32_t bestExtra = 5;
+        float bestScore = INFINITY;
+        if (curPrims.size() < maxPrims)
+        {
+            for (uint32_t v : curVerts)
+            {
+                const uint32_t* list = adjTris.data() + adjOffsets[v];
+                for (uint32_t j = 0; j < live[v]; ++j)
+                {
+                    const uint32_t t = list[j];
+                    const uint32_t a = indices[t * 3 + 0], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+                    const uint32_t extra = (localIndex[a] == kNone ? 1u : 0u) +
+                        (localIndex[b] == kNone && b != a ? 1u : 0u) +
+                        (localIndex[c] == kNone && c != a && c != b ? 1u : 0u);
+                    if (curVerts.size() + extra > maxVerts)
+                        continue;
+
+                    // треугольник, последний у какой-то из своих вершин, забираем раньше:
+                    // иначе он останется обрывком для отдельного мешлета
+                    uint32_t priority = extra;
+                    if (extra != 0)
+                        priority = (live[a] == 1 || live[b] == 1 || live[c] == 1) ? 1u : extra + 1;
+                    if (priority > bestExtra)
+                        continue;
+
+                    const float score = Length(Sub(centroids[t], center)) *
+                        (1.0f + coneWeight * (1.0f - Dot(normals[t], axis)));
+                    if (priority < bestExtra || score < bestScore)
+                    {
+                        best = t;
+                        bestExtra = priority;
+                        bestScore = score;
+                    }
+                }
+            }
+
+            // соседей нет: ближайший несмежный, если он рядом и точно влезает
+            if (best == kNone && curVerts.size() + 3 <= maxVerts)
+                best = grid.FindNearest(center, centroids, used, 2);
+        }
+
+        if (best == kNone)
+            Flush();
+        else
+            AddTriangle(best);
+    }
+
+    Flush();
+}
+
+MeshletBounds ComputeMeshletBounds(
+    const Meshlet& meshlet,
+    const std::vector<uint32_t>& meshletVertices,
+    const std::vector<uint32_t>& meshletPrimsPacked,
+    const XMFLOAT3* positions, size_t positionStride)
+{
+    const PositionReader P{ reinterpret_cast<const uint8_t*>(positions), positionStride };
+    auto V = [&](uint32_t local) -> const XMFLOAT3& { return P(meshletVertices[meshlet.vertexOffset + local]); };
+
+    MeshletBounds b{};
+    b.coneCutoff = 1.0f;
+    b.coneAxis[2] = 1.0f;
+    if (meshlet.vertexCount == 0)
+        return b;
+
+    // Риттер: диаметр по двум дальним точкам, потом расширение на выпавшие
+    auto Farthest = [&](const XMFLOAT3& from) {
+        uint32_t best = 0;
+        float bestD2 = -1.0f;
+        for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+        {
+            const XMFLOAT3 d = Sub(V(i), from);
+            if (Dot(d, d) > bestD2)
+            {
+                bestD2 = Dot(d, d);
+                best = i;
+            }
+        }
+        return V(best);
+    };
+    const XMFLOAT3 a = Farthest(V(0));
+    const XMFLOAT3 c = Farthest(a);
+    XMFLOAT3 center = Scale(Add(a, c), 0.5f);
+    float radius = 0.5f * Length(Sub(c, a));
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+    {
+        const float d = Length(Sub(V(i), center));
+        if (d > radius)
+        {
+            const float grown = 0.5f * (radius + d);
+            center = Add(center, Scale(Sub(V(i), center), (grown - radius) / d));
+            radius = grown;
+        }
+    }
+    // добираем погрешность float, чтобы сфера точно содержала все вершины
+    for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+        radius = (std::max)(radius, Length(Sub(V(i), center)));
+
+    b.center[0] = center.x; b.center[1] = center.y; b.center[2] = center.z;
+    b.radius = radius;
+    b.coneApex[0] = center.x; b.coneApex[1] = center.y; b.coneApex[2] = center.z;
+
+    // конус по нормалям невырожденных треугольников
+    XMFLOAT3 normals[126];
+    XMFLOAT3 corners[126];
+    uint32_t count = 0;
+    XMFLOAT3 sum = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t p = 0; p < meshlet.primCount && count < 126; ++p)
+    {
+        const uint32_t packed = meshletPrimsPacked[meshlet.primOffset + p];
+        const XMFLOAT3& p0 = V(packed & 0xFFu);
+        const XMFLOAT3& p1 = V((packed >> 8) & 0xFFu);
+        const XMFLOAT3& p2 = V((packed >> 16) & 0xFFu);
+        const XMFLOAT3 n = Normalize(Cross(Sub(p1, p0), Sub(p2, p0)));
+        if (Dot(n, n) == 0.0f)
+            continue;
+        normals[count] = n;
+        corners[count] = p0;
+        sum = Add(sum, n);
+        ++count;
+    }
+
+    const XMFLOAT3 axis = Normalize(sum);
+    if (count == 0 || Dot(axis, axis) == 0.0f)
+        return b;
+
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < count; ++i)
+        minDot = (std::min)(minDot, Dot(normals[i], axis));
+
+    b.coneAxis[0] = axis.x; b.coneAxis[1] = axis.y; b.coneAxis[2] = axis.z;
+    if (minDot <= 0.0f)
+        return b;
+
+    // вершина конуса на оси позади плоскостей всех треугольников
+    float maxT = 0.0f;
+    for (uint32_t i = 0; i < count; ++i)
+        maxT = (std::max)(maxT, Dot(Sub(center, corners[i]), normals[i]) / Dot(axis, normals[i]));
+
+    const XMFLOAT3 apex = Sub(center, Scale(axis, maxT));
+    b.coneApex[0] = apex.x; b.coneApex[1] = apex.y; b.coneApex[2] = apex.z;
+    b.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    return b;
+}
+
+MeshletBlobInfo BuildMeshletBlob(
+    const Mesh& mesh,
+    uint32_t maxVerts, uint32_t maxPrims,
+    std::vector<uint32_t>& outBlob)
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletVerts;
+    std::vector<uint32_t> meshletPrims;
+    const XMFLOAT3* positions = mesh.vertices.empty() ? nullptr : &mesh.vertices[0].Pos;
+    BuildMeshlets_Clustered(mesh.indices, positions, sizeof(Vertex), mesh.vertices.size(),
+        maxVerts, maxPrims, MeshletConeWeight, meshlets, meshletVerts, meshletPrims);
+
+    MeshletBlobInfo info;
+    info.meshletCount = (uint32_t)meshlets.size();
+    info.vertexCount = (uint32_t)meshletVerts.size();
+    info.primCount = (uint32_t)meshletPrims.size();
+
+    outBlob.assign(info.Words(), 0);
+    for (size_t i = 0; i < meshlets.size(); ++i)
+    {
+        const MeshletBounds b = ComputeMeshletBounds(meshlets[i], meshletVerts, meshletPrims, positions, sizeof(Vertex));
+        memcpy(outBlob.data() + i * MeshletBoundsWords, &b, sizeof(b));
+    }
+    if (!meshlets.empty())
+        memcpy(outBlob.data() + info.MeshletsOffset(), meshlets.data(), meshlets.size() * sizeof(Meshlet));
+    std::copy(meshletVerts.begin(), meshletVerts.end(), outBlob.begin() + info.VerticesOffset());
+    std::copy(meshletPrims.begin(), meshletPrims.end(), outBlob.begin() + info.PrimsOffset());
+    return info;
+}
+
+MeshletStats& MeshletStats::operator+=(const MeshletStats& o)
+{
+    meshlets += o.meshlets;
+    triangles += o.triangles;
+    vertices += o.vertices;
+    cullableCones += o.cullableCones;
+    radiusSum += o.radiusSum;
+    buildMs += o.buildMs;
+    maxVerts = (std::max)(maxVerts, o.maxVerts);
+    maxPrims = (std::max)(maxPrims, o.maxPrims);
+    return *this;
+}
+
+// статистика и проверка: треугольники совпадают с исходными, границы их покрывают
+static MeshletStats AnalyzeMeshlets(const Mesh& mesh, uint32_t maxVerts, uint32_t maxPrims,
+    const std::vector<Meshlet>& meshlets, const std::vector<uint32_t>& verts, const std::vector<uint32_t>& prims,
+    bool& valid)
+{
+    MeshletStats s;
+    s.maxVerts = maxVerts;
+    s.maxPrims = maxPrims;
+    s.meshlets = meshlets.size();
+
+    const XMFLOAT3* positions = mesh.vertices.empty() ? nullptr : &mesh.vertices[0].Pos;
+    const PositionReader P{ reinterpret_cast<const uint8_t*>(positions), sizeof(Vertex) };
+
+    // треугольник с наименьшим индексом первым, обход сохраняется
+    auto Canonical = [](uint32_t a, uint32_t b, uint32_t c) {
+        if (b < a && b <= c) return std::array<uint32_t, 3>{ b, c, a };
+        if (c < a && c < b) return std::array<uint32_t, 3>{ c, a, b };
+        return std::array<uint32_t, 3>{ a, b, c };
+    };
+    std::vector<std::array<uint32_t, 3>> source, built;
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        source.push_back(Canonical(mesh.indices[t], mesh.indices[t + 1], mesh.indices[t + 2]));
+
+    for (const Meshlet& m : meshlets)
+    {
+        s.triangles += m.primCount;
+        s.vertices += m.vertexCount;
+        if (m.vertexCount > maxVerts || m.primCount > maxPrims || m.primCount == 0)
+            valid = false;
+
+        const MeshletBounds b = ComputeMeshletBounds(m, verts, prims, positions, sizeof(Vertex));
+        s.radiusSum += b.radius;
+        if (b.coneCutoff < 1.0f)
+            ++s.cullableCones;
+
+        const XMFLOAT3 center = { b.center[0], b.center[1], b.center[2] };
+        const XMFLOAT3 axis = { b.coneAxis[0], b.coneAxis[1], b.coneAxis[2] };
+        const XMFLOAT3 apex = { b.coneApex[0], b.coneApex[1], b.coneApex[2] };
+        const float minDot = std::sqrt((std::max)(1.0f - b.coneCutoff * b.coneCutoff, 0.0f));
+        const float eps = 1e-4f * (b.radius + Length(center));
+
+        for (uint32_t i = 0; i < m.vertexCount; ++i)
+            if (Length(Sub(P(verts[m.vertexOffset + i]), center)) > b.radius + eps)
+                valid = false;
+
+        for (uint32_t p = 0; p < m.primCount; ++p)
+        {
+            const uint32_t packed = prims[m.primOffset + p];
+            const uint32_t l[3] = { packed & 0xFFu, (packed >> 8) & 0xFFu, (packed >> 16) & 0xFFu };
+            if (l[0] >= m.vertexCount || l[1] >= m.vertexCount || l[2] >= m.vertexCount)
+            {
+                valid = false;
+                continue;
+            }
+            const uint32_t g[3] = { verts[m.vertexOffset + l[0]], verts[m.vertexOffset + l[1]], verts[m.vertexOffset + l[2]] };
+            built.push_back(Canonical(g[0], g[1], g[2]));
+
+            if (b.coneCutoff >= 1.0f)
+                continue;
+            const XMFLOAT3 n = Normalize(Cross(Sub(P(g[1]), P(g[0])), Sub(P(g[2]), P(g[0]))));
+            if (Dot(n, n) == 0.0f)
+                continue;
+            if (Dot(n, axis) < minDot - 1e-3f || Dot(Sub(apex, P(g[0])), n) > eps)
+                valid = false;
+        }
+    }
+
+    std::sort(source.begin(), source.end());
+    std::sort(built.begin(), built.end());
+    if (source != built)
+        valid = false;
+    return s;
+}
+
+MeshletBuilderComparison CompareMeshletBuilders(const Mesh& mesh, uint32_t maxVerts, uint32_t maxPrims)
+{
+    MeshletBuilderComparison r;
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> verts, prims;
+
+    auto start = std::chrono::steady_clock::now();
+    BuildMeshlets_Greedy(mesh.indices, maxVerts, maxPrims, meshlets, verts, prims);
+    const double greedyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    r.greedy = AnalyzeMeshlets(mesh, maxVerts, maxPrims, meshlets, verts, prims, r.valid);
+    r.greedy.buildMs = greedyMs;
+
+    const XMFLOAT3* positions = mesh.vertices.empty() ? nullptr : &mesh.vertices[0].Pos;
+    start = std::chrono::steady_clock::now();
+    BuildMeshlets_Clustered(mesh.indices, positions, sizeof(Vertex), mesh.vertices.size(),
+        maxVerts, maxPrims, MeshletConeWeight, meshlets, verts, prims);
+    const double clusteredMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    r.clustered = AnalyzeMeshlets(mesh, maxVerts, maxPrims, meshlets, verts, prims, r.valid);
+    r.clustered.buildMs = clusteredMs;
+    return r;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Meshes.h"
+
+// Построение мешлетов на CPU, без D3D (используется и офлайн-кукером)
+struct Meshlet
+{
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    uint32_t primOffset;
+    uint32_t primCount;
+};
+
+// Для отсечения кластера целиком. Конус нормалей: кластер смотрит от камеры, если
+// dot(normalize(coneApex - cameraPos), coneAxis) >= coneCutoff
+struct MeshletBounds
+{
+    float center[3];
+    float radius;
+    float coneApex[3];
+    float coneCutoff;   // синус раствора конуса; 1 - конус слишком широкий, не отсекает
+    float coneAxis[3];
+    float pad;
+};
+
+// в исходном порядке индексов; для сравнения с кластерным
+void BuildMeshlets_Greedy(
+    const std::vector<uint32_t>& indices,
+    uint32_t maxVerts, uint32_t maxPrims,
+    std::vector<Meshlet>& outMeshlets,
+    std::vector<uint32_t>& outMeshletVertices,
+    std::vector<uint32_t>& outMeshletPrimsPacked);
+
+// Мешлет растёт по смежности: берётся соседний треугольник с наименьшим числом новых вершин,
+// при равенстве - ближайший к центру мешлета и с нормалью ближе к средней (вес coneWeight).
+// Когда соседей нет, добирается ближайший свободный треугольник поблизости, иначе мешлет закрывается
+void BuildMeshlets_Clustered(
+    const std::vector<uint32_t>& indices,
+    const XMFLOAT3* positions, size_t positionStride, size_t vertexCount,
+    uint32_t maxVerts, uint32_t maxPrims, float coneWeight,
+    std::vector<Meshlet>& outMeshlets,
+    std::vector<uint32_t>& outMeshletVertices,
+    std::vector<uint32_t>& outMeshletPrimsPacked);
+
+// описанная сфера (Риттер) и конус нормалей по треугольникам мешлета
+MeshletBounds ComputeMeshletBounds(
+    const Meshlet& meshlet,
+    const std::vector<uint32_t>& meshletVertices,
+    const std::vector<uint32_t>& meshletPrimsPacked,
+    const XMFLOAT3* positions, size_t positionStride);
+
+static const float MeshletConeWeight = 0.25f;
+
+// Блоб мешлетов одного LOD в uint32: [MeshletBounds x N][Meshlet x N][meshletVertices][meshletPrims].
+// Начало блоба кратно MeshletBlobAlignment, тогда обе таблицы читаются как StructuredBuffer
+static const uint32_t MeshletWords = sizeof(Meshlet) / sizeof(uint32_t);
+static const uint32_t MeshletBoundsWords = sizeof(MeshletBounds) / sizeof(uint32_t);
+static const uint32_t MeshletBlobAlignment = MeshletBoundsWords;
+
+struct MeshletBlobInfo
+{
+    uint32_t meshletCount = 0;
+    uint32_t vertexCount = 0;
+    uint32_t primCount = 0;
+
+    // смещения частей в uint32 от начала блоба
+    uint32_t MeshletsOffset() const { return meshletCount * MeshletBoundsWords; }
+    uint32_t VerticesOffset() const { return MeshletsOffset() + meshletCount * MeshletWords; }
+    uint32_t PrimsOffset() const { return VerticesOffset() + vertexCount; }
+    uint32_t Words() const { return PrimsOffset() + primCount; }
+};
+
+MeshletBlobInfo BuildMeshletBlob(
+    const Mesh& mesh,
+    uint32_t maxVerts, uint32_t maxPrims,
+    std::vector<uint32_t>& outBlob);
+
+struct MeshletStats
+{
+    size_t meshlets = 0;
+    size_t triangles = 0;
+    size_t vertices = 0;          // сумма вершин мешлетов, с повторами на границах
+    size_t cullableCones = 0;     // мешлеты с coneCutoff < 1
+    double radiusSum = 0.0;
+    double buildMs = 0.0;
+    uint32_t maxVerts = 0;
+    uint32_t maxPrims = 0;
+
+    double VertsPerTri() const { return triangles ? (double)vertices / triangles : 0.0; }
+    double VertexFill() const { return meshlets ? (double)vertices / ((double)meshlets * maxVerts) : 0.0; }
+    double PrimFill() const { return meshlets ? (double)triangles / ((double)meshlets * maxPrims) : 0.0; }
+    double AvgRadius() const { return meshlets ? radiusSum / meshlets : 0.0; }
+
+    MeshletStats& operator+=(const MeshletStats& o);
+};
+
+struct MeshletBuilderComparison
+{
+    MeshletStats greedy;
+    MeshletStats clustered;
+    bool valid = true;   // каждый треугольник ровно в одном мешлете, сферы и конусы покрывают свои треугольники
+};
+
+// оба построителя на одном меше, с границами и проверкой результата
+MeshletBuilderComparison CompareMeshletBuilders(const Mesh& mesh, uint32_t maxVerts, uint32_t maxPrims);
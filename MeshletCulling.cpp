@@ -0,0 +1,598 @@
+#include "MeshletCulling.h"
+#include "FrustumPlane.h"
+#include "MeshCacheFormat.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    // порядок операций как в MeshletCulling.hlsli: (a.x * b.x + a.y * b.y) + a.z * b.z
+    float Dot3(float ax, float ay, float az, float bx, float by, float bz)
+    {
+        return (ax * bx + ay * by) + az * bz;
+    }
+
+    bool OutsideFrustum(const MeshletBounds& b, const MeshletCullConstants& c)
+    {
+        const float negRadius = -b.radius;
+        for (int i = 0; i < 6; ++i)
+        {
+            const XMFLOAT4& p = c.planes[i];
+            const float d = Dot3(p.x, p.y, p.z, b.center[0], b.center[1], b.center[2]) + p.w;
+            if (d < negRadius)
+                return true;
+        }
+        return false;
+    }
+
+    // dot(normalize(apex - camera), axis) >= cutoff без корня: t > 0 и t^2 >= cutoff^2 * |d|^2
+    bool BackfacingCone(const MeshletBounds& b, const MeshletCullConstants& c)
+    {
+        if (!(b.coneCutoff < 1.0f))
+            return false;
+
+        const float dx = b.coneApex[0] - c.cameraPos.x;
+        const float dy = b.coneApex[1] - c.cameraPos.y;
+        const float dz = b.coneApex[2] - c.cameraPos.z;
+        const float t = Dot3(dx, dy, dz, b.coneAxis[0], b.coneAxis[1], b.coneAxis[2]);
+        if (!(t > 0.0f))
+            return false;
+
+        const float dd = Dot3(dx, dy, dz, dx, dy, dz);
+        return t * t >= (b.coneCutoff * b.coneCutoff) * dd;
+    }
+
+    // Наибольшее i из [-1, size] с 2i * w <= num, то есть floor(num / 2w) без деления в ответе:
+    // произведение монотонно по i, поэтому результат не зависит от точности приближения q
+    int PixelFloor(float num, float w, int size)
+    {
+        float q = num / (2.0f * w);
+        q = q > -1.0f ? (q < (float)size ? q : (float)size) : -1.0f;
+        int i = (int)(q + 1.0f) - 1;   // q >= -1, усечение = floor
+        while (i < size && (float)(2 * (i + 1)) * w <= num)
+            ++i;
+        while (i > -1 && !((float)(2 * i) * w <= num))
+            --i;
+        return i;
+    }
+
+    uint32_t HiZMipWidth(uint32_t depthWidth, uint32_t mip)
+    {
+        return (std::max)(1u, (std::max)(1u, depthWidth >> 1) >> mip);
+    }
+
+    // куб вокруг сферы в клипе кадра глубины; перекрыт, если ближайший угол дальше максимума HiZ
+    // под его прямоугольником на экране
+    bool Occluded(const MeshletBounds& b, const MeshletCullConstants& c, const HiZPyramid& hiz)
+    {
+        const XMFLOAT4X4& m = c.occluderViewProj;
+        const int width = (int)c.depthWidth;
+        const int height = (int)c.depthHeight;
+
+        float cornerZ[8], cornerW[8];
+        int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+        for (int k = 0; k < 8; ++k)
+        {
+            const float px = (k & 1) ? b.center[0] + b.radius : b.center[0] - b.radius;
+            const float py = (k & 2) ? b.center[1] + b.radius : b.center[1] - b.radius;
+            const float pz = (k & 4) ? b.center[2] + b.radius : b.center[2] - b.radius;
+
+            const float x = Dot3(px, py, pz, m._11, m._21, m._31) + m._41;
+            const float y = Dot3(px, py, pz, m._12, m._22, m._32) + m._42;
+            const float z = Dot3(px, py, pz, m._13, m._23, m._33) + m._43;
+            const float w = Dot3(px, py, pz, m._14, m._24, m._34) + m._44;
+
+            // угол у камеры или за ней - прямоугольник не ограничен
+            if (!(w > 0.0f))
+                return false;
+
+            // u = (x / w + 1) / 2, v = (1 - y / w) / 2
+            const int ix = PixelFloor((x + w) * (float)width, w, width);
+            const int iy = PixelFloor((w - y) * (float)height, w, height);
+            x0 = (std::min)(x0, ix); x1 = (std::max)(x1, ix);
+            y0 = (std::min)(y0, iy); y1 = (std::max)(y1, iy);
+            cornerZ[k] = z;
+            cornerW[k] = w;
+        }
+
+        // вне экрана - дело пирамиды видимости
+        if (x1 < 0 || y1 < 0 || x0 >= width || y0 >= height)
+            return false;
+        x0 = (std::max)(x0, 0); y0 = (std::max)(y0, 0);
+        x1 = (std::min)(x1, width - 1); y1 = (std::min)(y1, height - 1);
+
+        // самый мелкий уровень, где прямоугольник ложится в 2x2 текселя
+        uint32_t mip = 0;
+        int tx0, tx1, ty0, ty1;
+        for (;;)
+        {
+            const int s = (int)mip + 1;
+            const int mw = (int)HiZMipWidth(c.depthWidth, mip);
+            const int mh = (int)HiZMipWidth(c.depthHeight, mip);
+            tx0 = (std::min)(x0 >> s, mw - 1); tx1 = (std::min)(x1 >> s, mw - 1);
+            ty0 = (std::min)(y0 >> s, mh - 1); ty1 = (std::min)(y1 >> s, mh - 1);
+            if ((tx1 - tx0 <= 1 && ty1 - ty0 <= 1) || mip + 1 >= c.hizMips)
+                break;
+            ++mip;
+        }
+
+        const std::vector<float>& level = hiz.mips[mip];
+        const size_t pitch = hiz.widths[mip];
+        const float maxDepth = (std::max)(
+            (std::max)(level[ty0 * pitch + tx0], level[ty0 * pitch + tx1]),
+            (std::max)(level[ty1 * pitch + tx0], level[ty1 * pitch + tx1]));
+
+        for (int k = 0; k < 8; ++k)
+            if (!(cornerZ[k] > maxDepth * cornerW[k]))
+                return false;
+        return true;
+    }
+}
+
+MeshletCullConstants MakeMeshletCullConstants(const XMFLOAT4X4& world, const MeshletCullView& view, uint32_t meshletCount)
+{
+    MeshletCullConstants c{};
+    const XMMATRIX W = XMLoadFloat4x4(&world);
+
+    // плоскости World * ViewProj сразу в пространстве объекта
+    ExtractFrustumPlanes(c.planes, W * XMLoadFloat4x4(&view.viewProj));
+    XMStoreFloat4x4(&c.occluderViewProj, W * XMLoadFloat4x4(&view.occluderViewProj));
+
+    c.flags = view.flags;
+    XMVECTOR det;
+    const XMMATRIX invW = XMMatrixInverse(&det, W);
+    if (!(XMVectorGetX(det) > 0.0f))
+    {
+        // отражение меняет обход треугольников, вырожденная матрица - обратной нет
+        c.flags &= ~MeshletCullCone;
+        c.cameraPos = { 0.0f, 0.0f, 0.0f };
+    }
+    else
+    {
+        XMStoreFloat3(&c.cameraPos, XMVector3TransformCoord(XMLoadFloat3(&view.cameraPos), invW));
+    }
+
+    c.depthWidth = view.depthWidth;
+    c.depthHeight = view.depthHeight;
+    c.hizMips = HiZMipCount(view.depthWidth, view.depthHeight);
+    if (c.hizMips == 0)
+        c.flags &= ~MeshletCullOcclusion;
+    c.meshletCount = meshletCount;
+    return c;
+}
+
+uint32_t HiZMipCount(uint32_t depthWidth, uint32_t depthHeight)
+{
+    if (depthWidth == 0 || depthHeight == 0)
+        return 0;
+    uint32_t size = (std::max)(HiZMipWidth(depthWidth, 0), HiZMipWidth(depthHeight, 0));
+    uint32_t mips = 1;
+    while (size > 1)
+    {
+        size >>= 1;
+        ++mips;
+    }
+    return mips;
+}
+
+HiZPyramid BuildHiZPyramid(const float* depth, uint32_t width, uint32_t height, size_t rowPitch)
+{
+    HiZPyramid hiz;
+    hiz.depthWidth = width;
+    hiz.depthHeight = height;
+
+    const uint32_t mips = HiZMipCount(width, height);
+    hiz.widths.resize(mips);
+    hiz.heights.resize(mips);
+    hiz.mips.resize(mips);
+
+    for (uint32_t m = 0; m < mips; ++m)
+    {
+        const uint32_t w = HiZMipWidth(width, m);
+        const uint32_t h = HiZMipWidth(height, m);
+        const uint32_t srcW = m == 0 ? width : hiz.widths[m - 1];
+        const uint32_t srcH = m == 0 ? height : hiz.heights[m - 1];
+        auto Src = [&](uint32_t x, uint32_t y) {
+            return m == 0
+                ? *reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(depth) + y * rowPitch + x * sizeof(float))
+                : hiz.mips[m - 1][(size_t)y * srcW + x];
+        };
+
+        hiz.widths[m] = w;
+        hiz.heights[m] = h;
+        std::vector<float>& dst = hiz.mips[m];
+        dst.resize((size_t)w * h);
+        for (uint32_t y = 0; y < h; ++y)
+        {
+            const uint32_t lastY = y == h - 1 ? srcH - 1 : (std::min)(2 * y + 1, srcH - 1);
+            for (uint32_t x = 0; x < w; ++x)
+            {
+                const uint32_t lastX = x == w - 1 ? srcW - 1 : (std::min)(2 * x + 1, srcW - 1);
+                float d = 0.0f;
+                for (uint32_t sy = 2 * y; sy <= lastY; ++sy)
+                    for (uint32_t sx = 2 * x; sx <= lastX; ++sx)
+                        d = (std::max)(d, Src(sx, sy));
+                dst[(size_t)y * w + x] = d;
+            }
+        }
+    }
+    return hiz;
+}
+
+MeshletCullResult CullMeshlet(const MeshletBounds& bounds, const MeshletCullConstants& c, const HiZPyramid* hiz)
+{
+    if ((c.flags & MeshletCullFrustum) && OutsideFrustum(bounds, c))
+        return MeshletCullResult::Frustum;
+    if ((c.flags & MeshletCullCone) && BackfacingCone(bounds, c))
+        return MeshletCullResult::Cone;
+    if ((c.flags & MeshletCullOcclusion) && hiz && hiz->depthWidth == c.depthWidth &&
+        hiz->depthHeight == c.depthHeight && hiz->mips.size() == c.hizMips && Occluded(bounds, c, *hiz))
+        return MeshletCullResult::Occluded;
+    return MeshletCullResult::Visible;
+}
+
+MeshletCullStats& MeshletCullStats::operator+=(const MeshletCullStats& o)
+{
+    tested += o.tested;
+    visible += o.visible;
+    frustum += o.frustum;
+    cone += o.cone;
+    occluded += o.occluded;
+    return *this;
+}
+
+uint32_t CullMeshlets(const MeshletBounds* bounds, uint32_t count, const MeshletCullConstants& c,
+    const HiZPyramid* hiz, uint32_t* outVisible, MeshletCullStats* stats)
+{
+    uint32_t visible = 0;
+    MeshletCullStats s;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        switch (CullMeshlet(bounds[i], c, hiz))
+        {
+        case MeshletCullResult::Visible: outVisible[visible++] = i; break;
+        case MeshletCullResult::Frustum: ++s.frustum; break;
+        case MeshletCullResult::Cone: ++s.cone; break;
+        case MeshletCullResult::Occluded: ++s.occluded; break;
+        }
+    }
+    s.tested = count;
+    s.visible = visible;
+    if (stats)
+        *stats += s;
+    return visible;
+}
+
+MeshletCullValidation& MeshletCullValidation::operator+=(const MeshletCullValidation& o)
+{
+    meshlets += o.meshlets;
+    gpuVisible += o.gpuVisible;
+    cpuVisible += o.cpuVisible;
+    mismatches += o.mismatches;
+    occlusion = occlusion || o.occlusion;
+    return *this;
+}
+
+MeshletCullValidation ValidateMeshletCulling(const MeshletBounds* bounds, uint32_t count, const MeshletCullConstants& c,
+    const HiZPyramid* hiz, const uint32_t* gpuVisibility)
+{
+    MeshletCullValidation v;
+    v.meshlets = count;
+    v.occlusion = (c.flags & MeshletCullOcclusion) && hiz;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const bool cpu = CullMeshlet(bounds[i], c, hiz) == MeshletCullResult::Visible;
+        const bool gpu = gpuVisibility[i] != 0;
+        v.cpuVisible += cpu ? 1 : 0;
+        v.gpuVisible += gpu ? 1 : 0;
+        v.mismatches += cpu != gpu ? 1 : 0;
+    }
+    return v;
+}
+
+namespace
+{
+    struct CullTestMesh
+    {
+        const Mesh* mesh = nullptr;
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> vertices;
+        std::vector<uint32_t> prims;
+        std::vector<MeshletBounds> bounds;
+        XMFLOAT3 center = { 0.0f, 0.0f, 0.0f };
+        float radius = 0.0f;
+    };
+
+    CullTestMesh PrepareCullTestMesh(const Mesh& mesh)
+    {
+        CullTestMesh t;
+        t.mesh = &mesh;
+        if (mesh.indices.empty())
+            return t;
+
+        const XMFLOAT3* positions = &mesh.vertices[0].Pos;
+        BuildMeshlets_Clustered(mesh.indices, positions, sizeof(Vertex), mesh.vertices.size(),
+            MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims, MeshletConeWeight, t.meshlets, t.vertices, t.prims);
+        for (const Meshlet& m : t.meshlets)
+            t.bounds.push_back(ComputeMeshletBounds(m, t.vertices, t.prims, positions, sizeof(Vertex)));
+
+        XMVECTOR mn = XMVectorReplicate(INFINITY), mx = XMVectorReplicate(-INFINITY);
+        for (const Vertex& v : mesh.vertices)
+        {
+            mn = XMVectorMin(mn, XMLoadFloat3(&v.Pos));
+            mx = XMVectorMax(mx, XMLoadFloat3(&v.Pos));
+        }
+        XMStoreFloat3(&t.center, (mn + mx) * 0.5f);
+        t.radius = XMVectorGetX(XMVector3Length(mx - mn)) * 0.5f;
+        return t;
+    }
+
+    MeshletCullView MakeTestView(FXMVECTOR eye, FXMVECTOR at, float nearZ, float farZ, uint32_t width, uint32_t height, uint32_t flags)
+    {
+        MeshletCullView view;
+        const XMMATRIX viewProj = XMMatrixLookAtLH(eye, at, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+            XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)width / height, nearZ, farZ);
+        XMStoreFloat4x4(&view.viewProj, viewProj);
+        view.occluderViewProj = view.viewProj;
+        XMStoreFloat3(&view.cameraPos, eye);
+        view.depthWidth = width;
+        view.depthHeight = height;
+        view.flags = flags;
+        return view;
+    }
+
+    // глубина стены на расстоянии wallDist перед камерой; закрывает левую долю экрана coverage
+    std::vector<float> MakeWallDepth(const MeshletCullView& view, FXMVECTOR eye, FXMVECTOR at, float wallDist, float coverage)
+    {
+        const XMVECTOR p = eye + XMVector3Normalize(at - eye) * wallDist;
+        const XMVECTOR clip = XMVector4Transform(XMVectorSetW(p, 1.0f), XMLoadFloat4x4(&view.viewProj));
+        const float wallDepth = XMVectorGetZ(clip) / XMVectorGetW(clip);
+
+        std::vector<float> depth((size_t)view.depthWidth * view.depthHeight, 1.0f);
+        const uint32_t wallWidth = (uint32_t)(coverage * view.depthWidth);
+        for (uint32_t y = 0; y < view.depthHeight; ++y)
+            for (uint32_t x = 0; x < wallWidth; ++x)
+                depth[(size_t)y * view.depthWidth + x] = wallDepth;
+        return depth;
+    }
+}
+
+MeshletCullBenchmarkResult BenchmarkMeshletCulling(const std::vector<Mesh>& meshes, uint32_t views,
+    uint32_t depthWidth, uint32_t depthHeight)
+{
+    MeshletCullBenchmarkResult r;
+    r.depthWidth = depthWidth;
+    r.depthHeight = depthHeight;
+
+    XMFLOAT4X4 identity;
+    XMStoreFloat4x4(&identity, XMMatrixIdentity());
+    std::vector<uint32_t> visible;
+
+    for (const Mesh& mesh : meshes)
+    {
+        const CullTestMesh t = PrepareCullTestMesh(mesh);
+        if (t.bounds.empty() || !(t.radius > 0.0f))
+            continue;
+        visible.resize(t.bounds.size());
+
+        for (uint32_t v = 0; v < views; ++v)
+        {
+            // камера по кругу смотрит в сторону на ~30 градусов: центр ещё в кадре, дальний край меша уже за ним
+            const float angle = XM_2PI * v / views;
+            const XMVECTOR center = XMLoadFloat3(&t.center);
+            const XMVECTOR eye = center + XMVectorSet(std::cos(angle), 0.3f, std::sin(angle), 0.0f) * (2.5f * t.radius);
+            const XMVECTOR at = center + XMVectorSet(-std::sin(angle), 0.0f, std::cos(angle), 0.0f) * (1.5f * t.radius);
+            const MeshletCullView view = MakeTestView(eye, at, 0.01f * t.radius, 10.0f * t.radius, depthWidth, depthHeight,
+                MeshletCullFrustum | MeshletCullCone | MeshletCullOcclusion);
+            const std::vector<float> depth = MakeWallDepth(view, eye, at, 0.8f * t.radius, 0.3f);
+            ++r.views;
+
+            auto start = std::chrono::steady_clock::now();
+            const HiZPyramid hiz = BuildHiZPyramid(depth.data(), depthWidth, depthHeight, depthWidth * sizeof(float));
+            r.hizBuildMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            const MeshletCullConstants c = MakeMeshletCullConstants(identity, view, (uint32_t)t.bounds.size());
+            auto Time = [&](uint32_t flags, double& ms, MeshletCullStats* stats) {
+                MeshletCullConstants one = c;
+                one.flags = flags;
+                const auto begin = std::chrono::steady_clock::now();
+                CullMeshlets(t.bounds.data(), (uint32_t)t.bounds.size(), one, &hiz, visible.data(), stats);
+                ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            };
+            Time(MeshletCullFrustum, r.frustumMs, nullptr);
+            Time(MeshletCullCone, r.coneMs, nullptr);
+            Time(MeshletCullOcclusion, r.occlusionMs, nullptr);
+            Time(c.flags, r.cullMs, &r.stats);
+        }
+    }
+    return r;
+}
+
+MeshletCullSelfTest RunMeshletCullSelfTest()
+{
+    MeshletCullSelfTest r;
+    auto Check = [&](bool ok) { ++r.checks; if (!ok) ++r.failures; };
+
+    // пирамида против перебора, в том числе нечётные и вырожденные размеры
+    {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        const uint32_t sizes[][2] = { { 37, 23 }, { 64, 1 }, { 1, 1 }, { 5, 130 }, { 2, 3 } };
+        for (const auto& size : sizes)
+        {
+            const uint32_t w = size[0], h = size[1];
+            std::vector<float> depth((size_t)w * h);
+            for (float& d : depth) d = dist(rng);
+            const HiZPyramid hiz = BuildHiZPyramid(depth.data(), w, h, w * sizeof(float));
+            Check(hiz.mips.size() == HiZMipCount(w, h) && hiz.widths.back() == 1 && hiz.heights.back() == 1);
+
+            for (uint32_t m = 0; m < hiz.mips.size(); ++m)
+            {
+                std::vector<float> expected((size_t)hiz.widths[m] * hiz.heights[m], 0.0f);
+                for (uint32_t y = 0; y < h; ++y)
+                    for (uint32_t x = 0; x < w; ++x)
+                    {
+                        const uint32_t tx = (std::min)(x >> (m + 1), hiz.widths[m] - 1);
+                        const uint32_t ty = (std::min)(y >> (m + 1), hiz.heights[m] - 1);
+                        float& e = expected[(size_t)ty * hiz.widths[m] + tx];
+                        e = (std::max)(e, depth[(size_t)y * w + x]);
+                    }
+                Check(expected == hiz.mips[m]);
+            }
+        }
+    }
+
+    // очевидные случаи на одиночных сферах: камера в начале координат смотрит вдоль +z
+    {
+        XMFLOAT4X4 identity;
+        XMStoreFloat4x4(&identity, XMMatrixIdentity());
+        const XMVECTOR eye = XMVectorZero(), at = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+        const MeshletCullView view = MakeTestView(eye, at, 0.1f, 100.0f, 64, 64,
+            MeshletCullFrustum | MeshletCullCone | MeshletCullOcclusion);
+        const MeshletCullConstants c = MakeMeshletCullConstants(identity, view, 1);
+
+        auto Sphere = [](float x, float y, float z, float r) {
+            MeshletBounds b{};
+            b.center[0] = x; b.center[1] = y; b.center[2] = z; b.radius = r;
+            b.coneApex[0] = x; b.coneApex[1] = y; b.coneApex[2] = z;
+            b.coneAxis[2] = 1.0f; b.coneCutoff = 1.0f;
+            return b;
+        };
+        auto Cone = [&](float axisZ, float cutoff) {
+            MeshletBounds b = Sphere(0.0f, 0.0f, 5.0f, 1.0f);
+            b.coneApex[2] = 4.0f; b.coneAxis[2] = axisZ; b.coneCutoff = cutoff;
+            return b;
+        };
+
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, 5.0f, 1.0f), c, nullptr) == MeshletCullResult::Visible);
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, -5.0f, 1.0f), c, nullptr) == MeshletCullResult::Frustum);
+        Check(CullMeshlet(Sphere(50.0f, 0.0f, 5.0f, 1.0f), c, nullptr) == MeshletCullResult::Frustum);
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, 200.0f, 1.0f), c, nullptr) == MeshletCullResult::Frustum);
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, -0.5f, 1.0f), c, nullptr) == MeshletCullResult::Visible);
+        Check(CullMeshlet(Cone(1.0f, 0.5f), c, nullptr) == MeshletCullResult::Cone);
+        Check(CullMeshlet(Cone(-1.0f, 0.5f), c, nullptr) == MeshletCullResult::Visible);
+        Check(CullMeshlet(Cone(1.0f, 1.0f), c, nullptr) == MeshletCullResult::Visible);
+        Check(CullMeshlet(Cone(1.0f, 0.0f), c, nullptr) == MeshletCullResult::Cone);
+
+        MeshletCullConstants noCone = c;
+        noCone.flags &= ~MeshletCullCone;
+        Check(CullMeshlet(Cone(1.0f, 0.5f), noCone, nullptr) == MeshletCullResult::Visible);
+
+        // стена на всю ширину на расстоянии 2: за ней перекрыто, перед ней и вокруг камеры - нет
+        const std::vector<float> wall = MakeWallDepth(view, eye, at, 2.0f, 1.0f);
+        const HiZPyramid hiz = BuildHiZPyramid(wall.data(), 64, 64, 64 * sizeof(float));
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, 5.0f, 1.0f), c, &hiz) == MeshletCullResult::Occluded);
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, 1.5f, 0.2f), c, &hiz) == MeshletCullResult::Visible);
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, 0.5f, 1.0f), c, &hiz) == MeshletCullResult::Visible);
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, 5.0f, 1.0f), c, nullptr) == MeshletCullResult::Visible);
+
+        MeshletCullConstants otherSize = c;
+        otherSize.depthWidth = 32;
+        Check(CullMeshlet(Sphere(0.0f, 0.0f, 5.0f, 1.0f), otherSize, &hiz) == MeshletCullResult::Visible);
+
+        // отражение: конус не применяется
+        XMFLOAT4X4 mirror;
+        XMStoreFloat4x4(&mirror, XMMatrixScaling(-1.0f, 1.0f, 1.0f));
+        Check((MakeMeshletCullConstants(mirror, view, 1).flags & MeshletCullCone) == 0);
+    }
+
+    // Консервативность на сфере под случайными камерами и матрицами World: отброшенный мешлет
+    // проверяется по своим вершинам и треугольникам
+    {
+        const Mesh sphere = CreateSphere(96, 96, 1.0f);
+        const CullTestMesh t = PrepareCullTestMesh(sphere);
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::vector<uint32_t> visible(t.bounds.size());
+        const uint32_t width = 160, height = 90;
+
+        for (int iter = 0; iter < 64; ++iter)
+        {
+            const XMMATRIX W = XMMatrixScaling(1.0f + 0.5f * unit(rng), 1.0f + 0.5f * unit(rng), 1.0f + 0.5f * unit(rng)) *
+                XMMatrixRotationRollPitchYaw(unit(rng) * XM_PI, unit(rng) * XM_PI, unit(rng) * XM_PI) *
+                XMMatrixTranslation(unit(rng), unit(rng), unit(rng));
+            XMFLOAT4X4 world;
+            XMStoreFloat4x4(&world, W);
+
+            const XMVECTOR dir = XMVector3Normalize(XMVectorSet(unit(rng), unit(rng), unit(rng), 0.0f));
+            const XMVECTOR eye = dir * (2.0f + 3.0f * (0.5f + 0.5f * unit(rng)));
+            const XMVECTOR at = XMVectorSet(unit(rng), unit(rng), unit(rng), 0.0f);
+            const MeshletCullView view = MakeTestView(eye, at, 0.05f, 50.0f, width, height,
+                MeshletCullFrustum | MeshletCullCone | MeshletCullOcclusion);
+            const float wallDist = XMVectorGetX(XMVector3Length(eye)) - 1.0f - 0.5f * (0.5f + 0.5f * unit(rng));
+            const std::vector<float> depth = MakeWallDepth(view, eye, at, wallDist, 0.5f + 0.5f * unit(rng));
+            const HiZPyramid hiz = BuildHiZPyramid(depth.data(), width, height, width * sizeof(float));
+
+            const MeshletCullConstants c = MakeMeshletCullConstants(world, view, (uint32_t)t.bounds.size());
+            const uint32_t count = CullMeshlets(t.bounds.data(), (uint32_t)t.bounds.size(), c, &hiz, visible.data(), &r.stats);
+            for (uint32_t i = 1; i < count; ++i)
+                Check(visible[i - 1] < visible[i]);
+
+            XMFLOAT4 worldPlanes[6];
+            ExtractFrustumPlanes(worldPlanes, XMLoadFloat4x4(&view.viewProj));
+            const XMMATRIX viewProj = XMLoadFloat4x4(&view.viewProj);
+
+            for (size_t i = 0; i < t.meshlets.size(); ++i)
+            {
+                const MeshletCullResult result = CullMeshlet(t.bounds[i], c, &hiz);
+                if (result == MeshletCullResult::Visible)
+                    continue;
+
+                const Meshlet& m = t.meshlets[i];
+                std::vector<XMVECTOR> p(m.vertexCount);
+                for (uint32_t k = 0; k < m.vertexCount; ++k)
+                    p[k] = XMVector3TransformCoord(XMLoadFloat3(&sphere.vertices[t.vertices[m.vertexOffset + k]].Pos), W);
+
+                bool ok = true;
+                if (result == MeshletCullResult::Frustum)
+                {
+                    ok = false;
+                    for (const XMFLOAT4& plane : worldPlanes)
+                    {
+                        bool allOutside = true;
+                        for (const XMVECTOR& v : p)
+                            allOutside = allOutside && XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&plane), v)) < 1e-4f;
+                        ok = ok || allOutside;
+                    }
+                }
+                else if (result == MeshletCullResult::Cone)
+                {
+                    for (uint32_t k = 0; k < m.primCount; ++k)
+                    {
+                        const uint32_t packed = t.prims[m.primOffset + k];
+                        const XMVECTOR a = p[packed & 0xFFu], b = p[(packed >> 8) & 0xFFu], cc = p[(packed >> 16) & 0xFFu];
+                        const XMVECTOR n = XMVector3Cross(b - a, cc - a);
+                        const float facing = XMVectorGetX(XMVector3Dot(n, eye - a));
+                        const float scale = XMVectorGetX(XMVector3Length(n)) * XMVectorGetX(XMVector3Length(eye - a));
+                        ok = ok && facing <= 1e-3f * scale;
+                    }
+                }
+                else
+                {
+                    for (const XMVECTOR& v : p)
+                    {
+                        const XMVECTOR clip = XMVector4Transform(XMVectorSetW(v, 1.0f), viewProj);
+                        const float w = XMVectorGetW(clip);
+                        ok = ok && w > 0.0f;
+                        if (!(w > 0.0f)) break;
+                        const float u = (XMVectorGetX(clip) / w * 0.5f + 0.5f) * width;
+                        const float vv = (0.5f - XMVectorGetY(clip) / w * 0.5f) * height;
+                        if (u < 0.0f || vv < 0.0f || u >= width || vv >= height)
+                            continue;
+                        const float z = XMVectorGetZ(clip) / w;
+                        ok = ok && z >= depth[(size_t)vv * width + (size_t)u] - 1e-5f;
+                    }
+                }
+                Check(ok);
+            }
+        }
+
+        // без каждого вида отсечения проверка ничего бы не значила
+        Check(r.stats.frustum != 0 && r.stats.cone != 0 && r.stats.occluded != 0 && r.stats.visible != 0);
+    }
+
+    return r;
+}
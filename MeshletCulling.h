@@ -0,0 +1,133 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshletBuilder.h"
+
+// Отсечение мешлетов: пирамида видимости, конус нормалей и HiZ. На GPU то же делает AS_MeshletCull
+// (Shaders.hlsl, MeshletCulling.hlsli). Тесты обходятся сложением, умножением и сравнением в одном
+// и том же порядке (в шейдере под precise), деления и корни посчитаны заранее на CPU, а D3D требует
+// для сложения и умножения точного округления - поэтому решения CPU и GPU совпадают до бита.
+// Исключение - денормалы, их GPU сбрасывает в ноль.
+
+enum MeshletCullFlags : uint32_t
+{
+    MeshletCullFrustum = 1u << 0,
+    MeshletCullCone = 1u << 1,
+    MeshletCullOcclusion = 1u << 2,
+    MeshletCullWriteVisibility = 1u << 3,   // AS пишет результат каждого мешлета для сверки с CPU
+};
+
+// = cbuffer MeshletCullCB в Shaders.hlsl, одна на объект
+struct MeshletCullConstants
+{
+    XMFLOAT4 planes[6];            // в пространстве объекта, нормированные, внутри положительны
+    XMFLOAT3 cameraPos;            // в пространстве объекта
+    uint32_t flags;
+    XMFLOAT4X4 occluderViewProj;   // объект -> клип кадра, из глубины которого построен HiZ
+    uint32_t depthWidth;
+    uint32_t depthHeight;
+    uint32_t hizMips;
+    uint32_t meshletCount;
+    uint32_t visibilityOffset;     // для MeshletCullWriteVisibility
+    uint32_t pad[3];
+};
+static_assert(sizeof(MeshletCullConstants) == 208, "MeshletCullConstants layout is shared with shaders");
+
+// Камера кадра; матрицы row-major, как в PassCB
+struct MeshletCullView
+{
+    XMFLOAT4X4 viewProj;
+    XMFLOAT3 cameraPos;
+    XMFLOAT4X4 occluderViewProj;   // кадр глубины HiZ, обычно прошлый
+    uint32_t depthWidth = 0;
+    uint32_t depthHeight = 0;
+    uint32_t flags = MeshletCullFrustum | MeshletCullCone;
+};
+
+// Переводит камеру в пространство объекта. Конус отключается, если World отражает или вырожден
+MeshletCullConstants MakeMeshletCullConstants(const XMFLOAT4X4& world, const MeshletCullView& view, uint32_t meshletCount);
+
+// Пирамида максимумов глубины. Уровень 0 - половина глубины, размеры уровней как у mip-цепочки D3D
+// (с округлением вниз), последний тексель нечётного ряда забирает три дочерних. Тогда пиксель x
+// глубины лежит в текселе min(x >> (m + 1), width(m) - 1) уровня m. CS_BuildHiZ (HiZ.hlsl) строит ту же
+struct HiZPyramid
+{
+    uint32_t depthWidth = 0;
+    uint32_t depthHeight = 0;
+    std::vector<uint32_t> widths;
+    std::vector<uint32_t> heights;
+    std::vector<std::vector<float>> mips;
+};
+
+uint32_t HiZMipCount(uint32_t depthWidth, uint32_t depthHeight);
+// depth - строки с шагом rowPitch байт
+HiZPyramid BuildHiZPyramid(const float* depth, uint32_t width, uint32_t height, size_t rowPitch);
+
+enum class MeshletCullResult : uint8_t { Visible, Frustum, Cone, Occluded };
+
+// hiz == nullptr или другого размера - окклюзия пропускается
+MeshletCullResult CullMeshlet(const MeshletBounds& bounds, const MeshletCullConstants& c, const HiZPyramid* hiz);
+
+struct MeshletCullStats
+{
+    size_t tested = 0;
+    size_t visible = 0;
+    size_t frustum = 0;
+    size_t cone = 0;
+    size_t occluded = 0;
+
+    MeshletCullStats& operator+=(const MeshletCullStats& o);
+};
+
+// Программный путь без AS: индексы видимых мешлетов по возрастанию, как их упаковывает AS_MeshletCull.
+// Возвращает их число
+uint32_t CullMeshlets(const MeshletBounds* bounds, uint32_t count, const MeshletCullConstants& c,
+    const HiZPyramid* hiz, uint32_t* outVisible, MeshletCullStats* stats = nullptr);
+
+// сверка с флагами видимости, которые записал AS (MeshletCullWriteVisibility)
+struct MeshletCullValidation
+{
+    size_t meshlets = 0;
+    size_t gpuVisible = 0;
+    size_t cpuVisible = 0;
+    size_t mismatches = 0;
+    bool occlusion = false;
+
+    MeshletCullValidation& operator+=(const MeshletCullValidation& o);
+};
+
+MeshletCullValidation ValidateMeshletCulling(const MeshletBounds* bounds, uint32_t count, const MeshletCullConstants& c,
+    const HiZPyramid* hiz, const uint32_t* gpuVisibility);
+
+struct MeshletCullBenchmarkResult
+{
+    MeshletCullStats stats;
+    uint32_t views = 0;   // по всем мешам
+    uint32_t depthWidth = 0;
+    uint32_t depthHeight = 0;
+    double hizBuildMs = 0.0;
+    double cullMs = 0.0;        // все тесты вместе, по ним и stats
+    double frustumMs = 0.0;     // каждый тест отдельно на тех же видах
+    double coneMs = 0.0;
+    double occlusionMs = 0.0;
+
+    double NsPerMeshlet(double ms) const { return stats.tested ? ms * 1e6 / stats.tested : 0.0; }
+};
+
+// Камеры по кругу вокруг каждого меша смотрят мимо центра, так что часть мешлетов выходит за край кадра;
+// окклюдер - стена на треть экрана между камерой и мешем
+MeshletCullBenchmarkResult BenchmarkMeshletCulling(const std::vector<Mesh>& meshes, uint32_t views,
+    uint32_t depthWidth = 1280, uint32_t depthHeight = 720);
+
+// Проверки на сфере под случайными World и камерами: каждый отброшенный мешлет действительно невидим (все вершины за одной
+// плоскостью пирамиды, все треугольники задом к камере, все вершины за стеной в буфере глубины),
+// очевидные случаи на заданных вручную границах, пирамида совпадает с перебором
+struct MeshletCullSelfTest
+{
+    size_t checks = 0;
+    size_t failures = 0;
+    MeshletCullStats stats;
+};
+
+MeshletCullSelfTest RunMeshletCullSelfTest();
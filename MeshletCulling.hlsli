@@ -0,0 +1,153 @@
+//   ,      MeshletCulling.cpp:   
+//    , precise      mad.   HiZPixelFloor  
+//  ,    -     CPU  .
+
+// = MeshletBounds  MeshletBuilder.h
+struct MeshletBounds
+{
+    float3 center;
+    float radius;
+    float3 coneApex;
+    float coneCutoff;
+    float3 coneAxis;
+    float pad;
+};
+
+// = MeshletCullFlags
+#define MESHLET_CULL_FRUSTUM 1u
+#define MESHLET_CULL_CONE 2u
+#define MESHLET_CULL_OCCLUSION 4u
+#define MESHLET_CULL_WRITE_VISIBILITY 8u
+
+float CullDot3(float3 a, float3 b)
+{
+    precise float r = (a.x * b.x + a.y * b.y) + a.z * b.z;
+    return r;
+}
+
+bool MeshletOutsideFrustum(MeshletBounds b, float4 planes[6])
+{
+    [unroll]
+    for (uint i = 0; i < 6; ++i)
+    {
+        precise float d = CullDot3(planes[i].xyz, b.center) + planes[i].w;
+        if (d < -b.radius)
+            return true;
+    }
+    return false;
+}
+
+bool MeshletBackfacing(MeshletBounds b, float3 cameraPos)
+{
+    if (!(b.coneCutoff < 1.0))
+        return false;
+
+    precise float3 d = b.coneApex - cameraPos;
+    precise float t = CullDot3(d, b.coneAxis);
+    if (!(t > 0.0))
+        return false;
+
+    precise float dd = CullDot3(d, d);
+    precise float lhs = t * t;
+    precise float rhs = (b.coneCutoff * b.coneCutoff) * dd;
+    return lhs >= rhs;
+}
+
+//  i  [-1, size]  2i * w <= num
+int HiZPixelFloor(float num, float w, int size)
+{
+    float q = num / (2.0 * w);
+    q = q > -1.0 ? min(q, (float)size) : -1.0;
+    int i = (int)(q + 1.0) - 1;
+    [loop]
+    while (i < size)
+    {
+        precise float next = (float)(2 * (i + 1)) * w;
+        if (!(next <= num))
+            break;
+        ++i;
+    }
+    [loop]
+    while (i > -1)
+    {
+        precise float cur = (float)(2 * i) * w;
+        if (cur <= num)
+            break;
+        --i;
+    }
+    return i;
+}
+
+uint HiZMipSize(uint depthSize, uint mip)
+{
+    return max(1u, max(1u, depthSize >> 1) >> mip);
+}
+
+// hiz -    HiZ.hlsl, occluderViewProj      
+bool MeshletOccluded(MeshletBounds b, float4x4 occluderViewProj, uint2 depthSize, uint hizMips, Texture2D<float> hiz)
+{
+    const int width = (int)depthSize.x;
+    const int height = (int)depthSize.y;
+    float4x4 m = occluderViewProj;
+
+    float cornerZ[8];
+    float cornerW[8];
+    int2 lo = int2(0x7FFFFFFF, 0x7FFFFFFF);
+    int2 hi = int2(-0x7FFFFFFF - 1, -0x7FFFFFFF - 1);
+
+    [unroll]
+    for (uint k = 0; k < 8; ++k)
+    {
+        precise float px = (k & 1) ? b.center.x + b.radius : b.center.x - b.radius;
+        precise float py = (k & 2) ? b.center.y + b.radius : b.center.y - b.radius;
+        precise float pz = (k & 4) ? b.center.z + b.radius : b.center.z - b.radius;
+        float3 p = float3(px, py, pz);
+
+        precise float x = CullDot3(p, float3(m._11, m._21, m._31)) + m._41;
+        precise float y = CullDot3(p, float3(m._12, m._22, m._32)) + m._42;
+        precise float z = CullDot3(p, float3(m._13, m._23, m._33)) + m._43;
+        precise float w = CullDot3(p, float3(m._14, m._24, m._34)) + m._44;
+
+        if (!(w > 0.0))
+            return false;
+
+        precise float numX = (x + w) * (float)width;
+        precise float numY = (w - y) * (float)height;
+        int2 pixel = int2(HiZPixelFloor(numX, w, width), HiZPixelFloor(numY, w, height));
+        lo = min(lo, pixel);
+        hi = max(hi, pixel);
+        cornerZ[k] = z;
+        cornerW[k] = w;
+    }
+
+    if (hi.x < 0 || hi.y < 0 || lo.x >= width || lo.y >= height)
+        return false;
+    lo = max(lo, int2(0, 0));
+    hi = min(hi, int2(width - 1, height - 1));
+
+    uint mip = 0;
+    int2 t0, t1;
+    [loop]
+    for (;;)
+    {
+        int2 last = int2(HiZMipSize(depthSize.x, mip), HiZMipSize(depthSize.y, mip)) - 1;
+        t0 = min(lo >> (mip + 1), last);
+        t1 = min(hi >> (mip + 1), last);
+        if ((t1.x - t0.x <= 1 && t1.y - t0.y <= 1) || mip + 1 >= hizMips)
+            break;
+        ++mip;
+    }
+
+    float maxDepth = max(
+        max(hiz.Load(int3(t0.x, t0.y, mip)), hiz.Load(int3(t1.x, t0.y, mip))),
+        max(hiz.Load(int3(t0.x, t1.y, mip)), hiz.Load(int3(t1.x, t1.y, mip))));
+
+    [unroll]
+    for (uint c = 0; c < 8; ++c)
+    {
+        precise float limit = maxDepth * cornerW[c];
+        if (!(cornerZ[c] > limit))
+            return false;
+    }
+    return true;
+}
@@ -1,21 +1,13 @@
 #pragma once
 #include <cstdint>
 #include <vector>
-#include <unordered_map>
+#include "MeshletBuilder.h"
 #include <wrl.h>
 #include <d3d12.h>
 #include "d3dx12.h"
 
 using Microsoft::WRL::ComPtr;
 
-struct Meshlet
-{
-    uint32_t vertexOffset;
-    uint32_t vertexCount; 
-    uint32_t primOffset;  
-    uint32_t primCount;   
-};
-
 struct MeshletBuffersGPU
 {
     ComPtr<ID3D12Resource> vertices;
@@ -36,19 +28,23 @@ struct MeshVertex
     float handed;
 };
 
-void BuildMeshlets_Greedy(
-    const std::vector<uint32_t>& indices,
-    uint32_t maxVerts, uint32_t maxPrims,
-    std::vector<Meshlet>& outMeshlets,
-    std::vector<uint32_t>& outMeshletVertices,
-    std::vector<uint32_t>& outMeshletPrimsPacked);
+// кусок буфера в элементах, для SRV поверх общих буферов GeometryArena
+struct StructuredRange
+{
+    ID3D12Resource* resource = nullptr;
+    UINT firstElement = 0;
+    UINT numElements = 0;
+};
 
+// srvBase + 0..4: t0..t4 space2 в Shaders.hlsl
 void CreateMeshletSRVs(
     ID3D12Device* device,
-    ID3D12Resource* vertices,
-    ID3D12Resource* meshlets,
-    ID3D12Resource* meshletVertices,
-    ID3D12Resource* meshletPrims,
+    const StructuredRange& vertices,
+    const StructuredRange& meshlets,
+    const StructuredRange& meshletVertices,
+    const StructuredRange& meshletPrims,
+    const StructuredRange& meshletBounds,
     D3D12_CPU_DESCRIPTOR_HANDLE heapCpuStart,
     UINT descriptorSize,
-    uint32_t srvBase);
+    uint32_t srvBase,
+    UINT vertexStride = sizeof(MeshVertex));
@@ -0,0 +1,264 @@
+#include "ObjImport.h"
+#include "ObjParser.h"
+#include "VertexWeld.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+std::vector<ImportedObject> ImportObj(const std::string& objPath, TaskPool* pool)
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string                      warn, err;
+    std::string baseDir = std::filesystem::path(objPath)
+        .parent_path()
+        .string();
+
+    if (!ParallelLoadObj(&attrib, &shapes, &materials, &warn, &err, objPath.c_str(), baseDir.c_str(), pool)) 
+    {
+        throw std::runtime_error("TinyObjLoader error: " + warn + err);
+    }
+
+    size_t M = materials.size();
+    size_t N = M + 1;
+    std::vector<Mesh> meshPerMat(N);
+
+    // углов на материал - ровно столько индексов
+    std::vector<size_t> cornersPerMat(N, 0);
+    for (const auto& shape : shapes)
+    {
+        const auto& matIds = shape.mesh.material_ids;
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); ++f)
+        {
+            int rawMatId = (f < matIds.size() ? matIds[f] : -1);
+            int mid = (rawMatId >= 0 && rawMatId < (int)M) ? rawMatId : (int)M;
+            cornersPerMat[mid] += shape.mesh.num_face_vertices[f];
+        }
+    }
+
+    size_t corners = 0;
+    for (size_t i = 0; i < N; ++i)
+    {
+        meshPerMat[i].indices.reserve(cornersPerMat[i]);
+        corners += cornersPerMat[i];
+    }
+    // одна таблица на все материалы, материал - часть ключа
+    VertexWeldTable weld(attrib.vertices.size() / 3, (std::min)(corners, attrib.vertices.size() / 3));
+
+    for (auto& shape : shapes) 
+    {
+        auto& fvCounts = shape.mesh.num_face_vertices;
+        auto& matIds = shape.mesh.material_ids;
+        auto& idxs = shape.mesh.indices;
+
+        size_t indexOffset = 0;
+        for (size_t f = 0; f < fvCounts.size(); ++f) 
+        {
+            int rawMatId = (f < matIds.size() ? matIds[f] : -1);
+            int mid = (rawMatId >= 0 && rawMatId < (int)M) ? rawMatId : (int)M;
+
+            Mesh& mesh = meshPerMat[mid];
+
+            for (size_t v = 0; v < fvCounts[f]; ++v) 
+            {
+                const auto& idx = idxs[indexOffset + v];
+                bool isNew;
+                const uint32_t newIndex = weld.FindOrAdd(idx.vertex_index, idx.texcoord_index, idx.normal_index,
+                    (uint32_t)mid, (uint32_t)mesh.vertices.size(), isNew);
+                if (isNew) 
+                {
+                    Vertex vert{};
+                    vert.Pos = 
+                    {
+                        attrib.vertices[3 * idx.vertex_index + 0],
+                        attrib.vertices[3 * idx.vertex_index + 1],
+                        attrib.vertices[3 * idx.vertex_index + 2]
+                    };
+                    if (idx.normal_index >= 0) 
+                    {
+                        vert.Normal = 
+                        {
+                            attrib.normals[3 * idx.normal_index + 0],
+                            attrib.normals[3 * idx.normal_index + 1],
+                            attrib.normals[3 * idx.normal_index + 2]
+                        };
+                    }
+                    if (idx.texcoord_index >= 0) 
+                    {
+                        vert.uv = 
+                        {
+                            attrib.texcoords[2 * idx.texcoord_index + 0],
+                            1.0f - attrib.texcoords[2 * idx.texcoord_index + 1]
+                        };
+                    }
+                    mesh.vertices.push_back(vert);
+                }
+                mesh.indices.push_back(newIndex);
+            }
+            indexOffset += fvCounts[f];
+        }
+    }
+
+    for (auto& mesh : meshPerMat) 
+    {
+        for (auto& v : mesh.vertices) 
+        {
+            v.tangent = { 0,0,0 };
+            v.handedness = 0;
+        }
+
+        for (size_t f = 0; f + 2 < mesh.indices.size(); f += 3) 
+        {
+            uint32_t i0 = mesh.indices[f], i1 = mesh.indices[f + 1], i2 = mesh.indices[f + 2];
+            auto& v0 = mesh.vertices[i0];
+            auto& v1 = mesh.vertices[i1];
+            auto& v2 = mesh.vertices[i2];
+
+            float duv1x = v1.uv.x - v0.uv.x;
+            float duv1y = v1.uv.y - v0.uv.y;
+            float duv2x = v2.uv.x - v0.uv.x;
+            float duv2y = v2.uv.y - v0.uv.y;
+
+            float det = duv1x * duv2y - duv2x * duv1y;
+            XMVECTOR T, B;
+            float H;
+
+            if (fabs(det) < 1e-6f)
+            {
+                T = XMVectorSet(1, 0, 0, 0);
+                B = XMVectorSet(0, 1, 0, 0);
+                H = 1.0f;
+            }
+            else
+            {
+                float invDet = 1.0f / det;
+                XMVECTOR p0 = XMLoadFloat3(&v0.Pos);
+                XMVECTOR p1 = XMLoadFloat3(&v1.Pos);
+                XMVECTOR p2 = XMLoadFloat3(&v2.Pos);
+                XMVECTOR edge1 = p1 - p0;
+                XMVECTOR edge2 = p2 - p0;
+
+                T = (edge1 * duv2y - edge2 * duv1y) * invDet;
+                B = (edge2 * duv1x - edge1 * duv2x) * invDet;
+                H = XMVectorGetX(XMVector3Dot(XMVector3Cross(edge1, edge2), B)) < 0 ? -1.0f : 1.0f;
+            }
+
+            XMVECTOR t0 = XMVector3Normalize(XMLoadFloat3(&v0.tangent) + T);
+            XMVECTOR t1 = XMVector3Normalize(XMLoadFloat3(&v1.tangent) + T);
+            XMVECTOR t2 = XMVector3Normalize(XMLoadFloat3(&v2.tangent) + T);
+
+            XMStoreFloat3(&v0.tangent, t0);
+            XMStoreFloat3(&v1.tangent, t1);
+            XMStoreFloat3(&v2.tangent, t2);
+
+            v0.handedness = v1.handedness = v2.handedness = H;
+        }
+
+        for (auto& v : mesh.vertices) 
+        {
+            XMVECTOR t = XMLoadFloat3(&v.tangent);
+            t = XMVector3Normalize(t);
+            XMStoreFloat3(&v.tangent, t);
+        }
+    }
+
+    std::vector<MeshOptimizeStats> statsPerMat(N);
+    for (size_t i = 0; i < N; ++i)
+        OptimizeMesh(meshPerMat[i], &statsPerMat[i]);
+
+    std::vector<ImportedObject> objects;
+    objects.reserve(N);
+
+    for (size_t i = 0; i < N; ++i) 
+    {
+        if (meshPerMat[i].indices.empty()) continue;
+
+        ImportedObject obj;
+        obj.lodMeshes.push_back(std::move(meshPerMat[i]));
+        obj.lodOptimizeStats.push_back(statsPerMat[i]);
+
+        if (i < M) 
+        {
+            const auto& m = materials[i];
+
+            obj.material.ambient = { m.ambient[0],  m.ambient[1],  m.ambient[2] };
+            obj.material.diffuse = { m.diffuse[0],  m.diffuse[1],  m.diffuse[2] };
+            obj.material.specular = { m.specular[0], m.specular[1], m.specular[2] };
+            obj.material.roughness = m.roughness;
+            obj.material.metallic = m.metallic;
+            obj.material.ao = 1.0f;
+            obj.material.shininess = m.shininess;
+            obj.material.diffuseTexPath = m.diffuse_texname;
+            obj.material.normalTexPath = !m.bump_texname.empty() ? m.bump_texname
+                : !m.normal_texname.empty() ? m.normal_texname : "";
+            obj.material.displacementTexPath = m.displacement_texname;
+            obj.material.roughnessTexPath = m.roughness_texname;
+            obj.material.metallicTexPath = m.metallic_texname;
+            obj.material.aoTexPath = m.ambient_texname;
+
+            const bool hasMetalMap = !m.metallic_texname.empty();
+            const bool hasRoughMap = !m.roughness_texname.empty();
+
+            const bool hasAnyPBR = hasMetalMap || hasRoughMap || (m.metallic > 0.0f) || (m.roughness > 0.0f);
+
+            if (!hasAnyPBR)
+            {
+                obj.material.metallic = 0.0f;
+                obj.material.roughness = 1.0f;
+            }
+        }
+        else 
+        {
+            obj.material.ambient = { 0.0f, 0.0f, 0.0f };
+            obj.material.diffuse = { 1.0f, 1.0f, 1.0f };
+            obj.material.specular = { 0.0f, 0.0f, 0.0f };
+            obj.material.shininess = 1.0f;
+            obj.material.diffuseTexPath.clear();
+            obj.material.normalTexPath.clear();
+            obj.material.displacementTexPath.clear();
+            obj.material.roughnessTexPath.clear();
+            obj.material.metallicTexPath.clear();
+            obj.material.aoTexPath.clear();
+        }
+
+        objects.push_back(std::move(obj));
+    }
+
+    return objects;
+}
+
+std::vector<ImportedObject> ImportObjLODs(const std::vector<std::string>& objPaths, TaskPool* pool)
+{
+    if (objPaths.empty()) throw std::runtime_error("no LOD paths");
+
+    auto base = ImportObj(objPaths[0], pool);
+
+    for (size_t k = 1; k < objPaths.size(); ++k) {
+        auto lodK = ImportObj(objPaths[k], pool);
+        for (size_t i = 0; i < base.size(); ++i) {
+            if (i < lodK.size() && !lodK[i].lodMeshes[0].indices.empty()) {
+                if (base[i].lodMeshes.size() <= k) base[i].lodMeshes.resize(k + 1);
+                if (base[i].lodOptimizeStats.size() <= k) base[i].lodOptimizeStats.resize(k + 1);
+                base[i].lodMeshes[k] = std::move(lodK[i].lodMeshes[0]);
+                base[i].lodOptimizeStats[k] = lodK[i].lodOptimizeStats[0];
+            }
+        }
+    }
+
+    return base;
+}
+
+std::vector<ImportedObject> ImportScene(const std::vector<std::string>& objPaths, const LodChainSettings& lods,
+    TaskPool* pool)
+{
+    if (objPaths.size() != 1) return ImportObjLODs(objPaths, pool);
+
+    auto objects = ImportObj(objPaths[0], pool);
+    GenerateLodChain(objects, lods, pool);
+    return objects;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Meshes.h"
+#include "Material.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+class TaskPool;
+
+// Импорт OBJ/MTL без D3D: сварка вершин, касательные, OptimizeMesh, по сабмешу на материал.
+// Общий для AssetLoader и офлайн-кукера (AssetCooker).
+struct ImportedObject
+{
+    Material material;
+    // [0] - меш из первого файла, [k] - из k-го файла LOD-цепочки (пустой, если там нет этого материала)
+    std::vector<Mesh> lodMeshes;
+    // ACMR/ATVR до и после OptimizeMesh, по LOD
+    std::vector<MeshOptimizeStats> lodOptimizeStats;
+    // у цепочки из GenerateLodChain: ошибка LOD относительно LOD 0 и дистанции включения,
+    // в единицах меша; пустые - LOD из файлов, дистанции задаёт сцена
+    std::vector<float> lodErrors;
+    std::vector<float> lodDistances;
+};
+
+// сабмеши по материалам, последним - грани без материала; пустые пропускаются.
+// pool - для разбора файла (ParallelLoadObj), nullptr - в вызывающем потоке
+std::vector<ImportedObject> ImportObj(const std::string& objPath, TaskPool* pool = nullptr);
+// i-й объект objPaths[k] становится LOD k i-го объекта objPaths[0]
+std::vector<ImportedObject> ImportObjLODs(const std::vector<std::string>& objPaths, TaskPool* pool = nullptr);
+// один файл - LOD 1..N генерируются упрощением (GenerateLodChain), несколько - ImportObjLODs
+std::vector<ImportedObject> ImportScene(const std::vector<std::string>& objPaths, const LodChainSettings& lods,
+    TaskPool* pool = nullptr);
@@ -0,0 +1,1089 @@
+#include "ObjParser.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <set>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using tinyobj::real_t;
+
+namespace
+{
+    // куски меньше этого не режем: на мелких файлах потоки только мешают
+    const size_t kMinChunkBytes = 1 << 20;
+
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const char* path)
+        {
+#ifdef _WIN32
+            m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+                return;
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(m_file, &size))
+                return;
+            m_size = (size_t)size.QuadPart;
+            if (m_size == 0)
+            {
+                m_ok = true;
+                return;
+            }
+            m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping)
+                m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+            m_fd = open(path, O_RDONLY);
+            if (m_fd < 0)
+                return;
+            struct stat st {};
+            if (fstat(m_fd, &st) != 0)
+                return;
+            m_size = (size_t)st.st_size;
+            if (m_size == 0)
+            {
+                m_ok = true;
+                return;
+            }
+            void* p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (p != MAP_FAILED)
+            {
+                madvise(p, m_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char*>(p);
+            }
+#endif
+            m_ok = m_data != nullptr;
+        }
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            if (m_data)
+                UnmapViewOfFile(m_data);
+            if (m_mapping)
+                CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE)
+                CloseHandle(m_file);
+#else
+            if (m_data)
+                munmap(const_cast<char*>(m_data), m_size);
+            if (m_fd >= 0)
+                close(m_fd);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool IsOpen() const { return m_ok; }
+        const char* Data() const { return m_data; }
+        size_t Size() const { return m_size; }
+
+    private:
+#ifdef _WIN32
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+        bool m_ok = false;
+    };
+
+    inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+    inline bool IsDigit(char c) { return (unsigned)(c - '0') < 10u; }
+
+    // strspn(" \t") и strcspn(" \t\r") в пределах строки ('\r' в строку не попадает)
+    inline const char* SkipSpace(const char* p, const char* end)
+    {
+        while (p < end && IsSpace(*p)) ++p;
+        return p;
+    }
+
+    inline const char* SkipToken(const char* p, const char* end)
+    {
+        while (p < end && !IsSpace(*p)) ++p;
+        return p;
+    }
+
+    inline const char* SkipIndex(const char* p, const char* end)
+    {
+        while (p < end && *p != '/' && !IsSpace(*p)) ++p;
+        return p;
+    }
+
+    // tryParseDouble из tinyobj, только без копии строки: дробная часть копится тем же
+    // порядком умножений, поэтому после приведения к float числа совпадают до бита.
+    // В tinyobj за s_end всегда стоит разделитель, здесь вместо чтения за конец - проверка.
+    bool ParseDouble(const char* s, const char* sEnd, double* result)
+    {
+        if (s >= sEnd)
+            return false;
+
+        static const double powLut[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+        const int lutEntries = sizeof(powLut) / sizeof(powLut[0]);
+
+        double mantissa = 0.0;
+        int exponent = 0;
+        char sign = '+';
+        char expSign = '+';
+        const char* curr = s;
+        int read = 0;
+        bool endNotReached = false;
+        bool leadingDot = false;
+
+        if (*curr == '+' || *curr == '-')
+        {
+            sign = *curr;
+            curr++;
+            if (curr != sEnd && *curr == '.')
+                leadingDot = true;
+        }
+        else if (*curr == '.')
+        {
+            leadingDot = true;
+        }
+        else if (!IsDigit(*curr))
+        {
+            return false;
+        }
+
+        endNotReached = curr != sEnd;
+        if (!leadingDot)
+        {
+            while (endNotReached && IsDigit(*curr))
+            {
+                mantissa *= 10;
+                mantissa += static_cast<int>(*curr - 0x30);
+                curr++;
+                read++;
+                endNotReached = curr != sEnd;
+            }
+            if (read == 0)
+                return false;
+        }
+
+        if (endNotReached)
+        {
+            if (*curr == '.')
+            {
+                curr++;
+                read = 1;
+                endNotReached = curr != sEnd;
+                while (endNotReached && IsDigit(*curr))
+                {
+                    mantissa += static_cast<int>(*curr - 0x30) * (read < lutEntries ? powLut[read] : std::pow(10.0, -read));
+                    read++;
+                    curr++;
+                    endNotReached = curr != sEnd;
+                }
+            }
+            else if (*curr != 'e' && *curr != 'E')
+            {
+                endNotReached = false;
+            }
+
+            if (endNotReached && (*curr == 'e' || *curr == 'E'))
+            {
+                curr++;
+                endNotReached = curr != sEnd;
+                if (endNotReached && (*curr == '+' || *curr == '-'))
+                {
+                    expSign = *curr;
+                    curr++;
+                }
+                else if (!endNotReached || !IsDigit(*curr))
+                {
+                    return false;
+                }
+
+                read = 0;
+                endNotReached = curr != sEnd;
+                while (endNotReached && IsDigit(*curr))
+                {
+                    if (exponent > 2147483647 / 10)
+                        return false;
+                    exponent *= 10;
+                    exponent += static_cast<int>(*curr - 0x30);
+                    curr++;
+                    read++;
+                    endNotReached = curr != sEnd;
+                }
+                exponent *= (expSign == '+' ? 1 : -1);
+                if (read == 0)
+                    return false;
+            }
+        }
+
+        *result = (sign == '+' ? 1 : -1) *
+            (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+        return true;
+    }
+
+    // parseReal: при неудаче out не трогается, позиция всё равно уходит за токен
+    inline bool ParseReal(const char*& p, const char* end, real_t* out)
+    {
+        p = SkipSpace(p, end);
+        const char* e = SkipToken(p, end);
+        double v;
+        const bool ok = ParseDouble(p, e, &v);
+        if (ok)
+            *out = static_cast<real_t>(v);
+        p = e;
+        return ok;
+    }
+
+    // atoi в пределах строки; false - число не влезает в int
+    inline bool ParseInt(const char* p, const char* end, int* out)
+    {
+        while (p < end && (IsSpace(*p) || *p == '\v' || *p == '\f')) ++p;
+        bool negative = false;
+        if (p < end && (*p == '+' || *p == '-'))
+            negative = *p++ == '-';
+        int64_t v = 0;
+        for (int digits = 0; p < end && IsDigit(*p); ++p)
+        {
+            if (++digits > 10)
+                return false;
+            v = v * 10 + (*p - '0');
+        }
+        if (v > 2147483647)
+            return false;
+        *out = (int)(negative ? -v : v);
+        return true;
+    }
+
+    struct RawIndex
+    {
+        int v;
+        int vt;
+        int vn;
+    };
+
+    enum RelativeBits : uint8_t { RelV = 1, RelVt = 2, RelVn = 4 };
+
+    enum class ObjEventKind : uint8_t { Object, Group, UseMtl, MtlLib, Smoothing };
+
+    // строка, которая меняет shape, материал или группу сглаживания; разбирается последовательно
+    struct ObjEvent
+    {
+        ObjEventKind kind;
+        size_t line;        // номер строки от начала куска
+        size_t face;        // сколько граней, треугольников, вершин граней и v было до строки
+        size_t tri;
+        size_t fv;
+        size_t v;
+        const char* text;   // после ведущих пробелов
+        const char* textEnd;
+    };
+
+    struct ObjChunk
+    {
+        std::vector<real_t> v;
+        std::vector<real_t> vc;     // r, g, b; r заодно вес вершины
+        std::vector<real_t> vn;
+        std::vector<real_t> vt;
+        std::vector<RawIndex> fv;
+        std::vector<uint8_t> rel;   // RelativeBits на вершину грани, заводится при первом отрицательном индексе
+        bool hasRelative = false;
+        std::vector<uint8_t> faceSize;
+        std::vector<ObjEvent> events;
+        size_t tris = 0;
+        size_t lines = 0;
+    };
+
+    // fixIndex без предупреждений: ноль отдаётся tinyobj, отрицательный считается от начала куска
+    inline bool FixIndex(int idx, size_t localCount, int* out, bool* relative)
+    {
+        if (idx > 0)
+        {
+            *out = idx - 1;
+            *relative = false;
+            return true;
+        }
+        if (idx == 0)
+            return false;
+        *out = (int)localCount + idx;
+        *relative = true;
+        return true;
+    }
+
+    // parseTriple: i, i/j/k, i//k, i/j
+    bool ParseTriple(const char*& p, const char* end, const ObjChunk& c, RawIndex* out, uint8_t* rel)
+    {
+        int raw;
+        bool relative;
+        *out = { -1, -1, -1 };
+        *rel = 0;
+
+        if (!ParseInt(p, end, &raw) || !FixIndex(raw, c.v.size() / 3, &out->v, &relative))
+            return false;
+        *rel |= relative ? RelV : 0;
+        p = SkipIndex(p, end);
+        if (p >= end || *p != '/')
+            return true;
+        p++;
+
+        if (p < end && *p == '/')
+        {
+            p++;
+            if (!ParseInt(p, end, &raw) || !FixIndex(raw, c.vn.size() / 3, &out->vn, &relative))
+                return false;
+            *rel |= relative ? RelVn : 0;
+            p = SkipIndex(p, end);
+            return true;
+        }
+
+        if (!ParseInt(p, end, &raw) || !FixIndex(raw, c.vt.size() / 2, &out->vt, &relative))
+            return false;
+        *rel |= relative ? RelVt : 0;
+        p = SkipIndex(p, end);
+        if (p >= end || *p != '/')
+            return true;
+        p++;
+
+        if (!ParseInt(p, end, &raw) || !FixIndex(raw, c.vn.size() / 3, &out->vn, &relative))
+            return false;
+        *rel |= relative ? RelVn : 0;
+        p = SkipIndex(p, end);
+        return true;
+    }
+
+    // false - в куске есть то, что быстрый путь не повторяет
+    bool ParseChunk(const char* p, const char* end, ObjChunk& c, const std::atomic<bool>& abort)
+    {
+        while (p < end)
+        {
+            if (abort.load(std::memory_order_relaxed))
+                return false;
+
+            // конец строки как в safeGetline: '\n', '\r' или "\r\n"
+            const char* lineEnd = p;
+            while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r') ++lineEnd;
+            const char* next = lineEnd;
+            const size_t line = c.lines;
+            if (next < end)
+            {
+                next += (*next == '\r' && next + 1 < end && next[1] == '\n') ? 2 : 1;
+                ++c.lines;
+            }
+
+            // tinyobj видит строку как C-строку: после '\0' её нет
+            const char* zero = static_cast<const char*>(std::memchr(p, 0, lineEnd - p));
+            const char* e = zero ? zero : lineEnd;
+            const char* t = SkipSpace(p, e);
+            p = next;
+
+            if (t >= e || t[0] == '#')
+                continue;
+
+            auto At = [&](size_t i) { return t + i < e ? t[i] : '\0'; };
+
+            if (t[0] == 'v' && IsSpace(At(1)))
+            {
+                const char* q = t + 2;
+                real_t x = 0, y = 0, z = 0, r, g, b;
+                ParseReal(q, e, &x);
+                ParseReal(q, e, &y);
+                ParseReal(q, e, &z);
+                if (!ParseReal(q, e, &r))
+                    r = g = b = 1;
+                else if (!ParseReal(q, e, &g))
+                    g = b = 1;
+                else if (!ParseReal(q, e, &b))
+                    r = g = b = 1;
+
+                c.v.insert(c.v.end(), { x, y, z });
+                c.vc.insert(c.vc.end(), { r, g, b });
+                continue;
+            }
+
+            if (t[0] == 'v' && At(1) == 'n' && IsSpace(At(2)))
+            {
+                const char* q = t + 3;
+                real_t x = 0, y = 0, z = 0;
+                ParseReal(q, e, &x);
+                ParseReal(q, e, &y);
+                ParseReal(q, e, &z);
+                c.vn.insert(c.vn.end(), { x, y, z });
+                continue;
+            }
+
+            if (t[0] == 'v' && At(1) == 't' && IsSpace(At(2)))
+            {
+                const char* q = t + 3;
+                real_t x = 0, y = 0;
+                ParseReal(q, e, &x);
+                ParseReal(q, e, &y);
+                c.vt.insert(c.vt.end(), { x, y });
+                continue;
+            }
+
+            if ((t[0] == 'v' && At(1) == 'w' && IsSpace(At(2))) ||
+                ((t[0] == 'l' || t[0] == 'p' || t[0] == 't') && IsSpace(At(1))))
+                return false;
+
+            if (t[0] == 'f' && IsSpace(At(1)))
+            {
+                const char* q = SkipSpace(t + 2, e);
+                RawIndex face[4];
+                uint8_t rel[4];
+                size_t n = 0;
+                while (q < e && *q != '#')
+                {
+                    if (n == 4 || !ParseTriple(q, e, c, &face[n], &rel[n]))
+                        return false;
+                    ++n;
+                    q = SkipSpace(q, e);
+                }
+                if (n < 3)
+                    return false;
+
+                for (size_t k = 0; k < n; ++k)
+                {
+                    if (rel[k] && !c.hasRelative)
+                    {
+                        c.rel.assign(c.fv.size(), 0);
+                        c.hasRelative = true;
+                    }
+                    c.fv.push_back(face[k]);
+                    if (c.hasRelative)
+                        c.rel.push_back(rel[k]);
+                }
+                c.faceSize.push_back((uint8_t)n);
+                c.tris += n - 2;
+                continue;
+            }
+
+            ObjEventKind kind;
+            if (e - t >= 6 && std::memcmp(t, "usemtl", 6) == 0)
+                kind = ObjEventKind::UseMtl;
+            else if (e - t >= 6 && std::memcmp(t, "mtllib", 6) == 0 && IsSpace(At(6)))
+                kind = ObjEventKind::MtlLib;
+            else if (t[0] == 'g' && IsSpace(At(1)))
+                kind = ObjEventKind::Group;
+            else if (t[0] == 'o' && IsSpace(At(1)))
+                kind = ObjEventKind::Object;
+            else if (t[0] == 's' && IsSpace(At(1)))
+                kind = ObjEventKind::Smoothing;
+            else
+                continue;
+
+            c.events.push_back({ kind, line, c.faceSize.size(), c.tris, c.fv.size(), c.v.size() / 3, t, e });
+        }
+        return true;
+    }
+
+    std::string ParseString(const char*& p, const char* end)
+    {
+        p = SkipSpace(p, end);
+        const char* e = SkipToken(p, end);
+        std::string s(p, e);
+        p = e;
+        return s;
+    }
+
+    // SplitString из tinyobj: последний токен добавляется, даже пустой
+    std::vector<std::string> SplitString(const char* p, const char* end, char delim, char escape)
+    {
+        std::vector<std::string> elems;
+        std::string token;
+        bool escaping = false;
+        for (; p < end; ++p)
+        {
+            const char ch = *p;
+            if (escaping)
+            {
+                escaping = false;
+            }
+            else if (ch == escape)
+            {
+                escaping = true;
+                continue;
+            }
+            else if (ch == delim)
+            {
+                if (!token.empty())
+                    elems.push_back(token);
+                token.clear();
+                continue;
+            }
+            token += ch;
+        }
+        elems.push_back(token);
+        return elems;
+    }
+
+    // кусок граней одного куска файла между двумя событиями
+    struct FaceRun
+    {
+        size_t chunk;
+        size_t faceBegin, faceEnd;
+        size_t fvBegin;
+        size_t tris;
+        int material;
+        unsigned smoothing;
+        size_t shape = 0;
+        size_t outTri = 0;
+        size_t vLimit = 0;  // сколько v было при выгрузке в shape: по ним tinyobj проверяет четырёхугольники
+    };
+
+    struct ShapePlan
+    {
+        std::string name;
+        size_t tris = 0;
+    };
+
+    void ForChunks(TaskPool* pool, size_t count, const std::function<void(size_t, size_t)>& fn)
+    {
+        if (pool && count > 1)
+            pool->ParallelFor(count, 1, fn);
+        else
+            fn(0, count);
+    }
+
+    // Склейка кусков и последовательный проход по o/g/usemtl/mtllib/s. false - нужен tinyobj.
+    bool BuildObj(std::vector<ObjChunk>& chunks, tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+        std::vector<tinyobj::material_t>* materials, std::string* warn, std::string* err, const char* mtlBaseDir, TaskPool* pool)
+    {
+        const size_t n = chunks.size();
+        std::vector<size_t> vBase(n + 1, 0), vnBase(n + 1, 0), vtBase(n + 1, 0), lineBase(n + 1, 0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            vBase[i + 1] = vBase[i] + chunks[i].v.size() / 3;
+            vnBase[i + 1] = vnBase[i] + chunks[i].vn.size() / 3;
+            vtBase[i + 1] = vtBase[i] + chunks[i].vt.size() / 2;
+            lineBase[i + 1] = lineBase[i] + chunks[i].lines;
+        }
+        const size_t vCount = vBase[n], vnCount = vnBase[n], vtCount = vtBase[n];
+
+        // один кусок отдаётся как есть, несколько копируются на свои места
+        const bool single = n == 1;
+        if (single)
+        {
+            attrib->vertices.swap(chunks[0].v);
+            attrib->colors.swap(chunks[0].vc);
+            attrib->normals.swap(chunks[0].vn);
+            attrib->texcoords.swap(chunks[0].vt);
+        }
+        else
+        {
+            attrib->vertices.resize(vCount * 3);
+            attrib->colors.resize(vCount * 3);
+            attrib->normals.resize(vnCount * 3);
+            attrib->texcoords.resize(vtCount * 2);
+        }
+        attrib->vertex_weights.resize(vCount);
+        attrib->texcoord_ws.clear();
+        attrib->skin_weights.clear();
+
+        // индексы с отрицательными номерами досчитываются здесь, индексы за концом массивов - к tinyobj
+        std::atomic<bool> bad{ false };
+        ForChunks(pool, n, [&](size_t b, size_t e)
+        {
+            for (size_t i = b; i < e; ++i)
+            {
+                ObjChunk& c = chunks[i];
+                if (!single)
+                {
+                    std::copy(c.v.begin(), c.v.end(), attrib->vertices.begin() + vBase[i] * 3);
+                    std::copy(c.vc.begin(), c.vc.end(), attrib->colors.begin() + vBase[i] * 3);
+                    std::copy(c.vn.begin(), c.vn.end(), attrib->normals.begin() + vnBase[i] * 3);
+                    std::copy(c.vt.begin(), c.vt.end(), attrib->texcoords.begin() + vtBase[i] * 2);
+                }
+                const real_t* colors = attrib->colors.data() + vBase[i] * 3;
+                for (size_t k = vBase[i]; k < vBase[i + 1]; ++k, colors += 3)
+                    attrib->vertex_weights[k] = colors[0];
+
+                std::vector<RawIndex>& out = c.fv;
+                if (c.hasRelative)
+                {
+                    for (size_t k = 0; k < out.size(); ++k)
+                    {
+                        const uint8_t r = c.rel[k];
+                        if (r & RelV) out[k].v += (int)vBase[i];
+                        if (r & RelVt) out[k].vt += (int)vtBase[i];
+                        if (r & RelVn) out[k].vn += (int)vnBase[i];
+                        if (((r & RelV) && out[k].v < 0) || ((r & RelVt) && out[k].vt < 0) || ((r & RelVn) && out[k].vn < 0))
+                            bad = true;
+                    }
+                }
+                for (const RawIndex& r : out)
+                {
+                    if (r.v < 0 || (size_t)r.v >= vCount || r.vt >= (int64_t)vtCount || r.vn >= (int64_t)vnCount)
+                    {
+                        bad = true;
+                        break;
+                    }
+                }
+            }
+        });
+        if (bad)
+            return false;
+
+        std::string baseDir = mtlBaseDir ? mtlBaseDir : "";
+        if (!baseDir.empty())
+        {
+#ifndef _WIN32
+            const char dirsep = '/';
+#else
+            const char dirsep = '\\';
+#endif
+            if (baseDir[baseDir.length() - 1] != dirsep) baseDir += dirsep;
+        }
+        tinyobj::MaterialFileReader readMaterial(baseDir);
+        std::set<std::string> materialFilenames;
+        std::map<std::string, int> materialMap;
+
+        int material = -1;
+        unsigned smoothing = 0;
+        std::string name;
+        std::vector<ShapePlan> plan(1);
+        std::vector<FaceRun> runs;
+        size_t pendingBegin = 0;
+
+        // exportGroupsToShape: накопленные грани уходят в текущий shape
+        auto Export = [&](size_t vAtExport)
+        {
+            for (size_t r = pendingBegin; r < runs.size(); ++r)
+            {
+                runs[r].shape = plan.size() - 1;
+                runs[r].outTri = plan.back().tris;
+                runs[r].vLimit = vAtExport;
+                plan.back().tris += runs[r].tris;
+                plan.back().name = name;
+            }
+            pendingBegin = runs.size();
+        };
+        auto NextShape = [&]()
+        {
+            if (plan.back().tris > 0)
+                plan.emplace_back();
+            else
+                plan.back() = ShapePlan();
+        };
+
+        for (size_t ci = 0; ci < n; ++ci)
+        {
+            const ObjChunk& c = chunks[ci];
+            size_t face = 0, tri = 0, fv = 0;
+            auto AddRun = [&](size_t faceEnd, size_t triEnd, size_t fvEnd)
+            {
+                if (faceEnd > face)
+                    runs.push_back({ ci, face, faceEnd, fv, triEnd - tri, material, smoothing });
+                face = faceEnd;
+                tri = triEnd;
+                fv = fvEnd;
+            };
+
+            for (const ObjEvent& ev : c.events)
+            {
+                AddRun(ev.face, ev.tri, ev.fv);
+                const char* t = ev.text;
+                const size_t vAt = vBase[ci] + ev.v;
+
+                switch (ev.kind)
+                {
+                case ObjEventKind::Smoothing:
+                {
+                    t = SkipSpace(t + 2, ev.textEnd);
+                    if (t >= ev.textEnd)
+                        break;
+                    if (ev.textEnd - t >= 3 && std::memcmp(t, "off", 3) == 0)
+                    {
+                        smoothing = 0;
+                    }
+                    else
+                    {
+                        int id = 0;
+                        if (!ParseInt(t, ev.textEnd, &id))
+                            return false;
+                        smoothing = id < 0 ? 0u : (unsigned)id;
+                    }
+                    break;
+                }
+                case ObjEventKind::UseMtl:
+                {
+                    t += 6;
+                    const std::string mtlName = ParseString(t, ev.textEnd);
+                    int newMaterial = -1;
+                    const auto it = materialMap.find(mtlName);
+                    if (it != materialMap.end())
+                        newMaterial = it->second;
+                    else if (warn)
+                        (*warn) += "material [ '" + mtlName + "' ] not found in .mtl\n";
+
+                    if (newMaterial != material)
+                    {
+                        Export(vAt);
+                        material = newMaterial;
+                    }
+                    break;
+                }
+                case ObjEventKind::MtlLib:
+                {
+                    const std::vector<std::string> filenames = SplitString(t + 7, ev.textEnd, ' ', '\\');
+                    bool found = false;
+                    for (const std::string& f : filenames)
+                    {
+                        if (materialFilenames.count(f) > 0)
+                        {
+                            found = true;
+                            continue;
+                        }
+                        std::string warnMtl, errMtl;
+                        const bool ok = readMaterial(f, materials, &materialMap, &warnMtl, &errMtl);
+                        if (warn && !warnMtl.empty())
+                            (*warn) += warnMtl;
+                        if (err && !errMtl.empty())
+                            (*err) += errMtl;
+                        if (ok)
+                        {
+                            found = true;
+                            materialFilenames.insert(f);
+                            break;
+                        }
+                    }
+                    if (!found && warn)
+                        (*warn) += "Failed to load material file(s). Use default material.\n";
+                    break;
+                }
+                case ObjEventKind::Group:
+                {
+                    Export(vAt);
+                    NextShape();
+
+                    std::vector<std::string> names;
+                    while (t < ev.textEnd && *t != '#')
+                    {
+                        names.push_back(ParseString(t, ev.textEnd));
+                        t = SkipSpace(t, ev.textEnd);
+                    }
+                    if (names.size() < 2)
+                    {
+                        if (warn)
+                        {
+                            (*warn) += "Empty group name. line: " + std::to_string(lineBase[ci] + ev.line + 1) + "\n";
+                            name = "";
+                        }
+                    }
+                    else
+                    {
+                        name = names[1];
+                        for (size_t i = 2; i < names.size(); ++i)
+                            name += " " + names[i];
+                    }
+                    break;
+                }
+                case ObjEventKind::Object:
+                    Export(vAt);
+                    NextShape();
+                    name.assign(t + 2, ev.textEnd);
+                    break;
+                }
+            }
+            AddRun(c.faceSize.size(), c.tris, c.fv.size());
+        }
+        Export(vCount);
+        if (plan.back().tris == 0)
+            plan.pop_back();
+
+        shapes->resize(plan.size());
+        ForChunks(pool, plan.size(), [&](size_t b, size_t e)
+        {
+            for (size_t i = b; i < e; ++i)
+            {
+                tinyobj::mesh_t& m = (*shapes)[i].mesh;
+                (*shapes)[i].name = plan[i].name;
+                m.indices.resize(plan[i].tris * 3);
+                m.num_face_vertices.assign(plan[i].tris, 3);
+                m.material_ids.resize(plan[i].tris);
+                m.smoothing_group_ids.resize(plan[i].tris);
+            }
+        });
+
+        const real_t* v = attrib->vertices.data();
+        ForChunks(pool, runs.size(), [&](size_t b, size_t e)
+        {
+            for (size_t r = b; r < e; ++r)
+            {
+                const FaceRun& run = runs[r];
+                const ObjChunk& c = chunks[run.chunk];
+                const RawIndex* fv = c.fv.data() + run.fvBegin;
+                tinyobj::mesh_t& m = (*shapes)[run.shape].mesh;
+                tinyobj::index_t* out = m.indices.data() + run.outTri * 3;
+
+                std::fill_n(m.material_ids.begin() + run.outTri, run.tris, run.material);
+                std::fill_n(m.smoothing_group_ids.begin() + run.outTri, run.tris, run.smoothing);
+
+                auto Put = [&](const RawIndex& i) { *out++ = { i.v, i.vn, i.vt }; };
+
+                for (size_t f = run.faceBegin; f < run.faceEnd; ++f)
+                {
+                    if (c.faceSize[f] == 3)
+                    {
+                        Put(fv[0]); Put(fv[1]); Put(fv[2]);
+                        fv += 3;
+                        continue;
+                    }
+
+                    const size_t vi0 = (size_t)fv[0].v, vi1 = (size_t)fv[1].v, vi2 = (size_t)fv[2].v, vi3 = (size_t)fv[3].v;
+                    if (vi0 >= run.vLimit || vi1 >= run.vLimit || vi2 >= run.vLimit || vi3 >= run.vLimit)
+                    {
+                        bad = true;
+                        return;
+                    }
+
+                    // та же диагональ, что у tinyobj: короче - по ней и режем
+                    real_t e02x = v[vi2 * 3 + 0] - v[vi0 * 3 + 0];
+                    real_t e02y = v[vi2 * 3 + 1] - v[vi0 * 3 + 1];
+                    real_t e02z = v[vi2 * 3 + 2] - v[vi0 * 3 + 2];
+                    real_t e13x = v[vi3 * 3 + 0] - v[vi1 * 3 + 0];
+                    real_t e13y = v[vi3 * 3 + 1] - v[vi1 * 3 + 1];
+                    real_t e13z = v[vi3 * 3 + 2] - v[vi1 * 3 + 2];
+                    real_t sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+                    real_t sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+                    if (sqr02 < sqr13)
+                    {
+                        Put(fv[0]); Put(fv[1]); Put(fv[2]);
+                        Put(fv[0]); Put(fv[2]); Put(fv[3]);
+                    }
+                    else
+                    {
+                        Put(fv[0]); Put(fv[1]); Put(fv[3]);
+                        Put(fv[1]); Put(fv[2]); Put(fv[3]);
+                    }
+                    fv += 4;
+                }
+            }
+        });
+        return !bad;
+    }
+
+    bool SameFloats(const std::vector<real_t>& a, const std::vector<real_t>& b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(real_t)) == 0);
+    }
+
+    bool SameObj(const tinyobj::attrib_t& aa, const std::vector<tinyobj::shape_t>& as, const std::vector<tinyobj::material_t>& am,
+        const tinyobj::attrib_t& ba, const std::vector<tinyobj::shape_t>& bs, const std::vector<tinyobj::material_t>& bm)
+    {
+        if (!SameFloats(aa.vertices, ba.vertices) || !SameFloats(aa.vertex_weights, ba.vertex_weights) ||
+            !SameFloats(aa.normals, ba.normals) || !SameFloats(aa.texcoords, ba.texcoords) ||
+            !SameFloats(aa.colors, ba.colors) || as.size() != bs.size() || am.size() != bm.size())
+            return false;
+
+        for (size_t i = 0; i < am.size(); ++i)
+            if (am[i].name != bm[i].name || am[i].diffuse_texname != bm[i].diffuse_texname)
+                return false;
+
+        for (size_t i = 0; i < as.size(); ++i)
+        {
+            const tinyobj::mesh_t& a = as[i].mesh;
+            const tinyobj::mesh_t& b = bs[i].mesh;
+            if (as[i].name != bs[i].name || a.indices.size() != b.indices.size() ||
+                a.num_face_vertices != b.num_face_vertices || a.material_ids != b.material_ids ||
+                a.smoothing_group_ids != b.smoothing_group_ids)
+                return false;
+            for (size_t k = 0; k < a.indices.size(); ++k)
+            {
+                if (a.indices[k].vertex_index != b.indices[k].vertex_index ||
+                    a.indices[k].normal_index != b.indices[k].normal_index ||
+                    a.indices[k].texcoord_index != b.indices[k].texcoord_index)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool WriteBenchmarkObj(const std::string& path, uint32_t triangles)
+    {
+        const std::string tmp = path + ".tmp";
+        FILE* f = std::fopen(tmp.c_str(), "wb");
+        if (!f)
+            return false;
+        std::vector<char> buffer(1 << 22);
+        std::setvbuf(f, buffer.data(), _IOFBF, buffer.size());
+
+        const uint32_t parts = 8;
+        const uint32_t quadsPerPart = (std::max)(triangles / 2 / parts, 1u);
+        const uint32_t cols = (std::max)((uint32_t)std::sqrt((double)quadsPerPart), 1u);
+        const uint32_t rows = (std::max)(quadsPerPart / cols, 1u);
+
+        std::fprintf(f, "# %u x %u quads x %u parts\n", cols, rows, parts);
+        uint32_t written = 0;
+        for (uint32_t part = 0; part < parts; ++part)
+        {
+            std::fprintf(f, "o part%u\nusemtl mat%u\n%s\n", part, part % 3, part % 2 ? "s off" : "s 1");
+
+            const uint32_t first = written + 1;
+            for (uint32_t r = 0; r <= rows; ++r)
+            {
+                for (uint32_t c = 0; c <= cols; ++c)
+                {
+                    const float x = c * 0.01f + part * (cols * 0.01f + 1.0f);
+                    const float z = r * 0.01f;
+                    const float y = 0.25f * std::sin(x * 3.0f) * std::cos(z * 5.0f);
+                    std::fprintf(f, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                        x, y, z, (float)c / cols, (float)r / rows, -y, 1.0f, 0.5f * y);
+                }
+            }
+            written += (rows + 1) * (cols + 1);
+
+            // нечётные части ссылаются на вершины относительными индексами
+            const bool relative = part % 2 == 1;
+            for (uint32_t r = 0; r < rows; ++r)
+            {
+                for (uint32_t c = 0; c < cols; ++c)
+                {
+                    uint32_t q[4] =
+                    {
+                        first + r * (cols + 1) + c,
+                        first + r * (cols + 1) + c + 1,
+                        first + (r + 1) * (cols + 1) + c + 1,
+                        first + (r + 1) * (cols + 1) + c,
+                    };
+                    std::fputs("f", f);
+                    for (uint32_t i : q)
+                    {
+                        const long long idx = relative ? (long long)i - written - 1 : (long long)i;
+                        std::fprintf(f, " %lld/%lld/%lld", idx, idx, idx);
+                    }
+                    std::fputs("\n", f);
+                }
+            }
+        }
+
+        const bool ok = std::fclose(f) == 0;
+        std::error_code ec;
+        if (ok)
+            std::filesystem::rename(tmp, path, ec);
+        return ok && !ec;
+    }
+}
+
+bool ParallelLoadObj(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+    std::vector<tinyobj::material_t>* materials, std::string* warn, std::string* err,
+    const char* filename, const char* mtlBaseDir, TaskPool* pool)
+{
+    std::vector<tinyobj::material_t> localMaterials;
+    if (!materials)
+        materials = &localMaterials;
+
+    const size_t warnSize = warn ? warn->size() : 0;
+    const size_t errSize = err ? err->size() : 0;
+    const size_t materialCount = materials->size();
+
+    auto Fallback = [&]()
+    {
+        if (warn) warn->resize(warnSize);
+        if (err) err->resize(errSize);
+        materials->resize(materialCount);
+        return tinyobj::LoadObj(attrib, shapes, materials, warn, err, filename, mtlBaseDir);
+    };
+
+    attrib->vertices.clear();
+    attrib->normals.clear();
+    attrib->texcoords.clear();
+    attrib->colors.clear();
+    shapes->clear();
+
+    MappedFile file(filename);
+    if (!file.IsOpen())
+        return Fallback();
+
+    const char* data = file.Data();
+    const size_t size = file.Size();
+
+    // границы кусков - сразу за концом строки, "\r\n" не разрезается
+    const size_t chunkCount = pool ? (std::max)((size_t)1, (std::min)((size_t)pool->GetThreadCount() * 4, size / kMinChunkBytes)) : 1;
+    std::vector<size_t> bounds = { 0 };
+    for (size_t i = 1; i < chunkCount; ++i)
+    {
+        size_t b = (std::max)(bounds.back(), size / chunkCount * i);
+        while (b < size && data[b - 1] != '\n' && data[b - 1] != '\r') ++b;
+        if (b < size && data[b - 1] == '\r' && data[b] == '\n') ++b;
+        if (b > bounds.back() && b < size)
+            bounds.push_back(b);
+    }
+    bounds.push_back(size);
+
+    std::vector<ObjChunk> chunks(bounds.size() - 1);
+    std::atomic<bool> unsupported{ false };
+    ForChunks(pool, chunks.size(), [&](size_t b, size_t e)
+    {
+        for (size_t i = b; i < e; ++i)
+        {
+            if (!ParseChunk(data + bounds[i], data + bounds[i + 1], chunks[i], unsupported))
+                unsupported = true;
+        }
+    });
+    if (unsupported || !BuildObj(chunks, attrib, shapes, materials, warn, err, mtlBaseDir, pool))
+        return Fallback();
+    return true;
+}
+
+ObjParseBenchmarkResult RunObjParseBenchmark(const std::string& path, uint32_t triangles, TaskPool* pool)
+{
+    ObjParseBenchmarkResult r;
+    r.threads = pool ? pool->GetThreadCount() : 1;
+
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec))
+    {
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        if (!WriteBenchmarkObj(path, triangles))
+            return r;
+    }
+    r.fileBytes = std::filesystem::file_size(path, ec);
+
+    tinyobj::attrib_t refAttrib;
+    std::vector<tinyobj::shape_t> refShapes;
+    std::vector<tinyobj::material_t> refMaterials;
+    std::string warn, err;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!tinyobj::LoadObj(&refAttrib, &refShapes, &refMaterials, &warn, &err, path.c_str(), nullptr))
+        return r;
+    r.tinyobjMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for (const tinyobj::shape_t& s : refShapes)
+        r.triangles += s.mesh.num_face_vertices.size();
+
+    // по одному результату за раз: на 10М треугольников каждый занимает сотни мегабайт
+    r.matches = true;
+    for (TaskPool* p : { (TaskPool*)nullptr, pool })
+    {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string w, e;
+
+        start = std::chrono::steady_clock::now();
+        const bool ok = ParallelLoadObj(&attrib, &shapes, &materials, &w, &e, path.c_str(), nullptr, p);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        (p ? r.parallelMs : r.singleMs) = ms;
+
+        r.matches = r.matches && ok && w == warn && e == err &&
+            SameObj(refAttrib, refShapes, refMaterials, attrib, shapes, materials);
+    }
+    return r;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tiny_obj_loader.h"
+
+class TaskPool;
+
+// Замена tinyobj::LoadObj (triangulate = true) для больших файлов. Файл отображается в память,
+// режется на куски по границам строк, куски разбираются параллельно и склеиваются по префиксным суммам.
+// Результат совпадает с tinyobj до бита: числа читаются тем же алгоритмом, четырёхугольники режутся
+// по той же диагонали, o/g/usemtl/s дают те же shape. Чего быстрый путь не повторяет
+// (l, p, t, vw, грани не из 3-4 вершин, индексы, на которые tinyobj выдаёт предупреждение),
+// то целиком разбирает tinyobj::LoadObj.
+// pool == nullptr - всё в вызывающем потоке.
+bool ParallelLoadObj(tinyobj::attrib_t* attrib, std::vector<tinyobj::shape_t>* shapes,
+    std::vector<tinyobj::material_t>* materials, std::string* warn, std::string* err,
+    const char* filename, const char* mtlBaseDir, TaskPool* pool);
+
+struct ObjParseBenchmarkResult
+{
+    uint64_t fileBytes = 0;
+    size_t triangles = 0;
+    unsigned threads = 0;
+    double tinyobjMs = 0.0;
+    double singleMs = 0.0;    // ParallelLoadObj без пула
+    double parallelMs = 0.0;
+    bool matches = false;     // attrib, shapes и materials совпали с tinyobj в обоих случаях
+};
+
+// если path ещё нет, пишет туда сетку примерно из triangles треугольников
+// (четырёхугольники v/vt/vn, несколько o/usemtl/s, часть граней с относительными индексами)
+ObjParseBenchmarkResult RunObjParseBenchmark(const std::string& path, uint32_t triangles, TaskPool* pool);
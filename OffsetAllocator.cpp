@@ -0,0 +1,153 @@
+#include "OffsetAllocator.h"
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+    uint32_t AlignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+OffsetAllocator::OffsetAllocator(uint32_t capacity)
+{
+    Init(capacity);
+}
+
+void OffsetAllocator::Init(uint32_t capacity)
+{
+    m_capacity = capacity;
+    m_used = 0;
+    m_freeByOffset.clear();
+    m_freeBySize.clear();
+    m_allocations.clear();
+    if (capacity != 0)
+        InsertFree(0, capacity);
+}
+
+void OffsetAllocator::InsertFree(uint32_t offset, uint32_t size)
+{
+    m_freeByOffset[offset] = size;
+    m_freeBySize.emplace(size, offset);
+}
+
+void OffsetAllocator::EraseFree(std::map<uint32_t, uint32_t>::iterator it)
+{
+    auto range = m_freeBySize.equal_range(it->second);
+    for (auto s = range.first; s != range.second; ++s)
+    {
+        if (s->second == it->first)
+        {
+            m_freeBySize.erase(s);
+            break;
+        }
+    }
+    m_freeByOffset.erase(it);
+}
+
+uint32_t OffsetAllocator::Allocate(uint32_t size, uint32_t alignment)
+{
+    if (size == 0 || alignment == 0)
+        return Invalid;
+
+    // самый маленький подходящий блок; с выравниванием может не влезть, тогда берём следующий
+    for (auto s = m_freeBySize.lower_bound(size); s != m_freeBySize.end(); ++s)
+    {
+        const uint32_t blockOffset = s->second;
+        const uint32_t blockSize = s->first;
+        const uint32_t offset = AlignUp(blockOffset, alignment);
+        const uint32_t padding = offset - blockOffset;
+        if (padding + size > blockSize)
+            continue;
+
+        EraseFree(m_freeByOffset.find(blockOffset));
+        if (padding != 0)
+            InsertFree(blockOffset, padding);
+        if (padding + size < blockSize)
+            InsertFree(offset + size, blockSize - padding - size);
+
+        m_allocations[offset] = { size, alignment };
+        m_used += size;
+        return offset;
+    }
+    return Invalid;
+}
+
+void OffsetAllocator::Free(uint32_t offset)
+{
+    auto a = m_allocations.find(offset);
+    if (a == m_allocations.end())
+        throw std::runtime_error("OffsetAllocator: freeing unknown offset");
+
+    uint32_t start = offset;
+    uint32_t end = offset + a->second.size;
+    m_used -= a->second.size;
+    m_allocations.erase(a);
+
+    // сливаем с соседями
+    auto next = m_freeByOffset.lower_bound(start);
+    if (next != m_freeByOffset.end() && next->first == end)
+    {
+        end += next->second;
+        EraseFree(next);
+        next = m_freeByOffset.lower_bound(start);
+    }
+    if (next != m_freeByOffset.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start)
+        {
+            start = prev->first;
+            EraseFree(prev);
+        }
+    }
+
+    InsertFree(start, end - start);
+}
+
+std::vector<OffsetAllocator::Move> OffsetAllocator::Compact()
+{
+    std::vector<Move> moves;
+    std::map<uint32_t, Allocation> packed;
+
+    uint32_t cursor = 0;
+    for (const auto& a : m_allocations)
+    {
+        const uint32_t to = AlignUp(cursor, a.second.alignment);
+        if (to != a.first)
+            moves.push_back({ a.first, to, a.second.size });
+        packed[to] = a.second;
+        cursor = to + a.second.size;
+    }
+
+    m_allocations.swap(packed);
+    m_freeByOffset.clear();
+    m_freeBySize.clear();
+
+    // дырки от выравнивания остаются свободными блоками
+    uint32_t prevEnd = 0;
+    for (const auto& a : m_allocations)
+    {
+        if (a.first > prevEnd)
+            InsertFree(prevEnd, a.first - prevEnd);
+        prevEnd = a.first + a.second.size;
+    }
+    if (prevEnd < m_capacity)
+        InsertFree(prevEnd, m_capacity - prevEnd);
+
+    return moves;
+}
+
+uint32_t OffsetAllocator::GetLargestFreeBlock() const
+{
+    return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+}
+
+float OffsetAllocator::GetFragmentation() const
+{
+    const uint32_t freeSpace = GetFree();
+    if (freeSpace == 0)
+        return 0.0f;
+    return 1.0f - (float)GetLargestFreeBlock() / (float)freeSpace;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Распределитель диапазонов внутри одного большого буфера (в элементах, не в байтах).
+// Best-fit по размеру, соседние свободные блоки сливаются при Free.
+// Compact() сдвигает живые блоки к началу и возвращает список перемещений для копирования на GPU.
+// С устройством не работает.
+class OffsetAllocator
+{
+public:
+    static const uint32_t Invalid = UINT32_MAX;
+
+    struct Move
+    {
+        uint32_t from;
+        uint32_t to;
+        uint32_t size;
+    };
+
+    OffsetAllocator() = default;
+    explicit OffsetAllocator(uint32_t capacity);
+
+    void Init(uint32_t capacity);
+
+    uint32_t Allocate(uint32_t size, uint32_t alignment = 1);
+    void Free(uint32_t offset);
+
+    // порядок блоков сохраняется, to <= from для каждого перемещения
+    std::vector<Move> Compact();
+
+    uint32_t GetCapacity() const { return m_capacity; }
+    uint32_t GetUsed() const { return m_used; }
+    uint32_t GetFree() const { return m_capacity - m_used; }
+    uint32_t GetLargestFreeBlock() const;
+    size_t GetAllocationCount() const { return m_allocations.size(); }
+    size_t GetFreeBlockCount() const { return m_freeByOffset.size(); }
+
+    // 0 - всё свободное место одним блоком, ближе к 1 - раздроблено
+    float GetFragmentation() const;
+
+private:
+    struct Allocation
+    {
+        uint32_t size;
+        uint32_t alignment;
+    };
+
+    void InsertFree(uint32_t offset, uint32_t size);
+    void EraseFree(std::map<uint32_t, uint32_t>::iterator it);
+
+    uint32_t m_capacity = 0;
+    uint32_t m_used = 0;
+
+    std::map<uint32_t, uint32_t> m_freeByOffset;
+    std::multimap<uint32_t, uint32_t> m_freeBySize;
+    std::map<uint32_t, Allocation> m_allocations;
+};
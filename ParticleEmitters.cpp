@@ -0,0 +1,390 @@
+#include "ParticleEmitters.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // смещение частицы за время u при vel += a * dt; pos += vel * dt:
+    // f(u) = 0.5 * a * u * (u + dt) + v * u, ищем min/max на [0, t]
+    void TrajectoryRange(float a, float dt, float v, float t, float& lo, float& hi)
+    {
+        auto f = [&](float u) { return 0.5f * a * u * (u + dt) + v * u; };
+        lo = (std::min)(0.0f, f(t));
+        hi = (std::max)(0.0f, f(t));
+        if (a != 0.0f)
+        {
+            const float u = -(0.5f * a * dt + v) / a;
+            if (u > 0.0f && u < t)
+            {
+                lo = (std::min)(lo, f(u));
+                hi = (std::max)(hi, f(u));
+            }
+        }
+    }
+}
+
+void ParticleEmitterPool::Init(uint32_t capacity)
+{
+    m_emitters.clear();
+    m_ranges.Init(capacity);
+    m_capacity = capacity;
+    m_budget = capacity;
+    m_totalAlive = 0;
+    m_frame = 0;
+}
+
+const ParticleEmitterPool::Emitter* ParticleEmitterPool::Find(ParticleEmitterId id) const
+{
+    auto it = m_emitters.find(id);
+    return it != m_emitters.end() ? &it->second : nullptr;
+}
+
+ParticleEmitterPool::Emitter* ParticleEmitterPool::Find(ParticleEmitterId id)
+{
+    auto it = m_emitters.find(id);
+    return it != m_emitters.end() ? &it->second : nullptr;
+}
+
+ParticleEmitterId ParticleEmitterPool::Create(const ParticleEmitterDesc& desc)
+{
+    uint32_t size = desc.capacity;
+    if (size == 0)
+    {
+        const double steady = std::ceil((double)desc.spawnRate * (double)desc.lifetime);
+        size = (uint32_t)(std::min)((double)desc.burst + steady, (double)m_capacity);
+    }
+    if (size == 0)
+        return InvalidParticleEmitter;
+
+    const uint32_t offset = m_ranges.Allocate(size);
+    if (offset == OffsetAllocator::Invalid)
+        return InvalidParticleEmitter;
+
+    const ParticleEmitterId id = m_nextId++;
+    Emitter& e = m_emitters[id];
+    e.desc = desc;
+    e.rangeOffset = offset;
+    e.rangeSize = size;
+    e.pendingBurst = desc.burst;
+    e.bounds.expand(desc.position);
+    return id;
+}
+
+void ParticleEmitterPool::Destroy(ParticleEmitterId id)
+{
+    auto it = m_emitters.find(id);
+    if (it == m_emitters.end())
+        return;
+
+    if (it->second.alive == 0)
+    {
+        m_ranges.Free(it->second.rangeOffset);
+        m_emitters.erase(it);
+        return;
+    }
+    it->second.destroyed = true;
+    it->second.pendingBurst = 0;
+}
+
+void ParticleEmitterPool::SetPosition(ParticleEmitterId id, const XMFLOAT3& position)
+{
+    if (Emitter* e = Find(id))
+        e->desc.position = position;
+}
+
+void ParticleEmitterPool::SetSpawnRate(ParticleEmitterId id, float spawnRate)
+{
+    if (Emitter* e = Find(id))
+        e->desc.spawnRate = (std::max)(spawnRate, 0.0f);
+}
+
+void ParticleEmitterPool::SetGlobalBudget(uint32_t maxAlive)
+{
+    m_budget = (std::min)(maxAlive, m_capacity);
+}
+
+void ParticleEmitterPool::Update(float dt, const XMFLOAT3& accel, const ParticleBudgetView& view, std::vector<ParticleEmitterSpawn>& out)
+{
+    out.clear();
+    ++m_frame;
+
+    m_totalAlive = 0;
+    for (auto it = m_emitters.begin(); it != m_emitters.end();)
+    {
+        Emitter& e = it->second;
+        for (Batch& b : e.batches)
+            b.age += dt;
+        // партии идут от старых к новым, lifetime у всех одинаковый
+        while (!e.batches.empty() && !(e.batches.front().age < e.desc.lifetime))
+        {
+            e.alive -= e.batches.front().count;
+            e.batches.pop_front();
+        }
+
+        if (e.destroyed && e.alive == 0)
+        {
+            m_ranges.Free(e.rangeOffset);
+            it = m_emitters.erase(it);
+            continue;
+        }
+
+        m_totalAlive += e.alive;
+        UpdateBounds(e, accel, dt);
+        UpdateImportance(e, view);
+        ++it;
+    }
+
+    uint32_t available = m_budget > m_totalAlive ? m_budget - m_totalAlive : 0;
+
+    // burst и spawnRate одного кадра - одна партия и один запуск CS_Emit на эмиттер
+    auto take = [&](Emitter& e, uint32_t count)
+    {
+        count = (std::min)({ count, e.rangeSize - e.alive, available });
+        e.alive += count;
+        e.spawned += count;
+        m_totalAlive += count;
+        available -= count;
+    };
+
+    for (auto& [id, e] : m_emitters)
+    {
+        e.spawned = 0;
+        if (e.pendingBurst == 0)
+            continue;
+        take(e, e.pendingBurst);
+        e.pendingBurst = 0;
+    }
+
+    DistributeBudget(available);
+
+    for (auto& [id, e] : m_emitters)
+    {
+        if (e.destroyed || e.desc.spawnRate <= 0.0f)
+            continue;
+
+        e.accumulator = (std::min)(e.accumulator + e.desc.spawnRate * e.spawnScale * dt, (float)e.rangeSize);
+        const uint32_t count = (uint32_t)e.accumulator;
+        // не влезшее в диапазон или бюджет не копится
+        e.accumulator -= (float)count;
+        take(e, count);
+    }
+
+    for (auto& [id, e] : m_emitters)
+    {
+        if (e.spawned == 0)
+            continue;
+
+        e.batches.push_back({ 0.0f, e.spawned, e.desc.position });
+
+        ParticleEmitterSpawn s;
+        s.id = id;
+        s.count = e.spawned;
+        s.seed = id * 0x9E3779B9u + m_frame * 0x85EBCA6Bu;
+        s.position = e.desc.position;
+        s.initialSpeed = e.desc.initialSpeed;
+        s.lifetime = e.desc.lifetime;
+        out.push_back(s);
+    }
+}
+
+void ParticleEmitterPool::UpdateBounds(Emitter& e, const XMFLOAT3& accel, float dt) const
+{
+    AABB b;
+    b.expand(e.desc.position);
+
+    const float speed = std::fabs(e.desc.initialSpeed);
+    const float a[3] = { accel.x, accel.y, accel.z };
+
+    const Batch* prev = nullptr;
+    for (const Batch& batch : e.batches)
+    {
+        // партии из той же точки моложе предыдущей и лежат внутри её траектории
+        if (prev && prev->origin.x == batch.origin.x && prev->origin.y == batch.origin.y && prev->origin.z == batch.origin.z)
+            continue;
+        prev = &batch;
+
+        const float o[3] = { batch.origin.x, batch.origin.y, batch.origin.z };
+        float lo[3], hi[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            float l, h;
+            TrajectoryRange(a[k], dt, -speed, batch.age, lo[k], h);
+            TrajectoryRange(a[k], dt, speed, batch.age, l, hi[k]);
+            lo[k] += o[k];
+            hi[k] += o[k];
+        }
+        b.expand(XMFLOAT3{ lo[0], lo[1], lo[2] });
+        b.expand(XMFLOAT3{ hi[0], hi[1], hi[2] });
+    }
+    e.bounds = b;
+}
+
+void ParticleEmitterPool::UpdateImportance(Emitter& e, const ParticleBudgetView& view) const
+{
+    if (!view.valid)
+    {
+        e.visible = true;
+        e.importance = 1.0f;
+        return;
+    }
+
+    e.visible = IntersectsFrustum(e.bounds, view.planes);
+    if (!e.visible)
+    {
+        e.importance = 0.0f;
+        return;
+    }
+
+    // квадрат проекции описанной сферы: примерно доля экрана
+    const XMFLOAT3 c = e.bounds.center();
+    const XMFLOAT3 s = e.bounds.size();
+    const float r = 0.5f * std::sqrt(s.x * s.x + s.y * s.y + s.z * s.z);
+    const float depth = c.x * view.depthPlane[0] + c.y * view.depthPlane[1] + c.z * view.depthPlane[2] + view.depthPlane[3];
+
+    if (depth <= r)
+    {
+        e.importance = 1.0f;
+        return;
+    }
+    const float p = r * view.projScale / depth;
+    e.importance = (std::min)((std::max)(p * p, 1e-4f), 1.0f);
+}
+
+void ParticleEmitterPool::DistributeBudget(uint32_t available)
+{
+    struct Demand
+    {
+        Emitter* e;
+        float demand;
+        float weight;
+        float quota;
+        bool done;
+    };
+
+    // живые частицы эмиттеров со spawnRate уже в бюджете, на них и делим
+    std::vector<Demand> demands;
+    float pool = (float)available;
+    float total = 0.0f;
+    for (auto& [id, e] : m_emitters)
+    {
+        if (e.destroyed || e.desc.spawnRate <= 0.0f)
+            continue;
+        const float d = (std::min)((float)e.rangeSize, e.desc.spawnRate * e.desc.lifetime);
+        demands.push_back({ &e, d, e.visible ? e.importance : 0.0f, 0.0f, false });
+        pool += (float)e.alive;
+        total += d;
+    }
+
+    if (total <= pool)
+    {
+        for (Demand& d : demands)
+            d.e->spawnScale = 1.0f;
+        return;
+    }
+
+    // водозаполнение: доли по весу, насытившиеся эмиттеры отдают остаток остальным
+    float remaining = pool;
+    for (;;)
+    {
+        float weight = 0.0f;
+        for (const Demand& d : demands)
+            if (!d.done && d.weight > 0.0f)
+                weight += d.weight;
+        if (weight <= 0.0f)
+            break;
+
+        bool saturated = false;
+        for (Demand& d : demands)
+        {
+            if (d.done || d.weight <= 0.0f)
+                continue;
+            if (remaining * d.weight / weight >= d.demand)
+            {
+                d.quota = d.demand;
+                d.done = true;
+                saturated = true;
+            }
+        }
+
+        if (!saturated)
+        {
+            for (Demand& d : demands)
+                if (!d.done && d.weight > 0.0f)
+                    d.quota = remaining * d.weight / weight;
+            break;
+        }
+
+        remaining = pool;
+        for (const Demand& d : demands)
+            if (d.done)
+                remaining -= d.quota;
+    }
+
+    for (Demand& d : demands)
+        d.e->spawnScale = d.demand > 0.0f ? d.quota / d.demand : 0.0f;
+}
+
+bool ParticleEmitterPool::Exists(ParticleEmitterId id) const
+{
+    const Emitter* e = Find(id);
+    return e && !e->destroyed;
+}
+
+uint32_t ParticleEmitterPool::GetAliveCount(ParticleEmitterId id) const
+{
+    const Emitter* e = Find(id);
+    return e ? e->alive : 0;
+}
+
+uint32_t ParticleEmitterPool::GetRangeOffset(ParticleEmitterId id) const
+{
+    const Emitter* e = Find(id);
+    return e ? e->rangeOffset : OffsetAllocator::Invalid;
+}
+
+uint32_t ParticleEmitterPool::GetRangeSize(ParticleEmitterId id) const
+{
+    const Emitter* e = Find(id);
+    return e ? e->rangeSize : 0;
+}
+
+float ParticleEmitterPool::GetSpawnScale(ParticleEmitterId id) const
+{
+    const Emitter* e = Find(id);
+    return e ? e->spawnScale : 0.0f;
+}
+
+float ParticleEmitterPool::GetImportance(ParticleEmitterId id) const
+{
+    const Emitter* e = Find(id);
+    return e ? e->importance : 0.0f;
+}
+
+bool ParticleEmitterPool::IsVisible(ParticleEmitterId id) const
+{
+    const Emitter* e = Find(id);
+    return e && e->visible;
+}
+
+AABB ParticleEmitterPool::GetBounds(ParticleEmitterId id) const
+{
+    const Emitter* e = Find(id);
+    return e ? e->bounds : AABB{};
+}
+
+bool ParticleEmitterPool::AnyVisible() const
+{
+    for (const auto& [id, e] : m_emitters)
+        if (e.visible && e.alive > 0)
+            return true;
+    return false;
+}
+
+std::vector<ParticleEmitterId> ParticleEmitterPool::GetEmitterIds() const
+{
+    std::vector<ParticleEmitterId> ids;
+    ids.reserve(m_emitters.size());
+    for (const auto& [id, e] : m_emitters)
+        ids.push_back(id);
+    return ids;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <cfloat>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+#include "Octree.h"
+#include "OffsetAllocator.h"
+
+using ParticleEmitterId = uint32_t;
+static const ParticleEmitterId InvalidParticleEmitter = 0;
+
+struct ParticleEmitterDesc
+{
+    XMFLOAT3 position{ 0.0f, 0.0f, 0.0f };
+    float initialSpeed = 8.0f;
+    float lifetime = 50.0f;
+    // частиц в секунду
+    float spawnRate = 0.0f;
+    // выпускаются при ближайшем Update; важность на них не влияет, но диапазон и бюджет ограничивают
+    uint32_t burst = 0;
+    // диапазон в общем пуле; 0 - burst + spawnRate * lifetime
+    uint32_t capacity = 0;
+};
+
+// один запуск CS_Emit
+struct ParticleEmitterSpawn
+{
+    ParticleEmitterId id = InvalidParticleEmitter;
+    uint32_t count = 0;
+    uint32_t seed = 0;
+    XMFLOAT3 position{};
+    float initialSpeed = 0.0f;
+    float lifetime = 0.0f;
+};
+
+// Камера для отсечения и важности: плоскости как у ExtractFrustumPlanes,
+// depthPlane - глубина (w после ViewProj), projScale - 1 / tan(fovY / 2).
+struct ParticleBudgetView
+{
+    bool valid = false;
+    XMFLOAT4 planes[6]{};
+    float depthPlane[4]{};
+    float projScale = 1.0f;
+};
+
+// Эмиттеры над одним пулом частиц. Каждый эмиттер держит диапазон пула (OffsetAllocator),
+// число живых частиц считается на CPU тем же шагом, что CS_Update, поэтому readback не нужен.
+// Когда суммарный спрос больше бюджета, скорость спавна делится по важности на экране.
+// С устройством не работает.
+class ParticleEmitterPool
+{
+public:
+    ParticleEmitterPool() = default;
+    explicit ParticleEmitterPool(uint32_t capacity) { Init(capacity); }
+
+    void Init(uint32_t capacity);
+
+    // InvalidParticleEmitter - диапазон не влез в пул
+    ParticleEmitterId Create(const ParticleEmitterDesc& desc);
+    // новых частиц не будет; диапазон вернётся в пул, когда умрут уже выпущенные
+    void Destroy(ParticleEmitterId id);
+    void SetPosition(ParticleEmitterId id, const XMFLOAT3& position);
+    void SetSpawnRate(ParticleEmitterId id, float spawnRate);
+
+    // не больше ёмкости пула
+    void SetGlobalBudget(uint32_t maxAlive);
+    uint32_t GetGlobalBudget() const { return m_budget; }
+
+    // старение как в CS_Update (age += dt, смерть при age >= lifetime), затем спавн в out:
+    // не больше одного ParticleEmitterSpawn на эмиттер
+    void Update(float dt, const XMFLOAT3& accel, const ParticleBudgetView& view, std::vector<ParticleEmitterSpawn>& out);
+
+    bool Exists(ParticleEmitterId id) const;
+    uint32_t GetCapacity() const { return m_capacity; }
+    uint32_t GetAliveCount() const { return m_totalAlive; }
+    uint32_t GetAliveCount(ParticleEmitterId id) const;
+    uint32_t GetRangeOffset(ParticleEmitterId id) const;
+    uint32_t GetRangeSize(ParticleEmitterId id) const;
+    // доля запрошенного spawnRate, которую дал бюджет на последнем Update
+    float GetSpawnScale(ParticleEmitterId id) const;
+    float GetImportance(ParticleEmitterId id) const;
+    bool IsVisible(ParticleEmitterId id) const;
+    AABB GetBounds(ParticleEmitterId id) const;
+    // есть ли видимый эмиттер с живыми частицами
+    bool AnyVisible() const;
+
+    // вместе с удалёнными, у которых ещё живут частицы
+    size_t GetEmitterCount() const { return m_emitters.size(); }
+    std::vector<ParticleEmitterId> GetEmitterIds() const;
+    const OffsetAllocator& GetRanges() const { return m_ranges; }
+
+private:
+    struct Batch
+    {
+        float age;
+        uint32_t count;
+        XMFLOAT3 origin;
+    };
+
+    struct Emitter
+    {
+        ParticleEmitterDesc desc;
+        uint32_t rangeOffset = 0;
+        uint32_t rangeSize = 0;
+
+        // от старых к новым
+        std::deque<Batch> batches;
+        uint32_t alive = 0;
+        uint32_t pendingBurst = 0;
+        float accumulator = 0.0f;
+        // выпущено на текущем Update
+        uint32_t spawned = 0;
+
+        float spawnScale = 1.0f;
+        float importance = 1.0f;
+        bool visible = true;
+        bool destroyed = false;
+        AABB bounds;
+    };
+
+    const Emitter* Find(ParticleEmitterId id) const;
+    Emitter* Find(ParticleEmitterId id);
+
+    void UpdateBounds(Emitter& e, const XMFLOAT3& accel, float dt) const;
+    void UpdateImportance(Emitter& e, const ParticleBudgetView& view) const;
+    // spawnScale для эмиттеров со spawnRate, available - сколько ещё частиц влезает в бюджет
+    void DistributeBudget(uint32_t available);
+
+    std::map<ParticleEmitterId, Emitter> m_emitters;
+    OffsetAllocator m_ranges;
+    uint32_t m_capacity = 0;
+    uint32_t m_budget = 0;
+    uint32_t m_totalAlive = 0;
+    uint32_t m_frame = 0;
+    ParticleEmitterId m_nextId = 1;
+};
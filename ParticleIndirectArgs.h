@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+// Буфер аргументов для ExecuteIndirect частиц. CS_BuildArgs (ParticlesCS.hlsl) пишет его
+// из счётчика append-буфера; BuildParticleIndirectArgs - то же самое на CPU, байт в байт.
+struct ParticleIndirectArgs
+{
+    // D3D12_DISPATCH_ARGUMENTS для CS_Update
+    uint32_t threadGroupCountX;
+    uint32_t threadGroupCountY;
+    uint32_t threadGroupCountZ;
+
+    // D3D12_DRAW_INDEXED_ARGUMENTS для DrawGBuffer
+    uint32_t indexCountPerInstance;
+    uint32_t instanceCount;
+    uint32_t startIndexLocation;
+    int32_t baseVertexLocation;
+    uint32_t startInstanceLocation;
+};
+static_assert(sizeof(ParticleIndirectArgs) == 32, "layout must match CS_BuildArgs");
+
+static const uint32_t ParticleUpdateGroupSize = 256;
+static const uint32_t ParticleMaxGroupCount = 65535;
+static const uint32_t ParticleDispatchArgsOffset = 0;
+static const uint32_t ParticleDrawArgsOffset = 12;
+
+inline ParticleIndirectArgs BuildParticleIndirectArgs(uint32_t aliveCount, uint32_t indexCountPerInstance)
+{
+    ParticleIndirectArgs a{};
+    uint32_t groups = aliveCount / ParticleUpdateGroupSize + (aliveCount % ParticleUpdateGroupSize != 0 ? 1u : 0u);
+    a.threadGroupCountX = groups < ParticleMaxGroupCount ? groups : ParticleMaxGroupCount;
+    a.threadGroupCountY = 1;
+    a.threadGroupCountZ = 1;
+
+    a.indexCountPerInstance = indexCountPerInstance;
+    a.instanceCount = aliveCount;
+    return a;
+}
@@ -0,0 +1,213 @@
+#include "ParticleSort.h"
+#include "CpuParticleSim.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    const uint32_t RadixBits = 8;
+    const uint32_t RadixBins = 1u << RadixBits;
+}
+
+uint32_t ParticleDepthKey(float viewDepth)
+{
+    uint32_t u;
+    memcpy(&u, &viewDepth, sizeof(u));
+    // float -> uint с сохранением порядка, затем инверсия: дальние первыми
+    u ^= (u & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+    return ~u;
+}
+
+void ParticleDepthPlane(const float viewProj[16], float plane[4])
+{
+    plane[0] = viewProj[3];
+    plane[1] = viewProj[7];
+    plane[2] = viewProj[11];
+    plane[3] = viewProj[15];
+}
+
+void ParticleRadixSort::ForChunks(size_t count, const std::function<void(size_t, size_t)>& fn)
+{
+    if (m_pool)
+    {
+        m_pool->ParallelFor(count, ChunkSize, fn);
+        return;
+    }
+    for (size_t b = 0; b < count; b += ChunkSize)
+        fn(b, (std::min)(count, b + ChunkSize));
+}
+
+void ParticleRadixSort::Sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values)
+{
+    const size_t n = keys.size();
+    if (n < 2)
+        return;
+
+    const size_t chunks = (n + ChunkSize - 1) / ChunkSize;
+    m_keysTmp.resize(n);
+    m_valuesTmp.resize(n);
+    m_histograms.resize(chunks * RadixBins);
+
+    std::vector<uint32_t>* srcK = &keys;
+    std::vector<uint32_t>* srcV = &values;
+    std::vector<uint32_t>* dstK = &m_keysTmp;
+    std::vector<uint32_t>* dstV = &m_valuesTmp;
+
+    for (uint32_t shift = 0; shift < 32; shift += RadixBits)
+    {
+        const uint32_t* sk = srcK->data();
+
+        ForChunks(n, [&](size_t b, size_t e)
+        {
+            uint32_t* h = m_histograms.data() + (b / ChunkSize) * RadixBins;
+            std::fill(h, h + RadixBins, 0u);
+            for (size_t i = b; i < e; ++i)
+                ++h[(sk[i] >> shift) & (RadixBins - 1)];
+        });
+
+        // разряд у всех ключей один и тот же - проход ничего не переставит
+        bool uniform = false;
+        const uint32_t d0 = (sk[0] >> shift) & (RadixBins - 1);
+        {
+            size_t total = 0;
+            for (size_t c = 0; c < chunks; ++c)
+                total += m_histograms[c * RadixBins + d0];
+            uniform = (total == n);
+        }
+        if (uniform)
+            continue;
+
+        // гистограммы -> начала выходных диапазонов: по разрядам, внутри разряда по чанкам
+        uint32_t running = 0;
+        for (uint32_t d = 0; d < RadixBins; ++d)
+        {
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                uint32_t& h = m_histograms[c * RadixBins + d];
+                const uint32_t count = h;
+                h = running;
+                running += count;
+            }
+        }
+
+        const uint32_t* sv = srcV->data();
+        uint32_t* dk = dstK->data();
+        uint32_t* dv = dstV->data();
+
+        ForChunks(n, [&](size_t b, size_t e)
+        {
+            uint32_t offsets[RadixBins];
+            memcpy(offsets, m_histograms.data() + (b / ChunkSize) * RadixBins, sizeof(offsets));
+            for (size_t i = b; i < e; ++i)
+            {
+                const uint32_t at = offsets[(sk[i] >> shift) & (RadixBins - 1)]++;
+                dk[at] = sk[i];
+                dv[at] = sv[i];
+            }
+        });
+
+        std::swap(srcK, dstK);
+        std::swap(srcV, dstV);
+    }
+
+    // результат остался во временных массивах - отдаём их вызывающему
+    if (srcK != &keys)
+    {
+        keys.swap(m_keysTmp);
+        values.swap(m_valuesTmp);
+    }
+}
+
+void ParticleRadixSort::BuildDrawOrder(const CpuParticleSim& sim, const float depthPlane[4], std::vector<uint32_t>& order)
+{
+    const uint32_t n = sim.GetAliveCount();
+    m_keys.resize(n);
+    order.resize(n);
+
+    ForChunks(n, [&](size_t b, size_t e)
+    {
+        for (size_t i = b; i < e; ++i)
+        {
+            const ParticleCPU p = sim.GetParticle((uint32_t)i);
+            const float depth = p.pos[0] * depthPlane[0] + p.pos[1] * depthPlane[1] + p.pos[2] * depthPlane[2] + depthPlane[3];
+            m_keys[i] = ParticleDepthKey(depth);
+            order[i] = (uint32_t)i;
+        }
+    });
+
+    Sort(m_keys, order);
+}
+
+RadixSortBenchmarkResult RunRadixSortBenchmark(uint32_t count, TaskPool* pool)
+{
+    std::mt19937 rng(12345u);
+    std::uniform_real_distribution<float> depth(0.1f, 5000.0f);
+
+    std::vector<uint32_t> keys(count), values(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        keys[i] = ParticleDepthKey(depth(rng));
+        values[i] = i;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> reference(count);
+    for (uint32_t i = 0; i < count; ++i)
+        reference[i] = { keys[i], values[i] };
+
+    ParticleRadixSort sorter(pool);
+
+    auto start = std::chrono::steady_clock::now();
+    sorter.Sort(keys, values);
+    const double radixMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // радикс стабилен, а индексы шли по возрастанию, так что порядок совпадает с сортировкой пар
+    start = std::chrono::steady_clock::now();
+    std::sort(reference.begin(), reference.end());
+    const double stdMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    bool matches = true;
+    for (uint32_t i = 0; i < count && matches; ++i)
+        matches = reference[i].first == keys[i] && reference[i].second == values[i];
+
+    RadixSortBenchmarkResult r;
+    r.count = count;
+    r.threads = pool ? pool->GetThreadCount() : 1;
+    r.radixMs = radixMs;
+    r.stdSortMs = stdMs;
+    r.matchesStdSort = matches;
+
+    // живые частицы разлетаются из одной точки, камера смотрит вдоль +Z
+    CpuParticleSim sim(pool);
+    sim.Reset(count);
+    ParticleUpdateCB cb{};
+    cb.spawnCount = count;
+    cb.initialSpeed = 20.0f;
+    cb.lifetime = 1000.0f;
+    sim.Emit(cb);
+    cb.spawnCount = 0;
+    cb.dt = 0.5f;
+    for (int i = 0; i < 4; ++i)
+        sim.Update(cb);
+
+    const float plane[4] = { 0.0f, 0.0f, 1.0f, 200.0f };
+    std::vector<uint32_t> order;
+    start = std::chrono::steady_clock::now();
+    sorter.BuildDrawOrder(sim, plane, order);
+    r.drawOrderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> drawKeys(sim.GetAliveCount());
+    std::vector<uint32_t> expected(sim.GetAliveCount());
+    for (uint32_t i = 0; i < sim.GetAliveCount(); ++i)
+    {
+        const ParticleCPU p = sim.GetParticle(i);
+        drawKeys[i] = ParticleDepthKey(p.pos[0] * plane[0] + p.pos[1] * plane[1] + p.pos[2] * plane[2] + plane[3]);
+        expected[i] = i;
+    }
+    std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) { return drawKeys[a] < drawKeys[b]; });
+    r.drawOrderStdMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    r.drawOrderMatches = order == expected;
+    return r;
+}
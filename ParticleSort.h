@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "TaskPool.h"
+
+class CpuParticleSim;
+
+// Ключ сортировки частиц от дальних к ближним: чем больше глубина, тем меньше ключ.
+// Тот же ключ строит CS_SortKeys (ParticleSort.hlsl).
+uint32_t ParticleDepthKey(float viewDepth);
+
+// Глубина в виде w после ViewProj: dot(float4(pos, 1), plane), plane - четвёртый столбец матрицы
+void ParticleDepthPlane(const float viewProj[16], float plane[4]);
+
+// Стабильная LSD-сортировка 32-битных ключей по 8 бит; values переставляются вместе с ключами.
+// Гистограммы и раскладка считаются кусками на TaskPool, разряды, одинаковые у всех ключей, пропускаются.
+class ParticleRadixSort
+{
+public:
+    static const size_t ChunkSize = 64 * 1024;
+
+    explicit ParticleRadixSort(TaskPool* pool = nullptr) : m_pool(pool) {}
+
+    void Sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values);
+
+    // порядок отрисовки живых частиц sim, по индексам GetParticle
+    void BuildDrawOrder(const CpuParticleSim& sim, const float depthPlane[4], std::vector<uint32_t>& order);
+
+private:
+    void ForChunks(size_t count, const std::function<void(size_t, size_t)>& fn);
+
+    TaskPool* m_pool = nullptr;
+    std::vector<uint32_t> m_keysTmp;
+    std::vector<uint32_t> m_valuesTmp;
+    std::vector<uint32_t> m_keys;
+    // [чанк * 256 + разряд]
+    std::vector<uint32_t> m_histograms;
+};
+
+struct RadixSortBenchmarkResult
+{
+    uint32_t count = 0;
+    unsigned threads = 0;
+    double radixMs = 0.0;
+    double stdSortMs = 0.0;
+    bool matchesStdSort = false;
+
+    // BuildDrawOrder на count частицах CpuParticleSim против std::stable_sort по ключу глубины
+    double drawOrderMs = 0.0;
+    double drawOrderStdMs = 0.0;
+    bool drawOrderMatches = false;
+};
+
+// случайные глубины, сравнение с std::sort по паре (ключ, индекс); затем порядок отрисовки CpuParticleSim
+RadixSortBenchmarkResult RunRadixSortBenchmark(uint32_t count, TaskPool* pool);
@@ -0,0 +1,166 @@
+// Сортировка частиц от дальних к ближним: CS_SortKeys, затем 4 прохода по 8 бит
+// (CS_SortHistogram, CS_SortScan, CS_SortScatter). Один поток - одна частица, группа - 256 частиц.
+// Ключи и разряды совпадают с ParticleRadixSort (ParticleSort.cpp).
+
+cbuffer ParticleSortCB : register(b0)
+{
+    float4 DepthPlane;
+    uint Shift;
+};
+
+struct Particle
+{
+    float3 pos;
+    float3 vel;
+    float age;
+    float lifetime;
+    float size;
+};
+
+StructuredBuffer<Particle> gParticles : register(t0);
+ByteAddressBuffer gAliveCount : register(t1);
+
+RWStructuredBuffer<uint> gKeysIn : register(u0);
+RWStructuredBuffer<uint> gValuesIn : register(u1);
+RWStructuredBuffer<uint> gKeysOut : register(u2);
+RWStructuredBuffer<uint> gValuesOut : register(u3);
+// [разряд * число групп + группа]
+RWStructuredBuffer<uint> gHistogram : register(u4);
+
+#define SORT_GROUP 256
+#define SORT_BINS 256
+#define SORT_PAD 0xFFFFFFFFu
+// как ParticleMaxGroupCount в CS_BuildArgs: больше групп за один Dispatch не запустить
+#define SORT_MAX_GROUPS 65535
+
+groupshared uint gsScan[SORT_GROUP];
+groupshared uint gsKeys[SORT_GROUP];
+groupshared uint gsValues[SORT_GROUP];
+groupshared uint gsDigitStart[SORT_BINS];
+
+uint SortGroupCount(uint count)
+{
+    return min(count / SORT_GROUP + (count % SORT_GROUP != 0 ? 1 : 0), SORT_MAX_GROUPS);
+}
+
+uint DepthKey(float depth)
+{
+    uint u = asuint(depth);
+    u ^= (u & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+    return ~u;
+}
+
+uint Digit(uint key)
+{
+    return (key >> Shift) & (SORT_BINS - 1);
+}
+
+// включительная сумма gsScan по группе
+void GroupInclusiveScan(uint gi)
+{
+    GroupMemoryBarrierWithGroupSync();
+    [unroll]
+    for (uint offset = 1; offset < SORT_GROUP; offset <<= 1)
+    {
+        uint v = gi >= offset ? gsScan[gi - offset] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gsScan[gi] += v;
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
+
+[numthreads(SORT_GROUP, 1, 1)]
+void CS_SortKeys(uint3 id : SV_DispatchThreadID)
+{
+    uint count = gAliveCount.Load(0);
+    if (id.x >= count)
+        return;
+
+    float depth = dot(float4(gParticles[id.x].pos, 1.0), DepthPlane);
+    gKeysOut[id.x] = DepthKey(depth);
+    gValuesOut[id.x] = id.x;
+}
+
+[numthreads(SORT_GROUP, 1, 1)]
+void CS_SortHistogram(uint3 gid : SV_GroupID, uint gi : SV_GroupIndex)
+{
+    gsDigitStart[gi] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint count = gAliveCount.Load(0);
+    uint i = gid.x * SORT_GROUP + gi;
+    if (i < count)
+        InterlockedAdd(gsDigitStart[Digit(gKeysIn[i])], 1);
+    GroupMemoryBarrierWithGroupSync();
+
+    gHistogram[gi * SortGroupCount(count) + gid.x] = gsDigitStart[gi];
+}
+
+// одна группа: гистограмма -> исключающие префиксные суммы, т.е. начала диапазонов в выходе
+[numthreads(SORT_GROUP, 1, 1)]
+void CS_SortScan(uint gi : SV_GroupIndex)
+{
+    uint total = SortGroupCount(gAliveCount.Load(0)) * SORT_BINS;
+    uint perThread = (total + SORT_GROUP - 1) / SORT_GROUP;
+    uint begin = gi * perThread;
+    uint end = min(begin + perThread, total);
+
+    uint sum = 0;
+    for (uint i = begin; i < end; ++i)
+        sum += gHistogram[i];
+
+    gsScan[gi] = sum;
+    GroupInclusiveScan(gi);
+
+    uint running = gsScan[gi] - sum;
+    for (uint j = begin; j < end; ++j)
+    {
+        uint h = gHistogram[j];
+        gHistogram[j] = running;
+        running += h;
+    }
+}
+
+[numthreads(SORT_GROUP, 1, 1)]
+void CS_SortScatter(uint3 gid : SV_GroupID, uint gi : SV_GroupIndex)
+{
+    uint count = gAliveCount.Load(0);
+    uint i = gid.x * SORT_GROUP + gi;
+
+    // хвост последней группы - ключи SORT_PAD, после сортировки они в конце разряда 255 и не пишутся
+    uint key = i < count ? gKeysIn[i] : SORT_PAD;
+    uint value = i < count ? gValuesIn[i] : SORT_PAD;
+
+    // стабильная сортировка группы по разряду: 8 разбиений по одному биту
+    [loop]
+    for (uint b = 0; b < 8; ++b)
+    {
+        uint bit = (Digit(key) >> b) & 1;
+        gsScan[gi] = bit;
+        GroupInclusiveScan(gi);
+
+        uint onesBefore = gsScan[gi] - bit;
+        uint ones = gsScan[SORT_GROUP - 1];
+        uint dst = bit ? (SORT_GROUP - ones + onesBefore) : (gi - onesBefore);
+
+        gsKeys[dst] = key;
+        gsValues[dst] = value;
+        GroupMemoryBarrierWithGroupSync();
+
+        key = gsKeys[gi];
+        value = gsValues[gi];
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    uint digit = Digit(key);
+    if (gi == 0 || Digit(gsKeys[gi - 1]) != digit)
+        gsDigitStart[digit] = gi;
+    GroupMemoryBarrierWithGroupSync();
+
+    if (value == SORT_PAD)
+        return;
+
+    uint dst = gHistogram[digit * SortGroupCount(count) + gid.x] + (gi - gsDigitStart[digit]);
+    gKeysOut[dst] = key;
+    gValuesOut[dst] = value;
+}
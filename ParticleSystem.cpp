@@ -1,18 +1,12 @@
 ﻿#include "ParticleSystem.h"
+#include <algorithm>
 #include <stdexcept>
 #include <DirectXMath.h>
 #include "Meshes.h"
+#include "ParticleSort.h"
+#include "FrustumPlane.h"
 using namespace DirectX;
 
-struct UpdateCB
-{
-    float dt; float accel[3];
-    UINT  spawnCount;
-    float emitterPos[3];
-    float initialSpeed;
-    UINT  aliveCount;
-};
-
 static inline void ThrowIfFailed(HRESULT hr) { if (FAILED(hr)) throw std::runtime_error("hr"); }
 
 ParticleSystem::ParticleSystem(DX12Framework* fw, Pipeline* pipe)
@@ -21,21 +15,37 @@ ParticleSystem::ParticleSystem(DX12Framework* fw, Pipeline* pipe)
 
 void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
 {
+    // CS_Update и сортировка запускаются одним Dispatch, не больше ParticleMaxGroupCount групп
+    if (maxParticles > ParticleMaxGroupCount * ParticleUpdateGroupSize)
+        throw std::runtime_error("ParticleSystem: maxParticles exceeds one dispatch");
+
     m_maxParticles = maxParticles;
     m_initialSpawn = initialSpawn;
 
     auto* dev = m_framework->GetDevice();
 
+    m_emitters.Init(m_maxParticles);
+    if (m_initialSpawn > 0)
+    {
+        ParticleEmitterDesc desc;
+        desc.position = { 0.0f, 100.0f, 0.0f };
+        desc.initialSpeed = 8.0f;
+        desc.lifetime = 50.0f;
+        desc.burst = m_initialSpawn;
+        desc.capacity = m_initialSpawn;
+        m_emitters.Create(desc);
+    }
+
     {
         const UINT64 totalBytes = static_cast<UINT64>(m_maxParticles) * sizeof(ParticleCPU);
         CD3DX12_HEAP_PROPERTIES defHeap(D3D12_HEAP_TYPE_DEFAULT);
         auto bufDesc = CD3DX12_RESOURCE_DESC::Buffer(totalBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
-        ThrowIfFailed(dev->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &defHeap, D3D12_HEAP_FLAG_NONE, &bufDesc,
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_bufA)));
 
-        ThrowIfFailed(dev->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &defHeap, D3D12_HEAP_FLAG_NONE, &bufDesc,
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_bufB)));
 
@@ -47,11 +57,11 @@ void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
         CD3DX12_HEAP_PROPERTIES defHeap(D3D12_HEAP_TYPE_DEFAULT);
         auto cntDesc = CD3DX12_RESOURCE_DESC::Buffer(4, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
-        ThrowIfFailed(dev->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &defHeap, D3D12_HEAP_FLAG_NONE, &cntDesc,
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_cntA)));
 
-        ThrowIfFailed(dev->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &defHeap, D3D12_HEAP_FLAG_NONE, &cntDesc,
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_cntB)));
 
@@ -60,14 +70,21 @@ void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
     }
 
     {
-        CD3DX12_HEAP_PROPERTIES rbHeap(D3D12_HEAP_TYPE_READBACK);
+        CD3DX12_HEAP_PROPERTIES defHeap(D3D12_HEAP_TYPE_DEFAULT);
         auto rbDesc = CD3DX12_RESOURCE_DESC::Buffer(4);
-        ThrowIfFailed(dev->CreateCommittedResource(
-            &rbHeap, D3D12_HEAP_FLAG_NONE, &rbDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readbackCount)));
+        ThrowIfFailed(m_framework->CreateResource(
+            &defHeap, D3D12_HEAP_FLAG_NONE, &rbDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_aliveCountGpu)));
+        m_stateAliveCount = D3D12_RESOURCE_STATE_COPY_DEST;
+
+        auto argsDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(ParticleIndirectArgs), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        ThrowIfFailed(m_framework->CreateResource(
+            &defHeap, D3D12_HEAP_FLAG_NONE, &argsDesc,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_indirectArgs)));
+        m_stateIndirectArgs = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
 
         CD3DX12_HEAP_PROPERTIES upHeap(D3D12_HEAP_TYPE_UPLOAD);
-        ThrowIfFailed(dev->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &upHeap, D3D12_HEAP_FLAG_NONE, &rbDesc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_uploadZero)));
 
@@ -77,10 +94,32 @@ void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
         CD3DX12_RANGE wr(0, 0); m_uploadZero->Unmap(0, &wr);
     }
 
+    {
+        CD3DX12_HEAP_PROPERTIES defHeap(D3D12_HEAP_TYPE_DEFAULT);
+        auto sortDesc = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(m_maxParticles) * sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        for (int i = 0; i < 2; ++i)
+        {
+            ThrowIfFailed(m_framework->CreateResource(
+                &defHeap, D3D12_HEAP_FLAG_NONE, &sortDesc,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_sortKeys[i])));
+            ThrowIfFailed(m_framework->CreateResource(
+                &defHeap, D3D12_HEAP_FLAG_NONE, &sortDesc,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_sortValues[i])));
+        }
+        m_stateSortOrder = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+        // 256 разрядов на каждую группу CS_SortHistogram
+        const UINT64 groups = (std::min)((m_maxParticles + ParticleUpdateGroupSize - 1) / ParticleUpdateGroupSize, ParticleMaxGroupCount);
+        auto histDesc = CD3DX12_RESOURCE_DESC::Buffer(groups * 256 * sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        ThrowIfFailed(m_framework->CreateResource(
+            &defHeap, D3D12_HEAP_FLAG_NONE, &histDesc,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_sortHistogram)));
+    }
+
     {
         CD3DX12_HEAP_PROPERTIES upHeap(D3D12_HEAP_TYPE_UPLOAD);
-        auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(Align256(64));
-        ThrowIfFailed(dev->CreateCommittedResource(
+        auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(UpdateCBStride * (MaxEmitters + 1));
+        ThrowIfFailed(m_framework->CreateResource(
             &upHeap, D3D12_HEAP_FLAG_NONE, &cbDesc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_updateCB)));
 
@@ -89,19 +128,21 @@ void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
     }
 
     {
-        struct ObjCB { XMFLOAT4X4 World; XMFLOAT4X4 ViewProj; } obj{};
-        XMStoreFloat4x4(&obj.World, XMMatrixIdentity());
-        XMStoreFloat4x4(&obj.ViewProj, XMMatrixIdentity());
+        // [0] - ObjectCB (b0), [PassCBOffset] - PassCB (b5)
+        XMFLOAT4X4 identity;
+        XMStoreFloat4x4(&identity, XMMatrixIdentity());
 
         CD3DX12_HEAP_PROPERTIES upHeap(D3D12_HEAP_TYPE_UPLOAD);
-        auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(Align256(sizeof(ObjCB)));
-        ThrowIfFailed(dev->CreateCommittedResource(
+        auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(PassCBOffset * 2);
+        ThrowIfFailed(m_framework->CreateResource(
             &upHeap, D3D12_HEAP_FLAG_NONE, &cbDesc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_objectCB)));
 
         uint8_t* p = nullptr; CD3DX12_RANGE rr(0, 0);
         ThrowIfFailed(m_objectCB->Map(0, &rr, reinterpret_cast<void**>(&p)));
-        memcpy(p, &obj, sizeof(obj));
+        memset(p, 0, PassCBOffset * 2);
+        memcpy(p, &identity, sizeof(identity));
+        memcpy(p + PassCBOffset, &identity, sizeof(identity));
         m_objectCBAddr = m_objectCB->GetGPUVirtualAddress();
     }
 
@@ -111,15 +152,14 @@ void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
         const UINT ibSize = static_cast<UINT>(plane.indices.size() * sizeof(uint32_t));
         if (vbSize == 0 || ibSize == 0) throw std::runtime_error("Particle mesh empty");
 
-        ComPtr<ID3D12Resource> vbUpload, ibUpload;
         auto* cl = m_framework->GetCommandList();
         auto* al = m_framework->GetCommandAllocator();
 
         ThrowIfFailed(al->Reset());
         ThrowIfFailed(cl->Reset(al, nullptr));
 
-        m_framework->CreateDefaultBuffer(cl, plane.vertices.data(), vbSize, m_vb, vbUpload);
-        m_framework->CreateDefaultBuffer(cl, plane.indices.data(), ibSize, m_ib, ibUpload);
+        m_framework->CreateDefaultBuffer(cl, plane.vertices.data(), vbSize, m_vb);
+        m_framework->CreateDefaultBuffer(cl, plane.indices.data(), ibSize, m_ib);
 
         m_vbv.BufferLocation = m_vb->GetGPUVirtualAddress();
         m_vbv.SizeInBytes = vbSize;
@@ -138,14 +178,18 @@ void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
     }
 
     {
-        D3D12_DESCRIPTOR_HEAP_DESC hd = {};
-        hd.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-        hd.NumDescriptors = 3;
-        hd.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-        ThrowIfFailed(dev->CreateDescriptorHeap(&hd, IID_PPV_ARGS(&m_computeHeap)));
-
-        m_dhInc = dev->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        m_gpuBase = m_computeHeap->GetGPUDescriptorHandleForHeapStart();
+        D3D12_INDIRECT_ARGUMENT_DESC arg = {};
+        D3D12_COMMAND_SIGNATURE_DESC sd = {};
+        sd.NumArgumentDescs = 1;
+        sd.pArgumentDescs = &arg;
+
+        arg.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+        sd.ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+        ThrowIfFailed(dev->CreateCommandSignature(&sd, nullptr, IID_PPV_ARGS(&m_dispatchSignature)));
+
+        arg.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+        sd.ByteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+        ThrowIfFailed(dev->CreateCommandSignature(&sd, nullptr, IID_PPV_ARGS(&m_drawSignature)));
     }
 
     {
@@ -158,34 +202,21 @@ void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
 
         WriteUavDescriptors(m_bufA.Get(), m_cntA.Get(), m_bufB.Get(), m_cntB.Get());
 
-        UpdateCB cb{};
-        cb.dt = 0.0f;
-        cb.accel[0] = 0.0f;
-        cb.accel[1] = 0.0f;
-        cb.accel[2] = 0.0f;
-        cb.spawnCount = m_initialSpawn;
-        cb.emitterPos[0] = 0.0f;
-        cb.emitterPos[1] = 100.0f;
-        cb.emitterPos[2] = 0.0f;
-        cb.initialSpeed = 8.0f;
-        cb.aliveCount = 0u;
-
-        memcpy(m_updatePtr, &cb, sizeof(cb));
-
-        ID3D12DescriptorHeap* heaps[] = { m_computeHeap.Get() };
-        cmd->SetDescriptorHeaps(1, heaps);
+        SetComputeHeaps(cmd);
         cmd->SetComputeRootSignature(m_pipeline->GetParticlesComputeRS());
-        cmd->SetPipelineState(m_pipeline->GetParticlesEmitCSO());
-        cmd->SetComputeRootDescriptorTable(0, m_gpuBase);
-        cmd->SetComputeRootConstantBufferView(1, m_updateCB->GetGPUVirtualAddress());
+        cmd->SetComputeRootDescriptorTable(0, m_uavTable);
 
-        const UINT groups = (m_initialSpawn + 255u) / 256u;
-        if (groups) cmd->Dispatch(groups, 1, 1);
+        // камеры ещё нет, выпускается только burst
+        m_emitters.Update(0.0f, m_accel, ParticleBudgetView{}, m_spawns);
+        EmitSpawns(cmd);
 
         CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
         cmd->ResourceBarrier(1, &barrier);
         TransitIfNeeded(cmd, m_bufB.Get(), m_stateBufB, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
+        BuildIndirectArgs(cmd, m_cntB.Get(), m_stateCntB);
+        SortParticles(cmd, m_bufB.Get());
+
         ThrowIfFailed(cmd->Close());
         ID3D12CommandList* lists[] = { cmd };
         m_framework->GetCommandQueue()->ExecuteCommandLists(1, lists);
@@ -196,6 +227,111 @@ void ParticleSystem::Initialize(UINT maxParticles, UINT initialSpawn)
     }
 }
 
+void ParticleSystem::BuildIndirectArgs(ID3D12GraphicsCommandList* cmd, ID3D12Resource* counter, D3D12_RESOURCE_STATES& counterState)
+{
+    TransitIfNeeded(cmd, counter, counterState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    TransitIfNeeded(cmd, m_aliveCountGpu.Get(), m_stateAliveCount, D3D12_RESOURCE_STATE_COPY_DEST);
+    cmd->CopyBufferRegion(m_aliveCountGpu.Get(), 0, counter, 0, 4);
+    TransitIfNeeded(cmd, counter, counterState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    TransitIfNeeded(cmd, m_aliveCountGpu.Get(), m_stateAliveCount, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    TransitIfNeeded(cmd, m_indirectArgs.Get(), m_stateIndirectArgs, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    cmd->SetPipelineState(m_pipeline->GetParticlesBuildArgsCSO());
+    cmd->SetComputeRootShaderResourceView(4, m_aliveCountGpu->GetGPUVirtualAddress());
+    cmd->SetComputeRootUnorderedAccessView(5, m_indirectArgs->GetGPUVirtualAddress());
+    cmd->SetComputeRoot32BitConstant(6, m_indexCount, 0);
+    cmd->Dispatch(1, 1, 1);
+
+    TransitIfNeeded(cmd, m_indirectArgs.Get(), m_stateIndirectArgs, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+}
+
+ParticleEmitterId ParticleSystem::AddEmitter(const ParticleEmitterDesc& desc)
+{
+    if (m_emitters.GetEmitterCount() >= MaxEmitters)
+        return InvalidParticleEmitter;
+    return m_emitters.Create(desc);
+}
+
+void ParticleSystem::EmitSpawns(ID3D12GraphicsCommandList* cmd)
+{
+    if (m_spawns.empty())
+        return;
+    // пул даёт не больше одного запуска на эмиттер, а эмиттеров не больше MaxEmitters
+    if (m_spawns.size() > MaxEmitters)
+        throw std::runtime_error("ParticleSystem: more emitter spawns than update CB slots");
+
+    cmd->SetPipelineState(m_pipeline->GetParticlesEmitCSO());
+
+    const D3D12_GPU_VIRTUAL_ADDRESS base = m_updateCB->GetGPUVirtualAddress();
+    UINT slot = 1;
+    for (const ParticleEmitterSpawn& s : m_spawns)
+    {
+        ParticleUpdateCB cb{};
+        cb.spawnCount = s.count;
+        cb.emitterPos[0] = s.position.x;
+        cb.emitterPos[1] = s.position.y;
+        cb.emitterPos[2] = s.position.z;
+        cb.initialSpeed = s.initialSpeed;
+        cb.lifetime = s.lifetime;
+        cb.emitSeed = s.seed;
+        memcpy(m_updatePtr + slot * UpdateCBStride, &cb, sizeof(cb));
+
+        cmd->SetComputeRootConstantBufferView(1, base + slot * UpdateCBStride);
+        cmd->Dispatch((s.count + ParticleUpdateGroupSize - 1) / ParticleUpdateGroupSize, 1, 1);
+        ++slot;
+    }
+}
+
+void ParticleSystem::SortParticles(ID3D12GraphicsCommandList* cmd, ID3D12Resource* particles)
+{
+    TransitIfNeeded(cmd, m_sortValues[0].Get(), m_stateSortOrder, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    float plane[4];
+    ParticleDepthPlane(&m_viewProj._11, plane);
+
+    cmd->SetComputeRootSignature(m_pipeline->GetParticleSortRS());
+    cmd->SetComputeRoot32BitConstants(0, 4, plane, 0);
+    cmd->SetComputeRootShaderResourceView(1, particles->GetGPUVirtualAddress());
+    cmd->SetComputeRootShaderResourceView(2, m_aliveCountGpu->GetGPUVirtualAddress());
+    cmd->SetComputeRootUnorderedAccessView(7, m_sortHistogram->GetGPUVirtualAddress());
+
+    // группы те же, что у CS_Update: по 256 частиц, число - из m_indirectArgs
+    CD3DX12_RESOURCE_BARRIER uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+
+    cmd->SetComputeRootUnorderedAccessView(5, m_sortKeys[0]->GetGPUVirtualAddress());
+    cmd->SetComputeRootUnorderedAccessView(6, m_sortValues[0]->GetGPUVirtualAddress());
+    cmd->SetPipelineState(m_pipeline->GetParticleSortKeysCSO());
+    cmd->ExecuteIndirect(m_dispatchSignature.Get(), 1, m_indirectArgs.Get(), ParticleDispatchArgsOffset, nullptr, 0);
+    cmd->ResourceBarrier(1, &uavBarrier);
+
+    // 4 прохода по 8 бит, чётное число - результат снова в [0]
+    for (UINT pass = 0; pass < 4; ++pass)
+    {
+        const UINT src = pass & 1;
+        const UINT dst = src ^ 1;
+
+        cmd->SetComputeRoot32BitConstant(0, pass * 8, 4);
+        cmd->SetComputeRootUnorderedAccessView(3, m_sortKeys[src]->GetGPUVirtualAddress());
+        cmd->SetComputeRootUnorderedAccessView(4, m_sortValues[src]->GetGPUVirtualAddress());
+        cmd->SetComputeRootUnorderedAccessView(5, m_sortKeys[dst]->GetGPUVirtualAddress());
+        cmd->SetComputeRootUnorderedAccessView(6, m_sortValues[dst]->GetGPUVirtualAddress());
+
+        cmd->SetPipelineState(m_pipeline->GetParticleSortHistogramCSO());
+        cmd->ExecuteIndirect(m_dispatchSignature.Get(), 1, m_indirectArgs.Get(), ParticleDispatchArgsOffset, nullptr, 0);
+        cmd->ResourceBarrier(1, &uavBarrier);
+
+        cmd->SetPipelineState(m_pipeline->GetParticleSortScanCSO());
+        cmd->Dispatch(1, 1, 1);
+        cmd->ResourceBarrier(1, &uavBarrier);
+
+        cmd->SetPipelineState(m_pipeline->GetParticleSortScatterCSO());
+        cmd->ExecuteIndirect(m_dispatchSignature.Get(), 1, m_indirectArgs.Get(), ParticleDispatchArgsOffset, nullptr, 0);
+        cmd->ResourceBarrier(1, &uavBarrier);
+    }
+
+    TransitIfNeeded(cmd, m_sortValues[0].Get(), m_stateSortOrder, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
+
 void ParticleSystem::ResetUavCounter(ID3D12GraphicsCommandList* cmd, ID3D12Resource* counter, D3D12_RESOURCE_STATES& stateVar)
 {
     TransitIfNeeded(cmd, counter, stateVar, D3D12_RESOURCE_STATE_COPY_DEST);
@@ -215,12 +351,24 @@ void ParticleSystem::WriteUavDescriptors(
     uav.Buffer.NumElements = m_maxParticles;
     uav.Buffer.CounterOffsetInBytes = 0;
 
-    auto dev = m_framework->GetDevice();
-    auto hCPU0 = m_computeHeap->GetCPUDescriptorHandleForHeapStart();
-    auto hCPU1 = CD3DX12_CPU_DESCRIPTOR_HANDLE(hCPU0, 1, m_dhInc);
+    // буферы меняются местами каждый кадр, а прошлый кадр ещё может читать свою таблицу
+    const UINT first = m_framework->AllocateTransientDescriptors(2);
+    const UINT inc = m_framework->GetSrvDescriptorSize();
+    auto* heap = m_framework->GetSrvHeap();
+    auto hCPU0 = CD3DX12_CPU_DESCRIPTOR_HANDLE(heap->GetCPUDescriptorHandleForHeapStart(), first, inc);
+    auto hCPU1 = CD3DX12_CPU_DESCRIPTOR_HANDLE(hCPU0, 1, inc);
 
+    auto dev = m_framework->GetDevice();
     dev->CreateUnorderedAccessView(inBuf, inCounter, &uav, hCPU0);
     dev->CreateUnorderedAccessView(outBuf, outCounter, &uav, hCPU1);
+
+    m_uavTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(heap->GetGPUDescriptorHandleForHeapStart(), first, inc);
+}
+
+void ParticleSystem::SetComputeHeaps(ID3D12GraphicsCommandList* cmd)
+{
+    ID3D12DescriptorHeap* heaps[] = { m_framework->GetSrvHeap(), m_framework->GetSamplerHeap() };
+    cmd->SetDescriptorHeaps(_countof(heaps), heaps);
 }
 
 void ParticleSystem::Simulate(ID3D12GraphicsCommandList* cmd, float dt)
@@ -232,35 +380,12 @@ void ParticleSystem::Simulate(ID3D12GraphicsCommandList* cmd, float dt)
 
     auto& stateSrc = (m_usingAasRead ? m_stateBufA : m_stateBufB);
     auto& stateDst = (m_usingAasRead ? m_stateBufB : m_stateBufA);
-    auto& stateCntSrc = (m_usingAasRead ? m_stateCntA : m_stateCntB);
     auto& stateCntDst = (m_usingAasRead ? m_stateCntB : m_stateCntA);
 
     TransitIfNeeded(cmd, srcBuf, stateSrc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     TransitIfNeeded(cmd, dstBuf, stateDst, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     ResetUavCounter(cmd, dstCnt, stateCntDst);
 
-    TransitIfNeeded(cmd, srcCnt, stateCntSrc, D3D12_RESOURCE_STATE_COPY_SOURCE);
-    cmd->CopyBufferRegion(m_readbackCount.Get(), 0, srcCnt, 0, 4);
-    TransitIfNeeded(cmd, srcCnt, stateCntSrc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-
-    ThrowIfFailed(cmd->Close());
-    {
-        ID3D12CommandList* lists[] = { cmd };
-        m_framework->GetCommandQueue()->ExecuteCommandLists(1, lists);
-        m_framework->WaitForGpu();
-    }
-
-    {
-        uint32_t* p = nullptr; CD3DX12_RANGE rr(0, 4);
-        ThrowIfFailed(m_readbackCount->Map(0, &rr, reinterpret_cast<void**>(&p)));
-        m_aliveCount = *p;
-        CD3DX12_RANGE wr(0, 0); m_readbackCount->Unmap(0, &wr);
-    }
-
-    auto* alloc = m_framework->GetCommandAllocator();
-    ThrowIfFailed(alloc->Reset());
-    ThrowIfFailed(cmd->Reset(alloc, nullptr));
-
     {
         SceneCB scb = m_sceneCBHost;
         scb.ViewProj = m_viewProj;
@@ -275,47 +400,51 @@ void ParticleSystem::Simulate(ID3D12GraphicsCommandList* cmd, float dt)
         CD3DX12_RANGE wr(0, 0); m_sceneCB->Unmap(0, &wr);
     }
 
-    UpdateCB cb{};
+    m_emitters.Update(dt, m_accel, m_budgetView, m_spawns);
+
+    ParticleUpdateCB cb{};
     cb.dt = dt;
-    cb.accel[0] = 0.0f; cb.accel[1] = -10.0f; cb.accel[2] = 0.0f;
+    cb.accel[0] = m_accel.x; cb.accel[1] = m_accel.y; cb.accel[2] = m_accel.z;
     cb.spawnCount = 0;
     cb.emitterPos[0] = 0.0f; cb.emitterPos[1] = 0.0f; cb.emitterPos[2] = 0.0f;
     cb.initialSpeed = 1.0f;
-    cb.aliveCount = m_aliveCount;
+    cb.aliveCount = m_maxParticles;
     memcpy(m_updatePtr, &cb, sizeof(cb));
 
     WriteUavDescriptors(srcBuf, srcCnt, dstBuf, dstCnt);
 
     {
-        auto gpu0 = m_computeHeap->GetGPUDescriptorHandleForHeapStart();
-        auto depthGpu = CD3DX12_GPU_DESCRIPTOR_HANDLE(gpu0, 2, m_dhInc);
-
-        ID3D12DescriptorHeap* heaps[] = { m_computeHeap.Get() };
-        cmd->SetDescriptorHeaps(1, heaps);
+        SetComputeHeaps(cmd);
         cmd->SetComputeRootSignature(m_pipeline->GetParticlesComputeRS());
         cmd->SetPipelineState(m_pipeline->GetParticlesUpdateCSO());
 
-        cmd->SetComputeRootDescriptorTable(0, m_gpuBase);
+        cmd->SetComputeRootDescriptorTable(0, m_uavTable);
         cmd->SetComputeRootConstantBufferView(1, m_updateCB->GetGPUVirtualAddress());
-        cmd->SetComputeRootDescriptorTable(2, depthGpu);
+        cmd->SetComputeRootDescriptorTable(2, m_depthSrv);
         cmd->SetComputeRootConstantBufferView(3, m_sceneCB->GetGPUVirtualAddress());
+        cmd->SetComputeRootShaderResourceView(4, m_aliveCountGpu->GetGPUVirtualAddress());
 
-        const UINT threads = 256;
-        const UINT groups = (m_aliveCount + threads - 1) / threads;
-        if (groups) cmd->Dispatch(groups, 1, 1);
+        // m_aliveCountGpu и аргументы остались от прошлого BuildIndirectArgs, т.е. по счётчику srcCnt
+        cmd->ExecuteIndirect(m_dispatchSignature.Get(), 1, m_indirectArgs.Get(), ParticleDispatchArgsOffset, nullptr, 0);
+
+        // новые частицы дописываются в тот же выходной буфер после выживших
+        EmitSpawns(cmd);
     }
 
     CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
     cmd->ResourceBarrier(1, &barrier);
     TransitIfNeeded(cmd, dstBuf, stateDst, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
+    BuildIndirectArgs(cmd, dstCnt, stateCntDst);
+    SortParticles(cmd, dstBuf);
+
     m_usingAasRead = !m_usingAasRead;
 }
 
 
 void ParticleSystem::DrawGBuffer(ID3D12GraphicsCommandList* cmd)
 {
-    if (m_indexCount == 0 || m_aliveCount == 0) return;
+    if (m_indexCount == 0 || !m_emitters.AnyVisible()) return;
 
     cmd->SetGraphicsRootSignature(m_pipeline->GetRootSignature());
     cmd->SetPipelineState(m_pipeline->GetGBufferParticlesPSO());
@@ -325,11 +454,13 @@ void ParticleSystem::DrawGBuffer(ID3D12GraphicsCommandList* cmd)
     cmd->IASetIndexBuffer(&m_ibv);
 
     cmd->SetGraphicsRootConstantBufferView(0, m_objectCBAddr);
+    cmd->SetGraphicsRootConstantBufferView(7, m_objectCBAddr + PassCBOffset);
 
     ID3D12Resource* readBuf = m_usingAasRead ? m_bufA.Get() : m_bufB.Get();
     cmd->SetGraphicsRootShaderResourceView(6, readBuf->GetGPUVirtualAddress());
+    cmd->SetGraphicsRootShaderResourceView(8, m_sortValues[0]->GetGPUVirtualAddress());
 
-    cmd->DrawIndexedInstanced(m_indexCount, m_aliveCount, 0, 0, 0);
+    cmd->ExecuteIndirect(m_drawSignature.Get(), 1, m_indirectArgs.Get(), ParticleDrawArgsOffset, nullptr, 0);
 }
 
 void ParticleSystem::EnableDepthCollisions(ID3D12Resource* depth, UINT w, UINT h)
@@ -342,13 +473,17 @@ void ParticleSystem::EnableDepthCollisions(ID3D12Resource* depth, UINT w, UINT h
     ds.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
     ds.Texture2D.MipLevels = 1;
 
-    auto cpu0 = m_computeHeap->GetCPUDescriptorHandleForHeapStart();
-    auto cpuDepth = CD3DX12_CPU_DESCRIPTOR_HANDLE(cpu0, 2, m_dhInc);
-    m_framework->GetDevice()->CreateShaderResourceView(m_depth.Get(), &ds, cpuDepth);
+    if (m_depthSrvIndex == DescriptorAllocator::Invalid)
+        m_depthSrvIndex = m_framework->AllocateSrvDescriptor();
+    const UINT inc = m_framework->GetSrvDescriptorSize();
+    auto* heap = m_framework->GetSrvHeap();
+    m_framework->GetDevice()->CreateShaderResourceView(m_depth.Get(), &ds,
+        CD3DX12_CPU_DESCRIPTOR_HANDLE(heap->GetCPUDescriptorHandleForHeapStart(), m_depthSrvIndex, inc));
+    m_depthSrv = CD3DX12_GPU_DESCRIPTOR_HANDLE(heap->GetGPUDescriptorHandleForHeapStart(), m_depthSrvIndex, inc);
 
     CD3DX12_HEAP_PROPERTIES up(D3D12_HEAP_TYPE_UPLOAD);
     auto cbDesc = CD3DX12_RESOURCE_DESC::Buffer(Align256(sizeof(SceneCB)));
-    ThrowIfFailed(m_framework->GetDevice()->CreateCommittedResource(
+    ThrowIfFailed(m_framework->CreateResource(
         &up, D3D12_HEAP_FLAG_NONE, &cbDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_sceneCB)));
 }
@@ -357,4 +492,10 @@ void ParticleSystem::SetCameraMatrices(const XMMATRIX& vp, const XMMATRIX& ivp)
 {
     XMStoreFloat4x4(&m_viewProj, vp);
     XMStoreFloat4x4(&m_invViewProj, ivp);
+
+    m_budgetView.valid = true;
+    ExtractFrustumPlanes(m_budgetView.planes, vp);
+    ParticleDepthPlane(&m_viewProj._11, m_budgetView.depthPlane);
+    // длина второго столбца ViewProj - масштаб проекции по y, поворот камеры его не меняет
+    m_budgetView.projScale = sqrtf(m_viewProj._12 * m_viewProj._12 + m_viewProj._22 * m_viewProj._22 + m_viewProj._32 * m_viewProj._32);
 }
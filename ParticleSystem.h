@@ -5,27 +5,25 @@
 #include "d3dx12.h"
 #include "DX12Framework.h"
 #include "Pipeline.h"
+#include "ParticleIndirectArgs.h"
+#include "ParticleTypes.h"
+#include "ParticleEmitters.h"
 #include <DirectXMath.h>
 
 using namespace DirectX;
 
 using Microsoft::WRL::ComPtr;
 
-struct ParticleCPU 
-{
-    float pos[3];
-    float vel[3];
-    float age;
-    float lifetime;
-    float size;
-};
-
 class ParticleSystem 
 {
 public:
     ParticleSystem(DX12Framework* fw, Pipeline* pipe);
     ~ParticleSystem() = default;
 
+    // один CS_Emit на эмиттер за кадр, CB для них лежат в m_updateCB
+    static const UINT MaxEmitters = 64;
+
+    // maxParticles - общий пул; initialSpawn - разовый выброс эмиттера по умолчанию в (0, 100, 0)
     void Initialize(UINT maxParticles, UINT initialSpawn);
     void Simulate(ID3D12GraphicsCommandList* cmd, float dt);
     void DrawGBuffer(ID3D12GraphicsCommandList* cmd);
@@ -35,13 +33,16 @@ public:
         if (!m_objectCB) return;
         uint8_t* p = nullptr; CD3DX12_RANGE r(0, 0);
         if (SUCCEEDED(m_objectCB->Map(0, &r, reinterpret_cast<void**>(&p)))) {
-            struct ObjCB { XMFLOAT4X4 World; XMFLOAT4X4 ViewProj; };
-            ObjCB* cb = reinterpret_cast<ObjCB*>(p);
-            XMStoreFloat4x4(&cb->ViewProj, viewProj);
+            XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(p + PassCBOffset), viewProj);
             CD3DX12_RANGE wr(0, 0); m_objectCB->Unmap(0, &wr);
         }
     }
 
+    // InvalidParticleEmitter - диапазон не влез в пул или эмиттеров уже MaxEmitters
+    ParticleEmitterId AddEmitter(const ParticleEmitterDesc& desc);
+    void RemoveEmitter(ParticleEmitterId id) { m_emitters.Destroy(id); }
+    ParticleEmitterPool& GetEmitters() { return m_emitters; }
+
     void EnableDepthCollisions(ID3D12Resource* depth, UINT width, UINT height);
     void SetCameraMatrices(const XMMATRIX& viewProj, const XMMATRIX& invViewProj);
 
@@ -60,8 +61,16 @@ private:
     }
 
     void ResetUavCounter(ID3D12GraphicsCommandList* cmd, ID3D12Resource* counter, D3D12_RESOURCE_STATES& stateVar);
+    // копирует счётчик в m_aliveCountGpu и пишет по нему m_indirectArgs; корневая сигнатура частиц уже выставлена
+    void BuildIndirectArgs(ID3D12GraphicsCommandList* cmd, ID3D12Resource* counter, D3D12_RESOURCE_STATES& counterState);
+    // CS_Emit по m_spawns в выходной буфер; корневая сигнатура и таблица UAV уже выставлены
+    void EmitSpawns(ID3D12GraphicsCommandList* cmd);
+    // ParticleSort.hlsl по частицам particles; результат - m_sortValues[0], его читает DrawGBuffer
+    void SortParticles(ID3D12GraphicsCommandList* cmd, ID3D12Resource* particles);
+    // UAV пары буферов пишутся во временные дескрипторы кадра, таблица - m_uavTable
     void WriteUavDescriptors(ID3D12Resource* inBuf, ID3D12Resource* inCounter,
         ID3D12Resource* outBuf, ID3D12Resource* outCounter);
+    void SetComputeHeaps(ID3D12GraphicsCommandList* cmd);
 
 private:
     DX12Framework* m_framework = nullptr;
@@ -76,7 +85,6 @@ private:
     };
 
     UINT m_maxParticles = 0;
-    UINT m_aliveCount = 0;
     UINT m_initialSpawn = 0;
 
     ComPtr<ID3D12Resource> m_bufA;
@@ -91,18 +99,40 @@ private:
     D3D12_RESOURCE_STATES m_stateCntA = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
     D3D12_RESOURCE_STATES m_stateCntB = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
 
-    ComPtr<ID3D12Resource> m_readbackCount;
+    // счётчик последнего выходного буфера: его читают CS_Update и CS_BuildArgs, CPU он не нужен
+    ComPtr<ID3D12Resource> m_aliveCountGpu;
+    D3D12_RESOURCE_STATES m_stateAliveCount = D3D12_RESOURCE_STATE_COPY_DEST;
+
+    // ParticleIndirectArgs: Dispatch для CS_Update и DrawIndexed для DrawGBuffer
+    ComPtr<ID3D12Resource> m_indirectArgs;
+    D3D12_RESOURCE_STATES m_stateIndirectArgs = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    ComPtr<ID3D12CommandSignature> m_dispatchSignature;
+    ComPtr<ID3D12CommandSignature> m_drawSignature;
     ComPtr<ID3D12Resource> m_uploadZero;   
 
+    // ключи и индексы частиц, проходы сортировки чередуют [0] и [1]
+    ComPtr<ID3D12Resource> m_sortKeys[2];
+    ComPtr<ID3D12Resource> m_sortValues[2];
+    ComPtr<ID3D12Resource> m_sortHistogram;
+    D3D12_RESOURCE_STATES m_stateSortOrder = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+    // [0] - CS_Update, [1..MaxEmitters] - запуски CS_Emit
+    static const UINT UpdateCBStride = 256;
     ComPtr<ID3D12Resource> m_updateCB;
     uint8_t* m_updatePtr = nullptr;
 
+    ParticleEmitterPool m_emitters;
+    std::vector<ParticleEmitterSpawn> m_spawns;
+    ParticleBudgetView m_budgetView;
+    XMFLOAT3 m_accel{ 0.0f, -10.0f, 0.0f };
+
+    static const UINT PassCBOffset = 256;
     ComPtr<ID3D12Resource> m_objectCB;
     D3D12_GPU_VIRTUAL_ADDRESS m_objectCBAddr = 0;
 
-    ComPtr<ID3D12DescriptorHeap> m_computeHeap;
-    D3D12_GPU_DESCRIPTOR_HANDLE  m_gpuBase{};
-    UINT                         m_dhInc = 0;
+    D3D12_GPU_DESCRIPTOR_HANDLE  m_uavTable{};
+    D3D12_GPU_DESCRIPTOR_HANDLE  m_depthSrv{};
+    UINT                         m_depthSrvIndex = DescriptorAllocator::Invalid;
 
     ComPtr<ID3D12Resource> m_vb;
     ComPtr<ID3D12Resource> m_ib;
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+
+// Частица в структурированных буферах (ParticlesCS.hlsl, struct Particle)
+struct ParticleCPU
+{
+    float pos[3];
+    float vel[3];
+    float age;
+    float lifetime;
+    float size;
+};
+
+// cbuffer ParticleUpdateCB : register(b5)
+struct ParticleUpdateCB
+{
+    float dt; float accel[3];
+    uint32_t spawnCount;
+    float emitterPos[3];
+    float initialSpeed;
+    uint32_t aliveCount;
+    // только для CS_Emit
+    float lifetime;
+    uint32_t emitSeed;
+};
@@ -103,6 +103,8 @@ cbuffer ParticleUpdateCB : register(b5)
     float3 emitterPos;
     float initialSpeed;
     uint aliveCount;
+    float emitLifetime;
+    uint emitSeed;
 };
 
 struct Particle
@@ -117,6 +119,15 @@ struct Particle
 ConsumeStructuredBuffer<Particle> gIn : register(u0);
 AppendStructuredBuffer<Particle> gOut : register(u1);
 
+// копия счётчика gIn, её же читает CS_BuildArgs; aliveCount из CB - ёмкость буфера
+ByteAddressBuffer gAliveCount : register(t3);
+RWByteAddressBuffer gArgs : register(u2);
+
+cbuffer ParticleArgsCB : register(b7)
+{
+    uint IndexCountPerInstance;
+};
+
 uint WangHash(uint s)
 {
     s = (s ^ 61u) ^ (s >> 16);
@@ -138,7 +149,7 @@ void CS_Emit(uint3 id : SV_DispatchThreadID)
     uint i = id.x;
     if (i >= spawnCount)
         return;
-    uint seed = 1337u + i * 747796405u;
+    uint seed = 1337u + i * 747796405u + emitSeed;
     Particle p;
     p.pos = emitterPos;
     float3 dir = normalize(float3(
@@ -147,7 +158,7 @@ void CS_Emit(uint3 id : SV_DispatchThreadID)
         rand01(seed + 2) * 2 - 1));
     p.vel = dir * initialSpeed;
     p.age = 0.0;
-    p.lifetime = 50.0;
+    p.lifetime = emitLifetime;
     p.size = 1.0f;
     gOut.Append(p);
 }
@@ -155,7 +166,7 @@ void CS_Emit(uint3 id : SV_DispatchThreadID)
 [numthreads(256, 1, 1)]
 void CS_Update(uint3 id : SV_DispatchThreadID)
 {
-    if (id.x >= aliveCount)
+    if (id.x >= min(aliveCount, gAliveCount.Load(0)))
         return;
     Particle p = gIn.Consume();
     float3 oldPos = p.pos;
@@ -185,4 +196,16 @@ void CS_Update(uint3 id : SV_DispatchThreadID)
     p.age += dt;
     if (p.age < p.lifetime)
         gOut.Append(p);
+}
+
+// раскладка - ParticleIndirectArgs (ParticleIndirectArgs.h)
+[numthreads(1, 1, 1)]
+void CS_BuildArgs(uint3 id : SV_DispatchThreadID)
+{
+    uint count = gAliveCount.Load(0);
+    uint groups = min(count / 256 + (count % 256 != 0 ? 1 : 0), 65535);
+
+    gArgs.Store3(0, uint3(groups, 1, 1));
+    gArgs.Store4(12, uint4(IndexCountPerInstance, count, 0, 0));
+    gArgs.Store(28, 0);
 }
\ No newline at end of file
@@ -5,11 +5,22 @@
 #include <stdexcept>
 #include <windows.h>
 #include "Vertexes.h"
+#include "PostPermutation.h"
 #pragma comment(lib, "d3dcompiler.lib")
 #include <dxcapi.h>
+#include <algorithm>
+#include <string>
+#include "TaskPool.h"
+#include "Timer.h"
 
 namespace
 {
+    LPCWSTR kDxcArgs[] =
+    {
+        L"-HV",
+        L"2021",
+    };
+
     template<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type, typename T>
     struct alignas(void*) PSOSubobject
     {
@@ -51,66 +62,75 @@ void Pipeline::Init()
 #endif
 
     ComPtr<IDxcBlob> vsBlob, psBlob, vsG, psG, vsQuad, psLight, psAmbientBlob;
-    Compile(L"Shaders.hlsl", L"VSMain", L"vs_6_5", vsBlob);
-    Compile(L"Shaders.hlsl", L"PSMain", L"ps_6_5", psBlob);
-    Compile(L"Shaders.hlsl", L"VS_GBuffer", L"vs_6_5", vsG);
-    Compile(L"Shaders.hlsl", L"PS_GBuffer", L"ps_6_5", psG);
-    Compile(L"Shaders.hlsl", L"VS_Quad", L"vs_6_5", vsQuad);
-    Compile(L"Shaders.hlsl", L"PS_Lighting", L"ps_6_5", psLight);
-    Compile(L"Shaders.hlsl", L"PS_Ambient", L"ps_6_5", psAmbientBlob);
-
     ComPtr<IDxcBlob> vsTessBlob, hsTessBlob, dsTessBlob;
-    Compile(L"Tessellation.hlsl", L"VSMain", L"vs_6_5", vsTessBlob);
-    Compile(L"Tessellation.hlsl", L"HSMain", L"hs_6_5", hsTessBlob);
-    Compile(L"Tessellation.hlsl", L"DSMain", L"ds_6_5", dsTessBlob);
-
     ComPtr<IDxcBlob> vsShadow;
-    Compile(L"Shaders.hlsl", L"VS_Shadow", L"vs_6_5", vsShadow);
-
     ComPtr<IDxcBlob> vsGPart, psGPart;
-    Compile(L"Shaders.hlsl", L"VS_GBufferParticle", L"vs_6_5", vsGPart);
-    Compile(L"Shaders.hlsl", L"PS_GBufferParticle", L"ps_6_5", psGPart);
-
-    ComPtr<IDxcBlob> csUpdate, csEmit;
-    Compile(L"ParticlesCS.hlsl", L"CS_Update", L"cs_6_5", csUpdate);
-    Compile(L"ParticlesCS.hlsl", L"CS_Emit", L"cs_6_5", csEmit);
-
+    ComPtr<IDxcBlob> csUpdate, csEmit, csBuildArgs;
+    ComPtr<IDxcBlob> csSortKeys, csSortHistogram, csSortScan, csSortScatter;
     ComPtr<IDxcBlob> psSkybox;
-    Compile(L"Shaders.hlsl", L"PS_Skybox", L"ps_6_5", psSkybox);
-
-    ComPtr<IDxcBlob> psCopyHDRtoLDR, psCopyLDR, psTonemap, psGamma, psVignette;
-    ComPtr<IDxcBlob> psInvert, psGrayscale, psPixelate, psPosterize, psSaturation;
-    Compile(L"PostEffects.hlsl", L"PS_CopyHDRtoLDR", L"ps_6_5", psCopyHDRtoLDR);
-    Compile(L"PostEffects.hlsl", L"PS_CopyLDR", L"ps_6_5", psCopyLDR);
-    Compile(L"PostEffects.hlsl", L"PS_Tonemap", L"ps_6_5", psTonemap);
-    Compile(L"PostEffects.hlsl", L"PS_Gamma", L"ps_6_5", psGamma);
-    Compile(L"PostEffects.hlsl", L"PS_Vignette", L"ps_6_5", psVignette);
-    Compile(L"PostEffects.hlsl", L"PS_Invert", L"ps_6_5", psInvert);
-    Compile(L"PostEffects.hlsl", L"PS_Grayscale", L"ps_6_5", psGrayscale);
-    Compile(L"PostEffects.hlsl", L"PS_Pixelate", L"ps_6_5", psPixelate);
-    Compile(L"PostEffects.hlsl", L"PS_Posterize", L"ps_6_5", psPosterize);
-    Compile(L"PostEffects.hlsl", L"PS_Saturation", L"ps_6_5", psSaturation);
-
+    ComPtr<IDxcBlob> psCopyHDRtoLDR, psTonemap;
     ComPtr<IDxcBlob> psPreview;
-    Compile(L"Shaders.hlsl", L"PS_PreviewGBuffer", L"ps_6_5", psPreview);
-
     ComPtr<IDxcBlob> vsTerrain, psTerrain;
-    Compile(L"Terrain.hlsl", L"VS_TerrainGBuffer", L"vs_6_5", vsTerrain);
-    Compile(L"Terrain.hlsl", L"PS_TerrainGBuffer", L"ps_6_5", psTerrain);
-
     ComPtr<IDxcBlob> psTAA, psVelocity;
-    Compile(L"TAA.hlsl", L"PS_TAA", L"ps_6_5", psTAA);
-    Compile(L"Velocity.hlsl", L"PS_Velocity", L"ps_6_5", psVelocity);
-
     ComPtr<IDxcBlob> psMotionBlur;
-    Compile(L"MotionBlur.hlsl", L"PS_MotionBlur", L"ps_6_5", psMotionBlur);
+    ComPtr<IDxcBlob> msGBuffer, msGBufferCull, msGBufferList, asMeshletCull;
+    ComPtr<IDxcBlob> csBuildHiZ;
+
+    // шейдеры, читающие вершины GeometryArena
+    std::vector<DxcDefine> meshDefines;
+    if (m_packedVertices)
+        meshDefines.push_back({ L"PACKED_VERTICES", L"1" });
 
-    ComPtr<IDxcBlob> msGBuffer;
+    std::vector<ShaderJob> jobs =
+    {
+        { L"Shaders.hlsl", L"VSMain", L"vs_6_5", &vsBlob, meshDefines },
+        { L"Shaders.hlsl", L"PSMain", L"ps_6_5", &psBlob },
+        { L"Shaders.hlsl", L"VS_GBuffer", L"vs_6_5", &vsG, meshDefines },
+        { L"Shaders.hlsl", L"PS_GBuffer", L"ps_6_5", &psG },
+        { L"Shaders.hlsl", L"VS_Quad", L"vs_6_5", &vsQuad },
+        { L"Shaders.hlsl", L"PS_Lighting", L"ps_6_5", &psLight },
+        { L"Shaders.hlsl", L"PS_Ambient", L"ps_6_5", &psAmbientBlob },
+        { L"Tessellation.hlsl", L"VSMain", L"vs_6_5", &vsTessBlob, meshDefines },
+        { L"Tessellation.hlsl", L"HSMain", L"hs_6_5", &hsTessBlob },
+        { L"Tessellation.hlsl", L"DSMain", L"ds_6_5", &dsTessBlob },
+        { L"Shaders.hlsl", L"VS_Shadow", L"vs_6_5", &vsShadow },
+        { L"Shaders.hlsl", L"VS_GBufferParticle", L"vs_6_5", &vsGPart },
+        { L"Shaders.hlsl", L"PS_GBufferParticle", L"ps_6_5", &psGPart },
+        { L"ParticlesCS.hlsl", L"CS_Update", L"cs_6_5", &csUpdate },
+        { L"ParticlesCS.hlsl", L"CS_Emit", L"cs_6_5", &csEmit },
+        { L"ParticlesCS.hlsl", L"CS_BuildArgs", L"cs_6_5", &csBuildArgs },
+        { L"ParticleSort.hlsl", L"CS_SortKeys", L"cs_6_5", &csSortKeys },
+        { L"ParticleSort.hlsl", L"CS_SortHistogram", L"cs_6_5", &csSortHistogram },
+        { L"ParticleSort.hlsl", L"CS_SortScan", L"cs_6_5", &csSortScan },
+        { L"ParticleSort.hlsl", L"CS_SortScatter", L"cs_6_5", &csSortScatter },
+        { L"Shaders.hlsl", L"PS_Skybox", L"ps_6_5", &psSkybox },
+        { L"PostEffects.hlsl", L"PS_CopyHDRtoLDR", L"ps_6_5", &psCopyHDRtoLDR },
+        { L"PostEffects.hlsl", L"PS_Tonemap", L"ps_6_5", &psTonemap },
+        { L"Shaders.hlsl", L"PS_PreviewGBuffer", L"ps_6_5", &psPreview },
+        { L"Terrain.hlsl", L"VS_TerrainGBuffer", L"vs_6_5", &vsTerrain },
+        { L"Terrain.hlsl", L"PS_TerrainGBuffer", L"ps_6_5", &psTerrain },
+        { L"TAA.hlsl", L"PS_TAA", L"ps_6_5", &psTAA },
+        { L"Velocity.hlsl", L"PS_Velocity", L"ps_6_5", &psVelocity },
+        { L"MotionBlur.hlsl", L"PS_MotionBlur", L"ps_6_5", &psMotionBlur },
+    };
     if (m_framework->IsMeshShaderSupported())
     {
-        Compile(L"Shaders.hlsl", L"MS_GBuffer", L"ms_6_5", msGBuffer);
+        // варианты MS_GBuffer: все мешлеты подряд, из payload AS_MeshletCull, из списка CPU-отсечения
+        std::vector<DxcDefine> cullDefines = meshDefines;
+        cullDefines.push_back({ L"MESHLET_CULL_AS", L"1" });
+        std::vector<DxcDefine> listDefines = meshDefines;
+        listDefines.push_back({ L"MESHLET_CULL_LIST", L"1" });
+
+        jobs.push_back({ L"Shaders.hlsl", L"MS_GBuffer", L"ms_6_5", &msGBuffer, meshDefines });
+        jobs.push_back({ L"Shaders.hlsl", L"MS_GBuffer", L"ms_6_5", &msGBufferCull, cullDefines });
+        jobs.push_back({ L"Shaders.hlsl", L"MS_GBuffer", L"ms_6_5", &msGBufferList, listDefines });
+        jobs.push_back({ L"Shaders.hlsl", L"AS_MeshletCull", L"as_6_5", &asMeshletCull, meshDefines });
+        jobs.push_back({ L"HiZ.hlsl", L"CS_BuildHiZ", L"cs_6_5", &csBuildHiZ });
     }
 
+    CompileBatch(jobs);
+    m_vsQuad = vsQuad;
+
     D3D12_INPUT_ELEMENT_DESC inputLayout[] =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
@@ -120,13 +140,33 @@ void Pipeline::Init()
         { "HAND",     0, DXGI_FORMAT_R32_FLOAT,       0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     };
 
+    // PackedVertex (VertexPacking.h)
+    D3D12_INPUT_ELEMENT_DESC packedLayout[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0, 8,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TANGENT",  0, DXGI_FORMAT_R16G16_SNORM,       0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    // вершины GeometryArena; частицы и террейн остаются на inputLayout
+    const D3D12_INPUT_LAYOUT_DESC meshLayout = m_packedVertices
+        ? D3D12_INPUT_LAYOUT_DESC{ packedLayout, _countof(packedLayout) }
+        : D3D12_INPUT_LAYOUT_DESC{ inputLayout, _countof(inputLayout) };
+
+    // поток позиций GeometryArena
+    D3D12_INPUT_ELEMENT_DESC positionLayout[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
     // Geometry RS
     {
         CD3DX12_DESCRIPTOR_RANGE samplerRange(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 1, 0);
         CD3DX12_DESCRIPTOR_RANGE srvRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
             m_framework->GetSrvHeap()->GetDesc().NumDescriptors, 0);
 
-        CD3DX12_ROOT_PARAMETER params[7] = {};
+        CD3DX12_ROOT_PARAMETER params[9] = {};
         params[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
         params[1].InitAsConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_ALL);
         params[2].InitAsConstantBufferView(3, 0, D3D12_SHADER_VISIBILITY_ALL);
@@ -134,6 +174,9 @@ void Pipeline::Init()
         params[4].InitAsDescriptorTable(1, &samplerRange, D3D12_SHADER_VISIBILITY_ALL);
         params[5].InitAsConstantBufferView(4, 0, D3D12_SHADER_VISIBILITY_ALL);
         params[6].InitAsShaderResourceView(0, 1, D3D12_SHADER_VISIBILITY_ALL);
+        params[7].InitAsConstantBufferView(5, 0, D3D12_SHADER_VISIBILITY_ALL);
+        // порядок отрисовки частиц после ParticleSort.hlsl
+        params[8].InitAsShaderResourceView(1, 1, D3D12_SHADER_VISIBILITY_VERTEX);
 
         CD3DX12_ROOT_SIGNATURE_DESC desc(_countof(params), params, 0, nullptr,
             D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -149,11 +192,12 @@ void Pipeline::Init()
     {
         CD3DX12_DESCRIPTOR_RANGE srvRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
             m_framework->GetSrvHeap()->GetDesc().NumDescriptors, 0);
-        CD3DX12_DESCRIPTOR_RANGE meshletRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 4, 0, 2);
+        CD3DX12_DESCRIPTOR_RANGE meshletRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 5, 0, 2);
+        CD3DX12_DESCRIPTOR_RANGE hizRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 4);
 
         CD3DX12_DESCRIPTOR_RANGE samplerRange(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 1, 0);
 
-        CD3DX12_ROOT_PARAMETER params[9] = {};
+        CD3DX12_ROOT_PARAMETER params[14] = {};
         params[0].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
         params[1].InitAsConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_ALL);
         params[2].InitAsConstantBufferView(2, 0, D3D12_SHADER_VISIBILITY_ALL);
@@ -163,6 +207,12 @@ void Pipeline::Init()
         params[6].InitAsConstantBufferView(3, 0, D3D12_SHADER_VISIBILITY_ALL);
         params[7].InitAsDescriptorTable(1, &meshletRange, D3D12_SHADER_VISIBILITY_ALL);
         params[8].InitAsShaderResourceView(0, 1, D3D12_SHADER_VISIBILITY_ALL);
+        params[9].InitAsConstantBufferView(5, 0, D3D12_SHADER_VISIBILITY_ALL);
+        // отсечение мешлетов: MeshletCullCB, список видимых с CPU, флаги видимости для сверки, HiZ
+        params[10].InitAsConstantBufferView(7, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[11].InitAsShaderResourceView(0, 3, D3D12_SHADER_VISIBILITY_ALL);
+        params[12].InitAsUnorderedAccessView(0, 2, D3D12_SHADER_VISIBILITY_ALL);
+        params[13].InitAsDescriptorTable(1, &hizRange, D3D12_SHADER_VISIBILITY_ALL);
 
         CD3DX12_ROOT_SIGNATURE_DESC desc(_countof(params), params, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
@@ -172,6 +222,25 @@ void Pipeline::Init()
             sig->GetBufferSize(), IID_PPV_ARGS(&m_meshletRootSignature)));
     }
 
+    // HiZ RS
+    if (m_framework->IsMeshShaderSupported())
+    {
+        CD3DX12_DESCRIPTOR_RANGE srcRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+        CD3DX12_DESCRIPTOR_RANGE dstRange(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0);
+
+        CD3DX12_ROOT_PARAMETER params[3] = {};
+        params[0].InitAsConstants(4, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[1].InitAsDescriptorTable(1, &srcRange, D3D12_SHADER_VISIBILITY_ALL);
+        params[2].InitAsDescriptorTable(1, &dstRange, D3D12_SHADER_VISIBILITY_ALL);
+
+        CD3DX12_ROOT_SIGNATURE_DESC desc(_countof(params), params, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+        ComPtr<ID3DBlob> sig, err;
+        ThrowIfFailed(D3D12SerializeRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1, &sig, &err));
+        ThrowIfFailed(m_framework->GetDevice()->CreateRootSignature(0, sig->GetBufferPointer(),
+            sig->GetBufferSize(), IID_PPV_ARGS(&m_hizRootSignature)));
+    }
+
     // Deferred Lighting RS
     {
         CD3DX12_DESCRIPTOR_RANGE srv[6];
@@ -213,11 +282,14 @@ void Pipeline::Init()
         CD3DX12_DESCRIPTOR_RANGE uav(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 0);
         CD3DX12_DESCRIPTOR_RANGE srv(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 2);
 
-        CD3DX12_ROOT_PARAMETER params[4] = {};
+        CD3DX12_ROOT_PARAMETER params[7] = {};
         params[0].InitAsDescriptorTable(1, &uav, D3D12_SHADER_VISIBILITY_ALL);
         params[1].InitAsConstantBufferView(5, 0, D3D12_SHADER_VISIBILITY_ALL);
         params[2].InitAsDescriptorTable(1, &srv, D3D12_SHADER_VISIBILITY_ALL);
         params[3].InitAsConstantBufferView(6, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[4].InitAsShaderResourceView(3, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[5].InitAsUnorderedAccessView(2, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[6].InitAsConstants(1, 7, 0, D3D12_SHADER_VISIBILITY_ALL);
 
         CD3DX12_ROOT_SIGNATURE_DESC desc(_countof(params), params, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
@@ -227,6 +299,26 @@ void Pipeline::Init()
             sig->GetBufferSize(), IID_PPV_ARGS(&m_particlesComputeRS)));
     }
 
+    // Particle sort RS
+    {
+        CD3DX12_ROOT_PARAMETER params[8] = {};
+        params[0].InitAsConstants(5, 0, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[1].InitAsShaderResourceView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[2].InitAsShaderResourceView(1, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[3].InitAsUnorderedAccessView(0, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[4].InitAsUnorderedAccessView(1, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[5].InitAsUnorderedAccessView(2, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[6].InitAsUnorderedAccessView(3, 0, D3D12_SHADER_VISIBILITY_ALL);
+        params[7].InitAsUnorderedAccessView(4, 0, D3D12_SHADER_VISIBILITY_ALL);
+
+        CD3DX12_ROOT_SIGNATURE_DESC desc(_countof(params), params, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+        ComPtr<ID3DBlob> sig, err;
+        ThrowIfFailed(D3D12SerializeRootSignature(&desc, D3D_ROOT_SIGNATURE_VERSION_1, &sig, &err));
+        ThrowIfFailed(m_framework->GetDevice()->CreateRootSignature(0, sig->GetBufferPointer(),
+            sig->GetBufferSize(), IID_PPV_ARGS(&m_particleSortRS)));
+    }
+
     // Post RS
     {
         CD3DX12_DESCRIPTOR_RANGE srv(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
@@ -331,7 +423,7 @@ void Pipeline::Init()
     // Opaque 
     {
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-        desc.InputLayout = { inputLayout, _countof(inputLayout) };
+        desc.InputLayout = meshLayout;
         desc.pRootSignature = m_rootSignature.Get();
         desc.VS = { vsBlob->GetBufferPointer(), vsBlob->GetBufferSize() };
         desc.PS = { psBlob->GetBufferPointer(), psBlob->GetBufferSize() };
@@ -350,7 +442,7 @@ void Pipeline::Init()
     // Transparent 
     {
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-        desc.InputLayout = { inputLayout, _countof(inputLayout) };
+        desc.InputLayout = meshLayout;
         desc.pRootSignature = m_rootSignature.Get();
         desc.VS = { vsBlob->GetBufferPointer(), vsBlob->GetBufferSize() };
         desc.PS = { psBlob->GetBufferPointer(), psBlob->GetBufferSize() };
@@ -377,7 +469,7 @@ void Pipeline::Init()
     // G-Buffer
     {
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-        desc.InputLayout = { inputLayout, _countof(inputLayout) };
+        desc.InputLayout = meshLayout;
         desc.pRootSignature = m_rootSignature.Get();
         desc.VS = { vsG->GetBufferPointer(), vsG->GetBufferSize() };
         desc.PS = { psG->GetBufferPointer(), psG->GetBufferSize() };
@@ -402,6 +494,7 @@ void Pipeline::Init()
         struct alignas(void*) MeshGBufferStream
         {
             PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE, ID3D12RootSignature*> RootSig;
+            PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS, D3D12_SHADER_BYTECODE> AS;
             PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS, D3D12_SHADER_BYTECODE> MS;
             PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS, D3D12_SHADER_BYTECODE> PS;
             PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER, D3D12_RASTERIZER_DESC> Raster;
@@ -415,7 +508,6 @@ void Pipeline::Init()
         } stream = {};
 
         stream.RootSig.data = m_meshletRootSignature.Get();
-        stream.MS.data = { msGBuffer->GetBufferPointer(), msGBuffer->GetBufferSize() };
         stream.PS.data = { psG->GetBufferPointer(), psG->GetBufferSize() };
         stream.Raster.data = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
         stream.Blend.data = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
@@ -435,13 +527,29 @@ void Pipeline::Init()
         D3D12_PIPELINE_STATE_STREAM_DESC streamDesc = { sizeof(stream), &stream };
         ComPtr<ID3D12Device2> dev2;
         m_framework->GetDevice()->QueryInterface(IID_PPV_ARGS(&dev2));
+
+        // пустой AS - без стадии усиления
+        stream.MS.data = { msGBuffer->GetBufferPointer(), msGBuffer->GetBufferSize() };
         ThrowIfFailed(dev2->CreatePipelineState(&streamDesc, IID_PPV_ARGS(&m_meshletGBufferPSO)));
+
+        stream.AS.data = { asMeshletCull->GetBufferPointer(), asMeshletCull->GetBufferSize() };
+        stream.MS.data = { msGBufferCull->GetBufferPointer(), msGBufferCull->GetBufferSize() };
+        ThrowIfFailed(dev2->CreatePipelineState(&streamDesc, IID_PPV_ARGS(&m_meshletCullGBufferPSO)));
+
+        stream.AS.data = {};
+        stream.MS.data = { msGBufferList->GetBufferPointer(), msGBufferList->GetBufferSize() };
+        ThrowIfFailed(dev2->CreatePipelineState(&streamDesc, IID_PPV_ARGS(&m_meshletListGBufferPSO)));
+
+        D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
+        desc.pRootSignature = m_hizRootSignature.Get();
+        desc.CS = { csBuildHiZ->GetBufferPointer(), csBuildHiZ->GetBufferSize() };
+        ThrowIfFailed(m_framework->GetDevice()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_hizCSO)));
     }
 
     // Tessellation
     {
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-        desc.InputLayout = { inputLayout, _countof(inputLayout) };
+        desc.InputLayout = meshLayout;
         desc.pRootSignature = m_rootSignature.Get();
         desc.VS = { vsTessBlob->GetBufferPointer(), vsTessBlob->GetBufferSize() };
         desc.HS = { hsTessBlob->GetBufferPointer(), hsTessBlob->GetBufferSize() };
@@ -464,7 +572,7 @@ void Pipeline::Init()
 
     {
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-        desc.InputLayout = { inputLayout, _countof(inputLayout) };
+        desc.InputLayout = meshLayout;
         desc.pRootSignature = m_rootSignature.Get();
         desc.VS = { vsTessBlob->GetBufferPointer(), vsTessBlob->GetBufferSize() };
         desc.HS = { hsTessBlob->GetBufferPointer(), hsTessBlob->GetBufferSize() };
@@ -489,7 +597,7 @@ void Pipeline::Init()
     // Shadow
     {
         D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-        desc.InputLayout = { inputLayout, _countof(inputLayout) };
+        desc.InputLayout = { positionLayout, _countof(positionLayout) };
         desc.pRootSignature = m_rootSignature.Get();
         desc.VS = { vsShadow->GetBufferPointer(), vsShadow->GetBufferSize() };
         desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
@@ -535,6 +643,25 @@ void Pipeline::Init()
 
         desc.CS = { csEmit->GetBufferPointer(), csEmit->GetBufferSize() };
         ThrowIfFailed(m_framework->GetDevice()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_particlesEmitCSO)));
+
+        desc.CS = { csBuildArgs->GetBufferPointer(), csBuildArgs->GetBufferSize() };
+        ThrowIfFailed(m_framework->GetDevice()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_particlesBuildArgsCSO)));
+    }
+
+    {
+        D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
+        desc.pRootSignature = m_particleSortRS.Get();
+        desc.CS = { csSortKeys->GetBufferPointer(), csSortKeys->GetBufferSize() };
+        ThrowIfFailed(m_framework->GetDevice()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_particleSortKeysCSO)));
+
+        desc.CS = { csSortHistogram->GetBufferPointer(), csSortHistogram->GetBufferSize() };
+        ThrowIfFailed(m_framework->GetDevice()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_particleSortHistogramCSO)));
+
+        desc.CS = { csSortScan->GetBufferPointer(), csSortScan->GetBufferSize() };
+        ThrowIfFailed(m_framework->GetDevice()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_particleSortScanCSO)));
+
+        desc.CS = { csSortScatter->GetBufferPointer(), csSortScatter->GetBufferSize() };
+        ThrowIfFailed(m_framework->GetDevice()->CreateComputePipelineState(&desc, IID_PPV_ARGS(&m_particleSortScatterCSO)));
     }
 
     // Deferred
@@ -668,15 +795,7 @@ void Pipeline::Init()
         };
 
     CreatePostPSO(psCopyHDRtoLDR, m_copyHDRtoLDRPSO);
-    CreatePostPSO(psCopyLDR, m_copyLDRPSO);
     CreatePostPSO(psTonemap, m_tonemapPSO);
-    CreatePostPSO(psGamma, m_gammaPSO);
-    CreatePostPSO(psVignette, m_vignettePSO);
-    CreatePostPSO(psInvert, m_invertPSO);
-    CreatePostPSO(psGrayscale, m_grayscalePSO);
-    CreatePostPSO(psPixelate, m_pixelatePSO);
-    CreatePostPSO(psPosterize, m_posterizePSO);
-    CreatePostPSO(psSaturation, m_saturationPSO);
     CreatePostPSO_WithRS(psMotionBlur, m_motionBlurRootSig.Get(), m_motionBlurPSO);
 
     // Preview
@@ -755,7 +874,43 @@ void Pipeline::Init()
     }
 }
 
-void Pipeline::Compile(LPCWSTR file, LPCWSTR entry, LPCWSTR target, ComPtr<IDxcBlob>& outBlob)
+// Пермутации компилируются при первом запросе и живут до конца работы
+ID3D12PipelineState* Pipeline::GetPostUberPSO(uint32_t permutationKey)
+{
+    auto it = m_postUberPSOs.find(permutationKey);
+    if (it != m_postUberPSOs.end())
+        return it->second.Get();
+
+    std::vector<DxcDefine> defines;
+    for (uint32_t bit = 0; bit < POST_BIT_COUNT; ++bit)
+        if (permutationKey & (1u << bit))
+            defines.push_back({ PostEffectDefine(bit), L"1" });
+
+    ComPtr<IDxcBlob> psBlob;
+    Compile(L"PostEffects.hlsl", L"PS_PostUber", L"ps_6_5", psBlob, defines);
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+    desc.pRootSignature = m_postRootSig.Get();
+    desc.VS = { m_vsQuad->GetBufferPointer(), m_vsQuad->GetBufferSize() };
+    desc.PS = { psBlob->GetBufferPointer(), psBlob->GetBufferSize() };
+    desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+    desc.DepthStencilState.DepthEnable = FALSE;
+    desc.SampleMask = UINT_MAX;
+    desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    desc.NumRenderTargets = 1;
+    desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+
+    ComPtr<ID3D12PipelineState> pso;
+    ThrowIfFailed(m_framework->GetDevice()->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)));
+    m_postUberPSOs[permutationKey] = pso;
+    return pso.Get();
+}
+
+// thread-safe: у каждого вызова свои IDxcLibrary/IDxcCompiler
+void Pipeline::CompileDxc(LPCWSTR file, LPCWSTR entry, LPCWSTR target,
+    const std::vector<DxcDefine>& defines, ComPtr<IDxcBlob>& outBlob)
 {
     ComPtr<IDxcLibrary>  library;
     ComPtr<IDxcCompiler> compiler;
@@ -764,20 +919,17 @@ void Pipeline::Compile(LPCWSTR file, LPCWSTR entry, LPCWSTR target, ComPtr<IDxcB
 
     ComPtr<IDxcBlobEncoding> source;
     library->CreateBlobFromFile(file, nullptr, &source);
+    // #include "..." ищется относительно файла, как и в ShaderCache
+    ComPtr<IDxcIncludeHandler> includeHandler;
+    library->CreateIncludeHandler(&includeHandler);
     ComPtr<IDxcOperationResult> result;
 
-    LPCWSTR args[] = 
-    {
-        L"-HV",
-        L"2021",
-    };
-
     compiler->Compile(
         source.Get(),
         file,
         entry, target,
-        args, _countof(args),
-        nullptr, 0, nullptr,
+        kDxcArgs, _countof(kDxcArgs),
+        defines.empty() ? nullptr : defines.data(), (UINT32)defines.size(), includeHandler.Get(),
         &result
     );
     HRESULT hr;
@@ -789,4 +941,149 @@ void Pipeline::Compile(LPCWSTR file, LPCWSTR entry, LPCWSTR target, ComPtr<IDxcB
         throw std::runtime_error("DXC compile failed");
     }
     result->GetResult(&outBlob);
-}
\ No newline at end of file
+}
+
+const std::string& Pipeline::GetCompilerVersion()
+{
+    if (!m_compilerVersion.empty())
+        return m_compilerVersion;
+
+    ComPtr<IDxcCompiler> compiler;
+    ComPtr<IDxcVersionInfo> info;
+    UINT32 major = 0, minor = 0;
+    if (SUCCEEDED(DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler))) &&
+        SUCCEEDED(compiler.As(&info)))
+        info->GetVersion(&major, &minor);
+
+    m_compilerVersion = "dxc " + std::to_string(major) + "." + std::to_string(minor);
+
+    ComPtr<IDxcVersionInfo2> info2;
+    char* commitHash = nullptr;
+    UINT32 commitCount = 0;
+    if (info && SUCCEEDED(info.As(&info2)) && SUCCEEDED(info2->GetCommitInfo(&commitCount, &commitHash)) && commitHash)
+    {
+        m_compilerVersion += std::string(" ") + commitHash;
+        CoTaskMemFree(commitHash);
+    }
+    return m_compilerVersion;
+}
+
+uint64_t Pipeline::CacheKey(LPCWSTR file, LPCWSTR entry, LPCWSTR target, const std::vector<DxcDefine>& defines)
+{
+    ShaderKeyDesc desc;
+    desc.file = file;
+    desc.entry = entry;
+    desc.target = target;
+    for (const auto& d : defines)
+        desc.defines.push_back({ d.Name, d.Value ? d.Value : L"" });
+    for (LPCWSTR a : kDxcArgs)
+        desc.args.push_back(a);
+    return ShaderCache::ComputeKey(desc, GetCompilerVersion());
+}
+
+bool Pipeline::LoadCached(uint64_t key, ComPtr<IDxcBlob>& outBlob)
+{
+    std::vector<uint8_t> bytes;
+    if (!m_shaderCache.Load(key, bytes))
+        return false;
+
+    ComPtr<IDxcLibrary> library;
+    ComPtr<IDxcBlobEncoding> blob;
+    if (FAILED(DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&library))) ||
+        FAILED(library->CreateBlobWithEncodingOnHeapCopy(bytes.data(), (UINT32)bytes.size(), 0, &blob)))
+        return false;
+
+    outBlob = blob;
+    return true;
+}
+
+void Pipeline::Compile(LPCWSTR file, LPCWSTR entry, LPCWSTR target, ComPtr<IDxcBlob>& outBlob,
+    const std::vector<DxcDefine>& defines)
+{
+    const uint64_t key = CacheKey(file, entry, target, defines);
+    if (LoadCached(key, outBlob))
+    {
+        m_shaderCache.CountHit();
+        return;
+    }
+
+    m_shaderCache.CountMiss();
+    CompileDxc(file, entry, target, defines, outBlob);
+    m_shaderCache.Store(key, outBlob->GetBufferPointer(), outBlob->GetBufferSize());
+}
+
+void Pipeline::CompileBatch(std::vector<ShaderJob>& jobs)
+{
+    m_compileStats = RunBatch(jobs, true);
+
+    m_initJobs = jobs;
+    for (ShaderJob& job : m_initJobs)
+        job.out = nullptr;
+}
+
+// Попадания грузятся с диска, промахи компилируются на TaskPool и пишутся в кэш.
+// useCache == false - кэш не читается, компилируется всё
+ShaderCompileStats Pipeline::RunBatch(std::vector<ShaderJob>& jobs, bool useCache)
+{
+    Timer timer;
+
+    std::vector<uint64_t> keys(jobs.size());
+    std::vector<size_t> misses;
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        keys[i] = CacheKey(jobs[i].file, jobs[i].entry, jobs[i].target, jobs[i].defines);
+        if (useCache && LoadCached(keys[i], *jobs[i].out))
+            m_shaderCache.CountHit();
+        else
+        {
+            m_shaderCache.CountMiss();
+            misses.push_back(i);
+        }
+    }
+
+    auto compile = [&](size_t begin, size_t end)
+    {
+        for (size_t m = begin; m < end; ++m)
+        {
+            ShaderJob& job = jobs[misses[m]];
+            CompileDxc(job.file, job.entry, job.target, job.defines, *job.out);
+        }
+    };
+    if (m_taskPool)
+        m_taskPool->ParallelFor(misses.size(), 1, compile);
+    else
+        compile(0, misses.size());
+
+    for (size_t i : misses)
+        m_shaderCache.Store(keys[i], (*jobs[i].out)->GetBufferPointer(), (*jobs[i].out)->GetBufferSize());
+
+    ShaderCompileStats stats;
+    stats.shaders = jobs.size();
+    stats.fromCache = jobs.size() - misses.size();
+    stats.compiled = misses.size();
+    stats.ms = timer.GetTotalSeconds() * 1000.0f;
+    return stats;
+}
+
+ShaderCacheBenchmarkResult Pipeline::RunShaderCacheBenchmark()
+{
+    std::vector<ComPtr<IDxcBlob>> blobs(m_initJobs.size());
+    std::vector<ShaderJob> jobs = m_initJobs;
+    for (size_t i = 0; i < jobs.size(); ++i)
+        jobs[i].out = &blobs[i];
+
+    ShaderCacheBenchmarkResult r;
+    r.shaders = jobs.size();
+    r.threads = m_taskPool ? m_taskPool->GetThreadCount() : 1;
+
+    // холодный проход заодно перезаписывает кэш, тёплый читает ровно его
+    const ShaderCompileStats cold = RunBatch(jobs, false);
+    for (ComPtr<IDxcBlob>& b : blobs)
+        b.Reset();
+    const ShaderCompileStats warm = RunBatch(jobs, true);
+
+    r.coldMs = cold.ms;
+    r.warmMs = warm.ms;
+    r.warmFromCache = warm.fromCache;
+    return r;
+}
@@ -2,18 +2,51 @@
 #include <wrl.h>
 #include <d3d12.h>
 #include <dxcapi.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "ShaderCache.h"
 
 class DX12Framework;
+class TaskPool;
 using Microsoft::WRL::ComPtr;
 
+// итог последнего CompileBatch: холодный старт - всё compiled, тёплый - всё из кэша
+struct ShaderCompileStats
+{
+    size_t shaders = 0;
+    size_t fromCache = 0;
+    size_t compiled = 0;
+    float ms = 0.0f;
+};
+
+// Набор шейдеров Init дважды: без кэша (всё компилируется) и с ним (всё читается с диска)
+struct ShaderCacheBenchmarkResult
+{
+    size_t shaders = 0;
+    unsigned threads = 0;
+    float coldMs = 0.0f;
+    float warmMs = 0.0f;
+    size_t warmFromCache = 0;   // меньше shaders - кэш не пишется или ключи нестабильны
+};
+
 class Pipeline
 {
 public:
     Pipeline(DX12Framework* framework);
     ~Pipeline() = default;
 
+    // до Init: геометрия арены в формате PackedVertex
+    void SetPackedVertices(bool packed) { m_packedVertices = packed; }
+    bool IsPackedVertices() const { return m_packedVertices; }
+    // до Init: промахи кэша компилируются на этих потоках, без пула - по очереди
+    void SetTaskPool(TaskPool* pool) { m_taskPool = pool; }
+
     void Init();
 
+    const ShaderCompileStats& GetCompileStats() const { return m_compileStats; }
+    ShaderCacheBenchmarkResult RunShaderCacheBenchmark();
+
     ID3D12RootSignature* GetRootSignature() const { return m_rootSignature.Get(); }
     ID3D12PipelineState* GetOpaquePSO() const { return m_opaquePSO.Get(); }
     ID3D12PipelineState* GetTransparentPSO() const { return m_transparentPSO.Get(); }
@@ -28,19 +61,17 @@ public:
     ID3D12RootSignature* GetParticlesComputeRS() const { return m_particlesComputeRS.Get(); }
     ID3D12PipelineState* GetParticlesUpdateCSO() const { return m_particlesUpdateCSO.Get(); }
     ID3D12PipelineState* GetParticlesEmitCSO() const { return m_particlesEmitCSO.Get(); }
+    ID3D12PipelineState* GetParticlesBuildArgsCSO() const { return m_particlesBuildArgsCSO.Get(); }
+    ID3D12RootSignature* GetParticleSortRS() const { return m_particleSortRS.Get(); }
+    ID3D12PipelineState* GetParticleSortKeysCSO() const { return m_particleSortKeysCSO.Get(); }
+    ID3D12PipelineState* GetParticleSortHistogramCSO() const { return m_particleSortHistogramCSO.Get(); }
+    ID3D12PipelineState* GetParticleSortScanCSO() const { return m_particleSortScanCSO.Get(); }
+    ID3D12PipelineState* GetParticleSortScatterCSO() const { return m_particleSortScatterCSO.Get(); }
     ID3D12PipelineState* GetPostPSO() const { return m_postPSO.Get(); }
     ID3D12PipelineState* GetSkyPSO() const { return m_skyPSO.Get(); }
     ID3D12PipelineState* GetTonemapPSO()  const { return m_tonemapPSO.Get(); }
-    ID3D12PipelineState* GetGammaPSO()    const { return m_gammaPSO.Get(); }
-    ID3D12PipelineState* GetVignettePSO() const { return m_vignettePSO.Get(); }
     ID3D12RootSignature* GetPostRS() const { return m_postRootSig.Get(); }
     ID3D12PipelineState* GetCopyHDRtoLDRPSO() const { return m_copyHDRtoLDRPSO.Get(); }
-    ID3D12PipelineState* GetCopyLDRPSO() const { return m_copyLDRPSO.Get(); }
-    ID3D12PipelineState* GetInvertPSO() const { return m_invertPSO.Get(); }
-    ID3D12PipelineState* GetGrayscalePSO() const { return m_grayscalePSO.Get(); }
-    ID3D12PipelineState* GetPixelatePSO() const { return m_pixelatePSO.Get(); }
-    ID3D12PipelineState* GetPosterizePSO() const { return m_posterizePSO.Get(); }
-    ID3D12PipelineState* GetSaturationPSO() const { return m_saturationPSO.Get(); }
     ID3D12RootSignature* GetPreviewRS() const { return m_previewRootSig.Get(); }
     ID3D12PipelineState* GetPreviewPSO() const { return m_previewPSO.Get(); }
     ID3D12PipelineState* GetTerrainGBufferPSO() const { return m_terrainGBufferPSO.Get(); }
@@ -49,11 +80,18 @@ public:
     ID3D12PipelineState* GetVelocityPSO() const { return m_velocityPSO.Get(); }
     ID3D12RootSignature* GetMeshletRS() const { return m_meshletRootSignature.Get(); }
     ID3D12PipelineState* GetMeshletGBufferPSO() const { return m_meshletGBufferPSO.Get(); }
+    ID3D12PipelineState* GetMeshletCullGBufferPSO() const { return m_meshletCullGBufferPSO.Get(); }
+    ID3D12PipelineState* GetMeshletListGBufferPSO() const { return m_meshletListGBufferPSO.Get(); }
+    ID3D12RootSignature* GetHiZRS() const { return m_hizRootSignature.Get(); }
+    ID3D12PipelineState* GetHiZCSO() const { return m_hizCSO.Get(); }
     ID3D12RootSignature* GetMotionBlurRS() const { return m_motionBlurRootSig.Get(); }
     ID3D12PipelineState* GetMotionBlurPSO() const { return m_motionBlurPSO.Get(); }
+    ID3D12PipelineState* GetPostUberPSO(uint32_t permutationKey);
 
 private:
     DX12Framework* m_framework;
+    TaskPool* m_taskPool = nullptr;
+    bool m_packedVertices = false;
 
     ComPtr<ID3D12RootSignature> m_rootSignature;
     ComPtr<ID3D12PipelineState> m_opaquePSO;
@@ -69,19 +107,17 @@ private:
     ComPtr<ID3D12RootSignature> m_particlesComputeRS;
     ComPtr<ID3D12PipelineState> m_particlesUpdateCSO;
     ComPtr<ID3D12PipelineState> m_particlesEmitCSO;
+    ComPtr<ID3D12PipelineState> m_particlesBuildArgsCSO;
+    ComPtr<ID3D12RootSignature> m_particleSortRS;
+    ComPtr<ID3D12PipelineState> m_particleSortKeysCSO;
+    ComPtr<ID3D12PipelineState> m_particleSortHistogramCSO;
+    ComPtr<ID3D12PipelineState> m_particleSortScanCSO;
+    ComPtr<ID3D12PipelineState> m_particleSortScatterCSO;
     ComPtr<ID3D12PipelineState> m_postPSO;
     ComPtr<ID3D12PipelineState> m_skyPSO;
     ComPtr<ID3D12PipelineState> m_tonemapPSO;
-    ComPtr<ID3D12PipelineState> m_gammaPSO;
-    ComPtr<ID3D12PipelineState> m_vignettePSO;
     ComPtr<ID3D12RootSignature> m_postRootSig;
     ComPtr<ID3D12PipelineState> m_copyHDRtoLDRPSO;
-    ComPtr<ID3D12PipelineState> m_copyLDRPSO;
-    ComPtr<ID3D12PipelineState> m_invertPSO;
-    ComPtr<ID3D12PipelineState> m_grayscalePSO;
-    ComPtr<ID3D12PipelineState> m_pixelatePSO;
-    ComPtr<ID3D12PipelineState> m_posterizePSO;
-    ComPtr<ID3D12PipelineState> m_saturationPSO;
     ComPtr<ID3D12RootSignature> m_previewRootSig;
     ComPtr<ID3D12PipelineState> m_previewPSO;
     ComPtr<ID3D12PipelineState> m_terrainGBufferPSO;
@@ -90,8 +126,36 @@ private:
     ComPtr<ID3D12PipelineState> m_velocityPSO;
     ComPtr<ID3D12RootSignature> m_meshletRootSignature;
     ComPtr<ID3D12PipelineState> m_meshletGBufferPSO;
+    ComPtr<ID3D12PipelineState> m_meshletCullGBufferPSO;
+    ComPtr<ID3D12PipelineState> m_meshletListGBufferPSO;
+    ComPtr<ID3D12RootSignature> m_hizRootSignature;
+    ComPtr<ID3D12PipelineState> m_hizCSO;
     ComPtr<ID3D12RootSignature> m_motionBlurRootSig;
     ComPtr<ID3D12PipelineState> m_motionBlurPSO;
+    ComPtr<IDxcBlob> m_vsQuad;
+    std::unordered_map<uint32_t, ComPtr<ID3D12PipelineState>> m_postUberPSOs;
+
+    struct ShaderJob
+    {
+        LPCWSTR file;
+        LPCWSTR entry;
+        LPCWSTR target;
+        ComPtr<IDxcBlob>* out;
+        std::vector<DxcDefine> defines;
+    };
+
+    ShaderCache m_shaderCache;
+    ShaderCompileStats m_compileStats;
+    std::vector<ShaderJob> m_initJobs;   // набор Init без out - для RunShaderCacheBenchmark
+    std::string m_compilerVersion;
 
-    void Compile(LPCWSTR file, LPCWSTR entry, LPCWSTR target, ComPtr<IDxcBlob>& outBlob);
+    void Compile(LPCWSTR file, LPCWSTR entry, LPCWSTR target, ComPtr<IDxcBlob>& outBlob,
+        const std::vector<DxcDefine>& defines = {});
+    void CompileBatch(std::vector<ShaderJob>& jobs);
+    ShaderCompileStats RunBatch(std::vector<ShaderJob>& jobs, bool useCache);
+    static void CompileDxc(LPCWSTR file, LPCWSTR entry, LPCWSTR target,
+        const std::vector<DxcDefine>& defines, ComPtr<IDxcBlob>& outBlob);
+    const std::string& GetCompilerVersion();
+    uint64_t CacheKey(LPCWSTR file, LPCWSTR entry, LPCWSTR target, const std::vector<DxcDefine>& defines);
+    bool LoadCached(uint64_t key, ComPtr<IDxcBlob>& outBlob);
 };
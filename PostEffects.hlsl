@@ -56,12 +56,6 @@ float4 PS_CopyHDRtoLDR(VSQOut IN) : SV_TARGET
     return float4(ldr, 1.0);
 }
 
-float4 PS_CopyLDR(VSQOut IN) : SV_TARGET
-{
-    float3 ldr = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
-    return float4(ldr, 1.0);
-}
-
 float4 PS_Tonemap(VSQOut IN) : SV_TARGET
 {
     float3 hdr = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
@@ -78,58 +72,44 @@ float4 PS_Tonemap(VSQOut IN) : SV_TARGET
     return float4(mapped, 1.0);
 }
 
-float4 PS_Gamma(VSQOut IN) : SV_TARGET
+// Все попиксельные эффекты за один проход, набор задаётся defines (см. PostPermutation.h)
+float4 PS_PostUber(VSQOut IN) : SV_TARGET
 {
-    float3 ldr = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
-    float invGamma = 1.0 / max(Gamma, 1e-4);
-    float3 srgb = pow(saturate(ldr), invGamma);
-    return float4(srgb, 1.0);
-}
+#ifdef POST_PIXELATE
+    float2 block = max(PixelateSize, 1.0) * InvResolution;
+    float2 uv0 = (floor(IN.uv / block) + 0.5) * block;
+    float3 c = gAlbedoTex.Sample(samLinear, uv0).rgb;
+#else
+    float3 c = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
+#endif
 
-float4 PS_Vignette(VSQOut IN) : SV_TARGET
-{
-    float3 srgb = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
+#ifdef POST_GAMMA
+    c = pow(saturate(c), 1.0 / max(Gamma, 1e-4));
+#endif
 
-    float2 aspect = float2(InvResolution.y / InvResolution.x, 1.0);
-    float2 d = (IN.uv - VignetteCenter) * aspect;
-    float vig = 1.0 - VignetteStrength * pow(saturate(length(d) * 1.41421356), VignettePower);
+#ifdef POST_INVERT
+    c = 1.0 - saturate(c);
+#endif
 
-    return float4(srgb * vig, 1.0);
-}
+#ifdef POST_GRAYSCALE
+    c = dot(c, float3(0.2126, 0.7152, 0.0722)).xxx;
+#endif
 
-float4 PS_Invert(VSQOut IN) : SV_TARGET
-{
-    float3 c = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
-    return float4(1.0 - c, 1.0);
-}
+#ifdef POST_POSTERIZE
+    float levels = max(PosterizeLevels, 2.0);
+    c = floor(saturate(c) * levels) / levels;
+#endif
 
-float4 PS_Grayscale(VSQOut IN) : SV_TARGET
-{
-    float3 c = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
+#ifdef POST_SATURATION
     float l = dot(c, float3(0.2126, 0.7152, 0.0722));
-    return float4(l.xxx, 1.0);
-}
+    c = saturate(lerp(l.xxx, c, Saturation));
+#endif
 
-float4 PS_Pixelate(VSQOut IN) : SV_TARGET
-{
-    float2 block = max(PixelateSize, 1.0) * InvResolution;
-    float2 uv0 = (floor(IN.uv / block) + 0.5) * block;
-    float3 c = gAlbedoTex.Sample(samLinear, uv0).rgb;
-    return float4(c, 1.0);
-}
-
-float4 PS_Posterize(VSQOut IN) : SV_TARGET
-{
-    float levels = max(PosterizeLevels, 2.0);
-    float3 c = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
-    c = floor(c * levels) / levels;
-    return float4(c, 1.0);
-}
+#ifdef POST_VIGNETTE
+    float2 aspect = float2(InvResolution.y / InvResolution.x, 1.0);
+    float2 d = (IN.uv - VignetteCenter) * aspect;
+    c *= 1.0 - VignetteStrength * pow(saturate(length(d) * 1.41421356), VignettePower);
+#endif
 
-float4 PS_Saturation(VSQOut IN) : SV_TARGET
-{
-    float3 c = gAlbedoTex.Sample(samLinear, IN.uv).rgb;
-    float l = dot(c, float3(0.2126, 0.7152, 0.0722));
-    c = lerp(l.xxx, c, Saturation);
     return float4(saturate(c), 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Биты ключа пермутации PS_PostUber, каждый бит - #define в PostEffects.hlsl
+enum PostEffectBits : uint32_t
+{
+    POST_GAMMA      = 1u << 0,
+    POST_INVERT     = 1u << 1,
+    POST_GRAYSCALE  = 1u << 2,
+    POST_PIXELATE   = 1u << 3,
+    POST_POSTERIZE  = 1u << 4,
+    POST_SATURATION = 1u << 5,
+    POST_VIGNETTE   = 1u << 6,
+    POST_BIT_COUNT  = 7,
+};
+
+inline const wchar_t* PostEffectDefine(uint32_t bit)
+{
+    static const wchar_t* names[POST_BIT_COUNT] =
+    {
+        L"POST_GAMMA", L"POST_INVERT", L"POST_GRAYSCALE", L"POST_PIXELATE",
+        L"POST_POSTERIZE", L"POST_SATURATION", L"POST_VIGNETTE",
+    };
+    return bit < POST_BIT_COUNT ? names[bit] : nullptr;
+}
+
+struct PostEffectFlags
+{
+    bool gamma = true;
+    bool invert = false;
+    bool grayscale = false;
+    bool pixelate = false;
+    bool posterize = false;
+    bool saturation = false;
+    bool vignette = true;
+};
+
+// Порядок эффектов как в старой цепочке: gamma, invert, grayscale, pixelate, posterize, saturation, vignette.
+// Pixelate читает текстуру в центре блока, поэтому он начинает второй проход, а всё до него пишется в промежуточный RT.
+// Если до pixelate ничего не включено, первого прохода нет - pixelate читает кадр сцены сам.
+inline std::vector<uint32_t> BuildPostChain(const PostEffectFlags& f)
+{
+    uint32_t pre = 0;
+    if (f.gamma) pre |= POST_GAMMA;
+    if (f.invert) pre |= POST_INVERT;
+    if (f.grayscale) pre |= POST_GRAYSCALE;
+
+    uint32_t post = 0;
+    if (f.posterize) post |= POST_POSTERIZE;
+    if (f.saturation) post |= POST_SATURATION;
+    if (f.vignette) post |= POST_VIGNETTE;
+
+    if (!f.pixelate)
+        return { pre | post };
+    if (!pre)
+        return { POST_PIXELATE | post };
+    return { pre, POST_PIXELATE | post };
+}
@@ -0,0 +1,110 @@
+#include "ReadbackManager.h"
+#include "d3dx12.h"
+#include <stdexcept>
+
+static inline void ThrowIfFailed(HRESULT hr)
+{
+    if (FAILED(hr))
+        throw std::runtime_error("HRESULT failed");
+}
+
+void ReadbackManager::Init(ID3D12Device* device, GpuHeapAllocator* allocator, UINT64 size)
+{
+    m_device = device;
+    m_allocator = allocator;
+    CreateBuffer(size);
+}
+
+void ReadbackManager::CreateBuffer(UINT64 size)
+{
+    if (m_buffer)
+    {
+        D3D12_RANGE written{ 0, 0 };
+        m_buffer->Unmap(0, &written);
+        m_buffer.Reset();
+    }
+
+    CD3DX12_HEAP_PROPERTIES heapReadback(D3D12_HEAP_TYPE_READBACK);
+    auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    ThrowIfFailed(m_allocator->CreateResource(
+        &heapReadback, D3D12_HEAP_FLAG_NONE, &desc,
+        D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_buffer)));
+
+    // readback-буфер можно держать отображённым, читаем только после fence
+    ThrowIfFailed(m_buffer->Map(0, nullptr, reinterpret_cast<void**>(&m_cpu)));
+
+    m_tracker.Init((uint32_t)size);
+    m_rowPitch.clear();
+}
+
+bool ReadbackManager::Reserve(UINT64 size)
+{
+    if (size <= m_tracker.GetCapacity())
+        return true;
+    if (m_tracker.GetLiveCount() != 0)
+        return false;
+    CreateBuffer(size);
+    return true;
+}
+
+ReadbackTicket ReadbackManager::EnqueueBuffer(ID3D12GraphicsCommandList* cmd, ID3D12Resource* src, UINT64 srcOffset, UINT64 size)
+{
+    uint32_t offset = 0;
+    const ReadbackTicket ticket = m_tracker.Enqueue((uint32_t)size, 16, offset);
+    if (ticket == InvalidReadbackTicket)
+        return ticket;
+
+    cmd->CopyBufferRegion(m_buffer.Get(), offset, src, srcOffset, size);
+    return ticket;
+}
+
+ReadbackTicket ReadbackManager::EnqueueTexture(ID3D12GraphicsCommandList* cmd, ID3D12Resource* src, UINT subresource,
+    const D3D12_BOX* box)
+{
+    D3D12_RESOURCE_DESC desc = src->GetDesc();
+    if (box)
+    {
+        desc.Width = box->right - box->left;
+        desc.Height = box->bottom - box->top;
+        desc.DepthOrArraySize = (UINT16)(box->back - box->front);
+        desc.MipLevels = 1;
+    }
+
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT fp{};
+    UINT64 total = 0;
+    const UINT firstSub = box ? 0 : subresource;
+    m_device->GetCopyableFootprints(&desc, firstSub, 1, 0, &fp, nullptr, nullptr, &total);
+
+    uint32_t offset = 0;
+    const ReadbackTicket ticket = m_tracker.Enqueue((uint32_t)total, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, offset);
+    if (ticket == InvalidReadbackTicket)
+        return ticket;
+
+    fp.Offset = offset;
+    CD3DX12_TEXTURE_COPY_LOCATION dst(m_buffer.Get(), fp);
+    CD3DX12_TEXTURE_COPY_LOCATION from(src, subresource);
+    cmd->CopyTextureRegion(&dst, 0, 0, 0, &from, box);
+
+    m_rowPitch[ticket] = fp.Footprint.RowPitch;
+    return ticket;
+}
+
+const uint8_t* ReadbackManager::GetData(ReadbackTicket ticket, UINT* rowPitch) const
+{
+    uint32_t offset = 0, size = 0;
+    if (!m_tracker.IsReady(ticket) || !m_tracker.GetRange(ticket, offset, size))
+        return nullptr;
+
+    if (rowPitch)
+    {
+        auto it = m_rowPitch.find(ticket);
+        *rowPitch = it != m_rowPitch.end() ? it->second : size;
+    }
+    return m_cpu + offset;
+}
+
+void ReadbackManager::Release(ReadbackTicket ticket)
+{
+    m_tracker.Release(ticket);
+    m_rowPitch.erase(ticket);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <unordered_map>
+#include "GpuHeapAllocator.h"
+#include "ReadbackTracker.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Асинхронное чтение с GPU без ожидания очереди.
+// Enqueue* записывает копию в общий readback-буфер и возвращает тикет; данные доступны
+// через GetData, когда fence пройдёт Signal после этих команд (обычно через кадр).
+// Тикет нужно отпустить через Release, иначе место в буфере не вернётся.
+class ReadbackManager
+{
+public:
+    static const UINT64 DefaultSize = 4 * 1024 * 1024;
+
+    void Init(ID3D12Device* device, GpuHeapAllocator* allocator, UINT64 size = DefaultSize);
+    // увеличивает буфер, если сейчас нет живых тикетов; false - не получилось
+    bool Reserve(UINT64 size);
+
+    // src должен быть в COPY_SOURCE
+    ReadbackTicket EnqueueBuffer(ID3D12GraphicsCommandList* cmd, ID3D12Resource* src, UINT64 srcOffset, UINT64 size);
+    // box == nullptr - весь подресурс (для depth-stencil и MSAA можно только так)
+    ReadbackTicket EnqueueTexture(ID3D12GraphicsCommandList* cmd, ID3D12Resource* src, UINT subresource,
+        const D3D12_BOX* box = nullptr);
+
+    void OnFenceSignaled(UINT64 signaled, UINT64 completed) { m_tracker.OnFenceSignaled(signaled, completed); }
+
+    bool IsReady(ReadbackTicket ticket) const { return m_tracker.IsReady(ticket); }
+    // nullptr, пока данные не готовы; для текстур строки идут с шагом rowPitch
+    const uint8_t* GetData(ReadbackTicket ticket, UINT* rowPitch = nullptr) const;
+    void Release(ReadbackTicket ticket);
+
+    const ReadbackTracker& GetTracker() const { return m_tracker; }
+
+private:
+    void CreateBuffer(UINT64 size);
+
+    GpuHeapAllocator* m_allocator = nullptr;
+    ComPtr<ID3D12Device> m_device;
+    ComPtr<ID3D12Resource> m_buffer;
+    uint8_t* m_cpu = nullptr;
+
+    ReadbackTracker m_tracker;
+    std::unordered_map<ReadbackTicket, UINT> m_rowPitch;
+};
@@ -0,0 +1,81 @@
+#include "ReadbackTracker.h"
+
+void ReadbackTracker::Init(uint32_t capacity)
+{
+    m_space.Init(capacity);
+    m_entries.clear();
+}
+
+ReadbackTicket ReadbackTracker::Enqueue(uint32_t size, uint32_t alignment, uint32_t& offset)
+{
+    offset = m_space.Allocate(size, alignment);
+    if (offset == OffsetAllocator::Invalid)
+        return InvalidReadbackTicket;
+
+    const ReadbackTicket ticket = m_nextTicket++;
+    m_entries[ticket] = { offset, size, m_nextFence, false, false };
+    return ticket;
+}
+
+void ReadbackTracker::OnFenceSignaled(uint64_t signaled, uint64_t completed)
+{
+    m_nextFence = signaled + 1;
+
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        Entry& e = it->second;
+        if (!e.ready && e.fence <= completed)
+            e.ready = true;
+
+        if (e.ready && e.released)
+        {
+            m_space.Free(e.offset);
+            it = m_entries.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+ReadbackTracker::State ReadbackTracker::GetState(ReadbackTicket ticket) const
+{
+    auto it = m_entries.find(ticket);
+    if (it == m_entries.end() || it->second.released)
+        return State::Invalid;
+    return it->second.ready ? State::Ready : State::Pending;
+}
+
+bool ReadbackTracker::GetRange(ReadbackTicket ticket, uint32_t& offset, uint32_t& size) const
+{
+    auto it = m_entries.find(ticket);
+    if (it == m_entries.end() || it->second.released)
+        return false;
+    offset = it->second.offset;
+    size = it->second.size;
+    return true;
+}
+
+void ReadbackTracker::Release(ReadbackTicket ticket)
+{
+    auto it = m_entries.find(ticket);
+    if (it == m_entries.end())
+        return;
+
+    // GPU ещё может писать в этот участок
+    if (!it->second.ready)
+    {
+        it->second.released = true;
+        return;
+    }
+    m_space.Free(it->second.offset);
+    m_entries.erase(it);
+}
+
+size_t ReadbackTracker::GetPendingCount() const
+{
+    size_t n = 0;
+    for (const auto& kv : m_entries)
+        if (!kv.second.ready)
+            ++n;
+    return n;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include "OffsetAllocator.h"
+
+using ReadbackTicket = uint64_t;
+static const ReadbackTicket InvalidReadbackTicket = 0;
+
+// Учёт тикетов чтения с GPU: место в readback-буфере и fence, после которого данные готовы.
+// С устройством не работает, ReadbackManager записывает копии и держит сам буфер.
+class ReadbackTracker
+{
+public:
+    enum class State { Invalid, Pending, Ready };
+
+    void Init(uint32_t capacity);
+
+    // InvalidReadbackTicket - в буфере нет места
+    ReadbackTicket Enqueue(uint32_t size, uint32_t alignment, uint32_t& offset);
+    // вызывается после каждого Signal, как StagingPool::OnFenceSignaled
+    void OnFenceSignaled(uint64_t signaled, uint64_t completed);
+
+    State GetState(ReadbackTicket ticket) const;
+    bool IsReady(ReadbackTicket ticket) const { return GetState(ticket) == State::Ready; }
+    bool GetRange(ReadbackTicket ticket, uint32_t& offset, uint32_t& size) const;
+    // можно отпустить и незавершённый тикет - место вернётся, когда GPU до него дойдёт
+    void Release(ReadbackTicket ticket);
+
+    uint32_t GetCapacity() const { return m_space.GetCapacity(); }
+    uint32_t GetUsedBytes() const { return m_space.GetUsed(); }
+    size_t GetLiveCount() const { return m_entries.size(); }
+    size_t GetPendingCount() const;
+
+private:
+    struct Entry
+    {
+        uint32_t offset;
+        uint32_t size;
+        uint64_t fence;
+        bool ready;
+        bool released;
+    };
+
+    OffsetAllocator m_space;
+    std::unordered_map<ReadbackTicket, Entry> m_entries;
+    ReadbackTicket m_nextTicket = 1;
+    uint64_t m_nextFence = 1;
+};
@@ -0,0 +1,120 @@
+#include "RecordingCommandList.h"
+
+void RecordingCommandList::Begin(RecordedOp op)
+{
+    m_offsets.push_back((uint32_t)m_stream.size());
+    m_stream.push_back((uint8_t)op);
+    ++m_counts[(size_t)op];
+}
+
+void RecordingCommandList::SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps)
+{
+    Begin(RecordedOp::SetDescriptorHeaps);
+    Write(count);
+    for (UINT i = 0; i < count; ++i)
+        Write((uint64_t)(uintptr_t)heaps[i]);
+}
+
+void RecordingCommandList::SetGraphicsRootSignature(ID3D12RootSignature* rs)
+{
+    Begin(RecordedOp::SetGraphicsRootSignature);
+    Write((uint64_t)(uintptr_t)rs);
+}
+
+void RecordingCommandList::SetPipelineState(ID3D12PipelineState* pso)
+{
+    Begin(RecordedOp::SetPipelineState);
+    Write((uint64_t)(uintptr_t)pso);
+}
+
+void RecordingCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    Begin(RecordedOp::IASetPrimitiveTopology);
+    Write((uint32_t)topology);
+}
+
+void RecordingCommandList::SetGraphicsRootConstantBufferView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    Begin(RecordedOp::SetGraphicsRootConstantBufferView);
+    Write(param);
+    Write(address);
+}
+
+void RecordingCommandList::SetGraphicsRootShaderResourceView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    Begin(RecordedOp::SetGraphicsRootShaderResourceView);
+    Write(param);
+    Write(address);
+}
+
+void RecordingCommandList::SetGraphicsRootUnorderedAccessView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    Begin(RecordedOp::SetGraphicsRootUnorderedAccessView);
+    Write(param);
+    Write(address);
+}
+
+void RecordingCommandList::SetGraphicsRootDescriptorTable(UINT param, D3D12_GPU_DESCRIPTOR_HANDLE table)
+{
+    Begin(RecordedOp::SetGraphicsRootDescriptorTable);
+    Write(param);
+    Write(table.ptr);
+}
+
+void RecordingCommandList::IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+    Begin(RecordedOp::IASetVertexBuffers);
+    Write(startSlot);
+    Write(count);
+    for (UINT i = 0; i < count; ++i)
+        Write(views[i]);
+}
+
+void RecordingCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+    Begin(RecordedOp::IASetIndexBuffer);
+    D3D12_INDEX_BUFFER_VIEW v{};
+    if (view) v = *view;
+    Write(v);
+}
+
+void RecordingCommandList::DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)
+{
+    Begin(RecordedOp::DrawInstanced);
+    Write(vertexCount);
+    Write(instanceCount);
+    Write(startVertex);
+    Write(startInstance);
+}
+
+void RecordingCommandList::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+    Begin(RecordedOp::DrawIndexedInstanced);
+    Write(indexCount);
+    Write(instanceCount);
+    Write(startIndex);
+    Write(baseVertex);
+    Write(startInstance);
+}
+
+void RecordingCommandList::DispatchMesh(UINT x, UINT y, UINT z)
+{
+    Begin(RecordedOp::DispatchMesh);
+    Write(x);
+    Write(y);
+    Write(z);
+}
+
+void RecordingCommandList::Reset()
+{
+    m_stream.clear();
+    m_offsets.clear();
+    for (auto& c : m_counts) c = 0;
+}
+
+size_t RecordingCommandList::GetDrawCount() const
+{
+    return GetCount(RecordedOp::DrawInstanced) +
+        GetCount(RecordedOp::DrawIndexedInstanced) +
+        GetCount(RecordedOp::DispatchMesh);
+}
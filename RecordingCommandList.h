@@ -0,0 +1,82 @@
+#pragma once
+#include <d3d12.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+enum class RecordedOp : uint8_t
+{
+    SetDescriptorHeaps,
+    SetGraphicsRootSignature,
+    SetPipelineState,
+    IASetPrimitiveTopology,
+    SetGraphicsRootConstantBufferView,
+    SetGraphicsRootShaderResourceView,
+    SetGraphicsRootUnorderedAccessView,
+    SetGraphicsRootDescriptorTable,
+    IASetVertexBuffers,
+    IASetIndexBuffer,
+    DrawInstanced,
+    DrawIndexedInstanced,
+    DispatchMesh,
+    Count
+};
+
+// Null-бэкенд: ничего не отдаёт на GPU, пишет команды в плотный поток байт (op + аргументы).
+// Методы названы как у ID3D12GraphicsCommandList6, поэтому подходит для StateFilteredCommandList
+// и RecordGeometryDraws без устройства.
+class RecordingCommandList
+{
+public:
+    struct Command
+    {
+        RecordedOp op;
+        const uint8_t* args;
+    };
+
+    void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps);
+    void SetGraphicsRootSignature(ID3D12RootSignature* rs);
+    void SetPipelineState(ID3D12PipelineState* pso);
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology);
+    void SetGraphicsRootConstantBufferView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address);
+    void SetGraphicsRootShaderResourceView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address);
+    void SetGraphicsRootUnorderedAccessView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address);
+    void SetGraphicsRootDescriptorTable(UINT param, D3D12_GPU_DESCRIPTOR_HANDLE table);
+    void IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views);
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view);
+    void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance);
+    void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+    void DispatchMesh(UINT x, UINT y, UINT z);
+
+    void Reset();
+
+    size_t GetCommandCount() const { return m_offsets.size(); }
+    size_t GetCount(RecordedOp op) const { return m_counts[(size_t)op]; }
+    size_t GetStreamSize() const { return m_stream.size(); }
+    size_t GetDrawCount() const;
+    Command GetCommand(size_t i) const { return { (RecordedOp)m_stream[m_offsets[i]], m_stream.data() + m_offsets[i] + 1 }; }
+
+    template<typename T>
+    static T ReadArg(const uint8_t*& args)
+    {
+        T v;
+        std::memcpy(&v, args, sizeof(T));
+        args += sizeof(T);
+        return v;
+    }
+
+private:
+    void Begin(RecordedOp op);
+
+    template<typename T>
+    void Write(const T& v)
+    {
+        const size_t at = m_stream.size();
+        m_stream.resize(at + sizeof(T));
+        std::memcpy(m_stream.data() + at, &v, sizeof(T));
+    }
+
+    std::vector<uint8_t> m_stream;
+    std::vector<uint32_t> m_offsets;
+    size_t m_counts[(size_t)RecordedOp::Count] = {};
+};
@@ -8,6 +8,15 @@
 #include "imgui_impl_win32.h"
 #include "ShadowMap.h"
 #include "Meshlets.h"
+#include "PostPermutation.h"
+#include "GeometryFrame.h"
+#include "MaterialTable.h"
+#include "VertexStreams.h"
+#include "MeshCache.h"
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace DirectX;
 
@@ -16,12 +25,6 @@ inline void ThrowIfFailed(HRESULT hr)
     if (FAILED(hr)) throw std::runtime_error("HRESULT failed");
 }
 
-struct CB 
-{
-    XMFLOAT4X4 World;
-    XMFLOAT4X4 ViewProj;
-};
-
 struct LightCB 
 {
     int Type; int pad0[3];
@@ -61,31 +64,6 @@ struct TessCB
     float minTess; float maxTess;
 };
 
-struct MaterialCB
-{
-    float      useNormalMap;
-    UINT       diffuseIdx;
-    UINT       normalIdx;
-    UINT       dispIdx;
-
-    UINT       roughIdx;
-    UINT       metalIdx;
-    UINT       aoIdx;
-    UINT       hasDiffuseMap;
-
-    XMFLOAT4   baseColor;
-
-    UINT       useRoughMap;
-    UINT       useMetalMap;
-    UINT       useAOMap;
-    UINT       hasRoughMap;
-
-    UINT       hasMetalMap;
-    UINT       hasAOMap;
-    UINT       _padM0;
-    UINT       _padM1;
-};
-
 struct PostCB
 {
     float Exposure;
@@ -246,115 +224,323 @@ void RenderingSystem::CountFPS()
 
 void RenderingSystem::SetObjects()
 {
-    m_objects = loader.LoadSceneObjectsLODs
-    (
-        {
-            //"Assets\\SponzaCrytek\\sponza.obj", 
-            //"Assets\\TestPBR\\TestPBR.obj", 
-            //"Assets\\Can\\Gas_can.obj", 
-            //"Assets\\LOD\\bunnyLOD0.obj", 
-            //"Assets\\LOD\\bunnyLOD1.obj", 
-            //"Assets\\LOD\\bunnyLOD2.obj", 
-            //"Assets\\LOD\\bunnyLOD3.obj", 
-            //"Assets\\TestShadows\\test.obj", 
-            //"Assets\\TestShadows\\floor.obj", 
-            //"Assets\\TestShadows\\TestRT.obj", 
-            //"Assets\\Cube\\cube.obj", 
-            "Assets\\Camera\\vintage_video_camera_1k.obj",
-            //"Assets\\Dragon\\dragon.obj",
-        },
-        { 0.0f, 500.0f, 1000.0f, 1500.0f, }
-    );
+    m_scenePaths =
+    {
+        //"Assets\\SponzaCrytek\\sponza.obj", 
+        //"Assets\\TestPBR\\TestPBR.obj", 
+        //"Assets\\Can\\Gas_can.obj", 
+        //"Assets\\LOD\\bunnyLOD0.obj", 
+        //"Assets\\LOD\\bunnyLOD1.obj", 
+        //"Assets\\LOD\\bunnyLOD2.obj", 
+        //"Assets\\LOD\\bunnyLOD3.obj", 
+        //"Assets\\TestShadows\\test.obj", 
+        //"Assets\\TestShadows\\floor.obj", 
+        //"Assets\\TestShadows\\TestRT.obj", 
+        //"Assets\\Cube\\cube.obj", 
+        "Assets\\Camera\\vintage_video_camera_1k.obj",
+        //"Assets\\Dragon\\dragon.obj",
+    };
+    // в единицах меша, как и у сгенерированных LOD; при выборе LOD умножаются на масштаб объекта
+    m_sceneLodDistances = { 0.0f, 5000.0f, 10000.0f, 15000.0f, };
+
+    loader.SetTaskPool(m_taskPool.get());
+    UpdateLodViewSettings();
+    loader.SetLodChainSettings(m_lodSettings);
+
+    const size_t cacheHits = m_meshCache.GetHits();
+    const auto loadStart = std::chrono::steady_clock::now();
+    m_objects = loader.LoadSceneObjectsCached(m_meshCache, m_scenePaths, m_sceneLodDistances);
+    m_sceneLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    m_sceneFromCache = m_meshCache.GetHits() != cacheHits;
 
     m_objectScale = 0.1f;
     for (auto& obj : m_objects) obj.scale = { m_objectScale, m_objectScale, m_objectScale };
 
+    for (auto& lods : m_meshletData)
+        for (auto& md : lods)
+            if (md.meshletCount != 0)
+                m_framework->FreeDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, md.srvBase, 5);
     m_meshletData.clear();
     m_meshletData.resize(m_objects.size());
-    m_meshletUploads.clear();
+
+    // мешлеты строим заранее: нужен общий размер буфера данных арены.
+    // Раскладка одного LOD - блоб BuildMeshletBlob: [MeshletBounds x N][Meshlet x N][meshletVertices][meshletPrims],
+    // начало кратно MeshletBlobAlignment. Границы ещё копируются на CPU для программного отсечения.
+    // Если сцена пришла из MeshCache, мешлеты и вершины берутся прямо из отображённого файла
+    std::vector<std::vector<std::vector<uint32_t>>> meshletBlobs(m_objects.size());
+
+    UINT totalVertices = 0;
+    UINT totalIndices = 0;
+    UINT totalIndices16 = 0;
+    UINT totalData = 0;
+
+    // одна квантизация на все LOD объекта: переключение LOD не сдвигает вершины
+    m_objectQuant.assign(m_objects.size(), VertexQuantization());
 
     for (size_t objIndex = 0; objIndex < m_objects.size(); ++objIndex)
     {
         auto& obj = m_objects[objIndex];
-
         const size_t L = obj.lodMeshes.size();
-        obj.lodVertexBuffers.resize(L);
-        obj.lodVertexUploads.resize(L);
-        obj.lodVBs.resize(L);
-        obj.lodIndexBuffers.resize(L);
-        obj.lodIndexUploads.resize(L);
-        obj.lodIBs.resize(L);
 
         m_meshletData[objIndex].resize(L);
+        meshletBlobs[objIndex].resize(L);
+        if (m_packedVertices)
+            m_objectQuant[objIndex] = ComputeVertexQuantization(obj.lodMeshes);
 
-        for (size_t i = 0; i < L; ++i) 
+        for (size_t i = 0; i < L; ++i)
         {
-            obj.CreateBuffersForMesh(
-                m_framework->GetDevice(),
-                m_framework->GetCommandList(),
-                obj.lodMeshes[i],
-                obj.lodVertexBuffers[i],
-                obj.lodVertexUploads[i],
-                obj.lodVBs[i],
-                obj.lodIndexBuffers[i],
-                obj.lodIndexUploads[i],
-                obj.lodIBs[i]
-            );
+            totalVertices += (UINT)obj.lodMeshes[i].vertices.size();
+            if (m_packedVertices && FitsIndex16(obj.lodMeshes[i].vertices.size()))
+                totalIndices16 += (UINT)obj.lodMeshes[i].indices.size();
+            else
+                totalIndices += (UINT)obj.lodMeshes[i].indices.size();
 
-            if (m_framework->IsMeshShaderSupported())
+            if (!m_framework->IsMeshShaderSupported())
+                continue;
+
+            MeshletBlobInfo info;
+            UINT blobWords = 0;
+            if (m_meshCache.IsOpen())
+            {
+                const MeshCacheLodView v = m_meshCache.GetLod((uint32_t)objIndex, (uint32_t)i);
+                info = { v.meshletCount, v.meshletVertexCount, v.meshletPrimCount };
+                blobWords = v.meshletBlobWords;
+            }
+            else if (!obj.lodMeshes[i].indices.empty())
             {
-                MeshletDrawData& md = m_meshletData[objIndex][i];
+                std::vector<uint32_t>& blob = meshletBlobs[objIndex][i];
+                info = BuildMeshletBlob(obj.lodMeshes[i], MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims, blob);
+                blobWords = (UINT)blob.size();
+            }
+            if (info.meshletCount == 0)
+                continue;
 
-                std::vector<uint32_t> idx32;
-                idx32.reserve(obj.lodMeshes[i].indices.size());
-                for (auto v : obj.lodMeshes[i].indices) idx32.push_back((uint32_t)v);
+            MeshletDrawData& md = m_meshletData[objIndex][i];
+            md.meshletCount = info.meshletCount;
+            md.meshletVertexCount = info.vertexCount;
+            md.meshletPrimCount = info.primCount;
+
+            totalData += blobWords + MeshletBlobAlignment - 1;
+        }
+    }
 
-                std::vector<Meshlet> meshlets;
-                std::vector<uint32_t> meshletVerts;
-                std::vector<uint32_t> meshletPrims;
+    // запас на перестройку LOD с другими настройками (RebuildLods)
+    totalVertices += totalVertices / 4;
+    totalIndices += totalIndices / 4;
+    totalIndices16 += totalIndices16 / 4;
+    totalData += totalData / 4;
 
-                BuildMeshlets_Greedy(idx32, 64, 126, meshlets, meshletVerts, meshletPrims);
+    m_geometry.Init(m_framework->GetDevice(), &m_framework->GetStagingPool(), totalVertices, totalIndices, totalData,
+        m_packedVertices, totalIndices16);
+
+    for (size_t objIndex = 0; objIndex < m_objects.size(); ++objIndex)
+    {
+        auto& obj = m_objects[objIndex];
+
+        const size_t L = obj.lodMeshes.size();
+        obj.lodGeometry.resize(L);
 
-                md.meshletCount = (uint32_t)meshlets.size();
+        for (size_t i = 0; i < L; ++i) 
+        {
+            MeshletDrawData& md = m_meshletData[objIndex][i];
+
+            if (m_meshCache.IsOpen())
+            {
+                const MeshCacheLodView v = m_meshCache.GetLod((uint32_t)objIndex, (uint32_t)i);
+                obj.lodGeometry[i] = m_geometry.AddMesh(v.vertices, v.positions, v.vertexCount, v.indices, v.indexCount,
+                    &m_objectQuant[objIndex]);
+                if (md.meshletCount != 0)
+                {
+                    md.geometry = m_geometry.AddData(v.meshletBlob, v.meshletBlobWords, MeshletBlobAlignment);
+                    const MeshletBounds* bounds = reinterpret_cast<const MeshletBounds*>(v.meshletBlob);
+                    md.bounds.assign(bounds, bounds + md.meshletCount);
+                }
+            }
+            else
+            {
+                obj.lodGeometry[i] = m_geometry.AddMesh(obj.lodMeshes[i], &m_objectQuant[objIndex]);
                 if (md.meshletCount != 0)
                 {
-                    if (obj.lodVBs[i].StrideInBytes != sizeof(MeshVertex))
-                        throw std::runtime_error("vertex stride mismatch");
+                    const std::vector<uint32_t>& blob = meshletBlobs[objIndex][i];
+                    md.geometry = m_geometry.AddData(blob.data(), (UINT)blob.size(), MeshletBlobAlignment);
+                    const MeshletBounds* bounds = reinterpret_cast<const MeshletBounds*>(blob.data());
+                    md.bounds.assign(bounds, bounds + md.meshletCount);
+                }
+            }
 
-                    ComPtr<ID3D12Resource> up0, up1, up2;
+            if (md.meshletCount == 0)
+                continue;
 
-                    m_framework->CreateDefaultBuffer(cmd, meshlets.data(),
-                        (UINT64)meshlets.size() * sizeof(Meshlet), md.meshlets, up0);
+            md.srvBase = m_framework->AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 5);
+        }
+    }
 
-                    m_framework->CreateDefaultBuffer(cmd, meshletVerts.data(),
-                        (UINT64)meshletVerts.size() * sizeof(uint32_t), md.meshletVertices, up1);
+    m_geometry.FlushUploads(cmd);
+    // данные уже скопированы в staging; отпускаем файл, чтобы его можно было перезаписать
+    m_meshCache.Close();
+    CreateMeshletViews();
 
-                    m_framework->CreateDefaultBuffer(cmd, meshletPrims.data(),
-                        (UINT64)meshletPrims.size() * sizeof(uint32_t), md.meshletPrims, up2);
+    BuildRaytracingAS();
+}
 
-                    md.srvBase = m_framework->AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 4);
+void RenderingSystem::CreateMeshletViews()
+{
+    // без упаковки шейдер читает Vertex как MeshVertex
+    static_assert(sizeof(MeshVertex) == sizeof(Vertex), "vertex stride mismatch");
 
-                    CreateMeshletSRVs(
-                        m_framework->GetDevice(),
-                        obj.lodVertexBuffers[i].Get(),
-                        md.meshlets.Get(),
-                        md.meshletVertices.Get(),
-                        md.meshletPrims.Get(),
-                        m_framework->GetSrvHeap()->GetCPUDescriptorHandleForHeapStart(),
-                        m_framework->GetSrvDescriptorSize(),
-                        md.srvBase
-                    );
+    for (size_t objIndex = 0; objIndex < m_objects.size(); ++objIndex)
+    {
+        const auto& obj = m_objects[objIndex];
+        for (size_t i = 0; i < m_meshletData[objIndex].size(); ++i)
+        {
+            const MeshletDrawData& md = m_meshletData[objIndex][i];
+            if (md.meshletCount == 0)
+                continue;
 
-                    m_meshletUploads.push_back(up0);
-                    m_meshletUploads.push_back(up1);
-                    m_meshletUploads.push_back(up2);
-                }
+            const GeometryRange& mesh = m_geometry.GetRange(obj.lodGeometry[i]);
+            const GeometryRange& data = m_geometry.GetRange(md.geometry);
+
+            const MeshletBlobInfo info = { md.meshletCount, md.meshletVertexCount, md.meshletPrimCount };
+            const UINT vertsFirst = data.dataOffset + info.VerticesOffset();
+            const UINT primsFirst = data.dataOffset + info.PrimsOffset();
+
+            CreateMeshletSRVs(
+                m_framework->GetDevice(),
+                { m_geometry.GetVertexBuffer(), mesh.baseVertex, mesh.vertexCount },
+                { m_geometry.GetDataBuffer(), (data.dataOffset + info.MeshletsOffset()) / MeshletWords, md.meshletCount },
+                { m_geometry.GetDataBuffer(), vertsFirst, md.meshletVertexCount },
+                { m_geometry.GetDataBuffer(), primsFirst, md.meshletPrimCount },
+                { m_geometry.GetDataBuffer(), data.dataOffset / MeshletBoundsWords, md.meshletCount },
+                m_framework->GetSrvHeap()->GetCPUDescriptorHandleForHeapStart(),
+                m_framework->GetSrvDescriptorSize(),
+                md.srvBase,
+                m_geometry.GetVertexStride()
+            );
+        }
+    }
+}
+
+bool RenderingSystem::AddLodGeometry(size_t objIndex, size_t lod)
+{
+    SceneObject& obj = m_objects[objIndex];
+    MeshletDrawData& md = m_meshletData[objIndex][lod];
+    md = MeshletDrawData();
+
+    // место есть, но раздроблено: сжимаем арену и пробуем ещё раз
+    auto allocate = [&](auto&& add) -> bool
+    {
+        try
+        {
+            add();
+            return true;
+        }
+        catch (const std::runtime_error&)
+        {
+            if (!m_geometry.Defragment(cmd))
+                return false;
+            ++m_geometryDefragCount;
+        }
+        try
+        {
+            add();
+            return true;
+        }
+        catch (const std::runtime_error&)
+        {
+            return false;
+        }
+    };
+
+    if (!allocate([&] { obj.lodGeometry[lod] = m_geometry.AddMesh(obj.lodMeshes[lod], &m_objectQuant[objIndex]); }))
+        return false;
+
+    if (!m_framework->IsMeshShaderSupported() || obj.lodMeshes[lod].indices.empty())
+        return true;
+
+    std::vector<uint32_t> blob;
+    const MeshletBlobInfo info = BuildMeshletBlob(obj.lodMeshes[lod], MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims, blob);
+    if (info.meshletCount == 0)
+        return true;
+
+    if (!allocate([&] { md.geometry = m_geometry.AddData(blob.data(), (UINT)blob.size(), MeshletBlobAlignment); }))
+    {
+        m_geometry.Free(obj.lodGeometry[lod]);
+        return false;
+    }
+
+    md.meshletCount = info.meshletCount;
+    md.meshletVertexCount = info.vertexCount;
+    md.meshletPrimCount = info.primCount;
+    const MeshletBounds* bounds = reinterpret_cast<const MeshletBounds*>(blob.data());
+    md.bounds.assign(bounds, bounds + md.meshletCount);
+    md.srvBase = m_framework->AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 5);
+    return true;
+}
+
+void RenderingSystem::UpdateLodViewSettings()
+{
+    m_lodSettings.screenHeight = static_cast<float>(m_framework->GetHeight());
+    m_lodSettings.fovY = m_fovY;
+}
+
+void RenderingSystem::RebuildLods()
+{
+    // LOD из нескольких файлов задаёт сцена, упрощением строятся только цепочки одного файла
+    if (m_scenePaths.size() != 1)
+        return;
+
+    // прошлые кадры ещё читают старые диапазоны и SRV мешлетов
+    m_framework->WaitForGpu();
+
+    std::vector<ImportedObject> chains(m_objects.size());
+    for (size_t objIndex = 0; objIndex < m_objects.size(); ++objIndex)
+    {
+        SceneObject& obj = m_objects[objIndex];
+        for (size_t i = 1; i < obj.lodGeometry.size(); ++i)
+        {
+            m_geometry.Free(obj.lodGeometry[i]);
+            const MeshletDrawData& md = m_meshletData[objIndex][i];
+            if (md.meshletCount != 0)
+            {
+                m_geometry.Free(md.geometry);
+                m_framework->FreeDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, md.srvBase, 5);
             }
+        }
+        chains[objIndex].lodMeshes = { obj.lodMeshes[0] };
+    }
+
+    UpdateLodViewSettings();
+    GenerateLodChain(chains, m_lodSettings, m_taskPool.get());
 
+    for (size_t objIndex = 0; objIndex < m_objects.size(); ++objIndex)
+    {
+        SceneObject& obj = m_objects[objIndex];
+        ImportedObject& chain = chains[objIndex];
+
+        obj.lodMeshes.resize(1);
+        for (size_t i = 1; i < chain.lodMeshes.size(); ++i)
+            obj.lodMeshes.push_back(std::move(chain.lodMeshes[i]));
+        obj.lodDistances = chain.lodDistances.empty() ? std::vector<float>{ 0.0f } : chain.lodDistances;
+
+        const size_t L = obj.lodMeshes.size();
+        obj.lodGeometry.resize(L);
+        m_meshletData[objIndex].resize(L);
+        for (size_t i = 1; i < L; ++i)
+        {
+            if (AddLodGeometry(objIndex, i))
+                continue;
+            // арена заполнена: объект остаётся с теми LOD, что влезли
+            obj.lodMeshes.resize(i);
+            obj.lodGeometry.resize(i);
+            obj.lodDistances.resize((std::min)(obj.lodDistances.size(), i));
+            m_meshletData[objIndex].resize(i);
+            break;
         }
     }
 
-    BuildRaytracingAS();
+    m_geometry.FlushUploads(cmd);
+    // после Defragment буферы арены новые
+    CreateMeshletViews();
 }
 
 void RenderingSystem::SetLights()
@@ -417,13 +603,30 @@ void RenderingSystem::LoadTextures()
         return false;
         };
 
+    // одна текстура на путь, даже если её используют несколько объектов
+    std::unordered_map<std::wstring, UINT> loaded;
+
     auto safeLoad = [&](const std::string& rel, UINT fallback, UINT onError)->UINT 
         {
         std::filesystem::path full;
         if (makeFullPath(rel, full)) 
         {
-            try { return loader.LoadTexture(device, uploadBatch, m_framework, full.wstring().c_str()); }
-            catch (...) { return onError; }
+            auto it = loaded.find(full.wstring());
+            if (it != loaded.end())
+                return it->second;
+
+            // DDS с мипами от AssetCooker, если она не старше исходника
+            std::error_code ec;
+            const std::filesystem::path cooked = CookedTexturePath(m_meshCache.GetDirectory(), full.wstring());
+            if (std::filesystem::exists(cooked, ec) &&
+                std::filesystem::last_write_time(cooked, ec) >= std::filesystem::last_write_time(full, ec))
+                full = cooked;
+
+            UINT index = onError;
+            try { index = loader.LoadTexture(device, uploadBatch, m_framework, full.wstring().c_str()); }
+            catch (...) {}
+            loaded[full.wstring()] = index;
+            return index;
         }
         return fallback;
         };
@@ -442,16 +645,49 @@ void RenderingSystem::LoadTextures()
     finish.wait();
 }
 
+void RenderingSystem::ReloadTextures()
+{
+    // прошлые кадры могут ещё читать старые SRV
+    m_framework->WaitForGpu();
+
+    const UINT shared[] = { errorTextures.white, errorTextures.roughness, errorTextures.metallic, errorTextures.normal,
+        errorTextures.height, errorTextures.ambientOcclusion, errorTextures.diffuse };
+    std::unordered_set<UINT> released;
+    for (const SceneObject& obj : m_objects)
+    {
+        for (UINT index : obj.texIdx)
+        {
+            if (std::find(std::begin(shared), std::end(shared), index) != std::end(shared))
+                continue;
+            if (released.insert(index).second)
+                loader.ReleaseTexture(m_framework, index);
+        }
+    }
+
+    LoadTextures();
+
+    for (const SceneObject& obj : m_objects)
+    {
+        MaterialCB& m = m_materialTable.Edit(obj.materialIndex);
+        m.diffuseIdx = obj.texIdx[0];
+        m.normalIdx = obj.texIdx[1];
+        m.dispIdx = obj.texIdx[2];
+        m.roughIdx = obj.texIdx[3];
+        m.metalIdx = obj.texIdx[4];
+        m.aoIdx = obj.texIdx[5];
+    }
+}
+
 void RenderingSystem::CreateConstantBuffers()
 {
     auto* device = m_framework->GetDevice();
     CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
 
     {
-        const UINT cbSize = Align256(sizeof(CB));
+        const UINT cbSize = Align256(sizeof(ObjectCB));
         const UINT totalSize = cbSize * static_cast<UINT>(m_objects.size());
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_constantBuffer)));
         CD3DX12_RANGE rr(0, 0);
@@ -462,7 +698,7 @@ void RenderingSystem::CreateConstantBuffers()
         const UINT cbSize = Align256(sizeof(LightCB));
         const UINT totalSize = cbSize * static_cast<UINT>(lights.size());
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_lightBuffer)));
         CD3DX12_RANGE rr(0, 0);
@@ -472,7 +708,7 @@ void RenderingSystem::CreateConstantBuffers()
     {
         const UINT totalSize = Align256(sizeof(AmbientCB));
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_ambientBuffer)));
         CD3DX12_RANGE rr(0, 0);
@@ -481,9 +717,9 @@ void RenderingSystem::CreateConstantBuffers()
 
     {
         const UINT cbSize = Align256(sizeof(MaterialCB));
-        const UINT totalSize = cbSize * static_cast<UINT>(m_objects.size());
+        const UINT totalSize = cbSize * static_cast<UINT>(std::max<size_t>(m_materialTable.Size(), 1));
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_materialBuffer)));
         CD3DX12_RANGE rr(0, 0);
@@ -493,7 +729,7 @@ void RenderingSystem::CreateConstantBuffers()
     {
         const UINT totalSize = Align256(sizeof(TessCB));
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_tessBuffer)));
         CD3DX12_RANGE rr(0, 0);
@@ -501,15 +737,41 @@ void RenderingSystem::CreateConstantBuffers()
     }
 
     {
-        const UINT cbSize = Align256(sizeof(CB));
-        const UINT totalSize = cbSize * static_cast<UINT>(m_objects.size()) * CSM_CASCADES;
+        // [0] - камера, [1 + ci] - каскады теней
+        const UINT cbSize = Align256(sizeof(PassCB));
+        const UINT totalSize = cbSize * (1 + CSM_CASCADES);
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
-        ThrowIfFailed(m_framework->GetDevice()->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_shadowBuffer)));
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_passBuffer)));
         CD3DX12_RANGE rr(0, 0);
-        m_shadowBuffer->Map(0, &rr, reinterpret_cast<void**>(&m_pShadowCbData));
+        m_passBuffer->Map(0, &rr, reinterpret_cast<void**>(&m_pPassData));
+    }
+
+    if (m_framework->IsMeshShaderSupported())
+    {
+        const UINT listBytes = (std::max)(1u, m_meshletCullCapacity) * sizeof(uint32_t);
+
+        const UINT cbSize = Align256(sizeof(MeshletCullConstants));
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(cbSize * (std::max)<UINT>(1, (UINT)m_objects.size()));
+        ThrowIfFailed(m_framework->CreateResource(
+            &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_meshletCullBuffer)));
+        CD3DX12_RANGE rr(0, 0);
+        m_meshletCullBuffer->Map(0, &rr, reinterpret_cast<void**>(&m_pMeshletCullData));
+
+        desc = CD3DX12_RESOURCE_DESC::Buffer(listBytes);
+        ThrowIfFailed(m_framework->CreateResource(
+            &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_meshletListBuffer)));
+        m_meshletListBuffer->Map(0, &rr, reinterpret_cast<void**>(&m_pMeshletListData));
+
+        CD3DX12_HEAP_PROPERTIES heapDefault(D3D12_HEAP_TYPE_DEFAULT);
+        desc = CD3DX12_RESOURCE_DESC::Buffer(listBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        ThrowIfFailed(m_framework->CreateResource(
+            &heapDefault, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&m_meshletVisibility)));
+        m_meshletVisibilityState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
     }
 
     {
@@ -517,7 +779,7 @@ void RenderingSystem::CreateConstantBuffers()
         auto* device = m_framework->GetDevice();
         CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
         auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_postBuffer)
         ));
@@ -532,7 +794,7 @@ void RenderingSystem::CreateConstantBuffers()
 
         CD3DX12_HEAP_PROPERTIES uploadHeap(D3D12_HEAP_TYPE_UPLOAD);
         CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(previewSize);
-        ThrowIfFailed(m_framework->GetDevice()->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &uploadHeap, D3D12_HEAP_FLAG_NONE, &bufferDesc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_previewBuffer)
         ));
@@ -542,7 +804,7 @@ void RenderingSystem::CreateConstantBuffers()
     {
         const UINT totalSize = Align256(sizeof(TAACB));
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_taaCB)));
         CD3DX12_RANGE rr(0, 0);
@@ -552,7 +814,7 @@ void RenderingSystem::CreateConstantBuffers()
     {
         const UINT totalSize = Align256(sizeof(MotionBlurCBData));
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_motionBlurCB)));
         CD3DX12_RANGE rr(0, 0);
@@ -563,7 +825,7 @@ void RenderingSystem::CreateConstantBuffers()
         const UINT totalSize = Align256(sizeof(AnimCBData));
         const auto desc = CD3DX12_RESOURCE_DESC::Buffer(totalSize);
 
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_animBuffer)));
 
@@ -576,6 +838,9 @@ void RenderingSystem::Initialize()
 {
     cmd = m_framework->GetCommandList();
 
+    m_taskPool = std::make_unique<TaskPool>();
+    m_pipeline.SetTaskPool(m_taskPool.get());
+    m_pipeline.SetPackedVertices(m_packedVertices);
     m_pipeline.Init();
 
     m_gbuffer = std::make_unique<GBuffer>(
@@ -630,16 +895,26 @@ void RenderingSystem::Initialize()
     m_depthWidth = static_cast<UINT>(depthDesc.Width);
     m_depthHeight = depthDesc.Height;
 
-    D3D12_RESOURCE_DESC stagingDesc = CD3DX12_RESOURCE_DESC::Buffer(m_depthWidth * m_depthHeight * sizeof(float));
-    auto* device = m_framework->GetDevice();
-    CD3DX12_HEAP_PROPERTIES properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
-    ThrowIfFailed(device->CreateCommittedResource(
-        &properties,
-        D3D12_HEAP_FLAG_NONE,
-        &stagingDesc,
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(&m_depthStaging)));
+    {
+        // глубина копируется целиком (depth-stencil иначе нельзя), места - на MaxDepthReadbacks копий
+        UINT64 depthBytes = 0;
+        m_framework->GetDevice()->GetCopyableFootprints(&depthDesc, 0, 1, 0, nullptr, nullptr, nullptr, &depthBytes);
+        const UINT64 align = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+        depthBytes = (depthBytes + align - 1) / align * align;
+
+        // объект рисуется за кадр одним LOD, поэтому флагов видимости - на самый подробный
+        m_meshletCullCapacity = 0;
+        for (const auto& lods : m_meshletData)
+        {
+            uint32_t maxCount = 0;
+            for (const MeshletDrawData& md : lods)
+                maxCount = (std::max)(maxCount, md.meshletCount);
+            m_meshletCullCapacity += maxCount;
+        }
+        // сверка отсечения мешлетов: прошлая глубина и флаги видимости
+        const UINT64 cullCheckBytes = depthBytes + (UINT64)m_meshletCullCapacity * sizeof(uint32_t);
+        m_framework->GetReadback().Reserve(depthBytes * MaxDepthReadbacks + cullCheckBytes + ReadbackManager::DefaultSize);
+    }
 
     {
         using DirectX::ResourceUploadBatch;
@@ -719,7 +994,7 @@ void RenderingSystem::Initialize()
         D3D12_CLEAR_VALUE cv{}; cv.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
         cv.Color[0] = cv.Color[1] = cv.Color[2] = 0.0f; cv.Color[3] = 0.0f;
 
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapDefault, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
             &cv, IID_PPV_ARGS(&m_lightAccum)
@@ -774,13 +1049,13 @@ void RenderingSystem::Initialize()
         ldrClear.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
         ldrClear.Color[0] = ldrClear.Color[1] = ldrClear.Color[2] = 0.0f; ldrClear.Color[3] = 1.0f;
 
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapDefault, D3D12_HEAP_FLAG_NONE, &ldrDesc,
             D3D12_RESOURCE_STATE_RENDER_TARGET, 
             &ldrClear,
             IID_PPV_ARGS(&m_postA)));
 
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapDefault, D3D12_HEAP_FLAG_NONE, &ldrDesc,
             D3D12_RESOURCE_STATE_RENDER_TARGET,
             &ldrClear,
@@ -832,7 +1107,7 @@ void RenderingSystem::Initialize()
         cv.Format = DXGI_FORMAT_R16G16_FLOAT;
         cv.Color[0] = cv.Color[1] = cv.Color[2] = 0.0f; cv.Color[3] = 0.0f;
 
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapDefault, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_RENDER_TARGET,
             &cv,
@@ -884,11 +1159,11 @@ void RenderingSystem::Initialize()
         ldrClear.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
         ldrClear.Color[0] = ldrClear.Color[1] = ldrClear.Color[2] = 0.0f; ldrClear.Color[3] = 1.0f;
 
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapDefault, D3D12_HEAP_FLAG_NONE, &ldrDesc,
             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, &ldrClear, IID_PPV_ARGS(&m_historyA)));
 
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapDefault, D3D12_HEAP_FLAG_NONE, &ldrDesc,
             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, &ldrClear, IID_PPV_ARGS(&m_historyB)));
         
@@ -939,7 +1214,7 @@ void RenderingSystem::Initialize()
 
         CD3DX12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 
-        ThrowIfFailed(device->CreateCommittedResource(
+        ThrowIfFailed(m_framework->CreateResource(
             &heapProperties, D3D12_HEAP_FLAG_NONE,
             &prevDepthDesc, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, nullptr,
             IID_PPV_ARGS(&m_prevDepth)));
@@ -958,11 +1233,57 @@ void RenderingSystem::Initialize()
         m_prevDepthSRV = CD3DX12_GPU_DESCRIPTOR_HANDLE(srvGPU0, m_prevDepthSrvIndex, srvInc);
     }
 
+    if (m_framework->IsMeshShaderSupported())
+    {
+        // пирамида максимумов прошлой глубины для отсечения мешлетов, размеры как в BuildHiZPyramid
+        auto* device = m_framework->GetDevice();
+        const UINT width = m_depthWidth;
+        const UINT height = m_depthHeight;
+        m_hizMips = HiZMipCount(width, height);
+        CD3DX12_RESOURCE_DESC hizDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT,
+            (std::max)(1u, width / 2), (std::max)(1u, height / 2), 1, (UINT16)m_hizMips, 1, 0,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+        ThrowIfFailed(m_framework->CreateResource(
+            &heapProperties, D3D12_HEAP_FLAG_NONE,
+            &hizDesc, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, nullptr,
+            IID_PPV_ARGS(&m_hiz)));
+        m_hiz->SetName(L"HiZ");
+
+        m_hizDescBase = m_framework->AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1 + 2 * m_hizMips);
+        auto srvCPU0 = m_framework->GetSrvHeap()->GetCPUDescriptorHandleForHeapStart();
+        UINT srvInc = m_framework->GetSrvDescriptorSize();
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srv{};
+        srv.Format = DXGI_FORMAT_R32_FLOAT;
+        srv.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        srv.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srv.Texture2D.MipLevels = m_hizMips;
+        device->CreateShaderResourceView(m_hiz.Get(), &srv,
+            CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCPU0, m_hizDescBase, srvInc));
+
+        for (UINT m = 0; m < m_hizMips; ++m)
+        {
+            srv.Texture2D.MostDetailedMip = m;
+            srv.Texture2D.MipLevels = 1;
+            device->CreateShaderResourceView(m_hiz.Get(), &srv,
+                CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCPU0, m_hizDescBase + 1 + m, srvInc));
+
+            D3D12_UNORDERED_ACCESS_VIEW_DESC uav{};
+            uav.Format = DXGI_FORMAT_R32_FLOAT;
+            uav.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+            uav.Texture2D.MipSlice = m;
+            device->CreateUnorderedAccessView(m_hiz.Get(), nullptr, &uav,
+                CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCPU0, m_hizDescBase + 1 + m_hizMips + m, srvInc));
+        }
+    }
+
     m_postA->SetName(L"PostA");
     m_postB->SetName(L"PostB");
     m_velocity->SetName(L"VelocityRT");
     m_lightAccum->SetName(L"LightAccumHDR");
 
+    BuildMaterialTable();
     CreateConstantBuffers();    
 
     {
@@ -981,8 +1302,9 @@ void RenderingSystem::Initialize()
     }
 
     m_particles = std::make_unique<ParticleSystem>(m_framework, &m_pipeline);
-    UINT particles = 1;
-    m_particles->Initialize(particles, particles);
+    // общий пул для всех эмиттеров; начальный выброс - одна частица, как раньше
+    const UINT maxParticles = 1u << 18;
+    m_particles->Initialize(maxParticles, 1);
 
     m_particles->EnableDepthCollisions
     (
@@ -996,6 +1318,9 @@ void RenderingSystem::Initialize()
         m_resetHistory = true;
         m_taaFrameIndex = 0;
     }
+
+    // стартовые загрузки выполнены, большие staging-буферы больше не нужны
+    m_framework->GetStagingPool().Trim();
 }
 
 void RenderingSystem::Update(float)
@@ -1083,6 +1408,7 @@ void RenderingSystem::Render()
     ImGui_ImplDX12_NewFrame();
     ImGui_ImplWin32_NewFrame();
     ImGui::NewFrame();
+    ResolveMeshletCullValidation();
     UpdateUI();
 
     m_prevViewProj_NoJitter = m_viewProj_NoJitter;
@@ -1111,6 +1437,7 @@ void RenderingSystem::Render()
     }
 
     ShadowPass();
+    BuildHiZ();
 
     m_gbuffer->Bind(cmd);
     const float clearG[4] = { 0.2f, 0.2f, 1.0f, 0.0f };
@@ -1121,24 +1448,19 @@ void RenderingSystem::Render()
 
     UpdateRaytracingTLAS();
 
-    UpdateTerrainBrush(cmd, dt);
+    UpdateTerrainBrush(dt);
+    UploadDirtyHeightRegions(cmd);
 
     TerrainPass();
 
+    if (m_brush.painting && m_depthReadbacks.size() < MaxDepthReadbacks)
     {
-        D3D12_RESOURCE_DESC depthDesc = m_gbuffer->GetDepthResource()->GetDesc();
-        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
-        UINT numRows;
-        UINT64 rowSize;
-        m_framework->GetDevice()->GetCopyableFootprints(&depthDesc, 0, 1, 0, &footprint, &numRows, &rowSize, nullptr);
-        m_depthRowPitch = rowSize;
-
         auto toCopySrc = CD3DX12_RESOURCE_BARRIER::Transition(m_gbuffer->GetDepthResource(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_COPY_SOURCE);
         cmd->ResourceBarrier(1, &toCopySrc);
 
-        CD3DX12_TEXTURE_COPY_LOCATION src(m_gbuffer->GetDepthResource(), 0);
-        CD3DX12_TEXTURE_COPY_LOCATION dst(m_depthStaging.Get(), footprint);
-        cmd->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        ReadbackTicket ticket = m_framework->GetReadback().EnqueueTexture(cmd, m_gbuffer->GetDepthResource(), 0);
+        if (ticket != InvalidReadbackTicket)
+            m_depthReadbacks.push_back(ticket);
 
         auto toDepthWrite = CD3DX12_RESOURCE_BARRIER::Transition(m_gbuffer->GetDepthResource(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
         cmd->ResourceBarrier(1, &toDepthWrite);
@@ -1167,8 +1489,6 @@ void RenderingSystem::Render()
     ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), cmd);
 
         m_framework->EndFrame();
-
-    m_transientUploads.clear();
 }
 
 void RenderingSystem::UpdateUI()
@@ -1189,9 +1509,208 @@ void RenderingSystem::UpdateUI()
         ImGui::Text("Frame: %d", m_frameIndex);
 
         ImGui::Text("draw: %d | mesh: %d", drawIndexedCount, meshDispatchCount);
+        ImGui::Text("state calls: %d | elided: %d", stateCallsIssued, stateCallsElided);
+        ImGui::Text("object CB uploads: %d | materials: %d", m_objectCBUploads, (int)m_materialTable.Size());
+        if (ImGui::Button("Geometry frame benchmark"))
+        {
+            // кадр GeometryPass без GPU: 4096 объектов, 256 кадров на каждый путь отсечения
+            m_geometryFrameBenchResults.clear();
+            for (MeshletCullPath path : { MeshletCullPath::Off, MeshletCullPath::Amplification, MeshletCullPath::CpuList })
+                m_geometryFrameBenchResults.push_back(RunGeometryFrameBenchmark(4096, 256, path));
+        }
+        for (const GeometryFrameBenchmarkResult& r : m_geometryFrameBenchResults)
+        {
+            static const char* paths[] = { "no cull", "AS cull", "CPU cull" };
+            ImGui::Text("%s: %.3f ms/frame (octree %.3f, CB %.3f, items %.3f, record %.3f), %llu visible/frame, %zu KB stream",
+                paths[(int)r.cullPath], r.MsPerFrame(r.TotalMs()), r.MsPerFrame(r.extractMs), r.MsPerFrame(r.packMs),
+                r.MsPerFrame(r.buildMs), r.MsPerFrame(r.recordMs), (unsigned long long)(r.frames ? r.visible / r.frames : 0), r.streamBytes / 1024);
+        }
+        ImGui::Text("geometry verts: %u / %u | frag: %.2f | index frag: %.2f | defrags: %u",
+            m_geometry.GetVertexAllocator().GetUsed(), m_geometry.GetVertexAllocator().GetCapacity(),
+            m_geometry.GetVertexAllocator().GetFragmentation(), m_geometry.GetIndexAllocator().GetFragmentation(),
+            m_geometryDefragCount);
+        ImGui::SliderFloat("LOD max error", &m_lodSettings.simplify.maxError, 0.001f, 0.2f, "%.3f", ImGuiSliderFlags_Logarithmic);
+        ImGui::SliderFloat("LOD pixel error", &m_lodSettings.pixelError, 0.25f, 8.0f);
+        if (ImGui::Button("Rebuild LODs"))
+        {
+            RebuildLods();
+        }
+
+        const StagingPool& staging = m_framework->GetStagingPool();
+        ImGui::Text("staging MB: %.1f (peak %.1f) | in flight: %.1f | reused: %u / %u",
+            staging.GetResidentBytes() / 1048576.0, staging.GetPeakResidentBytes() / 1048576.0,
+            staging.GetInFlightBytes() / 1048576.0, staging.GetReusedCount(),
+            staging.GetReusedCount() + staging.GetCreatedCount());
+
+        const GpuMemoryBudget mem = m_framework->GetHeapAllocator().GetBudget();
+        ImGui::Text("heaps: %u | placed: %u | committed: %u", mem.heapBlocks, mem.placedResources, mem.committedFallbacks);
+        ImGui::Text("heap MB: %.1f / %.1f | VRAM MB: %.1f / %.1f",
+            mem.usedBytes / 1048576.0, mem.reservedBytes / 1048576.0,
+            mem.currentUsage / 1048576.0, mem.budget / 1048576.0);
+
+        const DescriptorAllocator& srvAlloc = m_framework->GetSrvAllocator();
+        ImGui::Text("SRV heap: %u / %u | high water: %u | largest free: %u | transient: %u / %u",
+            srvAlloc.GetPersistentUsed(), srvAlloc.GetPersistentCapacity(), srvAlloc.GetHighWaterMark(),
+            srvAlloc.GetLargestFreeBlock(), srvAlloc.GetTransientUsed(), srvAlloc.GetTransientCapacity());
+        if (ImGui::Button("Reload textures"))
+        {
+            ReloadTextures();
+        }
+
+        ImGui::Text("scene load: %.1f ms (%s)", m_sceneLoadMs, m_sceneFromCache ? "mesh cache" : "OBJ");
+        const ShaderCompileStats& shaderStats = m_pipeline.GetCompileStats();
+        ImGui::Text("shaders: %zu in %.1f ms | from DXIL cache: %zu | compiled: %zu",
+            shaderStats.shaders, shaderStats.ms, shaderStats.fromCache, shaderStats.compiled);
+        if (ImGui::Button("Shader cache benchmark"))
+        {
+            m_shaderCacheBenchResults.clear();
+            m_shaderCacheBenchResults.push_back(m_pipeline.RunShaderCacheBenchmark());
+        }
+        for (const ShaderCacheBenchmarkResult& r : m_shaderCacheBenchResults)
+        {
+            ImGui::Text("%zu shaders on %u threads: cold %.1f ms, warm %.1f ms (%zu from cache)",
+                r.shaders, r.threads, r.coldMs, r.warmMs, r.warmFromCache);
+        }
+        if (ImGui::Button("Mesh cache benchmark"))
+        {
+            m_meshCacheBenchResults.clear();
+            m_meshCacheBenchResults.push_back(RunMeshCacheBenchmark(m_scenePaths, m_sceneLodDistances, m_lodSettings));
+        }
+        for (const MeshCacheBenchmarkResult& r : m_meshCacheBenchResults)
+        {
+            ImGui::Text("%u objects, %.1f MB: cold %.1f ms, cached %.1f ms, %s",
+                r.objects, r.fileBytes / 1048576.0, r.coldMs, r.cachedMs, r.matches ? "match" : "MISMATCH");
+        }
+
+        // первый запуск пишет ~850 МБ OBJ в MeshCache
+        if (ImGui::Button("OBJ parse benchmark (10M tris)"))
+        {
+            m_objParseBenchResults.clear();
+            m_objParseBenchResults.push_back(RunObjParseBenchmark("MeshCache\\objparse_10M.obj", 10000000, m_taskPool.get()));
+        }
+        for (const ObjParseBenchmarkResult& r : m_objParseBenchResults)
+        {
+            ImGui::Text("%.0f MB, %.1f M tris: tinyobj %.0f ms, 1 thread %.0f ms, %u threads %.0f ms, %s",
+                r.fileBytes / 1048576.0, r.triangles / 1e6, r.tinyobjMs, r.singleMs, r.threads, r.parallelMs,
+                r.matches ? "match" : "MISMATCH");
+        }
+
+        if (ImGui::Button("Vertex weld benchmark") && !m_scenePaths.empty())
+        {
+            m_vertexWeldBenchResults.clear();
+            m_vertexWeldBenchResults.push_back(RunVertexWeldBenchmark(m_scenePaths[0]));
+        }
+        for (const VertexWeldBenchmarkResult& r : m_vertexWeldBenchResults)
+        {
+            ImGui::Text("%zu corners -> %zu verts: unordered_map %.1f ms ~%.1f MB, table %.1f ms %.1f MB, %s",
+                r.corners, r.vertices, r.unorderedMapMs, r.unorderedMapBytes / 1048576.0,
+                r.tableMs, r.tableBytes / 1048576.0, r.matches ? "match" : "MISMATCH");
+        }
+
+        ImGui::Text("vertex format: %s", m_packedVertices ? "packed 20 B" : "float 48 B");
+        if (ImGui::Button("Vertex pack test"))
+        {
+            m_vertexPackResults.clear();
+            m_vertexPackResults.push_back(RunVertexPackSelfTest());
+            VertexPackStats scene;
+            for (const SceneObject& obj : m_objects)
+                scene += MeasureVertexPacking(obj.lodMeshes);
+            m_vertexPackResults.push_back(scene);
+        }
+        for (const VertexPackStats& r : m_vertexPackResults)
+        {
+            ImGui::Text("%zu verts, %.1f -> %.1f MB, pack %.1f ms: pos %.3f step, N %.4f deg, T %.4f deg, uv %.1e, %zu flips, %zu mismatches",
+                r.vertices, r.floatBytes / 1048576.0, r.packedBytes / 1048576.0, r.packMs,
+                r.maxPositionError, r.maxNormalDeg, r.maxTangentDeg, r.maxUvError,
+                r.handednessFlips, r.roundTripMismatches);
+        }
+
+        if (ImGui::Button("Meshlet builder comparison"))
+        {
+            MeshletBuilderComparison scene;
+            for (const SceneObject& obj : m_objects)
+            {
+                for (const Mesh& mesh : obj.lodMeshes)
+                {
+                    const MeshletBuilderComparison c = CompareMeshletBuilders(mesh, MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims);
+                    scene.greedy += c.greedy;
+                    scene.clustered += c.clustered;
+                    scene.valid = scene.valid && c.valid;
+                }
+            }
+            m_meshletBuilderResults.push_back(scene);
+        }
+        for (const MeshletBuilderComparison& r : m_meshletBuilderResults)
+        {
+            const MeshletStats* stats[2] = { &r.greedy, &r.clustered };
+            const char* names[2] = { "greedy", "clustered" };
+            for (int k = 0; k < 2; ++k)
+            {
+                const MeshletStats& s = *stats[k];
+                ImGui::Text("%s: %zu meshlets, %.3f verts/tri, fill V %.2f P %.2f, cones %zu, R %.3f, %.1f ms",
+                    names[k], s.meshlets, s.VertsPerTri(), s.VertexFill(), s.PrimFill(),
+                    s.cullableCones, s.AvgRadius(), s.buildMs);
+            }
+            ImGui::Text("%s", r.valid ? "valid" : "INVALID");
+        }
 
         ImGui::Checkbox("Draw", &tmp);
 
+        int cullPath = (int)m_meshletCullPath;
+        ImGui::RadioButton("No meshlet cull", &cullPath, (int)MeshletCullPath::Off); ImGui::SameLine();
+        ImGui::RadioButton("AS cull", &cullPath, (int)MeshletCullPath::Amplification); ImGui::SameLine();
+        ImGui::RadioButton("CPU cull", &cullPath, (int)MeshletCullPath::CpuList);
+        m_meshletCullPath = (MeshletCullPath)cullPath;
+        ImGui::Checkbox("Cull frustum", &m_meshletCullFrustum); ImGui::SameLine();
+        ImGui::Checkbox("Cull cone", &m_meshletCullCone); ImGui::SameLine();
+        ImGui::Checkbox("Cull HiZ", &m_meshletCullOcclusion);
+        if (m_meshletCullPath == MeshletCullPath::CpuList)
+        {
+            const MeshletCullStats& s = m_geometryFrame.cullStats;
+            ImGui::Text("Meshlets: %zu tested, %zu visible, frustum %zu, cone %zu",
+                s.tested, s.visible, s.frustum, s.cone);
+        }
+
+        if (ImGui::Button("Meshlet cull self-test"))
+        {
+            m_meshletCullSelfTests.push_back(RunMeshletCullSelfTest());
+        }
+        for (const MeshletCullSelfTest& r : m_meshletCullSelfTests)
+        {
+            ImGui::Text("%zu checks, %zu failures: visible %zu, frustum %zu, cone %zu, occluded %zu",
+                r.checks, r.failures, r.stats.visible, r.stats.frustum, r.stats.cone, r.stats.occluded);
+        }
+
+        if (ImGui::Button("Meshlet cull benchmark"))
+        {
+            std::vector<Mesh> meshes;
+            for (const SceneObject& obj : m_objects)
+            {
+                if (!obj.lodMeshes.empty())
+                    meshes.push_back(obj.lodMeshes[0]);
+            }
+            m_meshletCullBenchResults.push_back(BenchmarkMeshletCulling(meshes, 8));
+        }
+        for (const MeshletCullBenchmarkResult& r : m_meshletCullBenchResults)
+        {
+            const MeshletCullStats& s = r.stats;
+            ImGui::Text("%zu meshlets in %u views: visible %zu, frustum %zu, cone %zu, occluded %zu; HiZ %.2f ms/view",
+                s.tested, r.views, s.visible, s.frustum, s.cone, s.occluded,
+                r.views ? r.hizBuildMs / r.views : 0.0);
+            ImGui::Text("  ns/meshlet: frustum %.1f, cone %.1f, HiZ %.1f, all %.1f",
+                r.NsPerMeshlet(r.frustumMs), r.NsPerMeshlet(r.coneMs), r.NsPerMeshlet(r.occlusionMs), r.NsPerMeshlet(r.cullMs));
+        }
+
+        if (ImGui::Button("Validate meshlet culling"))
+        {
+            m_meshletCullValidateRequested = true;
+        }
+        for (const MeshletCullValidation& r : m_meshletCullValidation)
+        {
+            ImGui::Text("%zu meshlets: GPU %zu visible, CPU %zu, %zu mismatches%s",
+                r.meshlets, r.gpuVisible, r.cpuVisible, r.mismatches, r.occlusion ? ", with HiZ" : "");
+        }
+
         ImGui::End();
     }
 
@@ -1381,6 +1900,88 @@ void RenderingSystem::UpdateUI()
             
         ImGui::End();
     }
+
+    {
+        ImGui::Begin("Particles");
+
+        ParticleEmitterPool& pool = m_particles->GetEmitters();
+        ImGui::Text("Alive %u / %u, reserved %u", pool.GetAliveCount(), pool.GetCapacity(), pool.GetRanges().GetUsed());
+
+        int budget = (int)pool.GetGlobalBudget();
+        if (ImGui::SliderInt("Budget", &budget, 0, (int)pool.GetCapacity()))
+        {
+            pool.SetGlobalBudget((uint32_t)budget);
+        }
+
+        ImGui::SliderFloat("Spawn rate", &m_newEmitterRate, 100.0f, 20000.0f, "%.0f");
+        if (ImGui::Button("Add emitter"))
+        {
+            ParticleEmitterDesc desc;
+            desc.position = {
+                cameraPos.x + 30.0f * cosf(m_pitch) * sinf(m_yaw),
+                cameraPos.y + 30.0f * sinf(m_pitch),
+                cameraPos.z + 30.0f * cosf(m_pitch) * cosf(m_yaw) };
+            desc.initialSpeed = 8.0f;
+            desc.lifetime = 5.0f;
+            desc.spawnRate = m_newEmitterRate;
+            m_particles->AddEmitter(desc);
+        }
+
+        for (ParticleEmitterId id : pool.GetEmitterIds())
+        {
+            ImGui::PushID((int)id);
+            ImGui::Text("#%u: alive %u / %u, scale %.2f, importance %.3f%s", id,
+                pool.GetAliveCount(id), pool.GetRangeSize(id), pool.GetSpawnScale(id), pool.GetImportance(id),
+                pool.IsVisible(id) ? "" : " (culled)");
+            if (pool.Exists(id))
+            {
+                ImGui::SameLine();
+                if (ImGui::SmallButton("Remove"))
+                    m_particles->RemoveEmitter(id);
+            }
+            ImGui::PopID();
+        }
+
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("CPU Particles");
+
+        ImGui::SliderInt("Particles", &m_cpuBenchParticles, 100000, 8000000);
+        if (ImGui::Button("Benchmark"))
+        {
+            const uint32_t count = (uint32_t)m_cpuBenchParticles;
+            m_cpuBenchResults.clear();
+            m_cpuBenchResults.push_back(RunCpuParticleBenchmark(count, 30, nullptr, false));
+            m_cpuBenchResults.push_back(RunCpuParticleBenchmark(count, 30, nullptr, true));
+            m_cpuBenchResults.push_back(RunCpuParticleBenchmark(count, 30, m_taskPool.get(), true));
+        }
+
+        for (const CpuParticleBenchmarkResult& r : m_cpuBenchResults)
+        {
+            ImGui::Text("%u threads, %s: %.2f ms/frame, %.1f M particles/s",
+                r.threads, r.simd ? "AVX" : "scalar", r.msPerFrame, r.particlesPerSecond / 1e6);
+        }
+
+        if (ImGui::Button("Sort benchmark"))
+        {
+            const uint32_t count = (uint32_t)m_cpuBenchParticles;
+            m_sortBenchResults.clear();
+            m_sortBenchResults.push_back(RunRadixSortBenchmark(count, nullptr));
+            m_sortBenchResults.push_back(RunRadixSortBenchmark(count, m_taskPool.get()));
+        }
+
+        for (const RadixSortBenchmarkResult& r : m_sortBenchResults)
+        {
+            ImGui::Text("%u keys, %u threads: radix %.2f ms, std::sort %.2f ms, %s",
+                r.count, r.threads, r.radixMs, r.stdSortMs, r.matchesStdSort ? "match" : "MISMATCH");
+            ImGui::Text("  draw order: radix %.2f ms, std::stable_sort %.2f ms, %s",
+                r.drawOrderMs, r.drawOrderStdMs, r.drawOrderMatches ? "match" : "MISMATCH");
+        }
+
+        ImGui::End();
+    }
 }
 
 void RenderingSystem::BuildViewProj()
@@ -1401,7 +2002,7 @@ void RenderingSystem::BuildViewProj()
     const float h = static_cast<float>(m_framework->GetHeight());
     const float aspect = w / h;
 
-    XMMATRIX P = XMMatrixPerspectiveFovLH(XM_PIDIV4, aspect, m_near, m_far);
+    XMMATRIX P = XMMatrixPerspectiveFovLH(m_fovY, aspect, m_near, m_far);
 
     m_viewProj_NoJitter = view * proj;
     m_invViewProj_NoJitter = XMMatrixInverse(nullptr, m_viewProj_NoJitter);
@@ -1450,61 +2051,68 @@ void RenderingSystem::UpdateTessellationCB()
 
 void RenderingSystem::ExtractVisibleObjects()
 {
-    XMFLOAT4 planes[6];
-    ExtractFrustumPlanes(planes, viewProj);
-
-    m_visibleObjects.clear();
-    if (!m_octree) return;
-
-    std::vector<void*> hits;
-    m_octree->QueryFrustum(planes, hits);
-
-    for (void* p : hits)
-    {
-        m_visibleObjects.push_back(reinterpret_cast<SceneObject*>(p));
-    }
+    QueryVisibleObjects(m_octree.get(), viewProj, m_visibleObjects);
 }
 
-void RenderingSystem::UpdatePerObjectCBs()
+void RenderingSystem::BuildMaterialTable()
 {
-    const UINT cbSize = Align256(sizeof(CB));
-    const UINT materialSize = Align256(sizeof(MaterialCB));
-
-    CB cb{};
-    MaterialCB mcb{};
-
-    for (size_t i = 0; i < m_visibleObjects.size(); ++i) {
-        const SceneObject* obj = m_visibleObjects[i];
-
-        const XMMATRIX world = obj->GetWorldMatrix();
-        XMStoreFloat4x4(&cb.World, world);
-        XMStoreFloat4x4(&cb.ViewProj, viewProj);
+    m_materialTable.Clear();
 
+    for (SceneObject& obj : m_objects)
+    {
+        MaterialCB mcb{};
         mcb.useNormalMap = m_useNormalMap;
-        mcb.diffuseIdx = obj->texIdx[0];
-        mcb.normalIdx = obj->texIdx[1];
-        mcb.dispIdx = obj->texIdx[2];
-        mcb.roughIdx = obj->texIdx[3];
-        mcb.metalIdx = obj->texIdx[4];
-        mcb.aoIdx = obj->texIdx[5];
-
-        mcb.hasDiffuseMap = obj->material.diffuseTexPath.empty() ? 0u : 1u;
-        mcb.hasRoughMap = obj->material.roughnessTexPath.empty() ? 0u : 1u;
-        mcb.hasMetalMap = obj->material.metallicTexPath.empty() ? 0u : 1u;
-        mcb.hasAOMap = obj->material.aoTexPath.empty() ? 0u : 1u;
+        mcb.diffuseIdx = obj.texIdx[0];
+        mcb.normalIdx = obj.texIdx[1];
+        mcb.dispIdx = obj.texIdx[2];
+        mcb.roughIdx = obj.texIdx[3];
+        mcb.metalIdx = obj.texIdx[4];
+        mcb.aoIdx = obj.texIdx[5];
+
+        mcb.hasDiffuseMap = obj.material.diffuseTexPath.empty() ? 0u : 1u;
+        mcb.hasRoughMap = obj.material.roughnessTexPath.empty() ? 0u : 1u;
+        mcb.hasMetalMap = obj.material.metallicTexPath.empty() ? 0u : 1u;
+        mcb.hasAOMap = obj.material.aoTexPath.empty() ? 0u : 1u;
 
         mcb.useRoughMap = m_useRoughMapUI ? 1u : 0u;
         mcb.useMetalMap = m_useMetalMapUI ? 1u : 0u;
         mcb.useAOMap = m_useAOMapUI ? 1u : 0u;
 
-        mcb.baseColor = { obj->material.diffuse.x,
-                          obj->material.diffuse.y,
-                          obj->material.diffuse.z,
+        mcb.baseColor = { obj.material.diffuse.x,
+                          obj.material.diffuse.y,
+                          obj.material.diffuse.z,
                           1.0f };
 
-        memcpy(m_pCbData + static_cast<UINT>(i) * cbSize, &cb, sizeof(cb));
-        memcpy(m_pMaterialData + static_cast<UINT>(i) * materialSize, &mcb, sizeof(mcb));
+        obj.materialIndex = m_materialTable.Add(mcb);
+    }
+
+    m_materialFlags = { m_useNormalMap, m_useRoughMapUI, m_useMetalMapUI, m_useAOMapUI };
+    m_objectWorlds.clear();
+}
+
+void RenderingSystem::UpdatePerObjectCBs()
+{
+    const UINT cbSize = Align256(sizeof(ObjectCB));
+
+    // глобальные переключатели из UI правят все записи таблицы, иначе материалы не трогаем
+    const MaterialFlags flags{ m_useNormalMap, m_useRoughMapUI, m_useMetalMapUI, m_useAOMapUI };
+    if (flags.useNormalMap != m_materialFlags.useNormalMap || flags.useRoughMap != m_materialFlags.useRoughMap ||
+        flags.useMetalMap != m_materialFlags.useMetalMap || flags.useAOMap != m_materialFlags.useAOMap)
+    {
+        for (UINT m = 0; m < static_cast<UINT>(m_materialTable.Size()); ++m)
+        {
+            MaterialCB& mcb = m_materialTable.Edit(m);
+            mcb.useNormalMap = flags.useNormalMap;
+            mcb.useRoughMap = flags.useRoughMap ? 1u : 0u;
+            mcb.useMetalMap = flags.useMetalMap ? 1u : 0u;
+            mcb.useAOMap = flags.useAOMap ? 1u : 0u;
+        }
+        m_materialFlags = flags;
     }
+    m_materialTable.Flush(m_pMaterialData, Align256(sizeof(MaterialCB)));
+
+    m_objectCBUploads = PackObjectCBs(m_objects, m_objectQuant, m_objectWorlds, m_pCbData, cbSize);
+    PackPassCB(viewProj, m_pPassData);
 }
 
 inline float saturate(float x) { return std::clamp(x, 0.0f, 1.0f); }
@@ -1677,119 +2285,248 @@ void RenderingSystem::GeometryPass()
 {
     SetCommonHeaps();
 
-    cmd->SetGraphicsRootSignature(m_pipeline.GetRootSignature());
-
     ComPtr<ID3D12GraphicsCommandList6> cmd6;
     if (m_framework->IsMeshShaderSupported())
-    {
-        cmd->QueryInterface(IID_PPV_ARGS(&cmd6));
-    }
-
-    bool switchedToTransparent = false;
+        ThrowIfFailed(cmd->QueryInterface(IID_PPV_ARGS(&cmd6)));
 
-    const UINT cbSize = Align256(sizeof(CB));
+    const UINT cbSize = Align256(sizeof(ObjectCB));
     const UINT materialSize = Align256(sizeof(MaterialCB));
 
     const XMFLOAT3 fakeCamPos = { 0, 0, m_fakeCameraZ };
 
-    for (size_t i = 0; i < m_visibleObjects.size(); ++i) 
+    auto srvStart = m_framework->GetSrvHeap()->GetGPUDescriptorHandleForHeapStart();
+    auto sampStart = m_framework->GetSamplerHeap()->GetGPUDescriptorHandleForHeapStart();
+    const UINT srvStep = m_framework->GetSrvDescriptorSize();
+
+    GeometryPassBindings bindings;
+    bindings.rootSignature = m_pipeline.GetRootSignature();
+    bindings.meshletRootSignature = m_pipeline.GetMeshletRS();
+    bindings.gbufferPSO = m_pipeline.GetGBufferPSO();
+    bindings.tessellationPSO = m_wireframe ? m_pipeline.GetGBufferTessellationWireframePSO()
+        : m_pipeline.GetGBufferTessellationPSO();
+    bindings.transparentPSO = m_pipeline.GetTransparentPSO();
+    bindings.meshletPSO = m_pipeline.GetMeshletGBufferPSO();
+    bindings.meshletCullPSO = m_pipeline.GetMeshletCullGBufferPSO();
+    bindings.meshletListPSO = m_pipeline.GetMeshletListGBufferPSO();
+    bindings.lightCB = m_lightBuffer->GetGPUVirtualAddress();
+    bindings.tessCB = m_tessBuffer->GetGPUVirtualAddress();
+    bindings.animCB = m_animBuffer->GetGPUVirtualAddress();
+    bindings.passCB = m_passBuffer->GetGPUVirtualAddress();
+    bindings.srvTable = srvStart;
+    bindings.samplerTable = sampStart;
+    if (m_meshletVisibility)
+        bindings.meshletVisibility = m_meshletVisibility->GetGPUVirtualAddress();
+    if (m_hiz)
+        bindings.hizTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(srvStart, (INT)m_hizDescBase, srvStep);
+
+    // анимация в MS сдвигает вершины за границы мешлетов - тогда без отсечения
+    MeshletCullPath cullPath = m_meshletCullPath;
+    if (m_animExplode * m_animAmplitude != 0.0f)
+        cullPath = MeshletCullPath::Off;
+
+    MeshletCullView cullView;
+    XMStoreFloat4x4(&cullView.viewProj, viewProj);
+    cullView.cameraPos = cameraPos;
+    cullView.occluderViewProj = m_prevDepthViewProj;
+    cullView.flags = (m_meshletCullFrustum ? MeshletCullFrustum : 0u) | (m_meshletCullCone ? MeshletCullCone : 0u);
+    if (m_meshletCullOcclusion && m_hizBuilt && cullPath == MeshletCullPath::Amplification)
+    {
+        cullView.flags |= MeshletCullOcclusion;
+        cullView.depthWidth = m_depthWidth;
+        cullView.depthHeight = m_depthHeight;
+    }
+
+    // сверка с CPU: AS пишет флаг каждого мешлета, одна сверка за раз
+    const bool validate = m_meshletCullValidateRequested && cullPath == MeshletCullPath::Amplification &&
+        m_meshletVisibilityTicket == InvalidReadbackTicket && m_meshletDepthTicket == InvalidReadbackTicket;
+    if (validate)
+        m_meshletCullChecks.clear();
+    m_meshletCullValidateRequested = false;
+
+    GeometryFrameParams params;
+    params.lodOrigin = fakeCamPos;
+    params.objectCBs = m_constantBuffer->GetGPUVirtualAddress();
+    params.objectCBStride = cbSize;
+    params.materialCBs = m_materialBuffer->GetGPUVirtualAddress();
+    params.materialCBStride = materialSize;
+    params.cullPath = cullPath;
+    params.cullView = cullView;
+    params.worlds = m_objectWorlds.data();
+    if (m_meshletCullBuffer)
+    {
+        params.cullData = m_pMeshletCullData;
+        params.cullCBs = m_meshletCullBuffer->GetGPUVirtualAddress();
+        params.cullStride = Align256(sizeof(MeshletCullConstants));
+    }
+    if (validate)
+        params.checks = &m_meshletCullChecks;
+    if (m_meshletListBuffer)
+    {
+        params.listData = m_pMeshletListData;
+        params.listAddress = m_meshletListBuffer->GetGPUVirtualAddress();
+    }
+
+    const bool meshShaders = tmp && m_framework->IsMeshShaderSupported();
+    auto source = [&](size_t objIndex, int lod)
+    {
+        const SceneObject& obj = m_objects[objIndex];
+        GeometryObjectSource src;
+        src.tessellated = (obj.texIdx[2] != errorTextures.height);
+
+        if (meshShaders && objIndex < m_meshletData.size() && (size_t)lod < m_meshletData[objIndex].size() &&
+            m_meshletData[objIndex][lod].meshletCount != 0)
+        {
+            const auto& md = m_meshletData[objIndex][lod];
+            src.meshletCount = md.meshletCount;
+            src.meshletBounds = md.bounds.data();
+            src.meshletTable = CD3DX12_GPU_DESCRIPTOR_HANDLE(srvStart, (INT)md.srvBase, srvStep);
+        }
+        else
+        {
+            const GeometryRange& range = m_geometry.GetRange(obj.lodGeometry[lod]);
+            src.vbv = m_geometry.GetVertexBufferView();
+            src.ibv = m_geometry.GetIndexBufferView(range.index16);
+            src.indexCount = range.indexCount;
+            src.firstIndex = range.firstIndex;
+            src.baseVertex = range.baseVertex;
+        }
+        return src;
+    };
+
+    BuildGeometryDrawItems(m_visibleObjects, m_objects.data(), params, source, m_geometryFrame);
+
+    GeometryPassStats stats;
+    if (cmd6)
+    {
+        StateFilteredCommandList<ID3D12GraphicsCommandList6> sc(cmd6.Get());
+        stats = RecordGeometryDraws(sc, bindings, m_geometryFrame.items);
+    }
+    else
     {
-        SceneObject* obj = m_visibleObjects[i];
+        StateFilteredCommandList<ID3D12GraphicsCommandList> sc(cmd);
+        stats = RecordGeometryDraws(sc, bindings, m_geometryFrame.items);
+    }
 
-        const float dist = XMVectorGetX(XMVector3Length(XMLoadFloat3(&fakeCamPos) - XMLoadFloat3(&obj->position)));
-        int lod = static_cast<int>(obj->lodDistances.size()) - 1;
+    if (validate && !m_meshletCullChecks.empty())
+    {
+        auto& readback = m_framework->GetReadback();
+        TransitionResource(cmd, m_meshletVisibility.Get(), m_meshletVisibilityState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        m_meshletVisibilityTicket = readback.EnqueueBuffer(cmd, m_meshletVisibility.Get(), 0, (UINT64)m_geometryFrame.visibilityCount * sizeof(uint32_t));
+        TransitionResource(cmd, m_meshletVisibility.Get(), m_meshletVisibilityState, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-        for (int j = 0; j + 1 < static_cast<int>(obj->lodDistances.size()); ++j) 
+        // глубина, из которой построен HiZ этого кадра; CopyDepthToPrev перезапишет её позже
+        if (cullView.flags & MeshletCullOcclusion)
         {
-            if (dist < obj->lodDistances[j + 1]) 
+            auto toCopy = CD3DX12_RESOURCE_BARRIER::Transition(m_prevDepth.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+            cmd->ResourceBarrier(1, &toCopy);
+            m_meshletDepthTicket = readback.EnqueueTexture(cmd, m_prevDepth.Get(), 0);
+            auto back = CD3DX12_RESOURCE_BARRIER::Transition(m_prevDepth.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            cmd->ResourceBarrier(1, &back);
+
+            if (m_meshletDepthTicket == InvalidReadbackTicket)
             {
-                lod = j; break;
+                readback.Release(m_meshletVisibilityTicket);
+                m_meshletVisibilityTicket = InvalidReadbackTicket;
             }
         }
+        if (m_meshletVisibilityTicket == InvalidReadbackTicket)
+            m_meshletCullChecks.clear();
+    }
 
-        if (!switchedToTransparent && obj->Color.w != 1.0f) 
-        {
-            cmd->SetPipelineState(m_pipeline.GetTransparentPSO());
-            switchedToTransparent = true;
-        }
+    drawIndexedCount = stats.drawIndexed;
+    meshDispatchCount = stats.meshDispatches;
+    stateCallsIssued = stats.stateCallsIssued;
+    stateCallsElided = stats.stateCallsElided;
+}
 
-        const bool useTess = (obj->texIdx[2] != errorTextures.height);
+void RenderingSystem::BuildHiZ()
+{
+    m_hizBuilt = false;
+    if (!m_hiz || !tmp || !m_prevDepthValid || !m_meshletCullOcclusion ||
+        m_meshletCullPath != MeshletCullPath::Amplification)
+        return;
 
-        const size_t objIndex = (size_t)(obj - m_objects.data());
-        const bool hasMeshlets =
-            m_framework->IsMeshShaderSupported() &&
-            cmd6 &&
-            objIndex < m_meshletData.size() &&
-            (size_t)lod < m_meshletData[objIndex].size() &&
-            m_meshletData[objIndex][lod].meshletCount != 0;
+    SetCommonHeaps();
+    cmd->SetComputeRootSignature(m_pipeline.GetHiZRS());
+    cmd->SetPipelineState(m_pipeline.GetHiZCSO());
 
-        bool useMeshPipeline = hasMeshlets && !useTess && (obj->Color.w == 1.0f);
+    auto srvStart = m_framework->GetSrvHeap()->GetGPUDescriptorHandleForHeapStart();
+    const UINT srvStep = m_framework->GetSrvDescriptorSize();
 
-        auto srvStart = m_framework->GetSrvHeap()->GetGPUDescriptorHandleForHeapStart();
-        auto sampStart = m_framework->GetSamplerHeap()->GetGPUDescriptorHandleForHeapStart();
-        const UINT cbSize = Align256(sizeof(CB));
-        const UINT materialSize = Align256(sizeof(MaterialCB));
+    auto toRead = CD3DX12_RESOURCE_BARRIER::Transition(m_prevDepth.Get(),
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    cmd->ResourceBarrier(1, &toRead);
 
-        useMeshPipeline = tmp;
+    // каждый уровень - максимум по своему отпечатку в предыдущем (уровень 0 - в глубине)
+    UINT srcW = m_depthWidth, srcH = m_depthHeight;
+    for (UINT m = 0; m < m_hizMips; ++m)
+    {
+        const UINT dstW = (std::max)(1u, (m_depthWidth / 2) >> m);
+        const UINT dstH = (std::max)(1u, (m_depthHeight / 2) >> m);
 
-        if (useMeshPipeline)
-        {
-            cmd->SetGraphicsRootSignature(m_pipeline.GetMeshletRS());
-            cmd->SetPipelineState(m_pipeline.GetMeshletGBufferPSO());
+        auto toUav = CD3DX12_RESOURCE_BARRIER::Transition(m_hiz.Get(),
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, m);
+        cmd->ResourceBarrier(1, &toUav);
 
-            cmd->SetGraphicsRootConstantBufferView(0, m_constantBuffer->GetGPUVirtualAddress() + (UINT)i * cbSize);
-            cmd->SetGraphicsRootConstantBufferView(1, m_lightBuffer->GetGPUVirtualAddress());
-            cmd->SetGraphicsRootConstantBufferView(2, m_tessBuffer->GetGPUVirtualAddress());
-            cmd->SetGraphicsRootDescriptorTable(3, srvStart);
-            cmd->SetGraphicsRootDescriptorTable(4, sampStart);
-            cmd->SetGraphicsRootConstantBufferView(5, m_materialBuffer->GetGPUVirtualAddress() + (UINT)i * materialSize);
-            cmd->SetGraphicsRootConstantBufferView(6, m_animBuffer->GetGPUVirtualAddress());
+        const UINT sizes[4] = { srcW, srcH, dstW, dstH };
+        cmd->SetComputeRoot32BitConstants(0, 4, sizes, 0);
+        D3D12_GPU_DESCRIPTOR_HANDLE src = m_prevDepthSRV;
+        if (m > 0)
+            src = CD3DX12_GPU_DESCRIPTOR_HANDLE(srvStart, (INT)(m_hizDescBase + m), srvStep);
+        cmd->SetComputeRootDescriptorTable(1, src);
+        cmd->SetComputeRootDescriptorTable(2, CD3DX12_GPU_DESCRIPTOR_HANDLE(srvStart, (INT)(m_hizDescBase + 1 + m_hizMips + m), srvStep));
+        cmd->Dispatch((dstW + 7) / 8, (dstH + 7) / 8, 1);
 
-            const UINT srvStep = m_framework->GetSrvDescriptorSize();
-            const auto& md = m_meshletData[objIndex][lod];
-            CD3DX12_GPU_DESCRIPTOR_HANDLE meshletTable(srvStart, (INT)md.srvBase, srvStep);
-            cmd->SetGraphicsRootDescriptorTable(7, meshletTable);
+        auto toSrv = CD3DX12_RESOURCE_BARRIER::Transition(m_hiz.Get(),
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, m);
+        cmd->ResourceBarrier(1, &toSrv);
 
-            cmd6->DispatchMesh(md.meshletCount, 1, 1);
-            meshDispatchCount++;
-        }
-        else
-        {
-            cmd->SetGraphicsRootSignature(m_pipeline.GetRootSignature());
+        srcW = dstW;
+        srcH = dstH;
+    }
 
-            if (!switchedToTransparent && obj->Color.w != 1.0f)
-            {
-                cmd->SetPipelineState(m_pipeline.GetTransparentPSO());
-                switchedToTransparent = true;
-            }
+    auto back = CD3DX12_RESOURCE_BARRIER::Transition(m_prevDepth.Get(),
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    cmd->ResourceBarrier(1, &back);
 
-            if (useTess)
-            {
-                cmd->SetPipelineState(m_wireframe ? m_pipeline.GetGBufferTessellationWireframePSO()
-                    : m_pipeline.GetGBufferTessellationPSO());
-                cmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
-            }
-            else
-            {
-                cmd->SetPipelineState(m_pipeline.GetGBufferPSO());
-                cmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            }
+    m_hizBuilt = true;
+}
 
-            cmd->SetGraphicsRootConstantBufferView(0, m_constantBuffer->GetGPUVirtualAddress() + (UINT)i * cbSize);
-            cmd->SetGraphicsRootConstantBufferView(1, m_lightBuffer->GetGPUVirtualAddress());
-            cmd->SetGraphicsRootConstantBufferView(2, m_tessBuffer->GetGPUVirtualAddress());
-            cmd->SetGraphicsRootDescriptorTable(3, srvStart);
-            cmd->SetGraphicsRootDescriptorTable(4, sampStart);
-            cmd->SetGraphicsRootConstantBufferView(5, m_materialBuffer->GetGPUVirtualAddress() + (UINT)i * materialSize);
-            cmd->SetGraphicsRootConstantBufferView(6, m_animBuffer->GetGPUVirtualAddress());
+void RenderingSystem::ResolveMeshletCullValidation()
+{
+    if (m_meshletVisibilityTicket == InvalidReadbackTicket)
+        return;
 
-            cmd->IASetVertexBuffers(0, 1, &obj->lodVBs[lod]);
-            cmd->IASetIndexBuffer(&obj->lodIBs[lod]);
+    auto& readback = m_framework->GetReadback();
+    if (!readback.IsReady(m_meshletVisibilityTicket))
+        return;
+    if (m_meshletDepthTicket != InvalidReadbackTicket && !readback.IsReady(m_meshletDepthTicket))
+        return;
 
-            cmd->DrawIndexedInstanced((UINT)obj->lodMeshes[lod].indices.size(), 1, 0, 0, 0);
-            drawIndexedCount++;
-        }
+    HiZPyramid hiz;
+    if (m_meshletDepthTicket != InvalidReadbackTicket)
+    {
+        UINT rowPitch = 0;
+        const uint8_t* depthData = readback.GetData(m_meshletDepthTicket, &rowPitch);
+        hiz = BuildHiZPyramid(reinterpret_cast<const float*>(depthData), m_depthWidth, m_depthHeight, rowPitch);
+    }
+
+    const uint32_t* visibility = reinterpret_cast<const uint32_t*>(readback.GetData(m_meshletVisibilityTicket));
+    MeshletCullValidation total;
+    for (const MeshletCullCheck& check : m_meshletCullChecks)
+    {
+        const MeshletDrawData& md = m_meshletData[check.objIndex][check.lod];
+        total += ValidateMeshletCulling(md.bounds.data(), md.meshletCount, check.constants,
+            m_meshletDepthTicket != InvalidReadbackTicket ? &hiz : nullptr,
+            visibility + check.constants.visibilityOffset);
     }
+    m_meshletCullValidation.push_back(total);
+
+    readback.Release(m_meshletVisibilityTicket);
+    readback.Release(m_meshletDepthTicket);
+    m_meshletVisibilityTicket = InvalidReadbackTicket;
+    m_meshletDepthTicket = InvalidReadbackTicket;
+    m_meshletCullChecks.clear();
 }
 
 void RenderingSystem::DeferredPass()
@@ -1870,7 +2607,7 @@ void RenderingSystem::BuildLightViewProjCSM()
     if (fabsf(dotY) > 0.99f) up = XMVectorSet(0, 0, 1, 0);
 
     const float aspect = static_cast<float>(m_framework->GetWidth()) / m_framework->GetHeight();
-    const float fov = XM_PIDIV4;
+    const float fov = m_fovY;
     XMMATRIX V = view;
 
     const float overlapRatio = 0.15f;
@@ -1975,8 +2712,15 @@ void RenderingSystem::ShadowPass()
     cl->SetPipelineState(m_pipeline.GetShadowPSO());
     cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-    const UINT cbSize = Align256(sizeof(CB));
-    const UINT perCascadeCapacity = static_cast<UINT>(m_objects.size());
+    // вся геометрия в одном буфере, привязываем один раз; индексы uint16 и uint32 в двух буферах
+    const D3D12_VERTEX_BUFFER_VIEW positionVB = m_geometry.GetPositionBufferView();
+    const D3D12_INDEX_BUFFER_VIEW arenaIB[2] = { m_geometry.GetIndexBufferView(false), m_geometry.GetIndexBufferView(true) };
+    cl->IASetVertexBuffers(0, 1, &positionVB);
+    cl->IASetIndexBuffer(&arenaIB[0]);
+    bool boundIndex16 = false;
+
+    const UINT cbSize = Align256(sizeof(ObjectCB));
+    const UINT passSize = Align256(sizeof(PassCB));
 
     for (UINT ci = 0; ci < CSM_CASCADES; ++ci)
     {
@@ -1984,25 +2728,28 @@ void RenderingSystem::ShadowPass()
         cl->OMSetRenderTargets(0, nullptr, FALSE, &dsv);
         cl->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
-        const UINT base = ci * perCascadeCapacity;
+        PassCB pass{};
+        pass.ViewProj = m_lightViewProjCSM[ci];
+        memcpy(m_pPassData + (1 + ci) * passSize, &pass, sizeof(pass));
+        cl->SetGraphicsRootConstantBufferView(
+            7, m_passBuffer->GetGPUVirtualAddress() + (1 + ci) * passSize);
 
         for (size_t i = 0; i < m_shadowCasters[ci].size(); ++i)
         {
             SceneObject* obj = m_shadowCasters[ci][i];
 
-            CB cb{};
-            XMStoreFloat4x4(&cb.World, obj->GetWorldMatrix());
-            cb.ViewProj = m_lightViewProjCSM[ci];
-
-            const UINT slot = base + static_cast<UINT>(i);
-            memcpy(m_pShadowCbData + slot * cbSize, &cb, sizeof(cb));
+            const UINT objIndex = static_cast<UINT>(obj - m_objects.data());
             cl->SetGraphicsRootConstantBufferView(
-                0, m_shadowBuffer->GetGPUVirtualAddress() + slot * cbSize);
+                0, m_constantBuffer->GetGPUVirtualAddress() + objIndex * cbSize);
 
             int lod = (int)obj->lodMeshes.size() - 1;
-            cl->IASetVertexBuffers(0, 1, &obj->lodVBs[lod]);
-            cl->IASetIndexBuffer(&obj->lodIBs[lod]);
-            cl->DrawIndexedInstanced((UINT)obj->lodMeshes[lod].indices.size(), 1, 0, 0, 0);
+            const GeometryRange& range = m_geometry.GetRange(obj->lodGeometry[lod]);
+            if (range.index16 != boundIndex16)
+            {
+                boundIndex16 = range.index16;
+                cl->IASetIndexBuffer(&arenaIB[boundIndex16 ? 1 : 0]);
+            }
+            cl->DrawIndexedInstanced(range.indexCount, 1, range.firstIndex, (INT)range.baseVertex, 0);
         }
     }
 
@@ -2159,20 +2906,9 @@ void RenderingSystem::PostProcessPass()
         vcb.uvGuard = 2.0f;
         vcb.zDiffNdc = 0.004f;
 
-        ComPtr<ID3D12Resource> velCB;
-        {
-            CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
-            auto desc = CD3DX12_RESOURCE_DESC::Buffer(Align256(sizeof(VelCBData)));
-            ThrowIfFailed(m_framework->GetDevice()->CreateCommittedResource(
-                &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
-                D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&velCB)));
-            uint8_t* p = nullptr;
-            velCB->Map(0, nullptr, reinterpret_cast<void**>(&p));
-            memcpy(p, &vcb, sizeof(vcb));
-            velCB->Unmap(0, nullptr);
-            m_transientUploads.push_back(velCB);
-        }
-        cmd->SetGraphicsRootConstantBufferView(1, velCB->GetGPUVirtualAddress());
+        StagingBuffer velCB = m_framework->AcquireStaging(Align256(sizeof(VelCBData)));
+        memcpy(velCB.cpu, &vcb, sizeof(vcb));
+        cmd->SetGraphicsRootConstantBufferView(1, velCB.gpu);
 
         cmd->SetPipelineState(m_pipeline.GetVelocityPSO());
         cmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -2249,23 +2985,22 @@ void RenderingSystem::PostProcessPass()
     SetCommonHeaps();
     UpdatePostCB();
 
-    std::vector<ID3D12PipelineState*> passes;
-    passes.push_back(m_pipeline.GetGammaPSO());
-
-    if (m_enableInvert) passes.push_back(m_pipeline.GetInvertPSO());
-    if (m_enableGrayscale) passes.push_back(m_pipeline.GetGrayscalePSO());
-    if (m_enablePixelate) passes.push_back(m_pipeline.GetPixelatePSO());
-    if (m_enablePosterize) passes.push_back(m_pipeline.GetPosterizePSO());
-    if (m_enableSaturation)passes.push_back(m_pipeline.GetSaturationPSO());
-
-    passes.push_back(m_enableVignette ? m_pipeline.GetVignettePSO()
-        : m_pipeline.GetCopyLDRPSO());
+    PostEffectFlags flags;
+    flags.gamma = m_enableGamma;
+    flags.invert = m_enableInvert;
+    flags.grayscale = m_enableGrayscale;
+    flags.pixelate = m_enablePixelate;
+    flags.posterize = m_enablePosterize;
+    flags.saturation = m_enableSaturation;
+    flags.vignette = m_enableVignette;
 
-    for (size_t i = 0; i < passes.size(); ++i)
+    const std::vector<uint32_t> chain = BuildPostChain(flags);
+    for (size_t i = 0; i < chain.size(); ++i)
     {
-        bool last = (i + 1 == passes.size());
-        if (last) ApplyPassToBackbuffer(passes[i], cur);
-        else      doInter(passes[i]);
+        ID3D12PipelineState* pso = m_pipeline.GetPostUberPSO(chain[i]);
+        bool last = (i + 1 == chain.size());
+        if (last) ApplyPassToBackbuffer(pso, cur);
+        else      doInter(pso);
     }
 }
 
@@ -2400,10 +3135,11 @@ void RenderingSystem::TerrainPass()
     m_terrain->DrawGBuffer(cmd);
 }
 
+// пишет в открытый command list фреймворка: upload-буфер из пула должен уйти вместе с ним
 void RenderingSystem::InitHeightDeltaTexture()
 {
     auto* device = m_framework->GetDevice();
-    auto* queue = m_framework->GetCommandQueue();
+    auto* cmdList = m_framework->GetCommandList();
 
     m_heightDeltaCPU.assign(m_heightDeltaW * m_heightDeltaH, 0.0f);
 
@@ -2412,7 +3148,7 @@ void RenderingSystem::InitHeightDeltaTexture()
         DXGI_FORMAT_R32_FLOAT,
         (UINT)m_heightDeltaW, (UINT)m_heightDeltaH,
         1, 1, 1, 0);
-    ThrowIfFailed(device->CreateCommittedResource(
+    ThrowIfFailed(m_framework->CreateResource(
         &heapDefault, D3D12_HEAP_FLAG_NONE, &texDesc,
         D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
         IID_PPV_ARGS(&m_heightDeltaTex)));
@@ -2421,43 +3157,19 @@ void RenderingSystem::InitHeightDeltaTexture()
     UINT rows = 0; UINT64 rowSize = 0, total = 0;
     device->GetCopyableFootprints(&texDesc, 0, 1, 0, &fp, &rows, &rowSize, &total);
 
-    ComPtr<ID3D12Resource> uploadBuffer;
-    CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
-    CD3DX12_RESOURCE_DESC   bufDesc = CD3DX12_RESOURCE_DESC::Buffer(total);
-    ThrowIfFailed(device->CreateCommittedResource(
-        &heapUpload, D3D12_HEAP_FLAG_NONE, &bufDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-        IID_PPV_ARGS(&uploadBuffer)));
-
-    void* p = nullptr;
-    ThrowIfFailed(uploadBuffer->Map(0, nullptr, &p));
+    StagingBuffer upload = m_framework->AcquireStaging(total);
     for (UINT y = 0; y < rows; ++y)
-        memset((uint8_t*)p + fp.Offset + y * fp.Footprint.RowPitch, 0, (size_t)rowSize);
-    uploadBuffer->Unmap(0, nullptr);
-
-    ComPtr<ID3D12CommandAllocator> tempAlloc;
-    ThrowIfFailed(device->CreateCommandAllocator(
-        D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&tempAlloc)));
-
-    ComPtr<ID3D12GraphicsCommandList> tempCmd;
-    ThrowIfFailed(device->CreateCommandList(
-        0, D3D12_COMMAND_LIST_TYPE_DIRECT, tempAlloc.Get(), nullptr,
-        IID_PPV_ARGS(&tempCmd)));
+        memset(upload.cpu + fp.Offset + y * fp.Footprint.RowPitch, 0, (size_t)rowSize);
 
     CD3DX12_TEXTURE_COPY_LOCATION dst(m_heightDeltaTex.Get(), 0);
-    CD3DX12_TEXTURE_COPY_LOCATION src(uploadBuffer.Get(), fp);
-    tempCmd->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+    CD3DX12_TEXTURE_COPY_LOCATION src(upload.resource, fp);
+    cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
 
     auto toSRV = CD3DX12_RESOURCE_BARRIER::Transition(
         m_heightDeltaTex.Get(),
         D3D12_RESOURCE_STATE_COPY_DEST,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-    tempCmd->ResourceBarrier(1, &toSRV);
-
-    ThrowIfFailed(tempCmd->Close());
-    ID3D12CommandList* lists[] = { tempCmd.Get() };
-    queue->ExecuteCommandLists(1, lists);
-    m_framework->WaitForGpu();
+    cmdList->ResourceBarrier(1, &toSRV);
 
     m_heightDeltaSrvIndex = m_framework->AllocateSrvDescriptor();
     auto cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(
@@ -2512,17 +3224,32 @@ bool RenderingSystem::WorldToTerrainUV(const XMFLOAT3& P, XMFLOAT2& uv)
     return true;
 }
 
-void RenderingSystem::UpdateTerrainBrush(ID3D12GraphicsCommandList* cmd, float dt)
+void RenderingSystem::UpdateTerrainBrush(float dt)
 {
+    ReadbackManager& readback = m_framework->GetReadback();
 
-    if (!m_brush.enabled) return;
-
-    ImGuiIO& io = ImGui::GetIO();
-    if (io.WantCaptureMouse) return;
+    m_brush.painting = false;
+    if (m_brush.enabled && !ImGui::GetIO().WantCaptureMouse)
+        m_brush.painting = ImGui::GetIO().MouseDown[0];
 
-    m_brush.painting = io.MouseDown[0];
+    if (!m_brush.painting)
+    {
+        m_brush.hasLast = false;
+        for (ReadbackTicket ticket : m_depthReadbacks)
+            readback.Release(ticket);
+        m_depthReadbacks.clear();
+        return;
+    }
 
-    if (!m_brush.painting) return;
+    // самая свежая готовая копия глубины, более старые больше не нужны
+    ReadbackTicket depthTicket = InvalidReadbackTicket;
+    while (!m_depthReadbacks.empty() && readback.IsReady(m_depthReadbacks.front()))
+    {
+        readback.Release(depthTicket);
+        depthTicket = m_depthReadbacks.front();
+        m_depthReadbacks.pop_front();
+    }
+    if (depthTicket == InvalidReadbackTicket) return;
 
     m_brush.invert = (GetAsyncKeyState(VK_SHIFT) & 0x8000) != 0;
 
@@ -2532,12 +3259,11 @@ void RenderingSystem::UpdateTerrainBrush(ID3D12GraphicsCommandList* cmd, float d
     int mx = std::clamp(static_cast<int>(mouse.x), 0, static_cast<int>(m_depthWidth) - 1);
     int my = std::clamp(static_cast<int>(mouse.y), 0, static_cast<int>(m_depthHeight) - 1);
 
-    void* mappedData = nullptr;
-    m_depthStaging->Map(0, nullptr, &mappedData);
-    float* depthData = static_cast<float*>(mappedData);
-    UINT colPitch = static_cast<UINT>(m_depthRowPitch / sizeof(float));
-    float depth = depthData[my * colPitch + mx];
-    m_depthStaging->Unmap(0, nullptr);
+    UINT rowPitch = 0;
+    const uint8_t* depthData = readback.GetData(depthTicket, &rowPitch);
+    float depth = 1.0f;
+    memcpy(&depth, depthData + (size_t)my * rowPitch + (size_t)mx * sizeof(float), sizeof(float));
+    readback.Release(depthTicket);
 
     if (depth >= 1.0f || depth <= 0.0f) return;
 
@@ -2554,10 +3280,33 @@ void RenderingSystem::UpdateTerrainBrush(ID3D12GraphicsCommandList* cmd, float d
     XMFLOAT2 uv;
     if (!WorldToTerrainUV(worldHit, uv)) return;
 
-    ApplyBrushAtUV(uv, dt, cmd);
+    // штампы вдоль пути мыши с шагом в полрадиуса, dt делится между ними
+    int stamps = 1;
+    if (m_brush.hasLast)
+    {
+        const float spacing = 0.5f * m_brush.radiusWorld / m_terrainWorldSize;
+        const float dx = uv.x - m_brush.lastUV.x, dy = uv.y - m_brush.lastUV.y;
+        const float dist = sqrtf(dx * dx + dy * dy);
+        stamps = std::clamp((int)ceilf(dist / spacing), 1, 32);
+    }
+
+    for (int i = 1; i <= stamps; ++i)
+    {
+        const float t = (float)i / stamps;
+        XMFLOAT2 p = uv;
+        if (m_brush.hasLast)
+        {
+            p.x = m_brush.lastUV.x + (uv.x - m_brush.lastUV.x) * t;
+            p.y = m_brush.lastUV.y + (uv.y - m_brush.lastUV.y) * t;
+        }
+        ApplyBrushAtUV(p, dt / stamps);
+    }
+
+    m_brush.lastUV = uv;
+    m_brush.hasLast = true;
 }
 
-void RenderingSystem::ApplyBrushAtUV(const XMFLOAT2& uv, float dt, ID3D12GraphicsCommandList* cmd)
+void RenderingSystem::ApplyBrushAtUV(const XMFLOAT2& uv, float dt)
 {
     const float sign = m_brush.invert ? -1.f : 1.f;
 
@@ -2590,58 +3339,54 @@ void RenderingSystem::ApplyBrushAtUV(const XMFLOAT2& uv, float dt, ID3D12Graphic
         }
     }
 
-    UploadRegionToGPU(x0, y0, x1 - x0 + 1, y1 - y0 + 1, cmd);
+    m_heightDirty.Add({ x0, y0, x1 + 1, y1 + 1 });
 }
 
-void RenderingSystem::UploadRegionToGPU(int x0, int y0, int w, int h, ID3D12GraphicsCommandList* cmd)
+void RenderingSystem::UploadDirtyHeightRegions(ID3D12GraphicsCommandList* cmd)
 {
-    if (w <= 0 || h <= 0) return;
+    if (m_heightDirty.Empty()) return;
 
     auto* device = m_framework->GetDevice();
 
-    CD3DX12_RESOURCE_DESC regionTexDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, (UINT)w, (UINT)h, 1, 1);
-
-    D3D12_PLACED_SUBRESOURCE_FOOTPRINT fp{};
-    UINT rows = 0; UINT64 rowSize = 0, total = 0;
-    device->GetCopyableFootprints(&regionTexDesc, 0, 1, 0, &fp, &rows, &rowSize, &total);
-
-    ComPtr<ID3D12Resource> uploadBuffer;
-    CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
-    CD3DX12_RESOURCE_DESC   bufDesc = CD3DX12_RESOURCE_DESC::Buffer(total);
-
-    ThrowIfFailed(device->CreateCommittedResource(
-        &heapUpload, D3D12_HEAP_FLAG_NONE, &bufDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&uploadBuffer)));
-
-    m_transientUploads.push_back(uploadBuffer);
-
-    void* p = nullptr; ThrowIfFailed(uploadBuffer->Map(0, nullptr, &p));
-    uint8_t* dstBase = (uint8_t*)p + fp.Offset;
-
-    for (UINT row = 0; row < rows; ++row)
-    {
-        const float* src = &m_heightDeltaCPU[(y0 + (int)row) * m_heightDeltaW + x0];
-        memcpy(dstBase + row * fp.Footprint.RowPitch, src, (size_t)rowSize);
-    }
-    uploadBuffer->Unmap(0, nullptr);
-
     CD3DX12_RESOURCE_BARRIER toCopy = CD3DX12_RESOURCE_BARRIER::Transition(
         m_heightDeltaTex.Get(),
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
         D3D12_RESOURCE_STATE_COPY_DEST);
     cmd->ResourceBarrier(1, &toCopy);
 
-    CD3DX12_TEXTURE_COPY_LOCATION dst(m_heightDeltaTex.Get(), 0); 
-    CD3DX12_TEXTURE_COPY_LOCATION src(uploadBuffer.Get(), fp);    
+    CD3DX12_TEXTURE_COPY_LOCATION dst(m_heightDeltaTex.Get(), 0);
+
+    for (const DirtyRect& r : m_heightDirty.GetRects())
+    {
+        const UINT w = (UINT)r.Width(), h = (UINT)r.Height();
+        CD3DX12_RESOURCE_DESC regionTexDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R32_FLOAT, w, h, 1, 1);
+
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT fp{};
+        UINT rows = 0; UINT64 rowSize = 0, total = 0;
+        device->GetCopyableFootprints(&regionTexDesc, 0, 1, 0, &fp, &rows, &rowSize, &total);
+
+        StagingBuffer upload = m_framework->AllocateUpload(total, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        uint8_t* dstBase = upload.cpu + fp.Offset;
+        fp.Offset += upload.offset;
+
+        for (UINT row = 0; row < rows; ++row)
+        {
+            const float* src = &m_heightDeltaCPU[(r.y0 + (int)row) * m_heightDeltaW + r.x0];
+            memcpy(dstBase + row * fp.Footprint.RowPitch, src, (size_t)rowSize);
+        }
 
-    D3D12_BOX srcBox{ 0u, 0u, 0u, (UINT)w, (UINT)h, 1u };
-    cmd->CopyTextureRegion(&dst, (UINT)x0, (UINT)y0, 0, &src, &srcBox);
+        CD3DX12_TEXTURE_COPY_LOCATION src(upload.resource, fp);
+        D3D12_BOX srcBox{ 0u, 0u, 0u, w, h, 1u };
+        cmd->CopyTextureRegion(&dst, (UINT)r.x0, (UINT)r.y0, 0, &src, &srcBox);
+    }
 
     CD3DX12_RESOURCE_BARRIER toSRV = CD3DX12_RESOURCE_BARRIER::Transition(
         m_heightDeltaTex.Get(),
         D3D12_RESOURCE_STATE_COPY_DEST,
         D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
     cmd->ResourceBarrier(1, &toSRV);
+
+    m_heightDirty.Clear();
 }
 
 void RenderingSystem::ApplyTAAToIntermediate(D3D12_GPU_DESCRIPTOR_HANDLE currSrv, D3D12_GPU_DESCRIPTOR_HANDLE historySrv, D3D12_GPU_DESCRIPTOR_HANDLE prevDepthSrv, D3D12_GPU_DESCRIPTOR_HANDLE currDepthSrv, D3D12_GPU_DESCRIPTOR_HANDLE velocitySrv,ID3D12Resource* dst, D3D12_CPU_DESCRIPTOR_HANDLE dstRtv,  D3D12_GPU_DESCRIPTOR_HANDLE& outSrv)
@@ -2746,6 +3491,8 @@ void RenderingSystem::CopyDepthToPrev()
     }
 
     cmd->CopyResource(dst, src);
+    XMStoreFloat4x4(&m_prevDepthViewProj, viewProj);
+    m_prevDepthValid = true;
 
     {
         auto srcBack = CD3DX12_RESOURCE_BARRIER::Transition(
@@ -2771,27 +3518,27 @@ void RenderingSystem::TransitionResource(ID3D12GraphicsCommandList* cmd, ID3D12R
     current = target;
 }
 
-static ComPtr<ID3D12Resource> CreateUavBuffer(ID3D12Device* device, UINT64 size, D3D12_RESOURCE_STATES initState)
+static ComPtr<ID3D12Resource> CreateUavBuffer(DX12Framework* framework, UINT64 size, D3D12_RESOURCE_STATES initState)
 {
     ComPtr<ID3D12Resource> res;
 
     CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_DEFAULT);
     auto desc = CD3DX12_RESOURCE_DESC::Buffer(size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
-    ThrowIfFailed(device->CreateCommittedResource(
+    ThrowIfFailed(framework->CreateResource(
         &heap, D3D12_HEAP_FLAG_NONE, &desc, initState, nullptr, IID_PPV_ARGS(&res)));
 
     return res;
 }
 
-static ComPtr<ID3D12Resource> CreateUploadBuffer(ID3D12Device* device, UINT64 size)
+static ComPtr<ID3D12Resource> CreateUploadBuffer(DX12Framework* framework, UINT64 size)
 {
     ComPtr<ID3D12Resource> res;
 
     CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_UPLOAD);
     auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
 
-    ThrowIfFailed(device->CreateCommittedResource(
+    ThrowIfFailed(framework->CreateResource(
         &heap, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ,
         nullptr, IID_PPV_ARGS(&res)));
 
@@ -2835,7 +3582,6 @@ void RenderingSystem::BuildBLAS_Once(ID3D12Device5* device5, ID3D12GraphicsComma
 {
     if (m_blasBuilt) return;
 
-    ID3D12Device* device = m_framework->GetDevice();
     ID3D12GraphicsCommandList* cmd = m_framework->GetCommandList();
 
     m_blas.clear();
@@ -2849,22 +3595,23 @@ void RenderingSystem::BuildBLAS_Once(ID3D12Device5* device5, ID3D12GraphicsComma
         auto& obj = m_objects[i];
         if (obj.lodMeshes.empty()) continue;
 
-        const auto& vbv = obj.lodVBs[0];
-        const auto& ibv = obj.lodIBs[0];
+        const GeometryRange& range = m_geometry.GetRange(obj.lodGeometry[0]);
 
         D3D12_RAYTRACING_GEOMETRY_DESC geom{};
         geom.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
         //geom.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
         geom.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
 
-        geom.Triangles.VertexBuffer.StartAddress = vbv.BufferLocation;
-        geom.Triangles.VertexBuffer.StrideInBytes = vbv.StrideInBytes;
-        geom.Triangles.VertexCount = vbv.SizeInBytes / vbv.StrideInBytes;
+        geom.Triangles.VertexBuffer.StartAddress = m_geometry.GetPositionBuffer()->GetGPUVirtualAddress() +
+            (UINT64)range.baseVertex * PositionStreamStride;
+        geom.Triangles.VertexBuffer.StrideInBytes = PositionStreamStride;
+        geom.Triangles.VertexCount = range.vertexCount;
         geom.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
 
-        geom.Triangles.IndexBuffer = ibv.BufferLocation;
-        geom.Triangles.IndexCount = ibv.SizeInBytes / sizeof(uint32_t);
-        geom.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
+        geom.Triangles.IndexBuffer = m_geometry.GetIndexBuffer(range.index16)->GetGPUVirtualAddress() +
+            (UINT64)range.firstIndex * (range.index16 ? sizeof(uint16_t) : sizeof(uint32_t));
+        geom.Triangles.IndexCount = range.indexCount;
+        geom.Triangles.IndexFormat = range.index16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 
         D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs{};
         inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
@@ -2876,12 +3623,12 @@ void RenderingSystem::BuildBLAS_Once(ID3D12Device5* device5, ID3D12GraphicsComma
         D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info{};
         device5->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &info);
 
-        m_blasScratch[i] = CreateUavBuffer(device, info.ScratchDataSizeInBytes, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        m_blasScratch[i] = CreateUavBuffer(m_framework, info.ScratchDataSizeInBytes, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
         {
             CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_DEFAULT);
             auto desc = CD3DX12_RESOURCE_DESC::Buffer(info.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-            ThrowIfFailed(device->CreateCommittedResource(
+            ThrowIfFailed(m_framework->CreateResource(
                 &heap, D3D12_HEAP_FLAG_NONE, &desc,
                 D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
                 nullptr, IID_PPV_ARGS(&m_blas[i])));
@@ -2939,7 +3686,7 @@ void RenderingSystem::BuildOrUpdateTLAS(ID3D12Device5* device5, ID3D12GraphicsCo
     if (!m_tlasInstanceUpload || instBytes != m_tlasInstanceBytes)
     {
         m_tlasInstanceUpload.Reset();
-        m_tlasInstanceUpload = CreateUploadBuffer(device, instBytes);
+        m_tlasInstanceUpload = CreateUploadBuffer(m_framework, instBytes);
         m_tlasInstanceBytes = instBytes;
         m_tlasInstanceCount = (UINT)instances.size();
         update = false;
@@ -2968,7 +3715,7 @@ void RenderingSystem::BuildOrUpdateTLAS(ID3D12Device5* device5, ID3D12GraphicsCo
         scratchSize = max(scratchSize, m_tlasPrebuild.UpdateScratchDataSizeInBytes);
 
         m_tlasScratch.Reset();
-        m_tlasScratch = CreateUavBuffer(device, scratchSize, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        m_tlasScratch = CreateUavBuffer(m_framework, scratchSize, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
         {
             CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_DEFAULT);
@@ -2977,7 +3724,7 @@ void RenderingSystem::BuildOrUpdateTLAS(ID3D12Device5* device5, ID3D12GraphicsCo
                 D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
             m_tlas.Reset();
-            ThrowIfFailed(device->CreateCommittedResource(
+            ThrowIfFailed(m_framework->CreateResource(
                 &heap, D3D12_HEAP_FLAG_NONE, &desc,
                 D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE,
                 nullptr, IID_PPV_ARGS(&m_tlas)));
@@ -3011,12 +3758,10 @@ void RenderingSystem::BuildOrUpdateTLAS(ID3D12Device5* device5, ID3D12GraphicsCo
 
 void RenderingSystem::InitAlphaShadowDemoResources()
 {
-    auto* device = m_framework->GetDevice();
-
     if (!m_alphaShadowCB)
     {
         const UINT cbSize = Align256(sizeof(AlphaShadowCBData));
-        m_alphaShadowCB = CreateUploadBuffer(device, cbSize);
+        m_alphaShadowCB = CreateUploadBuffer(m_framework, cbSize);
     }
 
     UpdateGrassSrvHandle();
@@ -3059,8 +3804,7 @@ void RenderingSystem::EnsureMotionBlurResources()
 {
     if (!m_motionBlurCB)
     {
-        ID3D12Device* device = m_framework->GetDevice();
-        m_motionBlurCB = CreateUploadBuffer(device, 256);
+        m_motionBlurCB = CreateUploadBuffer(m_framework, 256);
     }
 }
 
@@ -5,6 +5,7 @@
 #include <wrl/client.h>
 #include <d3d12.h>
 #include <vector>
+#include <deque>
 #include "SceneObject.h"
 #include "IGameApp.h"
 #include "AssetLoader.h"
@@ -16,6 +17,17 @@
 #include "ParticleSystem.h"
 #include "Octree.h"
 #include "Terrain.h"
+#include "GeometryFrame.h"
+#include "MaterialTable.h"
+#include "GeometryArena.h"
+#include "DirtyRectSet.h"
+#include "CpuParticleSim.h"
+#include "ParticleSort.h"
+#include "MeshCache.h"
+#include "ObjParser.h"
+#include "VertexWeld.h"
+#include "MeshletBuilder.h"
+#include "MeshletCulling.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -50,7 +62,7 @@ private:
     ComPtr<ID3D12Resource> m_ambientBuffer;
     ComPtr<ID3D12Resource> m_tessBuffer;
     ComPtr<ID3D12Resource> m_materialBuffer;
-    ComPtr<ID3D12Resource> m_shadowBuffer;
+    ComPtr<ID3D12Resource> m_passBuffer;
     ComPtr<ID3D12Resource> m_postBuffer;
 
     uint8_t* m_pCbData = nullptr;
@@ -58,7 +70,20 @@ private:
     uint8_t* m_pAmbientData = nullptr;
     uint8_t* m_pTessCbData = nullptr;
     uint8_t* m_pMaterialData = nullptr;
-    uint8_t* m_pShadowCbData = nullptr;
+    uint8_t* m_pPassData = nullptr;
+
+    struct MaterialFlags
+    {
+        float useNormalMap;
+        bool useRoughMap;
+        bool useMetalMap;
+        bool useAOMap;
+    };
+
+    MaterialTable m_materialTable;
+    MaterialFlags m_materialFlags{};
+    std::vector<XMFLOAT4X4> m_objectWorlds;
+    UINT m_objectCBUploads = 0;
     uint8_t* m_pPostData = nullptr;
 
     XMMATRIX view, proj, viewProj;
@@ -70,6 +95,7 @@ private:
     XMFLOAT3 cameraPos{ 0.0f, 0.0f, 0.0f };
     float m_near = 0.1f;
     float m_far = 5000.0f;
+    float m_fovY = XM_PIDIV4;
 
     float cameraSpeed = 1.0f;
     float acceleration = 3.0f;
@@ -99,6 +125,11 @@ private:
     std::array<float, CSM_CASCADES> m_biasPerCascade{};
 
     std::unique_ptr<ParticleSystem> m_particles;
+    float m_newEmitterRate = 2000.0f;
+    std::unique_ptr<TaskPool> m_taskPool;   // общий, создаётся первым в Initialize
+    int m_cpuBenchParticles = 2000000;
+    std::vector<CpuParticleBenchmarkResult> m_cpuBenchResults;
+    std::vector<RadixSortBenchmarkResult> m_sortBenchResults;
 
     ComPtr<ID3D12Resource> m_lightAccum;
     D3D12_CPU_DESCRIPTOR_HANDLE m_lightAccumRTV{};
@@ -192,6 +223,8 @@ private:
         float strength = 0.15f;   
         float hardness = 0.5f;    
         bool  painting = false;
+        bool  hasLast = false;
+        XMFLOAT2 lastUV{};
     } m_brush;
 
     ComPtr<ID3D12Resource> m_heightDeltaTex;
@@ -199,7 +232,8 @@ private:
     int m_heightDeltaW = 1024;
     int m_heightDeltaH = 1024;
     std::vector<float> m_heightDeltaCPU;
-    std::vector<ComPtr<ID3D12Resource>> m_transientUploads;
+    // изменённые за кадр области m_heightDeltaCPU, копируются в текстуру одним пакетом
+    DirtyRectSet m_heightDirty;
 
     ComPtr<ID3D12Resource> m_uvRT;             
     D3D12_CPU_DESCRIPTOR_HANDLE m_uvRTV{};          
@@ -209,8 +243,9 @@ private:
     ComPtr<ID3D12Resource> m_uvReadback;
     UINT64 m_uvReadbackPitch = 0;
 
-    ComPtr<ID3D12Resource> m_depthStaging;
-    UINT64 m_depthRowPitch = 0;          
+    // копии глубины для кисти, запрашиваются только пока она рисует
+    static const size_t MaxDepthReadbacks = 2;
+    std::deque<ReadbackTicket> m_depthReadbacks;
     UINT m_depthWidth = 0;               
     UINT m_depthHeight = 0;
 
@@ -278,18 +313,71 @@ private:
 
     struct MeshletDrawData
     {
-        ComPtr<ID3D12Resource> meshlets;
-        ComPtr<ID3D12Resource> meshletVertices;
-        ComPtr<ID3D12Resource> meshletPrims;
+        UINT geometry = GeometryArena::Invalid;
         uint32_t meshletCount = 0;
+        uint32_t meshletVertexCount = 0;
+        uint32_t meshletPrimCount = 0;
         uint32_t srvBase = 0; 
+        std::vector<MeshletBounds> bounds;   // копия начала блоба для CullMeshlets
     };
 
+    GeometryArena m_geometry;
     std::vector<std::vector<MeshletDrawData>> m_meshletData;
-    std::vector<ComPtr<ID3D12Resource>> m_meshletUploads;
+    UINT m_geometryDefragCount = 0;
+
+    MeshCache m_meshCache;
+    std::vector<std::string> m_scenePaths;
+    std::vector<float> m_sceneLodDistances;
+    LodChainSettings m_lodSettings;
+    double m_sceneLoadMs = 0.0;
+    bool m_sceneFromCache = false;
+    std::vector<ShaderCacheBenchmarkResult> m_shaderCacheBenchResults;
+    std::vector<MeshCacheBenchmarkResult> m_meshCacheBenchResults;
+    std::vector<ObjParseBenchmarkResult> m_objParseBenchResults;
+    std::vector<VertexWeldBenchmarkResult> m_vertexWeldBenchResults;
+
+    // геометрия арены в PackedVertex (20 байт) и uint16 индексах; читается один раз в Initialize
+    bool m_packedVertices = true;
+    std::vector<VertexQuantization> m_objectQuant;
+    std::vector<VertexPackStats> m_vertexPackResults;
+    std::vector<MeshletBuilderComparison> m_meshletBuilderResults;
+
+    // отсечение мешлетов (MeshletCulling.h): в AS_MeshletCull или списком с CPU
+    MeshletCullPath m_meshletCullPath = MeshletCullPath::Amplification;
+    bool m_meshletCullFrustum = true;
+    bool m_meshletCullCone = true;
+    bool m_meshletCullOcclusion = true;
+
+    ComPtr<ID3D12Resource> m_meshletCullBuffer;    // MeshletCullConstants на объект
+    uint8_t* m_pMeshletCullData = nullptr;
+    ComPtr<ID3D12Resource> m_meshletListBuffer;    // видимые мешлеты для CpuList
+    uint32_t* m_pMeshletListData = nullptr;
+    ComPtr<ID3D12Resource> m_meshletVisibility;    // флаги AS для сверки с CPU
+    D3D12_RESOURCE_STATES m_meshletVisibilityState = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    uint32_t m_meshletCullCapacity = 0;            // сумма мешлетов по самым подробным LOD
+
+    // HiZ из глубины прошлого кадра; уровень 0 - половина экрана
+    ComPtr<ID3D12Resource> m_hiz;
+    uint32_t m_hizMips = 0;
+    UINT m_hizDescBase = 0;   // [0] вся цепочка, [1 + m] SRV уровня, [1 + mips + m] UAV уровня
+    bool m_hizBuilt = false;
+    bool m_prevDepthValid = false;
+    XMFLOAT4X4 m_prevDepthViewProj{};
+
+    bool m_meshletCullValidateRequested = false;
+    std::vector<MeshletCullCheck> m_meshletCullChecks;
+    ReadbackTicket m_meshletVisibilityTicket = InvalidReadbackTicket;
+    ReadbackTicket m_meshletDepthTicket = InvalidReadbackTicket;
+    std::vector<MeshletCullValidation> m_meshletCullValidation;
+    std::vector<MeshletCullSelfTest> m_meshletCullSelfTests;
+    std::vector<MeshletCullBenchmarkResult> m_meshletCullBenchResults;
 
     UINT drawIndexedCount = 0;
     UINT meshDispatchCount = 0;
+    UINT stateCallsIssued = 0;
+    UINT stateCallsElided = 0;
+    GeometryFrame m_geometryFrame;
+    std::vector<GeometryFrameBenchmarkResult> m_geometryFrameBenchResults;
     bool tmp = true;
 
     bool  m_autoSun = false;
@@ -342,9 +430,20 @@ private:
     void CountFPS();
 
     void SetObjects();
+    void CreateMeshletViews();
+    // заново упрощает LOD 1..N с текущими m_lodSettings; освободившиеся дыры в арене
+    // переиспользуются, а если новый LOD в них не влез - арена дефрагментируется
+    void RebuildLods();
+    // высота кадра и fovY камеры в m_lodSettings: по ним ошибка LOD переводится в пиксели
+    void UpdateLodViewSettings();
+    // false - места нет даже после Defragment
+    bool AddLodGeometry(size_t objIndex, size_t lod);
     void SetLights();
     void LoadErrorTextures();
     void LoadTextures();
+    // освобождает SRV текстур сцены и грузит их заново; индексы в материалах обновляются
+    void ReloadTextures();
+    void BuildMaterialTable();
     void CreateConstantBuffers();
 
     void UpdateUI();
@@ -355,6 +454,8 @@ private:
     void UpdateLightCB();
     void UpdatePostCB();
     void GeometryPass();
+    void BuildHiZ();
+    void ResolveMeshletCullValidation();
     void DeferredPass();
     void SetCommonHeaps();
 
@@ -382,12 +483,12 @@ private:
     void TerrainPass();
 
     void InitHeightDeltaTexture();
-    void UpdateTerrainBrush(ID3D12GraphicsCommandList* cmd, float dt);
+    void UpdateTerrainBrush(float dt);
     bool ScreenToWorldRay(float mx, float my, XMVECTOR& ro, XMVECTOR& rd);
     bool RayPlaneY0(const XMVECTOR& ro, const XMVECTOR& rd, XMFLOAT3& hit);
     bool WorldToTerrainUV(const XMFLOAT3& hit, XMFLOAT2& uv);
-    void ApplyBrushAtUV(const XMFLOAT2& uv, float dt, ID3D12GraphicsCommandList* cmd);
-    void UploadRegionToGPU(int x0, int y0, int w, int h, ID3D12GraphicsCommandList* cmd);
+    void ApplyBrushAtUV(const XMFLOAT2& uv, float dt);
+    void UploadDirtyHeightRegions(ID3D12GraphicsCommandList* cmd);
 
 
     void ApplyTAAToIntermediate(
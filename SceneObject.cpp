@@ -11,89 +11,12 @@ static inline void ThrowIfFailed(HRESULT hr)
         throw std::runtime_error("HRESULT failed");
 }
 
-void SceneObject::CreateBuffers(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList) {
+void SceneObject::CreateBuffers(DX12Framework* framework, ID3D12GraphicsCommandList* cmdList) {
     const UINT vbSize = UINT(mesh.vertices.size() * sizeof(Vertex));
     const UINT ibSize = UINT(mesh.indices.size() * sizeof(UINT32));
 
-    {
-        CD3DX12_HEAP_PROPERTIES heapDefault(D3D12_HEAP_TYPE_DEFAULT);
-        CD3DX12_RESOURCE_DESC     bufDesc = CD3DX12_RESOURCE_DESC::Buffer(vbSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapDefault,
-            D3D12_HEAP_FLAG_NONE,
-            &bufDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&vertexBuffer)
-        ));
-    }
-
-    {
-        CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
-        CD3DX12_RESOURCE_DESC     bufDesc = CD3DX12_RESOURCE_DESC::Buffer(vbSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapUpload,
-            D3D12_HEAP_FLAG_NONE,
-            &bufDesc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&vertexBufferUpload)
-        ));
-
-        void* pData = nullptr;
-        CD3DX12_RANGE readRange(0, 0);
-        ThrowIfFailed(vertexBufferUpload->Map(0, &readRange, &pData));
-        memcpy(pData, mesh.vertices.data(), vbSize);
-        vertexBufferUpload->Unmap(0, nullptr);
-
-        cmdList->CopyBufferRegion(vertexBuffer.Get(), 0, vertexBufferUpload.Get(), 0, vbSize);
-
-        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            vertexBuffer.Get(),
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            D3D12_RESOURCE_STATE_GENERIC_READ
-        );
-        cmdList->ResourceBarrier(1, &barrier);
-    }
-
-    {
-        CD3DX12_HEAP_PROPERTIES heapDefault(D3D12_HEAP_TYPE_DEFAULT);
-        CD3DX12_RESOURCE_DESC     bufDesc = CD3DX12_RESOURCE_DESC::Buffer(ibSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapDefault,
-            D3D12_HEAP_FLAG_NONE,
-            &bufDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&indexBuffer)
-        ));
-    }
-    {
-        CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
-        CD3DX12_RESOURCE_DESC     bufDesc = CD3DX12_RESOURCE_DESC::Buffer(ibSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapUpload,
-            D3D12_HEAP_FLAG_NONE,
-            &bufDesc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&indexBufferUpload)
-        ));
-
-        void* pData = nullptr;
-        CD3DX12_RANGE readRange(0, 0);
-        ThrowIfFailed(indexBufferUpload->Map(0, &readRange, &pData));
-        memcpy(pData, mesh.indices.data(), ibSize);
-        indexBufferUpload->Unmap(0, nullptr);
-
-        cmdList->CopyBufferRegion(indexBuffer.Get(), 0, indexBufferUpload.Get(), 0, ibSize);
-        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            indexBuffer.Get(),
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            D3D12_RESOURCE_STATE_GENERIC_READ
-        );
-        cmdList->ResourceBarrier(1, &barrier);
-    }
+    framework->CreateDefaultBuffer(cmdList, mesh.vertices.data(), vbSize, vertexBuffer);
+    framework->CreateDefaultBuffer(cmdList, mesh.indices.data(), ibSize, indexBuffer);
 
     vbView.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
     vbView.StrideInBytes = sizeof(Vertex);
@@ -114,114 +37,6 @@ void SceneObject::CreateBuffers(ID3D12Device* device, ID3D12GraphicsCommandList*
     XMVECTOR half = 0.5f * (vmax - vmin);
     float radius = XMVectorGetX(XMVector3Length(half));
 
-    XMStoreFloat3(&bsCenter, center);
-    bsRadius = radius;
-}
-
-void SceneObject::CreateBuffersForMesh(
-    ID3D12Device* device,
-    ID3D12GraphicsCommandList* cmdList,
-    const Mesh& m,
-    ComPtr<ID3D12Resource>& outVB,
-    ComPtr<ID3D12Resource>& outVBUpload,
-    D3D12_VERTEX_BUFFER_VIEW& outVBView,
-    ComPtr<ID3D12Resource>& outIB,
-    ComPtr<ID3D12Resource>& outIBUpload,
-    D3D12_INDEX_BUFFER_VIEW& outIBView
-)
-{
-    const UINT vbSize = UINT(m.vertices.size() * sizeof(Vertex));
-    const UINT ibSize = UINT(m.indices.size() * sizeof(UINT32));
-
-    {
-        CD3DX12_HEAP_PROPERTIES heapDefault(D3D12_HEAP_TYPE_DEFAULT);
-        auto desc = CD3DX12_RESOURCE_DESC::Buffer(vbSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapDefault,
-            D3D12_HEAP_FLAG_NONE,
-            &desc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&outVB)
-        ));
-    }
-
-    {
-        CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
-        auto desc = CD3DX12_RESOURCE_DESC::Buffer(vbSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapUpload,
-            D3D12_HEAP_FLAG_NONE,
-            &desc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&outVBUpload)
-        ));
-        void* pData = nullptr;
-        CD3DX12_RANGE readRange(0, 0);
-        outVBUpload->Map(0, &readRange, &pData);
-        memcpy(pData, m.vertices.data(), vbSize);
-        outVBUpload->Unmap(0, nullptr);
-
-        cmdList->CopyBufferRegion(outVB.Get(), 0, outVBUpload.Get(), 0, vbSize);
-        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            outVB.Get(),
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            D3D12_RESOURCE_STATE_GENERIC_READ
-        );
-        cmdList->ResourceBarrier(1, &barrier);
-    }
-
-    outVBView.BufferLocation = outVB->GetGPUVirtualAddress();
-    outVBView.SizeInBytes = vbSize;
-    outVBView.StrideInBytes = sizeof(Vertex);
-
-    {
-        CD3DX12_HEAP_PROPERTIES heapDefault(D3D12_HEAP_TYPE_DEFAULT);
-        auto desc = CD3DX12_RESOURCE_DESC::Buffer(ibSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapDefault, D3D12_HEAP_FLAG_NONE, &desc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr, IID_PPV_ARGS(&outIB)
-        ));
-    }
-    {
-        CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
-        auto desc = CD3DX12_RESOURCE_DESC::Buffer(ibSize);
-        ThrowIfFailed(device->CreateCommittedResource(
-            &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr, IID_PPV_ARGS(&outIBUpload)
-        ));
-        void* pData = nullptr;
-        CD3DX12_RANGE readRange(0, 0);
-        outIBUpload->Map(0, &readRange, &pData);
-        memcpy(pData, m.indices.data(), ibSize);
-        outIBUpload->Unmap(0, nullptr);
-
-        cmdList->CopyBufferRegion(outIB.Get(), 0, outIBUpload.Get(), 0, ibSize);
-        CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            outIB.Get(),
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            D3D12_RESOURCE_STATE_GENERIC_READ
-        );
-        cmdList->ResourceBarrier(1, &barrier);
-    }
-    outIBView.BufferLocation = outIB->GetGPUVirtualAddress();
-    outIBView.Format = DXGI_FORMAT_R32_UINT;
-    outIBView.SizeInBytes = ibSize;
-
-    DirectX::XMVECTOR vmin = XMVectorSet(FLT_MAX, FLT_MAX, FLT_MAX, 0);
-    DirectX::XMVECTOR vmax = XMVectorSet(-FLT_MAX, -FLT_MAX, -FLT_MAX, 0);
-    for (auto& v : mesh.vertices) {
-        XMVECTOR pos = XMLoadFloat3(&v.Pos);
-        vmin = XMVectorMin(vmin, pos);
-        vmax = XMVectorMax(vmax, pos);
-    }
-    XMVECTOR center = 0.5f * (vmin + vmax);
-    XMVECTOR half = 0.5f * (vmax - vmin);
-    float radius = XMVectorGetX(XMVector3Length(half));
-
     XMStoreFloat3(&bsCenter, center);
     bsRadius = radius;
 }
\ No newline at end of file
@@ -21,13 +21,12 @@ struct SceneObject {
     // 5 - AO
 
     Material material;
+    UINT materialIndex = 0;
     XMFLOAT3 bsCenter;
     float bsRadius;
 
     ComPtr<ID3D12Resource> vertexBuffer;
     ComPtr<ID3D12Resource> indexBuffer;
-    ComPtr<ID3D12Resource> vertexBufferUpload;
-    ComPtr<ID3D12Resource> indexBufferUpload;
     D3D12_VERTEX_BUFFER_VIEW vbView;
     D3D12_INDEX_BUFFER_VIEW ibView;
 
@@ -36,13 +35,9 @@ struct SceneObject {
     XMFLOAT3 scale;
 
     std::vector<Mesh> lodMeshes;
-    std::vector<ComPtr<ID3D12Resource>> lodVertexBuffers;
-    std::vector<ComPtr<ID3D12Resource>> lodVertexUploads;
-    std::vector<D3D12_VERTEX_BUFFER_VIEW> lodVBs;
-
-    std::vector<ComPtr<ID3D12Resource>> lodIndexBuffers;
-    std::vector<ComPtr<ID3D12Resource>> lodIndexUploads;
-    std::vector<D3D12_INDEX_BUFFER_VIEW> lodIBs;
+    // хэндлы в GeometryArena, по одному на LOD
+    std::vector<UINT> lodGeometry;
+    // дистанции включения LOD в единицах меша, при выборе умножаются на scale
     std::vector<float> lodDistances = { 0.0f };
 
     SceneObject() = default;
@@ -68,19 +63,7 @@ struct SceneObject {
             XMMatrixScaling(scale.x, scale.y, scale.z);
     }
 public:
-    void CreateBuffers(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
-
-    void CreateBuffersForMesh(
-        ID3D12Device* device,
-        ID3D12GraphicsCommandList* cmdList,
-        const Mesh& mesh,
-        ComPtr<ID3D12Resource>& outVB,
-        ComPtr<ID3D12Resource>& outVBUpload,
-        D3D12_VERTEX_BUFFER_VIEW& outVBView,
-        ComPtr<ID3D12Resource>& outIB,
-        ComPtr<ID3D12Resource>& outIBUpload,
-        D3D12_INDEX_BUFFER_VIEW& outIBView
-    );
+    void CreateBuffers(DX12Framework* framework, ID3D12GraphicsCommandList* cmdList);
 
     void EnsureDefaultLOD() 
     {
@@ -0,0 +1,138 @@
+#include "ShaderCache.h"
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <cstdio>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const uint64_t kFnvPrime = 1099511628211ull;
+
+    bool ReadWholeFile(const fs::path& path, std::string& out)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // #include "name" ищется относительно файла, который его подключает
+    uint64_t HashSourceTree(const fs::path& path, uint64_t h, std::set<fs::path>& visited)
+    {
+        fs::path canonical = fs::weakly_canonical(path);
+        if (!visited.insert(canonical).second)
+            return h;
+
+        std::string text;
+        if (!ReadWholeFile(path, text))
+            return ShaderCache::HashBytes("<missing>", 9, h);
+
+        h = ShaderCache::HashBytes(text.data(), text.size(), h);
+
+        size_t pos = 0;
+        while ((pos = text.find("#include", pos)) != std::string::npos)
+        {
+            pos += 8;
+            size_t open = text.find_first_of("\"<\n", pos);
+            if (open == std::string::npos || text[open] == '\n')
+                continue;
+            char closeCh = text[open] == '"' ? '"' : '>';
+            size_t close = text.find(closeCh, open + 1);
+            if (close == std::string::npos)
+                break;
+            fs::path inc = path.parent_path() / text.substr(open + 1, close - open - 1);
+            h = HashSourceTree(inc, h, visited);
+            pos = close;
+        }
+        return h;
+    }
+
+    uint64_t HashWide(const std::wstring& s, uint64_t h)
+    {
+        h = ShaderCache::HashBytes(s.data(), s.size() * sizeof(wchar_t), h);
+        return ShaderCache::HashBytes("\0", 1, h);
+    }
+}
+
+ShaderCache::ShaderCache(const std::wstring& directory)
+    : m_directory(directory)
+{
+}
+
+uint64_t ShaderCache::HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= p[i];
+        h *= kFnvPrime;
+    }
+    return h;
+}
+
+uint64_t ShaderCache::ComputeKey(const ShaderKeyDesc& desc, const std::string& compilerVersion)
+{
+    uint64_t h = HashBytes(compilerVersion.data(), compilerVersion.size());
+
+    std::set<fs::path> visited;
+    h = HashSourceTree(fs::path(desc.file), h, visited);
+
+    h = HashWide(desc.entry, h);
+    h = HashWide(desc.target, h);
+    for (const auto& d : desc.defines)
+    {
+        h = HashWide(d.first, h);
+        h = HashWide(d.second, h);
+    }
+    for (const auto& a : desc.args)
+        h = HashWide(a, h);
+    return h;
+}
+
+std::wstring ShaderCache::PathForKey(uint64_t key) const
+{
+    wchar_t name[32];
+    swprintf(name, 32, L"%016llx.dxil", (unsigned long long)key);
+    return (fs::path(m_directory) / name).wstring();
+}
+
+bool ShaderCache::Load(uint64_t key, std::vector<uint8_t>& outData) const
+{
+    std::ifstream in(fs::path(PathForKey(key)), std::ios::binary | std::ios::ate);
+    if (!in)
+        return false;
+
+    std::streamsize size = in.tellg();
+    if (size <= 0)
+        return false;
+
+    outData.resize((size_t)size);
+    in.seekg(0);
+    return (bool)in.read(reinterpret_cast<char*>(outData.data()), size);
+}
+
+void ShaderCache::Store(uint64_t key, const void* data, size_t size) const
+{
+    std::error_code ec;
+    fs::create_directories(fs::path(m_directory), ec);
+
+    // пишем во временный файл и переименовываем, чтобы не оставить обрезанный DXIL
+    fs::path finalPath(PathForKey(key));
+    fs::path tmpPath = finalPath;
+    tmpPath += L".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return;
+        out.write(static_cast<const char*>(data), (std::streamsize)size);
+        if (!out)
+            return;
+    }
+    fs::rename(tmpPath, finalPath, ec);
+    if (ec)
+        fs::remove(tmpPath, ec);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+struct ShaderKeyDesc
+{
+    std::wstring file;
+    std::wstring entry;
+    std::wstring target;
+    std::vector<std::pair<std::wstring, std::wstring>> defines;
+    std::vector<std::wstring> args;
+};
+
+// Кэш DXIL на диске. Ключ - хэш исходника со всеми #include, defines, entry, target и версии компилятора.
+class ShaderCache
+{
+public:
+    explicit ShaderCache(const std::wstring& directory = L"ShaderCache");
+
+    static uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+    static uint64_t ComputeKey(const ShaderKeyDesc& desc, const std::string& compilerVersion);
+
+    bool Load(uint64_t key, std::vector<uint8_t>& outData) const;
+    void Store(uint64_t key, const void* data, size_t size) const;
+
+    size_t GetHits() const { return m_hits; }
+    size_t GetMisses() const { return m_misses; }
+    void CountHit() { ++m_hits; }
+    void CountMiss() { ++m_misses; }
+
+private:
+    std::wstring PathForKey(uint64_t key) const;
+
+    std::wstring m_directory;
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+};
@@ -1,6 +1,15 @@
 cbuffer ObjectCB : register(b0)
 {
     row_major float4x4 World;
+    uint MaterialIndex;
+    float3 QuantOffset;  // PACKED_VERTICES: AABB   
+    float3 QuantScale;
+};
+
+#include "VertexPacking.hlsli"
+
+cbuffer PassCB : register(b5)
+{
     row_major float4x4 ViewProj;
 };
 
@@ -107,6 +116,35 @@ struct VSInput
     float handed : HAND;
 };
 
+//  ;    VSInput
+#ifdef PACKED_VERTICES
+struct VSMeshInput
+{
+    float4 pos : POSITION;
+    float2 normal : NORMAL;
+    float2 tangent : TANGENT;
+    float2 uv : TEXCOORD0;
+};
+
+MeshVertex LoadVertex(VSMeshInput IN)
+{
+    return DecodeVertex(IN.pos, IN.normal, IN.tangent, IN.uv, QuantOffset, QuantScale);
+}
+#else
+typedef VSInput VSMeshInput;
+
+MeshVertex LoadVertex(VSMeshInput IN)
+{
+    MeshVertex v;
+    v.pos = IN.pos;
+    v.normal = IN.normal;
+    v.uv = IN.uv;
+    v.tangent = IN.tangent;
+    v.handed = IN.handed;
+    return v;
+}
+#endif
+
 struct VSOutput
 {
     float4 posH : SV_POSITION;
@@ -124,6 +162,11 @@ struct GBufferOut
     float4 Params : SV_Target2;
 };
 
+struct VSPositionInput
+{
+    float3 pos : POSITION;
+};
+
 struct VSShadowOut
 {
     float4 posH : SV_POSITION;
@@ -139,10 +182,11 @@ struct Particle
 };
 
 StructuredBuffer<Particle> gParticles : register(t0, space1);
+StructuredBuffer<uint> gParticleOrder : register(t1, space1);
 
 VSOutput VS_GBufferParticle(VSInput IN, uint instanceId : SV_InstanceID)
 {
-    Particle P = gParticles[instanceId];
+    Particle P = gParticles[gParticleOrder[instanceId]];
     
     float3 local = IN.pos * P.size + P.pos;
 
@@ -172,7 +216,7 @@ GBufferOut PS_GBufferParticle(VSOutput IN)
     return OUT;
 }
 
-VSShadowOut VS_Shadow(VSInput IN)
+VSShadowOut VS_Shadow(VSPositionInput IN)
 {
     VSShadowOut OUT;
     float4 wp = mul(float4(IN.pos, 1.0), World);
@@ -230,16 +274,18 @@ uint ChooseCascade(float3 worldPos)
     return ci;
 }
 
-VSOutput VS_GBuffer(VSInput IN)
+VSOutput VS_GBuffer(VSMeshInput IN)
 {
+    MeshVertex v = LoadVertex(IN);
+
     VSOutput OUT;
-    float4 wp = mul(float4(IN.pos, 1.0), World);
+    float4 wp = mul(float4(v.pos, 1.0), World);
     OUT.worldPos = wp;
     OUT.posH = mul(wp, ViewProj);
-    OUT.normal = normalize(mul(IN.normal, (float3x3) World));
-    OUT.uv = IN.uv;
-    OUT.tangent = normalize(mul(IN.tangent, (float3x3) World));
-    OUT.handed = IN.handed;
+    OUT.normal = normalize(mul(v.normal, (float3x3) World));
+    OUT.uv = v.uv;
+    OUT.tangent = normalize(mul(v.tangent, (float3x3) World));
+    OUT.handed = v.handed;
     return OUT;
 }
 
@@ -288,13 +334,15 @@ struct VSFwdOut
     float2 uv : TEXCOORD0;
 };
 
-VSFwdOut VSMain(VSInput IN)
+VSFwdOut VSMain(VSMeshInput IN)
 {
+    MeshVertex v = LoadVertex(IN);
+
     VSFwdOut OUT;
-    float4 wp = mul(float4(IN.pos, 1.0), World);
+    float4 wp = mul(float4(v.pos, 1.0), World);
     OUT.posH = mul(wp, ViewProj);
-    OUT.normal = normalize(mul(IN.normal, (float3x3) World));
-    OUT.uv = IN.uv;
+    OUT.normal = normalize(mul(v.normal, (float3x3) World));
+    OUT.uv = v.uv;
     return OUT;
 }
 
@@ -886,15 +934,6 @@ float4 PS_PreviewGBuffer(VSQOut IN) : SV_TARGET
     return float4(color, 1.0);
 }
 
-struct MeshVertex
-{
-    float3 pos;
-    float3 normal;
-    float2 uv;
-    float3 tangent;
-    float handed;
-};
-
 struct Meshlet
 {
     uint vertexOffset;
@@ -903,11 +942,83 @@ struct Meshlet
     uint primCount;
 };
 
+#ifdef PACKED_VERTICES
+StructuredBuffer<PackedMeshVertex> gMeshVertices : register(t0, space2);
+#else
 StructuredBuffer<MeshVertex> gMeshVertices : register(t0, space2);
+#endif
 StructuredBuffer<Meshlet> gMeshlets : register(t1, space2);
 StructuredBuffer<uint> gMeshletVertices : register(t2, space2);
 StructuredBuffer<uint> gMeshletPrims : register(t3, space2);
 
+#include "MeshletCulling.hlsli"
+
+// = MeshletCullConstants (MeshletCulling.h),   
+cbuffer MeshletCullCB : register(b7)
+{
+    float4 CullPlanes[6];
+    float3 CullCameraPos;
+    uint CullFlags;
+    row_major float4x4 OccluderViewProj;
+    uint2 DepthSize;
+    uint HiZMips;
+    uint MeshletCount;
+    uint VisibilityOffset;
+    uint3 _padCull;
+};
+
+StructuredBuffer<MeshletBounds> gMeshletBounds : register(t4, space2);
+RWStructuredBuffer<uint> gMeshletVisibility : register(u0, space2);
+Texture2D<float> gHiZ : register(t0, space4);
+#ifdef MESHLET_CULL_LIST
+//   ,  CullMeshlets  CPU
+StructuredBuffer<uint> gMeshletList : register(t0, space3);
+#endif
+
+#define MESHLET_CULL_GROUP 32
+
+struct MeshletPayload
+{
+    uint meshletIndices[MESHLET_CULL_GROUP];
+};
+
+groupshared MeshletPayload gsMeshletPayload;
+groupshared uint gsMeshletVisibleMask;
+
+//  - ;     ,   CullMeshlets
+[numthreads(MESHLET_CULL_GROUP, 1, 1)]
+void AS_MeshletCull(uint dtid : SV_DispatchThreadID, uint gi : SV_GroupIndex)
+{
+    if (gi == 0)
+        gsMeshletVisibleMask = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    bool visible = false;
+    if (dtid < MeshletCount)
+    {
+        MeshletBounds b = gMeshletBounds[dtid];
+        visible = true;
+        if ((CullFlags & MESHLET_CULL_FRUSTUM) && MeshletOutsideFrustum(b, CullPlanes))
+            visible = false;
+        else if ((CullFlags & MESHLET_CULL_CONE) && MeshletBackfacing(b, CullCameraPos))
+            visible = false;
+        else if ((CullFlags & MESHLET_CULL_OCCLUSION) && MeshletOccluded(b, OccluderViewProj, DepthSize, HiZMips, gHiZ))
+            visible = false;
+
+        if (CullFlags & MESHLET_CULL_WRITE_VISIBILITY)
+            gMeshletVisibility[VisibilityOffset + dtid] = visible ? 1u : 0u;
+    }
+
+    if (visible)
+        InterlockedOr(gsMeshletVisibleMask, 1u << gi);
+    GroupMemoryBarrierWithGroupSync();
+
+    uint mask = gsMeshletVisibleMask;
+    if (visible)
+        gsMeshletPayload.meshletIndices[countbits(mask & ((1u << gi) - 1u))] = dtid;
+    DispatchMesh(countbits(mask), 1, 1, gsMeshletPayload);
+}
+
 struct MSOut
 {
     float4 posH : SV_POSITION;
@@ -931,17 +1042,31 @@ uint3 UnpackTri(uint packed)
 void MS_GBuffer(
     uint3 groupId : SV_GroupID,
     uint tid : SV_GroupIndex,
+#ifdef MESHLET_CULL_AS
+    in payload MeshletPayload payload,
+#endif
     out vertices MSOut outVerts[64],
     out indices uint3 outTris[126])
 {
-    Meshlet m = gMeshlets[groupId.x];
+#if defined(MESHLET_CULL_AS)
+    uint meshletIndex = payload.meshletIndices[groupId.x];
+#elif defined(MESHLET_CULL_LIST)
+    uint meshletIndex = gMeshletList[groupId.x];
+#else
+    uint meshletIndex = groupId.x;
+#endif
+    Meshlet m = gMeshlets[meshletIndex];
     
     SetMeshOutputCounts(m.vertexCount, m.primCount);
 
     if (tid < m.vertexCount)
     {
         uint vIdx = gMeshletVertices[m.vertexOffset + tid];
+#ifdef PACKED_VERTICES
+        MeshVertex v = UnpackMeshVertex(gMeshVertices[vIdx], QuantOffset, QuantScale);
+#else
         MeshVertex v = gMeshVertices[vIdx];
+#endif
 
         float3 p = v.pos;
 
@@ -952,7 +1077,7 @@ void MS_GBuffer(
         }
         else if (Mode == 1)
         {
-            uint h = HashU32(groupId.x * 9781u + 6271u);
+            uint h = HashU32(meshletIndex * 9781u + 6271u);
             float3 dir;
             dir.x = ((h & 1023u) / 511.5f) - 1.0f;
             dir.y = (((h >> 10) & 1023u) / 511.5f) - 1.0f;
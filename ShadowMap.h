@@ -55,7 +55,7 @@ private:
         clear.DepthStencil.Depth = 1.0f;
 
         CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_DEFAULT);
-        ThrowIfFailed(m_fw->GetDevice()->CreateCommittedResource(
+        ThrowIfFailed(m_fw->CreateResource(
             &heap, D3D12_HEAP_FLAG_NONE, &desc,
             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
             &clear, IID_PPV_ARGS(&m_tex)));
@@ -0,0 +1,97 @@
+#include "StagingPool.h"
+#include "d3dx12.h"
+#include <stdexcept>
+
+static inline void ThrowIfFailed(HRESULT hr)
+{
+    if (FAILED(hr))
+        throw std::runtime_error("HRESULT failed");
+}
+
+void StagingPool::Init(GpuHeapAllocator* allocator)
+{
+    m_allocator = allocator;
+}
+
+StagingBuffer StagingPool::Acquire(UINT64 size)
+{
+    const UINT64 rounded = (size + Granularity - 1) / Granularity * Granularity;
+
+    auto it = m_free.lower_bound(rounded);
+    if (it != m_free.end())
+    {
+        Entry entry = std::move(it->second);
+        m_free.erase(it);
+        ++m_reused;
+        return Track(std::move(entry));
+    }
+
+    Entry entry;
+    entry.size = rounded;
+
+    CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
+    auto desc = CD3DX12_RESOURCE_DESC::Buffer(rounded);
+    ThrowIfFailed(m_allocator->CreateResource(
+        &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&entry.resource)));
+
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(entry.resource->Map(0, &readRange, reinterpret_cast<void**>(&entry.cpu)));
+
+    m_residentBytes += rounded;
+    if (m_residentBytes > m_peakBytes)
+        m_peakBytes = m_residentBytes;
+    ++m_created;
+    return Track(std::move(entry));
+}
+
+StagingBuffer StagingPool::Track(Entry entry)
+{
+    entry.fence = m_nextFence;
+    m_inFlightBytes += entry.size;
+
+    StagingBuffer b;
+    b.resource = entry.resource.Get();
+    b.cpu = entry.cpu;
+    b.gpu = entry.resource->GetGPUVirtualAddress();
+    b.size = entry.size;
+
+    m_inFlight.push_back(std::move(entry));
+    return b;
+}
+
+void StagingPool::DeferRelease(ComPtr<ID3D12Resource> resource)
+{
+    Entry entry;
+    entry.resource = std::move(resource);
+    entry.fence = m_nextFence;
+    m_inFlight.push_back(std::move(entry));
+}
+
+void StagingPool::OnFenceSignaled(UINT64 signaled, UINT64 completed)
+{
+    m_nextFence = signaled + 1;
+
+    while (!m_inFlight.empty() && m_inFlight.front().fence <= completed)
+    {
+        Entry entry = std::move(m_inFlight.front());
+        m_inFlight.pop_front();
+
+        if (!entry.cpu)
+            continue;
+        m_inFlightBytes -= entry.size;
+        const UINT64 size = entry.size;
+        m_free.emplace(size, std::move(entry));
+    }
+}
+
+void StagingPool::Trim(UINT64 keepBytes)
+{
+    // сначала самые большие - обычно это разовые загрузки при старте
+    while (!m_free.empty() && GetFreeBytes() > keepBytes)
+    {
+        auto it = std::prev(m_free.end());
+        m_residentBytes -= it->first;
+        m_free.erase(it);
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include "GpuHeapAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Участок upload-буфера, постоянно отображён. cpu и gpu уже со смещением,
+// offset нужен для CopyBufferRegion/footprint (у буферов из StagingPool он 0)
+struct StagingBuffer
+{
+    ID3D12Resource* resource = nullptr;
+    uint8_t* cpu = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS gpu = 0;
+    UINT64 offset = 0;
+    UINT64 size = 0;
+};
+
+// Пул upload-буферов с привязкой к fence.
+// Выданный буфер считается занятым, пока fence не дойдёт до значения, которое выставят
+// после текущих команд; потом он возвращается в пул и выдаётся под следующие загрузки.
+class StagingPool
+{
+public:
+    // размеры округляются до размера placed-буфера
+    static const UINT64 Granularity = 64 * 1024;
+    // сколько свободных буферов держать после Trim для загрузок во время кадра
+    static const UINT64 DefaultKeepBytes = 4 * 1024 * 1024;
+
+    void Init(GpuHeapAllocator* allocator);
+
+    StagingBuffer Acquire(UINT64 size);
+    // ресурс живёт до того же fence, что и выданные сейчас буферы (старые буферы после Defragment и т.п.)
+    void DeferRelease(ComPtr<ID3D12Resource> resource);
+
+    // вызывается после каждого Signal: signaled - выставленное значение, completed - уже пройденное
+    void OnFenceSignaled(UINT64 signaled, UINT64 completed);
+
+    // отпускает свободные буферы, пока их суммарный размер больше keepBytes
+    void Trim(UINT64 keepBytes = DefaultKeepBytes);
+
+    UINT64 GetResidentBytes() const { return m_residentBytes; }
+    UINT64 GetPeakResidentBytes() const { return m_peakBytes; }
+    UINT64 GetInFlightBytes() const { return m_inFlightBytes; }
+    UINT64 GetFreeBytes() const { return m_residentBytes - m_inFlightBytes; }
+    uint32_t GetCreatedCount() const { return m_created; }
+    uint32_t GetReusedCount() const { return m_reused; }
+
+private:
+    struct Entry
+    {
+        ComPtr<ID3D12Resource> resource;
+        uint8_t* cpu = nullptr;         // nullptr - не из пула, просто отпустить
+        UINT64 size = 0;
+        UINT64 fence = 0;
+    };
+
+    StagingBuffer Track(Entry entry);
+
+    GpuHeapAllocator* m_allocator = nullptr;
+    UINT64 m_nextFence = 1;
+
+    std::multimap<UINT64, Entry> m_free;    // по размеру
+    std::deque<Entry> m_inFlight;           // fence не убывает
+
+    UINT64 m_residentBytes = 0;
+    UINT64 m_peakBytes = 0;
+    UINT64 m_inFlightBytes = 0;
+    uint32_t m_created = 0;
+    uint32_t m_reused = 0;
+};
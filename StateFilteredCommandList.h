@@ -0,0 +1,179 @@
+#pragma once
+#include <d3d12.h>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+// есть ли у списка команд DispatchMesh (ID3D12GraphicsCommandList6 и моки)
+template<typename TCmdList, typename = void>
+struct HasDispatchMesh : std::false_type {};
+
+template<typename TCmdList>
+struct HasDispatchMesh<TCmdList, std::void_t<decltype(std::declval<TCmdList&>().DispatchMesh(0u, 0u, 0u))>> : std::true_type {};
+
+// Обёртка над graphics command list, выкидывает вызовы, которые не меняют состояние.
+// TCmdList - ID3D12GraphicsCommandList или мок с теми же методами.
+// Если в тот же список писали в обход обёртки, нужно вызвать Invalidate().
+template<typename TCmdList>
+class StateFilteredCommandList
+{
+public:
+    static const UINT MaxRootParams = 16;
+
+    explicit StateFilteredCommandList(TCmdList* cmd) : m_cmd(cmd) { Invalidate(); }
+
+    void Invalidate()
+    {
+        m_rootSig = nullptr;
+        m_pso = nullptr;
+        m_topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        m_hasVB = false;
+        m_hasIB = false;
+        ResetRootParams();
+    }
+
+    void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* heaps)
+    {
+        // смена куч инвалидирует таблицы
+        ++m_issued;
+        m_cmd->SetDescriptorHeaps(count, heaps);
+        ResetRootParams();
+    }
+
+    void SetGraphicsRootSignature(ID3D12RootSignature* rs)
+    {
+        if (rs == m_rootSig) { ++m_elided; return; }
+        ++m_issued;
+        m_cmd->SetGraphicsRootSignature(rs);
+        m_rootSig = rs;
+        ResetRootParams();
+    }
+
+    void SetPipelineState(ID3D12PipelineState* pso)
+    {
+        if (pso == m_pso) { ++m_elided; return; }
+        ++m_issued;
+        m_cmd->SetPipelineState(pso);
+        m_pso = pso;
+    }
+
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+    {
+        if (topology == m_topology) { ++m_elided; return; }
+        ++m_issued;
+        m_cmd->IASetPrimitiveTopology(topology);
+        m_topology = topology;
+    }
+
+    void SetGraphicsRootConstantBufferView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address)
+    {
+        if (SameRootParam(param, RootCBV, address)) { ++m_elided; return; }
+        ++m_issued;
+        m_cmd->SetGraphicsRootConstantBufferView(param, address);
+    }
+
+    void SetGraphicsRootShaderResourceView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address)
+    {
+        if (SameRootParam(param, RootSRV, address)) { ++m_elided; return; }
+        ++m_issued;
+        m_cmd->SetGraphicsRootShaderResourceView(param, address);
+    }
+
+    void SetGraphicsRootUnorderedAccessView(UINT param, D3D12_GPU_VIRTUAL_ADDRESS address)
+    {
+        if (SameRootParam(param, RootUAV, address)) { ++m_elided; return; }
+        ++m_issued;
+        m_cmd->SetGraphicsRootUnorderedAccessView(param, address);
+    }
+
+    void SetGraphicsRootDescriptorTable(UINT param, D3D12_GPU_DESCRIPTOR_HANDLE table)
+    {
+        if (SameRootParam(param, RootTable, table.ptr)) { ++m_elided; return; }
+        ++m_issued;
+        m_cmd->SetGraphicsRootDescriptorTable(param, table);
+    }
+
+    void IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* views)
+    {
+        if (startSlot == 0 && count == 1 && m_hasVB && std::memcmp(&m_vb, views, sizeof(m_vb)) == 0)
+        {
+            ++m_elided; return;
+        }
+        ++m_issued;
+        m_cmd->IASetVertexBuffers(startSlot, count, views);
+        m_hasVB = (startSlot == 0 && count == 1);
+        if (m_hasVB) m_vb = *views;
+    }
+
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+    {
+        if (view && m_hasIB && std::memcmp(&m_ib, view, sizeof(m_ib)) == 0) { ++m_elided; return; }
+        ++m_issued;
+        m_cmd->IASetIndexBuffer(view);
+        m_hasIB = (view != nullptr);
+        if (m_hasIB) m_ib = *view;
+    }
+
+    void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)
+    {
+        m_cmd->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+    }
+
+    void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+    {
+        m_cmd->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+    }
+
+    void DispatchMesh(UINT x, UINT y, UINT z)
+    {
+        m_cmd->DispatchMesh(x, y, z);
+    }
+
+    TCmdList* Get() const { return m_cmd; }
+    TCmdList* operator->() const { return m_cmd; }
+
+    uint32_t GetIssuedCount() const { return m_issued; }
+    uint32_t GetElidedCount() const { return m_elided; }
+    void ResetCounters() { m_issued = 0; m_elided = 0; }
+
+private:
+    enum RootKind : uint8_t { RootNone, RootCBV, RootSRV, RootUAV, RootTable };
+
+    struct RootParam
+    {
+        RootKind kind;
+        UINT64 value;
+    };
+
+    void ResetRootParams()
+    {
+        for (auto& p : m_params) p = { RootNone, 0 };
+    }
+
+    // true - такой же параметр уже выставлен; иначе запоминаем новый
+    bool SameRootParam(UINT param, RootKind kind, UINT64 value)
+    {
+        if (param >= MaxRootParams)
+            return false;
+        RootParam& p = m_params[param];
+        if (p.kind == kind && p.value == value)
+            return true;
+        p = { kind, value };
+        return false;
+    }
+
+    TCmdList* m_cmd;
+
+    ID3D12RootSignature* m_rootSig;
+    ID3D12PipelineState* m_pso;
+    D3D12_PRIMITIVE_TOPOLOGY m_topology;
+    RootParam m_params[MaxRootParams];
+    D3D12_VERTEX_BUFFER_VIEW m_vb{};
+    D3D12_INDEX_BUFFER_VIEW m_ib{};
+    bool m_hasVB;
+    bool m_hasIB;
+
+    uint32_t m_issued = 0;
+    uint32_t m_elided = 0;
+};
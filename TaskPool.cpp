@@ -0,0 +1,100 @@
+#include "TaskPool.h"
+#include <algorithm>
+
+TaskPool::TaskPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = (std::max)(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 1; i < threads; ++i)
+        m_workers.emplace_back([this]() { WorkerLoop(); });
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& t : m_workers)
+        t.join();
+}
+
+void TaskPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+    if (count == 0)
+        return;
+    grain = (std::max)(grain, (size_t)1);
+
+    // один кусок или нет потоков - без синхронизации
+    if (m_workers.empty() || count <= grain)
+    {
+        for (size_t b = 0; b < count; b += grain)
+            fn(b, (std::min)(count, b + grain));
+        return;
+    }
+
+    std::lock_guard<std::mutex> call(m_callMutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fn = &fn;
+        m_count = count;
+        m_grain = grain;
+        m_next = 0;
+        m_error = nullptr;
+        m_busy = (unsigned)m_workers.size();
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    RunChunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busy == 0; });
+    m_fn = nullptr;
+
+    if (m_error)
+        std::rethrow_exception(m_error);
+}
+
+void TaskPool::RunChunks()
+{
+    for (;;)
+    {
+        const size_t b = m_next.fetch_add(m_grain);
+        if (b >= m_count)
+            break;
+        try
+        {
+            (*m_fn)(b, (std::min)(m_count, b + m_grain));
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error)
+                m_error = std::current_exception();
+        }
+    }
+}
+
+void TaskPool::WorkerLoop()
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]() { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+            seen = m_generation;
+        }
+
+        RunChunks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+            m_done.notify_one();
+    }
+}
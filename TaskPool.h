@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Постоянные рабочие потоки для ParallelFor. Вызывающий поток тоже берёт куски,
+// так что TaskPool(1) работает без дополнительных потоков.
+// Вызовы ParallelFor из разных потоков выполняются по очереди, вложенные не поддерживаются.
+class TaskPool
+{
+public:
+    // threads == 0 - по числу логических ядер
+    explicit TaskPool(unsigned threads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // fn(begin, end) на кусках [0, count) длиной grain; возвращается, когда все куски готовы.
+    // Первое исключение из fn пробрасывается вызывающему.
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+    unsigned GetThreadCount() const { return (unsigned)m_workers.size() + 1; }
+
+private:
+    void WorkerLoop();
+    void RunChunks();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_callMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation = 0;
+    unsigned m_busy = 0;
+    bool m_stop = false;
+
+    const std::function<void(size_t, size_t)>* m_fn = nullptr;
+    size_t m_count = 0;
+    size_t m_grain = 1;
+    std::atomic<size_t> m_next{ 0 };
+    std::exception_ptr m_error;
+};
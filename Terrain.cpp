@@ -36,18 +36,17 @@ void Terrain::Initialize(UINT heightSrvIdx, float worldSize, int maxDepth, float
 
 void Terrain::CreateCB()
 {
-    auto* dev = m_fw->GetDevice();
     CD3DX12_HEAP_PROPERTIES heap(D3D12_HEAP_TYPE_UPLOAD);
 
     m_cbStride = ((UINT)sizeof(VSObjCB) + 255) & ~255u;
     auto desc = CD3DX12_RESOURCE_DESC::Buffer(m_cbStride * 65536);
-    dev->CreateCommittedResource(&heap, D3D12_HEAP_FLAG_NONE, &desc,
+    m_fw->CreateResource(&heap, D3D12_HEAP_FLAG_NONE, &desc,
         D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_cb));
     m_cb->Map(0, nullptr, (void**)&m_cbPtr);
 
     m_matStride = ((UINT)sizeof(MaterialCBCPU) + 255) & ~255u;
     auto desc2 = CD3DX12_RESOURCE_DESC::Buffer(m_matStride);
-    dev->CreateCommittedResource(&heap, D3D12_HEAP_FLAG_NONE, &desc2,
+    m_fw->CreateResource(&heap, D3D12_HEAP_FLAG_NONE, &desc2,
         D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_matCB));
     m_matCB->Map(0, nullptr, (void**)&m_matPtr);
     memcpy(m_matPtr, &material, sizeof(material));
@@ -110,8 +109,8 @@ void Terrain::buildLODGrid(UINT N, bool skirts, float skirtSize, TerrainMeshLOD&
     out.vertexCount = (UINT)v.size();
     out.indexCount = (UINT)idx.size();
 
-    m_fw->CreateDefaultBuffer(cmd, v.data(), sizeof(V) * v.size(), out.vb, out.vbUpload);
-    m_fw->CreateDefaultBuffer(cmd, idx.data(), sizeof(uint32_t) * idx.size(), out.ib, out.ibUpload);
+    m_fw->CreateDefaultBuffer(cmd, v.data(), sizeof(V) * v.size(), out.vb);
+    m_fw->CreateDefaultBuffer(cmd, idx.data(), sizeof(uint32_t) * idx.size(), out.ib);
 
     out.vbv.BufferLocation = out.vb->GetGPUVirtualAddress();
     out.vbv.SizeInBytes = (UINT)(sizeof(V) * v.size());
@@ -11,7 +11,7 @@ using namespace DirectX;
 
 struct TerrainMeshLOD 
 {
-    ComPtr<ID3D12Resource> vb, ib, vbUpload, ibUpload;
+    ComPtr<ID3D12Resource> vb, ib;
     D3D12_VERTEX_BUFFER_VIEW vbv{};
     D3D12_INDEX_BUFFER_VIEW  ibv{};
     UINT indexCount = 0, vertexCount = 0;
@@ -1,6 +1,15 @@
 cbuffer ObjectCB : register(b0)
 {
     float4x4 World;
+    uint MaterialIndex;
+    float3 QuantOffset;
+    float3 QuantScale;
+};
+
+#include "VertexPacking.hlsli"
+
+cbuffer PassCB : register(b5)
+{
     float4x4 ViewProj;
 };
 
@@ -30,6 +39,15 @@ static const uint MAX_SRV = 100; // DX12Framework::srvDesc.NumDescriptors
 Texture2D<float4> gTextures[MAX_SRV] : register(t0);
 SamplerState samLinear : register(s0);
 
+#ifdef PACKED_VERTICES
+struct VSInput
+{
+    float4 pos : POSITION;
+    float2 normal : NORMAL;
+    float2 tangent : TANGENT;
+    float2 uv : TEXCOORD0;
+};
+#else
 struct VSInput
 {
     float3 pos : POSITION;
@@ -38,6 +56,7 @@ struct VSInput
     float3 tangent : TANGENT;
     float handedness : HAND;
 };
+#endif
 
 struct VSOutput
 {
@@ -76,11 +95,20 @@ struct DSOutput
 VSOutput VSMain(VSInput IN)
 {
     VSOutput o;
+#ifdef PACKED_VERTICES
+    MeshVertex v = DecodeVertex(IN.pos, IN.normal, IN.tangent, IN.uv, QuantOffset, QuantScale);
+    o.pos = v.pos;
+    o.normal = v.normal;
+    o.uv = v.uv;
+    o.tangent = v.tangent;
+    o.handedness = v.handed;
+#else
     o.pos = IN.pos;
     o.normal = IN.normal;
     o.uv = IN.uv;
     o.tangent = IN.tangent;
     o.handedness = IN.handedness;
+#endif
     return o;
 }
 
@@ -0,0 +1,157 @@
+#include "Test.h"
+#include "DescriptorAllocator.h"
+#include <algorithm>
+
+TEST(DescriptorAllocator, LowestAddressFirst)
+{
+    DescriptorAllocator a(1024, 64, 3);
+    CHECK(a.GetPersistentCapacity() == 1024 - 64 * 3);
+
+    // одиночные SRV текстур идут подряд с нуля - шейдер индексирует массив MAX_SRV
+    for (uint32_t i = 0; i < 16; ++i)
+        CHECK(a.Allocate() == i);
+    CHECK(a.GetPersistentUsed() == 16);
+    CHECK(a.GetHighWaterMark() == 16);
+
+    a.Free(3);
+    CHECK(a.Allocate() == 3);
+}
+
+TEST(DescriptorAllocator, SplitAndCoalesce)
+{
+    DescriptorAllocator a(1024 + 8, 4, 2);
+    const uint32_t capacity = a.GetPersistentCapacity();
+    const uint32_t largest = a.GetLargestFreeBlock();
+    CHECK(largest == 1024);
+
+    std::vector<uint32_t> singles;
+    for (int i = 0; i < 5; ++i)
+        singles.push_back(a.Allocate());
+    const uint32_t table = a.Allocate(3);   // класс 4
+    CHECK(table % 4 == 0);
+    CHECK(table >= 5);
+
+    for (uint32_t s : singles)
+        a.Free(s);
+    a.Free(table, 3);
+
+    CHECK(a.GetPersistentUsed() == 0);
+    CHECK(a.GetLargestFreeBlock() == largest);
+    CHECK(a.GetPersistentCapacity() == capacity);
+    CHECK(a.Allocate(1024) == 0);
+}
+
+TEST(DescriptorAllocator, NoFragmentationAcrossClasses)
+{
+    DescriptorAllocator a(256, 16, 2);
+
+    // перемешанные размеры, освобождение в другом порядке - после всего куча снова цельная
+    std::vector<std::pair<uint32_t, uint32_t>> live;
+    uint32_t seed = 12345;
+    for (int round = 0; round < 2000; ++round)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const bool alloc = live.empty() || (seed >> 16) % 3 != 0;
+        if (alloc)
+        {
+            const uint32_t count = 1 + (seed >> 24) % 8;
+            try
+            {
+                live.push_back({ a.Allocate(count), count });
+            }
+            catch (...)
+            {
+                // отказ только если нет блока нужного класса
+                uint32_t block = 1;
+                while (block < count) block <<= 1;
+                CHECK(a.GetLargestFreeBlock() < block);
+            }
+        }
+        else
+        {
+            const size_t k = (seed >> 8) % live.size();
+            a.Free(live[k].first, live[k].second);
+            live.erase(live.begin() + k);
+        }
+    }
+
+    // живые блоки не пересекаются
+    std::sort(live.begin(), live.end());
+    for (size_t i = 1; i < live.size(); ++i)
+        CHECK(live[i - 1].first + live[i - 1].second <= live[i].first);
+
+    for (auto& [index, count] : live)
+        a.Free(index, count);
+    CHECK(a.GetPersistentUsed() == 0);
+    CHECK(a.GetLargestFreeBlock() == 128);
+}
+
+TEST(DescriptorAllocator, SmallestFittingClassFirst)
+{
+    DescriptorAllocator a(64 + 8, 4, 2);
+    std::vector<uint32_t> singles;
+    for (int i = 0; i < 40; ++i)
+        singles.push_back(a.Allocate());
+    CHECK(a.GetHighWaterMark() == 40);
+
+    // свободная одиночная ячейка вверху используется раньше, чем делится блок на 8
+    a.Free(singles[33]);
+    a.Free(singles[2]);
+    a.Free(singles[3]);
+    CHECK(a.Allocate() == 33);
+    CHECK(a.Allocate(2) == 2);
+    CHECK(a.Allocate() == 40);
+    CHECK(a.GetHighWaterMark() == 41);
+}
+
+TEST(DescriptorAllocator, DoubleFreeThrows)
+{
+    DescriptorAllocator a(128, 8, 2);
+    const uint32_t i = a.Allocate();
+    a.Free(i);
+    CHECK_THROWS(a.Free(i));
+
+    const uint32_t t = a.Allocate(4);
+    CHECK_THROWS(a.Free(t, 1));         // не тот размер
+    CHECK_THROWS(a.Free(t + 1));        // середина блока
+    CHECK_THROWS(a.Free(100));          // не выдавался
+    CHECK_THROWS(a.Free(500));          // за пределами кучи
+    a.Free(t, 4);
+
+    a.Free(DescriptorAllocator::Invalid);   // Invalid игнорируется
+    CHECK(a.GetPersistentUsed() == 0);
+}
+
+TEST(DescriptorAllocator, HeapFull)
+{
+    DescriptorAllocator a(40, 4, 2);
+    CHECK(a.GetPersistentCapacity() == 32);
+    for (int i = 0; i < 32; ++i)
+        a.Allocate();
+    CHECK_THROWS(a.Allocate());
+    a.Free(7);
+    CHECK(a.Allocate() == 7);
+    CHECK_THROWS(a.Allocate(0));
+}
+
+TEST(DescriptorAllocator, TransientRing)
+{
+    DescriptorAllocator a(100, 10, 3);
+    const uint32_t base = a.GetPersistentCapacity();
+
+    a.BeginFrame(0);
+    CHECK(a.AllocateTransient(2) == base);
+    CHECK(a.AllocateTransient(3) == base + 2);
+    CHECK(a.GetTransientUsed() == 5);
+    CHECK_THROWS(a.AllocateTransient(6));
+
+    // каждый кадр в полёте пишет в свой сегмент
+    a.BeginFrame(1);
+    CHECK(a.AllocateTransient(1) == base + 10);
+    a.BeginFrame(5);
+    CHECK(a.AllocateTransient(1) == base + 20);
+    a.BeginFrame(3);
+    CHECK(a.AllocateTransient(10) == base);
+
+    CHECK_THROWS(DescriptorAllocator(30, 10, 3));
+}
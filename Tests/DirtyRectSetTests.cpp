@@ -0,0 +1,108 @@
+#include "Test.h"
+#include "DirtyRectSet.h"
+#include <random>
+
+namespace
+{
+    bool Contains(const DirtyRect& outer, const DirtyRect& inner)
+    {
+        return outer.x0 <= inner.x0 && outer.y0 <= inner.y0 && outer.x1 >= inner.x1 && outer.y1 >= inner.y1;
+    }
+
+    bool Covered(const DirtyRectSet& set, const DirtyRect& r)
+    {
+        for (const DirtyRect& d : set.GetRects())
+            if (Contains(d, r))
+                return true;
+        return false;
+    }
+}
+
+TEST(DirtyRectSet, EmptyRectIgnored)
+{
+    DirtyRectSet set;
+    set.Add({ 5, 5, 5, 10 });
+    set.Add({ 5, 5, 3, 10 });
+    CHECK(set.Empty());
+    CHECK(set.GetArea() == 0);
+}
+
+TEST(DirtyRectSet, DistantRectsStaySeparate)
+{
+    DirtyRectSet set;
+    set.Add({ 0, 0, 16, 16 });
+    set.Add({ 1000, 1000, 1016, 1016 });
+    CHECK(set.GetRects().size() == 2);
+    // одна общая рамка была бы ~1000x1000 текселей вместо 512
+    CHECK(set.GetArea() == 512);
+}
+
+TEST(DirtyRectSet, AdjacentAndNestedMerge)
+{
+    DirtyRectSet set;
+    set.Add({ 0, 0, 16, 16 });
+    set.Add({ 16, 0, 32, 16 });   // вплотную справа - без лишней площади
+    CHECK(set.GetRects().size() == 1);
+    CHECK(set.GetArea() == 32 * 16);
+
+    set.Add({ 4, 4, 8, 8 });      // внутри
+    CHECK(set.GetRects().size() == 1);
+    CHECK(set.GetArea() == 32 * 16);
+
+    // диагональный сосед: рамка вдвое больше суммы, не сливаем
+    set.Add({ 32, 16, 48, 32 });
+    CHECK(set.GetRects().size() == 2);
+}
+
+TEST(DirtyRectSet, NewRectSwallowsSeveral)
+{
+    DirtyRectSet set;
+    set.Add({ 0, 0, 4, 4 });
+    set.Add({ 20, 20, 24, 24 });
+    set.Add({ 40, 0, 44, 4 });
+    CHECK(set.GetRects().size() == 3);
+
+    set.Add({ 0, 0, 64, 64 });
+    CHECK(set.GetRects().size() == 1);
+    CHECK(set.GetArea() == 64 * 64);
+}
+
+TEST(DirtyRectSet, BrushStrokeStaysBounded)
+{
+    // кисть по ландшафту: штампы вдоль мазка, изредка - клик в другом месте
+    std::mt19937 rng(7);
+    const size_t maxRects = 8;
+    DirtyRectSet set(maxRects);
+    std::vector<DirtyRect> added;
+
+    for (int i = 0; i < 200; ++i)
+    {
+        int cx, cy;
+        if (i % 50 == 0)
+        {
+            cx = (int)(rng() % 4096);
+            cy = (int)(rng() % 4096);
+        }
+        else
+        {
+            cx = 500 + i * 6;
+            cy = 800 + (i * i) % 300;
+        }
+        const int r = 8 + (int)(rng() % 24);
+        const DirtyRect stamp{ cx - r, cy - r, cx + r, cy + r };
+        set.Add(stamp);
+        added.push_back(stamp);
+
+        CHECK(set.GetRects().size() <= maxRects);
+    }
+
+    // ни один изменённый тексель не потерян
+    for (const DirtyRect& r : added)
+        CHECK(Covered(set, r));
+
+    // и загрузка заметно меньше полной текстуры
+    CHECK(set.GetArea() < (int64_t)4096 * 4096 / 16);
+
+    set.Clear();
+    CHECK(set.Empty());
+}
@@ -0,0 +1,235 @@
+#include "Test.h"
+#include "GeometryFrame.h"
+#include "RecordingCommandList.h"
+
+namespace
+{
+    struct TestObject
+    {
+        XMFLOAT4 Color{ 1.0f, 1.0f, 1.0f, 1.0f };
+        UINT materialIndex = 0;
+        XMFLOAT3 position{ 0.0f, 0.0f, 0.0f };
+        XMFLOAT3 scale{ 1.0f, 1.0f, 1.0f };
+        std::vector<float> lodDistances = { 0.0f, 10.0f, 20.0f };
+
+        XMMATRIX GetWorldMatrix() const
+        {
+            return XMMatrixTranslation(position.x, position.y, position.z) * XMMatrixScaling(scale.x, scale.y, scale.z);
+        }
+    };
+
+    // мешлеты вокруг начала координат объекта: два смотрят на камеру, один от неё, один далеко за кадром
+    std::vector<MeshletBounds> TestBounds()
+    {
+        std::vector<MeshletBounds> out(4, MeshletBounds{});
+        const float axes[4] = { -1.0f, -1.0f, 1.0f, -1.0f };
+        for (size_t i = 0; i < out.size(); ++i)
+        {
+            out[i].radius = 0.5f;
+            out[i].center[0] = i == 3 ? 500.0f : 0.0f;
+            out[i].coneApex[0] = out[i].center[0];
+            out[i].coneApex[2] = -axes[i] * 0.5f;
+            out[i].coneAxis[2] = axes[i];
+            out[i].coneCutoff = 0.5f;
+        }
+        return out;
+    }
+}
+
+TEST(GeometryFrame, SelectLodScalesDistances)
+{
+    const std::vector<float> d = { 0.0f, 10.0f, 20.0f };
+    CHECK(SelectLod(d, { 1.0f, 1.0f, 1.0f }, 5.0f) == 0);
+    CHECK(SelectLod(d, { 1.0f, 1.0f, 1.0f }, 15.0f) == 1);
+    CHECK(SelectLod(d, { 1.0f, 1.0f, 1.0f }, 25.0f) == 2);
+    // берётся наибольшая ось масштаба
+    CHECK(SelectLod(d, { 0.5f, 2.0f, 1.0f }, 15.0f) == 0);
+    CHECK(SelectLod(d, { 0.5f, 2.0f, 1.0f }, 35.0f) == 1);
+    CHECK(SelectLod({ 0.0f }, { 1.0f, 1.0f, 1.0f }, 1e6f) == 0);
+}
+
+TEST(GeometryFrame, ObjectCBsUploadOnlyWhenMoved)
+{
+    std::vector<TestObject> objects(5);
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        objects[i].position = { (float)i, 0.0f, 0.0f };
+        objects[i].materialIndex = (UINT)(i * 3);
+    }
+    std::vector<VertexQuantization> quant(objects.size());
+    quant[2].offset = { 1.0f, 2.0f, 3.0f };
+    quant[2].scale = { 4.0f, 5.0f, 6.0f };
+
+    const UINT stride = 256;
+    std::vector<uint8_t> mapped(objects.size() * stride, 0);
+    std::vector<XMFLOAT4X4> worlds;
+
+    CHECK(PackObjectCBs(objects, quant, worlds, mapped.data(), stride) == objects.size());
+    CHECK(worlds.size() == objects.size());
+    CHECK(PackObjectCBs(objects, quant, worlds, mapped.data(), stride) == 0);
+
+    objects[2].position.y = 1.0f;
+    CHECK(PackObjectCBs(objects, quant, worlds, mapped.data(), stride) == 1);
+
+    ObjectCB cb;
+    memcpy(&cb, mapped.data() + 2 * stride, sizeof(cb));
+    XMFLOAT4X4 expected;
+    XMStoreFloat4x4(&expected, objects[2].GetWorldMatrix());
+    CHECK(memcmp(&cb.World, &expected, sizeof(expected)) == 0);
+    CHECK(cb.MaterialIndex == 6);
+    CHECK(cb.QuantOffset.z == 3.0f && cb.QuantScale.x == 4.0f);
+
+    // новый объект - снова все
+    objects.emplace_back();
+    mapped.resize(objects.size() * stride);
+    CHECK(PackObjectCBs(objects, quant, worlds, mapped.data(), stride) == objects.size());
+
+    std::vector<uint8_t> pass(sizeof(PassCB));
+    PackPassCB(XMMatrixScaling(2.0f, 2.0f, 2.0f), pass.data());
+    PassCB p;
+    memcpy(&p, pass.data(), sizeof(p));
+    CHECK(p.ViewProj._11 == 2.0f && p.ViewProj._44 == 1.0f);
+}
+
+TEST(GeometryFrame, FrameRecordsHeadless)
+{
+    // ряд объектов вдоль +Z перед камерой и один позади; чётные - мешлетные
+    std::vector<TestObject> objects(9);
+    std::vector<OctItem> items;
+    AABB bounds;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        TestObject& o = objects[i];
+        o.position = { 0.0f, 0.0f, i + 1 < objects.size() ? 4.0f + 3.0f * i : -10.0f };
+        o.materialIndex = (UINT)i % 2;
+        OctItem item;
+        item.box.minv = { o.position.x - 1.0f, o.position.y - 1.0f, o.position.z - 1.0f };
+        item.box.maxv = { o.position.x + 1.0f, o.position.y + 1.0f, o.position.z + 1.0f };
+        item.ptr = &o;
+        bounds.expand(item.box);
+        items.push_back(item);
+    }
+    objects[1].Color.w = 0.5f;
+    Octree octree;
+    octree.Build(bounds, items);
+
+    const XMMATRIX viewProj = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f),
+        XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f);
+    std::vector<TestObject*> visible;
+    QueryVisibleObjects(&octree, viewProj, visible);
+    CHECK(visible.size() == objects.size() - 1);
+
+    std::vector<uint8_t> cbs(objects.size() * 256);
+    std::vector<XMFLOAT4X4> worlds;
+    PackObjectCBs(objects, std::vector<VertexQuantization>(), worlds, cbs.data(), 256);
+
+    const std::vector<MeshletBounds> meshlets = TestBounds();
+    std::vector<int> lods(objects.size(), -1);
+    auto source = [&](size_t objIndex, int lod)
+    {
+        lods[objIndex] = lod;
+        GeometryObjectSource src;
+        src.tessellated = objIndex == 3;
+        if (objIndex % 2 == 0)
+        {
+            src.meshletCount = (UINT)meshlets.size();
+            src.meshletBounds = meshlets.data();
+        }
+        else
+        {
+            src.indexCount = 36;
+            src.firstIndex = (UINT)lod * 100;
+        }
+        return src;
+    };
+
+    GeometryFrameParams params;
+    params.objectCBs = 0x10000;
+    params.objectCBStride = 256;
+    params.materialCBs = 0x20000;
+    params.materialCBStride = 512;
+    params.cullPath = MeshletCullPath::CpuList;
+    XMStoreFloat4x4(&params.cullView.viewProj, viewProj);
+    params.cullView.occluderViewProj = params.cullView.viewProj;
+    params.cullView.flags = MeshletCullFrustum | MeshletCullCone;
+    params.worlds = worlds.data();
+    std::vector<uint32_t> list(objects.size() * meshlets.size());
+    params.listData = list.data();
+    params.listAddress = 0x40000;
+
+    GeometryFrame frame;
+    BuildGeometryDrawItems(visible, objects.data(), params, source, frame);
+    CHECK(frame.items.size() == visible.size());
+
+    size_t meshletItems = 0;
+    for (size_t i = 0; i < visible.size(); ++i)
+    {
+        const size_t objIndex = (size_t)(visible[i] - objects.data());
+        const GeometryDrawItem& item = frame.items[i];
+        CHECK(item.objectCB == 0x10000 + objIndex * 256);
+        CHECK(item.materialCB == 0x20000 + (objIndex % 2) * 512);
+        CHECK(item.transparent == (objIndex == 1));
+        CHECK(item.tessellated == (objIndex == 3));
+        CHECK(item.meshlet == (objIndex % 2 == 0));
+        const float z = objects[objIndex].position.z;
+        CHECK(lods[objIndex] == (z < 10.0f ? 0 : z < 20.0f ? 1 : 2));
+        if (item.meshlet)
+        {
+            // за кадром и от камеры отброшены, остальные - подряд в общем списке
+            CHECK(item.meshletCull == MeshletCullPath::CpuList);
+            CHECK(item.meshletCount == 2);
+            CHECK(item.meshletList == 0x40000 + meshletItems * 2 * sizeof(uint32_t));
+            ++meshletItems;
+        }
+        else
+            CHECK(item.firstIndex == (UINT)lods[objIndex] * 100);
+    }
+    CHECK(frame.listCount == meshletItems * 2);
+    CHECK(frame.cullStats.tested == meshletItems * meshlets.size());
+    CHECK(frame.cullStats.frustum == meshletItems && frame.cullStats.cone == meshletItems);
+
+    // AS: константы на объект, сверка получает смещения флагов подряд
+    std::vector<uint8_t> cull(objects.size() * 512);
+    std::vector<MeshletCullCheck> checks;
+    params.cullPath = MeshletCullPath::Amplification;
+    params.cullData = cull.data();
+    params.cullCBs = 0x30000;
+    params.cullStride = 512;
+    params.checks = &checks;
+    BuildGeometryDrawItems(visible, objects.data(), params, source, frame);
+    CHECK(checks.size() == meshletItems);
+    CHECK(frame.visibilityCount == meshletItems * meshlets.size());
+    CHECK(frame.listCount == 0 && frame.cullStats.tested == 0);
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        const MeshletCullCheck& c = checks[i];
+        CHECK(c.constants.visibilityOffset == i * meshlets.size());
+        CHECK((c.constants.flags & MeshletCullWriteVisibility) != 0);
+        CHECK(memcmp(cull.data() + c.objIndex * 512, &c.constants, sizeof(c.constants)) == 0);
+    }
+
+    RecordingCommandList rec;
+    StateFilteredCommandList<RecordingCommandList> sc(&rec);
+    GeometryPassBindings b;
+    const GeometryPassStats stats = RecordGeometryDraws(sc, b, frame.items);
+    CHECK(stats.drawIndexed + stats.meshDispatches == visible.size());
+    CHECK(rec.GetCount(RecordedOp::DispatchMesh) == meshletItems);
+}
+
+TEST(GeometryFrame, BenchmarkRunsWholeFrame)
+{
+    for (MeshletCullPath path : { MeshletCullPath::Off, MeshletCullPath::Amplification, MeshletCullPath::CpuList })
+    {
+        const GeometryFrameBenchmarkResult r = RunGeometryFrameBenchmark(512, 16, path);
+        CHECK(r.frames == 16 && r.objects == 512);
+        CHECK(r.visible > 0 && r.visible < 512ull * 16);
+        CHECK(r.drawIndexed != 0 && r.meshDispatches != 0);
+        CHECK(r.drawIndexed + r.meshDispatches <= r.visible);
+        // первый кадр пишет всё, дальше - только вращающаяся восьмая часть
+        CHECK(r.cbUploads == 512 + 15 * 64);
+        CHECK(r.stateCallsElided != 0);
+        CHECK(r.streamBytes != 0);
+        CHECK((r.cullStats.tested != 0) == (path == MeshletCullPath::CpuList));
+        CHECK(r.TotalMs() > 0.0);
+    }
+}
@@ -0,0 +1,188 @@
+#include "Test.h"
+#include "GeometryRecorder.h"
+#include "RecordingCommandList.h"
+
+namespace
+{
+    template<typename T>
+    T* Fake(uintptr_t id) { return reinterpret_cast<T*>(id * 16); }
+
+    GeometryPassBindings Bindings()
+    {
+        GeometryPassBindings b;
+        b.rootSignature = Fake<ID3D12RootSignature>(1);
+        b.meshletRootSignature = Fake<ID3D12RootSignature>(2);
+        b.gbufferPSO = Fake<ID3D12PipelineState>(10);
+        b.tessellationPSO = Fake<ID3D12PipelineState>(11);
+        b.transparentPSO = Fake<ID3D12PipelineState>(12);
+        b.meshletPSO = Fake<ID3D12PipelineState>(13);
+        b.meshletCullPSO = Fake<ID3D12PipelineState>(14);
+        b.meshletListPSO = Fake<ID3D12PipelineState>(15);
+        b.lightCB = 0x1000;
+        b.tessCB = 0x2000;
+        b.animCB = 0x3000;
+        b.passCB = 0x4000;
+        b.srvTable = { 0x100 };
+        b.samplerTable = { 0x200 };
+        b.meshletVisibility = 0x5000;
+        b.hizTable = { 0x300 };
+        return b;
+    }
+
+    // кадр как у GeometryPass: объекты в общей арене, материалы в общей таблице
+    std::vector<GeometryDrawItem> Frame(size_t opaque)
+    {
+        const D3D12_VERTEX_BUFFER_VIEW vbv{ 0x100000, 1 << 20, 32 };
+        const D3D12_INDEX_BUFFER_VIEW ibv{ 0x200000, 1 << 18, DXGI_FORMAT_R32_UINT };
+
+        std::vector<GeometryDrawItem> items;
+        for (size_t i = 0; i < opaque; ++i)
+        {
+            GeometryDrawItem item;
+            item.objectCB = 0x10000 + i * 256;
+            item.materialCB = 0x20000 + (i % 3) * 256;
+            item.vbv = vbv;
+            item.ibv = ibv;
+            item.indexCount = 36;
+            item.firstIndex = (UINT)i * 36;
+            item.baseVertex = (UINT)i * 24;
+            items.push_back(item);
+        }
+        return items;
+    }
+
+    // базовый ID3D12GraphicsCommandList: DispatchMesh нет
+    struct NoMeshCommandList
+    {
+        int draws = 0;
+        void SetDescriptorHeaps(UINT, ID3D12DescriptorHeap* const*) {}
+        void SetGraphicsRootSignature(ID3D12RootSignature*) {}
+        void SetPipelineState(ID3D12PipelineState*) {}
+        void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) {}
+        void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) {}
+        void SetGraphicsRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) {}
+        void SetGraphicsRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) {}
+        void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) {}
+        void IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW*) {}
+        void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) {}
+        void DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) { ++draws; }
+    };
+}
+
+TEST(GeometryRecorder, OpaqueFrameSharesState)
+{
+    const size_t count = 100;
+    RecordingCommandList rec;
+    StateFilteredCommandList<RecordingCommandList> sc(&rec);
+    const GeometryPassStats stats = RecordGeometryDraws(sc, Bindings(), Frame(count));
+
+    CHECK(stats.drawIndexed == count);
+    CHECK(stats.meshDispatches == 0);
+    CHECK(rec.GetDrawCount() == count);
+
+    // общее состояние - один раз на кадр, на объект - только свой CB и материал
+    CHECK(rec.GetCount(RecordedOp::SetGraphicsRootSignature) == 1);
+    CHECK(rec.GetCount(RecordedOp::SetPipelineState) == 1);
+    CHECK(rec.GetCount(RecordedOp::IASetPrimitiveTopology) == 1);
+    CHECK(rec.GetCount(RecordedOp::IASetVertexBuffers) == 1);
+    CHECK(rec.GetCount(RecordedOp::IASetIndexBuffer) == 1);
+    CHECK(rec.GetCount(RecordedOp::SetGraphicsRootDescriptorTable) == 2);
+    CHECK(rec.GetCount(RecordedOp::SetGraphicsRootConstantBufferView) == 4 + count + count);
+    CHECK(sc.GetElidedCount() > sc.GetIssuedCount());
+    CHECK(stats.stateCallsIssued == sc.GetIssuedCount() && stats.stateCallsElided == sc.GetElidedCount());
+}
+
+TEST(GeometryRecorder, StreamReplaysArguments)
+{
+    RecordingCommandList rec;
+    StateFilteredCommandList<RecordingCommandList> sc(&rec);
+    RecordGeometryDraws(sc, Bindings(), Frame(3));
+
+    UINT draw = 0;
+    for (size_t i = 0; i < rec.GetCommandCount(); ++i)
+    {
+        RecordingCommandList::Command c = rec.GetCommand(i);
+        if (c.op != RecordedOp::DrawIndexedInstanced)
+            continue;
+        const uint8_t* args = c.args;
+        const UINT indexCount = RecordingCommandList::ReadArg<UINT>(args);
+        const UINT instanceCount = RecordingCommandList::ReadArg<UINT>(args);
+        const UINT startIndex = RecordingCommandList::ReadArg<UINT>(args);
+        const INT baseVertex = RecordingCommandList::ReadArg<INT>(args);
+        CHECK(indexCount == 36);
+        CHECK(instanceCount == 1);
+        CHECK(startIndex == draw * 36);
+        CHECK(baseVertex == (INT)draw * 24);
+        ++draw;
+    }
+    CHECK(draw == 3);
+
+    rec.Reset();
+    CHECK(rec.GetCommandCount() == 0);
+    CHECK(rec.GetStreamSize() == 0);
+}
+
+TEST(GeometryRecorder, MixedFrame)
+{
+    std::vector<GeometryDrawItem> items = Frame(4);
+    items[1].tessellated = true;
+
+    GeometryDrawItem meshlet;
+    meshlet.meshlet = true;
+    meshlet.meshletCount = 70;
+    meshlet.meshletTable = { 0x400 };
+    items.push_back(meshlet);
+
+    meshlet.meshletCull = MeshletCullPath::Amplification;
+    meshlet.meshletCullCB = 0x6000;
+    items.push_back(meshlet);
+
+    meshlet.meshletCull = MeshletCullPath::CpuList;
+    meshlet.meshletCount = 0;   // всё отсечено на CPU
+    items.push_back(meshlet);
+
+    GeometryDrawItem glass = items[0];
+    glass.transparent = true;
+    items.push_back(glass);
+
+    RecordingCommandList rec;
+    StateFilteredCommandList<RecordingCommandList> sc(&rec);
+    const GeometryPassStats stats = RecordGeometryDraws(sc, Bindings(), items);
+
+    CHECK(stats.drawIndexed == 5);
+    CHECK(stats.meshDispatches == 2);
+    CHECK(rec.GetCount(RecordedOp::DispatchMesh) == 2);
+    CHECK(rec.GetCount(RecordedOp::IASetPrimitiveTopology) == 3);
+
+    // AS-путь: одна группа на 32 мешлета
+    bool found = false;
+    for (size_t i = 0; i < rec.GetCommandCount(); ++i)
+    {
+        RecordingCommandList::Command c = rec.GetCommand(i);
+        if (c.op != RecordedOp::DispatchMesh)
+            continue;
+        const uint8_t* args = c.args;
+        const UINT x = RecordingCommandList::ReadArg<UINT>(args);
+        found |= (x == 3);
+    }
+    CHECK(found);
+}
+
+TEST(GeometryRecorder, BaseListSkipsMeshlets)
+{
+    static_assert(HasDispatchMesh<RecordingCommandList>::value, "RecordingCommandList records DispatchMesh");
+    static_assert(!HasDispatchMesh<NoMeshCommandList>::value, "no DispatchMesh on the base list");
+
+    std::vector<GeometryDrawItem> items = Frame(2);
+    GeometryDrawItem meshlet;
+    meshlet.meshlet = true;
+    meshlet.meshletCount = 8;
+    items.push_back(meshlet);
+
+    NoMeshCommandList list;
+    StateFilteredCommandList<NoMeshCommandList> sc(&list);
+    const GeometryPassStats stats = RecordGeometryDraws(sc, Bindings(), items);
+    CHECK(stats.drawIndexed == 2);
+    CHECK(stats.meshDispatches == 0);
+    CHECK(list.draws == 2);
+}
@@ -0,0 +1,123 @@
+#include "Test.h"
+#include "HeapBlockPool.h"
+
+namespace
+{
+    const uint64_t KB = 1024;
+}
+
+TEST(HeapBlockPool, AlignmentInPages)
+{
+    HeapBlockPool pool(256 * KB);
+    bool newBlock = false;
+
+    // меньше страницы - всё равно целая страница
+    const HeapBlockPool::Allocation a = pool.Allocate(100, 256, newBlock);
+    CHECK(a.block == 0 && a.offset == 0 && a.size == HeapBlockPool::PageSize);
+
+    // 64 КБ - обычное выравнивание placed-ресурса; первая страница занята, отступ до 64 КБ
+    const HeapBlockPool::Allocation b = pool.Allocate(5000, 64 * KB, newBlock);
+    CHECK(b.block == 0 && b.offset == 64 * KB && b.size == 2 * HeapBlockPool::PageSize);
+    CHECK(!newBlock);
+
+    // дырка от выравнивания остаётся свободной
+    const HeapBlockPool::Allocation c = pool.Allocate(8 * KB, 0, newBlock);
+    CHECK(c.block == 0 && c.offset == HeapBlockPool::PageSize);
+    CHECK(pool.GetUsedBytes() == a.size + b.size + c.size);
+
+    // выравнивание не кратно странице или больше блока
+    CHECK(pool.Allocate(4 * KB, 6000, newBlock).block == HeapBlockPool::Invalid);
+    CHECK(pool.Allocate(4 * KB, 512 * KB, newBlock).block == HeapBlockPool::Invalid);
+    CHECK(!newBlock);
+}
+
+TEST(HeapBlockPool, ReportsNewBlocks)
+{
+    HeapBlockPool pool(64 * KB);
+    bool newBlock = false;
+
+    CHECK(pool.Allocate(40 * KB, 0, newBlock).block == 0);
+    CHECK(newBlock);
+    CHECK(pool.Allocate(16 * KB, 0, newBlock).block == 0);
+    CHECK(!newBlock);
+
+    // в первом осталось 8 КБ
+    const HeapBlockPool::Allocation big = pool.Allocate(16 * KB, 0, newBlock);
+    CHECK(big.block == 1 && big.offset == 0);
+    CHECK(newBlock);
+    CHECK(pool.Allocate(8 * KB, 0, newBlock).block == 0);
+    CHECK(!newBlock);
+
+    CHECK(pool.GetLiveBlockCount() == 2);
+    CHECK(pool.GetReservedBytes() == 128 * KB);
+}
+
+TEST(HeapBlockPool, FreeMakesRoomInSameBlock)
+{
+    HeapBlockPool pool(64 * KB);
+    bool newBlock = false;
+    HeapBlockPool::Allocation parts[4];
+    for (HeapBlockPool::Allocation& p : parts)
+        p = pool.Allocate(16 * KB, 0, newBlock);
+    CHECK(pool.GetUsedBytes() == 64 * KB);
+
+    pool.Free(parts[1]);
+    CHECK(pool.GetUsedBytes() == 48 * KB);
+    const HeapBlockPool::Allocation again = pool.Allocate(12 * KB, 0, newBlock);
+    CHECK(again.block == 0 && again.offset == parts[1].offset);
+    CHECK(!newBlock);
+
+    // Invalid - ресурс создавался отдельно, освобождать нечего
+    pool.Free(HeapBlockPool::Allocation());
+    CHECK(pool.GetUsedBytes() == 60 * KB);
+    CHECK(pool.GetLiveBlockCount() == 1);
+}
+
+TEST(HeapBlockPool, ReleaseEmptyBlocksReusesSlots)
+{
+    HeapBlockPool pool(64 * KB);
+    bool newBlock = false;
+    HeapBlockPool::Allocation blocks[3];
+    for (HeapBlockPool::Allocation& b : blocks)
+        b = pool.Allocate(64 * KB, 0, newBlock);
+    CHECK(blocks[0].block == 0 && blocks[1].block == 1 && blocks[2].block == 2);
+
+    // занятые блоки не отдаются
+    CHECK(pool.ReleaseEmptyBlocks().empty());
+
+    pool.Free(blocks[0]);
+    pool.Free(blocks[2]);
+    const std::vector<uint32_t> released = pool.ReleaseEmptyBlocks();
+    CHECK(released.size() == 2 && released[0] == 0 && released[1] == 2);
+    CHECK(pool.GetLiveBlockCount() == 1);
+    CHECK(pool.GetReservedBytes() == 64 * KB);
+    CHECK(pool.ReleaseEmptyBlocks().empty());
+
+    // новый блок занимает освобождённый слот, индексы не растут
+    const HeapBlockPool::Allocation a = pool.Allocate(4 * KB, 0, newBlock);
+    CHECK(a.block == 0 && a.offset == 0);
+    CHECK(newBlock);
+    CHECK(pool.Allocate(64 * KB, 0, newBlock).block == 2);
+    CHECK(newBlock);
+    CHECK(pool.Allocate(64 * KB, 0, newBlock).block == 3);
+    CHECK(pool.GetLiveBlockCount() == 4);
+}
+
+TEST(HeapBlockPool, OversizedGoesOutsidePool)
+{
+    HeapBlockPool pool(64 * KB);
+    bool newBlock = true;
+    const HeapBlockPool::Allocation a = pool.Allocate(64 * KB + 1, 0, newBlock);
+    CHECK(a.block == HeapBlockPool::Invalid && a.size == 0);
+    CHECK(!newBlock);
+    CHECK(pool.Allocate(0, 0, newBlock).block == HeapBlockPool::Invalid);
+    CHECK(pool.GetLiveBlockCount() == 0 && pool.GetUsedBytes() == 0);
+
+    // ровно блок - ещё в пуле
+    CHECK(pool.Allocate(64 * KB, 0, newBlock).block == 0);
+    CHECK(newBlock);
+
+    CHECK_THROWS(HeapBlockPool(0));
+    CHECK_THROWS(HeapBlockPool(6000));
+    CHECK_THROWS(pool.Init(64 * KB + 1));
+}
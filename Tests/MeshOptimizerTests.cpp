@@ -0,0 +1,158 @@
+#include "Test.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace
+{
+    // n x n квадратов, треугольники в случайном порядке - как после плохого экспорта
+    Mesh ShuffledGrid(uint32_t n, uint32_t seed)
+    {
+        Mesh m;
+        for (uint32_t y = 0; y <= n; ++y)
+        {
+            for (uint32_t x = 0; x <= n; ++x)
+            {
+                Vertex v{};
+                v.Pos = { (float)x, 0.0f, (float)y };
+                v.Normal = { 0.0f, 1.0f, 0.0f };
+                v.uv = { (float)x / n, (float)y / n };
+                m.vertices.push_back(v);
+            }
+        }
+
+        std::vector<std::array<uint32_t, 3>> tris;
+        for (uint32_t y = 0; y < n; ++y)
+        {
+            for (uint32_t x = 0; x < n; ++x)
+            {
+                const uint32_t i = y * (n + 1) + x;
+                tris.push_back({ i, i + n + 1, i + 1 });
+                tris.push_back({ i + 1, i + n + 1, i + n + 2 });
+            }
+        }
+        std::mt19937 rng(seed);
+        std::shuffle(tris.begin(), tris.end(), rng);
+        for (const auto& t : tris)
+            m.indices.insert(m.indices.end(), t.begin(), t.end());
+        return m;
+    }
+
+    // треугольник по позициям вершин, начиная с наименьшей: обход сохраняется, номера вершин - нет
+    std::vector<std::array<float, 9>> TriangleSet(const Mesh& m)
+    {
+        std::vector<std::array<float, 9>> out;
+        for (size_t t = 0; t + 2 < m.indices.size(); t += 3)
+        {
+            std::array<std::array<float, 3>, 3> p;
+            for (int k = 0; k < 3; ++k)
+            {
+                const XMFLOAT3& v = m.vertices[m.indices[t + k]].Pos;
+                p[k] = { v.x, v.y, v.z };
+            }
+            const int first = (int)(std::min_element(p.begin(), p.end()) - p.begin());
+            std::array<float, 9> key;
+            for (int k = 0; k < 3; ++k)
+                for (int c = 0; c < 3; ++c)
+                    key[k * 3 + c] = p[(first + k) % 3][c];
+            out.push_back(key);
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+}
+
+TEST(MeshOptimizer, AnalyzeFifoCache)
+{
+    // кэш на 3 вершины: 0 1 2 - три промаха, 2 1 3 - один, 0 - вытеснена и снова промах
+    const std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3, 3, 1, 0 };
+    const VertexCacheStats s = AnalyzeVertexCache(indices, 4, 16, 3);
+    CHECK(s.triangles == 3);
+    CHECK(s.vertices == 4);
+    CHECK(s.transformed == 5);
+    CHECK(s.Acmr() == 5.0 / 3.0);
+    CHECK(s.Atvr() == 5.0 / 4.0);
+    // 4 вершины по 16 байт лежат в одной 64-байтной строке
+    CHECK(s.fetchedBytes == 64);
+
+    VertexCacheStats sum = s;
+    sum += s;
+    CHECK(sum.transformed == 10 && sum.triangles == 6);
+}
+
+TEST(MeshOptimizer, ShuffledGridAcmr)
+{
+    Mesh m = ShuffledGrid(64, 1u);
+    const auto before = TriangleSet(m);
+
+    MeshOptimizeStats stats;
+    OptimizeMesh(m, &stats);
+
+    CHECK(stats.before.triangles == 64 * 64 * 2);
+    CHECK(stats.after.triangles == stats.before.triangles);
+    // в случайном порядке почти каждая вершина считается заново
+    CHECK(stats.before.Acmr() > 2.5);
+    // Tipsify с кэшем 16 на регулярной сетке: ~0.61 при идеале 0.5
+    CHECK(stats.after.Acmr() < 0.7);
+    CHECK(stats.after.Atvr() < 1.3);
+    // после OptimizeVertexFetch буфер читается почти подряд
+    CHECK(stats.after.Overfetch(sizeof(Vertex)) < 1.35);
+    CHECK(stats.after.Overfetch(sizeof(Vertex)) < stats.before.Overfetch(sizeof(Vertex)));
+
+    CHECK(m.vertices.size() == 65 * 65);
+    CHECK(TriangleSet(m) == before);
+}
+
+TEST(MeshOptimizer, VertexCacheKeepsTriangles)
+{
+    Mesh m = ShuffledGrid(16, 2u);
+    std::vector<uint32_t> clusters;
+    const std::vector<uint32_t> order = OptimizeVertexCache(m.indices, m.vertices.size(), MeshOptimizerCacheSize, &clusters);
+    CHECK(order.size() == m.indices.size());
+    CHECK(!clusters.empty() && clusters[0] == 0);
+    CHECK(std::is_sorted(clusters.begin(), clusters.end()));
+    CHECK(clusters.back() < order.size() / 3);
+
+    Mesh reordered = m;
+    reordered.indices = order;
+    CHECK(TriangleSet(reordered) == TriangleSet(m));
+
+    const std::vector<uint32_t> overdraw = OptimizeOverdraw(order, clusters, &m.vertices[0].Pos, sizeof(Vertex), m.vertices.size());
+    reordered.indices = overdraw;
+    CHECK(TriangleSet(reordered) == TriangleSet(m));
+    // дробление кластеров не портит ACMR больше порога 1.05
+    const double cacheAcmr = AnalyzeVertexCache(order, m.vertices.size(), sizeof(Vertex)).Acmr();
+    CHECK(AnalyzeVertexCache(overdraw, m.vertices.size(), sizeof(Vertex)).Acmr() <= cacheAcmr * 1.05 + 1e-9);
+}
+
+TEST(MeshOptimizer, VertexFetchOrdersByFirstUse)
+{
+    Mesh m;
+    m.vertices.resize(6);
+    for (size_t i = 0; i < m.vertices.size(); ++i)
+        m.vertices[i].Pos = { (float)i, 0.0f, 0.0f };
+    // вершина 1 не используется
+    m.indices = { 5, 3, 0, 0, 3, 2, 4, 5, 2 };
+
+    CHECK(OptimizeVertexFetch(m.vertices, m.indices) == 5);
+    CHECK((m.indices == std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3, 4, 0, 3 }));
+    const float expected[] = { 5, 3, 0, 2, 4 };
+    for (size_t i = 0; i < 5; ++i)
+        CHECK(m.vertices[i].Pos.x == expected[i]);
+}
+
+TEST(MeshOptimizer, EmptyAndDegenerateInput)
+{
+    Mesh empty;
+    MeshOptimizeStats stats;
+    OptimizeMesh(empty, &stats);
+    CHECK(stats.before.Acmr() == 0.0 && stats.after.Acmr() == 0.0);
+
+    // неполный треугольник не трогается
+    Mesh broken;
+    broken.vertices.resize(2);
+    broken.indices = { 0, 1 };
+    OptimizeMesh(broken);
+    CHECK(broken.indices.size() == 2);
+}
@@ -0,0 +1,178 @@
+#include "Test.h"
+#include "MeshSimplifier.h"
+#include "ObjImport.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+    float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+
+    // расстояние от точки до треугольника (Эриксон, Real-Time Collision Detection 5.1.5)
+    float PointTriangleDistance(const XMFLOAT3& p, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+    {
+        const XMFLOAT3 ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+        auto At = [&](float v, float w)
+        {
+            const XMFLOAT3 q = { a.x + ab.x * v + ac.x * w, a.y + ab.y * v + ac.y * w, a.z + ab.z * v + ac.z * w };
+            const XMFLOAT3 d = Sub(p, q);
+            return std::sqrt(Dot(d, d));
+        };
+
+        const float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return At(0.0f, 0.0f);
+        const XMFLOAT3 bp = Sub(p, b);
+        const float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3) return At(1.0f, 0.0f);
+        const float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return At(d1 / (d1 - d3), 0.0f);
+        const XMFLOAT3 cp = Sub(p, c);
+        const float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6) return At(0.0f, 1.0f);
+        const float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return At(0.0f, d2 / (d2 - d6));
+        const float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        {
+            const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            return At(1.0f - w, w);
+        }
+        const float denom = 1.0f / (va + vb + vc);
+        return At(vb * denom, vc * denom);
+    }
+
+    // перебором: наибольшее расстояние от вершин original до треугольников simplified
+    float BruteForceError(const Mesh& original, const Mesh& simplified)
+    {
+        float worst = 0.0f;
+        for (const Vertex& v : original.vertices)
+        {
+            float best = FLT_MAX;
+            for (size_t t = 0; t + 2 < simplified.indices.size(); t += 3)
+            {
+                best = (std::min)(best, PointTriangleDistance(v.Pos,
+                    simplified.vertices[simplified.indices[t]].Pos,
+                    simplified.vertices[simplified.indices[t + 1]].Pos,
+                    simplified.vertices[simplified.indices[t + 2]].Pos));
+            }
+            worst = (std::max)(worst, best);
+        }
+        return worst;
+    }
+
+    // радиус меша в смысле SimplifySettings::maxError - половина диагонали AABB
+    float MeshRadius(const Mesh& m)
+    {
+        XMFLOAT3 lo = { FLT_MAX, FLT_MAX, FLT_MAX }, hi = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (const Vertex& v : m.vertices)
+        {
+            lo = { (std::min)(lo.x, v.Pos.x), (std::min)(lo.y, v.Pos.y), (std::min)(lo.z, v.Pos.z) };
+            hi = { (std::max)(hi.x, v.Pos.x), (std::max)(hi.y, v.Pos.y), (std::max)(hi.z, v.Pos.z) };
+        }
+        const XMFLOAT3 d = Sub(hi, lo);
+        return 0.5f * std::sqrt(Dot(d, d));
+    }
+
+    Mesh Scaled(Mesh m, float s)
+    {
+        for (Vertex& v : m.vertices)
+            v.Pos = { v.Pos.x * s, v.Pos.y * s, v.Pos.z * s };
+        return m;
+    }
+}
+
+TEST(MeshSimplifier, DistancesProjectErrorToPixelError)
+{
+    LodChainSettings s;
+    s.pixelError = 2.0f;
+    s.screenHeight = 1440.0f;
+    s.fovY = 1.0f;
+    const std::vector<float> errors = { 0.0f, 0.01f, 0.005f, 0.04f };
+    const std::vector<float> d = LodDistancesFromErrors(errors, s);
+
+    CHECK(d.size() == errors.size());
+    CHECK(d[0] == 0.0f);
+    CHECK(std::is_sorted(d.begin(), d.end()));
+    // ошибка меньше, чем у предыдущего LOD, не включает его раньше
+    CHECK(d[2] == d[1]);
+
+    // на своей дистанции ошибка LOD занимает ровно pixelError пикселей
+    for (size_t i : { (size_t)1, (size_t)3 })
+    {
+        const float pixels = errors[i] * s.screenHeight / (2.0f * d[i] * std::tan(s.fovY * 0.5f));
+        CHECK(std::fabs(pixels - s.pixelError) < 1e-4f);
+    }
+
+    // вдвое выше кадр - ошибка видна вдвое дальше; уже fov - тоже дальше
+    LodChainSettings tall = s;
+    tall.screenHeight *= 2.0f;
+    CHECK(std::fabs(LodDistancesFromErrors(errors, tall)[3] - 2.0f * d[3]) < 1e-3f * d[3]);
+    LodChainSettings narrow = s;
+    narrow.fovY = 0.5f;
+    CHECK(LodDistancesFromErrors(errors, narrow)[3] > d[3]);
+}
+
+TEST(MeshSimplifier, MeasuredErrorMatchesBruteForce)
+{
+    const Mesh sphere = CreateSphere(48, 48, 1.0f);
+    CHECK(MeasureSimplifyError(sphere, sphere) == 0.0f);
+
+    SimplifySettings settings;
+    settings.maxError = 0.05f;
+    for (float ratio : { 0.5f, 0.25f, 0.1f })
+    {
+        const size_t target = (size_t)(sphere.indices.size() / 3 * ratio);
+        float quadricError = -1.0f;
+        const Mesh lod = SimplifyMesh(sphere, target, settings, &quadricError);
+        CHECK(!lod.indices.empty());
+        CHECK(lod.indices.size() / 3 < sphere.indices.size() / 3);
+
+        const float measured = MeasureSimplifyError(sphere, lod);
+        const float brute = BruteForceError(sphere, lod);
+        CHECK(std::fabs(measured - brute) <= 1e-5f + 1e-3f * brute);
+
+        // квадрики не дают уйти дальше maxError радиусов; реальное отклонение - не больше двух таких
+        const float bound = settings.maxError * MeshRadius(sphere);
+        CHECK(quadricError >= 0.0f && quadricError <= bound * 1.0001f);
+        CHECK(measured <= 2.0f * bound);
+    }
+}
+
+TEST(MeshSimplifier, ErrorIsInMeshUnits)
+{
+    // дистанции LOD хранятся в единицах меша, а масштаб объекта применяется при выборе LOD
+    const Mesh sphere = CreateSphere(32, 32, 1.0f);
+    SimplifySettings settings;
+    const Mesh lod = SimplifyMesh(sphere, sphere.indices.size() / 3 / 4, settings);
+    const float unit = MeasureSimplifyError(sphere, lod);
+    const float scaled = MeasureSimplifyError(Scaled(sphere, 10.0f), Scaled(lod, 10.0f));
+    CHECK(unit > 0.0f);
+    CHECK(std::fabs(scaled - 10.0f * unit) < 1e-3f * scaled);
+}
+
+TEST(MeshSimplifier, LodChainErrorsAndDistances)
+{
+    std::vector<ImportedObject> objects(2);
+    objects[0].lodMeshes = { CreateSphere(48, 48, 1.0f) };
+    objects[1].lodMeshes = { CreateSphere(24, 24, 3.0f) };
+
+    LodChainSettings settings;
+    settings.simplify.maxError = 0.1f;
+    GenerateLodChain(objects, settings, nullptr);
+
+    for (const ImportedObject& o : objects)
+    {
+        CHECK(o.lodMeshes.size() > 1);
+        CHECK(o.lodErrors.size() == o.lodMeshes.size());
+        CHECK(o.lodDistances == LodDistancesFromErrors(o.lodErrors, settings));
+        CHECK(o.lodErrors[0] == 0.0f);
+        for (size_t k = 1; k < o.lodMeshes.size(); ++k)
+        {
+            CHECK(o.lodMeshes[k].indices.size() < o.lodMeshes[k - 1].indices.size());
+            CHECK(o.lodErrors[k] == MeasureSimplifyError(o.lodMeshes[0], o.lodMeshes[k]));
+            CHECK(o.lodErrors[k] <= 2.0f * settings.simplify.maxError * MeshRadius(o.lodMeshes[0]));
+        }
+    }
+}
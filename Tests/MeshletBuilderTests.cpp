@@ -0,0 +1,229 @@
+#include "Test.h"
+#include "MeshletBuilder.h"
+#include "MeshCacheFormat.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    typedef std::array<uint32_t, 3> Tri;
+
+    // наименьший индекс первым, обход сохраняется
+    Tri Canonical(uint32_t a, uint32_t b, uint32_t c)
+    {
+        if (b < a && b <= c) return { b, c, a };
+        if (c < a && c < b) return { c, a, b };
+        return { a, b, c };
+    }
+
+    struct Vec { float x, y, z; };
+    Vec Sub(const Vec& a, const Vec& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    float Dot(const Vec& a, const Vec& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Vec Cross(const Vec& a, const Vec& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    float Length(const Vec& a) { return std::sqrt(Dot(a, a)); }
+
+    struct Positions
+    {
+        const XMFLOAT3* data;
+        size_t stride;
+        Vec operator()(uint32_t i) const
+        {
+            const XMFLOAT3& p = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(data) + i * stride);
+            return { p.x, p.y, p.z };
+        }
+    };
+
+    struct Result
+    {
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> verts, prims;
+        bool trianglesOnce = true;
+        bool limits = true;
+        bool bounds = true;
+        size_t cullableCones = 0;
+    };
+
+    // строит кластерные мешлеты с лимитами кэша и проверяет их независимо от CompareMeshletBuilders
+    Result BuildAndCheck(const std::vector<uint32_t>& indices, const XMFLOAT3* data, size_t stride, size_t vertexCount)
+    {
+        Result r;
+        const uint32_t maxVerts = MeshCacheMeshletMaxVerts, maxPrims = MeshCacheMeshletMaxPrims;
+        BuildMeshlets_Clustered(indices, data, stride, vertexCount, maxVerts, maxPrims, MeshletConeWeight,
+            r.meshlets, r.verts, r.prims);
+        const Positions P{ data, stride };
+
+        std::vector<Tri> source, built;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+            source.push_back(Canonical(indices[t], indices[t + 1], indices[t + 2]));
+
+        uint32_t vertexOffset = 0, primOffset = 0;
+        for (const Meshlet& m : r.meshlets)
+        {
+            // лимиты и плотная упаковка таблиц
+            if (m.vertexCount == 0 || m.vertexCount > maxVerts || m.primCount == 0 || m.primCount > maxPrims)
+                r.limits = false;
+            if (m.vertexOffset != vertexOffset || m.primOffset != primOffset)
+                r.limits = false;
+            vertexOffset += m.vertexCount;
+            primOffset += m.primCount;
+
+            std::vector<uint32_t> local(r.verts.begin() + m.vertexOffset, r.verts.begin() + m.vertexOffset + m.vertexCount);
+            std::sort(local.begin(), local.end());
+            if (std::adjacent_find(local.begin(), local.end()) != local.end())
+                r.limits = false;
+
+            const MeshletBounds b = ComputeMeshletBounds(m, r.verts, r.prims, data, stride);
+            const Vec center = { b.center[0], b.center[1], b.center[2] };
+            const Vec axis = { b.coneAxis[0], b.coneAxis[1], b.coneAxis[2] };
+            const Vec apex = { b.coneApex[0], b.coneApex[1], b.coneApex[2] };
+            const float eps = 1e-4f * (b.radius + Length(center));
+            // cutoff - синус половины раствора, нормали не дальше косинуса от оси
+            const float minDot = std::sqrt((std::max)(1.0f - b.coneCutoff * b.coneCutoff, 0.0f));
+            if (b.coneCutoff < 1.0f)
+                ++r.cullableCones;
+
+            for (uint32_t i = 0; i < m.vertexCount; ++i)
+                if (Length(Sub(P(r.verts[m.vertexOffset + i]), center)) > b.radius + eps)
+                    r.bounds = false;
+
+            for (uint32_t p = 0; p < m.primCount; ++p)
+            {
+                const uint32_t packed = r.prims[m.primOffset + p];
+                const uint32_t l[3] = { packed & 0xFFu, (packed >> 8) & 0xFFu, (packed >> 16) & 0xFFu };
+                if (l[0] >= m.vertexCount || l[1] >= m.vertexCount || l[2] >= m.vertexCount || (packed >> 24) != 0)
+                {
+                    r.limits = false;
+                    continue;
+                }
+                const uint32_t g[3] = { r.verts[m.vertexOffset + l[0]], r.verts[m.vertexOffset + l[1]], r.verts[m.vertexOffset + l[2]] };
+                built.push_back(Canonical(g[0], g[1], g[2]));
+
+                if (b.coneCutoff >= 1.0f)
+                    continue;
+                const Vec n = Cross(Sub(P(g[1]), P(g[0])), Sub(P(g[2]), P(g[0])));
+                const float len = Length(n);
+                if (len == 0.0f)
+                    continue;
+                const Vec nn = { n.x / len, n.y / len, n.z / len };
+                // треугольник в конусе и перед вершиной конуса
+                if (Dot(nn, axis) < minDot - 1e-3f || Dot(Sub(apex, P(g[0])), nn) > eps)
+                    r.bounds = false;
+            }
+        }
+
+        std::sort(source.begin(), source.end());
+        std::sort(built.begin(), built.end());
+        r.trianglesOnce = source == built;
+        return r;
+    }
+
+    Result BuildAndCheck(const Mesh& mesh)
+    {
+        return BuildAndCheck(mesh.indices, &mesh.vertices[0].Pos, sizeof(Vertex), mesh.vertices.size());
+    }
+
+    // плоская сетка n x n квадратов в XZ, нормали по cross(b - a, c - a) смотрят в +Y
+    Mesh Grid(uint32_t n)
+    {
+        Mesh m;
+        for (uint32_t z = 0; z <= n; ++z)
+            for (uint32_t x = 0; x <= n; ++x)
+            {
+                Vertex v{};
+                v.Pos = { (float)x, 0.0f, (float)z };
+                m.vertices.push_back(v);
+            }
+        for (uint32_t z = 0; z < n; ++z)
+            for (uint32_t x = 0; x < n; ++x)
+            {
+                const uint32_t i = z * (n + 1) + x;
+                m.indices.insert(m.indices.end(), { i, i + n + 1, i + 1, i + 1, i + n + 1, i + n + 2 });
+            }
+        return m;
+    }
+}
+
+TEST(MeshletBuilder, SphereTrianglesOnceWithinLimits)
+{
+    for (int segments : { 6, 32, 96 })
+    {
+        const Mesh mesh = CreateSphere(segments, segments, 2.0f);
+        const Result r = BuildAndCheck(mesh);
+        CHECK(r.trianglesOnce);
+        CHECK(r.limits);
+        CHECK(r.bounds);
+        CHECK(r.meshlets.size() >= (mesh.indices.size() / 3 + MeshCacheMeshletMaxPrims - 1) / MeshCacheMeshletMaxPrims);
+    }
+}
+
+TEST(MeshletBuilder, FlatGridConesAreTight)
+{
+    const Mesh mesh = Grid(40);
+    const Result r = BuildAndCheck(mesh);
+    CHECK(r.trianglesOnce && r.limits && r.bounds);
+
+    // все нормали одинаковы: каждый конус отсекает и смотрит вдоль нормали
+    CHECK(r.cullableCones == r.meshlets.size());
+    bool alongNormal = true;
+    for (const Meshlet& m : r.meshlets)
+    {
+        const MeshletBounds b = ComputeMeshletBounds(m, r.verts, r.prims, &mesh.vertices[0].Pos, sizeof(Vertex));
+        alongNormal &= b.coneAxis[1] > 0.999f && b.coneCutoff < 0.01f;
+    }
+    CHECK(alongNormal);
+}
+
+TEST(MeshletBuilder, ScatteredTrianglesAndStride)
+{
+    // несвязные треугольники со случайным обходом и общими вершинами; позиции с шагом 20 байт
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> coord(-50.0f, 50.0f);
+    const size_t vertexCount = 3000;
+    std::vector<float> raw(vertexCount * 5, 0.0f);
+    for (size_t i = 0; i < vertexCount; ++i)
+        for (int k = 0; k < 3; ++k)
+            raw[i * 5 + k] = coord(rng);
+
+    std::vector<uint32_t> indices;
+    for (int t = 0; t < 2500; ++t)
+    {
+        const uint32_t a = (uint32_t)(rng() % vertexCount);
+        uint32_t b = (uint32_t)(rng() % vertexCount), c = (uint32_t)(rng() % vertexCount);
+        if (b == a) b = (a + 1) % vertexCount;
+        if (c == a || c == b) c = (uint32_t)((std::max)(a, b) + 1) % vertexCount;
+        indices.insert(indices.end(), { a, b, c });
+    }
+    // один и тот же треугольник дважды - оба экземпляра должны остаться
+    indices.insert(indices.end(), { indices[0], indices[1], indices[2] });
+
+    const Result r = BuildAndCheck(indices, reinterpret_cast<const XMFLOAT3*>(raw.data()), 5 * sizeof(float), vertexCount);
+    CHECK(r.trianglesOnce);
+    CHECK(r.limits);
+    CHECK(r.bounds);
+}
+
+TEST(MeshletBuilder, EmptyAndTinyMeshes)
+{
+    std::vector<Meshlet> meshlets(3);
+    std::vector<uint32_t> verts(5), prims(5);
+    const XMFLOAT3 p[3] = { { 0, 0, 0 }, { 0, 1, 0 }, { 1, 0, 0 } };
+    BuildMeshlets_Clustered({}, p, sizeof(XMFLOAT3), 3, MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims,
+        MeshletConeWeight, meshlets, verts, prims);
+    CHECK(meshlets.empty() && verts.empty() && prims.empty());
+
+    const Result one = BuildAndCheck({ 0, 1, 2 }, p, sizeof(XMFLOAT3), 3);
+    CHECK(one.meshlets.size() == 1);
+    CHECK(one.meshlets[0].vertexCount == 3 && one.meshlets[0].primCount == 1);
+    CHECK(one.trianglesOnce && one.limits && one.bounds);
+}
+
+TEST(MeshletBuilder, ComparisonAgreesOnSphere)
+{
+    const MeshletBuilderComparison c = CompareMeshletBuilders(CreateSphere(40, 40, 1.0f),
+        MeshCacheMeshletMaxVerts, MeshCacheMeshletMaxPrims);
+    CHECK(c.valid);
+    CHECK(c.clustered.triangles == c.greedy.triangles);
+    CHECK(c.clustered.maxVerts == MeshCacheMeshletMaxVerts && c.clustered.maxPrims == MeshCacheMeshletMaxPrims);
+}
@@ -0,0 +1,201 @@
+#include "Test.h"
+#include "MeshletCulling.h"
+#include <cmath>
+#include <random>
+
+namespace
+{
+    // MeshletOutsideFrustum и MeshletBackfacing из MeshletCulling.hlsli строка в строку. precise там
+    // запрещает FMA; сборка тестов их и так не склеивает
+    float ShaderDot3(const float a[3], const float b[3])
+    {
+        return (a[0] * b[0] + a[1] * b[1]) + a[2] * b[2];
+    }
+
+    bool ShaderOutsideFrustum(const MeshletBounds& b, const MeshletCullConstants& c)
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            const float n[3] = { c.planes[i].x, c.planes[i].y, c.planes[i].z };
+            const float d = ShaderDot3(n, b.center) + c.planes[i].w;
+            if (d < -b.radius)
+                return true;
+        }
+        return false;
+    }
+
+    bool ShaderBackfacing(const MeshletBounds& b, const MeshletCullConstants& c)
+    {
+        if (!(b.coneCutoff < 1.0f))
+            return false;
+        const float d[3] = { b.coneApex[0] - c.cameraPos.x, b.coneApex[1] - c.cameraPos.y, b.coneApex[2] - c.cameraPos.z };
+        const float t = ShaderDot3(d, b.coneAxis);
+        if (!(t > 0.0f))
+            return false;
+        const float dd = ShaderDot3(d, d);
+        return t * t >= (b.coneCutoff * b.coneCutoff) * dd;
+    }
+
+    MeshletCullConstants MakeConstants(uint32_t flags, uint32_t meshlets)
+    {
+        MeshletCullView view;
+        const XMMATRIX viewProj = XMMatrixLookAtLH(XMVectorSet(0.3f, -0.2f, -4.0f, 1.0f), XMVectorSet(0.5f, 0.1f, 0.0f, 1.0f),
+            XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * XMMatrixPerspectiveFovLH(0.7f, 16.0f / 9.0f, 0.1f, 20.0f);
+        XMStoreFloat4x4(&view.viewProj, viewProj);
+        view.occluderViewProj = view.viewProj;
+        view.cameraPos = { 0.3f, -0.2f, -4.0f };
+        view.depthWidth = 64;
+        view.depthHeight = 36;
+        view.flags = flags;
+
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, XMMatrixRotationRollPitchYaw(0.0f, 0.4f, 0.0f) * XMMatrixTranslation(0.2f, 0.0f, 0.5f));
+        return MakeMeshletCullConstants(world, view, meshlets);
+    }
+
+    std::vector<MeshletBounds> RandomBounds(size_t count, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> pos(-6.0f, 6.0f), unit(-1.0f, 1.0f), radius(0.01f, 1.5f);
+        std::vector<MeshletBounds> out(count);
+        for (MeshletBounds& b : out)
+        {
+            b = MeshletBounds{};
+            for (int k = 0; k < 3; ++k)
+            {
+                b.center[k] = pos(rng);
+                b.coneApex[k] = b.center[k] + unit(rng);
+                b.coneAxis[k] = unit(rng);
+            }
+            const float len = std::sqrt(b.coneAxis[0] * b.coneAxis[0] + b.coneAxis[1] * b.coneAxis[1] + b.coneAxis[2] * b.coneAxis[2]);
+            for (float& a : b.coneAxis)
+                a /= len;
+            b.radius = radius(rng);
+            b.coneCutoff = rng() % 8 == 0 ? 1.0f : unit(rng);
+        }
+        return out;
+    }
+}
+
+TEST(MeshletCulling, SelfTest)
+{
+    // пирамида против перебора, очевидные случаи и консервативность на случайных World и камерах
+    const MeshletCullSelfTest r = RunMeshletCullSelfTest();
+    CHECK(r.checks > 1000);
+    CHECK(r.failures == 0);
+    CHECK(r.stats.frustum != 0 && r.stats.cone != 0 && r.stats.occluded != 0 && r.stats.visible != 0);
+}
+
+TEST(MeshletCulling, DecisionsMatchShaderArithmetic)
+{
+    const std::vector<MeshletBounds> bounds = RandomBounds(200000, 3u);
+    const MeshletCullConstants frustum = MakeConstants(MeshletCullFrustum, (uint32_t)bounds.size());
+    const MeshletCullConstants cone = MakeConstants(MeshletCullCone, (uint32_t)bounds.size());
+
+    size_t outside = 0, backfacing = 0;
+    for (const MeshletBounds& b : bounds)
+    {
+        const bool o = ShaderOutsideFrustum(b, frustum);
+        const bool f = ShaderBackfacing(b, cone);
+        CHECK((CullMeshlet(b, frustum, nullptr) == MeshletCullResult::Frustum) == o);
+        CHECK((CullMeshlet(b, cone, nullptr) == MeshletCullResult::Cone) == f);
+        outside += o ? 1 : 0;
+        backfacing += f ? 1 : 0;
+    }
+    CHECK(outside > bounds.size() / 10 && outside < bounds.size() * 9 / 10);
+    CHECK(backfacing > bounds.size() / 10 && backfacing < bounds.size() * 9 / 10);
+
+    // на самой границе решение зависит от последнего бита: d == -radius ещё видно, радиус на ulp меньше - уже нет
+    size_t edges = 0;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        MeshletBounds b = bounds[i];
+        const float n[3] = { frustum.planes[0].x, frustum.planes[0].y, frustum.planes[0].z };
+        const float d = ShaderDot3(n, b.center) + frustum.planes[0].w;
+        if (!(d < 0.0f))
+            continue;
+        b.radius = -d;
+        if (ShaderOutsideFrustum(b, frustum))
+            continue;   // снаружи другой плоскости
+        ++edges;
+        CHECK(CullMeshlet(b, frustum, nullptr) == MeshletCullResult::Visible);
+        b.radius = std::nextafter(-d, 0.0f);
+        CHECK(CullMeshlet(b, frustum, nullptr) == MeshletCullResult::Frustum);
+    }
+    CHECK(edges > 50);
+}
+
+TEST(MeshletCulling, CpuCullerListsVisibleInOrder)
+{
+    const std::vector<MeshletBounds> bounds = RandomBounds(5000, 8u);
+    const uint32_t count = (uint32_t)bounds.size();
+    const MeshletCullConstants c = MakeConstants(MeshletCullFrustum | MeshletCullCone | MeshletCullOcclusion, count);
+
+    // стена в левой половине кадра
+    std::vector<float> depth((size_t)c.depthWidth * c.depthHeight, 1.0f);
+    for (uint32_t y = 0; y < c.depthHeight; ++y)
+        for (uint32_t x = 0; x < c.depthWidth / 2; ++x)
+            depth[(size_t)y * c.depthWidth + x] = 0.5f;
+    const HiZPyramid hiz = BuildHiZPyramid(depth.data(), c.depthWidth, c.depthHeight, c.depthWidth * sizeof(float));
+    CHECK(hiz.mips.size() == c.hizMips);
+
+    std::vector<uint32_t> visible(count);
+    MeshletCullStats stats;
+    const uint32_t n = CullMeshlets(bounds.data(), count, c, &hiz, visible.data(), &stats);
+
+    std::vector<uint32_t> expected;
+    MeshletCullStats manual;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        switch (CullMeshlet(bounds[i], c, &hiz))
+        {
+        case MeshletCullResult::Visible: expected.push_back(i); break;
+        case MeshletCullResult::Frustum: ++manual.frustum; break;
+        case MeshletCullResult::Cone: ++manual.cone; break;
+        case MeshletCullResult::Occluded: ++manual.occluded; break;
+        }
+    }
+    visible.resize(n);
+    CHECK(visible == expected);
+    CHECK(stats.tested == count && stats.visible == n);
+    CHECK(stats.frustum == manual.frustum && stats.cone == manual.cone && stats.occluded == manual.occluded);
+    CHECK(stats.visible + stats.frustum + stats.cone + stats.occluded == stats.tested);
+    CHECK(stats.visible != 0 && stats.frustum != 0 && stats.cone != 0 && stats.occluded != 0);
+
+    // статистика накапливается
+    MeshletCullStats twice = stats;
+    CullMeshlets(bounds.data(), count, c, &hiz, visible.data(), &twice);
+    CHECK(twice.tested == 2 * stats.tested && twice.occluded == 2 * stats.occluded);
+
+    // HiZ другого размера окклюзию отключает
+    const HiZPyramid narrow = BuildHiZPyramid(depth.data(), c.depthWidth / 2, c.depthHeight, c.depthWidth * sizeof(float));
+    MeshletCullStats noHiz;
+    visible.resize(count);
+    CullMeshlets(bounds.data(), count, c, &narrow, visible.data(), &noHiz);
+    CHECK(noHiz.occluded == 0 && noHiz.visible == stats.visible + stats.occluded);
+
+    // сверка с флагами AS: свои же решения совпадают, каждый перевёрнутый флаг - расхождение
+    std::vector<uint32_t> gpu(count, 0u);
+    for (uint32_t i : expected)
+        gpu[i] = 1u;
+    const MeshletCullValidation same = ValidateMeshletCulling(bounds.data(), count, c, &hiz, gpu.data());
+    CHECK(same.meshlets == count && same.mismatches == 0 && same.occlusion);
+    CHECK(same.cpuVisible == n && same.gpuVisible == n);
+    gpu[0] ^= 1u;
+    gpu[count - 1] ^= 1u;
+    CHECK(ValidateMeshletCulling(bounds.data(), count, c, &hiz, gpu.data()).mismatches == 2);
+}
+
+TEST(MeshletCulling, BenchmarkRejectsWithEveryTest)
+{
+    const std::vector<Mesh> meshes = { CreateSphere(64, 64, 1.0f), CreateSphere(32, 32, 5.0f) };
+    const MeshletCullBenchmarkResult r = BenchmarkMeshletCulling(meshes, 8, 320, 180);
+    const MeshletCullStats& s = r.stats;
+    CHECK(r.views == 16);
+    CHECK(s.tested > 0);
+    CHECK(s.visible + s.frustum + s.cone + s.occluded == s.tested);
+    // камера смотрит мимо центра: без отсечённых пирамидой бенчмарк её бы не мерил
+    CHECK(s.frustum != 0 && s.cone != 0 && s.occluded != 0 && s.visible != 0);
+    CHECK(r.NsPerMeshlet(r.cullMs) > 0.0 && r.NsPerMeshlet(r.frustumMs) > 0.0);
+    CHECK(r.NsPerMeshlet(r.coneMs) > 0.0 && r.NsPerMeshlet(r.occlusionMs) > 0.0);
+}
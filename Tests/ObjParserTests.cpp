@@ -0,0 +1,186 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "Test.h"
+#include "ObjParser.h"
+#include "TaskPool.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+namespace
+{
+    std::string TempPath(const char* name)
+    {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    void WriteFile(const std::string& path, const std::string& text)
+    {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+    }
+
+    bool SameFloats(const std::vector<tinyobj::real_t>& a, const std::vector<tinyobj::real_t>& b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(tinyobj::real_t)) == 0);
+    }
+
+    // до бита: атрибуты, shape, индексы, материалы граней, группы сглаживания
+    bool SameAsTinyobj(const std::string& path, TaskPool* pool)
+    {
+        tinyobj::attrib_t ra, pa;
+        std::vector<tinyobj::shape_t> rs, ps;
+        std::vector<tinyobj::material_t> rm, pm;
+        std::string rw, re, pw, pe;
+        const bool rok = tinyobj::LoadObj(&ra, &rs, &rm, &rw, &re, path.c_str(), nullptr);
+        const bool pok = ParallelLoadObj(&pa, &ps, &pm, &pw, &pe, path.c_str(), nullptr, pool);
+        if (rok != pok || !SameFloats(ra.vertices, pa.vertices) || !SameFloats(ra.vertex_weights, pa.vertex_weights) ||
+            !SameFloats(ra.normals, pa.normals) || !SameFloats(ra.texcoords, pa.texcoords) ||
+            !SameFloats(ra.colors, pa.colors) || rs.size() != ps.size() || rm.size() != pm.size())
+            return false;
+
+        for (size_t i = 0; i < rs.size(); ++i)
+        {
+            const tinyobj::mesh_t& a = rs[i].mesh;
+            const tinyobj::mesh_t& b = ps[i].mesh;
+            if (rs[i].name != ps[i].name || a.indices.size() != b.indices.size() ||
+                a.num_face_vertices != b.num_face_vertices || a.material_ids != b.material_ids ||
+                a.smoothing_group_ids != b.smoothing_group_ids)
+                return false;
+            for (size_t k = 0; k < a.indices.size(); ++k)
+            {
+                if (a.indices[k].vertex_index != b.indices[k].vertex_index ||
+                    a.indices[k].normal_index != b.indices[k].normal_index ||
+                    a.indices[k].texcoord_index != b.indices[k].texcoord_index)
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST(ObjParser, HandWrittenCases)
+{
+    const char* cases[] =
+    {
+        // треугольники и четырёхугольники, все формы индексов
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0 0\nvt 1 1\nvn 0 0 1\n"
+        "f 1 2 3\nf 1/1 2/2 3/1 4/2\nf 1//1 2//1 3//1\nf 1/1/1 2/2/1 3/2/1 4/1/1\n",
+        // относительные индексы, CRLF, комментарии, лишние пробелы и табы
+        "# head\r\nv  1.5\t-2.25  3e2\r\nv -.5 +4 1E-3\r\nv 7 8 9 0.5\r\n\r\nf -3 -2 -1\r\n  # tail\r\n",
+        // o/g/usemtl/s делят на shape так же, как tinyobj
+        "mtllib missing.mtl\no a\nv 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nusemtl red\ns 1\nf 1 2 3\n"
+        "g b c\ns off\nf 2 4 3\nusemtl blue\nf 1 2 4\no\nf 1 3 4\n",
+        // числа на границе точности и цвета вершин
+        "v 0.1000000000000000055511151231257827 1e-38 3.4028234e38 1 0.5 0.25\n"
+        "v 123456789.123456789 -0.0 1e-50\nv 0 0 1\nf 1 2 3\n",
+        // то, что разбирает только tinyobj: многоугольник, линия, точка
+        "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 0.5 0\nf 1 2 3 4 5\nl 1 2\np 3\n",
+        // индекс за пределами - предупреждение у tinyobj
+        "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 7\n",
+        // пустой файл и файл без граней
+        "",
+        "v 1 2 3\nvn 0 1 0\n",
+    };
+
+    TaskPool pool(4);
+    const std::string path = TempPath("engine_tests_obj_case.obj");
+    for (const char* text : cases)
+    {
+        WriteFile(path, text);
+        CHECK(SameAsTinyobj(path, nullptr));
+        CHECK(SameAsTinyobj(path, &pool));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(ObjParser, RandomFiles)
+{
+    // мелкие случайные файлы из строк, которые понимает быстрый путь
+    std::mt19937 rng(99u);
+    const std::string path = TempPath("engine_tests_obj_random.obj");
+    TaskPool pool(4);
+    for (int file = 0; file < 100; ++file)
+    {
+        std::string text;
+        char line[128];
+        int v = 0, vt = 0, vn = 0;
+        for (int i = 0; i < 200; ++i)
+        {
+            const unsigned kind = rng() % 12;
+            auto val = [&]() { return (float)((int)(rng() % 20001) - 10000) / (float)(1 + rng() % 997); };
+            if (kind < 4)
+            {
+                std::snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n", val(), val(), val());
+                ++v;
+            }
+            else if (kind == 4)
+            {
+                std::snprintf(line, sizeof(line), "vt %.7g %.7g\n", val(), val());
+                ++vt;
+            }
+            else if (kind == 5)
+            {
+                std::snprintf(line, sizeof(line), "vn %.7g %.7g %.7g\n", val(), val(), val());
+                ++vn;
+            }
+            else if (kind < 9 && v > 0)
+            {
+                // все вершины грани в одной форме, как требует tinyobj
+                const int corners = 3 + (int)(rng() % 2);
+                const unsigned form = rng() % 4;
+                const bool relative = rng() % 3 == 0;
+                std::string f = "f";
+                for (int c = 0; c < corners; ++c)
+                {
+                    const int iv = 1 + (int)(rng() % v);
+                    const int it = vt > 0 ? 1 + (int)(rng() % vt) : 0;
+                    const int in = vn > 0 ? 1 + (int)(rng() % vn) : 0;
+                    const int sv = relative ? iv - v - 1 : iv;
+                    const int st = relative ? it - vt - 1 : it;
+                    const int sn = relative ? in - vn - 1 : in;
+                    if (form == 1 && vt > 0)
+                        std::snprintf(line, sizeof(line), " %d/%d", sv, st);
+                    else if (form == 2 && vn > 0)
+                        std::snprintf(line, sizeof(line), " %d//%d", sv, sn);
+                    else if (form == 3 && vt > 0 && vn > 0)
+                        std::snprintf(line, sizeof(line), " %d/%d/%d", sv, st, sn);
+                    else
+                        std::snprintf(line, sizeof(line), " %d", sv);
+                    f += line;
+                }
+                std::snprintf(line, sizeof(line), "%s\n", f.c_str());
+            }
+            else if (kind == 9)
+                std::snprintf(line, sizeof(line), "o obj%u\n", (unsigned)(rng() % 5));
+            else if (kind == 10)
+                std::snprintf(line, sizeof(line), "usemtl m%u\n", (unsigned)(rng() % 3));
+            else
+                std::snprintf(line, sizeof(line), rng() % 2 ? "s %u\n" : "s off\n", (unsigned)(rng() % 4));
+            text += line;
+        }
+
+        WriteFile(path, text);
+        const bool single = SameAsTinyobj(path, nullptr);
+        const bool parallel = SameAsTinyobj(path, &pool);
+        CHECK(single);
+        CHECK(parallel);
+        if (!single || !parallel)
+            break;
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(ObjParser, LargeFileAcrossChunks)
+{
+    // несколько мегабайт, чтобы файл резался на куски по строкам
+    TaskPool pool(4);
+    const std::string path = TempPath("engine_tests_obj_large.obj");
+    std::filesystem::remove(path);
+    const ObjParseBenchmarkResult r = RunObjParseBenchmark(path, 200000, &pool);
+    CHECK(r.fileBytes > (4u << 20));
+    CHECK(r.triangles >= 190000);
+    CHECK(r.matches);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,138 @@
+#include "Test.h"
+#include "OffsetAllocator.h"
+#include <iterator>
+#include <map>
+#include <random>
+
+TEST(OffsetAllocator, BestFitAndCoalesce)
+{
+    OffsetAllocator a(100);
+    const uint32_t x = a.Allocate(10);
+    const uint32_t y = a.Allocate(20);
+    const uint32_t z = a.Allocate(30);
+    CHECK(x == 0 && y == 10 && z == 30);
+    CHECK(a.GetFree() == 40);
+
+    a.Free(y);
+    CHECK(a.GetFreeBlockCount() == 2);
+    CHECK(a.GetLargestFreeBlock() == 40);
+
+    // 15 ложится в дыру на 20, а не в хвост
+    const uint32_t w = a.Allocate(15);
+    CHECK(w == 10);
+
+    a.Free(w);
+    a.Free(x);
+    CHECK(a.GetFreeBlockCount() == 2);
+    a.Free(z);
+    CHECK(a.GetFreeBlockCount() == 1);
+    CHECK(a.GetFree() == 100);
+    CHECK(a.GetFragmentation() == 0.0f);
+
+    CHECK(a.Allocate(0) == OffsetAllocator::Invalid);
+    CHECK(a.Allocate(101) == OffsetAllocator::Invalid);
+    CHECK_THROWS(a.Free(5));
+}
+
+TEST(OffsetAllocator, Alignment)
+{
+    OffsetAllocator a(64);
+    const uint32_t p = a.Allocate(3);
+    const uint32_t q = a.Allocate(8, 4);
+    CHECK(p == 0);
+    CHECK(q == 4);
+    CHECK(a.GetFreeBlockCount() == 2);   // дырка от выравнивания осталась свободной
+
+    a.Free(p);
+    const auto moves = a.Compact();
+    CHECK(moves.size() == 1);
+    CHECK(moves[0].from == 4 && moves[0].to == 0 && moves[0].size == 8);
+    CHECK(a.GetLargestFreeBlock() == 56);
+}
+
+TEST(OffsetAllocator, FragmentationAndCompact)
+{
+    // LOD 0 и LOD 1 объектов вперемешку, LOD 1 освобождаются - как при перестройке LOD
+    OffsetAllocator a(1000);
+    std::vector<uint32_t> lod0, lod1;
+    for (int i = 0; i < 10; ++i)
+    {
+        lod0.push_back(a.Allocate(60));
+        lod1.push_back(a.Allocate(40));
+    }
+    CHECK(a.GetFree() == 0);
+
+    for (uint32_t o : lod1)
+        a.Free(o);
+    CHECK(a.GetFree() == 400);
+    CHECK(a.GetLargestFreeBlock() == 40);
+    CHECK(a.GetFragmentation() > 0.85f);
+
+    // места хватает, но одним куском нет
+    CHECK(a.Allocate(100) == OffsetAllocator::Invalid);
+
+    const auto moves = a.Compact();
+    CHECK(moves.size() == 9);
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        CHECK(moves[i].to < moves[i].from);
+        CHECK(moves[i].size == 60);
+        // порядок блоков сохраняется, поэтому копировать можно по порядку без перекрытия
+        if (i > 0)
+            CHECK(moves[i - 1].to + moves[i - 1].size <= moves[i].to);
+    }
+    CHECK(a.GetFragmentation() == 0.0f);
+    CHECK(a.GetLargestFreeBlock() == 400);
+    CHECK(a.Allocate(100) == 600);
+
+    // старые смещения больше не действуют, новые освобождаются
+    for (const auto& m : moves)
+        a.Free(m.to);
+    CHECK(a.GetUsed() == 160);
+}
+
+TEST(OffsetAllocator, RandomStress)
+{
+    std::mt19937 rng(1);
+    OffsetAllocator a(1 << 16);
+    std::map<uint32_t, uint32_t> live;   // offset -> size
+
+    for (int it = 0; it < 20000; ++it)
+    {
+        if (live.empty() || rng() % 3)
+        {
+            const uint32_t size = 1 + rng() % 64;
+            const uint32_t alignment = 1u << (rng() % 3);
+            const uint32_t o = a.Allocate(size, alignment);
+            if (o == OffsetAllocator::Invalid)
+                continue;
+            CHECK(o % alignment == 0);
+            // не пересекается с соседями
+            auto next = live.lower_bound(o);
+            if (next != live.end())
+                CHECK(o + size <= next->first);
+            if (next != live.begin())
+            {
+                auto prev = std::prev(next);
+                CHECK(prev->first + prev->second <= o);
+            }
+            live[o] = size;
+        }
+        else
+        {
+            auto k = live.begin();
+            std::advance(k, rng() % live.size());
+            a.Free(k->first);
+            live.erase(k);
+        }
+    }
+
+    const uint32_t used = a.GetUsed();
+    const float before = a.GetFragmentation();
+    const auto moves = a.Compact();
+    CHECK(a.GetUsed() == used);
+    CHECK(a.GetFragmentation() <= before);
+    CHECK(a.GetFreeBlockCount() <= a.GetAllocationCount() + 1);
+    for (const auto& m : moves)
+        CHECK(m.to < m.from);
+}
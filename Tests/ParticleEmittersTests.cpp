@@ -0,0 +1,189 @@
+#include "Test.h"
+#include "ParticleEmitters.h"
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+
+namespace
+{
+    const XMFLOAT3 NoAccel{ 0.0f, 0.0f, 0.0f };
+
+    ParticleEmitterDesc MakeDesc(float x, float spawnRate, uint32_t burst, float lifetime = 5.0f)
+    {
+        ParticleEmitterDesc d;
+        d.position = { x, 0.0f, 0.0f };
+        d.spawnRate = spawnRate;
+        d.burst = burst;
+        d.lifetime = lifetime;
+        return d;
+    }
+
+    // камера в начале координат смотрит вдоль +Z, видно x в [-z, z]
+    ParticleBudgetView MakeView()
+    {
+        ParticleBudgetView v;
+        v.valid = true;
+        v.planes[0] = { 1.0f, 0.0f, 1.0f, 0.0f };
+        v.planes[1] = { -1.0f, 0.0f, 1.0f, 0.0f };
+        v.planes[2] = { 0.0f, 1.0f, 1.0f, 0.0f };
+        v.planes[3] = { 0.0f, -1.0f, 1.0f, 0.0f };
+        v.planes[4] = { 0.0f, 0.0f, 1.0f, -0.1f };
+        v.planes[5] = { 0.0f, 0.0f, -1.0f, 1000.0f };
+        v.depthPlane[2] = 1.0f;
+        v.projScale = 1.0f;
+        return v;
+    }
+}
+
+TEST(ParticleEmitters, BurstAndRateShareOneSpawn)
+{
+    ParticleEmitterPool pool(1000);
+    const ParticleEmitterId id = pool.Create(MakeDesc(0.0f, 10.0f, 100));
+    CHECK(id != InvalidParticleEmitter);
+    // burst + spawnRate * lifetime
+    CHECK(pool.GetRangeSize(id) == 150);
+
+    std::vector<ParticleEmitterSpawn> spawns;
+    pool.Update(1.0f, NoAccel, ParticleBudgetView{}, spawns);
+    CHECK(spawns.size() == 1);
+    CHECK(spawns[0].id == id && spawns[0].count == 110);
+    CHECK(pool.GetAliveCount(id) == 110);
+    CHECK(pool.GetAliveCount() == 110);
+
+    pool.Update(1.0f, NoAccel, ParticleBudgetView{}, spawns);
+    CHECK(spawns.size() == 1 && spawns[0].count == 10);
+    CHECK(pool.GetAliveCount() == 120);
+}
+
+TEST(ParticleEmitters, SpawnsPerUpdateNeverExceedEmitters)
+{
+    // на каждый запуск - свой слот CB в ParticleSystem::EmitSpawns
+    const uint32_t emitters = 64;
+    ParticleEmitterPool pool(emitters * 200);
+    for (uint32_t i = 0; i < emitters; ++i)
+        pool.Create(MakeDesc((float)i, 20.0f, 50));
+
+    std::vector<ParticleEmitterSpawn> spawns;
+    for (int frame = 0; frame < 30; ++frame)
+    {
+        pool.Update(0.25f, NoAccel, ParticleBudgetView{}, spawns);
+        CHECK(spawns.size() <= emitters);
+
+        std::set<ParticleEmitterId> ids;
+        for (const ParticleEmitterSpawn& s : spawns)
+            ids.insert(s.id);
+        CHECK(ids.size() == spawns.size());
+    }
+}
+
+TEST(ParticleEmitters, AliveMatchesSpawnedMinusExpired)
+{
+    // независимая модель: партии по кадрам, смерть при age >= lifetime
+    std::mt19937 rng(7u);
+    ParticleEmitterPool pool(4000);
+    pool.SetGlobalBudget(2500);
+
+    struct Model
+    {
+        float lifetime;
+        std::vector<std::pair<float, uint32_t>> batches;
+    };
+    std::map<ParticleEmitterId, Model> model;
+
+    std::vector<ParticleEmitterSpawn> spawns;
+    for (int frame = 0; frame < 300; ++frame)
+    {
+        if (frame % 10 == 0)
+        {
+            const float lifetime = 1.0f + (float)(rng() % 40) * 0.1f;
+            const ParticleEmitterId id = pool.Create(MakeDesc((float)(rng() % 100), (float)(rng() % 200), rng() % 300, lifetime));
+            if (id != InvalidParticleEmitter)
+                model[id].lifetime = lifetime;
+        }
+        if (frame % 17 == 0 && !model.empty())
+            pool.Destroy(std::next(model.begin(), rng() % model.size())->first);
+
+        const float dt = 0.05f + (float)(rng() % 10) * 0.01f;
+        pool.Update(dt, NoAccel, ParticleBudgetView{}, spawns);
+
+        uint32_t total = 0;
+        for (auto it = model.begin(); it != model.end(); ++it)
+        {
+            Model& m = it->second;
+            for (auto& b : m.batches)
+                b.first += dt;
+            while (!m.batches.empty() && !(m.batches.front().first < m.lifetime))
+                m.batches.erase(m.batches.begin());
+            for (const ParticleEmitterSpawn& s : spawns)
+                if (s.id == it->first)
+                    m.batches.push_back({ 0.0f, s.count });
+
+            uint32_t alive = 0;
+            for (const auto& b : m.batches)
+                alive += b.second;
+            CHECK(pool.GetAliveCount(it->first) == alive);
+            CHECK(alive <= pool.GetRangeSize(it->first));
+            total += alive;
+        }
+        CHECK(pool.GetAliveCount() == total);
+        CHECK(total <= pool.GetGlobalBudget());
+    }
+}
+
+TEST(ParticleEmitters, DestroyReturnsRangeAfterParticlesDie)
+{
+    ParticleEmitterPool pool(100);
+    const ParticleEmitterId id = pool.Create(MakeDesc(0.0f, 0.0f, 100, 2.0f));
+    CHECK(pool.Create(MakeDesc(0.0f, 0.0f, 1)) == InvalidParticleEmitter);
+
+    std::vector<ParticleEmitterSpawn> spawns;
+    pool.Update(0.5f, NoAccel, ParticleBudgetView{}, spawns);
+    CHECK(pool.GetAliveCount() == 100);
+
+    pool.Destroy(id);
+    CHECK(!pool.Exists(id));
+    CHECK(pool.GetEmitterCount() == 1);
+    CHECK(pool.GetRanges().GetFree() == 0);
+
+    pool.Update(1.0f, NoAccel, ParticleBudgetView{}, spawns);
+    CHECK(spawns.empty());
+    CHECK(pool.GetEmitterCount() == 1);
+    pool.Update(1.0f, NoAccel, ParticleBudgetView{}, spawns);
+    CHECK(pool.GetEmitterCount() == 0);
+    CHECK(pool.GetAliveCount() == 0);
+    CHECK(pool.GetRanges().GetFree() == 100);
+}
+
+TEST(ParticleEmitters, BudgetGoesToVisibleEmitters)
+{
+    ParticleEmitterPool pool(10000);
+    pool.SetGlobalBudget(1000);
+    // спрос 100 * 10 у каждого, вместе вдвое больше бюджета
+    const ParticleEmitterId seen = pool.Create(MakeDesc(0.0f, 100.0f, 0, 10.0f));
+    const ParticleEmitterId hidden = pool.Create(MakeDesc(500.0f, 100.0f, 0, 10.0f));
+    pool.SetPosition(seen, { 0.0f, 0.0f, 50.0f });
+    pool.SetPosition(hidden, { 0.0f, 0.0f, -50.0f });
+
+    const ParticleBudgetView view = MakeView();
+    std::vector<ParticleEmitterSpawn> spawns;
+    for (int frame = 0; frame < 100; ++frame)
+        pool.Update(0.1f, NoAccel, view, spawns);
+
+    CHECK(pool.IsVisible(seen));
+    CHECK(!pool.IsVisible(hidden));
+    CHECK(pool.GetSpawnScale(seen) == 1.0f);
+    CHECK(pool.GetSpawnScale(hidden) == 0.0f);
+    CHECK(pool.GetAliveCount() <= 1000);
+
+    // без камеры веса равны: каждому по половине бюджета
+    ParticleEmitterPool flat(10000);
+    flat.SetGlobalBudget(1000);
+    const ParticleEmitterId a = flat.Create(MakeDesc(0.0f, 100.0f, 0, 10.0f));
+    const ParticleEmitterId b = flat.Create(MakeDesc(1.0f, 100.0f, 0, 10.0f));
+    for (int frame = 0; frame < 100; ++frame)
+        flat.Update(0.1f, NoAccel, ParticleBudgetView{}, spawns);
+    CHECK(flat.GetSpawnScale(a) > 0.45f && flat.GetSpawnScale(a) < 0.55f);
+    CHECK(flat.GetSpawnScale(b) > 0.45f && flat.GetSpawnScale(b) < 0.55f);
+    CHECK(flat.GetAliveCount() <= 1000);
+}
@@ -0,0 +1,56 @@
+#include "Test.h"
+#include "ParticleIndirectArgs.h"
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    // CS_BuildArgs (ParticlesCS.hlsl) строка в строку: Store3/Store4/Store по байтовым смещениям
+    void BuildArgsShaderModel(uint32_t count, uint32_t indexCountPerInstance, uint8_t out[32])
+    {
+        auto store = [&](uint32_t byteOffset, uint32_t v) { std::memcpy(out + byteOffset, &v, 4); };
+
+        uint32_t groups = count / 256 + (count % 256 != 0 ? 1 : 0);
+        groups = groups < 65535 ? groups : 65535;
+
+        store(0, groups); store(4, 1); store(8, 1);
+        store(12, indexCountPerInstance); store(16, count); store(20, 0); store(24, 0);
+        store(28, 0);
+    }
+}
+
+TEST(ParticleIndirectArgs, Layout)
+{
+    CHECK(ParticleDispatchArgsOffset == offsetof(ParticleIndirectArgs, threadGroupCountX));
+    CHECK(ParticleDrawArgsOffset == offsetof(ParticleIndirectArgs, indexCountPerInstance));
+    CHECK(offsetof(ParticleIndirectArgs, instanceCount) == 16);
+    CHECK(offsetof(ParticleIndirectArgs, startInstanceLocation) == 28);
+}
+
+TEST(ParticleIndirectArgs, MatchesShader)
+{
+    const uint32_t counts[] = { 0, 1, 255, 256, 257, 65535 * 256 - 1, 65535 * 256, 65535 * 256 + 1,
+        1000000, 16777216, 20000000, 0xFFFFFFFFu };
+    for (uint32_t count : counts)
+    {
+        for (uint32_t indexCount : { 6u, 36u })
+        {
+            const ParticleIndirectArgs a = BuildParticleIndirectArgs(count, indexCount);
+            uint8_t model[32];
+            BuildArgsShaderModel(count, indexCount, model);
+            CHECK(std::memcmp(&a, model, sizeof(a)) == 0);
+        }
+    }
+}
+
+TEST(ParticleIndirectArgs, GroupCountClamped)
+{
+    CHECK(BuildParticleIndirectArgs(0, 6).threadGroupCountX == 0);
+    CHECK(BuildParticleIndirectArgs(1, 6).threadGroupCountX == 1);
+    CHECK(BuildParticleIndirectArgs(256, 6).threadGroupCountX == 1);
+    CHECK(BuildParticleIndirectArgs(257, 6).threadGroupCountX == 2);
+    CHECK(BuildParticleIndirectArgs(0xFFFFFFFFu, 6).threadGroupCountX == ParticleMaxGroupCount);
+
+    // рисуются все живые частицы, даже если обновление упёрлось в лимит групп
+    CHECK(BuildParticleIndirectArgs(20000000, 6).instanceCount == 20000000);
+}
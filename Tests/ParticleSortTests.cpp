@@ -0,0 +1,170 @@
+#include "Test.h"
+#include "ParticleSort.h"
+#include "CpuParticleSim.h"
+#include <algorithm>
+#include <random>
+
+namespace
+{
+    // эталон: стабильная сортировка по ключу, values едут вместе с ключами
+    void ReferenceSort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values)
+    {
+        std::vector<uint32_t> idx(keys.size());
+        for (size_t i = 0; i < idx.size(); ++i)
+            idx[i] = (uint32_t)i;
+        std::stable_sort(idx.begin(), idx.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+        std::vector<uint32_t> k(keys.size()), v(values.size());
+        for (size_t i = 0; i < idx.size(); ++i)
+        {
+            k[i] = keys[idx[i]];
+            v[i] = values[idx[i]];
+        }
+        keys.swap(k);
+        values.swap(v);
+    }
+
+    // mask - какие биты ключа случайны; остальные одинаковы у всех и сортировкой пропускаются
+    std::vector<uint32_t> RandomKeys(size_t count, uint32_t mask, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint32_t> keys(count);
+        for (uint32_t& k : keys)
+            k = ((uint32_t)rng() & mask) | (0x5A000000u & ~mask);
+        return keys;
+    }
+
+    bool SortMatchesReference(TaskPool* pool, size_t count, uint32_t mask, uint32_t seed)
+    {
+        std::vector<uint32_t> keys = RandomKeys(count, mask, seed);
+        std::vector<uint32_t> values(count);
+        for (size_t i = 0; i < count; ++i)
+            values[i] = (uint32_t)(i * 2654435761u);   // не индексы: проверяется перестановка, а не номера
+
+        std::vector<uint32_t> refKeys = keys, refValues = values;
+        ReferenceSort(refKeys, refValues);
+
+        ParticleRadixSort sort(pool);
+        sort.Sort(keys, values);
+        return keys == refKeys && values == refValues;
+    }
+}
+
+TEST(ParticleSort, MatchesStdSort)
+{
+    TaskPool pool(4);
+    for (TaskPool* p : { (TaskPool*)nullptr, &pool })
+    {
+        for (size_t count : { (size_t)0, (size_t)1, (size_t)255, (size_t)65537, (size_t)1000000 })
+        {
+            CHECK(SortMatchesReference(p, count, 0xFFFFFFFFu, (uint32_t)count + 1));
+            // два средних разряда одинаковы, младший и старший - нет
+            CHECK(SortMatchesReference(p, count, 0xFF0000FFu, (uint32_t)count + 2));
+        }
+    }
+}
+
+TEST(ParticleSort, StableOnEqualKeys)
+{
+    TaskPool pool(4);
+    for (TaskPool* p : { (TaskPool*)nullptr, &pool })
+    {
+        // 16 разных ключей на 200000 значений; все разряды, кроме одного, одинаковы
+        std::vector<uint32_t> keys = RandomKeys(200000, 0x00000F00u, 7u);
+        std::vector<uint32_t> values(keys.size());
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = (uint32_t)i;
+
+        ParticleRadixSort sort(p);
+        sort.Sort(keys, values);
+
+        bool ordered = true;
+        for (size_t i = 1; i < keys.size(); ++i)
+            ordered &= keys[i - 1] < keys[i] || (keys[i - 1] == keys[i] && values[i - 1] < values[i]);
+        CHECK(ordered);
+
+        // все ключи равны - порядок не меняется
+        std::vector<uint32_t> same(70000, 42u), ids(same.size());
+        for (size_t i = 0; i < ids.size(); ++i)
+            ids[i] = (uint32_t)i;
+        const std::vector<uint32_t> before = ids;
+        sort.Sort(same, ids);
+        CHECK(ids == before);
+    }
+}
+
+TEST(ParticleSort, DepthKeyPutsFarFirst)
+{
+    const float depths[] = { -1e30f, -5.0f, -1.0f, -0.0f, 0.0f, 1e-30f, 0.5f, 1.0f, 100.0f, 1e30f };
+    for (size_t i = 1; i < sizeof(depths) / sizeof(depths[0]); ++i)
+    {
+        if (depths[i - 1] < depths[i])
+            CHECK(ParticleDepthKey(depths[i - 1]) > ParticleDepthKey(depths[i]));
+    }
+
+    // w после ViewProj - четвёртый столбец (матрица по строкам, как XMFLOAT4X4)
+    float viewProj[16] = {};
+    for (int i = 0; i < 16; ++i)
+        viewProj[i] = (float)i;
+    float plane[4];
+    ParticleDepthPlane(viewProj, plane);
+    CHECK(plane[0] == 3.0f && plane[1] == 7.0f && plane[2] == 11.0f && plane[3] == 15.0f);
+}
+
+TEST(ParticleSort, DrawOrderBackToFront)
+{
+    TaskPool pool(4);
+    CpuParticleSim sim(&pool);
+    sim.Reset(150000);
+    ParticleUpdateCB cb{};
+    cb.dt = 0.05f;
+    cb.spawnCount = 150000;
+    cb.initialSpeed = 20.0f;
+    cb.lifetime = 10.0f;
+    sim.Emit(cb);
+    sim.Update(cb);
+    sim.Update(cb);
+
+    // глубина вдоль оси взгляда (1, 0.5, 2)
+    const float plane[4] = { 1.0f, 0.5f, 2.0f, 3.0f };
+    const uint32_t n = sim.GetAliveCount();
+    std::vector<float> depth(n);
+    std::vector<uint32_t> expected(n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const ParticleCPU p = sim.GetParticle(i);
+        depth[i] = p.pos[0] * plane[0] + p.pos[1] * plane[1] + p.pos[2] * plane[2] + plane[3];
+        expected[i] = i;
+    }
+    std::stable_sort(expected.begin(), expected.end(),
+        [&](uint32_t a, uint32_t b) { return ParticleDepthKey(depth[a]) < ParticleDepthKey(depth[b]); });
+
+    for (TaskPool* p : { (TaskPool*)nullptr, &pool })
+    {
+        ParticleRadixSort sort(p);
+        std::vector<uint32_t> order;
+        sort.BuildDrawOrder(sim, plane, order);
+        CHECK(order == expected);
+
+        bool backToFront = true;
+        for (uint32_t i = 1; i < n; ++i)
+            backToFront &= depth[order[i - 1]] >= depth[order[i]];
+        CHECK(backToFront);
+    }
+
+    // пустая система - пустой порядок
+    CpuParticleSim empty;
+    empty.Reset(16);
+    ParticleRadixSort sort;
+    std::vector<uint32_t> order(5, 1u);
+    sort.BuildDrawOrder(empty, plane, order);
+    CHECK(order.empty());
+}
+
+TEST(ParticleSort, BenchmarkAgreesWithStdSort)
+{
+    TaskPool pool(2);
+    const RadixSortBenchmarkResult r = RunRadixSortBenchmark(100000, &pool);
+    CHECK(r.count == 100000 && r.threads == 2);
+    CHECK(r.matchesStdSort);
+    CHECK(r.drawOrderMatches);
+}
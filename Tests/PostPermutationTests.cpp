@@ -0,0 +1,30 @@
+#include "Test.h"
+#include "PostPermutation.h"
+
+TEST(PostPermutation, OnePassWithoutPixelate)
+{
+    PostEffectFlags f;
+    CHECK((BuildPostChain(f) == std::vector<uint32_t>{ POST_GAMMA | POST_VIGNETTE }));
+
+    f.gamma = false;
+    f.vignette = false;
+    CHECK((BuildPostChain(f) == std::vector<uint32_t>{ 0u }));   // копия в backbuffer
+}
+
+TEST(PostPermutation, PixelateStartsSecondPass)
+{
+    PostEffectFlags f;
+    f.pixelate = true;
+    f.invert = true;
+    f.saturation = true;
+    CHECK((BuildPostChain(f) == std::vector<uint32_t>{ POST_GAMMA | POST_INVERT,
+        POST_PIXELATE | POST_SATURATION | POST_VIGNETTE }));
+
+    // до pixelate ничего - проход-копия не нужен
+    f.gamma = false;
+    f.invert = false;
+    CHECK((BuildPostChain(f) == std::vector<uint32_t>{ POST_PIXELATE | POST_SATURATION | POST_VIGNETTE }));
+    f.saturation = false;
+    f.vignette = false;
+    CHECK((BuildPostChain(f) == std::vector<uint32_t>{ POST_PIXELATE }));
+}
@@ -0,0 +1,83 @@
+#include "Test.h"
+#include "ReadbackTracker.h"
+#include <deque>
+
+TEST(ReadbackTracker, SimulatedQueue)
+{
+    // кадр сигналит fence = номер кадра, GPU отстаёт на два кадра
+    ReadbackTracker t;
+    t.Init(1024);
+
+    std::deque<ReadbackTicket> inFlight;
+    size_t consumed = 0;
+    for (uint64_t frame = 1; frame <= 20; ++frame)
+    {
+        uint32_t offset = 0;
+        const ReadbackTicket k = t.Enqueue(100, 16, offset);
+        CHECK(k != InvalidReadbackTicket);
+        CHECK(offset % 16 == 0);
+        CHECK(t.GetState(k) == ReadbackTracker::State::Pending);
+        inFlight.push_back(k);
+
+        const uint64_t completed = frame > 2 ? frame - 2 : 0;
+        t.OnFenceSignaled(frame, completed);
+
+        while (!inFlight.empty() && t.IsReady(inFlight.front()))
+        {
+            uint32_t off = 0, size = 0;
+            CHECK(t.GetRange(inFlight.front(), off, size));
+            CHECK(size == 100);
+            t.Release(inFlight.front());
+            inFlight.pop_front();
+            ++consumed;
+        }
+        // буфер не растёт: в полёте не больше задержки GPU
+        CHECK(inFlight.size() <= 3);
+        CHECK(t.GetPendingCount() == inFlight.size());
+    }
+    CHECK(consumed == 18);
+    CHECK(t.GetUsedBytes() == 200);
+}
+
+TEST(ReadbackTracker, ReleasePendingWaitsForGpu)
+{
+    ReadbackTracker t;
+    t.Init(256);
+
+    uint32_t offset = 0;
+    const ReadbackTicket a = t.Enqueue(200, 1, offset);
+    CHECK(a != InvalidReadbackTicket);
+    CHECK(t.Enqueue(100, 1, offset) == InvalidReadbackTicket);
+
+    // тикет уже недоступен, но GPU ещё пишет в его участок
+    t.Release(a);
+    CHECK(t.GetState(a) == ReadbackTracker::State::Invalid);
+    CHECK(t.Enqueue(100, 1, offset) == InvalidReadbackTicket);
+
+    t.OnFenceSignaled(1, 0);
+    CHECK(t.GetUsedBytes() == 200);
+    t.OnFenceSignaled(2, 1);
+    CHECK(t.GetUsedBytes() == 0);
+    CHECK(t.GetLiveCount() == 0);
+}
+
+TEST(ReadbackTracker, TicketWaitsForNextSignal)
+{
+    ReadbackTracker t;
+    t.Init(64);
+
+    uint32_t offset = 0;
+    t.OnFenceSignaled(1, 1);
+    // копия записана после Signal(1) - готова только после следующего
+    const ReadbackTicket c = t.Enqueue(10, 1, offset);
+    t.OnFenceSignaled(2, 1);
+    CHECK(!t.IsReady(c));
+    t.OnFenceSignaled(3, 2);
+    CHECK(t.IsReady(c));
+
+    uint32_t off = 0, size = 0;
+    CHECK(!t.GetRange(12345, off, size));
+    CHECK(t.GetState(InvalidReadbackTicket) == ReadbackTracker::State::Invalid);
+    t.Release(12345);   // чужой тикет игнорируется
+    CHECK(t.GetLiveCount() == 1);
+}
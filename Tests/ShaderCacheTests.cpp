@@ -0,0 +1,135 @@
+#include "Test.h"
+#include "ShaderCache.h"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // своя пустая папка на каждый тест
+    fs::path FreshDir(const char* name)
+    {
+        fs::path dir = fs::temp_directory_path() / "EngineTests" / name;
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        return dir;
+    }
+
+    void WriteText(const fs::path& path, const char* text)
+    {
+        std::ofstream(path, std::ios::binary) << text;
+    }
+
+    ShaderKeyDesc Desc(const fs::path& file)
+    {
+        ShaderKeyDesc d;
+        d.file = file.wstring();
+        d.entry = L"PSMain";
+        d.target = L"ps_6_6";
+        d.defines = { { L"USE_FOG", L"1" } };
+        d.args = { L"-O3" };
+        return d;
+    }
+}
+
+TEST(ShaderCache, KeyIsStable)
+{
+    fs::path dir = FreshDir("key_stable");
+    WriteText(dir / "a.hlsl", "float4 PSMain() : SV_Target { return 1; }\n");
+
+    const uint64_t k0 = ShaderCache::ComputeKey(Desc(dir / "a.hlsl"), "dxc 1.8");
+    CHECK(k0 == ShaderCache::ComputeKey(Desc(dir / "a.hlsl"), "dxc 1.8"));
+    // тот же текст в другом файле - тот же ключ, путь в хэш не входит
+    WriteText(dir / "b.hlsl", "float4 PSMain() : SV_Target { return 1; }\n");
+    CHECK(k0 == ShaderCache::ComputeKey(Desc(dir / "b.hlsl"), "dxc 1.8"));
+}
+
+TEST(ShaderCache, KeyCoversEveryInput)
+{
+    fs::path dir = FreshDir("key_inputs");
+    WriteText(dir / "a.hlsl", "#include \"common.hlsli\"\nfloat4 PSMain() : SV_Target { return K; }\n");
+    WriteText(dir / "common.hlsli", "static const float K = 1;\n");
+
+    const ShaderKeyDesc base = Desc(dir / "a.hlsl");
+    const uint64_t k0 = ShaderCache::ComputeKey(base, "dxc 1.8");
+
+    CHECK(k0 != ShaderCache::ComputeKey(base, "dxc 1.9"));
+
+    ShaderKeyDesc d = base;
+    d.entry = L"PSOther";
+    CHECK(k0 != ShaderCache::ComputeKey(d, "dxc 1.8"));
+
+    d = base;
+    d.target = L"ps_6_5";
+    CHECK(k0 != ShaderCache::ComputeKey(d, "dxc 1.8"));
+
+    d = base;
+    d.defines[0].second = L"0";
+    CHECK(k0 != ShaderCache::ComputeKey(d, "dxc 1.8"));
+
+    d = base;
+    d.defines.clear();
+    CHECK(k0 != ShaderCache::ComputeKey(d, "dxc 1.8"));
+
+    d = base;
+    d.args.push_back(L"-Zi");
+    CHECK(k0 != ShaderCache::ComputeKey(d, "dxc 1.8"));
+
+    // правка во включаемом файле тоже инвалидирует ключ
+    WriteText(dir / "common.hlsli", "static const float K = 2;\n");
+    CHECK(k0 != ShaderCache::ComputeKey(base, "dxc 1.8"));
+}
+
+TEST(ShaderCache, RecursiveIncludesTerminate)
+{
+    fs::path dir = FreshDir("key_cycle");
+    WriteText(dir / "a.hlsli", "#include \"b.hlsli\"\n");
+    WriteText(dir / "b.hlsli", "#include \"a.hlsli\"\n");
+    WriteText(dir / "main.hlsl", "#include \"a.hlsli\"\n#include \"missing.hlsli\"\n");
+
+    const uint64_t k = ShaderCache::ComputeKey(Desc(dir / "main.hlsl"), "v");
+    CHECK(k == ShaderCache::ComputeKey(Desc(dir / "main.hlsl"), "v"));
+}
+
+TEST(ShaderCache, StoreAndLoad)
+{
+    fs::path dir = FreshDir("store");
+    ShaderCache cache((dir / "cache").wstring());
+
+    std::vector<uint8_t> out;
+    CHECK(!cache.Load(42, out));   // холодный кэш, каталога ещё нет
+
+    std::vector<uint8_t> dxil(4096);
+    for (size_t i = 0; i < dxil.size(); ++i)
+        dxil[i] = (uint8_t)(i * 31 + 7);
+    cache.Store(42, dxil.data(), dxil.size());
+
+    CHECK(cache.Load(42, out));
+    CHECK(out == dxil);
+    CHECK(!cache.Load(43, out));
+
+    // перезапись по тому же ключу
+    dxil.resize(16);
+    cache.Store(42, dxil.data(), dxil.size());
+    CHECK(cache.Load(42, out));
+    CHECK(out == dxil);
+
+    // второй экземпляр видит те же файлы - тёплый старт
+    ShaderCache warm((dir / "cache").wstring());
+    CHECK(warm.Load(42, out));
+
+    // от временных файлов ничего не остаётся
+    for (const auto& entry : fs::directory_iterator(dir / "cache"))
+        CHECK(entry.path().extension() == ".dxil");
+}
+
+TEST(ShaderCache, EmptyFileIsMiss)
+{
+    fs::path dir = FreshDir("empty");
+    ShaderCache cache(dir.wstring());
+    cache.Store(7, "", 0);
+
+    std::vector<uint8_t> out;
+    CHECK(!cache.Load(7, out));
+}
@@ -0,0 +1,132 @@
+#include "Test.h"
+#include "StateFilteredCommandList.h"
+
+namespace
+{
+    // считает, что реально дошло до списка команд
+    struct MockCommandList
+    {
+        int heaps = 0, rootSig = 0, pso = 0, topology = 0;
+        int cbv = 0, srv = 0, uav = 0, table = 0;
+        int vb = 0, ib = 0, draws = 0, dispatches = 0;
+
+        void SetDescriptorHeaps(UINT, ID3D12DescriptorHeap* const*) { ++heaps; }
+        void SetGraphicsRootSignature(ID3D12RootSignature*) { ++rootSig; }
+        void SetPipelineState(ID3D12PipelineState*) { ++pso; }
+        void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) { ++topology; }
+        void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { ++cbv; }
+        void SetGraphicsRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { ++srv; }
+        void SetGraphicsRootUnorderedAccessView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { ++uav; }
+        void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) { ++table; }
+        void IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW*) { ++vb; }
+        void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) { ++ib; }
+        void DrawInstanced(UINT, UINT, UINT, UINT) { ++draws; }
+        void DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) { ++draws; }
+        void DispatchMesh(UINT, UINT, UINT) { ++dispatches; }
+    };
+
+    // указатели только сравниваются, разыменования нет
+    template<typename T>
+    T* Fake(uintptr_t id) { return reinterpret_cast<T*>(id * 16); }
+}
+
+TEST(StateFilteredCommandList, ElidesRepeatedState)
+{
+    MockCommandList mock;
+    StateFilteredCommandList<MockCommandList> sc(&mock);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        sc.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+        sc.SetPipelineState(Fake<ID3D12PipelineState>(2));
+        sc.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        sc.SetGraphicsRootConstantBufferView(1, 0x1000);                 // общий CB
+        sc.SetGraphicsRootConstantBufferView(0, 0x2000 + i * 256);       // свой CB объекта
+        sc.DrawIndexedInstanced(36, 1, 0, 0, 0);
+    }
+
+    CHECK(mock.rootSig == 1);
+    CHECK(mock.pso == 1);
+    CHECK(mock.topology == 1);
+    CHECK(mock.cbv == 1 + 10);
+    CHECK(mock.draws == 10);
+    CHECK(sc.GetIssuedCount() == 3 + 11);
+    CHECK(sc.GetElidedCount() == 9 * 4);
+}
+
+TEST(StateFilteredCommandList, RootSignatureResetsParams)
+{
+    MockCommandList mock;
+    StateFilteredCommandList<MockCommandList> sc(&mock);
+
+    sc.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(1));
+    sc.SetGraphicsRootConstantBufferView(1, 0x1000);
+    sc.SetGraphicsRootSignature(Fake<ID3D12RootSignature>(2));
+    sc.SetGraphicsRootConstantBufferView(1, 0x1000);   // после смены сигнатуры - снова
+    CHECK(mock.cbv == 2);
+
+    // смена куч сбрасывает таблицы
+    const D3D12_GPU_DESCRIPTOR_HANDLE t{ 0x40 };
+    sc.SetGraphicsRootDescriptorTable(3, t);
+    sc.SetGraphicsRootDescriptorTable(3, t);
+    CHECK(mock.table == 1);
+    sc.SetDescriptorHeaps(0, nullptr);
+    sc.SetGraphicsRootDescriptorTable(3, t);
+    CHECK(mock.table == 2);
+}
+
+TEST(StateFilteredCommandList, RootParamKindMatters)
+{
+    MockCommandList mock;
+    StateFilteredCommandList<MockCommandList> sc(&mock);
+
+    // тот же адрес, но другой тип параметра - не дубликат
+    sc.SetGraphicsRootConstantBufferView(2, 0x5000);
+    sc.SetGraphicsRootShaderResourceView(2, 0x5000);
+    sc.SetGraphicsRootUnorderedAccessView(2, 0x5000);
+    sc.SetGraphicsRootUnorderedAccessView(2, 0x5000);
+    CHECK(mock.cbv == 1);
+    CHECK(mock.srv == 1);
+    CHECK(mock.uav == 1);
+
+    // параметры за MaxRootParams не кэшируются
+    const UINT beyond = StateFilteredCommandList<MockCommandList>::MaxRootParams;
+    sc.SetGraphicsRootConstantBufferView(beyond, 0x6000);
+    sc.SetGraphicsRootConstantBufferView(beyond, 0x6000);
+    CHECK(mock.cbv == 3);
+}
+
+TEST(StateFilteredCommandList, BufferViews)
+{
+    MockCommandList mock;
+    StateFilteredCommandList<MockCommandList> sc(&mock);
+
+    D3D12_VERTEX_BUFFER_VIEW vbv{ 0x10000, 4096, 32 };
+    D3D12_INDEX_BUFFER_VIEW ibv{ 0x20000, 1024, DXGI_FORMAT_R16_UINT };
+    sc.IASetVertexBuffers(0, 1, &vbv);
+    sc.IASetVertexBuffers(0, 1, &vbv);
+    sc.IASetIndexBuffer(&ibv);
+    sc.IASetIndexBuffer(&ibv);
+    CHECK(mock.vb == 1);
+    CHECK(mock.ib == 1);
+
+    ibv.Format = DXGI_FORMAT_R32_UINT;   // та же память, другой формат индексов
+    sc.IASetIndexBuffer(&ibv);
+    CHECK(mock.ib == 2);
+
+    vbv.StrideInBytes = 20;
+    sc.IASetVertexBuffers(0, 1, &vbv);
+    CHECK(mock.vb == 2);
+}
+
+TEST(StateFilteredCommandList, InvalidateAfterBypass)
+{
+    MockCommandList mock;
+    StateFilteredCommandList<MockCommandList> sc(&mock);
+
+    sc.SetPipelineState(Fake<ID3D12PipelineState>(1));
+    mock.SetPipelineState(Fake<ID3D12PipelineState>(2));   // в обход обёртки
+    sc.Invalidate();
+    sc.SetPipelineState(Fake<ID3D12PipelineState>(1));
+    CHECK(mock.pso == 3);
+}
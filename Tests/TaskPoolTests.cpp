@@ -0,0 +1,47 @@
+#include "Test.h"
+#include "TaskPool.h"
+#include <stdexcept>
+
+TEST(TaskPool, EveryIndexOnce)
+{
+    for (unsigned threads : { 1u, 4u })
+    {
+        TaskPool pool(threads);
+        CHECK(pool.GetThreadCount() == threads);
+        for (size_t count : { (size_t)0, (size_t)1, (size_t)1000, (size_t)100003 })
+        {
+            std::vector<std::atomic<int>> hits(count);
+            std::atomic<size_t> chunks{ 0 };
+            std::atomic<bool> badRange{ false };
+            pool.ParallelFor(count, 64, [&](size_t b, size_t e)
+            {
+                if (!(b < e && e <= count && e - b <= 64))
+                    badRange = true;
+                for (size_t i = b; i < e; ++i)
+                    ++hits[i];
+                ++chunks;
+            });
+            CHECK(!badRange);
+            bool once = true;
+            for (const std::atomic<int>& h : hits)
+                once &= h.load() == 1;
+            CHECK(once);
+            CHECK(chunks == (count + 63) / 64);
+        }
+    }
+}
+
+TEST(TaskPool, RethrowsFirstError)
+{
+    TaskPool pool(4);
+    CHECK_THROWS(pool.ParallelFor(1000, 10, [](size_t b, size_t)
+    {
+        if (b == 500)
+            throw std::runtime_error("chunk");
+    }));
+
+    // после исключения пул рабочий
+    std::atomic<size_t> sum{ 0 };
+    pool.ParallelFor(100, 7, [&](size_t b, size_t e) { sum += e - b; });
+    CHECK(sum == 100);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Минимальный раннер: TEST регистрирует функцию в наборе, CHECK не прерывает тест,
+// а только помечает его упавшим. EngineTests <набор> запускает один набор, без аргумента - все.
+namespace Test
+{
+    struct Case
+    {
+        const char* suite;
+        const char* name;
+        void (*fn)();
+    };
+
+    inline std::vector<Case>& Registry()
+    {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    inline int& Failures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    struct Registrar
+    {
+        Registrar(const char* suite, const char* name, void (*fn)()) { Registry().push_back({ suite, name, fn }); }
+    };
+
+    inline void Fail(const char* file, int line, const char* expr)
+    {
+        std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expr);
+        ++Failures();
+    }
+}
+
+#define TEST(suite, name)                                                        \
+    static void suite##_##name();                                                \
+    static Test::Registrar suite##_##name##_reg(#suite, #name, &suite##_##name); \
+    static void suite##_##name()
+
+#define CHECK(expr)                                  \
+    do                                               \
+    {                                                \
+        if (!(expr))                                 \
+            Test::Fail(__FILE__, __LINE__, #expr);   \
+    } while (0)
+
+#define CHECK_THROWS(expr)                           \
+    do                                               \
+    {                                                \
+        bool thrown_ = false;                        \
+        try { expr; }                                \
+        catch (...) { thrown_ = true; }              \
+        if (!thrown_)                                \
+            Test::Fail(__FILE__, __LINE__, "throws: " #expr); \
+    } while (0)
@@ -0,0 +1,44 @@
+#include "Test.h"
+#include <exception>
+
+int main(int argc, char** argv)
+{
+    const std::string filter = argc > 1 ? argv[1] : "";
+
+    int ran = 0;
+    int failedCases = 0;
+    for (const Test::Case& c : Test::Registry())
+    {
+        if (!filter.empty() && filter != c.suite)
+            continue;
+
+        const int before = Test::Failures();
+        try
+        {
+            c.fn();
+        }
+        catch (const std::exception& e)
+        {
+            std::printf("  unexpected exception: %s\n", e.what());
+            ++Test::Failures();
+        }
+        catch (...)
+        {
+            std::printf("  unexpected exception\n");
+            ++Test::Failures();
+        }
+
+        const bool ok = Test::Failures() == before;
+        std::printf("[%s] %s.%s\n", ok ? " OK " : "FAIL", c.suite, c.name);
+        failedCases += ok ? 0 : 1;
+        ++ran;
+    }
+
+    if (ran == 0)
+    {
+        std::printf("no tests in suite '%s'\n", filter.c_str());
+        return 1;
+    }
+    std::printf("%d tests, %d failed\n", ran, failedCases);
+    return failedCases == 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+#include "Test.h"
+#include "VertexPacking.h"
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+namespace
+{
+    // границы ошибок упаковки: шейдеры и CPU-распаковка на них рассчитывают
+    const float PositionErrorBoundSteps = 0.5f;   // округление к ближайшему узлу UNORM16
+    const float DirectionErrorBoundDeg = 0.01f;   // октаэдр SNORM16, вариант "precise"
+    const float UvErrorBound = 1.0f / 2048.0f;    // половина ulp half относительно значения
+
+    double AngleDeg(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        const double la = std::sqrt((double)a.x * a.x + (double)a.y * a.y + (double)a.z * a.z);
+        const double lb = std::sqrt((double)b.x * b.x + (double)b.y * b.y + (double)b.z * b.z);
+        const double ex = a.x / la - b.x / lb, ey = a.y / la - b.y / lb, ez = a.z / la - b.z / lb;
+        return 2.0 * std::asin((std::min)(std::sqrt(ex * ex + ey * ey + ez * ez) * 0.5, 1.0)) * 180.0 / 3.14159265358979323846;
+    }
+
+    // эталон: ближайший half с округлением к чётному через double
+    double ReferenceHalf(float f)
+    {
+        const double x = std::fabs((double)f);
+        const double ulp = x < std::ldexp(1.0, -14) ? std::ldexp(1.0, -24) : std::ldexp(1.0, std::ilogb(x) - 10);
+        const double q = std::nearbyint(x / ulp) * ulp;
+        const double r = q > 65504.0 ? INFINITY : q;
+        return std::signbit(f) ? -r : r;
+    }
+}
+
+TEST(VertexPacking, HalfMatchesReferenceRounding)
+{
+    // каждое число half переживает круг half -> float -> half
+    for (uint32_t h = 0; h < 65536; ++h)
+    {
+        if (((h >> 10) & 0x1Fu) == 31 && (h & 0x3FFu))
+            continue;
+        CHECK(FloatToHalf(HalfToFloat((uint16_t)h)) == h);
+    }
+
+    std::mt19937 rng(5u);
+    std::uniform_real_distribution<float> mant(1.0f, 2.0f);
+    for (int i = 0; i < 200000; ++i)
+    {
+        const int e = (int)(rng() % 46) - 30;   // от глубоких денормалов до переполнения
+        const float f = std::ldexp(mant(rng), e) * (rng() & 1 ? -1.0f : 1.0f);
+        const float back = HalfToFloat(FloatToHalf(f));
+        CHECK((double)back == ReferenceHalf(f));
+        if (std::fabs(f) >= 6.103515625e-05f && std::fabs(f) <= 65504.0f)
+            CHECK(std::fabs(back - f) <= UvErrorBound * std::fabs(f));
+    }
+
+    // середины между соседями - к чётной мантиссе
+    CHECK(FloatToHalf(1.0f + 1.0f / 2048.0f) == 0x3C00u);
+    CHECK(FloatToHalf(1.0f + 3.0f / 2048.0f) == 0x3C02u);
+    CHECK(FloatToHalf(65504.0f) == 0x7BFFu);
+    CHECK(FloatToHalf(65519.0f) == 0x7BFFu);
+    CHECK(FloatToHalf(65520.0f) == 0x7C00u);
+    CHECK(FloatToHalf(-INFINITY) == 0xFC00u);
+    CHECK(std::isnan(HalfToFloat(FloatToHalf(NAN))));
+    CHECK(FloatToHalf(-0.0f) == 0x8000u);
+}
+
+TEST(VertexPacking, OctahedralDirectionError)
+{
+    double worst = 0.0;
+    const int n = 200000;
+    for (int i = 0; i < n; ++i)
+    {
+        const float z = 1.0f - 2.0f * (i + 0.5f) / n;
+        const float r = std::sqrt((std::max)(1.0f - z * z, 0.0f));
+        const float phi = i * 2.39996323f;
+        const XMFLOAT3 v = { r * std::cos(phi), r * std::sin(phi), z };
+
+        int16_t e[2];
+        OctEncode(v, e);
+        const XMFLOAT3 d = OctDecode(e);
+        worst = (std::max)(worst, AngleDeg(v, d));
+        CHECK(std::fabs(d.x * d.x + d.y * d.y + d.z * d.z - 1.0f) < 1e-5f);
+    }
+    CHECK(worst <= DirectionErrorBoundDeg);
+
+    // оси и диагонали - стыки граней октаэдра; длина на направление не влияет
+    for (int x = -1; x <= 1; ++x)
+        for (int y = -1; y <= 1; ++y)
+            for (int z = -1; z <= 1; ++z)
+            {
+                if (!x && !y && !z)
+                    continue;
+                const XMFLOAT3 v = { 3.0f * x, 3.0f * y, 3.0f * z };
+                int16_t e[2];
+                OctEncode(v, e);
+                CHECK(AngleDeg(v, OctDecode(e)) <= DirectionErrorBoundDeg);
+            }
+
+    int16_t zero[2] = { 1, 1 };
+    OctEncode({ 0.0f, 0.0f, 0.0f }, zero);
+    const XMFLOAT3 up = OctDecode(zero);
+    CHECK(up.x == 0.0f && up.y == 0.0f && up.z == 1.0f);
+}
+
+TEST(VertexPacking, PositionQuantizationError)
+{
+    std::mt19937 rng(11u);
+    std::uniform_real_distribution<float> coord(-20.0f, 30.0f);
+    std::vector<Vertex> vertices(20000);
+    for (Vertex& v : vertices)
+    {
+        v.Pos = { coord(rng), coord(rng) * 0.01f, coord(rng) + 1000.0f };
+        v.Normal = { 0.0f, 1.0f, 0.0f };
+        v.handedness = (rng() & 1) ? 1.0f : -1.0f;
+    }
+    const VertexQuantization q = ComputeVertexQuantization(vertices.data(), vertices.size());
+
+    for (const Vertex& v : vertices)
+    {
+        const PackedVertex p = PackVertex(v, q);
+        const Vertex b = UnpackVertex(p, q);
+        const float in[3] = { v.Pos.x, v.Pos.y, v.Pos.z };
+        const float out[3] = { b.Pos.x, b.Pos.y, b.Pos.z };
+        const float offset[3] = { q.offset.x, q.offset.y, q.offset.z };
+        const float scale[3] = { q.scale.x, q.scale.y, q.scale.z };
+        for (int k = 0; k < 3; ++k)
+        {
+            // к полушагу добавляется округление float в offset + unorm * scale
+            const float rounding = 4.0f * FLT_EPSILON * (std::fabs(offset[k]) + scale[k]);
+            CHECK(std::fabs(in[k] - out[k]) <= PositionErrorBoundSteps * scale[k] / 65535.0f + rounding);
+        }
+        CHECK(b.handedness == v.handedness);
+    }
+
+    // вырожденный AABB: позиция восстанавливается точно
+    Vertex flat = vertices[0];
+    flat.Pos = { 3.0f, -2.0f, 1.0f };
+    const VertexQuantization fq = ComputeVertexQuantization(&flat, 1);
+    const Vertex fb = UnpackVertex(PackVertex(flat, fq), fq);
+    CHECK(fb.Pos.x == 3.0f && fb.Pos.y == -2.0f && fb.Pos.z == 1.0f);
+}
+
+TEST(VertexPacking, SelfTestAndSceneWithinBounds)
+{
+    const VertexPackStats self = RunVertexPackSelfTest();
+    CHECK(self.vertices > 100000);
+    CHECK(self.roundTripMismatches == 0);
+    CHECK(self.handednessFlips == 0);
+    CHECK(self.maxNormalDeg <= DirectionErrorBoundDeg);
+    CHECK(self.maxTangentDeg <= DirectionErrorBoundDeg);
+    CHECK(self.maxUvError <= UvErrorBound);
+    // позиции самотеста: offset не больше размера AABB, округление float - меньше 0.05 шага
+    CHECK(self.maxPositionError <= PositionErrorBoundSteps + 0.05f);
+
+    const std::vector<Mesh> lods = { CreateSphere(64, 64, 2.0f), CreateSphere(16, 16, 2.0f) };
+    const VertexPackStats scene = MeasureVertexPacking(lods);
+    CHECK(scene.vertices == lods[0].vertices.size() + lods[1].vertices.size());
+    CHECK(scene.roundTripMismatches == 0);
+    CHECK(scene.handednessFlips == 0);
+    CHECK(scene.maxNormalDeg <= DirectionErrorBoundDeg);
+    CHECK(scene.maxUvError <= UvErrorBound);
+    CHECK(scene.maxPositionError <= PositionErrorBoundSteps + 0.05f);
+    // 20 байт на вершину и uint16 индексы против 48 байт и uint32
+    CHECK(scene.packedBytes * 2 < scene.floatBytes);
+}
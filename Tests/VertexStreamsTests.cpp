@@ -0,0 +1,84 @@
+#include "Test.h"
+#include "VertexStreams.h"
+#include "VertexPacking.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    std::vector<Vertex> RandomVertices(size_t count, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> d(-100.0f, 100.0f);
+        std::vector<Vertex> v(count);
+        for (Vertex& x : v)
+        {
+            x.Pos = { d(rng), d(rng), d(rng) };
+            x.Normal = { d(rng), d(rng), d(rng) };
+            x.uv = { d(rng), d(rng) };
+            x.tangent = { d(rng), d(rng), d(rng) };
+            x.handedness = rng() % 2 ? 1.0f : -1.0f;
+        }
+        if (count > 1)
+            v[1].Pos = { -0.0f, 1e-40f, 3.0e38f };   // знак нуля и денормали должны доехать как есть
+        return v;
+    }
+
+    // атрибутный поток - тот же Vertex, позицию из него проходы с потоком позиций не читают
+    std::vector<Vertex> AttributesOnly(std::vector<Vertex> v)
+    {
+        for (Vertex& x : v)
+            x.Pos = { NAN, NAN, NAN };
+        return v;
+    }
+}
+
+TEST(VertexStreams, PositionsAndAttributesRebuildVertices)
+{
+    for (size_t count : { (size_t)1, (size_t)2, (size_t)1000 })
+    {
+        const std::vector<Vertex> original = RandomVertices(count, (uint32_t)count);
+
+        // лишний элемент в конце - запись не выходит за count
+        std::vector<XMFLOAT3> positions(count + 1, XMFLOAT3{ 7.0f, 7.0f, 7.0f });
+        SplitPositionStream(original.data(), count, positions.data());
+        CHECK(positions[count].x == 7.0f && positions[count].y == 7.0f && positions[count].z == 7.0f);
+
+        std::vector<Vertex> rebuilt = AttributesOnly(original);
+        for (size_t i = 0; i < count; ++i)
+            rebuilt[i].Pos = positions[i];
+        CHECK(memcmp(rebuilt.data(), original.data(), count * sizeof(Vertex)) == 0);
+
+        // ExtractPositionStream - то же, плотно по PositionStreamStride
+        const std::vector<XMFLOAT3> extracted = ExtractPositionStream(original);
+        CHECK(extracted.size() == count);
+        CHECK(memcmp(extracted.data(), positions.data(), count * PositionStreamStride) == 0);
+    }
+
+    CHECK(PositionStreamStride == 12);
+    CHECK(ExtractPositionStream({}).empty());
+    SplitPositionStream(nullptr, 0, nullptr);
+}
+
+TEST(VertexStreams, ExactPositionsNextToPackedAttributes)
+{
+    // с упакованными вершинами позиция в основном потоке квантована, а в потоке позиций - точная
+    const std::vector<Vertex> original = RandomVertices(500, 3u);
+    const VertexQuantization q = ComputeVertexQuantization(original.data(), original.size());
+    std::vector<PackedVertex> packed(original.size());
+    PackVertices(original.data(), original.size(), q, packed.data());
+    const std::vector<XMFLOAT3> positions = ExtractPositionStream(original);
+
+    bool exact = true, quantized = false;
+    for (size_t i = 0; i < original.size(); ++i)
+    {
+        Vertex v = UnpackVertex(packed[i], q);
+        quantized |= memcmp(&v.Pos, &original[i].Pos, sizeof(XMFLOAT3)) != 0;
+        v.Pos = positions[i];
+        exact &= memcmp(&v.Pos, &original[i].Pos, sizeof(XMFLOAT3)) == 0;
+        exact &= v.handedness == original[i].handedness;
+    }
+    CHECK(exact);
+    CHECK(quantized);
+}
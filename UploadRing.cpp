@@ -0,0 +1,91 @@
+#include "UploadRing.h"
+#include "d3dx12.h"
+#include <stdexcept>
+
+static inline void ThrowIfFailed(HRESULT hr)
+{
+    if (FAILED(hr))
+        throw std::runtime_error("HRESULT failed");
+}
+
+static inline UINT64 AlignUp(UINT64 v, UINT64 a)
+{
+    return (v + a - 1) / a * a;
+}
+
+void UploadRing::Init(GpuHeapAllocator* allocator, UINT64 size)
+{
+    CD3DX12_HEAP_PROPERTIES heapUpload(D3D12_HEAP_TYPE_UPLOAD);
+    auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    ThrowIfFailed(allocator->CreateResource(
+        &heapUpload, D3D12_HEAP_FLAG_NONE, &desc,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_buffer)));
+
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_cpu)));
+    m_gpu = m_buffer->GetGPUVirtualAddress();
+
+    m_size = size;
+    m_head = m_tail = m_used = 0;
+    m_segments.clear();
+}
+
+StagingBuffer UploadRing::Allocate(UINT64 size, UINT64 alignment)
+{
+    StagingBuffer b;
+    if (size == 0 || size > m_size)
+        return b;
+
+    UINT64 offset = AlignUp(m_head, alignment);
+    UINT64 bytes = offset + size - m_head;
+
+    if (m_used != 0 && m_head <= m_tail)
+    {
+        // занято [tail, size) и [0, head): свободно только [head, tail)
+        if (offset + size > m_tail)
+            return b;
+    }
+    else if (offset + size > m_size)
+    {
+        // не влезает до конца буфера - начинаем с нуля, хвост пропускаем
+        if (size > m_tail)
+            return b;
+        bytes = (m_size - m_head) + size;
+        offset = 0;
+    }
+
+    m_head = offset + size;
+    m_used += bytes;
+
+    if (!m_segments.empty() && m_segments.back().fence == m_nextFence)
+    {
+        m_segments.back().end = m_head;
+        m_segments.back().bytes += bytes;
+    }
+    else
+    {
+        m_segments.push_back({ m_nextFence, m_head, bytes });
+    }
+
+    b.resource = m_buffer.Get();
+    b.cpu = m_cpu + offset;
+    b.gpu = m_gpu + offset;
+    b.offset = offset;
+    b.size = size;
+    return b;
+}
+
+void UploadRing::OnFenceSignaled(UINT64 signaled, UINT64 completed)
+{
+    m_nextFence = signaled + 1;
+
+    while (!m_segments.empty() && m_segments.front().fence <= completed)
+    {
+        m_tail = m_segments.front().end;
+        m_used -= m_segments.front().bytes;
+        m_segments.pop_front();
+    }
+
+    if (m_used == 0)
+        m_head = m_tail = 0;
+}
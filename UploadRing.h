@@ -0,0 +1,42 @@
+#pragma once
+#include <wrl.h>
+#include <d3d12.h>
+#include <cstdint>
+#include <deque>
+#include "StagingPool.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Один постоянно отображённый upload-буфер, выдаётся по кругу.
+// Место, выданное до очередного Signal, освобождается, когда fence дойдёт до этого значения.
+// Если места нет, Allocate возвращает пустой StagingBuffer.
+class UploadRing
+{
+public:
+    void Init(GpuHeapAllocator* allocator, UINT64 size);
+
+    StagingBuffer Allocate(UINT64 size, UINT64 alignment);
+    void OnFenceSignaled(UINT64 signaled, UINT64 completed);
+
+    UINT64 GetSize() const { return m_size; }
+    UINT64 GetUsedBytes() const { return m_used; }
+
+private:
+    struct Segment
+    {
+        UINT64 fence;
+        UINT64 end;     // смещение сразу за последним выделением в этом сегменте
+        UINT64 bytes;   // вместе с выравниванием и пропуском в конце буфера
+    };
+
+    ComPtr<ID3D12Resource> m_buffer;
+    uint8_t* m_cpu = nullptr;
+    D3D12_GPU_VIRTUAL_ADDRESS m_gpu = 0;
+    UINT64 m_size = 0;
+
+    UINT64 m_head = 0;
+    UINT64 m_tail = 0;
+    UINT64 m_used = 0;
+    UINT64 m_nextFence = 1;
+    std::deque<Segment> m_segments;
+};
@@ -0,0 +1,378 @@
+#include "VertexPacking.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+static uint16_t QuantizeUnorm16(float v)
+{
+    // NaN уходит в 0
+    const float c = v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f;
+    return (uint16_t)(c * 65535.0f + 0.5f);
+}
+
+static float SnormToFloat(int16_t v)
+{
+    return (std::max)(v / 32767.0f, -1.0f);
+}
+
+static void GrowBounds(const Vertex* vertices, size_t count, XMFLOAT3& mn, XMFLOAT3& mx)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const XMFLOAT3& p = vertices[i].Pos;
+        if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+            continue;
+        mn.x = (std::min)(mn.x, p.x); mx.x = (std::max)(mx.x, p.x);
+        mn.y = (std::min)(mn.y, p.y); mx.y = (std::max)(mx.y, p.y);
+        mn.z = (std::min)(mn.z, p.z); mx.z = (std::max)(mx.z, p.z);
+    }
+}
+
+static VertexQuantization QuantizationFromBounds(const XMFLOAT3& mn, const XMFLOAT3& mx)
+{
+    VertexQuantization q;
+    if (mn.x > mx.x)
+        return q;
+    q.offset = mn;
+    q.scale = { mx.x - mn.x, mx.y - mn.y, mx.z - mn.z };
+    return q;
+}
+
+VertexQuantization ComputeVertexQuantization(const Vertex* vertices, size_t count)
+{
+    XMFLOAT3 mn = { INFINITY, INFINITY, INFINITY };
+    XMFLOAT3 mx = { -INFINITY, -INFINITY, -INFINITY };
+    GrowBounds(vertices, count, mn, mx);
+    return QuantizationFromBounds(mn, mx);
+}
+
+VertexQuantization ComputeVertexQuantization(const std::vector<Mesh>& lods)
+{
+    XMFLOAT3 mn = { INFINITY, INFINITY, INFINITY };
+    XMFLOAT3 mx = { -INFINITY, -INFINITY, -INFINITY };
+    for (const Mesh& m : lods)
+        GrowBounds(m.vertices.data(), m.vertices.size(), mn, mx);
+    return QuantizationFromBounds(mn, mx);
+}
+
+uint16_t FloatToHalf(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000u;
+    const uint32_t a = x & 0x7FFFFFFFu;
+
+    if (a >= 0x7F800000u)
+        return (uint16_t)(sign | 0x7C00u | (a > 0x7F800000u ? 0x200u : 0u));
+    // 65520 и больше округляется в бесконечность
+    if (a >= 0x477FF000u)
+        return (uint16_t)(sign | 0x7C00u);
+
+    if (a < 0x38800000u)
+    {
+        // денормализованный half: единица - 2^-24
+        if (a < 0x33000000u)
+            return (uint16_t)sign;
+        const uint32_t mant = (a & 0x7FFFFFu) | 0x800000u;
+        const uint32_t shift = 126u - (a >> 23);
+        uint32_t h = mant >> shift;
+        const uint32_t rest = mant & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1u);
+        if (rest > halfway || (rest == halfway && (h & 1u)))
+            ++h;
+        return (uint16_t)(sign | h);
+    }
+
+    // перенос из мантиссы при округлении сам увеличивает порядок
+    uint32_t h = (a - 0x38000000u) >> 13;
+    const uint32_t rest = a & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (h & 1u)))
+        ++h;
+    return (uint16_t)(sign | h);
+}
+
+float HalfToFloat(uint16_t h)
+{
+    const uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1Fu;
+    const uint32_t mant = h & 0x3FFu;
+
+    uint32_t x;
+    if (exponent == 0)
+    {
+        const float f = mant * (1.0f / 16777216.0f);
+        memcpy(&x, &f, sizeof(x));
+        x |= sign;
+    }
+    else if (exponent == 31)
+        x = sign | 0x7F800000u | (mant << 13);
+    else
+        x = sign | ((exponent + 112u) << 23) | (mant << 13);
+
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static float SignNotZero(float v)
+{
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+XMFLOAT3 OctDecode(const int16_t e[2])
+{
+    float x = SnormToFloat(e[0]);
+    float y = SnormToFloat(e[1]);
+    const float z = 1.0f - std::fabs(x) - std::fabs(y);
+    const float t = (std::max)(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+
+    const float len = std::sqrt(x * x + y * y + z * z);
+    return { x / len, y / len, z / len };
+}
+
+void OctEncode(const XMFLOAT3& v, int16_t out[2])
+{
+    const float l1 = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+    if (!(l1 > 0.0f) || !std::isfinite(l1))
+    {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    float px = v.x / l1;
+    float py = v.y / l1;
+    if (v.z < 0.0f)
+    {
+        const float ox = (1.0f - std::fabs(py)) * SignNotZero(px);
+        const float oy = (1.0f - std::fabs(px)) * SignNotZero(py);
+        px = ox;
+        py = oy;
+    }
+
+    const float len = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    const float bx = std::floor((std::min)((std::max)(px, -1.0f), 1.0f) * 32767.0f);
+    const float by = std::floor((std::min)((std::max)(py, -1.0f), 1.0f) * 32767.0f);
+
+    float bestDot = -2.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        const int16_t c[2] = {
+            (int16_t)(std::min)(bx + (i & 1), 32767.0f),
+            (int16_t)(std::min)(by + (i >> 1), 32767.0f) };
+        const XMFLOAT3 d = OctDecode(c);
+        const float dot = (d.x * v.x + d.y * v.y + d.z * v.z) / len;
+        if (dot > bestDot)
+        {
+            bestDot = dot;
+            out[0] = c[0];
+            out[1] = c[1];
+        }
+    }
+}
+
+PackedVertex PackVertex(const Vertex& v, const VertexQuantization& q)
+{
+    auto unorm = [](float p, float offset, float scale) {
+        return QuantizeUnorm16(scale > 0.0f ? (p - offset) / scale : 0.0f);
+    };
+
+    PackedVertex p;
+    p.pos[0] = unorm(v.Pos.x, q.offset.x, q.scale.x);
+    p.pos[1] = unorm(v.Pos.y, q.offset.y, q.scale.y);
+    p.pos[2] = unorm(v.Pos.z, q.offset.z, q.scale.z);
+    p.pos[3] = v.handedness < 0.0f ? 0 : 65535;
+    OctEncode(v.Normal, p.normal);
+    OctEncode(v.tangent, p.tangent);
+    p.uv[0] = FloatToHalf(v.uv.x);
+    p.uv[1] = FloatToHalf(v.uv.y);
+    return p;
+}
+
+Vertex UnpackVertex(const PackedVertex& p, const VertexQuantization& q)
+{
+    Vertex v;
+    v.Pos = {
+        q.offset.x + p.pos[0] / 65535.0f * q.scale.x,
+        q.offset.y + p.pos[1] / 65535.0f * q.scale.y,
+        q.offset.z + p.pos[2] / 65535.0f * q.scale.z };
+    v.Normal = OctDecode(p.normal);
+    v.uv = { HalfToFloat(p.uv[0]), HalfToFloat(p.uv[1]) };
+    v.tangent = OctDecode(p.tangent);
+    v.handedness = p.pos[3] / 65535.0f * 2.0f - 1.0f;
+    return v;
+}
+
+void PackVertices(const Vertex* vertices, size_t count, const VertexQuantization& q, PackedVertex* out)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = PackVertex(vertices[i], q);
+}
+
+void PackIndices16(const uint32_t* indices, size_t count, uint16_t* out)
+{
+    for (size_t i = 0; i < count; ++i)
+        out[i] = (uint16_t)indices[i];
+}
+
+VertexPackStats& VertexPackStats::operator+=(const VertexPackStats& o)
+{
+    vertices += o.vertices;
+    indices += o.indices;
+    floatBytes += o.floatBytes;
+    packedBytes += o.packedBytes;
+    maxPositionError = (std::max)(maxPositionError, o.maxPositionError);
+    maxNormalDeg = (std::max)(maxNormalDeg, o.maxNormalDeg);
+    maxTangentDeg = (std::max)(maxTangentDeg, o.maxTangentDeg);
+    maxUvError = (std::max)(maxUvError, o.maxUvError);
+    handednessFlips += o.handednessFlips;
+    roundTripMismatches += o.roundTripMismatches;
+    packMs += o.packMs;
+    return *this;
+}
+
+// угол между исходным и распакованным направлением; нулевые и нечисловые исходные не считаются
+static float AngleDeg(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+    const double la = std::sqrt((double)a.x * a.x + (double)a.y * a.y + (double)a.z * a.z);
+    if (!(la > 0.0) || !std::isfinite(la))
+        return 0.0f;
+    const double d = (a.x * (double)b.x + a.y * (double)b.y + a.z * (double)b.z) / la;
+    const double c = (std::min)((std::max)(d, -1.0), 1.0);
+    // acos теряет точность у 1, поэтому через длину разности
+    const double ex = a.x / la - b.x, ey = a.y / la - b.y, ez = a.z / la - b.z;
+    const double chord = std::sqrt(ex * ex + ey * ey + ez * ez);
+    return (float)((c > 0.0 ? 2.0 * std::asin((std::min)(chord * 0.5, 1.0)) : std::acos(c)) * 180.0 / 3.14159265358979323846);
+}
+
+static void MeasureVertices(const Vertex* vertices, size_t count, const VertexQuantization& q, VertexPackStats& s)
+{
+    std::vector<PackedVertex> packed(count);
+    const auto start = std::chrono::steady_clock::now();
+    PackVertices(vertices, count, q, packed.data());
+    s.packMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    auto axisError = [](float a, float b, float scale) {
+        if (!std::isfinite(a))
+            return 0.0f;
+        return scale > 0.0f ? std::fabs(a - b) / scale * 65535.0f : std::fabs(a - b);
+    };
+    float maxPositionError = 0.0f;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Vertex& a = vertices[i];
+        const Vertex b = UnpackVertex(packed[i], q);
+
+        maxPositionError = (std::max)({ maxPositionError,
+            axisError(a.Pos.x, b.Pos.x, q.scale.x),
+            axisError(a.Pos.y, b.Pos.y, q.scale.y),
+            axisError(a.Pos.z, b.Pos.z, q.scale.z) });
+        s.maxNormalDeg = (std::max)(s.maxNormalDeg, AngleDeg(a.Normal, b.Normal));
+        s.maxTangentDeg = (std::max)(s.maxTangentDeg, AngleDeg(a.tangent, b.tangent));
+
+        const float uv[2] = { a.uv.x, a.uv.y };
+        const float uvBack[2] = { b.uv.x, b.uv.y };
+        for (int k = 0; k < 2; ++k)
+        {
+            if (!std::isfinite(uv[k]))
+                continue;
+            const float denom = (std::max)(std::fabs(uv[k]), 1.0f / 16384.0f);
+            s.maxUvError = (std::max)(s.maxUvError, std::fabs(uv[k] - uvBack[k]) / denom);
+        }
+
+        if (a.handedness != 0.0f && (a.handedness < 0.0f) != (b.handedness < 0.0f))
+            ++s.handednessFlips;
+    }
+
+    s.vertices += count;
+    s.maxPositionError = (std::max)(s.maxPositionError, maxPositionError);
+}
+
+VertexPackStats MeasureVertexPacking(const std::vector<Mesh>& lods)
+{
+    VertexPackStats s;
+    const VertexQuantization q = ComputeVertexQuantization(lods);
+    for (const Mesh& m : lods)
+    {
+        MeasureVertices(m.vertices.data(), m.vertices.size(), q, s);
+
+        s.indices += m.indices.size();
+        s.floatBytes += m.vertices.size() * sizeof(Vertex) + m.indices.size() * sizeof(uint32_t);
+        s.packedBytes += m.vertices.size() * sizeof(PackedVertex) +
+            m.indices.size() * (FitsIndex16(m.vertices.size()) ? sizeof(uint16_t) : sizeof(uint32_t));
+
+        if (FitsIndex16(m.vertices.size()))
+        {
+            std::vector<uint16_t> narrow(m.indices.size());
+            PackIndices16(m.indices.data(), m.indices.size(), narrow.data());
+            for (size_t i = 0; i < narrow.size(); ++i)
+                if (narrow[i] != m.indices[i])
+                    ++s.roundTripMismatches;
+        }
+    }
+    return s;
+}
+
+VertexPackStats RunVertexPackSelfTest()
+{
+    std::vector<Vertex> vertices;
+
+    // направления по спирали Фибоначчи, оси и диагонали (стыки граней октаэдра)
+    std::vector<XMFLOAT3> dirs;
+    const int spiral = 100000;
+    for (int i = 0; i < spiral; ++i)
+    {
+        const float z = 1.0f - 2.0f * (i + 0.5f) / spiral;
+        const float r = std::sqrt((std::max)(1.0f - z * z, 0.0f));
+        const float phi = i * 2.39996323f;
+        dirs.push_back({ r * std::cos(phi), r * std::sin(phi), z });
+    }
+    for (int x = -1; x <= 1; ++x)
+        for (int y = -1; y <= 1; ++y)
+            for (int z = -1; z <= 1; ++z)
+                if (x || y || z)
+                    dirs.push_back({ (float)x, (float)y, (float)z });
+    dirs.push_back({ 1e-20f, -1e-20f, -1.0f });
+    dirs.push_back({ 0.0f, 0.0f, -0.0f });
+
+    const float uvs[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.5f, 0.999f, 1e-5f, 6.1e-5f, 3.0e-8f, 1024.3f, -65504.0f, 65504.0f, 0.333333f };
+    const size_t uvCount = sizeof(uvs) / sizeof(uvs[0]);
+
+    for (size_t i = 0; i < dirs.size(); ++i)
+    {
+        Vertex v;
+        const float t = (float)i / dirs.size();
+        v.Pos = { -50.0f + 100.0f * t, 1e-3f * std::sin(t * 1000.0f), 7.0f };
+        v.Normal = dirs[i];
+        v.tangent = dirs[dirs.size() - 1 - i];
+        v.uv = { uvs[i % uvCount], uvs[(i / uvCount) % uvCount] };
+        v.handedness = (i & 1) ? 1.0f : -1.0f;
+        vertices.push_back(v);
+    }
+
+    VertexPackStats s;
+    MeasureVertices(vertices.data(), vertices.size(), ComputeVertexQuantization(vertices.data(), vertices.size()), s);
+
+    // вырожденный AABB: все позиции совпадают, шаг квантизации нулевой
+    Vertex flat = vertices[0];
+    flat.Pos = { 3.0f, -2.0f, 1.0f };
+    const std::vector<Vertex> same(3, flat);
+    MeasureVertices(same.data(), same.size(), ComputeVertexQuantization(same.data(), same.size()), s);
+
+    // half: каждое значение переживает круг half -> float -> half
+    for (uint32_t h = 0; h < 65536; ++h)
+    {
+        const uint32_t exponent = (h >> 10) & 0x1Fu;
+        if (exponent == 31 && (h & 0x3FFu))
+            continue;
+        if (FloatToHalf(HalfToFloat((uint16_t)h)) != h)
+            ++s.roundTripMismatches;
+    }
+
+    s.floatBytes = s.vertices * sizeof(Vertex);
+    s.packedBytes = s.vertices * sizeof(PackedVertex);
+    return s;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Meshes.h"
+
+// Упакованная вершина резидентной геометрии: 20 байт вместо 48 у Vertex.
+// Раскладку читают input layout в Pipeline и VertexPacking.hlsli - менять вместе.
+struct PackedVertex
+{
+    uint16_t pos[4];     // xyz - UNORM16 внутри VertexQuantization, w - handedness: 0 -> -1, 65535 -> +1
+    int16_t normal[2];   // октаэдрическая развёртка, SNORM16
+    int16_t tangent[2];  // октаэдрическая развёртка, SNORM16
+    uint16_t uv[2];      // half
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex layout is shared with shaders");
+
+// pos = offset + unorm * scale; одна на объект, общая для всех его LOD
+struct VertexQuantization
+{
+    XMFLOAT3 offset = { 0.0f, 0.0f, 0.0f };
+    XMFLOAT3 scale = { 1.0f, 1.0f, 1.0f };
+};
+
+// по AABB вершин, нечисловые координаты пропускаются
+VertexQuantization ComputeVertexQuantization(const Vertex* vertices, size_t count);
+VertexQuantization ComputeVertexQuantization(const std::vector<Mesh>& lods);
+
+uint16_t FloatToHalf(float f);  // округление к ближайшему чётному, за пределами half - бесконечность
+float HalfToFloat(uint16_t h);
+
+// Cigolle et al. 2014, вариант "precise": из 4 соседних узлов берётся ближайший по углу.
+// Нулевой вектор кодируется как (0, 0, 1)
+void OctEncode(const XMFLOAT3& v, int16_t out[2]);
+XMFLOAT3 OctDecode(const int16_t e[2]);
+
+PackedVertex PackVertex(const Vertex& v, const VertexQuantization& q);
+Vertex UnpackVertex(const PackedVertex& p, const VertexQuantization& q);
+void PackVertices(const Vertex* vertices, size_t count, const VertexQuantization& q, PackedVertex* out);
+
+// 16-битные индексы - когда все номера вершин влезают в uint16
+inline bool FitsIndex16(size_t vertexCount) { return vertexCount <= 65536; }
+void PackIndices16(const uint32_t* indices, size_t count, uint16_t* out);
+
+struct VertexPackStats
+{
+    size_t vertices = 0;
+    size_t indices = 0;
+    size_t floatBytes = 0;    // Vertex + uint32 индексы
+    size_t packedBytes = 0;   // PackedVertex + uint16/uint32 индексы
+
+    // границы ошибок проверяет Tests/VertexPackingTests.cpp
+    float maxPositionError = 0.0f;  // в шагах квантизации по оси
+    float maxNormalDeg = 0.0f;
+    float maxTangentDeg = 0.0f;
+    float maxUvError = 0.0f;        // относительно max(|uv|, 2^-14)
+    size_t handednessFlips = 0;
+    size_t roundTripMismatches = 0; // half или uint16-индекс изменился после упаковки и распаковки
+    double packMs = 0.0;
+
+    VertexPackStats& operator+=(const VertexPackStats& o);
+};
+
+// упаковка всех LOD одного объекта с общей квантизацией и сравнение распакованного с исходным
+VertexPackStats MeasureVertexPacking(const std::vector<Mesh>& lods);
+
+// то же на синтетике: направления по всей сфере и по осям, граничные uv, вырожденный AABB,
+// плюс круг half -> float -> half для всех 65536 значений
+VertexPackStats RunVertexPackSelfTest();
@@ -0,0 +1,63 @@
+//  PackedVertex  VertexPacking.h,     .
+//    AABB : pos = QuantOffset + unorm * QuantScale (ObjectCB)
+
+//   ,   MeshVertex  Meshlets.h
+struct MeshVertex
+{
+    float3 pos;
+    float3 normal;
+    float2 uv;
+    float3 tangent;
+    float handed;
+};
+
+// 20 ,  StructuredBuffer 
+struct PackedMeshVertex
+{
+    uint2 pos;     // UNORM16 x4: xyz  handedness  w
+    uint normal;   // SNORM16 x2, 
+    uint tangent;  // SNORM16 x2, 
+    uint uv;       // half x2
+};
+
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += select(n.xy >= 0.0, -t.xx, t.xx);
+    return normalize(n);
+}
+
+//  ,   input assembler  R16G16_SNORM  R16G16B16A16_UNORM
+float2 UnpackSnorm2x16(uint v)
+{
+    int2 i = int2(v << 16, v) >> 16;
+    return max(float2(i) / 32767.0, -1.0);
+}
+
+float4 UnpackUnorm4x16(uint2 v)
+{
+    return float4(v.x & 0xFFFF, v.x >> 16, v.y & 0xFFFF, v.y >> 16) / 65535.0;
+}
+
+//  -     input layout
+MeshVertex DecodeVertex(float4 pos, float2 normal, float2 tangent, float2 uv, float3 quantOffset, float3 quantScale)
+{
+    MeshVertex v;
+    v.pos = quantOffset + pos.xyz * quantScale;
+    v.normal = OctDecode(normal);
+    v.uv = uv;
+    v.tangent = OctDecode(tangent);
+    v.handed = pos.w * 2.0 - 1.0;
+    return v;
+}
+
+MeshVertex UnpackMeshVertex(PackedMeshVertex p, float3 quantOffset, float3 quantScale)
+{
+    return DecodeVertex(
+        UnpackUnorm4x16(p.pos),
+        UnpackSnorm2x16(p.normal),
+        UnpackSnorm2x16(p.tangent),
+        f16tof32(uint2(p.uv, p.uv >> 16)),
+        quantOffset, quantScale);
+}
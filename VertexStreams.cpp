@@ -0,0 +1,14 @@
+#include "VertexStreams.h"
+
+void SplitPositionStream(const Vertex* vertices, size_t count, XMFLOAT3* outPositions)
+{
+    for (size_t i = 0; i < count; ++i)
+        outPositions[i] = vertices[i].Pos;
+}
+
+std::vector<XMFLOAT3> ExtractPositionStream(const std::vector<Vertex>& vertices)
+{
+    std::vector<XMFLOAT3> positions(vertices.size());
+    SplitPositionStream(vertices.data(), vertices.size(), positions.data());
+    return positions;
+}
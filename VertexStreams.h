@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Vertexes.h"
+
+// Плотный поток позиций (12 байт на вершину) для теней, depth-only проходов и BLAS.
+// Полный Vertex - 48 байт, из которых этим проходам нужна только позиция.
+static const uint32_t PositionStreamStride = sizeof(XMFLOAT3);
+
+void SplitPositionStream(const Vertex* vertices, size_t count, XMFLOAT3* outPositions);
+std::vector<XMFLOAT3> ExtractPositionStream(const std::vector<Vertex>& vertices);
@@ -0,0 +1,92 @@
+#include "VertexWeld.h"
+#include "ObjParser.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+VertexWeldTable::VertexWeldTable(size_t positionCount, size_t expectedUnique)
+    : m_heads(positionCount, Empty)
+{
+    m_entries.reserve(expectedUnique);
+}
+
+VertexWeldBenchmarkResult RunVertexWeldBenchmark(const std::string& objPath)
+{
+    VertexWeldBenchmarkResult r;
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::string warn, err;
+    if (!ParallelLoadObj(&attrib, &shapes, nullptr, &warn, &err, objPath.c_str(), nullptr, nullptr))
+        return r;
+
+    for (const auto& shape : shapes)
+        r.corners += shape.mesh.indices.size();
+
+    // так сваривали LoadGeometry и ImportObj
+    std::vector<uint32_t> mapIndices;
+    std::vector<tinyobj::index_t> mapVertices;
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::unordered_map<uint64_t, uint32_t> uniqueVerts;
+        uniqueVerts.reserve(shapes.size() * 3);
+        for (const auto& shape : shapes)
+        {
+            for (const auto& idx : shape.mesh.indices)
+            {
+                uint64_t key = (uint64_t(idx.vertex_index + 1) << 42)
+                    | (uint64_t(idx.texcoord_index + 1) << 21)
+                    | uint64_t(idx.normal_index + 1);
+
+                auto it = uniqueVerts.find(key);
+                if (it == uniqueVerts.end())
+                {
+                    const uint32_t newIndex = (uint32_t)mapVertices.size();
+                    mapVertices.push_back(idx);
+                    mapIndices.push_back(newIndex);
+                    uniqueVerts[key] = newIndex;
+                }
+                else
+                {
+                    mapIndices.push_back(it->second);
+                }
+            }
+        }
+        // узел MSVC: значение и два указателя списка; на корзину - два итератора
+        r.unorderedMapBytes = uniqueVerts.size() * (sizeof(std::pair<const uint64_t, uint32_t>) + 2 * sizeof(void*)) +
+            uniqueVerts.bucket_count() * 2 * sizeof(void*);
+    }
+    r.unorderedMapMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint32_t> tableIndices;
+    std::vector<tinyobj::index_t> tableVertices;
+    start = std::chrono::steady_clock::now();
+    {
+        VertexWeldTable weld(attrib.vertices.size() / 3, (std::min)(r.corners, attrib.vertices.size() / 3));
+        tableIndices.reserve(r.corners);
+        for (const auto& shape : shapes)
+        {
+            for (const auto& idx : shape.mesh.indices)
+            {
+                bool isNew;
+                const uint32_t index = weld.FindOrAdd(idx.vertex_index, idx.texcoord_index, idx.normal_index, 0,
+                    (uint32_t)tableVertices.size(), isNew);
+                if (isNew)
+                    tableVertices.push_back(idx);
+                tableIndices.push_back(index);
+            }
+        }
+        r.tableBytes = weld.GetMemoryBytes();
+    }
+    r.tableMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    r.vertices = tableVertices.size();
+    r.matches = mapIndices == tableIndices && mapVertices.size() == tableVertices.size();
+    for (size_t i = 0; r.matches && i < mapVertices.size(); ++i)
+    {
+        r.matches = mapVertices[i].vertex_index == tableVertices[i].vertex_index &&
+            mapVertices[i].texcoord_index == tableVertices[i].texcoord_index &&
+            mapVertices[i].normal_index == tableVertices[i].normal_index;
+    }
+    return r;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Сварка вершин OBJ: (v, vt, vn) -> номер вершины в порядке первого появления.
+// Вместо хеша по упакованному ключу - плоская таблица по индексу позиции: у каждой позиции
+// короткая цепочка вариантов (vt, vn), записи лежат подряд в одном массиве. Соседние углы
+// ссылаются на соседние позиции, поэтому поиск почти всегда попадает в кэш, а на вершину
+// уходит 20 байт без аллокаций. Ключ сравнивается целиком, индексы больше 2^21 не склеиваются.
+class VertexWeldTable
+{
+public:
+    // positionCount - размер attrib.vertices / 3, expectedUnique - оценка числа вершин
+    VertexWeldTable(size_t positionCount, size_t expectedUnique);
+
+    // group разделяет одинаковые тройки разных сабмешей (материалов).
+    // Тройки ещё не было - запоминает за ней newValue и ставит isNew; иначе возвращает запомненное.
+    uint32_t FindOrAdd(int v, int vt, int vn, uint32_t group, uint32_t newValue, bool& isNew)
+    {
+        if ((size_t)(uint32_t)v >= m_heads.size())
+            m_heads.resize((size_t)(uint32_t)v + 1, Empty);
+
+        uint32_t& head = m_heads[(uint32_t)v];
+        for (uint32_t e = head; e != Empty; e = m_entries[e].next)
+        {
+            const Entry& entry = m_entries[e];
+            if (entry.vt == vt && entry.vn == vn && entry.group == group)
+            {
+                isNew = false;
+                return entry.value;
+            }
+        }
+
+        isNew = true;
+        m_entries.push_back({ vt, vn, group, newValue, head });
+        head = (uint32_t)m_entries.size() - 1;
+        return newValue;
+    }
+
+    size_t GetCount() const { return m_entries.size(); }
+    size_t GetMemoryBytes() const { return m_heads.capacity() * sizeof(uint32_t) + m_entries.capacity() * sizeof(Entry); }
+
+private:
+    static constexpr uint32_t Empty = UINT32_MAX;
+
+    struct Entry
+    {
+        int vt;
+        int vn;
+        uint32_t group;
+        uint32_t value;
+        uint32_t next;
+    };
+
+    std::vector<uint32_t> m_heads;
+    std::vector<Entry> m_entries;
+};
+
+struct VertexWeldBenchmarkResult
+{
+    size_t corners = 0;
+    size_t vertices = 0;
+    double unorderedMapMs = 0.0;
+    double tableMs = 0.0;
+    size_t unorderedMapBytes = 0;  // оценка: узлы и корзины
+    size_t tableBytes = 0;
+    bool matches = false;          // одинаковые потоки вершин и индексов
+};
+
+// сварка всех граней objPath одним потоком: старый unordered_map с упакованным ключом против VertexWeldTable
+VertexWeldBenchmarkResult RunVertexWeldBenchmark(const std::string& objPath);